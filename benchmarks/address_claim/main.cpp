@@ -0,0 +1,229 @@
+#include "isobus/hardware_integration/can_hardware_interface.hpp"
+#include "isobus/hardware_integration/virtual_can_plugin.hpp"
+#include "isobus/isobus/can_general_parameter_group_numbers.hpp"
+#include "isobus/isobus/can_internal_control_function.hpp"
+#include "isobus/isobus/can_network_configuration.hpp"
+#include "isobus/isobus/can_network_manager.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static constexpr std::uint32_t CLAIM_TIMEOUT_MS = 10000; ///< How long to wait for all addresses to be claimed before giving up
+static constexpr std::uint8_t NUMBER_OF_CHANNELS = 4; ///< Each run claims on its own channel, with a second channel listening on the same virtual bus
+
+// Counted on the listening channel of each run
+static std::array<std::atomic<std::uint32_t>, NUMBER_OF_CHANNELS> requestsForClaimOnBus;
+static std::array<std::atomic<std::uint32_t>, NUMBER_OF_CHANNELS> addressClaimsOnBus;
+
+struct BenchmarkResult
+{
+	std::string name;
+	std::uint32_t internalControlFunctions;
+	std::uint32_t claimed;
+	std::uint32_t uniqueAddresses;
+	double timeToAllClaimedSeconds;
+	std::uint32_t requestsForClaim;
+	std::uint32_t addressClaims;
+};
+
+void update_CAN_network()
+{
+	isobus::CANNetworkManager::CANNetwork.update();
+}
+
+void raw_can_glue(isobus::HardwareInterfaceCANFrame &rawFrame, void *parentPointer)
+{
+	if (rawFrame.channel < NUMBER_OF_CHANNELS)
+	{
+		const std::uint32_t parameterGroupNumber = isobus::CANIdentifier(rawFrame.identifier).get_parameter_group_number();
+
+		if (static_cast<std::uint32_t>(isobus::CANLibParameterGroupNumber::ParameterGroupNumberRequest) == parameterGroupNumber)
+		{
+			requestsForClaimOnBus[rawFrame.channel].fetch_add(1);
+		}
+		else if (static_cast<std::uint32_t>(isobus::CANLibParameterGroupNumber::AddressClaim) == parameterGroupNumber)
+		{
+			addressClaimsOnBus[rawFrame.channel].fetch_add(1);
+		}
+	}
+	isobus::CANNetworkManager::CANNetwork.can_lib_process_rx_message(rawFrame, parentPointer);
+}
+
+BenchmarkResult run_benchmark(const std::string &name,
+                              bool coordinated,
+                              std::uint8_t claimChannel,
+                              std::uint8_t listenChannel,
+                              std::uint32_t numberOfControlFunctions,
+                              std::vector<std::unique_ptr<isobus::InternalControlFunction>> &controlFunctions)
+{
+	BenchmarkResult retVal;
+
+	retVal.name = name;
+	retVal.internalControlFunctions = numberOfControlFunctions;
+	retVal.claimed = 0;
+	retVal.uniqueAddresses = 0;
+
+	isobus::CANNetworkConfiguration::set_coordinated_address_claiming(coordinated);
+	const std::size_t firstControlFunction = controlFunctions.size();
+	const auto startTime = std::chrono::steady_clock::now();
+
+	// Like a gateway, every control function would like the same address
+	for (std::uint32_t i = 0; i < numberOfControlFunctions; i++)
+	{
+		isobus::NAME controlFunctionName(0);
+		controlFunctionName.set_arbitrary_address_capable(true);
+		controlFunctionName.set_industry_group(2);
+		controlFunctionName.set_function_code(static_cast<std::uint8_t>(isobus::NAME::Function::OffVehicleGateway));
+		controlFunctionName.set_function_instance(claimChannel);
+		controlFunctionName.set_identity_number(i + 1);
+		controlFunctionName.set_manufacturer_code(64);
+		controlFunctions.emplace_back(new isobus::InternalControlFunction(controlFunctionName, 0x80, claimChannel));
+	}
+
+	while ((retVal.claimed < numberOfControlFunctions) &&
+	       (std::chrono::steady_clock::now() - startTime < std::chrono::milliseconds(CLAIM_TIMEOUT_MS)))
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		retVal.claimed = 0;
+
+		for (std::size_t i = firstControlFunction; i < controlFunctions.size(); i++)
+		{
+			if (controlFunctions[i]->get_address_valid())
+			{
+				retVal.claimed++;
+			}
+		}
+	}
+	retVal.timeToAllClaimedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	// Let any contention caused by duplicate claims play out before checking the result
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+	std::set<std::uint8_t> addresses;
+	for (std::size_t i = firstControlFunction; i < controlFunctions.size(); i++)
+	{
+		if (controlFunctions[i]->get_address_valid())
+		{
+			addresses.insert(controlFunctions[i]->get_address());
+		}
+	}
+	retVal.uniqueAddresses = static_cast<std::uint32_t>(addresses.size());
+	retVal.requestsForClaim = requestsForClaimOnBus[listenChannel].load();
+	retVal.addressClaims = addressClaimsOnBus[listenChannel].load();
+	return retVal;
+}
+
+std::string results_to_json(const std::vector<BenchmarkResult> &results)
+{
+	std::ostringstream json;
+
+	json.precision(6);
+	json << std::fixed;
+	json << "{\n  \"benchmark\": \"address_claim\",\n  \"results\": [\n";
+
+	for (std::size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult &result = results[i];
+
+		json << "    {\n";
+		json << "      \"name\": \"" << result.name << "\",\n";
+		json << "      \"internal_control_functions\": " << result.internalControlFunctions << ",\n";
+		json << "      \"claimed\": " << result.claimed << ",\n";
+		json << "      \"unique_addresses\": " << result.uniqueAddresses << ",\n";
+		json << "      \"time_to_all_claimed_s\": " << result.timeToAllClaimedSeconds << ",\n";
+		json << "      \"requests_for_claim_on_bus\": " << result.requestsForClaim << ",\n";
+		json << "      \"address_claims_on_bus\": " << result.addressClaims << "\n";
+		json << "    }" << ((i + 1 < results.size()) ? "," : "") << "\n";
+	}
+	json << "  ]\n}\n";
+	return json.str();
+}
+
+int main(int argc, char **argv)
+{
+	std::string outputFileName;
+	std::uint32_t numberOfControlFunctions = 16;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string argument(argv[i]);
+
+		if (("--output" == argument) && (i + 1 < argc))
+		{
+			outputFileName = argv[++i];
+		}
+		else if (("--count" == argument) && (i + 1 < argc))
+		{
+			numberOfControlFunctions = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--count internal_control_functions_per_run] [--output results.json]" << std::endl;
+			return -1;
+		}
+	}
+
+	if ((0 == numberOfControlFunctions) || (numberOfControlFunctions > 120))
+	{
+		std::cerr << "The number of internal control functions must be between 1 and 120." << std::endl;
+		return -1;
+	}
+
+	// Channels 0 and 1 share one virtual bus, channels 2 and 3 share another, so the runs don't see each other
+	CANHardwareInterface::set_number_of_can_channels(NUMBER_OF_CHANNELS);
+	CANHardwareInterface::assign_can_channel_frame_handler(0, std::make_shared<VirtualCANPlugin>("independent_claim"));
+	CANHardwareInterface::assign_can_channel_frame_handler(1, std::make_shared<VirtualCANPlugin>("independent_claim"));
+	CANHardwareInterface::assign_can_channel_frame_handler(2, std::make_shared<VirtualCANPlugin>("coordinated_claim"));
+	CANHardwareInterface::assign_can_channel_frame_handler(3, std::make_shared<VirtualCANPlugin>("coordinated_claim"));
+
+	if (!CANHardwareInterface::start())
+	{
+		std::cerr << "Failed to start hardware interface." << std::endl;
+		return -2;
+	}
+
+	CANHardwareInterface::add_can_lib_update_callback(update_CAN_network, nullptr);
+	CANHardwareInterface::add_raw_can_message_rx_callback(raw_can_glue, nullptr);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+	// The control functions have to outlive the network manager's use of them, so they are only deleted at the end
+	std::vector<std::unique_ptr<isobus::InternalControlFunction>> controlFunctions;
+	std::vector<BenchmarkResult> results;
+	results.push_back(run_benchmark("independent", false, 0, 1, numberOfControlFunctions, controlFunctions));
+	results.push_back(run_benchmark("coordinated", true, 2, 3, numberOfControlFunctions, controlFunctions));
+
+	CANHardwareInterface::stop();
+	controlFunctions.clear();
+
+	const std::string json = results_to_json(results);
+
+	if (outputFileName.empty())
+	{
+		std::cout << json;
+	}
+	else
+	{
+		std::ofstream outputFile(outputFileName);
+		outputFile << json;
+	}
+
+	for (const auto &result : results)
+	{
+		if (result.claimed != result.internalControlFunctions)
+		{
+			return -3;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,345 @@
+#include "isobus/hardware_integration/can_hardware_interface.hpp"
+#include "isobus/hardware_integration/virtual_can_plugin.hpp"
+#include "isobus/isobus/can_NAME_filter.hpp"
+#include "isobus/isobus/can_internal_control_function.hpp"
+#include "isobus/isobus/can_network_configuration.hpp"
+#include "isobus/isobus/can_network_manager.hpp"
+#include "isobus/isobus/can_partnered_control_function.hpp"
+#include "isobus/isobus/nmea2000_fast_packet_protocol.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Every heap allocation in the process is counted, so the numbers include the
+// hardware interface threads as well as the stack itself.
+static std::atomic<std::uint64_t> allocationCount = { 0 };
+
+void *operator new(std::size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	void *retVal = std::malloc(0 == size ? 1 : size);
+
+	if (nullptr == retVal)
+	{
+		throw std::bad_alloc();
+	}
+	return retVal;
+}
+
+void *operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+static constexpr std::uint32_t BENCHMARK_PGN = 0xEF00; ///< Proprietary A, used for the destination specific runs
+static constexpr std::uint32_t BROADCAST_BENCHMARK_PGN = 0xFF00; ///< Proprietary B, used for BAM runs
+static constexpr std::uint32_t FAST_PACKET_BENCHMARK_PGN = 0x1FF00; ///< NMEA 2000 proprietary fast packet range
+static constexpr std::uint32_t MESSAGE_TIMEOUT_MS = 10000; ///< How long to wait for any single message before giving up
+
+static std::atomic<std::uint32_t> messagesReceived = { 0 };
+static std::atomic<std::uint32_t> bytesReceived = { 0 };
+static std::atomic<std::uint32_t> messagesTransmitted = { 0 };
+static std::atomic<std::uint64_t> framesOnBus = { 0 };
+
+struct BenchmarkResult
+{
+	std::string name;
+	std::uint32_t payloadBytes;
+	std::uint32_t iterations;
+	std::uint32_t completed;
+	double wallTimeSeconds;
+	double cpuTimeSeconds;
+	std::uint64_t frames;
+	std::uint64_t allocations;
+};
+
+enum class BenchmarkType
+{
+	TransportProtocolBroadcast,
+	TransportProtocolConnectionMode,
+	ExtendedTransportProtocol,
+	FastPacket
+};
+
+void update_CAN_network()
+{
+	isobus::CANNetworkManager::CANNetwork.update();
+}
+
+void raw_can_glue(isobus::HardwareInterfaceCANFrame &rawFrame, void *parentPointer)
+{
+	framesOnBus.fetch_add(1, std::memory_order_relaxed);
+	isobus::CANNetworkManager::CANNetwork.can_lib_process_rx_message(rawFrame, parentPointer);
+}
+
+void benchmark_message_received(isobus::CANMessage *message, void *)
+{
+	bytesReceived.fetch_add(message->get_data_length());
+	messagesReceived.fetch_add(1);
+}
+
+void benchmark_message_transmitted(std::uint32_t, std::uint32_t, isobus::InternalControlFunction *, isobus::ControlFunction *, bool successful, void *)
+{
+	if (successful)
+	{
+		messagesTransmitted.fetch_add(1);
+	}
+}
+
+BenchmarkResult run_benchmark(const std::string &name,
+                              BenchmarkType type,
+                              std::uint32_t payloadBytes,
+                              std::uint32_t iterations,
+                              isobus::InternalControlFunction *sender,
+                              isobus::ControlFunction *receiver)
+{
+	BenchmarkResult retVal;
+	std::vector<std::uint8_t> payload(payloadBytes);
+
+	for (std::size_t i = 0; i < payload.size(); i++)
+	{
+		payload[i] = static_cast<std::uint8_t>(i);
+	}
+
+	retVal.name = name;
+	retVal.payloadBytes = payloadBytes;
+	retVal.iterations = iterations;
+	retVal.completed = 0;
+
+	messagesReceived = 0;
+	bytesReceived = 0;
+	messagesTransmitted = 0;
+	const std::uint64_t startFrames = framesOnBus.load();
+	const std::uint64_t startAllocations = allocationCount.load();
+	const std::clock_t startCPUTime = std::clock();
+	const auto startWallTime = std::chrono::steady_clock::now();
+
+	for (std::uint32_t i = 0; i < iterations; i++)
+	{
+		bool sent = false;
+
+		switch (type)
+		{
+			case BenchmarkType::TransportProtocolBroadcast:
+			{
+				sent = isobus::CANNetworkManager::CANNetwork.send_can_message(BROADCAST_BENCHMARK_PGN, payload.data(), payloadBytes, sender, nullptr, isobus::CANIdentifier::CANPriority::PriorityDefault6, benchmark_message_transmitted);
+			}
+			break;
+
+			case BenchmarkType::TransportProtocolConnectionMode:
+			case BenchmarkType::ExtendedTransportProtocol:
+			{
+				sent = isobus::CANNetworkManager::CANNetwork.send_can_message(BENCHMARK_PGN, payload.data(), payloadBytes, sender, receiver, isobus::CANIdentifier::CANPriority::PriorityDefault6, benchmark_message_transmitted);
+			}
+			break;
+
+			case BenchmarkType::FastPacket:
+			{
+				sent = isobus::FastPacketProtocol::Protocol.send_multipacket_message(FAST_PACKET_BENCHMARK_PGN, payload.data(), static_cast<std::uint8_t>(payloadBytes), sender, nullptr, isobus::CANIdentifier::CANPriority::PriorityDefault6, benchmark_message_transmitted);
+			}
+			break;
+		}
+
+		if (!sent)
+		{
+			std::cerr << "[" << name << "]: Failed to start sending message " << i << std::endl;
+			break;
+		}
+
+		const auto messageStartTime = std::chrono::steady_clock::now();
+		// Both ends have to be done with the session before another one can be started
+		while (((messagesReceived.load() <= i) || (messagesTransmitted.load() <= i)) &&
+		       (std::chrono::steady_clock::now() - messageStartTime < std::chrono::milliseconds(MESSAGE_TIMEOUT_MS)))
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+
+		if ((messagesReceived.load() <= i) || (messagesTransmitted.load() <= i))
+		{
+			std::cerr << "[" << name << "]: Timed out waiting for message " << i << std::endl;
+			break;
+		}
+		retVal.completed++;
+	}
+
+	retVal.wallTimeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startWallTime).count();
+	retVal.cpuTimeSeconds = static_cast<double>(std::clock() - startCPUTime) / CLOCKS_PER_SEC;
+	retVal.frames = framesOnBus.load() - startFrames;
+	retVal.allocations = allocationCount.load() - startAllocations;
+
+	// Give the stack a moment to close out the sessions before the next run
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	return retVal;
+}
+
+std::string results_to_json(const std::vector<BenchmarkResult> &results)
+{
+	std::ostringstream json;
+
+	json.precision(6);
+	json << std::fixed;
+	json << "{\n  \"benchmark\": \"throughput\",\n  \"results\": [\n";
+
+	for (std::size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult &result = results[i];
+		const double totalBytes = static_cast<double>(result.payloadBytes) * result.completed;
+		const double wallTime = (result.wallTimeSeconds > 0.0) ? result.wallTimeSeconds : 1.0;
+
+		json << "    {\n";
+		json << "      \"name\": \"" << result.name << "\",\n";
+		json << "      \"payload_bytes\": " << result.payloadBytes << ",\n";
+		json << "      \"iterations\": " << result.iterations << ",\n";
+		json << "      \"completed\": " << result.completed << ",\n";
+		json << "      \"wall_time_s\": " << result.wallTimeSeconds << ",\n";
+		json << "      \"cpu_time_s\": " << result.cpuTimeSeconds << ",\n";
+		json << "      \"bytes_per_second\": " << (totalBytes / wallTime) << ",\n";
+		json << "      \"frames\": " << result.frames << ",\n";
+		json << "      \"frames_per_second\": " << (static_cast<double>(result.frames) / wallTime) << ",\n";
+		json << "      \"allocations\": " << result.allocations << ",\n";
+		json << "      \"allocations_per_message\": " << ((0 != result.completed) ? (static_cast<double>(result.allocations) / result.completed) : 0.0) << "\n";
+		json << "    }" << ((i + 1 < results.size()) ? "," : "") << "\n";
+	}
+	json << "  ]\n}\n";
+	return json.str();
+}
+
+int main(int argc, char **argv)
+{
+	std::string outputFileName;
+
+	if ((argc > 2) && (std::string("--output") == argv[1]))
+	{
+		outputFileName = argv[2];
+	}
+	else if (argc > 1)
+	{
+		std::cerr << "Usage: " << argv[0] << " [--output results.json]" << std::endl;
+		return -1;
+	}
+
+	// Run as fast as the standard allows
+	isobus::CANNetworkConfiguration::set_minimum_time_between_transport_protocol_bam_frames(10);
+
+	// Port 0 is the sender, port 1 is the receiver, both on the same virtual bus
+	std::shared_ptr<VirtualCANPlugin> senderDevice = std::make_shared<VirtualCANPlugin>("throughput");
+	std::shared_ptr<VirtualCANPlugin> receiverDevice = std::make_shared<VirtualCANPlugin>("throughput");
+	CANHardwareInterface::set_number_of_can_channels(2);
+	CANHardwareInterface::assign_can_channel_frame_handler(0, senderDevice);
+	CANHardwareInterface::assign_can_channel_frame_handler(1, receiverDevice);
+
+	if (!CANHardwareInterface::start())
+	{
+		std::cerr << "Failed to start hardware interface." << std::endl;
+		return -2;
+	}
+
+	CANHardwareInterface::add_can_lib_update_callback(update_CAN_network, nullptr);
+	CANHardwareInterface::add_raw_can_message_rx_callback(raw_can_glue, nullptr);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+	isobus::NAME senderName(0);
+	senderName.set_arbitrary_address_capable(true);
+	senderName.set_industry_group(1);
+	senderName.set_function_code(static_cast<std::uint8_t>(isobus::NAME::Function::SteeringControl));
+	senderName.set_identity_number(1);
+	senderName.set_manufacturer_code(64);
+	isobus::InternalControlFunction senderECU(senderName, 0x1C, 0);
+
+	isobus::NAME receiverName(0);
+	receiverName.set_arbitrary_address_capable(true);
+	receiverName.set_industry_group(1);
+	receiverName.set_function_code(static_cast<std::uint8_t>(isobus::NAME::Function::TripRecorder));
+	receiverName.set_identity_number(2);
+	receiverName.set_manufacturer_code(64);
+	isobus::InternalControlFunction receiverECU(receiverName, 0x1D, 1);
+
+	const isobus::NAMEFilter receiverFilter(isobus::NAME::NAMEParameters::FunctionCode, static_cast<std::uint8_t>(isobus::NAME::Function::TripRecorder));
+	isobus::PartneredControlFunction senderPartner(0, { receiverFilter });
+	const isobus::NAMEFilter senderFilter(isobus::NAME::NAMEParameters::FunctionCode, static_cast<std::uint8_t>(isobus::NAME::Function::SteeringControl));
+	isobus::PartneredControlFunction receiverPartner(1, { senderFilter });
+
+	receiverPartner.add_parameter_group_number_callback(BENCHMARK_PGN, benchmark_message_received, nullptr);
+	isobus::CANNetworkManager::CANNetwork.add_global_parameter_group_number_callback(BROADCAST_BENCHMARK_PGN, benchmark_message_received, nullptr);
+	isobus::FastPacketProtocol::Protocol.register_multipacket_message_callback(FAST_PACKET_BENCHMARK_PGN, benchmark_message_received, nullptr);
+
+	// Wait for address claiming to finish
+	for (std::uint32_t i = 0; (i < 200) && ((!senderECU.get_address_valid()) || (!senderPartner.get_address_valid())); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	if ((!senderECU.get_address_valid()) || (!senderPartner.get_address_valid()))
+	{
+		std::cerr << "Address claiming did not complete." << std::endl;
+		CANHardwareInterface::stop();
+		return -3;
+	}
+
+	std::vector<BenchmarkResult> results;
+	results.push_back(run_benchmark("tp_bam", BenchmarkType::TransportProtocolBroadcast, 64, 3, &senderECU, nullptr));
+	results.push_back(run_benchmark("tp_bam", BenchmarkType::TransportProtocolBroadcast, 256, 2, &senderECU, nullptr));
+	results.push_back(run_benchmark("tp_cm", BenchmarkType::TransportProtocolConnectionMode, 64, 20, &senderECU, &senderPartner));
+	results.push_back(run_benchmark("tp_cm", BenchmarkType::TransportProtocolConnectionMode, 512, 20, &senderECU, &senderPartner));
+	results.push_back(run_benchmark("tp_cm", BenchmarkType::TransportProtocolConnectionMode, 1785, 20, &senderECU, &senderPartner));
+	results.push_back(run_benchmark("etp", BenchmarkType::ExtendedTransportProtocol, 1786, 10, &senderECU, &senderPartner));
+	results.push_back(run_benchmark("etp", BenchmarkType::ExtendedTransportProtocol, 16384, 5, &senderECU, &senderPartner));
+	results.push_back(run_benchmark("etp", BenchmarkType::ExtendedTransportProtocol, 131072, 2, &senderECU, &senderPartner));
+	results.push_back(run_benchmark("fast_packet", BenchmarkType::FastPacket, 32, 20, &senderECU, nullptr));
+	results.push_back(run_benchmark("fast_packet", BenchmarkType::FastPacket, 223, 20, &senderECU, nullptr));
+
+	CANHardwareInterface::stop();
+
+	const std::string json = results_to_json(results);
+
+	if (outputFileName.empty())
+	{
+		std::cout << json;
+	}
+	else
+	{
+		std::ofstream outputFile(outputFileName);
+		outputFile << json;
+	}
+
+	for (const auto &result : results)
+	{
+		if (result.completed != result.iterations)
+		{
+			return -4;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,504 @@
+#include "isobus/hardware_integration/can_hardware_interface.hpp"
+#include "isobus/hardware_integration/virtual_can_plugin.hpp"
+#include "isobus/isobus/can_NAME_filter.hpp"
+#include "isobus/isobus/can_internal_control_function.hpp"
+#include "isobus/isobus/can_network_manager.hpp"
+#include "isobus/isobus/can_partnered_control_function.hpp"
+#include "isobus/isobus/isobus_virtual_terminal_client.hpp"
+#include "isobus/isobus/isobus_virtual_terminal_object_pool_index.hpp"
+#include "isobus/utility/iop_file_interface.hpp"
+
+#include "simulated_vt_server.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static constexpr std::uint32_t CONNECT_TIMEOUT_MS = 60000; ///< How long to wait for the client to connect before giving up
+static constexpr std::uint32_t COMMAND_TIMEOUT_MS = 10000; ///< How long to wait for command responses before giving up
+static const std::string MANIFEST_FILE_NAME = "vt_client_benchmark_manifest.bin"; ///< Where the client keeps its object pool manifest
+
+static std::shared_ptr<SimulatedVirtualTerminalServer> server;
+static std::mutex serverMutex;
+
+struct ConnectResult
+{
+	std::string name;
+	std::string pool;
+	bool connected;
+	bool partialUpload;
+	double timeToFirstMaskSeconds;
+	double timeToConnectedSeconds;
+	std::uint32_t uploadBytes;
+	double uploadSeconds;
+};
+
+struct CommandResult
+{
+	std::string name;
+	std::string pool;
+	std::uint32_t processingDelay_ms;
+	std::uint32_t commands;
+	std::uint32_t completed;
+	double wallTimeSeconds;
+	std::vector<double> latenciesMilliseconds;
+};
+
+void update_CAN_network()
+{
+	isobus::CANNetworkManager::CANNetwork.update();
+
+	const std::lock_guard<std::mutex> lock(serverMutex);
+	if (nullptr != server)
+	{
+		server->update();
+	}
+}
+
+void raw_can_glue(isobus::HardwareInterfaceCANFrame &rawFrame, void *parentPointer)
+{
+	isobus::CANNetworkManager::CANNetwork.can_lib_process_rx_message(rawFrame, parentPointer);
+}
+
+std::string get_pool_name(const std::string &fileName)
+{
+	const std::size_t separator = fileName.find_last_of("/\\");
+	return (std::string::npos == separator) ? fileName : fileName.substr(separator + 1);
+}
+
+bool find_working_set(const isobus::VirtualTerminalObjectPoolIndex &poolIndex, isobus::VirtualTerminalObjectPoolIndex::ObjectInfo &workingSet)
+{
+	bool retVal = false;
+
+	// The working set object isn't always the first object in the pool
+	for (std::size_t i = 0; i < poolIndex.get_number_objects(); i++)
+	{
+		const isobus::VirtualTerminalObjectPoolIndex::ObjectInfo *object = poolIndex.get_object_at_position(i);
+
+		if ((nullptr != object) &&
+		    (isobus::VirtualTerminalObjectType::WorkingSet == object->type))
+		{
+			workingSet = *object;
+			retVal = true;
+			break;
+		}
+	}
+	return retVal;
+}
+
+ConnectResult run_connect_benchmark(const std::string &name,
+                                    const std::string &poolName,
+                                    const std::vector<std::uint8_t> &pool,
+                                    const std::string &versionLabel,
+                                    std::shared_ptr<isobus::PartneredControlFunction> partnerVT,
+                                    std::shared_ptr<isobus::InternalControlFunction> internalECU,
+                                    std::unique_ptr<isobus::VirtualTerminalClient> &client)
+{
+	ConnectResult retVal;
+
+	retVal.name = name;
+	retVal.pool = poolName;
+	retVal.connected = false;
+	retVal.partialUpload = false;
+	retVal.timeToFirstMaskSeconds = 0.0;
+	retVal.timeToConnectedSeconds = 0.0;
+	retVal.uploadBytes = 0;
+	retVal.uploadSeconds = 0.0;
+
+	// Each run is a fresh client, like an ECU that was just powered on
+	client.reset();
+	client.reset(new isobus::VirtualTerminalClient(partnerVT, internalECU));
+	client->set_object_pool(0, isobus::VirtualTerminalClient::VTVersion::Version3, &pool, versionLabel);
+	client->set_object_pool_manifest_file(MANIFEST_FILE_NAME);
+
+	const auto previousMaskShownTime = server->get_data_mask_shown_time();
+	const std::uint32_t previousNumberUploads = server->get_number_uploads();
+	const auto startTime = std::chrono::steady_clock::now();
+	client->initialize(true);
+	server->send_status_now();
+
+	while ((!client->get_is_connected()) &&
+	       (std::chrono::steady_clock::now() - startTime < std::chrono::milliseconds(CONNECT_TIMEOUT_MS)))
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+	}
+	const auto connectedTime = std::chrono::steady_clock::now();
+
+	retVal.connected = client->get_is_connected();
+	if (retVal.connected)
+	{
+		const auto maskShownTime = server->get_data_mask_shown_time();
+
+		retVal.partialUpload = client->get_last_upload_was_partial();
+		retVal.timeToConnectedSeconds = std::chrono::duration<double>(connectedTime - startTime).count();
+
+		if (maskShownTime != previousMaskShownTime)
+		{
+			retVal.timeToFirstMaskSeconds = std::chrono::duration<double>(maskShownTime - startTime).count();
+		}
+
+		// A load from the VT's memory doesn't upload anything
+		if (server->get_number_uploads() != previousNumberUploads)
+		{
+			retVal.uploadBytes = server->get_last_upload_size();
+			retVal.uploadSeconds = server->get_last_upload_duration_s();
+		}
+	}
+	else
+	{
+		std::cerr << "[" << name << "]: Timed out connecting with " << poolName << std::endl;
+	}
+	return retVal;
+}
+
+CommandResult run_command_benchmark(const std::string &name,
+                                    const std::string &poolName,
+                                    bool burst,
+                                    std::uint32_t numberOfCommands,
+                                    std::uint16_t objectID,
+                                    bool numericObject,
+                                    isobus::VirtualTerminalClient &client)
+{
+	CommandResult retVal;
+	std::mutex resultMutex;
+	std::vector<std::chrono::steady_clock::time_point> sendTimes(numberOfCommands);
+	std::atomic<std::uint32_t> numberCompleted = { 0 };
+
+	retVal.name = name;
+	retVal.pool = poolName;
+	retVal.processingDelay_ms = server->get_processing_delay_ms();
+	retVal.commands = numberOfCommands;
+	retVal.completed = 0;
+
+	client.set_command_pipeline_enabled(true);
+	client.get_command_pipeline().set_maximum_queue_size(std::max<std::uint32_t>(numberOfCommands, isobus::VirtualTerminalCommandPipeline::DEFAULT_MAXIMUM_QUEUE_SIZE));
+
+	const auto startTime = std::chrono::steady_clock::now();
+
+	for (std::uint32_t i = 0; i < numberOfCommands; i++)
+	{
+		auto callback = [i, &sendTimes, &resultMutex, &retVal, &numberCompleted](isobus::VirtualTerminalCommandPipeline::Result result, std::uint8_t) {
+			const auto now = std::chrono::steady_clock::now();
+
+			if (isobus::VirtualTerminalCommandPipeline::Result::Success == result)
+			{
+				const std::lock_guard<std::mutex> lock(resultMutex);
+				retVal.latenciesMilliseconds.push_back(std::chrono::duration<double, std::milli>(now - sendTimes[i]).count());
+			}
+			numberCompleted.fetch_add(1);
+		};
+		auto send = [&client, objectID, numericObject, i]() {
+			// Every value is different, so nothing is skipped as a duplicate
+			return numericObject ? client.send_change_numeric_value(objectID, i) : client.send_change_background_colour(objectID, static_cast<std::uint8_t>(i));
+		};
+
+		sendTimes[i] = std::chrono::steady_clock::now();
+		if (!client.send_command_with_completion(send, isobus::VirtualTerminalCommandPipeline::Priority::Normal, callback))
+		{
+			std::cerr << "[" << name << "]: Failed to queue command " << i << std::endl;
+			break;
+		}
+
+		if (!burst)
+		{
+			// Wait for the response before sending the next command, so the latency is a single round trip
+			const auto commandStartTime = std::chrono::steady_clock::now();
+			while ((numberCompleted.load() <= i) &&
+			       (std::chrono::steady_clock::now() - commandStartTime < std::chrono::milliseconds(COMMAND_TIMEOUT_MS)))
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+			}
+		}
+	}
+
+	while ((numberCompleted.load() < numberOfCommands) &&
+	       (std::chrono::steady_clock::now() - startTime < std::chrono::milliseconds(COMMAND_TIMEOUT_MS)))
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(50));
+	}
+	retVal.wallTimeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	{
+		const std::lock_guard<std::mutex> lock(resultMutex);
+		retVal.completed = static_cast<std::uint32_t>(retVal.latenciesMilliseconds.size());
+		std::sort(retVal.latenciesMilliseconds.begin(), retVal.latenciesMilliseconds.end());
+	}
+
+	// Don't leave any callbacks pointing at this stack frame
+	client.get_command_pipeline().abort_all();
+	return retVal;
+}
+
+double get_percentile(const std::vector<double> &sortedValues, double percentile)
+{
+	double retVal = 0.0;
+
+	if (!sortedValues.empty())
+	{
+		const std::size_t index = static_cast<std::size_t>(percentile / 100.0 * (sortedValues.size() - 1) + 0.5);
+		retVal = sortedValues[std::min(index, sortedValues.size() - 1)];
+	}
+	return retVal;
+}
+
+std::string results_to_json(const std::vector<ConnectResult> &connectResults, const std::vector<CommandResult> &commandResults)
+{
+	std::ostringstream json;
+
+	json.precision(6);
+	json << std::fixed;
+	json << "{\n  \"benchmark\": \"vt_client\",\n  \"connect_results\": [\n";
+
+	for (std::size_t i = 0; i < connectResults.size(); i++)
+	{
+		const ConnectResult &result = connectResults[i];
+
+		json << "    {\n";
+		json << "      \"name\": \"" << result.name << "\",\n";
+		json << "      \"pool\": \"" << result.pool << "\",\n";
+		json << "      \"connected\": " << (result.connected ? "true" : "false") << ",\n";
+		json << "      \"partial_upload\": " << (result.partialUpload ? "true" : "false") << ",\n";
+		json << "      \"time_to_first_mask_s\": " << result.timeToFirstMaskSeconds << ",\n";
+		json << "      \"time_to_connected_s\": " << result.timeToConnectedSeconds << ",\n";
+		json << "      \"upload_bytes\": " << result.uploadBytes << ",\n";
+		json << "      \"upload_time_s\": " << result.uploadSeconds << ",\n";
+		json << "      \"upload_bytes_per_second\": " << ((result.uploadSeconds > 0.0) ? (result.uploadBytes / result.uploadSeconds) : 0.0) << "\n";
+		json << "    }" << ((i + 1 < connectResults.size()) ? "," : "") << "\n";
+	}
+	json << "  ],\n  \"command_results\": [\n";
+
+	for (std::size_t i = 0; i < commandResults.size(); i++)
+	{
+		const CommandResult &result = commandResults[i];
+		const double wallTime = (result.wallTimeSeconds > 0.0) ? result.wallTimeSeconds : 1.0;
+
+		json << "    {\n";
+		json << "      \"name\": \"" << result.name << "\",\n";
+		json << "      \"pool\": \"" << result.pool << "\",\n";
+		json << "      \"processing_delay_ms\": " << result.processingDelay_ms << ",\n";
+		json << "      \"commands\": " << result.commands << ",\n";
+		json << "      \"completed\": " << result.completed << ",\n";
+		json << "      \"wall_time_s\": " << result.wallTimeSeconds << ",\n";
+		json << "      \"commands_per_second\": " << (result.completed / wallTime) << ",\n";
+		json << "      \"latency_p50_ms\": " << get_percentile(result.latenciesMilliseconds, 50.0) << ",\n";
+		json << "      \"latency_p90_ms\": " << get_percentile(result.latenciesMilliseconds, 90.0) << ",\n";
+		json << "      \"latency_p99_ms\": " << get_percentile(result.latenciesMilliseconds, 99.0) << ",\n";
+		json << "      \"latency_max_ms\": " << (result.latenciesMilliseconds.empty() ? 0.0 : result.latenciesMilliseconds.back()) << "\n";
+		json << "    }" << ((i + 1 < commandResults.size()) ? "," : "") << "\n";
+	}
+	json << "  ]\n}\n";
+	return json.str();
+}
+
+int main(int argc, char **argv)
+{
+	std::string outputFileName;
+	std::uint32_t processingDelay_ms = 0;
+	std::uint32_t numberOfCommands = 200;
+	std::vector<std::string> poolFileNames;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string argument(argv[i]);
+
+		if (("--output" == argument) && (i + 1 < argc))
+		{
+			outputFileName = argv[++i];
+		}
+		else if (("--delay" == argument) && (i + 1 < argc))
+		{
+			processingDelay_ms = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (("--commands" == argument) && (i + 1 < argc))
+		{
+			numberOfCommands = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (("--pool" == argument) && (i + 1 < argc))
+		{
+			poolFileNames.push_back(argv[++i]);
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--pool file.iop]... [--delay command_processing_ms] [--commands count] [--output results.json]" << std::endl;
+			return -1;
+		}
+	}
+
+	if (poolFileNames.empty())
+	{
+		// The example pools are copied next to the benchmark when it's built
+		poolFileNames = { "VT3TestPool.iop", "vtpooldata.iop" };
+	}
+
+	if (0 == numberOfCommands)
+	{
+		std::cerr << "At least one command must be sent." << std::endl;
+		return -1;
+	}
+
+	// Port 0 is the working set, port 1 is the VT, both on the same virtual bus
+	CANHardwareInterface::set_number_of_can_channels(2);
+	CANHardwareInterface::assign_can_channel_frame_handler(0, std::make_shared<VirtualCANPlugin>("vt_client"));
+	CANHardwareInterface::assign_can_channel_frame_handler(1, std::make_shared<VirtualCANPlugin>("vt_client"));
+
+	if (!CANHardwareInterface::start())
+	{
+		std::cerr << "Failed to start hardware interface." << std::endl;
+		return -2;
+	}
+
+	CANHardwareInterface::add_can_lib_update_callback(update_CAN_network, nullptr);
+	CANHardwareInterface::add_raw_can_message_rx_callback(raw_can_glue, nullptr);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+	isobus::NAME workingSetName(0);
+	workingSetName.set_arbitrary_address_capable(true);
+	workingSetName.set_industry_group(2);
+	workingSetName.set_function_code(static_cast<std::uint8_t>(isobus::NAME::Function::SteeringControl));
+	workingSetName.set_identity_number(1);
+	workingSetName.set_manufacturer_code(64);
+	auto internalECU = std::make_shared<isobus::InternalControlFunction>(workingSetName, 0x1C, 0);
+
+	isobus::NAME serverName(0);
+	serverName.set_arbitrary_address_capable(true);
+	serverName.set_industry_group(2);
+	serverName.set_function_code(static_cast<std::uint8_t>(isobus::NAME::Function::VirtualTerminal));
+	serverName.set_identity_number(2);
+	serverName.set_manufacturer_code(64);
+	auto internalVT = std::make_shared<isobus::InternalControlFunction>(serverName, 0x26, 1);
+
+	const isobus::NAMEFilter virtualTerminalFilter(isobus::NAME::NAMEParameters::FunctionCode, static_cast<std::uint8_t>(isobus::NAME::Function::VirtualTerminal));
+	auto partnerVT = std::make_shared<isobus::PartneredControlFunction>(0, std::vector<isobus::NAMEFilter>{ virtualTerminalFilter });
+	const isobus::NAMEFilter workingSetFilter(isobus::NAME::NAMEParameters::FunctionCode, static_cast<std::uint8_t>(isobus::NAME::Function::SteeringControl));
+	auto partnerWorkingSet = std::make_shared<isobus::PartneredControlFunction>(1, std::vector<isobus::NAMEFilter>{ workingSetFilter });
+
+	{
+		const std::lock_guard<std::mutex> lock(serverMutex);
+		server = std::make_shared<SimulatedVirtualTerminalServer>(internalVT, partnerWorkingSet);
+	}
+	server->set_processing_delay_ms(processingDelay_ms);
+
+	// Wait for address claiming to finish
+	for (std::uint32_t i = 0; (i < 200) && ((!partnerVT->get_address_valid()) || (!partnerWorkingSet->get_address_valid())); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	if ((!partnerVT->get_address_valid()) || (!partnerWorkingSet->get_address_valid()))
+	{
+		std::cerr << "Address claiming did not complete." << std::endl;
+		CANHardwareInterface::stop();
+		return -3;
+	}
+
+	std::vector<ConnectResult> connectResults;
+	std::vector<CommandResult> commandResults;
+	std::unique_ptr<isobus::VirtualTerminalClient> client;
+	bool allPoolsLoaded = true;
+
+	for (std::size_t i = 0; i < poolFileNames.size(); i++)
+	{
+		const std::string poolName = get_pool_name(poolFileNames[i]);
+		const std::vector<std::uint8_t> pool = isobus::IOPFileInterface::read_iop_file(poolFileNames[i]);
+		isobus::VirtualTerminalObjectPoolIndex poolIndex;
+		isobus::VirtualTerminalObjectPoolIndex::ObjectInfo workingSet;
+
+		if ((pool.empty()) ||
+		    (!poolIndex.build(pool.data(), static_cast<std::uint32_t>(pool.size()))) ||
+		    (!find_working_set(poolIndex, workingSet)))
+		{
+			std::cerr << "Failed to load a valid object pool from " << poolFileNames[i] << std::endl;
+			allPoolsLoaded = false;
+			continue;
+		}
+
+		// Start every pool from an empty VT, with no manifest from a previous pool
+		server->clear();
+		std::remove(MANIFEST_FILE_NAME.c_str());
+
+		const std::string versionLabel = "BENCH" + std::to_string(i);
+		connectResults.push_back(run_connect_benchmark("upload", poolName, pool, versionLabel, partnerVT, internalECU, client));
+		connectResults.push_back(run_connect_benchmark("load_version", poolName, pool, versionLabel, partnerVT, internalECU, client));
+
+		// A new version of the pool where only the working set's background colour is different
+		std::vector<std::uint8_t> changedPool = pool;
+		changedPool[workingSet.offset + 3]++;
+		connectResults.push_back(run_connect_benchmark("partial_upload", poolName, changedPool, "BENCH" + std::to_string(i) + "P", partnerVT, internalECU, client));
+
+		if ((nullptr != client) && (client->get_is_connected()))
+		{
+			// Change a number if the pool has one, otherwise the working set's background colour
+			std::uint16_t objectID = workingSet.objectID;
+			bool numericObject = false;
+
+			for (std::size_t j = 0; j < poolIndex.get_number_objects(); j++)
+			{
+				const isobus::VirtualTerminalObjectPoolIndex::ObjectInfo *object = poolIndex.get_object_at_position(j);
+
+				if ((nullptr != object) &&
+				    ((isobus::VirtualTerminalObjectType::NumberVariable == object->type) ||
+				     (isobus::VirtualTerminalObjectType::OutputNumber == object->type)))
+				{
+					objectID = object->objectID;
+					numericObject = true;
+					break;
+				}
+			}
+			commandResults.push_back(run_command_benchmark("sequential", poolName, false, numberOfCommands, objectID, numericObject, *client));
+			commandResults.push_back(run_command_benchmark("burst", poolName, true, numberOfCommands, objectID, numericObject, *client));
+		}
+	}
+
+	client.reset();
+	CANHardwareInterface::stop();
+	{
+		const std::lock_guard<std::mutex> lock(serverMutex);
+		server.reset();
+	}
+	std::remove(MANIFEST_FILE_NAME.c_str());
+
+	const std::string json = results_to_json(connectResults, commandResults);
+
+	if (outputFileName.empty())
+	{
+		std::cout << json;
+	}
+	else
+	{
+		std::ofstream outputFile(outputFileName);
+		outputFile << json;
+	}
+
+	if (!allPoolsLoaded)
+	{
+		return -4;
+	}
+
+	for (const auto &result : connectResults)
+	{
+		if (!result.connected)
+		{
+			return -5;
+		}
+	}
+
+	for (const auto &result : commandResults)
+	{
+		if (result.completed != result.commands)
+		{
+			return -6;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,593 @@
+//================================================================================================
+/// @file simulated_vt_server.cpp
+///
+/// @brief Implements a minimal VT server that runs on the virtual CAN bus
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#include "simulated_vt_server.hpp"
+
+#include "isobus/isobus/can_constants.hpp"
+#include "isobus/isobus/can_general_parameter_group_numbers.hpp"
+#include "isobus/isobus/can_network_manager.hpp"
+#include "isobus/isobus/isobus_virtual_terminal_object_pool_index.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// The VT function codes that the server handles itself, see ISO 11783-6 Annex F
+	constexpr std::uint8_t OBJECT_POOL_TRANSFER = 0x11;
+	constexpr std::uint8_t END_OF_OBJECT_POOL = 0x12;
+	constexpr std::uint8_t CHANGE_NUMERIC_VALUE = 0xA8;
+	constexpr std::uint8_t CHANGE_STRING_VALUE = 0xB3;
+	constexpr std::uint8_t DELETE_OBJECT_POOL = 0xB2;
+	constexpr std::uint8_t GET_MEMORY = 0xC0;
+	constexpr std::uint8_t GET_NUMBER_OF_SOFT_KEYS = 0xC2;
+	constexpr std::uint8_t GET_TEXT_FONT_DATA = 0xC3;
+	constexpr std::uint8_t GET_HARDWARE = 0xC7;
+	constexpr std::uint8_t STORE_VERSION = 0xD0;
+	constexpr std::uint8_t LOAD_VERSION = 0xD1;
+	constexpr std::uint8_t DELETE_VERSION = 0xD2;
+	constexpr std::uint8_t GET_VERSIONS = 0xDF;
+	constexpr std::uint8_t GET_VERSIONS_RESPONSE = 0xE0;
+	constexpr std::uint8_t VT_STATUS = 0xFE;
+
+	constexpr std::size_t VERSION_LABEL_LENGTH = 7;
+	constexpr std::uint32_t WORKING_SET_ACTIVE_MASK_OFFSET = 5; ///< Where a working set object's active mask attribute is
+
+	/// @brief Finds where the error code is in a command's response
+	/// @param[in] functionCode The command's function code
+	/// @param[out] offset The offset of the error code in the response
+	/// @returns `true` if the command has a response the server sends, otherwise `false`
+	bool get_error_code_offset(std::uint8_t functionCode, std::uint8_t &offset)
+	{
+		bool retVal = true;
+
+		switch (functionCode)
+		{
+			case 0xA3: // Control audio signal
+			case 0xA4: // Set audio volume
+			{
+				offset = 1;
+			}
+			break;
+
+			case 0xBD: // Lock/unlock mask
+			case 0xBE: // Execute macro
+			{
+				offset = 2;
+			}
+			break;
+
+			case 0x92: // ESC
+			case 0xA6: // Change size
+			case CHANGE_NUMERIC_VALUE:
+			case 0xA9: // Change end point
+			case 0xAA: // Change font attributes
+			case 0xAB: // Change line attributes
+			case 0xAC: // Change fill attributes
+			case 0xAD: // Change active mask
+			case 0xB5: // Change object label
+			case 0xB6: // Change polygon point
+			case 0xBA: // Select colour map
+			case 0xBC: // Execute extended macro
+			{
+				offset = 3;
+			}
+			break;
+
+			case 0xA0: // Hide/show object
+			case 0xA1: // Enable/disable object
+			case 0xA2: // Select input object
+			case 0xA7: // Change background colour
+			case 0xAF: // Change attribute
+			case 0xB0: // Change priority
+			case 0xB8: // Graphics context
+			{
+				offset = 4;
+			}
+			break;
+
+			case 0xA5: // Change child location
+			case 0xAE: // Change soft key mask
+			case CHANGE_STRING_VALUE:
+			case 0xB4: // Change child position
+			{
+				offset = 5;
+			}
+			break;
+
+			case 0xB1: // Change list item
+			{
+				offset = 6;
+			}
+			break;
+
+			case 0xB7: // Change polygon scale
+			{
+				offset = 7;
+			}
+			break;
+
+			default:
+			{
+				retVal = false;
+			}
+			break;
+		}
+		return retVal;
+	}
+} // namespace
+
+SimulatedVirtualTerminalServer::SimulatedVirtualTerminalServer(std::shared_ptr<isobus::InternalControlFunction> serverControlFunction,
+                                                               std::shared_ptr<isobus::PartneredControlFunction> workingSetControlFunction) :
+  serverControlFunction(serverControlFunction),
+  workingSetControlFunction(workingSetControlFunction),
+  lastUploadDuration_s(0.0),
+  lastUploadSize(0),
+  numberUploads(0),
+  processingDelay_ms(0),
+  numberCommandsAcknowledged(0),
+  activeDataMask(NULL_OBJECT_ID),
+  statusChanged(true)
+{
+	workingSetControlFunction->add_parameter_group_number_callback(static_cast<std::uint32_t>(isobus::CANLibParameterGroupNumber::ECUtoVirtualTerminal), process_rx_message, this);
+}
+
+SimulatedVirtualTerminalServer::~SimulatedVirtualTerminalServer()
+{
+	workingSetControlFunction->remove_parameter_group_number_callback(static_cast<std::uint32_t>(isobus::CANLibParameterGroupNumber::ECUtoVirtualTerminal), process_rx_message, this);
+}
+
+void SimulatedVirtualTerminalServer::update()
+{
+	const std::lock_guard<std::mutex> lock(serverMutex);
+	const auto now = std::chrono::steady_clock::now();
+
+	if (serverControlFunction->get_address_valid())
+	{
+		if ((statusChanged) ||
+		    (now - lastStatusTime >= std::chrono::milliseconds(STATUS_INTERVAL_MS)))
+		{
+			if (send_status())
+			{
+				lastStatusTime = now;
+				statusChanged = false;
+			}
+		}
+
+		while ((!pendingResponses.empty()) &&
+		       (pendingResponses.front().dueTime <= now) &&
+		       (send_to_working_set(pendingResponses.front().data.data(), static_cast<std::uint32_t>(pendingResponses.front().data.size()))))
+		{
+			pendingResponses.pop_front();
+			numberCommandsAcknowledged++;
+		}
+	}
+}
+
+void SimulatedVirtualTerminalServer::send_status_now()
+{
+	const std::lock_guard<std::mutex> lock(serverMutex);
+	statusChanged = true;
+}
+
+void SimulatedVirtualTerminalServer::set_processing_delay_ms(std::uint32_t delay_ms)
+{
+	const std::lock_guard<std::mutex> lock(serverMutex);
+	processingDelay_ms = delay_ms;
+}
+
+std::uint32_t SimulatedVirtualTerminalServer::get_processing_delay_ms() const
+{
+	const std::lock_guard<std::mutex> lock(serverMutex);
+	return processingDelay_ms;
+}
+
+void SimulatedVirtualTerminalServer::clear()
+{
+	const std::lock_guard<std::mutex> lock(serverMutex);
+	storedVersions.clear();
+	activeObjects.clear();
+	transferredData.clear();
+	pendingResponses.clear();
+	activeDataMask = NULL_OBJECT_ID;
+	statusChanged = true;
+}
+
+bool SimulatedVirtualTerminalServer::get_has_version(const std::string &label) const
+{
+	std::string paddedLabel = label;
+	paddedLabel.resize(VERSION_LABEL_LENGTH, ' ');
+
+	const std::lock_guard<std::mutex> lock(serverMutex);
+	return (storedVersions.end() != storedVersions.find(paddedLabel));
+}
+
+std::uint16_t SimulatedVirtualTerminalServer::get_active_data_mask() const
+{
+	const std::lock_guard<std::mutex> lock(serverMutex);
+	return activeDataMask;
+}
+
+std::chrono::steady_clock::time_point SimulatedVirtualTerminalServer::get_data_mask_shown_time() const
+{
+	const std::lock_guard<std::mutex> lock(serverMutex);
+	return dataMaskShownTime;
+}
+
+std::uint32_t SimulatedVirtualTerminalServer::get_last_upload_size() const
+{
+	const std::lock_guard<std::mutex> lock(serverMutex);
+	return lastUploadSize;
+}
+
+double SimulatedVirtualTerminalServer::get_last_upload_duration_s() const
+{
+	const std::lock_guard<std::mutex> lock(serverMutex);
+	return lastUploadDuration_s;
+}
+
+std::uint32_t SimulatedVirtualTerminalServer::get_number_uploads() const
+{
+	const std::lock_guard<std::mutex> lock(serverMutex);
+	return numberUploads;
+}
+
+std::uint32_t SimulatedVirtualTerminalServer::get_number_commands_acknowledged() const
+{
+	const std::lock_guard<std::mutex> lock(serverMutex);
+	return numberCommandsAcknowledged;
+}
+
+void SimulatedVirtualTerminalServer::process_rx_message(isobus::CANMessage *message, void *parentPointer)
+{
+	if ((nullptr != message) &&
+	    (nullptr != parentPointer) &&
+	    (0 != message->get_data_length()))
+	{
+		SimulatedVirtualTerminalServer *server = static_cast<SimulatedVirtualTerminalServer *>(parentPointer);
+		const std::lock_guard<std::mutex> lock(server->serverMutex);
+		server->process_working_set_message(message->get_data().data(), message->get_data_length());
+	}
+}
+
+void SimulatedVirtualTerminalServer::process_working_set_message(const std::uint8_t *data, std::uint32_t length)
+{
+	std::array<std::uint8_t, 8> response;
+	response.fill(0xFF);
+	response[0] = data[0];
+
+	switch (data[0])
+	{
+		case GET_MEMORY:
+		{
+			// There's always enough memory
+			response[1] = VT_VERSION;
+			response[2] = 0;
+			send_response(response);
+		}
+		break;
+
+		case GET_NUMBER_OF_SOFT_KEYS:
+		{
+			response[1] = 0;
+			response[4] = SOFT_KEY_PIXELS;
+			response[5] = SOFT_KEY_PIXELS;
+			response[6] = 64;
+			response[7] = 6;
+			send_response(response);
+		}
+		break;
+
+		case GET_TEXT_FONT_DATA:
+		{
+			response[5] = 0xFF;
+			response[6] = 0x7F;
+			response[7] = 0xFF;
+			send_response(response);
+		}
+		break;
+
+		case GET_HARDWARE:
+		{
+			response[1] = 0xFF;
+			response[2] = 2; // 256 colours
+			response[3] = 0x0F;
+			response[4] = static_cast<std::uint8_t>(DATA_MASK_PIXELS & 0xFF);
+			response[5] = static_cast<std::uint8_t>(DATA_MASK_PIXELS >> 8);
+			response[6] = static_cast<std::uint8_t>(DATA_MASK_PIXELS & 0xFF);
+			response[7] = static_cast<std::uint8_t>(DATA_MASK_PIXELS >> 8);
+			send_response(response);
+		}
+		break;
+
+		case GET_VERSIONS:
+		{
+			std::vector<std::uint8_t> versionsResponse = { GET_VERSIONS_RESPONSE, static_cast<std::uint8_t>(storedVersions.size()) };
+
+			for (const auto &version : storedVersions)
+			{
+				versionsResponse.insert(versionsResponse.end(), version.first.begin(), version.first.end());
+			}
+			versionsResponse.resize(std::max<std::size_t>(versionsResponse.size(), response.size()), 0xFF);
+
+			if (send_to_working_set(versionsResponse.data(), static_cast<std::uint32_t>(versionsResponse.size())))
+			{
+				lastResponseTime = std::chrono::steady_clock::now();
+			}
+		}
+		break;
+
+		case STORE_VERSION:
+		{
+			if ((length >= 1 + VERSION_LABEL_LENGTH) &&
+			    (!activeObjects.empty()))
+			{
+				storedVersions[get_label(&data[1])] = get_active_pool();
+				response[5] = 0;
+			}
+			else
+			{
+				response[5] = 0x04; // Any other error
+			}
+			send_response(response);
+		}
+		break;
+
+		case LOAD_VERSION:
+		{
+			auto version = (length >= 1 + VERSION_LABEL_LENGTH) ? storedVersions.find(get_label(&data[1])) : storedVersions.end();
+
+			if (storedVersions.end() != version)
+			{
+				activeObjects.clear();
+				transferredData.clear();
+
+				if (add_objects(version->second.data(), static_cast<std::uint32_t>(version->second.size())))
+				{
+					show_working_set();
+					response[5] = 0;
+				}
+				else
+				{
+					response[5] = 0x01; // File system error or pool data corruption
+				}
+			}
+			else
+			{
+				response[5] = 0x02; // Version label unknown
+			}
+			send_response(response);
+		}
+		break;
+
+		case DELETE_VERSION:
+		{
+			response[5] = ((length >= 1 + VERSION_LABEL_LENGTH) && (0 != storedVersions.erase(get_label(&data[1])))) ? 0 : 0x02;
+			send_response(response);
+		}
+		break;
+
+		case OBJECT_POOL_TRANSFER:
+		{
+			if (transferredData.empty())
+			{
+				// The upload could start as soon as the working set had our last answer
+				uploadStartTime = lastResponseTime;
+			}
+			transferredData.insert(transferredData.end(), data + 1, data + length);
+		}
+		break;
+
+		case END_OF_OBJECT_POOL:
+		{
+			process_end_of_object_pool();
+		}
+		break;
+
+		case DELETE_OBJECT_POOL:
+		{
+			activeObjects.clear();
+			transferredData.clear();
+			activeDataMask = NULL_OBJECT_ID;
+			statusChanged = true;
+			response[1] = 0;
+			send_response(response);
+		}
+		break;
+
+		default:
+		{
+			PendingResponse pendingResponse;
+
+			if (get_command_response(data, length, pendingResponse.data))
+			{
+				pendingResponse.dueTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(processingDelay_ms);
+				pendingResponses.push_back(pendingResponse);
+			}
+		}
+		break;
+	}
+}
+
+void SimulatedVirtualTerminalServer::process_end_of_object_pool()
+{
+	std::array<std::uint8_t, 8> response = { END_OF_OBJECT_POOL, 0, 0xFF, 0xFF, 0xFF, 0xFF, 0, 0xFF };
+	const auto now = std::chrono::steady_clock::now();
+
+	numberUploads++;
+	lastUploadSize = static_cast<std::uint32_t>(transferredData.size());
+	lastUploadDuration_s = std::chrono::duration<double>(now - uploadStartTime).count();
+
+	if ((!transferredData.empty()) &&
+	    (!add_objects(transferredData.data(), static_cast<std::uint32_t>(transferredData.size()))))
+	{
+		response[1] = 0x01; // There are errors in the object pool
+		response[6] = 0x10; // Any other error
+	}
+	else if (activeObjects.empty())
+	{
+		response[1] = 0x01;
+		response[6] = 0x10;
+	}
+	else
+	{
+		show_working_set();
+	}
+	transferredData.clear();
+	send_response(response);
+}
+
+bool SimulatedVirtualTerminalServer::get_command_response(const std::uint8_t *data, std::uint32_t length, std::array<std::uint8_t, 8> &response) const
+{
+	std::uint8_t errorCodeOffset = 0;
+	bool retVal = get_error_code_offset(data[0], errorCodeOffset);
+
+	if (retVal)
+	{
+		const std::uint16_t objectID = (length >= 3) ? static_cast<std::uint16_t>(data[1] | (data[2] << 8)) : NULL_OBJECT_ID;
+		std::uint8_t errorCode = 0;
+
+		switch (data[0])
+		{
+			case 0xA0: // Hide/show object
+			case 0xA1: // Enable/disable object
+			case 0xA7: // Change background colour
+			case CHANGE_NUMERIC_VALUE:
+			case 0xAF: // Change attribute
+			case CHANGE_STRING_VALUE:
+			{
+				if (activeObjects.end() == activeObjects.find(objectID))
+				{
+					errorCode = 0x01; // Invalid object ID
+				}
+			}
+			break;
+
+			default:
+			{
+			}
+			break;
+		}
+
+		// Most responses echo the start of the command, with the error code after it
+		response.fill(0xFF);
+		std::memcpy(response.data(), data, std::min<std::size_t>(length, errorCodeOffset));
+		response[errorCodeOffset] = errorCode;
+
+		if (CHANGE_NUMERIC_VALUE == data[0])
+		{
+			// The response includes the value the object now has
+			std::memcpy(&response[4], &data[4], std::min<std::size_t>((length > 4) ? (length - 4) : 0, 4));
+		}
+		else if (CHANGE_STRING_VALUE == data[0])
+		{
+			response[1] = 0xFF;
+			response[2] = 0xFF;
+			response[3] = static_cast<std::uint8_t>(objectID & 0xFF);
+			response[4] = static_cast<std::uint8_t>(objectID >> 8);
+		}
+	}
+	return retVal;
+}
+
+bool SimulatedVirtualTerminalServer::add_objects(const std::uint8_t *poolData, std::uint32_t poolSize)
+{
+	isobus::VirtualTerminalObjectPoolIndex index;
+	bool retVal = index.build(poolData, poolSize);
+
+	if (retVal)
+	{
+		for (std::size_t i = 0; i < index.get_number_objects(); i++)
+		{
+			const isobus::VirtualTerminalObjectPoolIndex::ObjectInfo *object = index.get_object_at_position(i);
+
+			if (nullptr != object)
+			{
+				activeObjects[object->objectID].assign(poolData + object->offset, poolData + object->offset + object->length);
+			}
+		}
+	}
+	return retVal;
+}
+
+std::vector<std::uint8_t> SimulatedVirtualTerminalServer::get_active_pool() const
+{
+	std::vector<std::uint8_t> retVal;
+
+	for (const auto &object : activeObjects)
+	{
+		retVal.insert(retVal.end(), object.second.begin(), object.second.end());
+	}
+	return retVal;
+}
+
+void SimulatedVirtualTerminalServer::show_working_set()
+{
+	activeDataMask = NULL_OBJECT_ID;
+
+	for (const auto &object : activeObjects)
+	{
+		if ((object.second.size() > WORKING_SET_ACTIVE_MASK_OFFSET + 1) &&
+		    (static_cast<std::uint8_t>(isobus::VirtualTerminalObjectType::WorkingSet) == object.second[2]))
+		{
+			activeDataMask = static_cast<std::uint16_t>(object.second[WORKING_SET_ACTIVE_MASK_OFFSET] | (object.second[WORKING_SET_ACTIVE_MASK_OFFSET + 1] << 8));
+			break;
+		}
+	}
+	dataMaskShownTime = std::chrono::steady_clock::now();
+	statusChanged = true;
+}
+
+bool SimulatedVirtualTerminalServer::send_to_working_set(const std::uint8_t *data, std::uint32_t length)
+{
+	return isobus::CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(isobus::CANLibParameterGroupNumber::VirtualTerminalToECU),
+	                                                              data,
+	                                                              length,
+	                                                              serverControlFunction.get(),
+	                                                              workingSetControlFunction.get(),
+	                                                              isobus::CANIdentifier::PriorityLowest7);
+}
+
+void SimulatedVirtualTerminalServer::send_response(const std::array<std::uint8_t, 8> &response)
+{
+	if (send_to_working_set(response.data(), static_cast<std::uint32_t>(response.size())))
+	{
+		lastResponseTime = std::chrono::steady_clock::now();
+	}
+}
+
+bool SimulatedVirtualTerminalServer::send_status()
+{
+	const std::uint8_t workingSetMasterAddress = ((NULL_OBJECT_ID != activeDataMask) && (workingSetControlFunction->get_address_valid())) ? workingSetControlFunction->get_address() : isobus::NULL_CAN_ADDRESS;
+	const std::uint8_t buffer[8] = { VT_STATUS,
+		                               workingSetMasterAddress,
+		                               static_cast<std::uint8_t>(activeDataMask & 0xFF),
+		                               static_cast<std::uint8_t>(activeDataMask >> 8),
+		                               0xFF,
+		                               0xFF,
+		                               0, // Not busy
+		                               0xFF };
+	return isobus::CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(isobus::CANLibParameterGroupNumber::VirtualTerminalToECU),
+	                                                              buffer,
+	                                                              sizeof(buffer),
+	                                                              serverControlFunction.get(),
+	                                                              nullptr,
+	                                                              isobus::CANIdentifier::PriorityLowest7);
+}
+
+std::string SimulatedVirtualTerminalServer::get_label(const std::uint8_t *data)
+{
+	return std::string(reinterpret_cast<const char *>(data), VERSION_LABEL_LENGTH);
+}
+
+constexpr std::uint16_t SimulatedVirtualTerminalServer::NULL_OBJECT_ID;
+constexpr std::uint32_t SimulatedVirtualTerminalServer::STATUS_INTERVAL_MS;
+constexpr std::uint8_t SimulatedVirtualTerminalServer::VT_VERSION;
+constexpr std::uint16_t SimulatedVirtualTerminalServer::DATA_MASK_PIXELS;
+constexpr std::uint8_t SimulatedVirtualTerminalServer::SOFT_KEY_PIXELS;
@@ -0,0 +1,192 @@
+//================================================================================================
+/// @file simulated_vt_server.hpp
+///
+/// @brief A minimal VT server that runs on the virtual CAN bus, so that the VT client can be
+/// benchmarked without a physical terminal.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#ifndef SIMULATED_VT_SERVER_HPP
+#define SIMULATED_VT_SERVER_HPP
+
+#include "isobus/isobus/can_internal_control_function.hpp"
+#include "isobus/isobus/can_message.hpp"
+#include "isobus/isobus/can_partnered_control_function.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//================================================================================================
+/// @class SimulatedVirtualTerminalServer
+///
+/// @brief Answers one working set the way a VT would, closely enough for the VT client to connect,
+/// upload, store and load its pool, and send commands.
+/// @details The server responds to the get memory, get number of soft keys, get text font data, get hardware
+/// and get versions messages, accepts object pool transfers, and stores and loads versions in memory.
+/// Commands are acknowledged after a configurable processing delay, with an invalid object ID error if the
+/// object isn't in the active pool. Nothing is drawn, but the working set's active data mask is reported
+/// in the VT status message once the pool is active, which is when a real VT would show it.
+///
+/// Call update() periodically from the same thread that updates the network manager.
+//================================================================================================
+class SimulatedVirtualTerminalServer
+{
+public:
+	/// @brief Constructor for a server
+	/// @param[in] serverControlFunction The control function the server sends from, which should have the VT function code
+	/// @param[in] workingSetControlFunction The working set that the server talks to
+	SimulatedVirtualTerminalServer(std::shared_ptr<isobus::InternalControlFunction> serverControlFunction,
+	                               std::shared_ptr<isobus::PartneredControlFunction> workingSetControlFunction);
+
+	/// @brief Destructor for the server, which stops receiving messages
+	~SimulatedVirtualTerminalServer();
+
+	/// @brief Deleted copy constructor, since the server registers itself for callbacks
+	SimulatedVirtualTerminalServer(const SimulatedVirtualTerminalServer &) = delete;
+
+	/// @brief Deleted assignment operator, since the server registers itself for callbacks
+	/// @returns Nothing, since it's deleted
+	SimulatedVirtualTerminalServer &operator=(const SimulatedVirtualTerminalServer &) = delete;
+
+	/// @brief Sends the VT status message when it's due, and any command responses whose processing delay has passed
+	void update();
+
+	/// @brief Sends the VT status message on the next update instead of waiting for the interval, like a VT that just started up
+	void send_status_now();
+
+	/// @brief Sets how long the server takes to process each command before acknowledging it
+	/// @param[in] delay_ms The processing delay in milliseconds
+	void set_processing_delay_ms(std::uint32_t delay_ms);
+
+	/// @brief Returns how long the server takes to process each command
+	/// @returns The processing delay in milliseconds
+	std::uint32_t get_processing_delay_ms() const;
+
+	/// @brief Forgets every stored version and the active pool, like a VT that was factory reset
+	void clear();
+
+	/// @brief Returns if a version label is stored on the server
+	/// @param[in] label The version label, which is padded with spaces to 7 characters
+	/// @returns `true` if the version is stored, otherwise `false`
+	bool get_has_version(const std::string &label) const;
+
+	/// @brief Returns the active data mask of the working set
+	/// @returns The data mask's object ID, or 0xFFFF if no pool is active
+	std::uint16_t get_active_data_mask() const;
+
+	/// @brief Returns when the working set's data mask was last shown, after an upload or a load
+	/// @returns The time the data mask was shown
+	std::chrono::steady_clock::time_point get_data_mask_shown_time() const;
+
+	/// @brief Returns the number of object pool bytes received by the last upload
+	/// @returns The number of bytes in the object pool transfer messages, not counting their function code
+	std::uint32_t get_last_upload_size() const;
+
+	/// @brief Returns how long the last upload took, from the server's last response before it to the end of object pool message
+	/// @returns The duration of the last upload in seconds
+	double get_last_upload_duration_s() const;
+
+	/// @brief Returns the number of uploads that have finished, successfully or not
+	/// @returns The number of end of object pool messages received
+	std::uint32_t get_number_uploads() const;
+
+	/// @brief Returns the number of commands that have been acknowledged
+	/// @returns The number of command responses sent
+	std::uint32_t get_number_commands_acknowledged() const;
+
+	static constexpr std::uint16_t NULL_OBJECT_ID = 0xFFFF; ///< The ID that means "no object"
+	static constexpr std::uint32_t STATUS_INTERVAL_MS = 1000; ///< How often the VT status message is sent
+	static constexpr std::uint8_t VT_VERSION = 4; ///< The VT version the server reports
+	static constexpr std::uint16_t DATA_MASK_PIXELS = 480; ///< The width and height of the data mask area
+	static constexpr std::uint8_t SOFT_KEY_PIXELS = 60; ///< The width and height of a soft key designator
+
+private:
+	/// @brief A command response waiting for the processing delay to pass
+	struct PendingResponse
+	{
+		std::chrono::steady_clock::time_point dueTime; ///< When to send the response
+		std::array<std::uint8_t, 8> data; ///< The response message
+	};
+
+	/// @brief Handles messages from the working set
+	/// @param[in] message The message that was received
+	/// @param[in] parentPointer A pointer to the server
+	static void process_rx_message(isobus::CANMessage *message, void *parentPointer);
+
+	/// @brief Handles one message from the working set. Call with serverMutex locked.
+	/// @param[in] data The message data
+	/// @param[in] length The length of the message
+	void process_working_set_message(const std::uint8_t *data, std::uint32_t length);
+
+	/// @brief Handles the end of object pool message, by parsing what was transferred. Call with serverMutex locked.
+	void process_end_of_object_pool();
+
+	/// @brief Builds the response to a command. Call with serverMutex locked.
+	/// @param[in] data The command message
+	/// @param[in] length The length of the command message
+	/// @param[out] response The response to send
+	/// @returns `true` if the command has a response, otherwise `false`
+	bool get_command_response(const std::uint8_t *data, std::uint32_t length, std::array<std::uint8_t, 8> &response) const;
+
+	/// @brief Adds objects to the active pool, replacing any objects with the same IDs
+	/// @param[in] poolData The serialized objects
+	/// @param[in] poolSize The size of the serialized objects in bytes
+	/// @returns `true` if every object was understood, otherwise `false`
+	bool add_objects(const std::uint8_t *poolData, std::uint32_t poolSize);
+
+	/// @brief Serializes the active pool, so it can be stored as a version
+	/// @returns The active pool's objects
+	std::vector<std::uint8_t> get_active_pool() const;
+
+	/// @brief Makes the working set's active data mask visible. Call with serverMutex locked.
+	void show_working_set();
+
+	/// @brief Sends a message to the working set
+	/// @param[in] data The message to send
+	/// @param[in] length The length of the message
+	/// @returns `true` if the message was sent, otherwise `false`
+	bool send_to_working_set(const std::uint8_t *data, std::uint32_t length);
+
+	/// @brief Sends a response to one of the working set's connection messages. Call with serverMutex locked.
+	/// @param[in] response The message to send
+	void send_response(const std::array<std::uint8_t, 8> &response);
+
+	/// @brief Sends the VT status message
+	/// @returns `true` if the message was sent, otherwise `false`
+	bool send_status();
+
+	/// @brief Converts 7 bytes of a message into a version label
+	/// @param[in] data The first byte of the label
+	/// @returns The version label
+	static std::string get_label(const std::uint8_t *data);
+
+	std::shared_ptr<isobus::InternalControlFunction> serverControlFunction; ///< The control function the server sends from
+	std::shared_ptr<isobus::PartneredControlFunction> workingSetControlFunction; ///< The working set the server talks to
+	std::map<std::string, std::vector<std::uint8_t>> storedVersions; ///< The stored pools, by version label
+	std::map<std::uint16_t, std::vector<std::uint8_t>> activeObjects; ///< The objects in the active pool, by object ID
+	std::vector<std::uint8_t> transferredData; ///< The objects transferred since the last end of object pool message
+	std::deque<PendingResponse> pendingResponses; ///< Command responses waiting for the processing delay to pass
+	std::chrono::steady_clock::time_point lastStatusTime; ///< When the VT status message was last sent
+	std::chrono::steady_clock::time_point lastResponseTime; ///< When the last response to a connection message was sent
+	std::chrono::steady_clock::time_point uploadStartTime; ///< When the current upload could start
+	std::chrono::steady_clock::time_point dataMaskShownTime; ///< When the data mask was last shown
+	mutable std::mutex serverMutex; ///< Protects the server's state, which is read by the benchmark's thread
+	double lastUploadDuration_s; ///< How long the last upload took
+	std::uint32_t lastUploadSize; ///< The size of the last upload in bytes
+	std::uint32_t numberUploads; ///< The number of end of object pool messages received
+	std::uint32_t processingDelay_ms; ///< How long each command takes to process
+	std::uint32_t numberCommandsAcknowledged; ///< The number of command responses sent
+	std::uint16_t activeDataMask; ///< The working set's active data mask, or NULL_OBJECT_ID
+	bool statusChanged; ///< Whether the status should be sent without waiting for the interval
+};
+
+#endif // SIMULATED_VT_SERVER_HPP
@@ -42,6 +42,14 @@ namespace isobus
 		/// @returns true if a NAME matches this filter class's components
 		bool check_name_matches_filter(const NAME &nameToCompare) const;
 
+		/// @brief Returns this filter as a mask and value over the raw 64 bit NAME
+		/// @details A NAME matches the filter when `(NAME & mask) == matchValue`. This lets a set of filters be combined into
+		/// a single mask and value, so checking a NAME against them takes one AND and one compare.
+		/// @param[out] mask The bits of the NAME that the filter looks at
+		/// @param[out] matchValue The value those bits must have
+		/// @returns `true` if the filter can match a NAME, `false` if its value doesn't fit in the NAME component or the component is unknown
+		bool get_name_mask(std::uint64_t &mask, std::uint64_t &matchValue) const;
+
 	private:
 		NAME::NAMEParameters parameter; ///< The NAME component to filter against
 		std::uint32_t value; ///< The value of the data associated with the filter component
@@ -11,10 +11,16 @@
 #define CAN_ADDRESS_CLAIM_STATE_MACHINE_HPP
 
 #include "isobus/isobus/can_NAME.hpp"
+#include "isobus/isobus/can_badge.hpp"
+#include "isobus/isobus/can_constants.hpp"
+
+#include <array>
+#include <vector>
 
 namespace isobus
 {
 	class CANMessage; ///< Forward declare CANMessage
+	class InternalControlFunction; ///< Forward declare InternalControlFunction
 
 	//================================================================================================
 	/// @class AddressClaimStateMachine
@@ -23,6 +29,9 @@ namespace isobus
 	///
 	/// @details This class manages address claiming for internal control functions
 	/// and keeps track of things like requests for address claim.
+	/// When coordinated address claiming is enabled with CANNetworkConfiguration::set_coordinated_address_claiming,
+	/// all state machines on a CAN channel share one request for address claim, and once the contention
+	/// period has passed every one of them is resolved in the same pass.
 	//================================================================================================
 	class AddressClaimStateMachine
 	{
@@ -63,6 +72,12 @@ namespace isobus
 		/// @returns true if the class will address claim, false if in sniffing mode
 		bool get_enabled() const;
 
+		/// @brief Changes the address the state machine will try to claim first
+		/// @note This only has an effect before address claiming has started
+		/// @param[in] address The address you prefer to claim
+		/// @returns `true` if the preferred address was changed, `false` if claiming has already started or the address was invalid
+		bool set_preferred_address(std::uint8_t address);
+
 		/// @brief Returns the address claimed by the state machine or 0xFE if none claimed
 		/// @returns The address claimed by the state machine or 0xFE if no address has been claimed
 		std::uint8_t get_claimed_address() const;
@@ -70,7 +85,33 @@ namespace isobus
 		/// @brief Updates the state machine, should be called periodically
 		void update();
 
+		/// @brief Updates all state machines on a CAN channel together, used for coordinated address claiming
+		/// @details Sends a single request for address claim for all state machines on the channel that need an address,
+		/// then after the contention period claims addresses for all of them at once in order of their NAMEs, so that
+		/// state machines that prefer the same address don't claim it at the same time.
+		/// State machines that are not claiming are updated normally.
+		/// @param[in] portIndex The CAN channel index the state machines claim on
+		/// @param[in] stateMachines The state machines on the channel
+		static void update_coordinated(std::uint8_t portIndex, const std::vector<AddressClaimStateMachine *> &stateMachines, CANLibBadge<InternalControlFunction>);
+
 	private:
+		/// @brief The shared request for address claim of one CAN channel, when using coordinated address claiming
+		struct CoordinatedClaim
+		{
+			std::uint32_t timestamp_ms; ///< When the random delay started, or when the request was sent
+			bool waitingForDelay; ///< True while waiting out the random delay before sending the request
+			bool requestSent; ///< True while waiting out the contention period after the request
+		};
+
+		static constexpr std::uint32_t ADDRESS_CONTENTION_TIME_MS = 250; ///< The time to wait for address claims after a request for address claim
+
+		/// @brief Claims an address for each state machine in a coordinated claim
+		/// @param[in] portIndex The CAN channel index the state machines claim on
+		/// @param[in] stateMachines The state machines to claim addresses for
+		static void resolve_coordinated_claims(std::uint8_t portIndex, std::vector<AddressClaimStateMachine *> &stateMachines);
+
+		static std::array<CoordinatedClaim, CAN_PORT_MAXIMUM> coordinatedClaims; ///< The coordinated claim of each CAN channel
+
 		/// @brief Processes a CAN message
 		/// @param[in] message The CAN message being received
 		/// @param[in] parentPointer A context variable to find the relevant address claimer
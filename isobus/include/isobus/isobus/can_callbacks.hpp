@@ -30,6 +30,9 @@ namespace isobus
 	/// @brief A callback for control functions to get CAN messages
 	typedef void (*CANLibCallback)(CANMessage *message, void *parentPointer);
 	/// @brief A callback to get chunks of data for transfer by a protocol
+	/// @details By default the transport protocols ask for 7 bytes at a time. If
+	/// CANNetworkConfiguration::set_transport_protocol_window_data_chunk_callbacks is enabled,
+	/// TP and ETP instead ask for all the bytes needed by the current CTS window in one call.
 	typedef bool (*DataChunkCallback)(std::uint32_t callbackIndex,
 	                                  std::uint32_t bytesOffset,
 	                                  std::uint32_t numberOfBytesNeeded,
@@ -34,9 +34,11 @@ namespace isobus
 		WorkingSetMaster = 0xFE0D,
 		LanguageCommand = 0xFE0F,
 		ECUIdentificationInformation = 0xFDC5,
+		DiagnosticMessage25 = 0xFDB7,
 		DiagnosticMessage1 = 0xFECA,
 		DiagnosticMessage2 = 0xFECB,
 		DiagnosticMessage3 = 0xFECC,
+		DiagnosticMessage4 = 0xFECD,
 		DiagnosticMessage11 = 0xFED3,
 		SoftwareIdentification = 0xFEDA
 	};
@@ -55,10 +55,20 @@ namespace isobus
 		/// Other CF types are handled in Rx message processing.
 		static bool get_any_internal_control_function_changed_address(CANLibBadge<CANNetworkManager>);
 
+		/// @brief Lets network manager know a control function was created since the last address claiming update
+		/// @details New control functions haven't started claiming yet, so their preferred address can still be changed.
+		/// @returns true if any ICF was created since the last address claiming update
+		static bool get_any_new_internal_control_function(CANLibBadge<CANNetworkManager>);
+
 		/// @brief Used to determine if the internal control function changed address since the last network manager update
 		/// @returns true if the ICF changed address since the last network manager update
 		bool get_changed_address_since_last_update(CANLibBadge<CANNetworkManager>) const;
 
+		/// @brief Changes the address this control function will try to claim first, used when warm-starting from a NetworkSnapshot
+		/// @param[in] address The address to prefer
+		/// @returns `true` if the preferred address was changed, `false` if address claiming has already started
+		bool set_preferred_address(std::uint8_t address, CANLibBadge<CANNetworkManager>);
+
 		/// @brief Updates all address claim state machines
 		static void update_address_claiming(CANLibBadge<CANNetworkManager>);
 
@@ -66,8 +76,12 @@ namespace isobus
 		/// @brief Updates the internal control function, should be called periodically by the network manager
 		void update();
 
+		/// @brief Copies the address claimed by the state machine, and notes if it changed
+		void update_address();
+
 		static std::vector<InternalControlFunction *> internalControlFunctionList; ///< A list of all internal control functions that exist
 		static bool anyChangedAddress; ///< Lets the network manager know if any ICF changed address since the last update
+		static bool anyNewInternalControlFunction; ///< Lets the network manager know if any ICF was created since the last update
 		AddressClaimStateMachine stateMachine; ///< The address claimer for this ICF
 		bool objectChangedAddressSinceLastUpdate; ///< Tracks if this object has changed address since the last update
 	};
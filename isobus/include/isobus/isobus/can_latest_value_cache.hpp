@@ -0,0 +1,138 @@
+//================================================================================================
+/// @file can_latest_value_cache.hpp
+///
+/// @brief Keeps the most recent payload of selected PGNs from each source, so that any thread
+/// can read the latest value of a PGN without callbacks or locks.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#ifndef CAN_LATEST_VALUE_CACHE_HPP
+#define CAN_LATEST_VALUE_CACHE_HPP
+
+#include "isobus/isobus/can_constants.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace isobus
+{
+	class CANMessage;
+
+	//================================================================================================
+	/// @class LatestValueCache
+	///
+	/// @brief Stores the latest payload, timestamp, and length of selected PGNs per CAN channel and source address.
+	/// @details The network manager owns one of these, get it with CANNetworkManager::get_latest_value_cache.
+	/// Add the PGNs you care about with add_parameter_group_number, then read them from any thread with get_latest_value.
+	/// Each source's value lives in a slot protected by a sequence number (a seqlock), so the network manager never waits for
+	/// a reader, and a reader never waits for the network manager. Readers simply try again if the value changed while they were
+	/// copying it. Slots are allocated the first time a source sends a cached PGN, and are kept until the cache is destroyed.
+	//================================================================================================
+	class LatestValueCache
+	{
+	public:
+		/// @brief Describes a cached value
+		struct ValueInfo
+		{
+			std::uint32_t timestamp_ms; ///< When the value was received, in milliseconds
+			std::uint16_t dataLength; ///< The length of the payload in bytes
+			std::uint8_t sourceAddress; ///< The address that sent the value
+		};
+
+		/// @brief Constructor for an empty cache
+		LatestValueCache();
+
+		/// @brief Destructor for the cache, which frees all slots
+		~LatestValueCache();
+
+		/// @brief Starts caching a PGN
+		/// @param[in] parameterGroupNumber The PGN to cache
+		/// @returns `true` if the PGN is now cached, `false` if the cache is full
+		bool add_parameter_group_number(std::uint32_t parameterGroupNumber);
+
+		/// @brief Returns if a PGN is being cached
+		/// @param[in] parameterGroupNumber The PGN to check
+		/// @returns `true` if the PGN was added with add_parameter_group_number, otherwise `false`
+		bool get_is_parameter_group_number_cached(std::uint32_t parameterGroupNumber) const;
+
+		/// @brief Copies the latest value of a PGN. This never blocks and never allocates.
+		/// @param[in] canPort The CAN channel index the PGN was received on
+		/// @param[in] parameterGroupNumber The PGN to get
+		/// @param[in] sourceAddress The address that sent the PGN, or 0xFF to get the latest value from any source
+		/// @param[out] buffer Where to copy the payload to
+		/// @param[in] bufferSize The size of the buffer. Longer payloads are truncated, but ValueInfo::dataLength is still the full length.
+		/// @param[out] info The timestamp, length, and source of the value
+		/// @returns `true` if a value was copied, `false` if the PGN has not been received from that source, or isn't cached
+		bool get_latest_value(std::uint8_t canPort,
+		                      std::uint32_t parameterGroupNumber,
+		                      std::uint8_t sourceAddress,
+		                      std::uint8_t *buffer,
+		                      std::uint16_t bufferSize,
+		                      ValueInfo &info) const;
+
+		/// @brief Returns how long ago a PGN was last received, for staleness checks
+		/// @param[in] canPort The CAN channel index the PGN was received on
+		/// @param[in] parameterGroupNumber The PGN to check
+		/// @param[in] sourceAddress The address that sent the PGN, or 0xFF for the latest value from any source
+		/// @returns The age of the value in milliseconds, or 0xFFFFFFFF if the PGN has not been received
+		std::uint32_t get_age_ms(std::uint8_t canPort, std::uint32_t parameterGroupNumber, std::uint8_t sourceAddress) const;
+
+		/// @brief Stores a received message if its PGN is cached. Called by the network manager for each received message.
+		/// @note Only one thread may call this at a time
+		/// @param[in] message The received message
+		void record(CANMessage &message);
+
+		static constexpr std::uint16_t MAX_DATA_LENGTH = 64; ///< The longest payload that is cached, longer messages are ignored
+		static constexpr std::size_t MAX_PARAMETER_GROUP_NUMBERS = 32; ///< The number of PGNs that can be cached
+		static constexpr std::uint32_t NO_VALUE_AGE = 0xFFFFFFFF; ///< Returned by get_age_ms when there is no value
+
+	private:
+		static constexpr std::uint8_t MAX_READ_ATTEMPTS = 8; ///< How many times a reader tries again if the value changed while reading
+
+		/// @brief The latest value of a PGN from one source
+		struct Slot
+		{
+			/// @brief Constructor for an empty slot
+			Slot();
+
+			std::atomic<std::uint32_t> sequence; ///< Odd while the slot is being written, otherwise even
+			std::atomic<std::uint32_t> timestamp_ms; ///< When the value was received
+			std::atomic<std::uint16_t> dataLength; ///< The length of the payload
+			std::array<std::atomic<std::uint64_t>, MAX_DATA_LENGTH / 8> data; ///< The payload, packed little endian into words
+		};
+
+		/// @brief The slots of one cached PGN
+		struct Entry
+		{
+			/// @brief Constructor for an entry with no slots
+			/// @param[in] pgn The PGN of the entry
+			explicit Entry(std::uint32_t pgn);
+
+			const std::uint32_t parameterGroupNumber; ///< The cached PGN
+			std::array<std::array<std::atomic<Slot *>, 256>, CAN_PORT_MAXIMUM> slots; ///< One slot per channel and source address, allocated when first needed
+			std::array<std::atomic<std::uint8_t>, CAN_PORT_MAXIMUM> latestSourceAddress; ///< The source of the most recent value on each channel, 0xFF if none yet
+		};
+
+		/// @brief Finds the entry of a cached PGN
+		/// @param[in] parameterGroupNumber The PGN to find
+		/// @returns The entry, or nullptr if the PGN is not cached
+		Entry *find_entry(std::uint32_t parameterGroupNumber) const;
+
+		/// @brief Finds the slot of a PGN from a source
+		/// @param[in] canPort The CAN channel index
+		/// @param[in] parameterGroupNumber The PGN to find
+		/// @param[in,out] sourceAddress The source address, or 0xFF for the latest source, in which case it is replaced by that source's address
+		/// @returns The slot, or nullptr if there is no value
+		const Slot *find_slot(std::uint8_t canPort, std::uint32_t parameterGroupNumber, std::uint8_t &sourceAddress) const;
+
+		std::array<std::atomic<Entry *>, MAX_PARAMETER_GROUP_NUMBERS> entries; ///< The cached PGNs. Entries are published through numberOfEntries.
+		std::atomic<std::size_t> numberOfEntries; ///< The number of entries that are ready to use
+		std::mutex addMutex; ///< Serialises adding PGNs, which may happen on any thread
+	};
+} // namespace isobus
+
+#endif // CAN_LATEST_VALUE_CACHE_HPP
@@ -0,0 +1,294 @@
+//================================================================================================
+/// @file can_message_schema.hpp
+///
+/// @brief Compile time descriptions of where each parameter (SPN) sits in a PGN's payload,
+/// which generate inlined encoders and decoders for them.
+/// @details A PGN's layout is declared once as a set of fields, and the compiler checks that
+/// the fields fit in the message and don't overlap. Because every position, length, and scale
+/// is a template parameter, encoding or decoding a field compiles down to a few shifts and masks,
+/// the same code you would write by hand, without the chance of getting a shift or mask wrong.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#ifndef CAN_MESSAGE_SCHEMA_HPP
+#define CAN_MESSAGE_SCHEMA_HPP
+
+#include "isobus/isobus/can_message.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace isobus
+{
+	//================================================================================================
+	/// @class MessageField
+	///
+	/// @brief Describes one parameter of a PGN by its bit position and length, and encodes or decodes its raw value.
+	/// @details Bits are numbered from the least significant bit of the first byte of the payload, so bit 0 is
+	/// byte 0 bit 0, and bit 21 is byte 2 bit 5. Little endian fields (the J1939 and ISO 11783 default) may start and
+	/// end anywhere, big endian fields must be whole bytes. A field may span at most 8 bytes.
+	/// @tparam StartBit The position of the least significant bit of the field
+	/// @tparam BitLength The number of bits in the field, from 1 to 64
+	/// @tparam Format The byte order of the field
+	//================================================================================================
+	template<std::uint16_t StartBit, std::uint8_t BitLength, CANMessage::ByteFormat Format = CANMessage::ByteFormat::LittleEndian>
+	class MessageField
+	{
+	public:
+		static_assert((BitLength > 0) && (BitLength <= 64), "A field must be between 1 and 64 bits long");
+		static_assert((CANMessage::ByteFormat::LittleEndian == Format) || ((0 == (StartBit % 8)) && (0 == (BitLength % 8))),
+		              "Big endian fields must start on a byte boundary and be a whole number of bytes long");
+		static_assert((((StartBit % 8) + BitLength + 7) / 8) <= 8, "A field can span at most 8 bytes");
+
+		static constexpr std::uint16_t START_BIT = StartBit; ///< The position of the least significant bit of the field
+		static constexpr std::uint8_t BIT_LENGTH = BitLength; ///< The number of bits in the field
+		static constexpr std::uint16_t FIRST_BYTE = StartBit / 8; ///< The first byte of the payload the field uses
+		static constexpr std::uint16_t BYTE_SPAN = ((StartBit % 8) + BitLength + 7) / 8; ///< The number of bytes the field touches
+		static constexpr std::uint64_t MAX_RAW_VALUE = (~static_cast<std::uint64_t>(0)) >> (64 - BitLength); ///< The largest raw value, all bits set, which J1939 uses for "not available"
+
+		/// @brief Reads the raw value of the field
+		/// @param[in] data The payload of the message, which must be at least FIRST_BYTE + BYTE_SPAN bytes long
+		/// @returns The raw value of the field
+		static inline std::uint64_t decode(const std::uint8_t *data)
+		{
+			std::uint64_t retVal = 0;
+
+			// BYTE_SPAN is a constant, so the compiler unrolls this completely
+			for (std::uint16_t i = 0; i < BYTE_SPAN; i++)
+			{
+				retVal |= (static_cast<std::uint64_t>(data[FIRST_BYTE + i]) << (8 * get_byte_position(i)));
+			}
+			return ((retVal >> (StartBit % 8)) & MAX_RAW_VALUE);
+		}
+
+		/// @brief Writes the raw value of the field, leaving the other bits of the payload alone
+		/// @param[in,out] data The payload of the message, which must be at least FIRST_BYTE + BYTE_SPAN bytes long
+		/// @param[in] value The raw value to write. Bits above BIT_LENGTH are discarded.
+		static inline void encode(std::uint8_t *data, std::uint64_t value)
+		{
+			const std::uint64_t fieldMask = (MAX_RAW_VALUE << (StartBit % 8));
+			const std::uint64_t fieldValue = ((value & MAX_RAW_VALUE) << (StartBit % 8));
+
+			for (std::uint16_t i = 0; i < BYTE_SPAN; i++)
+			{
+				const std::uint8_t byteShift = static_cast<std::uint8_t>(8 * get_byte_position(i));
+				const std::uint8_t byteMask = static_cast<std::uint8_t>((fieldMask >> byteShift) & 0xFF);
+
+				data[FIRST_BYTE + i] = static_cast<std::uint8_t>((data[FIRST_BYTE + i] & ~byteMask) | ((fieldValue >> byteShift) & byteMask));
+			}
+		}
+
+		/// @brief Sets every bit of the field, which J1939 uses to mean "not available"
+		/// @param[in,out] data The payload of the message
+		static inline void encode_not_available(std::uint8_t *data)
+		{
+			encode(data, MAX_RAW_VALUE);
+		}
+
+	private:
+		/// @brief Returns the significance of a byte of the field, 0 being the least significant
+		/// @param[in] index The index of the byte, counting from FIRST_BYTE
+		/// @returns The significance of the byte
+		static constexpr std::uint16_t get_byte_position(std::uint16_t index)
+		{
+			return (CANMessage::ByteFormat::LittleEndian == Format) ? index : static_cast<std::uint16_t>(BYTE_SPAN - 1 - index);
+		}
+	};
+
+	template<std::uint16_t StartBit, std::uint8_t BitLength, CANMessage::ByteFormat Format>
+	constexpr std::uint16_t MessageField<StartBit, BitLength, Format>::START_BIT;
+	template<std::uint16_t StartBit, std::uint8_t BitLength, CANMessage::ByteFormat Format>
+	constexpr std::uint8_t MessageField<StartBit, BitLength, Format>::BIT_LENGTH;
+	template<std::uint16_t StartBit, std::uint8_t BitLength, CANMessage::ByteFormat Format>
+	constexpr std::uint16_t MessageField<StartBit, BitLength, Format>::FIRST_BYTE;
+	template<std::uint16_t StartBit, std::uint8_t BitLength, CANMessage::ByteFormat Format>
+	constexpr std::uint16_t MessageField<StartBit, BitLength, Format>::BYTE_SPAN;
+	template<std::uint16_t StartBit, std::uint8_t BitLength, CANMessage::ByteFormat Format>
+	constexpr std::uint64_t MessageField<StartBit, BitLength, Format>::MAX_RAW_VALUE;
+
+	/// @brief Returns the largest raw value J1939 treats as valid data for a parameter of a given length
+	/// @details The values above this are reserved for error and "not available" indicators (J1939-71).
+	/// @param[in] bitLength The length of the parameter in bits
+	/// @returns The largest valid raw value
+	constexpr std::uint64_t get_j1939_maximum_valid_value(std::uint8_t bitLength)
+	{
+		return (8 == bitLength) ? 0xFA : (16 == bitLength) ? 0xFAFF : (32 == bitLength) ? 0xFAFFFFFF : (bitLength >= 64) ? 0xFAFFFFFFFFFFFFFF : (((static_cast<std::uint64_t>(1) << bitLength) - 1) - ((bitLength > 1) ? 2 : 0));
+	}
+
+	//================================================================================================
+	/// @class ScaledMessageField
+	///
+	/// @brief A field whose raw value is converted to a physical value by a resolution and an offset
+	/// @details physical = (raw * ResolutionNumerator / ResolutionDenominator) + Offset. The resolution is given as
+	/// a fraction so that it can be a template parameter, for example 0.125 rpm/bit is 1 / 8.
+	/// Raw values above MaxValidRawValue are the J1939 error and "not available" indicators, and don't decode.
+	/// The raw field's decode and encode are still available through the base class.
+	/// @tparam Field The MessageField that holds the raw value
+	/// @tparam ResolutionNumerator The numerator of the resolution per bit
+	/// @tparam ResolutionDenominator The denominator of the resolution per bit
+	/// @tparam Offset The physical value of a raw value of 0
+	/// @tparam MaxValidRawValue The largest raw value that is valid data
+	//================================================================================================
+	template<typename Field,
+	         std::int64_t ResolutionNumerator,
+	         std::int64_t ResolutionDenominator,
+	         std::int64_t Offset,
+	         std::uint64_t MaxValidRawValue = get_j1939_maximum_valid_value(Field::BIT_LENGTH)>
+	class ScaledMessageField : public Field
+	{
+	public:
+		static_assert(ResolutionNumerator > 0, "The resolution must be positive");
+		static_assert(ResolutionDenominator > 0, "The resolution must be positive");
+		static_assert(MaxValidRawValue <= Field::MAX_RAW_VALUE, "The maximum valid raw value does not fit in the field");
+
+		static constexpr std::uint64_t MAX_VALID_RAW_VALUE = MaxValidRawValue; ///< The largest raw value that is valid data
+
+		/// @brief Returns the smallest physical value the field can hold
+		/// @returns The physical value of a raw value of 0
+		static constexpr double get_minimum_value()
+		{
+			return static_cast<double>(Offset);
+		}
+
+		/// @brief Returns the largest physical value the field can hold
+		/// @returns The physical value of MAX_VALID_RAW_VALUE
+		static constexpr double get_maximum_value()
+		{
+			return ((static_cast<double>(MaxValidRawValue) * ResolutionNumerator) / ResolutionDenominator) + Offset;
+		}
+
+		/// @brief Reads the physical value of the field
+		/// @param[in] data The payload of the message
+		/// @param[out] value The physical value, which is left alone if the field doesn't hold valid data
+		/// @returns `true` if the field held valid data, `false` if it held an error or "not available" indicator
+		static inline bool decode_value(const std::uint8_t *data, double &value)
+		{
+			const std::uint64_t rawValue = Field::decode(data);
+			bool retVal = false;
+
+			if (rawValue <= MaxValidRawValue)
+			{
+				value = ((static_cast<double>(rawValue) * ResolutionNumerator) / ResolutionDenominator) + Offset;
+				retVal = true;
+			}
+			return retVal;
+		}
+
+		/// @brief Writes a physical value to the field, rounding to the nearest step and clamping to the valid range
+		/// @param[in,out] data The payload of the message
+		/// @param[in] value The physical value to write
+		static inline void encode_value(std::uint8_t *data, double value)
+		{
+			const double rawValue = std::round(((value - Offset) * ResolutionDenominator) / ResolutionNumerator);
+			std::uint64_t clampedValue = MaxValidRawValue;
+
+			if (rawValue <= 0.0)
+			{
+				clampedValue = 0;
+			}
+			else if (rawValue < static_cast<double>(MaxValidRawValue))
+			{
+				clampedValue = static_cast<std::uint64_t>(rawValue);
+			}
+			Field::encode(data, clampedValue);
+		}
+	};
+
+	template<typename Field, std::int64_t ResolutionNumerator, std::int64_t ResolutionDenominator, std::int64_t Offset, std::uint64_t MaxValidRawValue>
+	constexpr std::uint64_t ScaledMessageField<Field, ResolutionNumerator, ResolutionDenominator, Offset, MaxValidRawValue>::MAX_VALID_RAW_VALUE;
+
+	//================================================================================================
+	/// @class MessageLayoutChecks
+	///
+	/// @brief The compile time checks of a MessageLayout, kept separate since a class can't call its own
+	/// constexpr functions in a static_assert before the class is complete
+	/// @tparam DataLength The length of the payload in bytes
+	/// @tparam Fields The fields of the layout
+	//================================================================================================
+	template<std::uint16_t DataLength, typename... Fields>
+	class MessageLayoutChecks
+	{
+	public:
+		/// @brief Checks that every field ends inside the payload
+		/// @returns `true` if all fields fit in DataLength bytes
+		static constexpr bool get_fields_fit()
+		{
+			// The extra element keeps the array valid for a layout with no fields
+			const std::uint32_t endBits[] = { (static_cast<std::uint32_t>(Fields::START_BIT) + Fields::BIT_LENGTH)..., 0 };
+			bool retVal = true;
+
+			for (std::size_t i = 0; i < sizeof...(Fields); i++)
+			{
+				if (endBits[i] > (static_cast<std::uint32_t>(DataLength) * 8))
+				{
+					retVal = false;
+				}
+			}
+			return retVal;
+		}
+
+		/// @brief Checks that no two fields share a bit
+		/// @returns `true` if the fields are all disjoint
+		static constexpr bool get_fields_disjoint()
+		{
+			const std::uint32_t startBits[] = { static_cast<std::uint32_t>(Fields::START_BIT)..., 0 };
+			const std::uint32_t endBits[] = { (static_cast<std::uint32_t>(Fields::START_BIT) + Fields::BIT_LENGTH)..., 0 };
+			bool retVal = true;
+
+			for (std::size_t i = 0; i < sizeof...(Fields); i++)
+			{
+				for (std::size_t j = i + 1; j < sizeof...(Fields); j++)
+				{
+					if ((startBits[i] < endBits[j]) && (startBits[j] < endBits[i]))
+					{
+						retVal = false;
+					}
+				}
+			}
+			return retVal;
+		}
+	};
+
+	//================================================================================================
+	/// @class MessageLayout
+	///
+	/// @brief Declares the fields of a PGN, and checks at compile time that they fit in the payload and don't overlap
+	/// @details Declaring a layout costs nothing at runtime, it exists so that a mistake in the positions of the fields
+	/// is a compile error instead of a corrupted message. Fields that are deliberately shared between two
+	/// interpretations of a message belong in separate layouts. The checks run when the layout is first used,
+	/// for example by a static_assert on DATA_LENGTH.
+	/// @tparam DataLength The length of the payload in bytes
+	/// @tparam Fields The MessageField or ScaledMessageField types of the parameters in the payload
+	//================================================================================================
+	template<std::uint16_t DataLength, typename... Fields>
+	class MessageLayout
+	{
+	public:
+		static_assert(DataLength > 0, "A message must have a payload");
+		static_assert(MessageLayoutChecks<DataLength, Fields...>::get_fields_fit(), "A field extends past the end of the message");
+		static_assert(MessageLayoutChecks<DataLength, Fields...>::get_fields_disjoint(), "Two fields of the message overlap");
+
+		static constexpr std::uint16_t DATA_LENGTH = DataLength; ///< The length of the payload in bytes
+		static constexpr std::size_t NUMBER_OF_FIELDS = sizeof...(Fields); ///< The number of fields in the layout
+
+		/// @brief Sets every byte of a payload to 0xFF, so that reserved bits and unset parameters read as "not available"
+		/// @param[out] data The payload to initialize, which must be at least DATA_LENGTH bytes long
+		static inline void initialize(std::uint8_t *data)
+		{
+			for (std::uint16_t i = 0; i < DataLength; i++)
+			{
+				data[i] = 0xFF;
+			}
+		}
+	};
+
+	template<std::uint16_t DataLength, typename... Fields>
+	constexpr std::uint16_t MessageLayout<DataLength, Fields...>::DATA_LENGTH;
+	template<std::uint16_t DataLength, typename... Fields>
+	constexpr std::size_t MessageLayout<DataLength, Fields...>::NUMBER_OF_FIELDS;
+} // namespace isobus
+
+#endif // CAN_MESSAGE_SCHEMA_HPP
@@ -49,11 +49,82 @@ namespace isobus
 		/// @returns The minimum time to wait between sending BAM frames
 		static std::uint32_t get_minimum_time_between_transport_protocol_bam_frames();
 
+		/// @brief Sets if the transport protocols should request a whole CTS window from a DataChunkCallback at once
+		/// @details By default a DataChunkCallback is called once for every 7 byte packet. When this is enabled,
+		/// TP and ETP instead call it once per CTS window (or once for the whole message for BAM) with
+		/// `numberOfBytesNeeded` set to the size of the window, which greatly reduces the number of callbacks
+		/// needed to send a large message. Your callback must be able to fill buffers larger than 7 bytes to use this.
+		/// @param[in] value `true` to request whole windows, `false` to request one packet at a time
+		static void set_transport_protocol_window_data_chunk_callbacks(bool value);
+
+		/// @brief Returns if the transport protocols request a whole CTS window from a DataChunkCallback at once
+		/// @returns `true` if whole windows are requested, `false` if data is requested one packet at a time
+		static bool get_transport_protocol_window_data_chunk_callbacks();
+
+		/// @brief Sets how many times a connection mode TP or ETP session may retransmit part of a message
+		/// @details When a receiver sees a missing packet it sends a CTS that re-requests the message starting
+		/// at the missing packet, instead of aborting the whole session. This value limits how many of
+		/// those requests a session will make as a receiver, and how many it will honour as a sender,
+		/// before aborting with "maximum retransmit request limit reached". An ETP receiver that has used up
+		/// its budget aborts with "bad sequence number".
+		///
+		/// Set to 0 to turn retransmits off, which handles lost packets the way the stack did before they existed:
+		/// a TP receiver aborts the session, an ETP receiver logs and drops out of order packets, and a sender treats
+		/// a CTS that points back into sent data like any other CTS.
+		/// @param[in] value The max number of retransmit requests per session
+		static void set_max_number_transport_protocol_retransmit_requests(std::uint8_t value);
+
+		/// @brief Returns how many times a connection mode TP or ETP session may retransmit part of a message
+		/// @returns The max number of retransmit requests per session
+		static std::uint8_t get_max_number_transport_protocol_retransmit_requests();
+
+		/// @brief Sets the minimum time between frames of the same NMEA 2000 fast packet message
+		/// @details By default fast packet messages are sent back to back, as fast as the stack can
+		/// queue them. Set this to pace each message to protect slow receivers. Frames from other
+		/// fast packet messages may still be sent during the gap. Because frames are only sent when the
+		/// stack updates, the real gap is rounded up to a multiple of the update period.
+		/// @param[in] value The minimum time between frames of a fast packet message in microseconds, or 0 for no gap
+		static void set_minimum_time_between_fast_packet_frames_us(std::uint32_t value);
+
+		/// @brief Returns the minimum time between frames of the same NMEA 2000 fast packet message
+		/// @returns The minimum time between frames of a fast packet message in microseconds
+		static std::uint32_t get_minimum_time_between_fast_packet_frames_us();
+
+		/// @brief Sets if broadcasts sent while a DM13 has suspended broadcasts are held back instead of dropped
+		/// @details By default these broadcasts are dropped, which suits periodic messages that will be sent again anyway.
+		/// When this is enabled, the latest broadcast of each PGN from each internal control function is kept instead,
+		/// and sent as soon as broadcasts resume. Fast packet messages and broadcasts from a data source are always dropped.
+		/// @param[in] value `true` to hold back suspended broadcasts, `false` to drop them
+		static void set_defer_suspended_broadcasts(bool value);
+
+		/// @brief Returns if broadcasts sent while a DM13 has suspended broadcasts are held back instead of dropped
+		/// @returns `true` if suspended broadcasts are held back, `false` if they are dropped
+		static bool get_defer_suspended_broadcasts();
+
+		/// @brief Sets if internal control functions on the same CAN channel claim their addresses together
+		/// @details By default each internal control function sends its own request for address claim and
+		/// claims on its own schedule. When this is enabled, one request for address claim is sent per CAN channel,
+		/// and after the contention period every internal control function on that channel claims in the same update,
+		/// in order of their NAMEs, so they never claim the same address at the same time.
+		/// This greatly reduces start up time and bus load when you have many internal control functions, like a gateway.
+		/// @param[in] value `true` to claim addresses together, `false` to claim them separately
+		static void set_coordinated_address_claiming(bool value);
+
+		/// @brief Returns if internal control functions on the same CAN channel claim their addresses together
+		/// @returns `true` if addresses are claimed together, `false` if they are claimed separately
+		static bool get_coordinated_address_claiming();
+
 	private:
 		static constexpr std::uint8_t DEFAULT_BAM_PACKET_DELAY_TIME_MS = 50; ///< The default time between BAM frames, as defined by J1939
+		static constexpr std::uint8_t DEFAULT_MAX_RETRANSMIT_REQUESTS = 2; ///< The default number of retransmit requests per session, as suggested by J1939-21
 
 		static std::uint32_t maxNumberTransportProtocolSessions; ///< The max number of TP sessions allowed
 		static std::uint32_t minimumTimeBetweenTransportProtocolBAMFrames; ///< The configurable time between BAM frames
+		static bool transportProtocolWindowDataChunkCallbacks; ///< Denotes if data chunk callbacks are asked for a whole CTS window at once
+		static std::uint8_t maxNumberTransportProtocolRetransmitRequests; ///< The max number of retransmit requests per TP/ETP session
+		static std::uint32_t minimumTimeBetweenFastPacketFrames_us; ///< The configurable time between frames of one fast packet message
+		static bool deferSuspendedBroadcasts; ///< Denotes if broadcasts are held back instead of dropped while suspended by a DM13
+		static bool coordinatedAddressClaiming; ///< Denotes if internal control functions on the same channel claim addresses together
 	};
 } // namespace isobus
 
@@ -19,12 +19,17 @@
 #include "isobus/isobus/can_frame.hpp"
 #include "isobus/isobus/can_identifier.hpp"
 #include "isobus/isobus/can_internal_control_function.hpp"
+#include "isobus/isobus/can_latest_value_cache.hpp"
 #include "isobus/isobus/can_message.hpp"
+#include "isobus/isobus/can_network_snapshot.hpp"
+#include "isobus/isobus/can_signal_database.hpp"
 #include "isobus/isobus/can_transport_protocol.hpp"
 
 #include <array>
 #include <list>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 /// @brief This namespace encompases all of the ISO11783 stack's functionality to reduce global namespace pollution
 namespace isobus
@@ -40,6 +45,16 @@ namespace isobus
 	class CANNetworkManager
 	{
 	public:
+		/// @brief Counters for the broadcast suspension gate of one CAN channel
+		struct BroadcastSuspensionStatistics
+		{
+			std::uint32_t suspensionCount; ///< The number of times broadcasts have been suspended by a DM13
+			std::uint32_t suppressedMessages; ///< The number of broadcasts that were dropped while suspended
+			std::uint32_t deferredMessages; ///< The number of broadcasts that were held back while suspended
+			std::uint32_t sentDeferredMessages; ///< The number of held back broadcasts that were sent once broadcasts resumed
+			std::uint32_t exceptedMessages; ///< The number of broadcasts sent while suspended because their PGN is an exception
+		};
+
 		static CANNetworkManager CANNetwork; ///< Static singleton of the one network manager. Use this to access stack functionality.
 
 		/// @brief Initializer function for the network manager
@@ -105,6 +120,26 @@ namespace isobus
 		                      void *parentPointer = nullptr,
 		                      DataChunkCallback frameChunkCallback = nullptr);
 
+		/// @brief Sends a CAN message whose payload is read in place from a data source.
+		/// @details Use this to send large payloads, like a memory mapped file, without copying them into the heap first.
+		/// The transport protocols keep a reference to the source until the session ends.
+		/// Payloads of 8 bytes or less are read up front and sent as a normal message.
+		/// @param[in] parameterGroupNumber The PGN of the message
+		/// @param[in] dataSource The source to read the payload from
+		/// @param[in] sourceControlFunction The internal control function to send from
+		/// @param[in] destinationControlFunction The destination, or nullptr to broadcast
+		/// @param[in] priority The priority of the message
+		/// @param[in] txCompleteCallback A callback for when the transmit completes or fails
+		/// @param[in] parentPointer A generic context object for the tx complete callback
+		/// @returns `true` if the message was sent or a session was started, otherwise `false`
+		bool send_can_message_from_data_source(std::uint32_t parameterGroupNumber,
+		                                       std::shared_ptr<TransmitDataSource> dataSource,
+		                                       InternalControlFunction *sourceControlFunction,
+		                                       ControlFunction *destinationControlFunction = nullptr,
+		                                       CANIdentifier::CANPriority priority = CANIdentifier::CANPriority::PriorityDefault6,
+		                                       TransmitCompleteCallback txCompleteCallback = nullptr,
+		                                       void *parentPointer = nullptr);
+
 		/// @brief This is the main function used by the stack to receive CAN messages and add them to a queue.
 		/// @details This function is called by the stack itself when you call can_lib_process_rx_message.
 		/// @param[in] message The message to be received
@@ -122,6 +157,73 @@ namespace isobus
 		/// @param[in] partner Pointer to the partner being deleted
 		void on_partner_deleted(PartneredControlFunction *partner, CANLibBadge<PartneredControlFunction>);
 
+		/// @brief Informs the network manager that an internal control function was deleted so that it can be purged from the address/cf tables
+		/// @param[in] internalControlFunction Pointer to the internal control function being deleted
+		void on_internal_control_function_deleted(InternalControlFunction *internalControlFunction, CANLibBadge<InternalControlFunction>);
+
+		/// @brief Returns if broadcasts from internal control functions are suspended on a CAN channel by a DM13
+		/// @details The network manager listens for DM13 commands sent globally or to any of our internal
+		/// control functions. J1939 network N is treated as CAN channel N - 1, and the current data link as the channel
+		/// the DM13 was received on. Suspension ends when a DM13 starts broadcasts again, or 6 seconds after the last DM13.
+		/// While suspended, broadcasts sent with send_can_message or as fast packet messages are dropped, or held back
+		/// if CANNetworkConfiguration::set_defer_suspended_broadcasts is enabled, unless their PGN is an exception.
+		/// Destination specific messages are never affected.
+		/// @param[in] canPort The CAN channel index to check
+		/// @returns `true` if broadcasts are suspended on the channel, otherwise `false`
+		bool get_broadcasts_suspended(std::uint8_t canPort) const;
+
+		/// @brief Adds a PGN that may still be broadcast while broadcasts are suspended by a DM13
+		/// @details Address claims, requests, acknowledgements, DM13 and the transport protocols are always allowed.
+		/// @param[in] parameterGroupNumber The PGN to allow
+		void add_broadcast_suspension_exception(std::uint32_t parameterGroupNumber);
+
+		/// @brief Removes a PGN added with add_broadcast_suspension_exception
+		/// @param[in] parameterGroupNumber The PGN to remove
+		void remove_broadcast_suspension_exception(std::uint32_t parameterGroupNumber);
+
+		/// @brief Returns the broadcast suspension counters of a CAN channel
+		/// @param[in] canPort The CAN channel index to get the counters of
+		/// @returns The counters of the channel, all zero if the channel index is invalid
+		BroadcastSuspensionStatistics get_broadcast_suspension_statistics(std::uint8_t canPort) const;
+
+		/// @brief Sets the network snapshot used to warm-start address claiming and partner binding
+		/// @details Set this before creating your control functions, usually right after loading the snapshot from a file.
+		/// Arbitrary address capable internal control functions that are in the snapshot will prefer the address they had last time,
+		/// and new partners that match a device in the snapshot are provisionally bound to that device's address until
+		/// its address claim confirms the binding. See NetworkSnapshot for details.
+		/// @param[in] snapshot The snapshot to use, or nullptr to stop using one
+		void set_network_snapshot(std::shared_ptr<NetworkSnapshot> snapshot);
+
+		/// @brief Returns the network snapshot set with set_network_snapshot
+		/// @returns The network snapshot in use, or nullptr if there isn't one
+		std::shared_ptr<NetworkSnapshot> get_network_snapshot() const;
+
+		/// @brief Returns if a partner is provisionally bound to an address from the network snapshot, and hasn't claimed it yet
+		/// @param[in] partner The partner to check
+		/// @returns `true` if the partner's address came from the snapshot and is not yet confirmed, otherwise `false`
+		bool get_is_partner_binding_provisional(const PartneredControlFunction *partner) const;
+
+		/// @brief Returns the cache of the latest value of selected PGNs from each source
+		/// @details Add the PGNs you want to the cache, and the network manager will keep the most recent payload of each one
+		/// from each source, including messages received with the transport protocols. Any thread can read them without callbacks or locks.
+		/// @returns The latest value cache
+		LatestValueCache &get_latest_value_cache();
+
+		/// @brief Decodes every received message whose PGN is in a signal database, and passes the decoded signals to a callback
+		/// @details Matching messages, including ones received with the transport protocols, are staged as they are processed,
+		/// then decoded together at the end of each update. The callback is called from the thread that calls update(),
+		/// and the batch it gets is cleared once it returns, so copy out anything you want to keep.
+		/// @param[in] database The signal database to decode with, or nullptr to stop decoding
+		/// @param[in] callback The function to call with each decoded batch
+		/// @param[in] parentPointer A generic context variable that is passed to the callback
+		void set_signal_database(std::shared_ptr<SignalDatabase> database, SignalBatchCallback callback, void *parentPointer);
+
+		/// @brief Returns the signal database set with set_signal_database
+		/// @returns The signal database in use, or nullptr if there isn't one
+		std::shared_ptr<SignalDatabase> get_signal_database() const;
+
+		static constexpr std::uint32_t PROVISIONAL_PARTNER_TIMEOUT_MS = 3000; ///< How long a partner's address from the network snapshot is trusted without an address claim
+
 	protected:
 		// Using protected region to allow protocols use of special functions from the network manager
 		friend class AddressClaimStateMachine; ///< Allows the network manager to work closely with the address claiming process
@@ -164,6 +266,21 @@ namespace isobus
 		                          std::uint32_t size,
 		                          CANLibBadge<AddressClaimStateMachine>);
 
+		/// @brief The ways a broadcast can pass through the broadcast suspension gate
+		enum class BroadcastGateResult
+		{
+			Send, ///< The broadcast may be sent now
+			Suppress, ///< The broadcast must be dropped
+			Defer ///< The broadcast should be held back until broadcasts resume
+		};
+
+		/// @brief Checks if a broadcast may be sent, and updates the broadcast suspension counters
+		/// @param[in] canPort The CAN channel index the broadcast would be sent on
+		/// @param[in] parameterGroupNumber The PGN of the broadcast
+		/// @param[in] canDefer `true` if the caller is able to defer the broadcast, otherwise it is suppressed instead
+		/// @returns What the caller should do with the broadcast
+		BroadcastGateResult check_broadcast_gate(std::uint8_t canPort, std::uint32_t parameterGroupNumber, bool canDefer);
+
 		/// @brief Processes completed protocol messages. Causes PGN callbacks to trigger.
 		/// @param[in] protocolMessage The completed protocol message
 		void protocol_message_callback(CANMessage *protocolMessage);
@@ -171,6 +288,28 @@ namespace isobus
 		std::vector<CANLibProtocol *> protocolList; ///< A list of all created protocol classes
 
 	private:
+		/// @brief A broadcast held back while broadcasts were suspended
+		struct DeferredBroadcast
+		{
+			std::vector<std::uint8_t> data; ///< The payload of the broadcast
+			InternalControlFunction *source; ///< The internal control function sending the broadcast
+			TransmitCompleteCallback txCompleteCallback; ///< The transmit complete callback to pass along when the broadcast is sent
+			void *parentPointer; ///< The context of the transmit complete callback
+			std::uint32_t parameterGroupNumber; ///< The PGN of the broadcast
+			CANIdentifier::CANPriority priority; ///< The priority of the broadcast
+			std::uint8_t canPort; ///< The CAN channel the broadcast is for
+		};
+
+		/// @brief A partner bound to the address it had in the network snapshot, waiting for its address claim
+		struct ProvisionalPartner
+		{
+			PartneredControlFunction *partner; ///< The provisionally bound partner
+			std::uint32_t timestamp_ms; ///< When the partner was bound
+			std::uint8_t address; ///< The address the partner was bound to
+		};
+
+		static constexpr std::uint32_t DM13_TIMEOUT_MS = 6000; ///< The time after the last DM13 when broadcasts resume, from J1939-73 5.7.13
+
 		/// @brief Constructor for the network manager. Sets default values for members
 		CANNetworkManager();
 
@@ -190,6 +329,25 @@ namespace isobus
 		/// @brief Checks if new partners have been created and matches them to existing control functions
 		void update_new_partners();
 
+		/// @brief Binds a partner to the address of a matching device in the network snapshot, if there is one
+		/// @param[in] partner The partner to bind
+		void bind_partner_from_snapshot(PartneredControlFunction *partner);
+
+		/// @brief Returns if the network snapshot was set since this was last called, and clears that flag
+		/// @returns `true` if set_network_snapshot was called since the last check, otherwise `false`
+		bool get_network_snapshot_changed();
+
+		/// @brief Applies the network snapshot's addresses to internal control functions that have not started claiming yet
+		/// @details Only called when a snapshot is set or an internal control function is created, since the others are already claiming
+		void apply_snapshot_preferred_addresses();
+
+		/// @brief Confirms provisional partner bindings when their device claims, and drops bindings that timed out
+		/// @param[in] message A message being received by the stack, or nullptr to only check for timeouts
+		void update_provisional_partners(CANMessage *message);
+
+		/// @brief Decodes the messages staged for the signal database this update, and passes them to the signal batch callback
+		void update_signal_batch();
+
 		/// @brief Builds a CAN frame from a frame's discrete components
 		/// @param[in] portIndex The CAN channel index of the CAN message being processed
 		/// @param[in] sourceAddress The source address to send the CAN message from
@@ -237,6 +395,30 @@ namespace isobus
 		/// @brief Processes the internal receive message queue
 		void process_rx_messages();
 
+		/// @brief Updates the broadcast suspension state from a DM13 we received
+		/// @param[in] message The DM13 message
+		void process_dm13_message(CANMessage &message);
+
+		/// @brief Holds back a broadcast until broadcasts resume, replacing any broadcast of the same PGN from the same source
+		/// @details The transmit complete callback of a replaced broadcast is called with a failure, since it will never be sent
+		/// @param[in] parameterGroupNumber The PGN of the broadcast
+		/// @param[in] dataBuffer The payload of the broadcast
+		/// @param[in] dataLength The length of the payload
+		/// @param[in] sourceControlFunction The internal control function sending the broadcast
+		/// @param[in] priority The priority of the broadcast
+		/// @param[in] transmitCompleteCallback The transmit complete callback to call when the broadcast is sent
+		/// @param[in] parentPointer The context of the transmit complete callback
+		void defer_broadcast(std::uint32_t parameterGroupNumber,
+		                     const std::uint8_t *dataBuffer,
+		                     std::uint32_t dataLength,
+		                     InternalControlFunction *sourceControlFunction,
+		                     CANIdentifier::CANPriority priority,
+		                     TransmitCompleteCallback transmitCompleteCallback,
+		                     void *parentPointer);
+
+		/// @brief Ends timed out broadcast suspensions, and sends deferred broadcasts of channels that have resumed
+		void update_broadcast_suspension();
+
 		/// @brief Sends a CAN message using raw addresses. Used only by the stack.
 		/// @param[in] portIndex The CAN channel index to send the message from
 		/// @param[in] sourceAddress The source address to send the CAN message from
@@ -272,7 +454,23 @@ namespace isobus
 		std::mutex receiveMessageMutex; ///< A mutex for receive messages thread safety
 		std::mutex protocolPGNCallbacksMutex; ///< A mutex for PGN callback thread safety
 		std::mutex anyControlFunctionCallbacksMutex; ///< Mutex to protect the "any CF" callbacks
+		std::array<BroadcastSuspensionStatistics, CAN_PORT_MAXIMUM> broadcastSuspensionStatistics; ///< The broadcast suspension counters of each channel
+		std::vector<std::uint32_t> broadcastSuspensionExceptions; ///< Application PGNs which may be broadcast while suspended
+		std::list<DeferredBroadcast> deferredBroadcasts; ///< Broadcasts held back until broadcasts resume, one per source and PGN
+		mutable std::mutex broadcastSuspensionMutex; ///< Protects the broadcast suspension state
+		std::uint32_t broadcastSuspensionBitfield; ///< One bit per CAN channel, set while broadcasts are suspended on that channel
+		LatestValueCache latestValueCache; ///< The latest value of selected PGNs from each source
+		std::shared_ptr<SignalDatabase> signalDatabase; ///< Decodes received messages for the signal batch callback, if set
+		SignalDatabase::DecodedBatch signalBatch; ///< The messages staged for the signal database this update, only used by the update thread
+		SignalBatchCallback signalBatchCallback; ///< Called with each decoded signal batch
+		void *signalBatchParent; ///< The context passed to the signal batch callback
+		mutable std::mutex signalDatabaseMutex; ///< Protects the signal database and its callback, which the application may change from another thread
+		std::shared_ptr<NetworkSnapshot> networkSnapshot; ///< The snapshot used to warm-start address claiming and partner binding
+		std::vector<ProvisionalPartner> provisionalPartners; ///< Partners bound from the network snapshot that have not claimed yet
+		mutable std::mutex networkSnapshotMutex; ///< Protects the network snapshot pointer, which the application may change from another thread
+		std::array<std::uint32_t, CAN_PORT_MAXIMUM> lastDM13ReceivedTimestamp_ms; ///< When we last received a DM13 addressed to us that suspended each channel, in milliseconds
 		std::uint32_t updateTimestamp_ms; ///< Keeps track of the last time the CAN stack was update in milliseconds
+		bool networkSnapshotChanged; ///< Set when the network snapshot is set, so its addresses are applied on the next update
 		bool initialized; ///< True if the network manager has been initialized by the update function
 	};
 
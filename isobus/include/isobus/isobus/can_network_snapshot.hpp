@@ -0,0 +1,139 @@
+//================================================================================================
+/// @file can_network_snapshot.hpp
+///
+/// @brief A small persisted record of the network as it was last seen, which lets the stack
+/// warm-start by reusing claimed addresses, partner addresses, and VT version labels.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#ifndef CAN_NETWORK_SNAPSHOT_HPP
+#define CAN_NETWORK_SNAPSHOT_HPP
+
+#include "isobus/isobus/can_NAME.hpp"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace isobus
+{
+	class PartneredControlFunction;
+
+	//================================================================================================
+	/// @class NetworkSnapshot
+	///
+	/// @brief Remembers which addresses our internal control functions and our partners had,
+	/// and which object pool version labels each VT had stored.
+	/// @details Give a snapshot to the network manager with CANNetworkManager::set_network_snapshot before
+	/// creating your control functions. Arbitrary address capable internal control functions will then prefer the address
+	/// they had last time, and partners are provisionally bound to the address their device had last time, so that
+	/// you can talk to them before the bus has finished address claiming. A provisional binding is confirmed when the device
+	/// claims with the NAME we remembered, and is dropped if no claim arrives within
+	/// CANNetworkManager::PROVISIONAL_PARTNER_TIMEOUT_MS, or if another device claims the address.
+	/// The VT client uses the stored version labels to load its object pool without asking the VT for its versions first.
+	/// Call capture() and then save() before shutting down to update the file.
+	/// A damaged or missing file is never fatal, the stack simply starts cold.
+	//================================================================================================
+	class NetworkSnapshot
+	{
+	public:
+		/// @brief Constructor for an empty snapshot
+		NetworkSnapshot();
+
+		/// @brief Replaces the contents of the snapshot with the contents of a file
+		/// @param[in] filename The path of the file to load
+		/// @returns `true` if the file was read, `false` if it was missing or damaged, in which case the snapshot is left empty
+		bool load(const std::string &filename);
+
+		/// @brief Writes the snapshot to a file
+		/// @details The snapshot is written to a temporary file which then replaces the old one,
+		/// so losing power part way through leaves the previous snapshot intact.
+		/// @param[in] filename The path of the file to write
+		/// @returns `true` if the file was written, otherwise `false`
+		bool save(const std::string &filename) const;
+
+		/// @brief Records the current address of every internal control function and partner that has one
+		void capture();
+
+		/// @brief Removes everything from the snapshot
+		void clear();
+
+		/// @brief Records the address an internal control function has claimed
+		/// @param[in] canPort The CAN channel of the control function
+		/// @param[in] controlFunctionNAME The NAME of the control function
+		/// @param[in] address The address it claimed
+		void set_internal_control_function_address(std::uint8_t canPort, NAME controlFunctionNAME, std::uint8_t address);
+
+		/// @brief Returns the address an internal control function had when the snapshot was taken
+		/// @param[in] canPort The CAN channel of the control function
+		/// @param[in] controlFunctionNAME The NAME of the control function
+		/// @returns The address the control function had, or 0xFE (null address) if it isn't in the snapshot
+		std::uint8_t get_internal_control_function_address(std::uint8_t canPort, NAME controlFunctionNAME) const;
+
+		/// @brief Records the NAME and address of a partner's device
+		/// @param[in] canPort The CAN channel of the device
+		/// @param[in] controlFunctionNAME The NAME of the device
+		/// @param[in] address The address of the device
+		void set_partner_address(std::uint8_t canPort, NAME controlFunctionNAME, std::uint8_t address);
+
+		/// @brief Finds a device in the snapshot that matches a partner's NAME filters
+		/// @param[in] partner The partner to find a device for
+		/// @param[out] controlFunctionNAME The NAME of the device that was found
+		/// @param[out] address The address the device had when the snapshot was taken
+		/// @returns `true` if a matching device was found, otherwise `false`
+		bool get_partner_address(const PartneredControlFunction &partner, NAME &controlFunctionNAME, std::uint8_t &address) const;
+
+		/// @brief Records the object pool version label that a VT has stored for us
+		/// @param[in] virtualTerminalNAME The NAME of the VT
+		/// @param[in] versionLabel The version label, or an empty string to forget the VT's label
+		void set_vt_version_label(NAME virtualTerminalNAME, const std::string &versionLabel);
+
+		/// @brief Returns the object pool version label that a VT had stored for us
+		/// @param[in] virtualTerminalNAME The NAME of the VT
+		/// @returns The version label, or an empty string if the VT isn't in the snapshot
+		std::string get_vt_version_label(NAME virtualTerminalNAME) const;
+
+		/// @brief Returns the number of internal control functions in the snapshot
+		/// @returns The number of internal control function addresses in the snapshot
+		std::size_t get_number_internal_control_functions() const;
+
+		/// @brief Returns the number of partner devices in the snapshot
+		/// @returns The number of partner addresses in the snapshot
+		std::size_t get_number_partners() const;
+
+	private:
+		/// @brief The address a control function had when the snapshot was taken
+		struct AddressEntry
+		{
+			std::uint64_t NAME; ///< The full NAME of the control function
+			std::uint8_t canPort; ///< The CAN channel of the control function
+			std::uint8_t address; ///< The address of the control function
+		};
+
+		/// @brief The version label a VT had stored for us when the snapshot was taken
+		struct VersionLabelEntry
+		{
+			std::uint64_t NAME; ///< The full NAME of the VT
+			std::string versionLabel; ///< The version label the VT has stored
+		};
+
+		static constexpr std::uint32_t FILE_FORMAT_VERSION = 1; ///< Written in the header of each file, and checked when loading
+
+		/// @brief Adds or replaces an address entry in a list
+		/// @param[in] entries The list to update
+		/// @param[in] canPort The CAN channel of the control function
+		/// @param[in] controlFunctionNAME The full NAME of the control function
+		/// @param[in] address The address of the control function
+		static void set_address_entry(std::vector<AddressEntry> &entries, std::uint8_t canPort, std::uint64_t controlFunctionNAME, std::uint8_t address);
+
+		std::vector<AddressEntry> internalControlFunctionEntries; ///< The addresses of our internal control functions
+		std::vector<AddressEntry> partnerEntries; ///< The addresses of our partners' devices
+		std::vector<VersionLabelEntry> versionLabelEntries; ///< The version labels each VT has stored for us
+		mutable std::mutex snapshotMutex; ///< Protects the snapshot, since the network manager, VT client, and application may use it from different threads
+	};
+} // namespace isobus
+
+#endif // CAN_NETWORK_SNAPSHOT_HPP
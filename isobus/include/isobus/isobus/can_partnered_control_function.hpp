@@ -15,8 +15,10 @@
 #include "isobus/isobus/can_address_claim_state_machine.hpp"
 #include "isobus/isobus/can_badge.hpp"
 #include "isobus/isobus/can_callbacks.hpp"
+#include "isobus/isobus/can_constants.hpp"
 #include "isobus/isobus/can_control_function.hpp"
 
+#include <array>
 #include <vector>
 
 namespace isobus
@@ -83,10 +85,21 @@ namespace isobus
 		bool get_name_filter_parameter(std::size_t index, NAME::NAMEParameters &parameter, std::uint32_t &filterValue) const;
 
 		/// @brief Checks to see if a NAME matches this CF's NAME filters
+		/// @details The filters are combined into a single mask and value when the partner is created,
+		/// so this takes the same time no matter how many filters the partner has.
 		/// @param[in] NAMEToCheck The NAME to check against this control function's filters
 		/// @returns true if this control function matches the NAME that was passed in, false otherwise
 		bool check_matches_name(NAME NAMEToCheck) const;
 
+		/// @brief Finds the first partner on a CAN channel whose NAME filters match a NAME
+		/// @details The compiled filters of all partners on a channel are kept side by side, and are compared
+		/// against the NAME a block at a time, so an address claim is checked against every partner in a few operations.
+		/// Partners are checked in the order they were created.
+		/// @param[in] CANPort The CAN channel index of the partners to check
+		/// @param[in] NAMEToCheck The NAME to check against the partners' filters
+		/// @returns The first partner that matches the NAME, or nullptr if none do
+		static PartneredControlFunction *find_partner_matching_name(std::uint8_t CANPort, NAME NAMEToCheck);
+
 		/// @brief Gets a PartneredControlFunction by index
 		/// @param[in] index The index of the PartneredControlFunction to get
 		/// @returns a PartneredControlFunction at the index specified from `partneredControlFunctionList`
@@ -104,9 +117,27 @@ namespace isobus
 		/// @returns A reference to the PGN callback data object at the index specified
 		ParameterGroupNumberCallbackData &get_parameter_group_number_callback(std::size_t index);
 
+		/// @brief The compiled NAME filters of all partners on one CAN channel, stored side by side
+		struct CompiledNAMEFilters
+		{
+			std::vector<std::uint64_t> masks; ///< The NAME mask of each partner
+			std::vector<std::uint64_t> values; ///< The value each partner needs under its mask
+			std::vector<PartneredControlFunction *> partners; ///< The partner each mask and value belongs to, nullptr for padding
+		};
+
+		static constexpr std::size_t NAME_MATCH_BLOCK_SIZE = 8; ///< The number of partners compared at once. The compiled filters are padded to a multiple of this.
+
+		/// @brief Rebuilds the compiled NAME filters of a CAN channel from the list of partners
+		/// @param[in] CANPort The CAN channel index to rebuild
+		static void compile_name_filters(std::uint8_t CANPort);
+
+		static std::array<CompiledNAMEFilters, CAN_PORT_MAXIMUM> compiledNAMEFilters; ///< The compiled NAME filters of each CAN channel
+
 		static std::vector<PartneredControlFunction *> partneredControlFunctionList; ///< A list of all created partnered control functions
 		static bool anyPartnerNeedsInitializing; ///< A way for the network manager to know if it needs to parse the partner list to match partners with existing CFs
 		const std::vector<NAMEFilter> NAMEFilterList; ///< A list of NAME parameters that describe this control function's identity
+		std::uint64_t NAMEFilterMask; ///< The bits of a NAME that the filters look at
+		std::uint64_t NAMEFilterValue; ///< The value a NAME must have under NAMEFilterMask to match all filters
 		std::vector<ParameterGroupNumberCallbackData> parameterGroupNumberCallbacks; ///< A list of all parameter group number callbacks associated with this control function
 		bool initialized; ///< A way to track if the network manager has processed this CF against existing CFs
 	};
@@ -15,7 +15,9 @@
 #include "isobus/isobus/can_callbacks.hpp"
 #include "isobus/isobus/can_control_function.hpp"
 #include "isobus/isobus/can_message.hpp"
+#include "isobus/isobus/can_transmit_data_source.hpp"
 
+#include <memory>
 #include <vector>
 
 namespace isobus
@@ -80,6 +82,22 @@ namespace isobus
 		                                       void *parentPointer,
 		                                       DataChunkCallback frameChunkCallback) = 0;
 
+		/// @brief The network manager calls this to see if the protocol can send a message whose payload is read from a data source
+		/// @details Protocols that don't support reading directly from a TransmitDataSource don't need to override this.
+		/// @param[in] parameterGroupNumber The PGN of the message
+		/// @param[in] dataSource The source to read the payload from. The protocol keeps it alive until the session ends.
+		/// @param[in] source The source control function
+		/// @param[in] destination The destination control function
+		/// @param[in] transmitCompleteCallback A callback for when the protocol completes its work
+		/// @param[in] parentPointer A generic context object for the tx complete callback
+		/// @returns true if the message was accepted by the protocol for processing
+		virtual bool protocol_transmit_data_source(std::uint32_t parameterGroupNumber,
+		                                           std::shared_ptr<TransmitDataSource> dataSource,
+		                                           ControlFunction *source,
+		                                           ControlFunction *destination,
+		                                           TransmitCompleteCallback transmitCompleteCallback,
+		                                           void *parentPointer);
+
 		/// @brief This will be called by the network manager on every cyclic update of the stack
 		virtual void update(CANLibBadge<CANNetworkManager>) = 0;
 
@@ -0,0 +1,281 @@
+//================================================================================================
+/// @file can_signal_database.hpp
+///
+/// @brief Loads signal definitions from a DBC file, and decodes batches of received messages
+/// into columns of physical values, for logging and gateways that handle many PGNs.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#ifndef CAN_SIGNAL_DATABASE_HPP
+#define CAN_SIGNAL_DATABASE_HPP
+
+#include "isobus/isobus/can_frame.hpp"
+#include "isobus/isobus/can_message.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace isobus
+{
+	//================================================================================================
+	/// @class SignalDatabase
+	///
+	/// @brief A set of PGNs and their signals, loaded at runtime, with a table driven batch decoder.
+	/// @details Load a DBC file with load_file, or DBC text with load_string. Messages are matched by PGN, so one
+	/// definition decodes the message from every source address. Only extended (29 bit) identifiers are used.
+	/// Each signal is turned into a decode table entry when it is loaded (which bytes to read, a shift, a mask, and a sign bit)
+	/// so decoding never looks at the signal's definition again.
+	///
+	/// Decoding happens in two steps. Messages are first staged into a DecodedBatch, which copies each payload
+	/// into a contiguous row of its PGN's table. decode() then walks each signal down all the new rows at once,
+	/// which is a branch free loop over contiguous memory that the compiler can vectorize, and writes the physical values into one
+	/// column per signal. decode_frames and decode_messages do both steps for a whole array of frames or messages.
+	///
+	/// The database can also be given to CANNetworkManager::set_signal_database, which stages every matching received
+	/// message (including ones received with the transport protocols), and hands you the decoded batch once per update.
+	//================================================================================================
+	class SignalDatabase
+	{
+	public:
+		/// @brief The definition of one signal (an SPN) in a message
+		struct SignalDefinition
+		{
+			std::string name; ///< The name of the signal
+			std::string unit; ///< The unit of the physical value
+			double scale; ///< The resolution of the signal, physical = (raw * scale) + offset
+			double offset; ///< The offset of the signal
+			double minimum; ///< The smallest valid physical value, from the DBC file
+			double maximum; ///< The largest valid physical value, from the DBC file
+			std::uint16_t startBit; ///< The start bit as written in the DBC file (the MSB for big endian signals)
+			std::uint8_t bitLength; ///< The length of the signal in bits
+			CANMessage::ByteFormat byteFormat; ///< The byte order of the signal
+			bool isSigned; ///< True if the raw value is two's complement
+			bool isMultiplexor; ///< True if this signal selects which multiplexed signals are present
+			std::int32_t multiplexValue; ///< The value of the multiplexor for which this signal is present, or -1 if it's always present
+		};
+
+		/// @brief The definition of one message (a PGN)
+		struct MessageDefinition
+		{
+			std::string name; ///< The name of the message
+			std::vector<SignalDefinition> signals; ///< The signals in the message
+			std::uint32_t parameterGroupNumber; ///< The PGN of the message
+			std::uint16_t dataLength; ///< The length of the payload in bytes
+		};
+
+		//================================================================================================
+		/// @class DecodedBatch
+		///
+		/// @brief Staged payloads and decoded columns of physical values, per message in the database.
+		/// @details Rows are appended until clear() is called, so a batch can keep growing across several decodes.
+		/// A value is NaN if the signal is multiplexed and wasn't present in that row.
+		//================================================================================================
+		class DecodedBatch
+		{
+		public:
+			/// @brief Constructor for an empty batch
+			DecodedBatch();
+
+			/// @brief Returns the number of rows of a message
+			/// @param[in] messageIndex The index of the message in the database
+			/// @returns The number of decoded rows of that message
+			std::size_t get_number_rows(std::size_t messageIndex) const;
+
+			/// @brief Returns the physical values of one signal, one per row
+			/// @param[in] messageIndex The index of the message in the database
+			/// @param[in] signalIndex The index of the signal in the message
+			/// @returns The column of physical values
+			const std::vector<double> &get_column(std::size_t messageIndex, std::size_t signalIndex) const;
+
+			/// @brief Returns when each row was received, in microseconds
+			/// @param[in] messageIndex The index of the message in the database
+			/// @returns The column of timestamps
+			const std::vector<std::uint64_t> &get_timestamps(std::size_t messageIndex) const;
+
+			/// @brief Returns the source address of each row
+			/// @param[in] messageIndex The index of the message in the database
+			/// @returns The column of source addresses
+			const std::vector<std::uint8_t> &get_source_addresses(std::size_t messageIndex) const;
+
+			/// @brief Returns the CAN channel each row was received on
+			/// @param[in] messageIndex The index of the message in the database
+			/// @returns The column of CAN channels
+			const std::vector<std::uint8_t> &get_can_ports(std::size_t messageIndex) const;
+
+			/// @brief Returns the total number of rows that are staged but not yet decoded
+			/// @returns The number of rows waiting for decode()
+			std::size_t get_number_staged_rows() const;
+
+			/// @brief Removes all rows, but keeps the memory so the next batch doesn't need to allocate
+			void clear();
+
+		private:
+			friend class SignalDatabase; ///< The database fills in the batch
+
+			/// @brief The rows of one message
+			struct MessageRows
+			{
+				/// @brief Constructor for a message with no rows
+				MessageRows();
+
+				std::vector<std::uint8_t> payloads; ///< The staged payloads, one padded row after another
+				std::vector<std::uint64_t> timestamps; ///< When each row was received, in microseconds
+				std::vector<std::uint8_t> sourceAddresses; ///< The source address of each row
+				std::vector<std::uint8_t> canPorts; ///< The CAN channel of each row
+				std::vector<std::vector<double>> columns; ///< One column of physical values per signal
+				std::size_t decodedRows; ///< How many rows have been decoded into the columns
+			};
+
+			std::vector<MessageRows> messages; ///< The rows of each message in the database
+			std::vector<std::uint64_t> multiplexorValues; ///< Scratch space for the raw multiplexor value of each row
+			std::size_t stagedRows; ///< The number of rows waiting to be decoded
+			const SignalDatabase *database; ///< The database the batch is laid out for
+		};
+
+		/// @brief Constructor for an empty database
+		SignalDatabase();
+
+		/// @brief Replaces the database with the messages in a DBC file. Batches used with the old contents should be cleared.
+		/// @param[in] filename The path of the DBC file
+		/// @returns `true` if the file was read and had at least one usable message, otherwise `false`
+		bool load_file(const std::string &filename);
+
+		/// @brief Replaces the database with the messages in some DBC text
+		/// @details BO_ and SG_ lines are used, everything else is ignored. Signals that can't be decoded (more than 8 bytes wide,
+		/// or past the end of their message) are skipped with a warning.
+		/// @param[in] dbcText The contents of a DBC file
+		/// @returns `true` if the text had at least one usable message, otherwise `false`
+		bool load_string(const std::string &dbcText);
+
+		/// @brief Returns the number of messages in the database
+		/// @returns The number of messages
+		std::size_t get_number_messages() const;
+
+		/// @brief Returns a message's definition
+		/// @param[in] messageIndex The index of the message
+		/// @returns The definition of the message
+		const MessageDefinition &get_message(std::size_t messageIndex) const;
+
+		/// @brief Finds a message by PGN
+		/// @param[in] parameterGroupNumber The PGN to find
+		/// @param[out] messageIndex The index of the message, if it was found
+		/// @returns `true` if the PGN is in the database, otherwise `false`
+		bool get_message_index(std::uint32_t parameterGroupNumber, std::size_t &messageIndex) const;
+
+		/// @brief Finds a signal by name
+		/// @param[in] messageIndex The index of the message
+		/// @param[in] signalName The name of the signal
+		/// @param[out] signalIndex The index of the signal in the message, if it was found
+		/// @returns `true` if the signal was found, otherwise `false`
+		bool get_signal_index(std::size_t messageIndex, const std::string &signalName, std::size_t &signalIndex) const;
+
+		/// @brief Copies a message's payload into a batch, if its PGN is in the database
+		/// @param[in] message The message to stage
+		/// @param[in] timestamp_us When the message was received, in microseconds
+		/// @param[in,out] batch The batch to stage the message into
+		/// @returns `true` if the message was staged, `false` if its PGN isn't in the database
+		bool stage(CANMessage &message, std::uint64_t timestamp_us, DecodedBatch &batch) const;
+
+		/// @brief Copies a frame's payload into a batch, if it's an extended frame and its PGN is in the database
+		/// @param[in] frame The frame to stage
+		/// @param[in,out] batch The batch to stage the frame into
+		/// @returns `true` if the frame was staged, otherwise `false`
+		bool stage(const HardwareInterfaceCANFrame &frame, DecodedBatch &batch) const;
+
+		/// @brief Decodes every staged row of a batch into its signal columns
+		/// @param[in,out] batch The batch to decode
+		void decode(DecodedBatch &batch) const;
+
+		/// @brief Stages and decodes an array of frames
+		/// @param[in] frames The frames to decode
+		/// @param[in] numberOfFrames The number of frames in the array
+		/// @param[in,out] batch The batch to add the rows to
+		/// @returns The number of frames that were in the database
+		std::size_t decode_frames(const HardwareInterfaceCANFrame *frames, std::size_t numberOfFrames, DecodedBatch &batch) const;
+
+		/// @brief Stages and decodes an array of messages, all given the same timestamp
+		/// @param[in] messages The messages to decode
+		/// @param[in] numberOfMessages The number of messages in the array
+		/// @param[in] timestamp_us The timestamp to give the rows, in microseconds
+		/// @param[in,out] batch The batch to add the rows to
+		/// @returns The number of messages that were in the database
+		std::size_t decode_messages(CANMessage *messages, std::size_t numberOfMessages, std::uint64_t timestamp_us, DecodedBatch &batch) const;
+
+		static constexpr std::uint16_t MAX_DATA_LENGTH = 1785; ///< The longest message that can be defined, which is the most the transport protocol can carry
+		static constexpr std::uint16_t ROW_PADDING = 8; ///< Extra bytes after each staged payload, so every signal can be read as one 8 byte window
+
+	private:
+		/// @brief How to pull one signal out of a staged row, worked out when the signal is loaded
+		struct SignalDecoder
+		{
+			std::uint64_t mask; ///< The mask of the raw value after shifting
+			std::uint64_t signBit; ///< The sign bit of the raw value, or 0 for unsigned signals
+			double scale; ///< The resolution of the signal
+			double offset; ///< The offset of the signal
+			std::uint16_t windowByte; ///< The first byte of the 8 byte window that holds the signal
+			std::uint8_t shift; ///< How far to shift the window to put the signal's LSB at bit 0
+			bool bigEndian; ///< True if the window is read big endian
+			std::int32_t multiplexValue; ///< The multiplexor value the signal needs, or -1 if it's always present
+		};
+
+		/// @brief The decode tables of one message
+		struct MessageDecoder
+		{
+			std::vector<SignalDecoder> signals; ///< The decode table entry of each signal
+			std::size_t rowStride; ///< The size of one staged row in bytes
+			std::int32_t multiplexorIndex; ///< The index of the multiplexor signal, or -1 if there isn't one
+		};
+
+		/// @brief Parses a signal line of a DBC file
+		/// @param[in] line The line, starting at SG_
+		/// @param[out] signal The parsed signal
+		/// @returns `true` if the line was a valid signal, otherwise `false`
+		static bool parse_signal(const std::string &line, SignalDefinition &signal);
+
+		/// @brief Works out the decode table entry of a signal
+		/// @param[in] signal The signal to decode
+		/// @param[in] dataLength The length of the signal's message
+		/// @param[out] decoder The decode table entry
+		/// @returns `true` if the signal fits in an 8 byte window inside the message, otherwise `false`
+		static bool build_decoder(const SignalDefinition &signal, std::uint16_t dataLength, SignalDecoder &decoder);
+
+		/// @brief Reads the raw value of a signal from a staged row
+		/// @param[in] decoder The signal's decode table entry
+		/// @param[in] row The staged row
+		/// @returns The raw value of the signal
+		static std::uint64_t read_raw_value(const SignalDecoder &decoder, const std::uint8_t *row);
+
+		/// @brief Makes sure a batch has a set of rows for each message in this database
+		/// @param[in,out] batch The batch to prepare
+		void prepare_batch(DecodedBatch &batch) const;
+
+		/// @brief Copies a payload into a batch
+		/// @param[in] messageIndex The index of the message in the database
+		/// @param[in] data The payload
+		/// @param[in] dataLength The length of the payload
+		/// @param[in] timestamp_us When the payload was received
+		/// @param[in] sourceAddress The source of the payload
+		/// @param[in] canPort The CAN channel of the payload
+		/// @param[in,out] batch The batch to add the row to
+		void stage_payload(std::size_t messageIndex,
+		                   const std::uint8_t *data,
+		                   std::size_t dataLength,
+		                   std::uint64_t timestamp_us,
+		                   std::uint8_t sourceAddress,
+		                   std::uint8_t canPort,
+		                   DecodedBatch &batch) const;
+
+		std::vector<MessageDefinition> messages; ///< The messages in the database
+		std::vector<MessageDecoder> decoders; ///< The decode tables of each message
+		std::unordered_map<std::uint32_t, std::size_t> messageIndices; ///< Finds a message's index by PGN
+	};
+
+	/// @brief A callback for batches of signals decoded by the network manager
+	typedef void (*SignalBatchCallback)(const SignalDatabase &database, const SignalDatabase::DecodedBatch &batch, void *parentPointer);
+} // namespace isobus
+
+#endif // CAN_SIGNAL_DATABASE_HPP
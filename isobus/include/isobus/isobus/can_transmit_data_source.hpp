@@ -0,0 +1,91 @@
+//================================================================================================
+/// @file can_transmit_data_source.hpp
+///
+/// @brief Defines an abstraction for where the payload of a long transmitted message comes from,
+/// so that protocols can read it in place instead of copying it into the session.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#ifndef CAN_TRANSMIT_DATA_SOURCE_HPP
+#define CAN_TRANSMIT_DATA_SOURCE_HPP
+
+#include "isobus/utility/memory_mapped_file.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace isobus
+{
+	//================================================================================================
+	/// @class TransmitDataSource
+	///
+	/// @brief A read-only source of payload data for a message sent with
+	/// CANNetworkManager::send_can_message_from_data_source.
+	/// @details The transport protocols hold a reference to the source for the lifetime of the
+	/// session and read from it as packets are sent. If the data is contiguous in memory,
+	/// `get_data` should return it, and the protocol will copy bytes straight from it into each frame.
+	/// Otherwise the protocol will call `read` once per CTS window.
+	//================================================================================================
+	class TransmitDataSource
+	{
+	public:
+		/// @brief Destructor for a TransmitDataSource
+		virtual ~TransmitDataSource() = default;
+
+		/// @brief Returns the total number of bytes this source provides
+		/// @returns The length of the payload in bytes
+		virtual std::uint32_t get_size() const = 0;
+
+		/// @brief Returns a pointer to the whole payload if it is contiguous in memory
+		/// @returns A pointer to the payload, or nullptr if the payload must be accessed with `read`
+		virtual const std::uint8_t *get_data() const;
+
+		/// @brief Copies a range of the payload into a buffer
+		/// @param[in] offset The offset into the payload to start reading from
+		/// @param[in] length The number of bytes to read
+		/// @param[out] destination The buffer to copy the bytes into, at least `length` bytes long
+		/// @returns `true` if the range was read, `false` if the range was invalid or could not be read
+		virtual bool read(std::uint32_t offset, std::uint32_t length, std::uint8_t *destination) = 0;
+	};
+
+	//================================================================================================
+	/// @class MemoryMappedFileDataSource
+	///
+	/// @brief A TransmitDataSource backed by a read-only memory mapping of a file.
+	/// @details The file is never loaded into the heap. Protocols copy each frame's payload
+	/// directly out of the mapping, so only the pages currently being sent need to be resident.
+	//================================================================================================
+	class MemoryMappedFileDataSource : public TransmitDataSource
+	{
+	public:
+		/// @brief Constructs a data source and attempts to map the specified file
+		/// @param[in] filename The path to the file to map
+		explicit MemoryMappedFileDataSource(const std::string &filename);
+
+		/// @brief Returns if the file was mapped successfully and can be sent
+		/// @returns `true` if the file is mapped, otherwise `false`
+		bool get_is_valid() const;
+
+		/// @brief Returns the total number of bytes in the mapped file
+		/// @returns The size of the file in bytes, or 0 if the file could not be mapped
+		std::uint32_t get_size() const override;
+
+		/// @brief Returns a pointer to the start of the mapping
+		/// @returns A pointer to the start of the mapping, or nullptr if the file could not be mapped
+		const std::uint8_t *get_data() const override;
+
+		/// @brief Copies a range of the file into a buffer
+		/// @param[in] offset The offset into the file to start reading from
+		/// @param[in] length The number of bytes to read
+		/// @param[out] destination The buffer to copy the bytes into
+		/// @returns `true` if the range was read, `false` if the range was out of bounds
+		bool read(std::uint32_t offset, std::uint32_t length, std::uint8_t *destination) override;
+
+	private:
+		MemoryMappedFile file; ///< The mapping of the file
+	};
+} // namespace isobus
+
+#endif // CAN_TRANSMIT_DATA_SOURCE_HPP
@@ -16,6 +16,8 @@
 #include "isobus/isobus/can_managed_message.hpp"
 #include "isobus/isobus/can_protocol.hpp"
 
+#include <vector>
+
 namespace isobus
 {
 	//================================================================================================
@@ -80,12 +82,17 @@ namespace isobus
 			CANLibManagedMessage sessionMessage; ///< A CAN message is used in the session to represent and store data like PGN
 			TransmitCompleteCallback sessionCompleteCallback; ///< A callback that is to be called when the session is completed
 			DataChunkCallback frameChunkCallback; ///< A callback that might be used to get chunks of data to send
+			std::shared_ptr<TransmitDataSource> dataSource; ///< An optional source to read the payload from in place
+			std::vector<std::uint8_t> windowBuffer; ///< Holds the current CTS window when reading from a non-contiguous source or windowed callback
+			std::uint32_t windowBufferOffset; ///< The message offset of the first byte in the window buffer
 			void *parent; ///< A generic context variable that helps identify what object callbacks are destined for. Can be nullptr
 			std::uint32_t timestamp_ms; ///< A timestamp used to track session timeouts
 			std::uint16_t lastPacketNumber; ///< The last processed sequence number for this set of packets
 			std::uint8_t packetCount; ///< The total number of packets to receive or send in this session
 			std::uint8_t processedPacketsThisSession; ///< The total processed packet count for the whole session so far
 			std::uint8_t clearToSendPacketMax; ///< The max packets that can be sent per CTS as indicated by the RTS message
+			std::uint8_t retransmitRequests; ///< The number of retransmit requests made (Rx) or honoured (Tx) in this session
+			bool retransmitPending; ///< Rx only, denotes we've asked for a retransmit and are discarding stale packets until it arrives
 			const Direction sessionDirection; ///< Represents Tx or Rx session
 		};
 
@@ -155,10 +162,60 @@ namespace isobus
 		                               void *parentPointer,
 		                               DataChunkCallback frameChunkCallback) override;
 
+		/// @brief The network manager calls this to see if the protocol can send a message whose payload is read from a data source
+		/// @param[in] parameterGroupNumber The PGN of the message
+		/// @param[in] dataSource The source to read the payload from
+		/// @param[in] source The source control function
+		/// @param[in] destination The destination control function
+		/// @param[in] transmitCompleteCallback A callback for when the protocol completes its work
+		/// @param[in] parentPointer A generic context object for the tx complete callback
+		/// @returns true if the message was accepted by the protocol for processing
+		bool protocol_transmit_data_source(std::uint32_t parameterGroupNumber,
+		                                   std::shared_ptr<TransmitDataSource> dataSource,
+		                                   ControlFunction *source,
+		                                   ControlFunction *destination,
+		                                   TransmitCompleteCallback transmitCompleteCallback,
+		                                   void *parentPointer) override;
+
 		/// @brief Updates the protocol cyclically
 		void update(CANLibBadge<CANNetworkManager>) override;
 
 	private:
+		/// @brief Validates a transmit request and creates a new Tx session for it
+		/// @param[in] parameterGroupNumber The PGN of the message
+		/// @param[in] data The data to be sent, or nullptr if the data comes from a callback or data source
+		/// @param[in] messageLength The length of the data to be sent
+		/// @param[in] source The source control function
+		/// @param[in] destination The destination control function
+		/// @param[in] transmitCompleteCallback A callback for when the protocol completes its work
+		/// @param[in] parentPointer A generic context object for the tx complete and chunk callbacks
+		/// @param[in] frameChunkCallback A callback to get some data to send
+		/// @param[in] dataSource A source to read the payload from in place
+		/// @returns true if a session was created
+		bool create_transmit_session(std::uint32_t parameterGroupNumber,
+		                             const std::uint8_t *data,
+		                             std::uint32_t messageLength,
+		                             ControlFunction *source,
+		                             ControlFunction *destination,
+		                             TransmitCompleteCallback transmitCompleteCallback,
+		                             void *parentPointer,
+		                             DataChunkCallback frameChunkCallback,
+		                             std::shared_ptr<TransmitDataSource> dataSource);
+
+		/// @brief Asks the sender of an Rx session to retransmit starting at the first packet we're missing
+		/// @details Uses up one of the session's retransmit requests. The CTS itself is sent from `update`.
+		/// @param[in] session The Rx session that is missing data
+		/// @returns true if a retransmit was requested, false if the session has no retransmit requests left
+		bool request_retransmit(TransportProtocolSession *session);
+
+		/// @brief Gets the 7 payload bytes for the next data packet of a Tx session
+		/// @details Reads from the session's data source, chunk callback, or internal buffer as appropriate.
+		/// Non-contiguous sources and windowed callbacks are read one CTS window at a time.
+		/// @param[in] session The session to get data for
+		/// @param[out] packetData A buffer of at least 7 bytes for the payload. Unused bytes are set to 0xFF.
+		/// @returns true if the data was retrieved, false if the callback or source failed
+		bool get_transmit_packet_data(TransportProtocolSession *session, std::uint8_t *packetData);
+
 		/// @brief Aborts the session with the specified abort reason. Sends a CAN message.
 		/// @param[in] session The session to abort
 		/// @param[in] reason The reason we're aborting the session
@@ -11,7 +11,12 @@
 /// as only 1 BAM can be active at a time. This message
 /// is sent at 1 Hz. In ISOBUS mode, unlike in J1939, the message is discontinued when no DTCs are active to
 /// minimize bus load. Also, ISO-11783 does not utilize or support lamp status.
-/// Other messages this protocol supports include: DM2, DM3, DM11, DM13, DM22, software ID, and Product ID.
+/// Other messages this protocol supports include: DM2, DM3, DM4, DM11, DM13, DM22, DM25, software ID, and Product ID.
+///
+/// @note DM4 and DM25 report freeze frames, which are snapshots of SPNs that your application records
+/// in a FreezeFrameSignalRecorder, taken when each DTC becomes active. Both messages contain the
+/// recorder's SPNs in the order they were added, so if you need a J1939 conforming DM4, add the SPNs
+/// that J1939-73 requires for it first.
 ///
 /// @note DM13 has two primary functions. It may be used as a command, from either a tool or an
 /// ECU, directed to a single controller or to all controllers to request the receiving
@@ -22,11 +27,10 @@
 /// This is not a message to ignore all communications. It is a message to minimize network traffic.
 ///
 /// @attention It is recognized that some network messages may be required to continue even during
-/// the "stop broadcast" condition. You MUST handle this in your application, as the stack cannot
-/// decide what messages are required without context. In other words, you must opt-in to make
-/// your application layer messages adhere to DM13 requests by explicitly calling the functions
-/// on this protocol (using get_diagnostic_protocol_by_internal_control_function)
-/// to check if you should send it.
+/// the "stop broadcast" condition. The network manager drops (or optionally holds back) broadcasts
+/// from internal control functions while a DM13 has suspended them, except for network management
+/// and transport protocol messages. If your application needs other broadcasts to continue, add their
+/// PGNs with CANNetworkManager::add_broadcast_suspension_exception.
 ///
 /// @author Adrian Del Grosso
 ///
@@ -38,11 +42,16 @@
 
 #include "isobus/isobus/can_internal_control_function.hpp"
 #include "isobus/isobus/can_protocol.hpp"
+#include "isobus/isobus/isobus_diagnostic_trouble_code_log.hpp"
+#include "isobus/isobus/isobus_freeze_frame_signal_recorder.hpp"
 #include "isobus/utility/processing_flags.hpp"
 
+#include <array>
 #include <list>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace isobus
 {
@@ -117,6 +126,8 @@ namespace isobus
 			DiagnosticProtocolID, ///< A flag to manage sending the Diagnostic protocol ID message
 			ProductIdentification, ///< A flag to manage sending the product identification message
 			DM22, ///< Process queued up DM22 responses
+			DM4, ///< A flag to manage sending the DM4 message
+			DM25, ///< A flag to manage sending the DM25 message
 
 			NumberOfFlags ///< The number of flags in the enum
 		};
@@ -184,6 +195,7 @@ namespace isobus
 			DiagnosticTroubleCode(std::uint32_t spn, FailureModeIdentifier fmi, LampStatus lamp);
 
 			/// @brief A useful way to compare DTC objects to each other for equality
+			/// @details DTCs are identified by their SPN and FMI, so the lamp state is not compared
 			/// @param[in] obj The "rhs" of the comparison
 			/// @returns `true` if the objects were equal
 			bool operator==(const DiagnosticTroubleCode &obj);
@@ -267,10 +279,12 @@ namespace isobus
 		/// @brief Adds a DTC to the active list, or removes one from the active list
 		/// @details When you call this function with a DTC and `true`, it will be added to the DM1 message.
 		/// When you call it with a DTC and `false` it will be moved to the inactive list.
+		/// DTCs are identified by their SPN and FMI, so activating a DTC that is already active with a different
+		/// lamp state updates the lamp state of that DTC, which is a state change and is reported in a DM1 like any other.
 		/// If you get `false` as a return value, either the DTC was already in the target state or the data was not valid
 		/// @param[in] dtc A diagnostic trouble code whose state should be altered
 		/// @param[in] active Sets if the DTC is currently active or not
-		/// @returns True if the DTC was added/removed from the list, false if DTC was not valid or target state is invalid
+		/// @returns True if the DTC was added/removed from the list or its lamp state changed, false if DTC was not valid or target state is invalid
 		bool set_diagnostic_trouble_code_active(const DiagnosticTroubleCode &dtc, bool active);
 
 		/// @brief Returns if a DTC is active
@@ -278,6 +292,38 @@ namespace isobus
 		/// @returns `true` if the DTC was in the active list
 		bool get_diagnostic_trouble_code_active(const DiagnosticTroubleCode &dtc);
 
+		/// @brief Returns how many times a DTC has been active, if it is in the active or inactive list
+		/// @param[in] dtc The diagnostic trouble code to look up, by SPN and FMI
+		/// @returns The occurrence count of the DTC, or 0 if the DTC is in neither list
+		std::uint8_t get_diagnostic_trouble_code_occurrance_count(const DiagnosticTroubleCode &dtc) const;
+
+		/// @brief Attaches a persistent log that keeps the DTC history and occurrence counts across power cycles
+		/// @details The log is opened, and the DTCs in it are restored to the inactive list. DTCs that were active when
+		/// the log was last written are restored as previously active too, since your application is expected to set
+		/// them active again if the fault is still present. DTCs already known to this protocol take precedence over
+		/// ones in the log. After that, every DTC state change is queued to the log, which writes it from its own thread,
+		/// so setting DTCs never blocks on file I/O.
+		/// @param[in] log The log to attach, which must not be open yet, or nullptr to detach the current log
+		/// @returns `true` if the log was attached (or detached), `false` if the log could not be opened
+		bool set_diagnostic_trouble_code_log(std::shared_ptr<DiagnosticTroubleCodeLog> log);
+
+		/// @brief Sets the recorder that freeze frames are captured from when a DTC becomes active
+		/// @details When a DTC becomes active, the latest value of each of the recorder's signals is copied into
+		/// a preallocated freeze frame for that DTC, without allocating or waiting on the threads recording values.
+		/// Up to MAX_FREEZE_FRAMES frames are kept, and the oldest one is replaced when they are all in use.
+		/// Frames are reported in DM4 and DM25, and are removed when their DTC is cleared from the inactive list.
+		/// @param[in] recorder The recorder to capture freeze frames from, or nullptr to stop capturing them
+		void set_freeze_frame_recorder(std::shared_ptr<FreezeFrameSignalRecorder> recorder);
+
+		/// @brief Returns the freeze frame captured when a DTC last became active
+		/// @param[in] dtc The DTC to get the freeze frame of, by SPN and FMI
+		/// @param[out] freezeFrameData The SPN data of the freeze frame, in the order the signals were added to the recorder
+		/// @returns `true` if there is a freeze frame for the DTC, otherwise `false`
+		bool get_freeze_frame(const DiagnosticTroubleCode &dtc, std::vector<std::uint8_t> &freezeFrameData) const;
+
+		static constexpr std::uint8_t MAX_FREEZE_FRAMES = 8; ///< The number of freeze frames kept by the protocol
+		static constexpr std::uint8_t MAX_FREEZE_FRAME_DATA_BYTES = 64; ///< The most SPN data captured in each freeze frame
+
 		/// @brief Sets the product ID code used in the diagnostic protocol "Product Identification" message (PGN 0xFC8D)
 		/// @details The product identification code, as assigned by the manufacturer, corresponds with the number on the
 		/// type plate of a product. For vehicles, this number can be the same as the VIN. For stand-alone systems, such as VTs,
@@ -361,6 +407,13 @@ namespace isobus
 			DTCNoLongerActive = 0x04 ///< DTC is inactive, not active, but active was requested to be cleared
 		};
 
+		/// @brief Where a DTC is stored, looked up by its SPN and FMI
+		struct DTCIndexEntry
+		{
+			std::size_t listIndex; ///< The index of the DTC in its list
+			bool active; ///< `true` if the DTC is in the active list, `false` if it is in the inactive list
+		};
+
 		/// @brief A structure to hold data about DM22 responses we need to send
 		struct DM22Data
 		{
@@ -372,6 +425,16 @@ namespace isobus
 			bool nack; ///< true if we are sending a NACK instead of PACK. Determines if we use nackIndicator
 		};
 
+		/// @brief A snapshot of the recorded signals taken when a DTC became active
+		struct FreezeFrame
+		{
+			DiagnosticTroubleCode dtc; ///< The DTC that caused the capture, with its occurance count at the time
+			std::uint32_t captureTimestamp_ms; ///< When the frame was captured, used to replace the oldest frame first
+			std::uint16_t dataLength; ///< The number of valid bytes in data
+			std::array<std::uint8_t, MAX_FREEZE_FRAME_DATA_BYTES> data; ///< The recorded SPN data
+			bool inUse; ///< `true` if this frame holds a capture
+		};
+
 		static constexpr std::uint32_t DM_MAX_FREQUENCY_MS = 1000; ///< You are techically allowed to send more than this under limited circumstances, but a hard limit saves 4 RAM bytes per DTC and has BAM benefits
 		static constexpr std::uint32_t DM13_HOLD_SIGNAL_TRANSMIT_INTERVAL_MS = 5000; ///< Defined in 5.7.13.13 SPN 1236
 		static constexpr std::uint32_t DM13_TIMEOUT_MS = 6000; ///< The timout in 5.7.13 after which nodes shall revert back to the normal broadcast state
@@ -381,6 +444,10 @@ namespace isobus
 		static constexpr std::uint8_t DM13_NUMBER_OF_J1939_NETWORKS = 11; ///< The number of networks in DM13 that are set aside for J1939
 		static constexpr std::uint8_t DM13_NETWORK_BITMASK = 0x03; ///< Used to mask the network SPN values
 		static constexpr std::uint8_t DM13_BITS_PER_NETWORK = 2; ///< Number of bits for the network SPNs
+		static constexpr std::uint8_t MAX_OCCURANCE_COUNT = 126; ///< The max occurance count of a DTC, since 127 means "not available"
+		static constexpr std::uint8_t DM_PAYLOAD_LAMP_BYTES = 2; ///< The number of lamp status bytes at the start of a DM1 or DM2
+		static constexpr std::uint8_t NUMBER_OF_LAMP_STATES = 12; ///< The number of LampStatus values other than `None`
+		static constexpr std::uint8_t NUMBER_OF_FLASH_STATES_PER_LAMP = 3; ///< Each lamp in LampStatus has a solid, slow flash, and fast flash value
 
 		/// @brief Lists the J1939 networks by index rather than by definition in J1939-73 5.7.13
 		static constexpr Network J1939NetworkIndicies[DM13_NUMBER_OF_J1939_NETWORKS] = { Network::SAEJ1939Network1PrimaryVehicleNetwork,
@@ -409,21 +476,72 @@ namespace isobus
 		/// @brief A utility function that will clean up PGN registrations
 		void deregister_all_pgns();
 
-		/// @brief This is a way to find the overall lamp states to report
-		/// @details This searches the active DTC list to find if a lamp is on or off, and to find the overall flash state for that lamp.
-		/// Basically, since the lamp states are global to the CAN message, we need a way to resolve the "total" lamp state from the list.
-		/// @param[in] targetLamp The lamp to find the status of
-		/// @param[out] flash How the lamp should be flashing
-		/// @param[out] lampOn If the lamp state is on for any DTC
-		void get_active_list_lamp_state_and_flash_state(Lamps targetLamp, FlashState &flash, bool &lampOn);
+		/// @brief Returns the key used to look up a DTC in the DTC index
+		/// @param[in] suspectParameterNumber The SPN of the DTC
+		/// @param[in] failureModeIdentifier The FMI of the DTC
+		/// @returns A key that uniquely identifies the DTC
+		static std::uint32_t get_dtc_index_key(std::uint32_t suspectParameterNumber, std::uint8_t failureModeIdentifier);
+
+		/// @brief Encodes a DTC into the 4 bytes used for it in DM1 and DM2
+		/// @param[in] dtc The DTC to encode
+		/// @param[out] buffer The buffer to encode into, which must have room for 4 bytes
+		static void encode_dtc(const DiagnosticTroubleCode &dtc, std::uint8_t *buffer);
+
+		/// @brief Appends a DTC to the active or inactive list, and updates the index, payload, and lamp totals to match
+		/// @param[in] dtc The DTC to add
+		/// @param[in] active `true` to add to the active list, `false` to add to the inactive list
+		void add_dtc_to_list(const DiagnosticTroubleCode &dtc, bool active);
+
+		/// @brief Removes a DTC from the active or inactive list, and updates the index, payload, and lamp totals to match
+		/// @details The last DTC in the list is moved into the removed DTC's place, so removal is constant time.
+		/// @param[in] active `true` to remove from the active list, `false` to remove from the inactive list
+		/// @param[in] listIndex The index of the DTC in the list
+		/// @returns The DTC that was removed
+		DiagnosticTroubleCode remove_dtc_from_list(bool active, std::size_t listIndex);
+
+		/// @brief Copies the latest recorded signals into the freeze frame for a DTC, reusing the oldest frame if needed.
+		/// This never allocates.
+		/// @param[in] dtc The DTC that just became active
+		void capture_freeze_frame(const DiagnosticTroubleCode &dtc);
+
+		/// @brief Removes the freeze frame of a DTC, if it has one
+		/// @param[in] dtc The DTC to remove the freeze frame of
+		void remove_freeze_frame(const DiagnosticTroubleCode &dtc);
+
+		/// @brief Sends a DM4 or DM25 containing all freeze frames
+		/// @param[in] parameterGroupNumber The PGN to send, either DM4 or DM25
+		/// @returns true if the message was sent, otherwise false
+		bool send_freeze_frames(std::uint32_t parameterGroupNumber);
+
+		/// @brief Queues a DTC's new state in the DTC log, if there is one
+		/// @param[in] dtc The DTC whose state changed
+		/// @param[in] type The kind of record to write
+		void log_dtc_state(const DiagnosticTroubleCode &dtc, DiagnosticTroubleCodeLog::RecordType type);
+
+		/// @brief Changes the lamp state of a DTC that is already in one of the lists
+		/// @param[in] active `true` if the DTC is in the active list, `false` if it is in the inactive list
+		/// @param[in] listIndex The index of the DTC in the list
+		/// @param[in] lamp The new lamp state
+		void set_dtc_lamp_state(bool active, std::size_t listIndex, LampStatus lamp);
+
+		/// @brief Sends a DM1 on the next update to report a change to the active list, unless a DM1 was sent
+		/// within the last DM_MAX_FREQUENCY_MS, in which case the next periodic DM1 reports it
+		void request_dm1_for_state_change();
 
 		/// @brief This is a way to find the overall lamp states to report
-		/// @details This searches the inactive DTC list to find if a lamp is on or off, and to find the overall flash state for that lamp.
-		/// Basically, since the lamp states are global to the CAN message, we need a way to resolve the "total" lamp state from the list.
+		/// @details Since the lamp states are global to the CAN message, we need a way to resolve the "total" lamp state from a list.
+		/// Each list keeps a count of how many of its DTCs use each lamp state, so this doesn't need to search the list.
+		/// @param[in] lampStateCounts The lamp state counts of the list to find the lamp state for
 		/// @param[in] targetLamp The lamp to find the status of
 		/// @param[out] flash How the lamp should be flashing
 		/// @param[out] lampOn If the lamp state is on for any DTC
-		void get_inactive_list_lamp_state_and_flash_state(Lamps targetLamp, FlashState &flash, bool &lampOn);
+		static void get_lamp_state_and_flash_state(const std::array<std::uint16_t, NUMBER_OF_LAMP_STATES> &lampStateCounts, Lamps targetLamp, FlashState &flash, bool &lampOn);
+
+		/// @brief Sends a DM1 or DM2 from the already encoded DTC payload of a list
+		/// @param[in] parameterGroupNumber The PGN to send, either DM1 or DM2
+		/// @param[in] active `true` to send the active list, `false` to send the inactive list
+		/// @returns true if the message was sent, otherwise false
+		bool send_dtc_list(std::uint32_t parameterGroupNumber, bool active);
 
 		/// @brief The network manager calls this to see if the protocol can accept a non-raw CAN message for processing
 		/// @note In this protocol, we do not accept messages from the network manager for transmission
@@ -445,6 +563,12 @@ namespace isobus
 		                               void *parentPointer,
 		                               DataChunkCallback frameChunkCallback) override;
 
+		/// @brief Decodes the stop/start command for one network from the data of a DM13
+		/// @param[in] messageData The 8 data bytes of the DM13
+		/// @param[in] network The network to get the command for
+		/// @returns The command for the network
+		static StopStartCommand get_dm13_network_command(const std::vector<std::uint8_t> &messageData, Network network);
+
 		/// @brief Sends a DM1 encoded CAN message
 		/// @returns true if the message was sent, otherwise false
 		bool send_diagnostic_message_1();
@@ -526,6 +650,14 @@ namespace isobus
 		std::shared_ptr<InternalControlFunction> myControlFunction; ///< The internal control function that this protocol will send from
 		std::vector<DiagnosticTroubleCode> activeDTCList; ///< Keeps track of all the active DTCs
 		std::vector<DiagnosticTroubleCode> inactiveDTCList; ///< Keeps track of all the previously active DTCs
+		std::unordered_map<std::uint32_t, DTCIndexEntry> dtcIndex; ///< Finds DTCs in the active and inactive lists by SPN and FMI
+		std::vector<std::uint8_t> activeDTCPayload; ///< The DM1 payload, kept up to date as the active list changes. The lamp bytes are filled in when sending.
+		std::vector<std::uint8_t> inactiveDTCPayload; ///< The DM2 payload, kept up to date as the inactive list changes. The lamp bytes are filled in when sending.
+		std::array<std::uint16_t, NUMBER_OF_LAMP_STATES> activeLampStateCounts; ///< How many active DTCs use each lamp state, indexed by LampStatus - 1
+		std::array<std::uint16_t, NUMBER_OF_LAMP_STATES> inactiveLampStateCounts; ///< How many inactive DTCs use each lamp state, indexed by LampStatus - 1
+		std::shared_ptr<DiagnosticTroubleCodeLog> dtcLog; ///< An optional log that persists DTC state changes
+		std::shared_ptr<FreezeFrameSignalRecorder> freezeFrameRecorder; ///< Where freeze frames are captured from, if anywhere
+		std::array<FreezeFrame, MAX_FREEZE_FRAMES> freezeFrames; ///< The captured freeze frames, preallocated so capturing never allocates
 		std::vector<DM22Data> dm22ResponseQueue; ///< Maintaining a list of DM22 responses we need to send to allow for retrying in case of Tx failures
 		std::vector<std::string> ecuIdentificationFields; ///< Stores the ECU ID fields so we can transmit them when ECUID's PGN is requested
 		std::vector<std::string> softwareIdentificationFields; ///< Stores the Software ID fields so we can transmit them when the PGN is requested
@@ -0,0 +1,172 @@
+//================================================================================================
+/// @file isobus_diagnostic_trouble_code_log.hpp
+///
+/// @brief A crash-safe, memory mapped, append-only log of diagnostic trouble code state changes,
+/// which lets the diagnostic protocol keep its DM2 history and occurrence counts across power cycles.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#ifndef ISOBUS_DIAGNOSTIC_TROUBLE_CODE_LOG_HPP
+#define ISOBUS_DIAGNOSTIC_TROUBLE_CODE_LOG_HPP
+
+#include "isobus/utility/memory_mapped_file.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace isobus
+{
+	//================================================================================================
+	/// @class DiagnosticTroubleCodeLog
+	///
+	/// @brief Persists DTC state changes to a memory mapped file of fixed size, CRC checked records.
+	/// @details Every change is appended as a new record, so a crash or power loss can at most lose or
+	/// tear the last few records, which are detected by their CRC and ignored when the log is opened.
+	/// The file is written by a worker thread owned by the log. append() only queues the record,
+	/// so calling it never blocks the CAN stack on file I/O.
+	/// When the file fills up, or when opening finds that most of it is stale, the log is compacted by writing
+	/// the latest state of each DTC to a new file which then atomically replaces the old one.
+	/// Attach a log to a DiagnosticProtocol with DiagnosticProtocol::set_diagnostic_trouble_code_log.
+	//================================================================================================
+	class DiagnosticTroubleCodeLog
+	{
+	public:
+		/// @brief The kinds of records that can be stored in the log
+		enum class RecordType : std::uint8_t
+		{
+			Active = 0, ///< The DTC was active when the record was written
+			PreviouslyActive = 1, ///< The DTC was previously active when the record was written
+			Cleared = 2, ///< The DTC was removed from the history
+			ClearAllPreviouslyActive = 3 ///< All previously active DTCs were removed from the history. The other fields are unused.
+		};
+
+		/// @brief The state of a single DTC as stored in the log
+		struct Record
+		{
+			std::uint32_t suspectParameterNumber; ///< The SPN of the DTC
+			std::uint8_t failureModeIdentifier; ///< The FMI of the DTC
+			std::uint8_t lampState; ///< The lamp status of the DTC, as a DiagnosticProtocol::LampStatus
+			std::uint8_t occurranceCount; ///< The number of times the DTC has been active
+			RecordType type; ///< What this record says happened to the DTC
+		};
+
+		/// @brief Constructor for a log, which does not touch the file until open() is called
+		/// @param[in] filename The path of the log file
+		/// @param[in] recordCapacity The number of records the file holds before it is compacted. The file grows if compacting would leave it more than half full.
+		explicit DiagnosticTroubleCodeLog(const std::string &filename, std::uint32_t recordCapacity = DEFAULT_RECORD_CAPACITY);
+
+		/// @brief Destructor, which writes any queued records and closes the log
+		~DiagnosticTroubleCodeLog();
+
+		/// @brief Deleted copy constructor, a log has exactly one owner of its file
+		DiagnosticTroubleCodeLog(const DiagnosticTroubleCodeLog &) = delete;
+
+		/// @brief Deleted assignment operator, a log has exactly one owner of its file
+		/// @returns Nothing, this is deleted
+		DiagnosticTroubleCodeLog &operator=(const DiagnosticTroubleCodeLog &) = delete;
+
+		/// @brief Opens the log file, creating it if needed, and replays it to find the latest state of each DTC.
+		/// Starts the worker thread that writes appended records.
+		/// @param[out] restoredRecords The latest Active or PreviouslyActive record of each DTC still in the log
+		/// @returns `true` if the log was opened, otherwise `false`
+		bool open(std::vector<Record> &restoredRecords);
+
+		/// @brief Writes any queued records, stops the worker thread and unmaps the file
+		void close();
+
+		/// @brief Returns if the log is open
+		/// @returns `true` if the log is open and accepting records, otherwise `false`
+		bool get_is_open() const;
+
+		/// @brief Queues a record to be written to the file by the worker thread
+		/// @param[in] record The record to append
+		/// @returns `true` if the record was queued, `false` if the log is not open
+		bool append(const Record &record);
+
+		/// @brief Waits until every record appended so far has been written and flushed to the storage device
+		/// @note This blocks on file I/O, so don't call it from the CAN stack's thread
+		void flush();
+
+		/// @brief Returns the number of records currently stored in the file
+		/// @returns The number of records in the file, not counting ones still queued
+		std::uint32_t get_number_of_records() const;
+
+		/// @brief Returns how many times the log has been compacted since it was opened
+		/// @returns The number of compactions since the log was opened
+		std::uint32_t get_number_of_compactions() const;
+
+		static constexpr std::uint32_t DEFAULT_RECORD_CAPACITY = 4096; ///< The default number of records in the log file before it is compacted
+		static constexpr std::uint32_t RECORD_SIZE = 16; ///< The size of each record in the file
+		static constexpr std::uint32_t HEADER_SIZE = 16; ///< The size of the file header
+
+	private:
+		static constexpr std::uint32_t FILE_MAGIC = 0x43544449; ///< "IDTC" in little endian, marks the start of a log file
+		static constexpr std::uint16_t FILE_VERSION = 1; ///< The version of the file format
+
+		/// @brief Calculates the CRC-32 (IEEE 802.3) of a buffer
+		/// @param[in] data The data to calculate the CRC of
+		/// @param[in] length The number of bytes in data
+		/// @returns The CRC-32 of the data
+		static std::uint32_t calculate_crc32(const std::uint8_t *data, std::size_t length);
+
+		/// @brief Returns the key used to identify a DTC in the replayed state
+		/// @param[in] record The record to get the key of
+		/// @returns A unique key for the SPN and FMI of the record
+		static std::uint32_t get_record_key(const Record &record);
+
+		/// @brief Encodes a record into its location in the file
+		/// @param[in] record The record to encode
+		/// @param[in] index The index of the record in the file, which is also stored in the record
+		/// @param[out] buffer The location of the record in the file, at least RECORD_SIZE bytes long
+		static void encode_record(const Record &record, std::uint32_t index, std::uint8_t *buffer);
+
+		/// @brief Decodes and validates a record from the file
+		/// @param[in] buffer The location of the record in the file
+		/// @param[in] index The index the record is expected to have
+		/// @param[out] record The decoded record
+		/// @returns `true` if the record's CRC and index were valid, otherwise `false`
+		static bool decode_record(const std::uint8_t *buffer, std::uint32_t index, Record &record);
+
+		/// @brief Applies a record to the replayed state of all DTCs
+		/// @param[in] record The record to apply
+		void apply_record(const Record &record);
+
+		/// @brief Writes a new file containing only the latest state of each DTC, and swaps it in for the current file
+		/// @returns `true` if the log was compacted, otherwise `false`
+		bool compact();
+
+		/// @brief Writes a record at the end of the file, compacting first if the file is full
+		/// @param[in] record The record to write
+		/// @returns `true` if the record was written, otherwise `false`
+		bool write_record(const Record &record);
+
+		/// @brief The worker thread's main loop, which writes queued records
+		void worker_thread_function();
+
+		const std::string logFilename; ///< The path of the log file
+		MemoryMappedFile mappedFile; ///< The mapping of the log file
+		std::unordered_map<std::uint32_t, Record> currentState; ///< The latest state of each DTC in the file, keyed by SPN and FMI
+		std::vector<Record> pendingRecords; ///< Records waiting to be written by the worker thread
+		std::vector<Record> writingRecords; ///< The batch of records the worker thread is writing. Swapped with pendingRecords to avoid allocations.
+		mutable std::mutex logMutex; ///< Protects the queue and the counters shared with the worker thread
+		std::condition_variable workerWakeCondition; ///< Wakes the worker thread when records are queued or the log is closed
+		std::condition_variable flushedCondition; ///< Wakes threads waiting in flush() when a batch has been written
+		std::thread *workerThread; ///< The thread that writes records to the file
+		std::uint64_t appendedRecordCount; ///< The number of records queued since the log was opened
+		std::uint64_t flushedRecordCount; ///< The number of queued records that have been written and flushed
+		std::uint32_t recordCapacity; ///< The number of records the current file can hold
+		std::atomic<std::uint32_t> numberOfRecords; ///< The number of records in the current file
+		std::atomic<std::uint32_t> numberOfCompactions; ///< The number of compactions since the log was opened
+		bool stopRequested; ///< Tells the worker thread to exit once the queue is empty
+	};
+} // namespace isobus
+
+#endif // ISOBUS_DIAGNOSTIC_TROUBLE_CODE_LOG_HPP
@@ -0,0 +1,123 @@
+//================================================================================================
+/// @file isobus_freeze_frame_signal_recorder.hpp
+///
+/// @brief Keeps the recent history of a set of SPNs in lock-free ring buffers, so that the
+/// diagnostic protocol can capture the operating conditions when a DTC becomes active.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#ifndef ISOBUS_FREEZE_FRAME_SIGNAL_RECORDER_HPP
+#define ISOBUS_FREEZE_FRAME_SIGNAL_RECORDER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace isobus
+{
+	//================================================================================================
+	/// @class FreezeFrameSignalRecorder
+	///
+	/// @brief Records the values of application selected SPNs, for use in freeze frames (DM4/DM25).
+	/// @details Add each SPN you want in your freeze frames with add_signal() during setup, then call
+	/// record() whenever a new value is known, for example from a PGN callback on the CAN stack's thread.
+	/// Each signal has a small ring of samples with a sequence number per slot, so recording never
+	/// waits for a reader, and reading never waits for a writer. Each signal must only be recorded
+	/// from one thread at a time. Samples older than the history duration are reported as not available.
+	/// Attach the recorder to a DiagnosticProtocol with DiagnosticProtocol::set_freeze_frame_recorder.
+	//================================================================================================
+	class FreezeFrameSignalRecorder
+	{
+	public:
+		/// @brief A single recorded value of a signal
+		struct Sample
+		{
+			std::uint32_t value; ///< The raw value of the SPN
+			std::uint32_t timestamp_ms; ///< When the value was recorded, in milliseconds
+		};
+
+		/// @brief Constructor for a recorder
+		/// @param[in] historyDuration_ms How long a sample stays valid after being recorded, or 0 to keep it valid forever
+		explicit FreezeFrameSignalRecorder(std::uint32_t historyDuration_ms = DEFAULT_HISTORY_DURATION_MS);
+
+		/// @brief Adds a signal to the recorder. Signals appear in freeze frames in the order they were added.
+		/// @note Add all signals before you start recording, this is not thread safe with respect to record()
+		/// @param[in] suspectParameterNumber The SPN of the signal
+		/// @param[in] dataLength The number of bytes the SPN takes up in a freeze frame, 1 to 4
+		/// @returns The index of the new signal to pass to record(), or INVALID_SIGNAL_INDEX if the signal was invalid
+		std::size_t add_signal(std::uint32_t suspectParameterNumber, std::uint8_t dataLength);
+
+		/// @brief Records a new value for a signal. This is wait free and never allocates.
+		/// @param[in] signalIndex The index returned by add_signal
+		/// @param[in] value The raw value of the SPN, which will be sent little endian in freeze frames
+		/// @returns `true` if the value was recorded, `false` if the signal index was invalid
+		bool record(std::size_t signalIndex, std::uint32_t value);
+
+		/// @brief Returns the latest sample of a signal that is still within the history duration
+		/// @param[in] signalIndex The index returned by add_signal
+		/// @param[out] sample The latest sample
+		/// @returns `true` if there was a recent sample, otherwise `false`
+		bool get_latest_sample(std::size_t signalIndex, Sample &sample) const;
+
+		/// @brief Returns the number of signals in the recorder
+		/// @returns The number of signals that have been added
+		std::size_t get_number_of_signals() const;
+
+		/// @brief Returns the SPN of a signal
+		/// @param[in] signalIndex The index returned by add_signal
+		/// @returns The SPN of the signal, or 0xFFFFFFFF if the index is invalid
+		std::uint32_t get_suspect_parameter_number(std::size_t signalIndex) const;
+
+		/// @brief Returns the number of bytes all signals take up in a freeze frame
+		/// @returns The total data length of all signals
+		std::uint16_t get_snapshot_length() const;
+
+		/// @brief Writes the latest value of each signal into a buffer, in the order the signals were added.
+		/// Signals without a recent sample are filled with 0xFF (not available).
+		/// @details This takes time proportional to the number of signals and never allocates, so it is safe to call
+		/// from time critical code. Signals that would not fit entirely in the buffer are left out.
+		/// @param[out] buffer The buffer to write the snapshot into
+		/// @param[in] bufferSize The size of the buffer in bytes
+		/// @returns The number of bytes written into the buffer
+		std::uint16_t capture_snapshot(std::uint8_t *buffer, std::uint16_t bufferSize) const;
+
+		static constexpr std::size_t INVALID_SIGNAL_INDEX = 0xFFFFFFFF; ///< Returned by add_signal when a signal could not be added
+		static constexpr std::uint32_t DEFAULT_HISTORY_DURATION_MS = 10000; ///< By default, samples are valid for 10 seconds
+
+	private:
+		static constexpr std::uint32_t SAMPLES_PER_SIGNAL = 8; ///< The number of samples in each signal's ring. Must be a power of 2.
+		static constexpr std::uint8_t MAX_READ_ATTEMPTS = 4; ///< How many times a reader tries again if a writer overwrote the sample it was reading
+
+		/// @brief One slot in a signal's ring
+		struct Slot
+		{
+			std::atomic<std::uint32_t> sequence; ///< Odd while the slot is being written, otherwise identifies which write the slot holds
+			std::atomic<std::uint32_t> value; ///< The recorded value
+			std::atomic<std::uint32_t> timestamp_ms; ///< When the value was recorded
+		};
+
+		/// @brief The ring of samples and the encoding info for one SPN
+		struct Signal
+		{
+			/// @brief Constructor for a signal with an empty ring
+			/// @param[in] spn The SPN of the signal
+			/// @param[in] length The number of bytes the SPN takes up in a freeze frame
+			Signal(std::uint32_t spn, std::uint8_t length);
+
+			std::array<Slot, SAMPLES_PER_SIGNAL> slots; ///< The ring of recent samples
+			std::atomic<std::uint32_t> writeCount; ///< The number of samples that have been recorded
+			const std::uint32_t suspectParameterNumber; ///< The SPN of the signal
+			const std::uint8_t dataLength; ///< The number of bytes the SPN takes up in a freeze frame
+		};
+
+		std::vector<std::unique_ptr<Signal>> signals; ///< The signals being recorded. Pointers, since atomics can't be moved.
+		const std::uint32_t historyDuration_ms; ///< How long a sample stays valid after being recorded
+		std::uint16_t snapshotLength; ///< The total data length of all signals
+	};
+} // namespace isobus
+
+#endif // ISOBUS_FREEZE_FRAME_SIGNAL_RECORDER_HPP
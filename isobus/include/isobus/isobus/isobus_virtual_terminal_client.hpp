@@ -11,10 +11,20 @@
 
 #include "isobus/isobus/can_internal_control_function.hpp"
 #include "isobus/isobus/can_partnered_control_function.hpp"
+#include "isobus/isobus/can_transmit_data_source.hpp"
+#include "isobus/isobus/isobus_virtual_terminal_client_executor.hpp"
+#include "isobus/isobus/isobus_virtual_terminal_command_coalescer.hpp"
+#include "isobus/isobus/isobus_virtual_terminal_command_pipeline.hpp"
+#include "isobus/isobus/isobus_virtual_terminal_object_pool_index.hpp"
+#include "isobus/isobus/isobus_virtual_terminal_object_pool_manifest.hpp"
 #include "isobus/isobus/isobus_virtual_terminal_objects.hpp"
+#include "isobus/isobus/isobus_virtual_terminal_scaled_pool_cache.hpp"
+#include "isobus/isobus/isobus_virtual_terminal_shadow_state.hpp"
 #include "isobus/utility/processing_flags.hpp"
 
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
@@ -258,6 +268,7 @@ namespace isobus
 		};
 
 		static constexpr std::uint16_t NULL_OBJECT_ID = 0xFFFF; ///< The NULL Object ID, usually drawn as blank space
+		static constexpr std::uint32_t DEFAULT_COMMAND_COALESCING_INTERVAL_MS = 100; ///< The default longest time a coalesced command waits before it is sent
 
 		/// @brief The constructor for a VirtualTerminalClient
 		/// @param[in] partner The VT server control function
@@ -270,8 +281,16 @@ namespace isobus
 		// Setup Functions
 		/// @brief This function starts the state machine. Call this once you have supplied 1 or more object pool and are ready to connect.
 		/// @param[in] spawnThread The client will start a thread to manage itself if this parameter is true. Otherwise you must update it cyclically.
+		/// The thread is a VirtualTerminalClientExecutor of the client's own, so it only runs when the client has something to do.
 		void initialize(bool spawnThread);
 
+		/// @brief Starts the state machine, with the client updated by an executor that can be shared with other clients
+		/// @details The executor updates the client as soon as a message from the VT arrives, a transmit completes,
+		/// or a command is queued, and otherwise when get_time_until_next_update_ms() has passed, so one thread
+		/// can serve several clients without polling them.
+		/// @param[in] sharedExecutor The executor to update the client with, or nullptr to update the client cyclically yourself
+		void initialize(std::shared_ptr<VirtualTerminalClientExecutor> sharedExecutor);
+
 		/// @brief Returns if the client has been initialized
 		/// @note This does not mean that the client is connected to the VT server
 		/// @returns true if the client has been initialized
@@ -1049,6 +1068,19 @@ namespace isobus
 		                     const std::vector<std::uint8_t> *pool,
 		                     std::string version = "");
 
+		/// @brief Assigns an object pool to the client from a data source that is contiguous in memory, like a MemoryMappedFileDataSource.
+		/// @details This is the best way to load large IOP files. The pool is uploaded straight from the mapping, and is never copied into the heap
+		/// unless it needs to be scaled. The client keeps the source alive for as long as the pool is assigned.
+		/// @param[in] poolIndex The index of the pool you are assigning
+		/// @param[in] poolSupportedVTVersion The VT version of the object pool
+		/// @param[in] pool The object pool. Sources that aren't contiguous in memory (whose `get_data` returns nullptr) are rejected.
+		/// @param[in] version An optional version string. The stack will automatically store/load your pool from the VT if this is provided.
+		/// @returns `true` if the pool was assigned, otherwise `false`
+		bool set_object_pool(std::uint8_t poolIndex,
+		                     VTVersion poolSupportedVTVersion,
+		                     std::shared_ptr<TransmitDataSource> pool,
+		                     std::string version = "");
+
 		/// @brief Configures an object pool to be automatically scaled to match the target VT server
 		/// @param[in] poolIndex The index of the pool you want to auto-scale
 		/// @param[in] originalDataMaskDimensions_px The data mask width that your object pool was originally designed for
@@ -1067,11 +1099,141 @@ namespace isobus
 		/// @param[in] value The data callback that will be used to get object pool data to upload.
 		void register_object_pool_data_chunk_callback(std::uint8_t poolIndex, VTVersion poolSupportedVTVersion, std::uint32_t poolTotalSize, DataChunkCallback value);
 
+		/// @brief Returns the index of the objects in one of the assigned object pools
+		/// @details The index is built when the pool is assigned with set_object_pool.
+		/// Pools that use a data chunk callback aren't indexed, since the client doesn't keep them in memory.
+		/// @param[in] poolIndex The index of the pool
+		/// @returns The pool's object index, or nullptr if there is no such pool or it couldn't be indexed
+		const VirtualTerminalObjectPoolIndex *get_object_pool_index(std::uint8_t poolIndex) const;
+
+		/// @brief Sets the cache that auto-scaled object pools are stored in and reused from
+		/// @details Each client starts with its own in-memory cache, so reconnecting to the same VT doesn't scale the pool again.
+		/// Share one cache between clients, or give it a directory, to also reuse scaled pools across clients or application restarts.
+		/// @param[in] cache The cache to use, or nullptr to scale pools on every connection
+		void set_scaled_object_pool_cache(std::shared_ptr<VirtualTerminalScaledPoolCache> cache);
+
+		/// @brief Returns the cache that auto-scaled object pools are stored in
+		/// @returns The scaled object pool cache, or nullptr if caching is disabled
+		std::shared_ptr<VirtualTerminalScaledPoolCache> get_scaled_object_pool_cache() const;
+
+		/// @brief Enables or disables coalescing of change numeric value, change string value, and change attribute commands
+		/// @details When coalescing is enabled those commands are queued instead of being sent right away, and a newer value for the same
+		/// object (and attribute) replaces a queued one, so values that change faster than the VT can show them don't flood the bus.
+		/// Queued commands are sent by update() as soon as the VT has responded to the ones sent before (if flushOnVTResponse is set)
+		/// or once the flush interval has passed since the last flush. Disabling coalescing sends any queued commands on the next update.
+		/// Other commands are not queued, so they can reach the VT before coalesced commands that were sent earlier.
+		/// @param[in] enabled `true` to queue and coalesce commands, `false` to send them right away
+		/// @param[in] flushInterval_ms The longest time queued commands wait before being sent
+		/// @param[in] flushOnVTResponse `true` to also send queued commands as soon as the VT has responded to the previous ones
+		void set_command_coalescing(bool enabled, std::uint32_t flushInterval_ms = DEFAULT_COMMAND_COALESCING_INTERVAL_MS, bool flushOnVTResponse = true);
+
+		/// @brief Returns if change numeric value, change string value, and change attribute commands are being coalesced
+		/// @returns `true` if commands are being coalesced, otherwise `false`
+		bool get_command_coalescing_enabled() const;
+
+		/// @brief Returns the number of commands waiting in the coalescing queue
+		/// @returns The number of queued commands
+		std::size_t get_number_queued_commands() const;
+
+		/// @brief Returns how many commands were never sent because a newer value for the same object replaced them
+		/// @returns The number of coalesced commands
+		std::uint32_t get_number_coalesced_commands() const;
+
+		/// @brief Enables or disables skipping change numeric value, change string value, and change attribute commands
+		/// that wouldn't change anything on the VT
+		/// @details The client keeps a shadow copy of the values the VT has, seeded from the initial values in the object pool
+		/// when it connects and updated by the VT's responses. Commands that would set the value the VT already has are
+		/// reported as sent but not transmitted. Macros that run on the VT can change values without the client knowing,
+		/// so call invalidate_shadow_state() for objects the pool's macros change, or leave this disabled.
+		/// @param[in] enabled `true` to skip commands that wouldn't change anything
+		void set_shadow_state_enabled(bool enabled);
+
+		/// @brief Returns if commands that wouldn't change anything on the VT are skipped
+		/// @returns `true` if redundant commands are skipped, otherwise `false`
+		bool get_shadow_state_enabled() const;
+
+		/// @brief Forgets every value in the shadow state, so the next command for each object is always sent
+		void invalidate_shadow_state();
+
+		/// @brief Forgets the shadow state of one object, so the next command for it is always sent
+		/// @details Use this to bypass the shadow state for a single command, for example to force a value to be redrawn.
+		/// @param[in] objectID The object to forget
+		void invalidate_shadow_state(std::uint16_t objectID);
+
+		/// @brief Sets how long the VT has to respond to a command before the shadow state stops trusting the command's value
+		/// @details Until then, repeating the command is skipped. After that, the command may have been lost, so a repeat is sent.
+		/// Commands that time out or are aborted in the command pipeline are forgotten right away.
+		/// @param[in] value_ms The response timeout in milliseconds
+		void set_shadow_state_response_timeout(std::uint32_t value_ms);
+
+		/// @brief Returns the client's shadow copy of the values the VT has
+		/// @returns The shadow state
+		const VirtualTerminalShadowState &get_shadow_state() const;
+
+		/// @brief Returns how many commands were skipped because they wouldn't have changed anything on the VT
+		/// @returns The number of skipped commands
+		std::uint32_t get_number_suppressed_commands() const;
+
+		/// @brief Sets a file in which to keep a manifest of the object pool stored on the VT, which enables partial re-uploads
+		/// @details After a pool is stored on the VT under its version label, the client saves the label and a hash of every
+		/// uploaded object to this file. When the pool changes, and the VT still has the previous version stored, the client
+		/// loads the previous version and transfers only the objects that are new or changed before ending the object pool,
+		/// then stores the result under the new label and deletes the previous version.
+		/// If the VT rejects the changed objects, the client deletes the pool and uploads all of it instead.
+		/// Objects that were removed from the pool stay in the VT's copy, which is harmless as long as nothing refers to them.
+		/// Version labels must be set on the object pools for this to have any effect.
+		/// @param[in] filename The path of the manifest file, or an empty string to always upload the whole pool
+		void set_object_pool_manifest_file(const std::string &filename);
+
+		/// @brief Returns the file the manifest of the object pool stored on the VT is kept in
+		/// @returns The path of the manifest file, or an empty string if partial re-uploads are disabled
+		std::string get_object_pool_manifest_file() const;
+
+		/// @brief Returns if the object pool was last uploaded by transferring only its changed objects
+		/// @returns `true` if the last upload was partial, `false` if the whole pool was uploaded or it was loaded from a stored version
+		bool get_last_upload_was_partial() const;
+
+		/// @brief Enables or disables sending commands through the flow controlled command pipeline
+		/// @details When the pipeline is enabled, commands the VT responds to are queued in priority lanes and only a limited
+		/// number are sent before the VT has responded to them, so a burst of commands can't overrun a slow VT.
+		/// Commands that change the active mask or soft key mask, or that alert the operator, are sent before value updates.
+		/// The window size, queue size, and response timeout can be tuned through get_command_pipeline().
+		/// Disabling the pipeline doesn't drop commands that are already queued, they are still sent by update().
+		/// @param[in] enabled `true` to queue commands in the pipeline, `false` to send them right away
+		void set_command_pipeline_enabled(bool enabled);
+
+		/// @brief Returns if commands are sent through the flow controlled command pipeline
+		/// @returns `true` if the pipeline is enabled, otherwise `false`
+		bool get_command_pipeline_enabled() const;
+
+		/// @brief Returns the command pipeline, for tuning it or reading its statistics
+		/// @returns The command pipeline
+		VirtualTerminalCommandPipeline &get_command_pipeline();
+
+		/// @brief Sends a command through the command pipeline and reports its result, even if the pipeline isn't enabled
+		/// @details Call one of the send functions from sendFunction, for example:
+		/// `send_command_with_completion([&]() { return client.send_change_active_mask(workingSet, mask); }, Priority::High, callback)`.
+		/// The priority and callback apply to the first command that sendFunction sends. That command skips command coalescing,
+		/// and if the shadow state suppresses it, the callback is called right away with a successful result.
+		/// @param[in] sendFunction A function that calls one of this client's send functions and returns its result
+		/// @param[in] priority The lane to queue the command in
+		/// @param[in] callback Called when the VT responds to the command, or when it times out or is aborted
+		/// @returns `true` if the command was queued, `false` if it was invalid or the VT doesn't respond to that command
+		bool send_command_with_completion(const std::function<bool()> &sendFunction,
+		                                  VirtualTerminalCommandPipeline::Priority priority,
+		                                  VirtualTerminalCommandPipeline::CompletionCallback callback);
+
 		/// @brief Periodic Update Function (worker thread may call this)
 		/// @details This class can spawn a thread, or you can supply your own to run this function.
 		/// To configure that behavior, see the initialize function.
 		void update();
 
+		/// @brief Returns how long the client can wait before update() needs to be called again, if nothing else happens
+		/// @details Incoming VT messages, completed transmits, and queued commands may need an update sooner.
+		/// Applications that update the client from their own loop can use this to sleep instead of polling.
+		/// @returns The time until the next update is needed, in milliseconds, which is 0 if it's needed right away
+		std::uint32_t get_time_until_next_update_ms() const;
+
 	protected:
 		/// @brief The internal state machine state of the VT client
 		enum class StateMachineState : std::uint8_t
@@ -1095,6 +1257,7 @@ namespace isobus
 			SendLoadVersion, ///< Sending the load version command
 			WaitForLoadVersionResponse, ///< Client is waiting for the VT to respond to the "Load Version" command
 			UploadObjectPool, ///< Client is uploading the object pool
+			UploadChangedObjects, ///< Client is uploading only the objects that changed since the version it loaded from the VT
 			SendEndOfObjectPool, ///< Client is sending the end of object pool message
 			WaitForEndOfObjectPoolResponse, ///< Client is waiting for the end of object pool response message
 			Connected, ///< Client is connected to the VT server and the application layer is in control
@@ -1227,12 +1390,16 @@ namespace isobus
 		{
 			const std::uint8_t *objectPoolDataPointer; ///< A pointer to an object pool
 			const std::vector<std::uint8_t> *objectPoolVectorPointer; ///< A pointer to an object pool (vector format)
-			std::vector<std::uint8_t> scaledObjectPool; ///< Stores a copy of a pool to auto-scale in RAM before uploading it
+			std::shared_ptr<TransmitDataSource> objectPoolSource; ///< Keeps a data source (like a memory mapped file) alive while objectPoolDataPointer points into it
+			std::shared_ptr<const std::vector<std::uint8_t>> scaledObjectPool; ///< The auto-scaled copy of the pool that gets uploaded, which may be shared with the scaled pool cache
+			VirtualTerminalObjectPoolIndex objectIndex; ///< Where each object is in the pool, built once when the pool is assigned
 			DataChunkCallback dataCallback; ///< A callback used to get data in chunks as an alternative to loading the whole pool at once
 			std::string versionLabel; ///< An optional version label that will be used to load/store the pool to the VT. 7 character max!
 			std::uint32_t objectPoolSize; ///< The size of the object pool
 			std::uint32_t autoScaleDataMaskOriginalDimension; ///< The original length or width of this object pool's data mask area (in pixels)
 			std::uint32_t autoScaleSoftKeyDesignatorOriginalHeight; ///< The original height of a soft key designator as designed in the pool (in pixels)
+			std::uint64_t poolHash; ///< The hash of the unscaled pool, used to find it in the scaled pool cache
+			bool poolHashValid; ///< Tells if poolHash has been calculated yet
 			VTVersion version; ///< The version of the object pool. Must be the same for all pools!
 			bool useDataCallback; ///< Determines if the client will use callbacks to get the data in chunks.
 			bool uploaded; ///< The upload state of this pool
@@ -1348,6 +1515,10 @@ namespace isobus
 		/// @param[in] value The new state for the state machine
 		void set_state(StateMachineState value);
 
+		/// @brief Records in the network snapshot whether the VT has our object pool's version label stored
+		/// @param[in] stored `true` if the VT has the label stored, `false` if loading it failed
+		void update_snapshot_version_label(bool stored);
+
 		/// @brief Calls all registered callbacks for button events
 		/// @param[in] keyEvent The button event
 		/// @param[in] keyNumber They key number
@@ -1494,9 +1665,58 @@ namespace isobus
 		bool get_any_pool_needs_scaling() const;
 
 		/// @brief Iterates through each object pool and scales each object in the pool automatically
+		/// @details Pools that were already scaled for this VT's geometry are taken from the scaled pool cache.
+		/// The others are scaled in parallel by the calling thread and up to MAX_OBJECT_POOL_SCALING_THREADS - 1 helper threads,
+		/// never more threads than there are pools or cores.
 		/// @returns true if all object pools scaled with no error
 		bool scale_object_pools();
 
+		/// @brief The data callback used to transfer the changed objects of a partial upload
+		/// @param[in] callbackIndex The number of times the callback has been called
+		/// @param[in] bytesOffset The byte offset at which to get the data
+		/// @param[in] numberOfBytesNeeded The number of bytes the protocol needs to send another frame (usually 7)
+		/// @param[out] chunkBuffer A pointer through which the data should be returned to the protocol
+		/// @param[in] parentPointer A context variable that is passed back through the callback
+		/// @returns true if the data was successfully returned via the callback
+		static bool process_internal_changed_objects_upload_callback(std::uint32_t callbackIndex,
+		                                                             std::uint32_t bytesOffset,
+		                                                             std::uint32_t numberOfBytesNeeded,
+		                                                             std::uint8_t *chunkBuffer,
+		                                                             void *parentPointer);
+
+		/// @brief Loads the manifest of the pool stored on the VT, forgetting the state of any earlier partial upload
+		void load_object_pool_manifest();
+
+		/// @brief Returns if a version label on the VT is the one the manifest describes, so it can be the base of a partial upload
+		/// @param[in] label The version label from the VT, padded with spaces to 7 characters
+		/// @returns true if the pools can be uploaded by loading that version and transferring only the changed objects
+		bool get_is_partial_upload_base(const std::string &label) const;
+
+		/// @brief Hashes every object that will be uploaded into a new manifest and, if a partial upload is in progress,
+		/// collects the objects that differ from the manifest of the version loaded from the VT
+		/// @param[out] numberChangedObjects The number of changed objects that were collected
+		/// @returns true if every pool could be read and indexed
+		bool prepare_object_pool_manifest(std::uint32_t &numberChangedObjects);
+
+		/// @brief Saves the manifest of the pool just stored on the VT, and deletes the version a partial upload started from
+		void save_object_pool_manifest();
+
+		/// @brief Abandons a partial upload, deleting the pool on the VT and uploading the whole pool instead
+		void fall_back_to_full_object_pool_upload();
+
+		/// @brief Reads a whole object pool from its data chunk callback, in chunks of OBJECT_POOL_FETCH_CHUNK_SIZE bytes
+		/// @param[in] objectPool The pool to read
+		/// @param[out] poolData The pool that was read
+		/// @returns true if the callback returned every chunk
+		bool read_object_pool_from_callback(const ObjectPoolDataStruct &objectPool, std::vector<std::uint8_t> &poolData);
+
+		/// @brief Scales every object in a copy of an object pool
+		/// @param[in] objectPool The pool's scaling settings
+		/// @param[in,out] poolData The copy of the pool to scale in place
+		/// @param[in] objectIndex An index of the pool, which can have been built from another copy of the same pool
+		/// @returns true if every object was scaled
+		bool scale_object_pool(const ObjectPoolDataStruct &objectPool, std::vector<std::uint8_t> &poolData, const VirtualTerminalObjectPoolIndex &objectIndex);
+
 		/// @brief Returns if the specified object type can be scaled
 		/// @returns true if the object is inherently scalable
 		static bool get_is_object_scalable(VirtualTerminalObjectType type);
@@ -1535,11 +1755,39 @@ namespace isobus
 		/// @returns true if the object was resized, otherwise false
 		bool resize_object(std::uint8_t *buffer, float scaleFactor, VirtualTerminalObjectType type);
 
-		/// @brief The worker thread will execute this function when it runs, if applicable
-		void worker_thread_function();
+		/// @brief Sends a command to the VT, or queues it in the command coalescer or command pipeline if they are enabled,
+		/// or skips it if the shadow state is enabled and shows that the command wouldn't change anything
+		/// @details Inside send_command_with_completion() the command is always queued in the command pipeline.
+		/// @param[in] data The command, starting with its function code
+		/// @param[in] length The length of the command in bytes
+		/// @returns true if the message was sent or queued successfully
+		bool send_command(const std::uint8_t *data, std::uint32_t length);
+
+		/// @brief Queues a command in the command pipeline, and makes the shadow state forget its value if it times out or is aborted
+		/// @param[in] data The command, starting with its function code
+		/// @param[in] length The length of the command in bytes
+		/// @param[in] priority The lane to queue the command in
+		/// @param[in] callback Called when the command finishes, or nullptr
+		/// @returns `true` if the command was queued
+		bool add_to_command_pipeline(const std::uint8_t *data,
+		                             std::uint32_t length,
+		                             VirtualTerminalCommandPipeline::Priority priority,
+		                             VirtualTerminalCommandPipeline::CompletionCallback callback);
+
+		/// @brief Sends queued coalesced commands if the VT is ready for them or the flush interval has passed
+		void update_coalesced_commands();
+
+		/// @brief Sends the command pipeline's queued commands while the VT has room for them
+		void update_command_pipeline();
+
+		/// @brief Makes the client's executor update the client as soon as possible, if it has one
+		void wake_executor();
 
 		static constexpr std::uint32_t VT_STATUS_TIMEOUT_MS = 3000; ///< The max allowable time between VT status messages before its considered offline
 		static constexpr std::uint32_t WORKING_SET_MAINTENANCE_TIMEOUT_MS = 1000; ///< The frequency at which we send the working set maintenance message
+		static constexpr std::uint32_t OBJECT_POOL_FETCH_CHUNK_SIZE = 4096; ///< The number of bytes requested per call to a data chunk callback when reading a pool to scale it
+		static constexpr std::size_t MAX_OBJECT_POOL_SCALING_THREADS = 4; ///< The most threads, including the calling one, used to scale object pools at once
+		static constexpr std::uint32_t POLLING_UPDATE_INTERVAL_MS = 50; ///< How often the client is updated while it's waiting on something that doesn't wake it, like connecting to the VT
 
 		std::shared_ptr<PartneredControlFunction> partnerControlFunction; ///< The partner control function this client will send to
 		std::shared_ptr<InternalControlFunction> myControlFunction; ///< The internal control function the client uses to send from
@@ -1579,8 +1827,10 @@ namespace isobus
 		std::uint32_t stateMachineTimestamp_ms; ///< Timestamp from the last state machine update
 		std::uint32_t lastWorkingSetMaintenanceTimestamp_ms; ///< The timestamp from the last time we sent the maintenance message
 		std::vector<ObjectPoolDataStruct> objectPools; ///< A container to hold all object pools that have been assigned to the interface
+		std::shared_ptr<VirtualTerminalScaledPoolCache> scaledPoolCache; ///< Stores scaled object pools so they can be reused on later connections
 		std::vector<AuxiliaryInputDevice> auxiliaryInputDevices; ///< A container to hold all auxiliary input devices known
-		std::thread *workerThread; ///< The worker thread that updates this interface
+		std::shared_ptr<VirtualTerminalClientExecutor> executor; ///< The executor that updates this client, if any
+		mutable std::mutex executorMutex; ///< Protects the executor pointer, since the CAN stack wakes the executor from its own thread
 		bool firstTimeInState; ///< Stores if the current update cycle is the first time a state machine state has been processed
 		bool initialized; ///< Stores the client initialization state
 		bool sendWorkingSetMaintenenace; ///< Used internally to enable and disable cyclic sending of the maintenance message
@@ -1604,6 +1854,31 @@ namespace isobus
 		DataChunkCallback objectPoolDataCallback; ///< The callback to use to get pool data
 		std::uint32_t objectPoolSize_bytes; ///< Total object pool size aggregate
 		std::uint32_t lastObjectPoolIndex; ///< The last object pool index that was processed
+
+		// Command coalescing
+		VirtualTerminalCommandCoalescer commandCoalescer; ///< Queues change value and attribute commands, keeping only the latest per object
+		std::uint32_t commandCoalescingInterval_ms; ///< The longest time a coalesced command waits before it is sent
+		std::uint32_t lastCoalescedCommandFlushTimestamp_ms; ///< The timestamp of the last time queued commands were sent
+		std::uint32_t numberSuppressedCommands; ///< The number of commands skipped because of the shadow state
+		bool commandCoalescingEnabled; ///< Stores if change value and attribute commands are queued and coalesced
+		bool flushCoalescedCommandsOnResponse; ///< Stores if queued commands are sent as soon as the VT responds to the previous ones
+
+		// Shadow state
+		VirtualTerminalShadowState shadowState; ///< The values the VT has for each object, used to skip commands that don't change anything
+		bool shadowStateEnabled; ///< Stores if commands that don't change anything are skipped
+
+		// Partial object pool upload
+		VirtualTerminalObjectPoolManifest previousManifest; ///< The manifest of the pool stored on the VT, loaded from objectPoolManifestFilename
+		VirtualTerminalObjectPoolManifest uploadManifest; ///< The manifest of the pool being uploaded, saved once it's stored on the VT
+		std::vector<std::uint8_t> partialObjectPoolData; ///< The changed objects transferred by a partial upload
+		std::string objectPoolManifestFilename; ///< The file the manifest is kept in, empty if partial uploads are disabled
+		std::string partialUploadBaseLabel; ///< The version label a partial upload started from, deleted once the new version is stored
+		bool partialUploadInProgress; ///< Stores if the client is uploading only the changed objects
+		bool lastUploadWasPartial; ///< Stores if the last upload transferred only the changed objects
+
+		// Command pipeline
+		VirtualTerminalCommandPipeline commandPipeline; ///< Limits how many commands wait for a response from the VT and reports their results
+		bool commandPipelineEnabled; ///< Stores if commands are queued in the command pipeline
 	};
 
 } // namespace isobus
@@ -0,0 +1,103 @@
+//================================================================================================
+/// @file isobus_virtual_terminal_client_executor.hpp
+///
+/// @brief A thread that updates one or more VT clients when something happens, instead of
+/// polling each of them on a fixed interval.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#ifndef ISOBUS_VIRTUAL_TERMINAL_CLIENT_EXECUTOR_HPP
+#define ISOBUS_VIRTUAL_TERMINAL_CLIENT_EXECUTOR_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace isobus
+{
+	class VirtualTerminalClient;
+
+	//================================================================================================
+	/// @class VirtualTerminalClientExecutor
+	///
+	/// @brief Runs the update function of a set of VT clients on a single thread.
+	/// @details Each client is updated when it is woken, which clients do when a message from the VT arrives,
+	/// when a transmit completes, or when a command is queued, and otherwise when the time the client
+	/// reported from VirtualTerminalClient::get_time_until_next_update_ms() has passed.
+	/// While no client has anything to do, the thread sleeps.
+	///
+	/// Clients add and remove themselves when they are initialized with the executor and terminated.
+	/// A client must be removed before it is destroyed, which VirtualTerminalClient::terminate() does.
+	//================================================================================================
+	class VirtualTerminalClientExecutor
+	{
+	public:
+		/// @brief Constructor, which starts the executor's thread
+		VirtualTerminalClientExecutor();
+
+		/// @brief Destructor, which stops the executor's thread. Clients still added are no longer updated.
+		~VirtualTerminalClientExecutor();
+
+		/// @brief Deleted copy constructor, the executor owns a thread
+		VirtualTerminalClientExecutor(const VirtualTerminalClientExecutor &) = delete;
+
+		/// @brief Deleted assignment operator, the executor owns a thread
+		/// @returns Nothing, the operator is deleted
+		VirtualTerminalClientExecutor &operator=(const VirtualTerminalClientExecutor &) = delete;
+
+		/// @brief Adds a client to be updated by the executor, starting with an update right away
+		/// @param[in] client The client to update
+		void add_client(VirtualTerminalClient *client);
+
+		/// @brief Removes a client from the executor
+		/// @details If the executor is updating the client, this waits for the update to finish, unless it's
+		/// called from within the update itself. After this returns the client won't be updated again.
+		/// @param[in] client The client to remove
+		void remove_client(VirtualTerminalClient *client);
+
+		/// @brief Returns the number of clients the executor updates
+		/// @returns The number of clients
+		std::size_t get_number_clients() const;
+
+		/// @brief Makes the executor update a client as soon as possible
+		/// @param[in] client The client to update
+		void wake(VirtualTerminalClient *client);
+
+		/// @brief Returns the total number of client updates the executor has run
+		/// @returns The number of updates
+		std::uint32_t get_number_updates() const;
+
+	private:
+		/// @brief A client and when it next needs to be updated
+		struct ScheduledClient
+		{
+			VirtualTerminalClient *client; ///< The client
+			std::uint32_t lastUpdateTimestamp_ms; ///< When the client was last updated
+			std::uint32_t updateDelay_ms; ///< How long after the last update the client needs to be updated again
+			bool woken; ///< Stores if the client needs to be updated right away
+		};
+
+		/// @brief The executor's thread, which updates clients as they come due and sleeps in between
+		void worker_thread_function();
+
+		/// @brief Finds a client in the list of scheduled clients. Call with executorMutex locked.
+		/// @param[in] client The client to find
+		/// @returns The client's entry, or nullptr if the client isn't added
+		ScheduledClient *find_client(const VirtualTerminalClient *client);
+
+		std::vector<ScheduledClient> clients; ///< The clients the executor updates
+		std::thread workerThread; ///< The thread that updates the clients
+		std::condition_variable wakeCondition; ///< Wakes the thread when a client is woken or added, or the executor is destroyed
+		mutable std::mutex executorMutex; ///< Protects the list of clients and the wake flags
+		std::mutex updateMutex; ///< Held while clients are being updated, so that removing a client can wait for its update
+		std::uint32_t numberUpdates; ///< The total number of client updates
+		bool wakePending; ///< Stores if any client has been woken since the thread last checked
+		bool shouldTerminate; ///< Stores if the thread should exit
+	};
+} // namespace isobus
+
+#endif // ISOBUS_VIRTUAL_TERMINAL_CLIENT_EXECUTOR_HPP
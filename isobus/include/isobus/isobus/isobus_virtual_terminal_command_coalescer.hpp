@@ -0,0 +1,118 @@
+//================================================================================================
+/// @file isobus_virtual_terminal_command_coalescer.hpp
+///
+/// @brief A queue of pending VT commands that keeps only the latest value for each object,
+/// so that values updated faster than the VT can show them don't flood the bus.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#ifndef ISOBUS_VIRTUAL_TERMINAL_COMMAND_COALESCER_HPP
+#define ISOBUS_VIRTUAL_TERMINAL_COMMAND_COALESCER_HPP
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace isobus
+{
+	//================================================================================================
+	/// @class VirtualTerminalCommandCoalescer
+	///
+	/// @brief Holds change numeric value, change string value, and change attribute commands until they are flushed.
+	/// @details Commands are identified by their function code, object ID, and (for change attribute) attribute ID.
+	/// Adding a command with the same identity as one that is already pending replaces the pending one's value but keeps
+	/// its place in the queue, so commands for different objects are still sent in the order they were first added.
+	/// Only the order of the queued commands is kept. Any command sent without going through the queue, such as a hide/show
+	/// object command, can reach the VT before queued commands that were added earlier, so an application that depends on
+	/// that order must send the earlier commands without coalescing.
+	/// All functions are thread safe.
+	//================================================================================================
+	class VirtualTerminalCommandCoalescer
+	{
+	public:
+		/// @brief A function that sends one command, returning `true` if it was sent
+		using SendFunction = std::function<bool(const std::uint8_t *data, std::uint32_t length)>;
+
+		/// @brief Constructor for an empty queue
+		VirtualTerminalCommandCoalescer();
+
+		/// @brief Returns if a command can be coalesced
+		/// @param[in] data The command, starting with its function code
+		/// @param[in] length The length of the command in bytes
+		/// @returns `true` if the command is a change numeric value, change string value, or change attribute command
+		static bool get_is_coalescable(const std::uint8_t *data, std::uint32_t length);
+
+		/// @brief Adds a command to the queue, replacing any pending command for the same object and attribute
+		/// @param[in] data The command, starting with its function code
+		/// @param[in] length The length of the command in bytes
+		/// @returns `true` if the command was queued, `false` if it can't be coalesced
+		bool add(const std::uint8_t *data, std::uint32_t length);
+
+		/// @brief Sends pending commands in the order they were first added
+		/// @details Stops at the first command that can't be sent, which is kept for the next flush.
+		/// @param[in] sendFunction The function used to send each command
+		/// @returns The number of commands sent
+		std::uint32_t flush(const SendFunction &sendFunction);
+
+		/// @brief Tells the queue that the VT responded to a command, so it no longer counts as waiting for a response
+		/// @details Only responses that match a flushed command's function code, object ID, and (for change attribute) attribute ID
+		/// are counted, so responses to commands that were sent some other way are ignored.
+		/// @param[in] data The response message, starting with its function code
+		/// @param[in] length The length of the response in bytes
+		void process_response(const std::uint8_t *data, std::uint32_t length);
+
+		/// @brief Forgets about any commands that are waiting for a response, for example because the VT timed out
+		void clear_awaiting_response();
+
+		/// @brief Removes all pending commands
+		void clear();
+
+		/// @brief Returns the number of commands waiting to be flushed
+		/// @returns The number of pending commands
+		std::size_t get_number_pending() const;
+
+		/// @brief Returns the number of flushed commands the VT hasn't responded to yet
+		/// @returns The number of commands awaiting a response
+		std::uint32_t get_number_awaiting_response() const;
+
+		/// @brief Returns how many commands were dropped because a newer value replaced them before they were sent
+		/// @returns The number of coalesced commands
+		std::uint32_t get_number_coalesced() const;
+
+	private:
+		static constexpr std::uint8_t CHANGE_NUMERIC_VALUE_COMMAND = 0xA8; ///< The function code of the change numeric value command
+		static constexpr std::uint8_t CHANGE_ATTRIBUTE_COMMAND = 0xAF; ///< The function code of the change attribute command
+		static constexpr std::uint8_t CHANGE_STRING_VALUE_COMMAND = 0xB3; ///< The function code of the change string value command
+
+		/// @brief Returns if a function code is one of the commands that can be coalesced
+		/// @param[in] functionCode The function code to check
+		/// @returns `true` if the function code is change numeric value, change string value, or change attribute
+		static bool get_is_coalescable_function(std::uint8_t functionCode);
+
+		/// @brief Builds the identity of a command from its function code, object ID, and attribute ID
+		/// @param[in] data The command, which must be coalescable
+		/// @returns The command's key
+		static std::uint32_t get_key(const std::uint8_t *data);
+
+		/// @brief Builds the key of the command that a response is for
+		/// @param[in] data The response, which must be for a coalescable command
+		/// @param[in] length The length of the response in bytes
+		/// @param[out] key The key of the command the response is for
+		/// @returns `true` if the response is long enough to hold the object ID, otherwise `false`
+		static bool get_response_key(const std::uint8_t *data, std::uint32_t length, std::uint32_t &key);
+
+		std::unordered_map<std::uint32_t, std::vector<std::uint8_t>> pendingCommands; ///< The latest pending command for each key
+		std::deque<std::uint32_t> pendingOrder; ///< The keys of the pending commands, in the order they were first added
+		std::unordered_map<std::uint32_t, std::uint32_t> awaitingResponses; ///< The number of flushed commands awaiting a response, for each key
+		std::uint32_t numberAwaitingResponse; ///< The number of flushed commands the VT hasn't responded to yet
+		std::uint32_t numberCoalesced; ///< The number of commands replaced by a newer value
+		mutable std::mutex queueMutex; ///< Protects the queue, since the application, worker thread, and CAN stack may all use it
+	};
+} // namespace isobus
+
+#endif // ISOBUS_VIRTUAL_TERMINAL_COMMAND_COALESCER_HPP
@@ -0,0 +1,179 @@
+//================================================================================================
+/// @file isobus_virtual_terminal_command_pipeline.hpp
+///
+/// @brief A flow controlled queue of VT commands, which limits how many commands are waiting
+/// for a response from the VT and reports the result of each command.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#ifndef ISOBUS_VIRTUAL_TERMINAL_COMMAND_PIPELINE_HPP
+#define ISOBUS_VIRTUAL_TERMINAL_COMMAND_PIPELINE_HPP
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace isobus
+{
+	//================================================================================================
+	/// @class VirtualTerminalCommandPipeline
+	///
+	/// @brief Queues VT commands in priority lanes and sends them while fewer than a set number
+	/// of commands are waiting for a response.
+	/// @details Responses are matched to the oldest command in flight with the same function code, since the VT
+	/// processes commands in the order it receives them. When a command's response arrives, or it times out, or the
+	/// pipeline is aborted, the command's completion callback is called with the result and the VT's error code.
+	/// Callbacks are called without any lock held, so they may queue more commands.
+	/// All functions are thread safe.
+	//================================================================================================
+	class VirtualTerminalCommandPipeline
+	{
+	public:
+		/// @brief The priority lanes. Commands in a higher priority lane are always sent first.
+		enum class Priority : std::uint8_t
+		{
+			High = 0, ///< Commands the operator must see right away, like changing the active mask or an alarm's priority
+			Normal = 1, ///< Most commands
+			Low = 2, ///< Frequent value updates, like numeric values, bar graphs, and graphics context drawing
+
+			NumberOfPriorities ///< The number of lanes
+		};
+
+		/// @brief How a command finished
+		enum class Result : std::uint8_t
+		{
+			Success, ///< The VT responded without an error
+			VTError, ///< The VT responded with an error, which is passed to the callback
+			Timeout, ///< The VT didn't respond in time
+			Aborted ///< The command was removed before it finished, for example because the VT disconnected
+		};
+
+		/// @brief Called when a command finishes, with the result and the VT's error code bitfield (0 if there was no response)
+		using CompletionCallback = std::function<void(Result result, std::uint8_t errorCode)>;
+
+		/// @brief A function that sends one command, returning `true` if it was sent
+		using SendFunction = std::function<bool(const std::uint8_t *data, std::uint32_t length)>;
+
+		/// @brief Counters that show how much the pipeline is holding commands back
+		struct Statistics
+		{
+			std::uint32_t numberQueued; ///< The number of commands waiting to be sent
+			std::uint32_t numberInFlight; ///< The number of commands waiting for a response
+			std::uint32_t numberSent; ///< The total number of commands sent
+			std::uint32_t numberSucceeded; ///< The total number of commands the VT accepted
+			std::uint32_t numberVTErrors; ///< The total number of commands the VT responded to with an error
+			std::uint32_t numberTimedOut; ///< The total number of commands the VT didn't respond to in time
+			std::uint32_t numberAborted; ///< The total number of commands removed before they finished
+			std::uint32_t numberRejected; ///< The total number of commands not queued because their lane was full
+			std::uint32_t numberWindowFull; ///< The number of times a queued command waited because the in-flight window was full
+			std::uint32_t numberSendFailures; ///< The number of times a queued command waited because the CAN stack couldn't take it
+			std::uint32_t maximumQueueDepth; ///< The most commands that have been waiting to be sent at once
+			std::uint32_t maximumResponseTime_ms; ///< The longest time the VT has taken to respond to a command
+		};
+
+		/// @brief Constructor for an empty pipeline
+		/// @param[in] maximumInFlight The number of commands that may wait for a response at once
+		explicit VirtualTerminalCommandPipeline(std::uint8_t maximumInFlight = DEFAULT_MAXIMUM_IN_FLIGHT);
+
+		/// @brief Returns if a command's response can be tracked by the pipeline
+		/// @param[in] data The command, starting with its function code
+		/// @param[in] length The length of the command in bytes
+		/// @returns `true` if the VT responds to the command with an error code we know how to read
+		static bool get_is_managed(const std::uint8_t *data, std::uint32_t length);
+
+		/// @brief Returns the lane a command goes into if the application doesn't choose one
+		/// @param[in] functionCode The function code of the command
+		/// @returns The default priority of the command
+		static Priority get_default_priority(std::uint8_t functionCode);
+
+		/// @brief Queues a command
+		/// @param[in] data The command, starting with its function code
+		/// @param[in] length The length of the command in bytes
+		/// @param[in] priority The lane to queue the command in
+		/// @param[in] callback Called when the command finishes, or nullptr
+		/// @returns `true` if the command was queued, `false` if the pipeline can't track it or its lane is full
+		bool add(const std::uint8_t *data, std::uint32_t length, Priority priority, CompletionCallback callback);
+
+		/// @brief Times out commands the VT hasn't responded to, then sends queued commands while the in-flight window has room
+		/// @param[in] sendFunction The function used to send each command
+		void update(const SendFunction &sendFunction);
+
+		/// @brief Processes a message from the VT, completing the command it responds to
+		/// @param[in] data The message, starting with its function code
+		/// @param[in] length The length of the message in bytes
+		/// @returns `true` if the message was the response to a command in flight, otherwise `false`
+		bool process_response(const std::uint8_t *data, std::uint32_t length);
+
+		/// @brief Removes every queued and in-flight command, completing each with Result::Aborted
+		void abort_all();
+
+		/// @brief Sets the number of commands that may wait for a response at once
+		/// @param[in] value The size of the in-flight window, at least 1
+		void set_maximum_in_flight(std::uint8_t value);
+
+		/// @brief Returns the number of commands that may wait for a response at once
+		/// @returns The size of the in-flight window
+		std::uint8_t get_maximum_in_flight() const;
+
+		/// @brief Sets how many commands each lane can hold before new ones are rejected
+		/// @param[in] value The maximum number of commands per lane
+		void set_maximum_queue_size(std::uint32_t value);
+
+		/// @brief Sets how long the VT has to respond to a command
+		/// @param[in] value_ms The response timeout in milliseconds
+		void set_response_timeout(std::uint32_t value_ms);
+
+		/// @brief Returns the counters that show how much the pipeline is holding commands back
+		/// @returns The pipeline's statistics
+		Statistics get_statistics() const;
+
+		static constexpr std::uint8_t DEFAULT_MAXIMUM_IN_FLIGHT = 4; ///< The default size of the in-flight window
+		static constexpr std::uint32_t DEFAULT_MAXIMUM_QUEUE_SIZE = 256; ///< The default number of commands each lane can hold
+		static constexpr std::uint32_t DEFAULT_RESPONSE_TIMEOUT_MS = 3000; ///< The default time the VT has to respond to a command
+
+	private:
+		/// @brief A queued or in-flight command
+		struct Command
+		{
+			std::vector<std::uint8_t> data; ///< The command
+			CompletionCallback callback; ///< Called when the command finishes
+			std::uint32_t sentTimestamp_ms; ///< When the command was sent, if it's in flight
+		};
+
+		/// @brief A finished command whose callback still needs to be called
+		struct Completion
+		{
+			CompletionCallback callback; ///< The callback to call
+			Result result; ///< How the command finished
+			std::uint8_t errorCode; ///< The VT's error code
+		};
+
+		/// @brief Returns where the error code is in the VT's response to a command
+		/// @param[in] functionCode The function code of the command
+		/// @param[out] offset The offset of the error code in the response
+		/// @returns `true` if the command is one the pipeline knows the response of, otherwise `false`
+		static bool get_error_code_offset(std::uint8_t functionCode, std::uint8_t &offset);
+
+		/// @brief Calls the callbacks of finished commands
+		/// @param[in] completions The finished commands
+		static void call_completions(const std::vector<Completion> &completions);
+
+		/// @brief Returns the number of queued commands in all lanes. Call with pipelineMutex locked.
+		/// @returns The number of queued commands
+		std::uint32_t get_number_queued() const;
+
+		std::deque<Command> lanes[static_cast<std::uint8_t>(Priority::NumberOfPriorities)]; ///< The queued commands in each lane
+		std::deque<Command> inFlightCommands; ///< The commands waiting for a response, oldest first
+		Statistics statistics; ///< Counters of what the pipeline has done
+		std::uint32_t maximumQueueSize; ///< The number of commands each lane can hold
+		std::uint32_t responseTimeout_ms; ///< How long the VT has to respond to a command
+		std::uint8_t maximumInFlight; ///< The number of commands that may wait for a response at once
+		mutable std::mutex pipelineMutex; ///< Protects the pipeline, since the application, worker thread, and CAN stack may all use it
+	};
+} // namespace isobus
+
+#endif // ISOBUS_VIRTUAL_TERMINAL_COMMAND_PIPELINE_HPP
@@ -0,0 +1,151 @@
+//================================================================================================
+/// @file isobus_virtual_terminal_object_pool_index.hpp
+///
+/// @brief An index of the objects in a serialized VT object pool, which finds any object
+/// by its ID without scanning the pool.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#ifndef ISOBUS_VIRTUAL_TERMINAL_OBJECT_POOL_INDEX_HPP
+#define ISOBUS_VIRTUAL_TERMINAL_OBJECT_POOL_INDEX_HPP
+
+#include "isobus/isobus/isobus_virtual_terminal_objects.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace isobus
+{
+	//================================================================================================
+	/// @class VirtualTerminalObjectPoolIndex
+	///
+	/// @brief Records where each object in a serialized (IOP format) object pool starts, how long it is, and its type.
+	/// @details The index is built in a single pass over the pool, after which any object can be found by ID in constant time.
+	/// The index doesn't copy the pool, it keeps a pointer to the data it was built from, so that data must stay
+	/// valid and unchanged in length for as long as the typed accessors are used. Changing attribute values in place
+	/// (like scaling does) is fine, since that doesn't move any objects.
+	//================================================================================================
+	class VirtualTerminalObjectPoolIndex
+	{
+	public:
+		/// @brief Where an object is in the pool
+		struct ObjectInfo
+		{
+			std::uint32_t offset; ///< The offset of the object's first byte (its ID) from the start of the pool
+			std::uint32_t length; ///< The total length of the object in bytes
+			std::uint16_t objectID; ///< The ID of the object
+			VirtualTerminalObjectType type; ///< The type of the object
+		};
+
+		/// @brief A reference from one object to an object that isn't in the pool
+		struct InvalidReference
+		{
+			std::uint16_t objectID; ///< The object that has the reference
+			std::uint16_t referencedObjectID; ///< The object ID it refers to, which isn't in the pool
+		};
+
+		/// @brief Constructor for an empty index
+		VirtualTerminalObjectPoolIndex();
+
+		/// @brief Builds the index of a pool, replacing any previous index
+		/// @param[in] poolData The serialized object pool
+		/// @param[in] poolSize The size of the pool in bytes
+		/// @returns `true` if every object in the pool was understood and the pool ends exactly at the end of the last object,
+		/// `false` if the pool is malformed or contains objects we don't know the length of, in which case the index is left empty
+		bool build(const std::uint8_t *poolData, std::uint32_t poolSize);
+
+		/// @brief Empties the index
+		void clear();
+
+		/// @brief Returns if the index has been built
+		/// @returns `true` if build() succeeded since the last clear()
+		bool get_is_valid() const;
+
+		/// @brief Returns the size of the pool the index was built from
+		/// @returns The size of the pool in bytes
+		std::uint32_t get_pool_size() const;
+
+		/// @brief Returns the number of objects in the pool
+		/// @returns The number of objects in the pool
+		std::size_t get_number_objects() const;
+
+		/// @brief Returns an object by its position in the pool, for walking the pool in order
+		/// @param[in] position The position of the object, from 0 to get_number_objects() - 1
+		/// @returns The object at that position, or nullptr if the position is out of range
+		const ObjectInfo *get_object_at_position(std::size_t position) const;
+
+		/// @brief Finds an object by its ID
+		/// @param[in] objectID The ID of the object to find
+		/// @param[out] info Where the object is in the pool, if it was found
+		/// @returns `true` if the object is in the pool, otherwise `false`
+		bool get_object(std::uint16_t objectID, ObjectInfo &info) const;
+
+		/// @brief Returns if an object is in the pool
+		/// @param[in] objectID The ID of the object to check for
+		/// @returns `true` if the object is in the pool, otherwise `false`
+		bool get_object_exists(std::uint16_t objectID) const;
+
+		/// @brief Returns a pointer to an object's serialized data
+		/// @param[in] objectID The ID of the object
+		/// @returns A pointer to the object's first byte, or nullptr if the object isn't in the pool
+		const std::uint8_t *get_object_data(std::uint16_t objectID) const;
+
+		/// @brief Reads a one byte attribute of an object
+		/// @param[in] objectID The ID of the object
+		/// @param[in] attributeOffset The offset of the attribute from the start of the object
+		/// @param[out] value The value of the attribute
+		/// @returns `true` if the object exists and the attribute is inside it, otherwise `false`
+		bool get_uint8_attribute(std::uint16_t objectID, std::uint32_t attributeOffset, std::uint8_t &value) const;
+
+		/// @brief Reads a two byte (little endian) attribute of an object
+		/// @param[in] objectID The ID of the object
+		/// @param[in] attributeOffset The offset of the attribute from the start of the object
+		/// @param[out] value The value of the attribute
+		/// @returns `true` if the object exists and the attribute is inside it, otherwise `false`
+		bool get_uint16_attribute(std::uint16_t objectID, std::uint32_t attributeOffset, std::uint16_t &value) const;
+
+		/// @brief Reads a four byte (little endian) attribute of an object
+		/// @param[in] objectID The ID of the object
+		/// @param[in] attributeOffset The offset of the attribute from the start of the object
+		/// @param[out] value The value of the attribute
+		/// @returns `true` if the object exists and the attribute is inside it, otherwise `false`
+		bool get_uint32_attribute(std::uint16_t objectID, std::uint32_t attributeOffset, std::uint32_t &value) const;
+
+		/// @brief Returns the IDs of the objects an object refers to, such as its children, its font attributes, or its variable
+		/// @details NULL object IDs (0xFFFF) are included, since they are allowed in most places.
+		/// Macro references, and the references of object types that are rarely used in pools (window masks, animations,
+		/// auxiliary objects, external objects, and graphics contexts), are not included.
+		/// @param[in] objectID The ID of the object
+		/// @param[out] references The referenced object IDs, which replace anything already in the vector
+		/// @returns `true` if the object is in the pool, otherwise `false`
+		bool get_referenced_object_ids(std::uint16_t objectID, std::vector<std::uint16_t> &references) const;
+
+		/// @brief Checks that every object reference in the pool is either NULL or points at an object in the pool
+		/// @returns A list of the references that point at missing objects, which is empty if the pool is consistent
+		std::vector<InvalidReference> get_invalid_references() const;
+
+		/// @brief Returns the minimum length that an object of a type could possibly require in bytes
+		/// @param[in] type The VT object type to check
+		/// @returns The minimum number of bytes that the specified object might use, or 0 if the type isn't supported
+		static std::uint32_t get_minimum_object_length(VirtualTerminalObjectType type);
+
+		/// @brief Returns the total number of bytes in the VT object located at the specified memory location
+		/// @param[in] buffer A pointer to the start of the VT object
+		/// @param[in] bytesAvailable How many bytes can be read from buffer. The length fields of the object must be inside this.
+		/// @returns The total number of bytes in the object, or 0 if the object's type isn't supported or its length fields can't be read
+		static std::uint32_t get_object_length(const std::uint8_t *buffer, std::uint32_t bytesAvailable);
+
+		static constexpr std::uint16_t NULL_OBJECT_ID = 0xFFFF; ///< The ID that means "no object"
+
+	private:
+		const std::uint8_t *poolData; ///< The pool the index was built from
+		std::uint32_t poolSize; ///< The size of the pool
+		std::vector<ObjectInfo> objects; ///< Every object in the pool, in the order they are serialized
+		std::unordered_map<std::uint16_t, std::size_t> objectPositions; ///< Finds an object's position in objects by its ID
+	};
+} // namespace isobus
+
+#endif // ISOBUS_VIRTUAL_TERMINAL_OBJECT_POOL_INDEX_HPP
@@ -0,0 +1,107 @@
+//================================================================================================
+/// @file isobus_virtual_terminal_object_pool_manifest.hpp
+///
+/// @brief A list of the objects in a VT object pool and a hash of each one, which is used to
+/// find the objects that changed between two versions of a pool.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#ifndef ISOBUS_VIRTUAL_TERMINAL_OBJECT_POOL_MANIFEST_HPP
+#define ISOBUS_VIRTUAL_TERMINAL_OBJECT_POOL_MANIFEST_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace isobus
+{
+	//================================================================================================
+	/// @class VirtualTerminalObjectPoolManifest
+	///
+	/// @brief Stores the version label a pool was stored on the VT under, and a 64 bit xxHash of each of its objects.
+	/// @details The VT client saves a manifest of each pool it stores on a VT. When the pool later changes, the client
+	/// can load the previous version on the VT and transfer only the objects whose hashes differ from the manifest.
+	/// Manifests can be saved to and loaded from a file, which is checked for corruption when it's loaded.
+	//================================================================================================
+	class VirtualTerminalObjectPoolManifest
+	{
+	public:
+		/// @brief Constructor for an empty manifest
+		VirtualTerminalObjectPoolManifest();
+
+		/// @brief Removes every object and the version label from the manifest
+		void clear();
+
+		/// @brief Sets the version label the pool is stored on the VT under
+		/// @param[in] label The version label
+		void set_version_label(const std::string &label);
+
+		/// @brief Returns the version label the pool is stored on the VT under
+		/// @returns The version label, or an empty string if none is set
+		std::string get_version_label() const;
+
+		/// @brief Adds an object to the manifest, replacing any object with the same ID
+		/// @param[in] objectID The ID of the object
+		/// @param[in] hash The hash of the object's serialized data, from hash_object()
+		void add_object(std::uint16_t objectID, std::uint64_t hash);
+
+		/// @brief Adds every object in a serialized (IOP format) object pool to the manifest
+		/// @param[in] poolData The object pool
+		/// @param[in] poolSize The size of the object pool in bytes
+		/// @returns `true` if every object in the pool was understood and added, otherwise `false`
+		bool add_object_pool(const std::uint8_t *poolData, std::uint32_t poolSize);
+
+		/// @brief Returns the hash of an object in the manifest
+		/// @param[in] objectID The ID of the object
+		/// @param[out] hash The hash of the object, if it's in the manifest
+		/// @returns `true` if the object is in the manifest, otherwise `false`
+		bool get_object_hash(std::uint16_t objectID, std::uint64_t &hash) const;
+
+		/// @brief Returns the number of objects in the manifest
+		/// @returns The number of objects in the manifest
+		std::size_t get_number_objects() const;
+
+		/// @brief Finds the objects in a pool that are new or different from the ones in this manifest
+		/// @details Objects that are in the manifest but no longer in the pool aren't reported,
+		/// since there's no way to remove a single object from a pool stored on a VT.
+		/// @param[in] poolData The new version of the object pool
+		/// @param[in] poolSize The size of the new pool in bytes
+		/// @param[in,out] changedObjects The serialized changed objects, in pool order, are appended to this
+		/// @param[out] numberChangedObjects The number of objects that were appended
+		/// @returns `true` if every object in the pool was understood, otherwise `false`
+		bool get_changed_objects(const std::uint8_t *poolData,
+		                         std::uint32_t poolSize,
+		                         std::vector<std::uint8_t> &changedObjects,
+		                         std::uint32_t &numberChangedObjects) const;
+
+		/// @brief Writes the manifest to a file, replacing any existing file atomically
+		/// @param[in] filename The path of the file to write
+		/// @returns `true` if the file was written, otherwise `false`
+		bool save(const std::string &filename) const;
+
+		/// @brief Replaces the contents of the manifest with a file written by save()
+		/// @param[in] filename The path of the file to read
+		/// @returns `true` if the file exists and isn't corrupted, otherwise `false`, in which case the manifest is left empty
+		bool load(const std::string &filename);
+
+		/// @brief Hashes one serialized object
+		/// @param[in] objectData A pointer to the object's first byte
+		/// @param[in] length The length of the object in bytes
+		/// @returns A 64 bit xxHash of the object
+		static std::uint64_t hash_object(const std::uint8_t *objectData, std::uint32_t length);
+
+	private:
+		static constexpr std::uint32_t FILE_MAGIC = 0x4D505456; ///< "VTPM" in little endian, marks the start of a manifest file
+		static constexpr std::uint16_t FILE_VERSION = 1; ///< The version of the file format
+		static constexpr std::uint32_t HEADER_SIZE = 8; ///< The size of the magic number, version, and reserved bytes
+		static constexpr std::uint32_t ENTRY_SIZE = 10; ///< The size of a serialized object ID and hash
+
+		std::unordered_map<std::uint16_t, std::uint64_t> objectHashes; ///< The hash of each object, by object ID
+		std::string versionLabel; ///< The version label the pool is stored on the VT under
+	};
+} // namespace isobus
+
+#endif // ISOBUS_VIRTUAL_TERMINAL_OBJECT_POOL_MANIFEST_HPP
@@ -0,0 +1,159 @@
+//================================================================================================
+/// @file isobus_virtual_terminal_scaled_pool_cache.hpp
+///
+/// @brief A cache of auto-scaled VT object pools, so that connecting to a VT with the same
+/// geometry as before doesn't need the pool to be scaled again.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#ifndef ISOBUS_VIRTUAL_TERMINAL_SCALED_POOL_CACHE_HPP
+#define ISOBUS_VIRTUAL_TERMINAL_SCALED_POOL_CACHE_HPP
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace isobus
+{
+	//================================================================================================
+	/// @class VirtualTerminalScaledPoolCache
+	///
+	/// @brief Stores scaled object pools keyed by the original pool's content and the geometry they were scaled for.
+	/// @details Entries are kept in memory, up to a maximum number after which the oldest entry is dropped.
+	/// If a directory is set, entries are also written to files there, so that they survive a restart of the application.
+	/// A cache can be shared by several VT clients, and all functions are thread safe.
+	//================================================================================================
+	class VirtualTerminalScaledPoolCache
+	{
+	public:
+		/// @brief Identifies a scaled pool. Two pools with equal keys scale to the same result.
+		struct Key
+		{
+			/// @brief Compares two keys
+			/// @param[in] other The key to compare with
+			/// @returns `true` if every field of the keys is equal
+			bool operator==(const Key &other) const;
+
+			std::uint64_t poolHash; ///< The hash of the unscaled pool, from hash_pool()
+			std::uint32_t poolSize; ///< The size of the unscaled pool in bytes
+			std::uint32_t originalDataMaskDimension; ///< The data mask size the pool was designed for, in pixels
+			std::uint32_t originalSoftKeyDesignatorHeight; ///< The soft key designator height the pool was designed for, in pixels
+			std::uint16_t dataMaskDimension; ///< The VT's data mask size, in pixels
+			std::uint16_t softKeyDesignatorWidth; ///< The VT's soft key designator width, in pixels
+			std::uint8_t smallFontSizes; ///< The VT's supported small font sizes bitfield, which affects how fonts are remapped
+			std::uint8_t largeFontSizes; ///< The VT's supported large font sizes bitfield, which affects how fonts are remapped
+		};
+
+		/// @brief Constructor for an empty cache that only uses memory
+		/// @param[in] maximumEntries The number of scaled pools to keep in memory
+		explicit VirtualTerminalScaledPoolCache(std::size_t maximumEntries = DEFAULT_MAXIMUM_ENTRIES);
+
+		/// @brief Sets a directory in which scaled pools will also be stored as files
+		/// @details The directory must already exist. Files that can't be written or read are treated as cache misses.
+		/// @param[in] path The directory to store files in, or an empty string to only use memory
+		void set_directory(const std::string &path);
+
+		/// @brief Returns the directory that scaled pools are stored in
+		/// @returns The directory, or an empty string if the cache only uses memory
+		std::string get_directory() const;
+
+		/// @brief Looks up a scaled pool, first in memory and then in the cache directory
+		/// @param[in] key The pool and geometry to look up
+		/// @returns The scaled pool, or nullptr if it isn't in the cache
+		std::shared_ptr<const std::vector<std::uint8_t>> find(const Key &key);
+
+		/// @brief Adds a scaled pool to the cache, replacing any pool with the same key
+		/// @param[in] key The pool and geometry that the scaled pool is for
+		/// @param[in] scaledPool The scaled pool
+		void insert(const Key &key, std::shared_ptr<const std::vector<std::uint8_t>> scaledPool);
+
+		/// @brief Returns the path of the file in the cache directory that stores a key's scaled pool
+		/// @param[in] key The key to get the file name of
+		/// @returns The path of the file, which may not exist, or an empty string if no directory is set
+		std::string get_filename(const Key &key) const;
+
+		/// @brief Removes every scaled pool from memory. Files in the cache directory are kept.
+		void clear();
+
+		/// @brief Returns the number of scaled pools in memory
+		/// @returns The number of scaled pools in memory
+		std::size_t get_number_entries() const;
+
+		/// @brief Returns how many times find() returned a scaled pool
+		/// @returns The number of cache hits
+		std::uint32_t get_number_hits() const;
+
+		/// @brief Returns how many times find() didn't return a scaled pool
+		/// @returns The number of cache misses
+		std::uint32_t get_number_misses() const;
+
+		/// @brief Calculates the hash of an object pool that identifies it in a Key
+		/// @param[in] data The object pool
+		/// @param[in] size The size of the object pool in bytes
+		/// @returns A 64 bit xxHash of the pool
+		static std::uint64_t hash_pool(const std::uint8_t *data, std::uint32_t size);
+
+		static constexpr std::size_t DEFAULT_MAXIMUM_ENTRIES = 4; ///< The default number of scaled pools kept in memory
+
+	private:
+		/// @brief Hashes a key so it can be used in an unordered_map
+		struct KeyHasher
+		{
+			/// @brief Hashes a key
+			/// @param[in] key The key to hash
+			/// @returns The hash of the key
+			std::size_t operator()(const Key &key) const;
+		};
+
+		static constexpr std::uint32_t FILE_MAGIC = 0x43535456; ///< "VTSC" in little endian, marks the start of a cache file
+		static constexpr std::uint16_t FILE_VERSION = 2; ///< The version of the file format. Version 1 files used a different hash.
+		static constexpr std::uint32_t KEY_SIZE = 26; ///< The size of a serialized key
+		static constexpr std::uint32_t HEADER_SIZE = 8 + KEY_SIZE + 8; ///< The size of a cache file's header
+
+		/// @brief Serializes a key in little endian order
+		/// @param[in] key The key to serialize
+		/// @param[out] buffer Where to write the key, which must be KEY_SIZE bytes long
+		static void serialize_key(const Key &key, std::uint8_t *buffer);
+
+		/// @brief Builds the path of the file that stores a key's scaled pool
+		/// @param[in] cacheDirectory The directory the file is in
+		/// @param[in] key The key to get the file name of
+		/// @returns The path of the file
+		static std::string make_filename(const std::string &cacheDirectory, const Key &key);
+
+		/// @brief Reads a scaled pool from the cache directory
+		/// @param[in] cacheDirectory The directory to read from
+		/// @param[in] key The key of the scaled pool to read
+		/// @param[out] scaledPool The scaled pool that was read
+		/// @returns `true` if the file exists, is for the key, and isn't corrupted, otherwise `false`
+		static bool read_file(const std::string &cacheDirectory, const Key &key, std::vector<std::uint8_t> &scaledPool);
+
+		/// @brief Writes a scaled pool to the cache directory, replacing any existing file atomically
+		/// @param[in] cacheDirectory The directory to write to
+		/// @param[in] key The key of the scaled pool
+		/// @param[in] scaledPool The scaled pool to write
+		/// @returns `true` if the file was written, otherwise `false`
+		static bool write_file(const std::string &cacheDirectory, const Key &key, const std::vector<std::uint8_t> &scaledPool);
+
+		/// @brief Adds a scaled pool to memory, dropping the oldest entry if the cache is full. Call with cacheMutex locked.
+		/// @param[in] key The key of the scaled pool
+		/// @param[in] scaledPool The scaled pool
+		void insert_in_memory(const Key &key, std::shared_ptr<const std::vector<std::uint8_t>> scaledPool);
+
+		std::unordered_map<Key, std::shared_ptr<const std::vector<std::uint8_t>>, KeyHasher> entries; ///< The scaled pools in memory
+		std::deque<Key> insertionOrder; ///< The keys in entries, oldest first
+		std::string directory; ///< The directory that scaled pools are written to, empty if not used
+		std::size_t maximumEntries; ///< The maximum number of scaled pools kept in memory
+		std::uint32_t numberHits; ///< The number of cache hits
+		std::uint32_t numberMisses; ///< The number of cache misses
+		mutable std::mutex cacheMutex; ///< Protects the cache so it can be shared between clients and threads
+	};
+} // namespace isobus
+
+#endif // ISOBUS_VIRTUAL_TERMINAL_SCALED_POOL_CACHE_HPP
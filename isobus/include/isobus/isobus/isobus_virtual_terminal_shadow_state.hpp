@@ -0,0 +1,171 @@
+//================================================================================================
+/// @file isobus_virtual_terminal_shadow_state.hpp
+///
+/// @brief Tracks the values a VT is showing for each object, so that commands which wouldn't
+/// change anything don't need to be sent.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#ifndef ISOBUS_VIRTUAL_TERMINAL_SHADOW_STATE_HPP
+#define ISOBUS_VIRTUAL_TERMINAL_SHADOW_STATE_HPP
+
+#include "isobus/isobus/isobus_virtual_terminal_object_pool_index.hpp"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace isobus
+{
+	//================================================================================================
+	/// @class VirtualTerminalShadowState
+	///
+	/// @brief A copy of the numeric values, string values, and attributes the VT has for each object.
+	/// @details Values are seeded from the initial values in the object pool, and updated when the VT responds
+	/// successfully to a change numeric value, change string value, or change attribute command, or when the operator
+	/// changes a value on the VT. Values that have been sent but not yet responded to are tracked separately, so that
+	/// repeating a command that is still in flight is also recognized as redundant. A pending value that isn't responded
+	/// to within the response timeout is no longer trusted, since the command may have been lost. A failed command
+	/// forgets the value, so the next command for that object is always sent. All functions are thread safe.
+	//================================================================================================
+	class VirtualTerminalShadowState
+	{
+	public:
+		/// @brief Constructor for an empty shadow state, where every command is assumed to change something
+		VirtualTerminalShadowState();
+
+		/// @brief Adds the initial numeric and string values of the objects in a pool
+		/// @details Attributes aren't seeded, they are only known once they've been changed by a command.
+		/// @param[in] index The index of the pool, which must be valid
+		void seed(const VirtualTerminalObjectPoolIndex &index);
+
+		/// @brief Forgets every value, so every command will be sent
+		void clear();
+
+		/// @brief Forgets every value of one object, so the next command for it will be sent
+		/// @param[in] objectID The object to forget
+		void invalidate(std::uint16_t objectID);
+
+		/// @brief Returns if a command would set a value the VT already has, or is already being sent
+		/// @param[in] data The command, starting with its function code
+		/// @param[in] length The length of the command in bytes
+		/// @returns `true` if the command wouldn't change anything, `false` if it would or if it's not a command we track
+		bool get_is_redundant(const std::uint8_t *data, std::uint32_t length) const;
+
+		/// @brief Records that a command was sent, so its value is known once the VT responds
+		/// @param[in] data The command, starting with its function code
+		/// @param[in] length The length of the command in bytes
+		void process_sent_command(const std::uint8_t *data, std::uint32_t length);
+
+		/// @brief Records that a command was never responded to, for example because it timed out or was aborted
+		/// @details The VT may or may not have the command's value, so the value is forgotten and the next command for it is sent.
+		/// @param[in] data The command, starting with its function code
+		/// @param[in] length The length of the command in bytes
+		void process_failed_command(const std::uint8_t *data, std::uint32_t length);
+
+		/// @brief Processes the VT's response to a change numeric value, change string value, or change attribute command
+		/// @param[in] data The response, starting with its function code
+		/// @param[in] length The length of the response in bytes
+		void process_response(const std::uint8_t *data, std::uint32_t length);
+
+		/// @brief Records a numeric value the operator changed on the VT
+		/// @param[in] objectID The object that changed
+		/// @param[in] value The object's new value
+		void process_vt_numeric_value_change(std::uint16_t objectID, std::uint32_t value);
+
+		/// @brief Records a string value the operator changed on the VT
+		/// @param[in] objectID The object that changed
+		/// @param[in] value The object's new value
+		void process_vt_string_value_change(std::uint16_t objectID, const std::string &value);
+
+		/// @brief Returns the numeric value the VT has for an object
+		/// @param[in] objectID The object to get the value of
+		/// @param[out] value The object's value
+		/// @returns `true` if the value is known, otherwise `false`
+		bool get_numeric_value(std::uint16_t objectID, std::uint32_t &value) const;
+
+		/// @brief Returns the string value the VT has for an object
+		/// @param[in] objectID The object to get the value of
+		/// @param[out] value The object's value
+		/// @returns `true` if the value is known, otherwise `false`
+		bool get_string_value(std::uint16_t objectID, std::string &value) const;
+
+		/// @brief Sets how long the VT has to respond to a command before its value is no longer trusted
+		/// @param[in] value_ms The response timeout in milliseconds
+		void set_response_timeout(std::uint32_t value_ms);
+
+		/// @brief Returns if a command is one whose value is tracked
+		/// @param[in] data The command, starting with its function code
+		/// @param[in] length The length of the command in bytes
+		/// @returns `true` if the command is a change numeric value, change string value, or change attribute command
+		static bool get_is_tracked(const std::uint8_t *data, std::uint32_t length);
+
+		/// @brief Returns the value the VT has for an object's attribute
+		/// @param[in] objectID The object to get the attribute of
+		/// @param[in] attributeID The attribute ID
+		/// @param[out] value The attribute's value
+		/// @returns `true` if the value is known, otherwise `false`
+		bool get_attribute_value(std::uint16_t objectID, std::uint8_t attributeID, std::uint32_t &value) const;
+
+		static constexpr std::uint32_t DEFAULT_RESPONSE_TIMEOUT_MS = 3000; ///< The default time the VT has to respond to a command
+
+	private:
+		/// @brief A numeric value or attribute that was sent but not yet responded to
+		struct PendingValue
+		{
+			std::uint32_t value; ///< The value that was sent
+			std::uint32_t timestamp_ms; ///< When the value was sent
+		};
+
+		/// @brief A string value that was sent but not yet responded to
+		struct PendingString
+		{
+			std::string value; ///< The value that was sent
+			std::uint32_t timestamp_ms; ///< When the value was sent
+		};
+
+		static constexpr std::uint8_t CHANGE_NUMERIC_VALUE_COMMAND = 0xA8; ///< The function code of the change numeric value command
+		static constexpr std::uint8_t CHANGE_ATTRIBUTE_COMMAND = 0xAF; ///< The function code of the change attribute command
+		static constexpr std::uint8_t CHANGE_STRING_VALUE_COMMAND = 0xB3; ///< The function code of the change string value command
+
+		/// @brief Builds the key of a numeric value or attribute
+		/// @param[in] functionCode The function code of the command that changes the value
+		/// @param[in] objectID The object ID
+		/// @param[in] attributeID The attribute ID, or 0 for a numeric value
+		/// @returns The key
+		static std::uint32_t get_key(std::uint8_t functionCode, std::uint16_t objectID, std::uint8_t attributeID);
+
+		/// @brief Reads a little endian 32 bit value from a message
+		/// @param[in] data The first byte of the value
+		/// @returns The value
+		static std::uint32_t read_uint32(const std::uint8_t *data);
+
+		/// @brief Looks up a confirmed numeric value or attribute
+		/// @param[in] key The key of the value
+		/// @param[out] value The value
+		/// @returns `true` if the value is known, otherwise `false`
+		bool get_confirmed_value(std::uint32_t key, std::uint32_t &value) const;
+
+		/// @brief Seeds the numeric value of one object. Call with stateMutex locked.
+		/// @param[in] index The index of the pool
+		/// @param[in] info The object to seed
+		void seed_numeric_value(const VirtualTerminalObjectPoolIndex &index, const VirtualTerminalObjectPoolIndex::ObjectInfo &info);
+
+		/// @brief Seeds the string value of one object. Call with stateMutex locked.
+		/// @param[in] index The index of the pool
+		/// @param[in] info The object to seed
+		void seed_string_value(const VirtualTerminalObjectPoolIndex &index, const VirtualTerminalObjectPoolIndex::ObjectInfo &info);
+
+		std::unordered_map<std::uint32_t, std::uint32_t> confirmedValues; ///< Numeric values and attributes the VT has
+		std::unordered_map<std::uint32_t, PendingValue> pendingValues; ///< Numeric values and attributes sent but not yet responded to
+		std::unordered_map<std::uint16_t, std::string> confirmedStrings; ///< String values the VT has
+		std::unordered_map<std::uint16_t, PendingString> pendingStrings; ///< String values sent but not yet responded to
+		std::uint32_t responseTimeout_ms; ///< How long a pending value is trusted for
+		mutable std::mutex stateMutex; ///< Protects the state, since the application and CAN stack may use it from different threads
+	};
+} // namespace isobus
+
+#endif // ISOBUS_VIRTUAL_TERMINAL_SHADOW_STATE_HPP
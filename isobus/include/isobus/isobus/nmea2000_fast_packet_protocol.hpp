@@ -30,7 +30,11 @@
 #include "isobus/isobus/can_managed_message.hpp"
 #include "isobus/isobus/can_protocol.hpp"
 
+#include <list>
+#include <map>
 #include <mutex>
+#include <unordered_map>
+#include <utility>
 
 namespace isobus
 {
@@ -60,7 +64,8 @@ namespace isobus
 		/// @brief Used to send CAN messages using fast packet
 		/// @details You have to use this function instead of the network manager
 		/// because otherwise the CAN stack has no way of knowing to send your message
-		/// with FP instead of TP.
+		/// with FP instead of TP. Broadcasts are rejected while a DM13 has suspended broadcasts,
+		/// see CANNetworkManager::get_broadcasts_suspended.
 		/// @param[in] parameterGroupNumber The PGN of the message
 		/// @param[in] data The data to be sent
 		/// @param[in] messageLength The length of the data to be sent
@@ -115,14 +120,18 @@ namespace isobus
 			DataChunkCallback frameChunkCallback; ///< A callback that might be used to get chunks of data to send
 			void *parent; ///< A generic context variable that helps identify what object callbacks are destined for. Can be nullptr
 			std::uint32_t timestamp_ms; ///< A timestamp used to track session timeouts
+			std::uint64_t lastFrameTimestamp_us; ///< When the last frame of a Tx session was sent, used to pace frames
 			std::uint16_t lastPacketNumber; ///< The last processed sequence number for this set of packets
 			std::uint8_t packetCount; ///< The total number of packets to receive or send in this session
 			std::uint8_t processedPacketsThisSession; ///< The total processed packet count for the whole session so far
 			std::uint8_t sequenceNumber; ///< The sequence number for this PGN
+			bool transmitFailed; ///< Set if a Tx session could not get its data and needs to be aborted
 			const Direction sessionDirection; ///< Represents Tx or Rx session
 		};
 
 		/// @brief A structure for keeping track of past sessions so we can resume with the right session number
+		/// @details History entries are kept in least recently used order, and the oldest entry is dropped
+		/// once there are more than MAX_SESSION_HISTORY_SIZE of them.
 		struct FastPacketHistory
 		{
 			NAME isoName; ///< The ISO name of the internal control function used in a session
@@ -130,6 +139,25 @@ namespace isobus
 			std::uint8_t sequenceNumber; ///< The sequence number to use in the next matching session
 		};
 
+		/// @brief The key used to look up a session history entry, made of the NAME and PGN of the session
+		using FastPacketHistoryKey = std::pair<std::uint64_t, std::uint32_t>;
+
+		/// @brief Builds the key used to look up an Rx session in the Rx session index
+		/// @details Rx sessions are indexed by sequence number as well so that a device can
+		/// interleave two transmissions of the same PGN without them corrupting each other.
+		/// @param[in] canPortIndex The CAN channel index for the session
+		/// @param[in] sourceAddress The address of the device sending the message
+		/// @param[in] parameterGroupNumber The PGN of the message
+		/// @param[in] sequenceNumber The fast packet sequence number of the message
+		/// @returns A key that uniquely identifies the Rx session
+		static std::uint64_t get_rx_session_key(std::uint8_t canPortIndex, std::uint8_t sourceAddress, std::uint32_t parameterGroupNumber, std::uint8_t sequenceNumber);
+
+		/// @brief Returns how many frames follow the first frame of a message
+		/// @details The first frame carries 6 bytes of the message and every other frame carries 7
+		/// @param[in] messageLength The length of the message in bytes
+		/// @returns The number of frames after the first one
+		static std::uint8_t get_number_frames_after_first(std::uint32_t messageLength);
+
 		/// @brief Adds a session's info to the history so that we can continue the sequence number later
 		/// @param[in] session The session to add to the history
 		void add_session_history(FastPacketProtocolSession *session);
@@ -144,7 +172,7 @@ namespace isobus
 		/// @returns The new sequence number to use
 		std::uint8_t get_new_sequence_number(FastPacketProtocolSession *session);
 
-		/// @brief Returns a session that matches the parameters, if one exists
+		/// @brief Returns a Tx session that matches the parameters, if one exists
 		/// @param[in,out] returnedSession The returned session
 		/// @param[in] parameterGroupNumber The PGN
 		/// @param[in] source The session source control function
@@ -185,7 +213,20 @@ namespace isobus
 		                               void *parentPointer,
 		                               DataChunkCallback frameChunkCallback) override;
 
+		/// @brief Fills in the next frame to send for a Tx session
+		/// @param[in] session The Tx session to get the frame for
+		/// @param[out] dataBuffer The 8 byte buffer to fill with the frame
+		/// @returns `true` if the frame was built, `false` if the session's data chunk callback failed
+		bool get_transmit_frame(FastPacketProtocolSession *session, std::uint8_t *dataBuffer);
+
+		/// @brief Sends as many frames as it can from the active Tx sessions
+		/// @details Frames are sent back to back until every session is done, the hardware
+		/// stops accepting frames, or the remaining sessions are waiting on their minimum frame gap.
+		/// Higher priority sessions go first, and sessions with equal priority are interleaved.
+		void schedule_transmit_frames();
+
 		/// @brief Updates in-progress sessions
+		/// @details Handles timeouts for all sessions, and closes Tx sessions that are finished
 		/// @param[in] session The session to process
 		void update_state_machine(FastPacketProtocolSession *session);
 
@@ -197,10 +238,13 @@ namespace isobus
 		static constexpr std::uint8_t SEQUENCE_NUMBER_BIT_MASK = 0x07; ///< Bit mask for masking out the sequence number bits
 		static constexpr std::uint8_t SEQUENCE_NUMBER_BIT_OFFSET = 0x05; ///< The bit offset into the first byte of data to get the seq number
 		static constexpr std::uint8_t PROTOCOL_BYTES_PER_FRAME = 7; ///< The number of payload bytes per frame for all but the first message, which has 6
+		static constexpr std::size_t MAX_SESSION_HISTORY_SIZE = 64; ///< The maximum number of NAME/PGN pairs to remember sequence numbers for
 
-		std::vector<FastPacketProtocolSession *> activeSessions; ///< A list of all active TP sessions
-		std::vector<FastPacketHistory> sessionHistory; ///< Used to keep track of sequence numbers for future sessions
-		std::vector<ParameterGroupNumberCallbackData> parameterGroupNumberCallbacks; ///< A list of all parameter group number callbacks that will be parsed as fast packet messages
+		std::vector<FastPacketProtocolSession *> activeSessions; ///< A list of all active Tx sessions
+		std::unordered_map<std::uint64_t, FastPacketProtocolSession *> activeRxSessions; ///< All active Rx sessions, indexed by get_rx_session_key. Only accessed from the stack's update thread.
+		std::list<FastPacketHistory> sessionHistory; ///< Used to keep track of sequence numbers for future sessions, most recently used first
+		std::map<FastPacketHistoryKey, std::list<FastPacketHistory>::iterator> sessionHistoryIndex; ///< Looks up entries in the session history by NAME and PGN
+		std::unordered_map<std::uint32_t, std::vector<ParameterGroupNumberCallbackData>> parameterGroupNumberCallbacks; ///< All parameter group number callbacks that will be parsed as fast packet messages, indexed by PGN
 		std::mutex sessionMutex; ///< A mutex to lock the sessions list in case someone starts a Tx while the stack is processing sessions
 	};
 
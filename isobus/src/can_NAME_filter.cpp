@@ -95,4 +95,95 @@ namespace isobus
 		return retVal;
 	}
 
+	bool NAMEFilter::get_name_mask(std::uint64_t &mask, std::uint64_t &matchValue) const
+	{
+		std::uint64_t componentMask = 0;
+		std::uint8_t componentShift = 0;
+		std::uint32_t componentValue = value;
+		bool retVal = true;
+
+		switch (parameter)
+		{
+			case NAME::NAMEParameters::IdentityNumber:
+			{
+				componentMask = 0x1FFFFF;
+				componentShift = 0;
+			}
+			break;
+
+			case NAME::NAMEParameters::ManufacturerCode:
+			{
+				componentMask = 0x7FF;
+				componentShift = 21;
+			}
+			break;
+
+			case NAME::NAMEParameters::EcuInstance:
+			{
+				componentMask = 0x07;
+				componentShift = 32;
+			}
+			break;
+
+			case NAME::NAMEParameters::FunctionInstance:
+			{
+				componentMask = 0x1F;
+				componentShift = 35;
+			}
+			break;
+
+			case NAME::NAMEParameters::FunctionCode:
+			{
+				componentMask = 0xFF;
+				componentShift = 40;
+			}
+			break;
+
+			case NAME::NAMEParameters::DeviceClass:
+			{
+				componentMask = 0x7F;
+				componentShift = 49;
+			}
+			break;
+
+			case NAME::NAMEParameters::DeviceClassInstance:
+			{
+				componentMask = 0x0F;
+				componentShift = 56;
+			}
+			break;
+
+			case NAME::NAMEParameters::IndustryGroup:
+			{
+				componentMask = 0x07;
+				componentShift = 60;
+			}
+			break;
+
+			case NAME::NAMEParameters::ArbitraryAddressCapable:
+			{
+				componentMask = 0x01;
+				componentShift = 63;
+				componentValue = (0 != value) ? 1 : 0;
+			}
+			break;
+
+			default:
+			{
+				retVal = false;
+			}
+			break;
+		}
+
+		// A value that doesn't fit in the component can never be equal to it
+		if (componentValue > componentMask)
+		{
+			retVal = false;
+		}
+
+		mask = componentMask << componentShift;
+		matchValue = static_cast<std::uint64_t>(componentValue) << componentShift;
+		return retVal;
+	}
+
 } // namespace isobus
\ No newline at end of file
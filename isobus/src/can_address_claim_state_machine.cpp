@@ -12,12 +12,16 @@
 #include "isobus/isobus/can_network_manager.hpp"
 #include "isobus/utility/system_timing.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <limits>
 #include <random>
 
 namespace isobus
 {
+	constexpr std::uint32_t AddressClaimStateMachine::ADDRESS_CONTENTION_TIME_MS;
+	std::array<AddressClaimStateMachine::CoordinatedClaim, CAN_PORT_MAXIMUM> AddressClaimStateMachine::coordinatedClaims = {};
+
 	AddressClaimStateMachine::AddressClaimStateMachine(std::uint8_t preferredAddressValue, NAME ControlFunctionNAME, std::uint8_t portIndex) :
 	  m_isoname(ControlFunctionNAME),
 	  m_currentState(State::None),
@@ -58,6 +62,19 @@ namespace isobus
 		return m_enabled;
 	}
 
+	bool AddressClaimStateMachine::set_preferred_address(std::uint8_t address)
+	{
+		bool retVal = false;
+
+		if ((State::None == get_current_state()) &&
+		    (address < NULL_CAN_ADDRESS))
+		{
+			m_preferredAddress = address;
+			retVal = true;
+		}
+		return retVal;
+	}
+
 	std::uint8_t AddressClaimStateMachine::get_claimed_address() const
 	{
 		return m_claimedAddress;
@@ -99,9 +116,7 @@ namespace isobus
 
 				case State::WaitForRequestContentionPeriod:
 				{
-					const std::uint32_t addressContentionTime_ms = 250;
-
-					if (SystemTiming::time_expired_ms(m_timestamp_ms, addressContentionTime_ms + m_randomClaimDelay_ms))
+					if (SystemTiming::time_expired_ms(m_timestamp_ms, ADDRESS_CONTENTION_TIME_MS + m_randomClaimDelay_ms))
 					{
 						ControlFunction *deviceAtOurPreferredAddress = CANNetworkManager::CANNetwork.get_control_function(m_portIndex, m_preferredAddress, {});
 						// Time to find a free address
@@ -201,6 +216,167 @@ namespace isobus
 		}
 	}
 
+	void AddressClaimStateMachine::update_coordinated(std::uint8_t portIndex, const std::vector<AddressClaimStateMachine *> &stateMachines, CANLibBadge<InternalControlFunction>)
+	{
+		if (portIndex < CAN_PORT_MAXIMUM)
+		{
+			CoordinatedClaim &portClaim = coordinatedClaims[portIndex];
+			std::vector<AddressClaimStateMachine *> waitingForRequest;
+			std::vector<AddressClaimStateMachine *> readyToResolve;
+
+			for (auto stateMachine : stateMachines)
+			{
+				if (!stateMachine->get_enabled())
+				{
+					stateMachine->set_current_state(State::None);
+				}
+				else
+				{
+					switch (stateMachine->get_current_state())
+					{
+						case State::None:
+						case State::WaitForClaim:
+						case State::SendRequestForClaim:
+						{
+							if (portClaim.requestSent)
+							{
+								// A request is already out, so this one can wait for the same claims as everyone else
+								stateMachine->m_timestamp_ms = portClaim.timestamp_ms;
+								stateMachine->set_current_state(State::WaitForRequestContentionPeriod);
+							}
+							else
+							{
+								stateMachine->set_current_state(State::WaitForClaim);
+								waitingForRequest.push_back(stateMachine);
+							}
+						}
+						break;
+
+						case State::WaitForRequestContentionPeriod:
+						{
+							// Without a shared request out, wait out this state machine's own contention period like update() does
+							if ((portClaim.requestSent) ||
+							    (SystemTiming::time_expired_ms(stateMachine->m_timestamp_ms, ADDRESS_CONTENTION_TIME_MS + stateMachine->m_randomClaimDelay_ms)))
+							{
+								readyToResolve.push_back(stateMachine);
+							}
+						}
+						break;
+
+						default:
+						{
+							stateMachine->update();
+						}
+						break;
+					}
+				}
+			}
+
+			if ((!readyToResolve.empty()) &&
+			    ((!portClaim.requestSent) ||
+			     (SystemTiming::time_expired_ms(portClaim.timestamp_ms, ADDRESS_CONTENTION_TIME_MS))))
+			{
+				portClaim.requestSent = false;
+				resolve_coordinated_claims(portIndex, readyToResolve);
+			}
+
+			if (!waitingForRequest.empty())
+			{
+				if (!portClaim.waitingForDelay)
+				{
+					portClaim.waitingForDelay = true;
+					portClaim.timestamp_ms = SystemTiming::get_timestamp_ms();
+				}
+				else if ((SystemTiming::time_expired_ms(portClaim.timestamp_ms, waitingForRequest.front()->m_randomClaimDelay_ms)) &&
+				         (waitingForRequest.front()->send_request_to_claim()))
+				{
+					portClaim.waitingForDelay = false;
+					portClaim.requestSent = true;
+					portClaim.timestamp_ms = SystemTiming::get_timestamp_ms();
+
+					for (auto stateMachine : waitingForRequest)
+					{
+						stateMachine->m_timestamp_ms = portClaim.timestamp_ms;
+						stateMachine->set_current_state(State::WaitForRequestContentionPeriod);
+					}
+				}
+			}
+		}
+	}
+
+	void AddressClaimStateMachine::resolve_coordinated_claims(std::uint8_t portIndex, std::vector<AddressClaimStateMachine *> &stateMachines)
+	{
+		std::array<bool, NULL_CAN_ADDRESS> claimedThisPass = {};
+
+		// Lower NAMEs win contention, so let them pick first
+		std::sort(stateMachines.begin(), stateMachines.end(), [](const AddressClaimStateMachine *first, const AddressClaimStateMachine *second) {
+			return first->m_isoname.get_full_name() < second->m_isoname.get_full_name();
+		});
+
+		for (auto stateMachine : stateMachines)
+		{
+			const std::uint64_t ourNAME = stateMachine->m_isoname.get_full_name();
+			const std::uint8_t preferredAddress = stateMachine->m_preferredAddress;
+			const ControlFunction *deviceAtOurPreferredAddress = CANNetworkManager::CANNetwork.get_control_function(portIndex, preferredAddress, {});
+			bool preferredAddressFree = false;
+			bool weWinPreferredAddress = false;
+
+			if (claimedThisPass[preferredAddress])
+			{
+				// Taken by one of our own state machines with a lower NAME
+			}
+			else if ((nullptr == deviceAtOurPreferredAddress) ||
+			         (deviceAtOurPreferredAddress->get_NAME().get_full_name() == ourNAME))
+			{
+				preferredAddressFree = true;
+			}
+			else
+			{
+				weWinPreferredAddress = (deviceAtOurPreferredAddress->get_NAME().get_full_name() > ourNAME);
+			}
+
+			if ((preferredAddressFree) || (weWinPreferredAddress))
+			{
+				// If someone with a higher NAME is there, our claim makes them move
+				if (stateMachine->send_address_claim(preferredAddress))
+				{
+					claimedThisPass[preferredAddress] = true;
+					stateMachine->set_current_state(State::AddressClaimingComplete);
+				}
+				else
+				{
+					stateMachine->set_current_state(State::None);
+				}
+			}
+			else if (!stateMachine->m_isoname.get_arbitrary_address_capable())
+			{
+				stateMachine->set_current_state(State::UnableToClaim);
+			}
+			else
+			{
+				bool addressFound = false;
+
+				for (std::uint8_t i = 128; i <= 247; i++)
+				{
+					if ((!claimedThisPass[i]) &&
+					    (nullptr == CANNetworkManager::CANNetwork.get_control_function(portIndex, i, {})) &&
+					    (stateMachine->send_address_claim(i)))
+					{
+						addressFound = true;
+						claimedThisPass[i] = true;
+						stateMachine->set_current_state(State::AddressClaimingComplete);
+						break;
+					}
+				}
+
+				if (!addressFound)
+				{
+					stateMachine->set_current_state(State::UnableToClaim);
+				}
+			}
+		}
+	}
+
 	void AddressClaimStateMachine::process_rx_message(CANMessage *message, void *parentPointer)
 	{
 		if ((nullptr != parentPointer) &&
@@ -250,6 +426,7 @@ namespace isobus
 							if (NAMEClaimed != parent->m_isoname.get_full_name())
 							{
 								// Wait for things to shake out a bit, then claim a new address.
+								parent->m_timestamp_ms = SystemTiming::get_timestamp_ms();
 								parent->set_current_state(State::WaitForRequestContentionPeriod);
 							}
 						}
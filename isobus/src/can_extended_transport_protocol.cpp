@@ -17,6 +17,7 @@
 #include "isobus/utility/to_string.hpp"
 
 #include <algorithm>
+#include <cstring>
 
 namespace isobus
 {
@@ -25,10 +26,13 @@ namespace isobus
 	  sessionMessage(canPortIndex),
 	  sessionCompleteCallback(nullptr),
 	  frameChunkCallback(nullptr),
+	  windowBufferOffset(0),
+	  parent(nullptr),
 	  timestamp_ms(0),
 	  lastPacketNumber(0),
 	  packetCount(0),
 	  processedPacketsThisSession(0),
+	  retransmitRequests(0),
 	  sessionDirection(sessionDirection)
 	{
 	}
@@ -122,10 +126,36 @@ namespace isobus
 						case EXTENDED_CLEAR_TO_SEND_MULTIPLEXOR:
 						{
 							const std::uint8_t packetsToBeSent = data[1];
+							const std::uint32_t nextPacketNumber = (static_cast<std::uint32_t>(data[2]) | (static_cast<std::uint32_t>(data[3]) << 8) | (static_cast<std::uint32_t>(data[4]) << 16));
 
 							if (get_session(session, message->get_destination_control_function(), message->get_source_control_function(), pgn))
 							{
-								if (StateMachineState::WaitForClearToSend == session->state)
+								if (((StateMachineState::WaitForClearToSend == session->state) ||
+								     (StateMachineState::TxDataSession == session->state) ||
+								     (StateMachineState::WaitForEndOfMessageAcknowledge == session->state)) &&
+								    (0 != CANNetworkConfiguration::get_max_number_transport_protocol_retransmit_requests()) &&
+								    (0 != packetsToBeSent) &&
+								    (0 != nextPacketNumber) &&
+								    (nextPacketNumber <= session->processedPacketsThisSession))
+								{
+									// The receiver is asking us to go back and resend some packets
+									if (session->retransmitRequests < CANNetworkConfiguration::get_max_number_transport_protocol_retransmit_requests())
+									{
+										CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[ETP]: Retransmitting to address " + isobus::to_string(static_cast<int>(message->get_source_control_function()->get_address())) + " from packet " + isobus::to_string(nextPacketNumber));
+										session->retransmitRequests++;
+										session->processedPacketsThisSession = (nextPacketNumber - 1);
+										session->packetCount = packetsToBeSent;
+										session->lastPacketNumber = 0;
+										set_state(session, StateMachineState::TxDataSession);
+									}
+									else
+									{
+										CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[ETP]: Sent abort to address " + isobus::to_string(static_cast<int>(message->get_source_control_function()->get_address())) + " retransmit request limit reached");
+										abort_session(session, ConnectionAbortReason::MaximumRetransmitRequestLimitReached);
+										close_session(session, false);
+									}
+								}
+								else if (StateMachineState::WaitForClearToSend == session->state)
 								{
 									session->packetCount = packetsToBeSent;
 									session->timestamp_ms = SystemTiming::get_timestamp_ms();
@@ -288,27 +318,49 @@ namespace isobus
 
 				if ((CAN_DATA_LENGTH == message->get_data_length()) &&
 				    (get_session(tempSession, message->get_source_control_function(), message->get_destination_control_function())) &&
-				    (StateMachineState::RxDataSession == tempSession->state) &&
-				    (messageData[SEQUENCE_NUMBER_DATA_INDEX] == (tempSession->lastPacketNumber + 1)))
+				    (StateMachineState::RxDataSession == tempSession->state))
 				{
-					for (std::uint8_t i = SEQUENCE_NUMBER_DATA_INDEX; i < PROTOCOL_BYTES_PER_FRAME; i++)
+					if (messageData[SEQUENCE_NUMBER_DATA_INDEX] == (tempSession->lastPacketNumber + 1))
 					{
-						std::uint32_t currentDataIndex = (PROTOCOL_BYTES_PER_FRAME * tempSession->processedPacketsThisSession) + i;
-						tempSession->sessionMessage.set_data(messageData[1 + SEQUENCE_NUMBER_DATA_INDEX + i], currentDataIndex);
-					}
-					tempSession->lastPacketNumber++;
-					tempSession->processedPacketsThisSession++;
-					if ((tempSession->processedPacketsThisSession * PROTOCOL_BYTES_PER_FRAME) >= tempSession->sessionMessage.get_data_length())
-					{
-						if (nullptr != tempSession->sessionMessage.get_destination_control_function())
+						for (std::uint8_t i = SEQUENCE_NUMBER_DATA_INDEX; i < PROTOCOL_BYTES_PER_FRAME; i++)
 						{
-							send_end_of_session_acknowledgement(tempSession);
+							std::uint32_t currentDataIndex = (PROTOCOL_BYTES_PER_FRAME * tempSession->processedPacketsThisSession) + i;
+							tempSession->sessionMessage.set_data(messageData[1 + SEQUENCE_NUMBER_DATA_INDEX + i], currentDataIndex);
 						}
-						CANNetworkManager::CANNetwork.process_any_control_function_pgn_callbacks(tempSession->sessionMessage);
-						CANNetworkManager::CANNetwork.protocol_message_callback(&tempSession->sessionMessage);
-						close_session(tempSession, true);
+						tempSession->lastPacketNumber++;
+						tempSession->processedPacketsThisSession++;
+						if ((tempSession->processedPacketsThisSession * PROTOCOL_BYTES_PER_FRAME) >= tempSession->sessionMessage.get_data_length())
+						{
+							if (nullptr != tempSession->sessionMessage.get_destination_control_function())
+							{
+								send_end_of_session_acknowledgement(tempSession);
+							}
+							CANNetworkManager::CANNetwork.process_any_control_function_pgn_callbacks(tempSession->sessionMessage);
+							CANNetworkManager::CANNetwork.protocol_message_callback(&tempSession->sessionMessage);
+							close_session(tempSession, true);
+						}
+						tempSession->timestamp_ms = SystemTiming::get_timestamp_ms();
+					}
+					else if (0 == CANNetworkConfiguration::get_max_number_transport_protocol_retransmit_requests())
+					{
+						// Retransmits are off, so drop the packet without aborting like we always have
+						CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[ETP]: Received an unexpected or invalid data transfer frame");
+					}
+					else if (messageData[SEQUENCE_NUMBER_DATA_INDEX] == tempSession->lastPacketNumber)
+					{
+						// A duplicate of the last packet doesn't cost us anything, just ignore it
+						CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[ETP]: Ignoring duplicate sequence number");
+					}
+					else if (request_retransmit(tempSession))
+					{
+						CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[ETP]: Bad sequence number, requesting retransmit from packet " + isobus::to_string(tempSession->processedPacketsThisSession + 1));
+					}
+					else
+					{
+						CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[ETP]: Aborting session due to bad sequence number");
+						abort_session(tempSession, ConnectionAbortReason::BadSequenceNumber);
+						close_session(tempSession, false);
 					}
-					tempSession->timestamp_ms = SystemTiming::get_timestamp_ms();
 				}
 				else
 				{
@@ -335,6 +387,42 @@ namespace isobus
 	                                                                 TransmitCompleteCallback sessionCompleteCallback,
 	                                                                 void *parentPointer,
 	                                                                 DataChunkCallback frameChunkCallback)
+	{
+		bool retVal = false;
+
+		if ((nullptr != dataBuffer) ||
+		    (nullptr != frameChunkCallback))
+		{
+			retVal = create_transmit_session(parameterGroupNumber, dataBuffer, messageLength, source, destination, sessionCompleteCallback, parentPointer, frameChunkCallback, nullptr);
+		}
+		return retVal;
+	}
+
+	bool ExtendedTransportProtocolManager::protocol_transmit_data_source(std::uint32_t parameterGroupNumber,
+	                                                                     std::shared_ptr<TransmitDataSource> dataSource,
+	                                                                     ControlFunction *source,
+	                                                                     ControlFunction *destination,
+	                                                                     TransmitCompleteCallback sessionCompleteCallback,
+	                                                                     void *parentPointer)
+	{
+		bool retVal = false;
+
+		if (nullptr != dataSource)
+		{
+			retVal = create_transmit_session(parameterGroupNumber, nullptr, dataSource->get_size(), source, destination, sessionCompleteCallback, parentPointer, nullptr, dataSource);
+		}
+		return retVal;
+	}
+
+	bool ExtendedTransportProtocolManager::create_transmit_session(std::uint32_t parameterGroupNumber,
+	                                                               const std::uint8_t *dataBuffer,
+	                                                               std::uint32_t messageLength,
+	                                                               ControlFunction *source,
+	                                                               ControlFunction *destination,
+	                                                               TransmitCompleteCallback sessionCompleteCallback,
+	                                                               void *parentPointer,
+	                                                               DataChunkCallback frameChunkCallback,
+	                                                               std::shared_ptr<TransmitDataSource> dataSource)
 	{
 		ExtendedTransportProtocolSession *session;
 		bool retVal = false;
@@ -342,8 +430,6 @@ namespace isobus
 		if ((messageLength < MAX_PROTOCOL_DATA_LENGTH) &&
 		    (messageLength >= MIN_PROTOCOL_DATA_LENGTH) &&
 		    (nullptr != destination) &&
-		    ((nullptr != dataBuffer) ||
-		     (nullptr != frameChunkCallback)) &&
 		    (nullptr != source) &&
 		    (true == source->get_address_valid()) &&
 		    (destination->get_address_valid()) &&
@@ -360,6 +446,7 @@ namespace isobus
 			newSession->processedPacketsThisSession = 0;
 			newSession->sessionCompleteCallback = sessionCompleteCallback;
 			newSession->frameChunkCallback = frameChunkCallback;
+			newSession->dataSource = dataSource;
 			newSession->parent = parentPointer;
 			if (0 != (messageLength % PROTOCOL_BYTES_PER_FRAME))
 			{
@@ -388,6 +475,97 @@ namespace isobus
 		}
 	}
 
+	bool ExtendedTransportProtocolManager::request_retransmit(ExtendedTransportProtocolSession *session)
+	{
+		bool retVal = false;
+
+		if ((nullptr != session) &&
+		    (session->retransmitRequests < CANNetworkConfiguration::get_max_number_transport_protocol_retransmit_requests()))
+		{
+			session->retransmitRequests++;
+			// The next CTS will set the real window size
+			session->packetCount = 0xFF;
+			set_state(session, StateMachineState::ClearToSend);
+			retVal = true;
+		}
+		return retVal;
+	}
+
+	bool ExtendedTransportProtocolManager::get_transmit_packet_data(ExtendedTransportProtocolSession *session, std::uint8_t *packetData)
+	{
+		const std::uint32_t messageLength = session->sessionMessage.get_data_length();
+		const std::uint32_t bytesOffset = (PROTOCOL_BYTES_PER_FRAME * session->processedPacketsThisSession);
+		std::uint32_t numberBytesThisPacket = 0;
+		bool retVal = true;
+
+		if (bytesOffset < messageLength)
+		{
+			numberBytesThisPacket = (messageLength - bytesOffset);
+		}
+		if (numberBytesThisPacket > PROTOCOL_BYTES_PER_FRAME)
+		{
+			numberBytesThisPacket = PROTOCOL_BYTES_PER_FRAME;
+		}
+		memset(packetData, 0xFF, PROTOCOL_BYTES_PER_FRAME);
+
+		if (0 == numberBytesThisPacket)
+		{
+			// Past the end of the message, so the packet is all padding
+		}
+		else if ((nullptr != session->dataSource) &&
+		         (nullptr != session->dataSource->get_data()))
+		{
+			// The source is contiguous (like a memory mapped file) so read directly from it
+			memcpy(packetData, session->dataSource->get_data() + bytesOffset, numberBytesThisPacket);
+		}
+		else if ((nullptr != session->dataSource) ||
+		         ((nullptr != session->frameChunkCallback) &&
+		          (CANNetworkConfiguration::get_transport_protocol_window_data_chunk_callbacks())))
+		{
+			if ((bytesOffset < session->windowBufferOffset) ||
+			    ((bytesOffset + numberBytesThisPacket) > (session->windowBufferOffset + session->windowBuffer.size())))
+			{
+				// Fetch everything the current CTS window will need in one go
+				std::uint32_t windowLength = (PROTOCOL_BYTES_PER_FRAME * (session->packetCount - session->lastPacketNumber));
+
+				if (windowLength > (messageLength - bytesOffset))
+				{
+					windowLength = (messageLength - bytesOffset);
+				}
+				session->windowBuffer.resize(windowLength);
+				session->windowBufferOffset = bytesOffset;
+
+				if (nullptr != session->dataSource)
+				{
+					retVal = session->dataSource->read(bytesOffset, windowLength, session->windowBuffer.data());
+				}
+				else
+				{
+					retVal = session->frameChunkCallback(session->lastPacketNumber + 1, bytesOffset, windowLength, session->windowBuffer.data(), session->parent);
+				}
+
+				if (!retVal)
+				{
+					session->windowBuffer.clear();
+				}
+			}
+
+			if (retVal)
+			{
+				memcpy(packetData, &session->windowBuffer[bytesOffset - session->windowBufferOffset], numberBytesThisPacket);
+			}
+		}
+		else if (nullptr != session->frameChunkCallback)
+		{
+			retVal = session->frameChunkCallback(session->lastPacketNumber + 1, bytesOffset, numberBytesThisPacket, packetData, session->parent);
+		}
+		else
+		{
+			memcpy(packetData, &session->sessionMessage.get_data()[bytesOffset], numberBytesThisPacket);
+		}
+		return retVal;
+	}
+
 	bool ExtendedTransportProtocolManager::abort_session(ExtendedTransportProtocolSession *session, ConnectionAbortReason reason)
 	{
 		bool retVal = false;
@@ -683,58 +861,13 @@ namespace isobus
 							{
 								dataBuffer[0] = (session->lastPacketNumber + 1);
 
-								if (nullptr != session->frameChunkCallback)
+								if (!get_transmit_packet_data(session, &dataBuffer[1]))
 								{
-									// Use the callback to get this frame's data
-									std::uint8_t callbackBuffer[7] = {
-										0xFF,
-										0xFF,
-										0xFF,
-										0xFF,
-										0xFF,
-										0xFF,
-										0xFF
-									};
-									std::uint16_t numberBytesLeft = (session->sessionMessage.get_data_length() - (PROTOCOL_BYTES_PER_FRAME * session->processedPacketsThisSession));
-
-									if (numberBytesLeft > PROTOCOL_BYTES_PER_FRAME)
-									{
-										numberBytesLeft = PROTOCOL_BYTES_PER_FRAME;
-									}
-
-									bool callbackSuccessful = session->frameChunkCallback(dataBuffer[0], (PROTOCOL_BYTES_PER_FRAME * session->processedPacketsThisSession), numberBytesLeft, callbackBuffer, session->parent);
-
-									if (callbackSuccessful)
-									{
-										for (std::uint8_t j = 0; j < PROTOCOL_BYTES_PER_FRAME; j++)
-										{
-											dataBuffer[1 + j] = callbackBuffer[j];
-										}
-									}
-									else
-									{
-										CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[ETP]: Aborting session, unable to transfer chunk of data (numberBytesLeft=" + to_string(numberBytesLeft) + ")");
-										abort_session(session, ConnectionAbortReason::AnyOtherReason);
-										close_session(session, false);
-										sessionStillValid = false;
-										break;
-									}
-								}
-								else
-								{
-									// Use the data buffer to get the data for this frame
-									for (std::uint8_t j = 0; j < PROTOCOL_BYTES_PER_FRAME; j++)
-									{
-										std::uint32_t index = (j + (PROTOCOL_BYTES_PER_FRAME * session->processedPacketsThisSession));
-										if (index < session->sessionMessage.get_data_length())
-										{
-											dataBuffer[1 + j] = session->sessionMessage.get_data()[j + (PROTOCOL_BYTES_PER_FRAME * session->processedPacketsThisSession)];
-										}
-										else
-										{
-											dataBuffer[1 + j] = 0xFF;
-										}
-									}
+									CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[ETP]: Aborting session, unable to transfer chunk of data at offset " + to_string(PROTOCOL_BYTES_PER_FRAME * session->processedPacketsThisSession));
+									abort_session(session, ConnectionAbortReason::AnyOtherReason);
+									close_session(session, false);
+									sessionStillValid = false;
+									break;
 								}
 
 								if (CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ExtendedTransportProtocolDataTransfer),
@@ -780,6 +913,12 @@ namespace isobus
 					{
 						set_state(session, StateMachineState::ClearToSend);
 					}
+					else if (SystemTiming::time_expired_ms(session->timestamp_ms, T1_TIMEOUT_MS) &&
+					         (request_retransmit(session)))
+					{
+						// The rest of the block was probably lost, ask for it again
+						CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[ETP]: RX T1 timeout reached, requesting retransmit from packet " + isobus::to_string(session->processedPacketsThisSession + 1));
+					}
 					else if (SystemTiming::time_expired_ms(session->timestamp_ms, T1_TIMEOUT_MS))
 					{
 						CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[ETP]: Aborting session, RX T1 timeout reached");
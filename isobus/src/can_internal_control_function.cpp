@@ -10,6 +10,8 @@
 #include "isobus/isobus/can_internal_control_function.hpp"
 
 #include "isobus/isobus/can_constants.hpp"
+#include "isobus/isobus/can_network_configuration.hpp"
+#include "isobus/isobus/can_network_manager.hpp"
 
 #include <algorithm>
 
@@ -17,6 +19,7 @@ namespace isobus
 {
 	std::vector<InternalControlFunction *> InternalControlFunction::internalControlFunctionList;
 	bool InternalControlFunction::anyChangedAddress = false;
+	bool InternalControlFunction::anyNewInternalControlFunction = false;
 
 	InternalControlFunction::InternalControlFunction(NAME desiredName, std::uint8_t preferredAddress, std::uint8_t CANPort) :
 	  ControlFunction(desiredName, NULL_CAN_ADDRESS, CANPort),
@@ -35,6 +38,7 @@ namespace isobus
 		{
 			internalControlFunctionList.push_back(this); // Allocate space in the list for this ICF
 		}
+		anyNewInternalControlFunction = true;
 	}
 
 	InternalControlFunction::~InternalControlFunction()
@@ -42,6 +46,7 @@ namespace isobus
 		const std::lock_guard<std::mutex> lock(ControlFunction::controlFunctionProcessingMutex);
 		auto thisObject = std::find(internalControlFunctionList.begin(), internalControlFunctionList.end(), this);
 		*thisObject = nullptr; // Don't erase, just null it out. Erase could cause a double free.
+		CANNetworkManager::CANNetwork.on_internal_control_function_deleted(this, {}); // Tell the network manager to purge this control function from all tables
 	}
 
 	InternalControlFunction *InternalControlFunction::get_internal_control_function(std::uint32_t index)
@@ -68,29 +73,79 @@ namespace isobus
 		return anyChangedAddress;
 	}
 
+	bool InternalControlFunction::get_any_new_internal_control_function(CANLibBadge<CANNetworkManager>)
+	{
+		return anyNewInternalControlFunction;
+	}
+
 	bool InternalControlFunction::get_changed_address_since_last_update(CANLibBadge<CANNetworkManager>) const
 	{
 		return objectChangedAddressSinceLastUpdate;
 	}
 
+	bool InternalControlFunction::set_preferred_address(std::uint8_t address, CANLibBadge<CANNetworkManager>)
+	{
+		return stateMachine.set_preferred_address(address);
+	}
+
 	void InternalControlFunction::update_address_claiming(CANLibBadge<CANNetworkManager>)
 	{
 		anyChangedAddress = false;
+		anyNewInternalControlFunction = false;
+
+		if (CANNetworkConfiguration::get_coordinated_address_claiming())
+		{
+			std::vector<AddressClaimStateMachine *> portStateMachines;
+
+			for (std::uint8_t i = 0; i < CAN_PORT_MAXIMUM; i++)
+			{
+				portStateMachines.clear();
+
+				for (auto currentControlFunction : internalControlFunctionList)
+				{
+					if ((nullptr != currentControlFunction) &&
+					    (i == currentControlFunction->get_can_port()))
+					{
+						portStateMachines.push_back(&currentControlFunction->stateMachine);
+					}
+				}
+
+				if (!portStateMachines.empty())
+				{
+					AddressClaimStateMachine::update_coordinated(i, portStateMachines, {});
+				}
+			}
 
-		for (auto currentControlFunction : internalControlFunctionList)
+			for (auto currentControlFunction : internalControlFunctionList)
+			{
+				if (nullptr != currentControlFunction)
+				{
+					currentControlFunction->update_address();
+				}
+			}
+		}
+		else
 		{
-			if (nullptr != currentControlFunction)
+			for (auto currentControlFunction : internalControlFunctionList)
 			{
-				currentControlFunction->update();
+				if (nullptr != currentControlFunction)
+				{
+					currentControlFunction->update();
+				}
 			}
 		}
 	}
 
 	void InternalControlFunction::update()
+	{
+		stateMachine.update();
+		update_address();
+	}
+
+	void InternalControlFunction::update_address()
 	{
 		std::uint8_t previousAddress = address;
 		objectChangedAddressSinceLastUpdate = false;
-		stateMachine.update();
 		address = stateMachine.get_claimed_address();
 
 		if (previousAddress != address)
@@ -0,0 +1,257 @@
+//================================================================================================
+/// @file can_latest_value_cache.cpp
+///
+/// @brief Keeps the most recent payload of selected PGNs from each source, so that any thread
+/// can read the latest value of a PGN without callbacks or locks.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#include "isobus/isobus/can_latest_value_cache.hpp"
+
+#include "isobus/isobus/can_message.hpp"
+#include "isobus/utility/system_timing.hpp"
+
+namespace isobus
+{
+	constexpr std::uint16_t LatestValueCache::MAX_DATA_LENGTH;
+	constexpr std::size_t LatestValueCache::MAX_PARAMETER_GROUP_NUMBERS;
+	constexpr std::uint32_t LatestValueCache::NO_VALUE_AGE;
+	constexpr std::uint8_t LatestValueCache::MAX_READ_ATTEMPTS;
+
+	LatestValueCache::Slot::Slot() :
+	  sequence(0),
+	  timestamp_ms(0),
+	  dataLength(0)
+	{
+		for (auto &word : data)
+		{
+			word.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	LatestValueCache::Entry::Entry(std::uint32_t pgn) :
+	  parameterGroupNumber(pgn)
+	{
+		for (auto &channelSlots : slots)
+		{
+			for (auto &slot : channelSlots)
+			{
+				slot.store(nullptr, std::memory_order_relaxed);
+			}
+		}
+		for (auto &sourceAddress : latestSourceAddress)
+		{
+			sourceAddress.store(BROADCAST_CAN_ADDRESS, std::memory_order_relaxed);
+		}
+	}
+
+	LatestValueCache::LatestValueCache() :
+	  numberOfEntries(0)
+	{
+		for (auto &entry : entries)
+		{
+			entry.store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	LatestValueCache::~LatestValueCache()
+	{
+		for (auto &entry : entries)
+		{
+			Entry *currentEntry = entry.load(std::memory_order_acquire);
+
+			if (nullptr != currentEntry)
+			{
+				for (auto &channelSlots : currentEntry->slots)
+				{
+					for (auto &slot : channelSlots)
+					{
+						delete slot.load(std::memory_order_acquire);
+					}
+				}
+				delete currentEntry;
+			}
+		}
+	}
+
+	bool LatestValueCache::add_parameter_group_number(std::uint32_t parameterGroupNumber)
+	{
+		const std::lock_guard<std::mutex> lock(addMutex);
+		const std::size_t entryCount = numberOfEntries.load(std::memory_order_acquire);
+		bool retVal = (nullptr != find_entry(parameterGroupNumber));
+
+		if ((!retVal) && (entryCount < MAX_PARAMETER_GROUP_NUMBERS))
+		{
+			// Publish the entry before the count, so nothing can see the count without the entry
+			entries[entryCount].store(new Entry(parameterGroupNumber), std::memory_order_release);
+			numberOfEntries.store(entryCount + 1, std::memory_order_release);
+			retVal = true;
+		}
+		return retVal;
+	}
+
+	bool LatestValueCache::get_is_parameter_group_number_cached(std::uint32_t parameterGroupNumber) const
+	{
+		return (nullptr != find_entry(parameterGroupNumber));
+	}
+
+	bool LatestValueCache::get_latest_value(std::uint8_t canPort,
+	                                        std::uint32_t parameterGroupNumber,
+	                                        std::uint8_t sourceAddress,
+	                                        std::uint8_t *buffer,
+	                                        std::uint16_t bufferSize,
+	                                        ValueInfo &info) const
+	{
+		std::uint8_t resolvedSourceAddress = sourceAddress;
+		const Slot *slot = find_slot(canPort, parameterGroupNumber, resolvedSourceAddress);
+		bool retVal = false;
+
+		if (nullptr != slot)
+		{
+			std::array<std::uint64_t, MAX_DATA_LENGTH / 8> dataWords;
+
+			for (std::uint8_t i = 0; i < MAX_READ_ATTEMPTS; i++)
+			{
+				const std::uint32_t sequenceBefore = slot->sequence.load(std::memory_order_acquire);
+
+				if (0 == sequenceBefore)
+				{
+					break; // Allocated, but the first value isn't finished yet
+				}
+				else if (0 != (sequenceBefore & 0x01))
+				{
+					continue; // Being written right now
+				}
+
+				const std::uint32_t timestamp = slot->timestamp_ms.load(std::memory_order_relaxed);
+				const std::uint16_t length = slot->dataLength.load(std::memory_order_relaxed);
+				const std::size_t numberOfWords = (length + 7) / 8;
+
+				for (std::size_t j = 0; j < numberOfWords; j++)
+				{
+					dataWords[j] = slot->data[j].load(std::memory_order_relaxed);
+				}
+				std::atomic_thread_fence(std::memory_order_acquire);
+
+				if (sequenceBefore == slot->sequence.load(std::memory_order_relaxed))
+				{
+					info.timestamp_ms = timestamp;
+					info.dataLength = length;
+					info.sourceAddress = resolvedSourceAddress;
+
+					if (nullptr != buffer)
+					{
+						for (std::uint16_t j = 0; (j < length) && (j < bufferSize); j++)
+						{
+							buffer[j] = static_cast<std::uint8_t>((dataWords[j / 8] >> (8 * (j % 8))) & 0xFF);
+						}
+					}
+					retVal = true;
+					break;
+				}
+				// Otherwise the value changed while we were copying it, so try again
+			}
+		}
+		return retVal;
+	}
+
+	std::uint32_t LatestValueCache::get_age_ms(std::uint8_t canPort, std::uint32_t parameterGroupNumber, std::uint8_t sourceAddress) const
+	{
+		const Slot *slot = find_slot(canPort, parameterGroupNumber, sourceAddress);
+		std::uint32_t retVal = NO_VALUE_AGE;
+
+		// The timestamp is a single atomic, so no need for the sequence number unless this is the first value
+		if ((nullptr != slot) &&
+		    (0 != slot->sequence.load(std::memory_order_acquire)))
+		{
+			retVal = SystemTiming::get_time_elapsed_ms(slot->timestamp_ms.load(std::memory_order_acquire));
+		}
+		return retVal;
+	}
+
+	void LatestValueCache::record(CANMessage &message)
+	{
+		const std::uint32_t parameterGroupNumber = message.get_identifier().get_parameter_group_number();
+		const std::uint8_t canPort = message.get_can_port_index();
+		const std::uint8_t sourceAddress = message.get_identifier().get_source_address();
+		Entry *entry = find_entry(parameterGroupNumber);
+
+		if ((nullptr != entry) &&
+		    (canPort < CAN_PORT_MAXIMUM) &&
+		    (sourceAddress < NULL_CAN_ADDRESS) &&
+		    (message.get_data_length() <= MAX_DATA_LENGTH))
+		{
+			Slot *slot = entry->slots[canPort][sourceAddress].load(std::memory_order_relaxed);
+
+			if (nullptr == slot)
+			{
+				slot = new Slot();
+				entry->slots[canPort][sourceAddress].store(slot, std::memory_order_release);
+			}
+
+			const std::vector<std::uint8_t> &data = message.get_data();
+			const std::uint16_t length = static_cast<std::uint16_t>(message.get_data_length());
+			const std::uint32_t sequence = slot->sequence.load(std::memory_order_relaxed);
+
+			// Mark the slot as being written, so a reader that catches us part way through will try again
+			slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			for (std::size_t i = 0; i < ((length + 7U) / 8U); i++)
+			{
+				std::uint64_t word = 0;
+
+				for (std::size_t j = 0; (j < 8) && (((i * 8) + j) < length); j++)
+				{
+					word |= (static_cast<std::uint64_t>(data[(i * 8) + j]) << (8 * j));
+				}
+				slot->data[i].store(word, std::memory_order_relaxed);
+			}
+			slot->dataLength.store(length, std::memory_order_relaxed);
+			slot->timestamp_ms.store(SystemTiming::get_timestamp_ms(), std::memory_order_relaxed);
+			slot->sequence.store(sequence + 2, std::memory_order_release);
+			entry->latestSourceAddress[canPort].store(sourceAddress, std::memory_order_release);
+		}
+	}
+
+	LatestValueCache::Entry *LatestValueCache::find_entry(std::uint32_t parameterGroupNumber) const
+	{
+		Entry *retVal = nullptr;
+		const std::size_t entryCount = numberOfEntries.load(std::memory_order_acquire);
+
+		for (std::size_t i = 0; i < entryCount; i++)
+		{
+			Entry *currentEntry = entries[i].load(std::memory_order_acquire);
+
+			if (parameterGroupNumber == currentEntry->parameterGroupNumber)
+			{
+				retVal = currentEntry;
+				break;
+			}
+		}
+		return retVal;
+	}
+
+	const LatestValueCache::Slot *LatestValueCache::find_slot(std::uint8_t canPort, std::uint32_t parameterGroupNumber, std::uint8_t &sourceAddress) const
+	{
+		const Entry *entry = find_entry(parameterGroupNumber);
+		const Slot *retVal = nullptr;
+
+		if ((nullptr != entry) &&
+		    (canPort < CAN_PORT_MAXIMUM))
+		{
+			if (BROADCAST_CAN_ADDRESS == sourceAddress)
+			{
+				sourceAddress = entry->latestSourceAddress[canPort].load(std::memory_order_acquire);
+			}
+
+			if (sourceAddress < NULL_CAN_ADDRESS)
+			{
+				retVal = entry->slots[canPort][sourceAddress].load(std::memory_order_acquire);
+			}
+		}
+		return retVal;
+	}
+} // namespace isobus
@@ -13,6 +13,11 @@ namespace isobus
 {
 	std::uint32_t CANNetworkConfiguration::maxNumberTransportProtocolSessions = 4;
 	std::uint32_t CANNetworkConfiguration::minimumTimeBetweenTransportProtocolBAMFrames = DEFAULT_BAM_PACKET_DELAY_TIME_MS;
+	bool CANNetworkConfiguration::transportProtocolWindowDataChunkCallbacks = false;
+	std::uint8_t CANNetworkConfiguration::maxNumberTransportProtocolRetransmitRequests = DEFAULT_MAX_RETRANSMIT_REQUESTS;
+	std::uint32_t CANNetworkConfiguration::minimumTimeBetweenFastPacketFrames_us = 0;
+	bool CANNetworkConfiguration::deferSuspendedBroadcasts = false;
+	bool CANNetworkConfiguration::coordinatedAddressClaiming = false;
 
 	CANNetworkConfiguration::CANNetworkConfiguration()
 	{
@@ -48,4 +53,54 @@ namespace isobus
 	{
 		return minimumTimeBetweenTransportProtocolBAMFrames;
 	}
+
+	void CANNetworkConfiguration::set_transport_protocol_window_data_chunk_callbacks(bool value)
+	{
+		transportProtocolWindowDataChunkCallbacks = value;
+	}
+
+	bool CANNetworkConfiguration::get_transport_protocol_window_data_chunk_callbacks()
+	{
+		return transportProtocolWindowDataChunkCallbacks;
+	}
+
+	void CANNetworkConfiguration::set_max_number_transport_protocol_retransmit_requests(std::uint8_t value)
+	{
+		maxNumberTransportProtocolRetransmitRequests = value;
+	}
+
+	std::uint8_t CANNetworkConfiguration::get_max_number_transport_protocol_retransmit_requests()
+	{
+		return maxNumberTransportProtocolRetransmitRequests;
+	}
+
+	void CANNetworkConfiguration::set_minimum_time_between_fast_packet_frames_us(std::uint32_t value)
+	{
+		minimumTimeBetweenFastPacketFrames_us = value;
+	}
+
+	std::uint32_t CANNetworkConfiguration::get_minimum_time_between_fast_packet_frames_us()
+	{
+		return minimumTimeBetweenFastPacketFrames_us;
+	}
+
+	void CANNetworkConfiguration::set_defer_suspended_broadcasts(bool value)
+	{
+		deferSuspendedBroadcasts = value;
+	}
+
+	bool CANNetworkConfiguration::get_defer_suspended_broadcasts()
+	{
+		return deferSuspendedBroadcasts;
+	}
+
+	void CANNetworkConfiguration::set_coordinated_address_claiming(bool value)
+	{
+		coordinatedAddressClaiming = value;
+	}
+
+	bool CANNetworkConfiguration::get_coordinated_address_claiming()
+	{
+		return coordinatedAddressClaiming;
+	}
 }
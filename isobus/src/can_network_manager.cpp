@@ -14,9 +14,11 @@
 #include "isobus/isobus/can_hardware_abstraction.hpp"
 #include "isobus/isobus/can_managed_message.hpp"
 #include "isobus/isobus/can_message.hpp"
+#include "isobus/isobus/can_network_configuration.hpp"
 #include "isobus/isobus/can_partnered_control_function.hpp"
 #include "isobus/isobus/can_protocol.hpp"
 #include "isobus/isobus/can_stack_logger.hpp"
+#include "isobus/isobus/isobus_diagnostic_protocol.hpp"
 #include "isobus/utility/system_timing.hpp"
 #include "isobus/utility/to_string.hpp"
 
@@ -25,6 +27,8 @@
 namespace isobus
 {
 	CANNetworkManager CANNetworkManager::CANNetwork;
+	constexpr std::uint32_t CANNetworkManager::DM13_TIMEOUT_MS;
+	constexpr std::uint32_t CANNetworkManager::PROVISIONAL_PARTNER_TIMEOUT_MS;
 
 	void CANNetworkManager::initialize()
 	{
@@ -116,48 +120,112 @@ namespace isobus
 		    ((parameterGroupNumber == static_cast<std::uint32_t>(CANLibParameterGroupNumber::AddressClaim)) ||
 		     (sourceControlFunction->get_address_valid())))
 		{
-			CANLibProtocol *currentProtocol;
+			BroadcastGateResult gateResult = BroadcastGateResult::Send;
 
-			// See if any transport layer protocol can handle this message
-			for (std::uint32_t i = 0; i < CANLibProtocol::get_number_protocols(); i++)
+			if (nullptr == destinationControlFunction)
 			{
-				if (CANLibProtocol::get_protocol(i, currentProtocol))
+				gateResult = check_broadcast_gate(sourceControlFunction->get_can_port(), parameterGroupNumber, nullptr != dataBuffer);
+			}
+
+			if (BroadcastGateResult::Defer == gateResult)
+			{
+				defer_broadcast(parameterGroupNumber, dataBuffer, dataLength, sourceControlFunction, priority, transmitCompleteCallback, parentPointer);
+				retVal = true;
+			}
+			else if (BroadcastGateResult::Send == gateResult)
+			{
+				CANLibProtocol *currentProtocol;
+
+				// See if any transport layer protocol can handle this message
+				for (std::uint32_t i = 0; i < CANLibProtocol::get_number_protocols(); i++)
 				{
-					retVal = currentProtocol->protocol_transmit_message(parameterGroupNumber,
-					                                                    dataBuffer,
-					                                                    dataLength,
-					                                                    sourceControlFunction,
-					                                                    destinationControlFunction,
-					                                                    transmitCompleteCallback,
-					                                                    parentPointer,
-					                                                    frameChunkCallback);
+					if (CANLibProtocol::get_protocol(i, currentProtocol))
+					{
+						retVal = currentProtocol->protocol_transmit_message(parameterGroupNumber,
+						                                                    dataBuffer,
+						                                                    dataLength,
+						                                                    sourceControlFunction,
+						                                                    destinationControlFunction,
+						                                                    transmitCompleteCallback,
+						                                                    parentPointer,
+						                                                    frameChunkCallback);
+
+						if (retVal)
+						{
+							break;
+						}
+					}
+				}
 
-					if (retVal)
+				//! @todo Allow sending 8 byte message with the frameChunkCallback
+				if ((!retVal) &&
+				    (nullptr != dataBuffer))
+				{
+					if (nullptr == destinationControlFunction)
 					{
-						break;
+						// Todo move binding of dest address to hardware layer
+						retVal = send_can_message_raw(sourceControlFunction->get_can_port(), sourceControlFunction->get_address(), 0xFF, parameterGroupNumber, priority, dataBuffer, dataLength);
+					}
+					else if (destinationControlFunction->get_address_valid())
+					{
+						retVal = send_can_message_raw(sourceControlFunction->get_can_port(), sourceControlFunction->get_address(), destinationControlFunction->get_address(), parameterGroupNumber, priority, dataBuffer, dataLength);
+					}
+
+					if ((retVal) &&
+					    (nullptr != transmitCompleteCallback))
+					{
+						// Message was not sent via a protocol, so handle the tx callback now
+						transmitCompleteCallback(parameterGroupNumber, dataLength, sourceControlFunction, destinationControlFunction, retVal, parentPointer);
 					}
 				}
 			}
+		}
+		return retVal;
+	}
+
+	bool CANNetworkManager::send_can_message_from_data_source(std::uint32_t parameterGroupNumber,
+	                                                          std::shared_ptr<TransmitDataSource> dataSource,
+	                                                          InternalControlFunction *sourceControlFunction,
+	                                                          ControlFunction *destinationControlFunction,
+	                                                          CANIdentifier::CANPriority priority,
+	                                                          TransmitCompleteCallback transmitCompleteCallback,
+	                                                          void *parentPointer)
+	{
+		bool retVal = false;
 
-			//! @todo Allow sending 8 byte message with the frameChunkCallback
-			if ((!retVal) &&
-			    (nullptr != dataBuffer))
+		if ((nullptr != dataSource) &&
+		    (dataSource->get_size() > 0) &&
+		    (dataSource->get_size() <= CANMessage::ABSOLUTE_MAX_MESSAGE_LENGTH) &&
+		    (nullptr != sourceControlFunction) &&
+		    (sourceControlFunction->get_address_valid()))
+		{
+			if (dataSource->get_size() <= CAN_DATA_LENGTH)
 			{
-				if (nullptr == destinationControlFunction)
-				{
-					// Todo move binding of dest address to hardware layer
-					retVal = send_can_message_raw(sourceControlFunction->get_can_port(), sourceControlFunction->get_address(), 0xFF, parameterGroupNumber, priority, dataBuffer, dataLength);
-				}
-				else if (destinationControlFunction->get_address_valid())
+				std::uint8_t shortMessageBuffer[CAN_DATA_LENGTH];
+
+				if (dataSource->read(0, dataSource->get_size(), shortMessageBuffer))
 				{
-					retVal = send_can_message_raw(sourceControlFunction->get_can_port(), sourceControlFunction->get_address(), destinationControlFunction->get_address(), parameterGroupNumber, priority, dataBuffer, dataLength);
+					retVal = send_can_message(parameterGroupNumber, shortMessageBuffer, dataSource->get_size(), sourceControlFunction, destinationControlFunction, priority, transmitCompleteCallback, parentPointer);
 				}
+			}
+			else if ((nullptr != destinationControlFunction) ||
+			         (BroadcastGateResult::Send == check_broadcast_gate(sourceControlFunction->get_can_port(), parameterGroupNumber, false)))
+			{
+				CANLibProtocol *currentProtocol;
 
-				if ((retVal) &&
-				    (nullptr != transmitCompleteCallback))
+				for (std::uint32_t i = 0; i < CANLibProtocol::get_number_protocols(); i++)
 				{
-					// Message was not sent via a protocol, so handle the tx callback now
-					transmitCompleteCallback(parameterGroupNumber, dataLength, sourceControlFunction, destinationControlFunction, retVal, parentPointer);
+					if ((CANLibProtocol::get_protocol(i, currentProtocol)) &&
+					    (currentProtocol->protocol_transmit_data_source(parameterGroupNumber,
+					                                                    dataSource,
+					                                                    sourceControlFunction,
+					                                                    destinationControlFunction,
+					                                                    transmitCompleteCallback,
+					                                                    parentPointer)))
+					{
+						retVal = true;
+						break;
+					}
 				}
 			}
 		}
@@ -189,6 +257,16 @@ namespace isobus
 
 		process_rx_messages();
 
+		update_broadcast_suspension();
+
+		update_provisional_partners(nullptr);
+
+		if (InternalControlFunction::get_any_new_internal_control_function({}) ||
+		    (get_network_snapshot_changed()))
+		{
+			apply_snapshot_preferred_addresses();
+		}
+
 		InternalControlFunction::update_address_claiming({});
 
 		if (InternalControlFunction::get_any_internal_control_function_changed_address({}))
@@ -224,6 +302,7 @@ namespace isobus
 				currentProtocol->update({});
 			}
 		}
+		update_signal_batch();
 		updateTimestamp_ms = SystemTiming::get_timestamp_ms();
 	}
 
@@ -289,6 +368,25 @@ namespace isobus
 	{
 		CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Debug, "[NM]: Partner " + isobus::to_string(static_cast<int>(partner->get_address())) + " was deleted.");
 
+		{
+			const std::lock_guard<std::mutex> lock(networkSnapshotMutex);
+			for (auto provisionalPartner = provisionalPartners.begin(); provisionalPartner != provisionalPartners.end(); provisionalPartner++)
+			{
+				if (partner == provisionalPartner->partner)
+				{
+					// Its device hasn't claimed, so it shouldn't be replaced by an external control function
+					if ((partner->address < NULL_CAN_ADDRESS) &&
+					    (partner == controlFunctionTable[partner->get_can_port()][partner->address]))
+					{
+						controlFunctionTable[partner->get_can_port()][partner->address] = nullptr;
+					}
+					partner->address = NULL_CAN_ADDRESS;
+					provisionalPartners.erase(provisionalPartner);
+					break;
+				}
+			}
+		}
+
 		for (auto activeControlFunction = activeControlFunctions.begin(); activeControlFunction != activeControlFunctions.end(); activeControlFunction++)
 		{
 			if ((partner->get_can_port() == (*activeControlFunction)->get_can_port()) &&
@@ -318,6 +416,24 @@ namespace isobus
 		}
 	}
 
+	void CANNetworkManager::on_internal_control_function_deleted(InternalControlFunction *internalControlFunction, CANLibBadge<InternalControlFunction>)
+	{
+		const std::uint8_t canPort = internalControlFunction->get_can_port();
+
+		if (canPort < CAN_PORT_MAXIMUM)
+		{
+			for (auto &controlFunction : controlFunctionTable[canPort])
+			{
+				if (internalControlFunction == controlFunction)
+				{
+					controlFunction = nullptr;
+				}
+			}
+		}
+		activeControlFunctions.erase(std::remove(activeControlFunctions.begin(), activeControlFunctions.end(), internalControlFunction), activeControlFunctions.end());
+		inactiveControlFunctions.erase(std::remove(inactiveControlFunctions.begin(), inactiveControlFunctions.end(), internalControlFunction), inactiveControlFunctions.end());
+	}
+
 	bool CANNetworkManager::add_protocol_parameter_group_number_callback(std::uint32_t parameterGroupNumber, CANLibCallback callback, void *parentPointer)
 	{
 		bool retVal = false;
@@ -354,11 +470,152 @@ namespace isobus
 		return retVal;
 	}
 
+	bool CANNetworkManager::get_broadcasts_suspended(std::uint8_t canPort) const
+	{
+		const std::lock_guard<std::mutex> lock(broadcastSuspensionMutex);
+		return (canPort < CAN_PORT_MAXIMUM) && (0 != (broadcastSuspensionBitfield & (1u << canPort)));
+	}
+
+	void CANNetworkManager::add_broadcast_suspension_exception(std::uint32_t parameterGroupNumber)
+	{
+		const std::lock_guard<std::mutex> lock(broadcastSuspensionMutex);
+
+		if (broadcastSuspensionExceptions.end() == std::find(broadcastSuspensionExceptions.begin(), broadcastSuspensionExceptions.end(), parameterGroupNumber))
+		{
+			broadcastSuspensionExceptions.push_back(parameterGroupNumber);
+		}
+	}
+
+	void CANNetworkManager::remove_broadcast_suspension_exception(std::uint32_t parameterGroupNumber)
+	{
+		const std::lock_guard<std::mutex> lock(broadcastSuspensionMutex);
+		auto exception = std::find(broadcastSuspensionExceptions.begin(), broadcastSuspensionExceptions.end(), parameterGroupNumber);
+
+		if (broadcastSuspensionExceptions.end() != exception)
+		{
+			broadcastSuspensionExceptions.erase(exception);
+		}
+	}
+
+	CANNetworkManager::BroadcastSuspensionStatistics CANNetworkManager::get_broadcast_suspension_statistics(std::uint8_t canPort) const
+	{
+		BroadcastSuspensionStatistics retVal = { 0, 0, 0, 0, 0 };
+		const std::lock_guard<std::mutex> lock(broadcastSuspensionMutex);
+
+		if (canPort < CAN_PORT_MAXIMUM)
+		{
+			retVal = broadcastSuspensionStatistics[canPort];
+		}
+		return retVal;
+	}
+
+	CANNetworkManager::BroadcastGateResult CANNetworkManager::check_broadcast_gate(std::uint8_t canPort, std::uint32_t parameterGroupNumber, bool canDefer)
+	{
+		BroadcastGateResult retVal = BroadcastGateResult::Send;
+		const std::lock_guard<std::mutex> lock(broadcastSuspensionMutex);
+
+		if ((canPort < CAN_PORT_MAXIMUM) &&
+		    (0 != (broadcastSuspensionBitfield & (1u << canPort))))
+		{
+			switch (parameterGroupNumber)
+			{
+				// J1939-73 still allows network management and the messages used to reprogram ECUs
+				case static_cast<std::uint32_t>(CANLibParameterGroupNumber::AddressClaim):
+				case static_cast<std::uint32_t>(CANLibParameterGroupNumber::ParameterGroupNumberRequest):
+				case static_cast<std::uint32_t>(CANLibParameterGroupNumber::Acknowledge):
+				case static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage13):
+				case static_cast<std::uint32_t>(CANLibParameterGroupNumber::TransportProtocolCommand):
+				case static_cast<std::uint32_t>(CANLibParameterGroupNumber::TransportProtocolData):
+				case static_cast<std::uint32_t>(CANLibParameterGroupNumber::ExtendedTransportProtocolConnectionManagement):
+				case static_cast<std::uint32_t>(CANLibParameterGroupNumber::ExtendedTransportProtocolDataTransfer):
+				{
+					broadcastSuspensionStatistics[canPort].exceptedMessages++;
+				}
+				break;
+
+				default:
+				{
+					if (broadcastSuspensionExceptions.end() != std::find(broadcastSuspensionExceptions.begin(), broadcastSuspensionExceptions.end(), parameterGroupNumber))
+					{
+						broadcastSuspensionStatistics[canPort].exceptedMessages++;
+					}
+					else if ((canDefer) &&
+					         (CANNetworkConfiguration::get_defer_suspended_broadcasts()))
+					{
+						broadcastSuspensionStatistics[canPort].deferredMessages++;
+						retVal = BroadcastGateResult::Defer;
+					}
+					else
+					{
+						broadcastSuspensionStatistics[canPort].suppressedMessages++;
+						retVal = BroadcastGateResult::Suppress;
+					}
+				}
+				break;
+			}
+		}
+		return retVal;
+	}
+
+	void CANNetworkManager::set_network_snapshot(std::shared_ptr<NetworkSnapshot> snapshot)
+	{
+		const std::lock_guard<std::mutex> lock(networkSnapshotMutex);
+		networkSnapshot = snapshot;
+		networkSnapshotChanged = true;
+	}
+
+	std::shared_ptr<NetworkSnapshot> CANNetworkManager::get_network_snapshot() const
+	{
+		const std::lock_guard<std::mutex> lock(networkSnapshotMutex);
+		return networkSnapshot;
+	}
+
+	bool CANNetworkManager::get_is_partner_binding_provisional(const PartneredControlFunction *partner) const
+	{
+		bool retVal = false;
+		const std::lock_guard<std::mutex> lock(networkSnapshotMutex);
+
+		for (const auto &provisionalPartner : provisionalPartners)
+		{
+			if (partner == provisionalPartner.partner)
+			{
+				retVal = true;
+				break;
+			}
+		}
+		return retVal;
+	}
+
+	LatestValueCache &CANNetworkManager::get_latest_value_cache()
+	{
+		return latestValueCache;
+	}
+
+	void CANNetworkManager::set_signal_database(std::shared_ptr<SignalDatabase> database, SignalBatchCallback callback, void *parentPointer)
+	{
+		const std::lock_guard<std::mutex> lock(signalDatabaseMutex);
+		signalDatabase = database;
+		signalBatchCallback = callback;
+		signalBatchParent = parentPointer;
+	}
+
+	std::shared_ptr<SignalDatabase> CANNetworkManager::get_signal_database() const
+	{
+		const std::lock_guard<std::mutex> lock(signalDatabaseMutex);
+		return signalDatabase;
+	}
+
 	CANNetworkManager::CANNetworkManager() :
+	  broadcastSuspensionBitfield(0),
+	  signalBatchCallback(nullptr),
+	  signalBatchParent(nullptr),
 	  updateTimestamp_ms(0),
+	  networkSnapshotChanged(false),
 	  initialized(false)
 	{
 		controlFunctionTable.fill({ nullptr });
+		broadcastSuspensionStatistics.fill({ 0, 0, 0, 0, 0 });
+		lastDM13ReceivedTimestamp_ms.fill(0);
 	}
 
 	void CANNetworkManager::update_address_table(CANMessage &message)
@@ -385,7 +642,8 @@ namespace isobus
 				// Look through active CFs, maybe we've heard of this ECU before
 				for (auto currentControlFunction : activeControlFunctions)
 				{
-					if (currentControlFunction->get_address() == messageSourceAddress)
+					if ((currentControlFunction->get_address() == messageSourceAddress) &&
+					    (currentControlFunction->get_can_port() == CANPort))
 					{
 						// ECU has claimed since the last update, add it to the table
 						controlFunctionTable[CANPort][messageSourceAddress] = currentControlFunction;
@@ -416,7 +674,8 @@ namespace isobus
 				// Look through active CFs, maybe we've heard of this ECU before
 				for (auto currentControlFunction : activeControlFunctions)
 				{
-					if (currentControlFunction->get_address() == claimedAddress)
+					if ((currentControlFunction->get_address() == claimedAddress) &&
+					    (currentControlFunction->get_can_port() == CANPort))
 					{
 						// ECU has claimed since the last update, add it to the table
 						controlFunctionTable[CANPort][claimedAddress] = currentControlFunction;
@@ -484,19 +743,20 @@ namespace isobus
 			if (nullptr == foundControlFunction)
 			{
 				// If we still haven't found it, it might be a partner. Check the list of partners.
-				for (std::size_t i = 0; i < PartneredControlFunction::partneredControlFunctionList.size(); i++)
+				PartneredControlFunction *matchingPartner = PartneredControlFunction::find_partner_matching_name(rxFrame.channel, NAME(claimedNAME));
+
+				if (nullptr != matchingPartner)
 				{
-					if ((nullptr != PartneredControlFunction::partneredControlFunctionList[i]) &&
-					    (PartneredControlFunction::partneredControlFunctionList[i]->get_can_port() == rxFrame.channel) &&
-					    (PartneredControlFunction::partneredControlFunctionList[i]->check_matches_name(NAME(claimedNAME))))
+					matchingPartner->address = CANIdentifier(rxFrame.identifier).get_source_address();
+					matchingPartner->controlFunctionNAME = NAME(claimedNAME);
+
+					// A partner bound from the network snapshot is already active, even though its device hasn't claimed yet
+					if (activeControlFunctions.end() == std::find(activeControlFunctions.begin(), activeControlFunctions.end(), matchingPartner))
 					{
-						PartneredControlFunction::partneredControlFunctionList[i]->address = CANIdentifier(rxFrame.identifier).get_source_address();
-						PartneredControlFunction::partneredControlFunctionList[i]->controlFunctionNAME = NAME(claimedNAME);
-						activeControlFunctions.push_back(PartneredControlFunction::partneredControlFunctionList[i]);
-						foundControlFunction = PartneredControlFunction::partneredControlFunctionList[i];
-						CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Debug, "[NM]: A Partner Has Claimed " + isobus::to_string(static_cast<int>(CANIdentifier(rxFrame.identifier).get_source_address())));
-						break;
+						activeControlFunctions.push_back(matchingPartner);
 					}
+					foundControlFunction = matchingPartner;
+					CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Debug, "[NM]: A Partner Has Claimed " + isobus::to_string(static_cast<int>(CANIdentifier(rxFrame.identifier).get_source_address())));
 				}
 
 				if (nullptr == foundControlFunction)
@@ -563,10 +823,16 @@ namespace isobus
 								controlFunctionTable[partner->get_can_port()][partner->address] = partner;
 								activeControlFunctions.erase(currentActiveControlFunction);
 								activeControlFunctions.push_back(partner);
+								foundReplaceableControlFunction = true;
 								break;
 							}
 						}
 					}
+
+					if (!foundReplaceableControlFunction)
+					{
+						bind_partner_from_snapshot(partner);
+					}
 					partner->initialized = true;
 				}
 			}
@@ -574,6 +840,148 @@ namespace isobus
 		}
 	}
 
+	void CANNetworkManager::bind_partner_from_snapshot(PartneredControlFunction *partner)
+	{
+		const std::shared_ptr<NetworkSnapshot> snapshot = get_network_snapshot();
+		NAME snapshotNAME(0);
+		std::uint8_t snapshotAddress = NULL_CAN_ADDRESS;
+
+		if ((nullptr != snapshot) &&
+		    (partner->get_can_port() < CAN_PORT_MAXIMUM) &&
+		    (snapshot->get_partner_address(*partner, snapshotNAME, snapshotAddress)) &&
+		    (nullptr == controlFunctionTable[partner->get_can_port()][snapshotAddress]))
+		{
+			CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Debug, "[NM]: Provisionally binding partner to address " + isobus::to_string(static_cast<int>(snapshotAddress)) + " from the network snapshot");
+
+			partner->address = snapshotAddress;
+			partner->controlFunctionNAME = snapshotNAME;
+			controlFunctionTable[partner->get_can_port()][snapshotAddress] = partner;
+			activeControlFunctions.push_back(partner);
+
+			const std::lock_guard<std::mutex> lock(networkSnapshotMutex);
+			provisionalPartners.push_back({ partner, SystemTiming::get_timestamp_ms(), snapshotAddress });
+		}
+	}
+
+	bool CANNetworkManager::get_network_snapshot_changed()
+	{
+		const std::lock_guard<std::mutex> lock(networkSnapshotMutex);
+		const bool retVal = networkSnapshotChanged;
+		networkSnapshotChanged = false;
+		return retVal;
+	}
+
+	void CANNetworkManager::apply_snapshot_preferred_addresses()
+	{
+		const std::shared_ptr<NetworkSnapshot> snapshot = get_network_snapshot();
+
+		if (nullptr != snapshot)
+		{
+			for (std::uint32_t i = 0; i < InternalControlFunction::get_number_internal_control_functions(); i++)
+			{
+				InternalControlFunction *currentControlFunction = InternalControlFunction::get_internal_control_function(i);
+
+				// Only arbitrary address capable control functions may move, the others must keep the address they were given
+				if ((nullptr != currentControlFunction) &&
+				    (currentControlFunction->get_NAME().get_arbitrary_address_capable()))
+				{
+					const std::uint8_t snapshotAddress = snapshot->get_internal_control_function_address(currentControlFunction->get_can_port(), currentControlFunction->get_NAME());
+
+					if ((NULL_CAN_ADDRESS != snapshotAddress) &&
+					    (currentControlFunction->set_preferred_address(snapshotAddress, {})))
+					{
+						CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Debug, "[NM]: Internal control function will prefer address " + isobus::to_string(static_cast<int>(snapshotAddress)) + " from the network snapshot");
+					}
+				}
+			}
+		}
+	}
+
+	void CANNetworkManager::update_provisional_partners(CANMessage *message)
+	{
+		const std::lock_guard<std::mutex> lock(networkSnapshotMutex);
+
+		for (auto provisionalPartner = provisionalPartners.begin(); provisionalPartner != provisionalPartners.end();)
+		{
+			PartneredControlFunction *partner = provisionalPartner->partner;
+			const std::uint8_t canPort = partner->get_can_port();
+			bool removeBinding = false;
+
+			if (nullptr != message)
+			{
+				if ((CAN_DATA_LENGTH == message->get_data_length()) &&
+				    (canPort == message->get_can_port_index()) &&
+				    (partner->get_NAME().get_full_name() == message->get_uint64_at(0)))
+				{
+					// The device claimed, so the binding is real now. It may have claimed a different address than last time.
+					if ((partner->get_address() != provisionalPartner->address) &&
+					    (partner == controlFunctionTable[canPort][provisionalPartner->address]))
+					{
+						controlFunctionTable[canPort][provisionalPartner->address] = nullptr;
+					}
+					removeBinding = true;
+					CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Debug, "[NM]: Partner from the network snapshot confirmed at address " + isobus::to_string(static_cast<int>(partner->get_address())));
+				}
+			}
+			else if ((SystemTiming::time_expired_ms(provisionalPartner->timestamp_ms, PROVISIONAL_PARTNER_TIMEOUT_MS)) ||
+			         (NULL_CAN_ADDRESS == partner->get_address()))
+			{
+				// Either the device never claimed, or another device claimed its address. Forget the binding, and let the partner
+				// be found the normal way when its device claims.
+				CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Info, "[NM]: Dropping partner binding from the network snapshot, its device did not claim address " + isobus::to_string(static_cast<int>(provisionalPartner->address)));
+
+				if (partner == controlFunctionTable[canPort][provisionalPartner->address])
+				{
+					controlFunctionTable[canPort][provisionalPartner->address] = nullptr;
+				}
+				partner->address = NULL_CAN_ADDRESS;
+
+				auto activeControlFunction = std::find(activeControlFunctions.begin(), activeControlFunctions.end(), partner);
+				if (activeControlFunctions.end() != activeControlFunction)
+				{
+					activeControlFunctions.erase(activeControlFunction);
+				}
+				removeBinding = true;
+			}
+
+			if (removeBinding)
+			{
+				provisionalPartner = provisionalPartners.erase(provisionalPartner);
+			}
+			else
+			{
+				provisionalPartner++;
+			}
+		}
+	}
+
+	void CANNetworkManager::update_signal_batch()
+	{
+		std::shared_ptr<SignalDatabase> database;
+		SignalBatchCallback callback = nullptr;
+		void *parentPointer = nullptr;
+
+		{
+			const std::lock_guard<std::mutex> lock(signalDatabaseMutex);
+			database = signalDatabase;
+			callback = signalBatchCallback;
+			parentPointer = signalBatchParent;
+		}
+
+		// Only this thread touches the batch, so the callback can be called without holding the lock
+		if ((nullptr != database) &&
+		    (0 != signalBatch.get_number_staged_rows()))
+		{
+			database->decode(signalBatch);
+
+			if (nullptr != callback)
+			{
+				callback(*database, signalBatch, parentPointer);
+			}
+		}
+		signalBatch.clear();
+	}
+
 	HardwareInterfaceCANFrame CANNetworkManager::construct_frame(std::uint32_t portIndex,
 	                                                             std::uint8_t sourceAddress,
 	                                                             std::uint8_t destAddress,
@@ -689,6 +1097,17 @@ namespace isobus
 	{
 		if (nullptr != message)
 		{
+			latestValueCache.record(*message);
+
+			{
+				const std::lock_guard<std::mutex> lock(signalDatabaseMutex);
+
+				if (nullptr != signalDatabase)
+				{
+					signalDatabase->stage(*message, SystemTiming::get_timestamp_us(), signalBatch);
+				}
+			}
+
 			ControlFunction *messageDestination = message->get_destination_control_function();
 			if ((nullptr == messageDestination) &&
 			    ((nullptr != message->get_source_control_function()) ||
@@ -747,6 +1166,16 @@ namespace isobus
 
 			update_address_table(currentMessage);
 
+			if (static_cast<std::uint32_t>(CANLibParameterGroupNumber::AddressClaim) == currentMessage.get_identifier().get_parameter_group_number())
+			{
+				update_provisional_partners(&currentMessage);
+			}
+
+			if (static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage13) == currentMessage.get_identifier().get_parameter_group_number())
+			{
+				process_dm13_message(currentMessage);
+			}
+
 			// Update Special Callbacks, like protocols and non-cf specific ones
 			process_protocol_pgn_callbacks(currentMessage);
 			process_any_control_function_pgn_callbacks(currentMessage);
@@ -756,6 +1185,151 @@ namespace isobus
 		}
 	}
 
+	void CANNetworkManager::defer_broadcast(std::uint32_t parameterGroupNumber,
+	                                        const std::uint8_t *dataBuffer,
+	                                        std::uint32_t dataLength,
+	                                        InternalControlFunction *sourceControlFunction,
+	                                        CANIdentifier::CANPriority priority,
+	                                        TransmitCompleteCallback transmitCompleteCallback,
+	                                        void *parentPointer)
+	{
+		TransmitCompleteCallback replacedCallback = nullptr;
+		void *replacedParent = nullptr;
+		std::uint32_t replacedDataLength = 0;
+
+		{
+			const std::lock_guard<std::mutex> lock(broadcastSuspensionMutex);
+			auto deferredMessage = std::find_if(deferredBroadcasts.begin(), deferredBroadcasts.end(), [parameterGroupNumber, sourceControlFunction](const DeferredBroadcast &message) {
+				return (message.parameterGroupNumber == parameterGroupNumber) && (message.source == sourceControlFunction);
+			});
+
+			if (deferredBroadcasts.end() == deferredMessage)
+			{
+				deferredBroadcasts.emplace_back();
+				deferredMessage = std::prev(deferredBroadcasts.end());
+			}
+			else
+			{
+				replacedCallback = deferredMessage->txCompleteCallback;
+				replacedParent = deferredMessage->parentPointer;
+				replacedDataLength = static_cast<std::uint32_t>(deferredMessage->data.size());
+			}
+
+			// Only the latest value of each PGN is worth sending once broadcasts resume
+			deferredMessage->data.assign(dataBuffer, dataBuffer + dataLength);
+			deferredMessage->source = sourceControlFunction;
+			deferredMessage->txCompleteCallback = transmitCompleteCallback;
+			deferredMessage->parentPointer = parentPointer;
+			deferredMessage->parameterGroupNumber = parameterGroupNumber;
+			deferredMessage->priority = priority;
+			deferredMessage->canPort = sourceControlFunction->get_can_port();
+		}
+
+		// The replaced message will never be sent. Called without the lock, in case the callback sends another broadcast.
+		if (nullptr != replacedCallback)
+		{
+			replacedCallback(parameterGroupNumber, replacedDataLength, sourceControlFunction, nullptr, false, replacedParent);
+		}
+	}
+
+	void CANNetworkManager::process_dm13_message(CANMessage &message)
+	{
+		if ((BROADCAST_CAN_ADDRESS == message.get_identifier().get_destination_address()) ||
+		    ((nullptr != message.get_destination_control_function()) &&
+		     (ControlFunction::Type::Internal == message.get_destination_control_function()->get_type())))
+		{
+			const std::lock_guard<std::mutex> lock(broadcastSuspensionMutex);
+			std::uint32_t newNetworkStates = broadcastSuspensionBitfield;
+			std::uint32_t stoppedNetworks = 0;
+
+			if (DiagnosticProtocol::parse_j1939_network_states(&message, newNetworkStates))
+			{
+				// Parsed again from nothing, so that only the channels this DM13 stops get a new timeout
+				DiagnosticProtocol::parse_j1939_network_states(&message, stoppedNetworks);
+
+				for (std::uint8_t i = 0; i < CAN_PORT_MAXIMUM; i++)
+				{
+					const std::uint32_t portBit = (1u << i);
+
+					if (0 != (stoppedNetworks & portBit))
+					{
+						lastDM13ReceivedTimestamp_ms[i] = SystemTiming::get_timestamp_ms();
+					}
+
+					if ((0 != (newNetworkStates & portBit)) &&
+					    (0 == (broadcastSuspensionBitfield & portBit)))
+					{
+						broadcastSuspensionStatistics[i].suspensionCount++;
+						CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Info, "[NM]: Broadcasts suspended by DM13 on channel " + isobus::to_string(static_cast<int>(i)));
+					}
+					else if ((0 == (newNetworkStates & portBit)) &&
+					         (0 != (broadcastSuspensionBitfield & portBit)))
+					{
+						CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Info, "[NM]: Broadcasts resumed by DM13 on channel " + isobus::to_string(static_cast<int>(i)));
+					}
+				}
+				broadcastSuspensionBitfield = newNetworkStates;
+			}
+		}
+	}
+
+	void CANNetworkManager::update_broadcast_suspension()
+	{
+		std::list<DeferredBroadcast> resumedBroadcasts;
+
+		{
+			const std::lock_guard<std::mutex> lock(broadcastSuspensionMutex);
+
+			for (std::uint8_t i = 0; i < CAN_PORT_MAXIMUM; i++)
+			{
+				const std::uint32_t portBit = (1u << i);
+
+				if ((0 != (broadcastSuspensionBitfield & portBit)) &&
+				    (SystemTiming::time_expired_ms(lastDM13ReceivedTimestamp_ms[i], DM13_TIMEOUT_MS)))
+				{
+					broadcastSuspensionBitfield &= ~portBit;
+					CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Info, "[NM]: DM13 broadcast suspension timed out on channel " + isobus::to_string(static_cast<int>(i)) + ", resuming broadcasts");
+				}
+			}
+
+			for (auto deferredMessage = deferredBroadcasts.begin(); deferredMessage != deferredBroadcasts.end();)
+			{
+				if (0 == (broadcastSuspensionBitfield & (1u << deferredMessage->canPort)))
+				{
+					auto resumedMessage = deferredMessage;
+					deferredMessage++;
+					resumedBroadcasts.splice(resumedBroadcasts.end(), deferredBroadcasts, resumedMessage);
+				}
+				else
+				{
+					deferredMessage++;
+				}
+			}
+		}
+
+		for (auto &message : resumedBroadcasts)
+		{
+			bool sourceStillExists = false;
+
+			// The source may have been deleted while its message was waiting
+			for (std::size_t i = 0; i < InternalControlFunction::get_number_internal_control_functions(); i++)
+			{
+				if (InternalControlFunction::get_internal_control_function(i) == message.source)
+				{
+					sourceStillExists = true;
+					break;
+				}
+			}
+
+			if ((sourceStillExists) &&
+			    (send_can_message(message.parameterGroupNumber, message.data.data(), message.data.size(), message.source, nullptr, message.priority, message.txCompleteCallback, message.parentPointer)))
+			{
+				const std::lock_guard<std::mutex> lock(broadcastSuspensionMutex);
+				broadcastSuspensionStatistics[message.canPort].sentDeferredMessages++;
+			}
+		}
+	}
+
 	bool CANNetworkManager::send_can_message_raw(std::uint32_t portIndex, std::uint8_t sourceAddress, std::uint8_t destAddress, std::uint32_t parameterGroupNumber, std::uint8_t priority, const void *data, std::uint32_t size)
 	{
 		HardwareInterfaceCANFrame tempFrame = construct_frame(portIndex, sourceAddress, destAddress, parameterGroupNumber, priority, data, size);
@@ -0,0 +1,370 @@
+//================================================================================================
+/// @file can_network_snapshot.cpp
+///
+/// @brief A small persisted record of the network as it was last seen, which lets the stack
+/// warm-start by reusing claimed addresses, partner addresses, and VT version labels.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#include "isobus/isobus/can_network_snapshot.hpp"
+
+#include "isobus/isobus/can_constants.hpp"
+#include "isobus/isobus/can_internal_control_function.hpp"
+#include "isobus/isobus/can_partnered_control_function.hpp"
+#include "isobus/isobus/can_stack_logger.hpp"
+#include "isobus/utility/replace_file.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace isobus
+{
+	constexpr std::uint32_t NetworkSnapshot::FILE_FORMAT_VERSION;
+
+	NetworkSnapshot::NetworkSnapshot()
+	{
+	}
+
+	bool NetworkSnapshot::load(const std::string &filename)
+	{
+		std::ifstream inputFile(filename);
+		std::vector<AddressEntry> loadedInternalControlFunctions;
+		std::vector<AddressEntry> loadedPartners;
+		std::vector<VersionLabelEntry> loadedVersionLabels;
+		bool retVal = false;
+
+		if (inputFile.is_open())
+		{
+			std::string line;
+			std::string fileType;
+			std::uint32_t fileVersion = 0;
+
+			if ((std::getline(inputFile, line)) &&
+			    (std::istringstream(line) >> fileType >> fileVersion) &&
+			    ("isobus-network-snapshot" == fileType) &&
+			    (FILE_FORMAT_VERSION == fileVersion))
+			{
+				retVal = true;
+
+				while (retVal && std::getline(inputFile, line))
+				{
+					std::istringstream lineStream(line);
+					std::string entryType;
+					std::uint64_t entryNAME = 0;
+
+					if (!(lineStream >> entryType))
+					{
+						continue; // Blank line
+					}
+
+					if (("icf" == entryType) || ("partner" == entryType))
+					{
+						std::uint32_t canPort = 0;
+						std::uint32_t address = 0;
+
+						if ((lineStream >> canPort >> std::hex >> entryNAME >> std::dec >> address) &&
+						    (canPort < CAN_PORT_MAXIMUM) &&
+						    (address < NULL_CAN_ADDRESS))
+						{
+							AddressEntry entry;
+							entry.NAME = entryNAME;
+							entry.canPort = static_cast<std::uint8_t>(canPort);
+							entry.address = static_cast<std::uint8_t>(address);
+
+							if ("icf" == entryType)
+							{
+								loadedInternalControlFunctions.push_back(entry);
+							}
+							else
+							{
+								loadedPartners.push_back(entry);
+							}
+						}
+						else
+						{
+							retVal = false;
+						}
+					}
+					else if ("vt" == entryType)
+					{
+						std::string encodedLabel;
+
+						// The label may contain spaces, so it's stored as hex
+						if ((lineStream >> std::hex >> entryNAME >> encodedLabel) &&
+						    (0 == (encodedLabel.size() % 2)))
+						{
+							VersionLabelEntry entry;
+							entry.NAME = entryNAME;
+
+							for (std::size_t i = 0; (i < encodedLabel.size()) && retVal; i += 2)
+							{
+								char *end = nullptr;
+								const std::string encodedByte = encodedLabel.substr(i, 2);
+								const unsigned long decodedByte = std::strtoul(encodedByte.c_str(), &end, 16);
+
+								if ((nullptr != end) && ('\0' == *end))
+								{
+									entry.versionLabel.push_back(static_cast<char>(decodedByte));
+								}
+								else
+								{
+									retVal = false;
+								}
+							}
+							loadedVersionLabels.push_back(entry);
+						}
+						else
+						{
+							retVal = false;
+						}
+					}
+					// Lines of unknown types are ignored, so that newer files can still be read
+				}
+			}
+		}
+
+		const std::lock_guard<std::mutex> lock(snapshotMutex);
+		internalControlFunctionEntries.clear();
+		partnerEntries.clear();
+		versionLabelEntries.clear();
+
+		if (retVal)
+		{
+			internalControlFunctionEntries = loadedInternalControlFunctions;
+			partnerEntries = loadedPartners;
+			versionLabelEntries = loadedVersionLabels;
+		}
+		else
+		{
+			CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[NM]: Unable to load network snapshot " + filename + ", starting without one");
+		}
+		return retVal;
+	}
+
+	bool NetworkSnapshot::save(const std::string &filename) const
+	{
+		const std::string temporaryFilename = filename + ".tmp";
+		std::ostringstream contents;
+		bool retVal = false;
+
+		{
+			const std::lock_guard<std::mutex> lock(snapshotMutex);
+
+			contents << "isobus-network-snapshot " << FILE_FORMAT_VERSION << "\n";
+
+			for (const auto &entry : internalControlFunctionEntries)
+			{
+				contents << "icf " << static_cast<std::uint32_t>(entry.canPort) << " " << std::hex << entry.NAME << std::dec << " " << static_cast<std::uint32_t>(entry.address) << "\n";
+			}
+			for (const auto &entry : partnerEntries)
+			{
+				contents << "partner " << static_cast<std::uint32_t>(entry.canPort) << " " << std::hex << entry.NAME << std::dec << " " << static_cast<std::uint32_t>(entry.address) << "\n";
+			}
+			for (const auto &entry : versionLabelEntries)
+			{
+				contents << "vt " << std::hex << entry.NAME << " ";
+
+				for (const char labelCharacter : entry.versionLabel)
+				{
+					const std::uint32_t labelByte = static_cast<std::uint8_t>(labelCharacter);
+					contents << ((labelByte < 0x10) ? "0" : "") << labelByte;
+				}
+				contents << std::dec << "\n";
+			}
+		}
+
+		std::FILE *temporaryFile = std::fopen(temporaryFilename.c_str(), "w");
+
+		if (nullptr != temporaryFile)
+		{
+			const std::string fileContents = contents.str();
+			bool written = ((fileContents.size() == std::fwrite(fileContents.data(), 1, fileContents.size(), temporaryFile)) &&
+			                (0 == std::fflush(temporaryFile)));
+			written = (0 == std::fclose(temporaryFile)) && written;
+
+			if (written)
+			{
+				retVal = replace_file(temporaryFilename, filename);
+			}
+		}
+
+		if (!retVal)
+		{
+			std::remove(temporaryFilename.c_str());
+			CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[NM]: Failed to save network snapshot " + filename);
+		}
+		return retVal;
+	}
+
+	void NetworkSnapshot::capture()
+	{
+		for (std::uint32_t i = 0; i < InternalControlFunction::get_number_internal_control_functions(); i++)
+		{
+			const InternalControlFunction *currentControlFunction = InternalControlFunction::get_internal_control_function(i);
+
+			if ((nullptr != currentControlFunction) &&
+			    (currentControlFunction->get_address_valid()))
+			{
+				set_internal_control_function_address(currentControlFunction->get_can_port(), currentControlFunction->get_NAME(), currentControlFunction->get_address());
+			}
+		}
+
+		for (std::size_t i = 0; i < PartneredControlFunction::get_number_partnered_control_functions(); i++)
+		{
+			const PartneredControlFunction *currentPartner = PartneredControlFunction::get_partnered_control_function(i);
+
+			if ((nullptr != currentPartner) &&
+			    (currentPartner->get_address_valid()))
+			{
+				set_partner_address(currentPartner->get_can_port(), currentPartner->get_NAME(), currentPartner->get_address());
+			}
+		}
+	}
+
+	void NetworkSnapshot::clear()
+	{
+		const std::lock_guard<std::mutex> lock(snapshotMutex);
+		internalControlFunctionEntries.clear();
+		partnerEntries.clear();
+		versionLabelEntries.clear();
+	}
+
+	void NetworkSnapshot::set_internal_control_function_address(std::uint8_t canPort, NAME controlFunctionNAME, std::uint8_t address)
+	{
+		const std::lock_guard<std::mutex> lock(snapshotMutex);
+		set_address_entry(internalControlFunctionEntries, canPort, controlFunctionNAME.get_full_name(), address);
+	}
+
+	std::uint8_t NetworkSnapshot::get_internal_control_function_address(std::uint8_t canPort, NAME controlFunctionNAME) const
+	{
+		std::uint8_t retVal = NULL_CAN_ADDRESS;
+		const std::lock_guard<std::mutex> lock(snapshotMutex);
+
+		for (const auto &entry : internalControlFunctionEntries)
+		{
+			if ((canPort == entry.canPort) &&
+			    (controlFunctionNAME.get_full_name() == entry.NAME))
+			{
+				retVal = entry.address;
+				break;
+			}
+		}
+		return retVal;
+	}
+
+	void NetworkSnapshot::set_partner_address(std::uint8_t canPort, NAME controlFunctionNAME, std::uint8_t address)
+	{
+		const std::lock_guard<std::mutex> lock(snapshotMutex);
+		set_address_entry(partnerEntries, canPort, controlFunctionNAME.get_full_name(), address);
+	}
+
+	bool NetworkSnapshot::get_partner_address(const PartneredControlFunction &partner, NAME &controlFunctionNAME, std::uint8_t &address) const
+	{
+		bool retVal = false;
+		const std::lock_guard<std::mutex> lock(snapshotMutex);
+
+		for (const auto &entry : partnerEntries)
+		{
+			if ((partner.get_can_port() == entry.canPort) &&
+			    (partner.check_matches_name(NAME(entry.NAME))))
+			{
+				controlFunctionNAME = NAME(entry.NAME);
+				address = entry.address;
+				retVal = true;
+				break;
+			}
+		}
+		return retVal;
+	}
+
+	void NetworkSnapshot::set_vt_version_label(NAME virtualTerminalNAME, const std::string &versionLabel)
+	{
+		const std::lock_guard<std::mutex> lock(snapshotMutex);
+		bool found = false;
+
+		for (auto entry = versionLabelEntries.begin(); entry != versionLabelEntries.end(); entry++)
+		{
+			if (virtualTerminalNAME.get_full_name() == entry->NAME)
+			{
+				if (versionLabel.empty())
+				{
+					versionLabelEntries.erase(entry);
+				}
+				else
+				{
+					entry->versionLabel = versionLabel;
+				}
+				found = true;
+				break;
+			}
+		}
+
+		if ((!found) && (!versionLabel.empty()))
+		{
+			VersionLabelEntry entry;
+			entry.NAME = virtualTerminalNAME.get_full_name();
+			entry.versionLabel = versionLabel;
+			versionLabelEntries.push_back(entry);
+		}
+	}
+
+	std::string NetworkSnapshot::get_vt_version_label(NAME virtualTerminalNAME) const
+	{
+		std::string retVal;
+		const std::lock_guard<std::mutex> lock(snapshotMutex);
+
+		for (const auto &entry : versionLabelEntries)
+		{
+			if (virtualTerminalNAME.get_full_name() == entry.NAME)
+			{
+				retVal = entry.versionLabel;
+				break;
+			}
+		}
+		return retVal;
+	}
+
+	std::size_t NetworkSnapshot::get_number_internal_control_functions() const
+	{
+		const std::lock_guard<std::mutex> lock(snapshotMutex);
+		return internalControlFunctionEntries.size();
+	}
+
+	std::size_t NetworkSnapshot::get_number_partners() const
+	{
+		const std::lock_guard<std::mutex> lock(snapshotMutex);
+		return partnerEntries.size();
+	}
+
+	void NetworkSnapshot::set_address_entry(std::vector<AddressEntry> &entries, std::uint8_t canPort, std::uint64_t controlFunctionNAME, std::uint8_t address)
+	{
+		bool found = false;
+
+		if ((canPort < CAN_PORT_MAXIMUM) && (address < NULL_CAN_ADDRESS))
+		{
+			for (auto &entry : entries)
+			{
+				if ((canPort == entry.canPort) &&
+				    (controlFunctionNAME == entry.NAME))
+				{
+					entry.address = address;
+					found = true;
+					break;
+				}
+			}
+
+			if (!found)
+			{
+				AddressEntry entry;
+				entry.NAME = controlFunctionNAME;
+				entry.canPort = canPort;
+				entry.address = address;
+				entries.push_back(entry);
+			}
+		}
+	}
+} // namespace isobus
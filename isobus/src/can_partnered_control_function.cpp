@@ -19,16 +19,50 @@ namespace isobus
 {
 	std::vector<PartneredControlFunction *> PartneredControlFunction::partneredControlFunctionList;
 	bool PartneredControlFunction::anyPartnerNeedsInitializing = false;
+	std::array<PartneredControlFunction::CompiledNAMEFilters, CAN_PORT_MAXIMUM> PartneredControlFunction::compiledNAMEFilters;
+	constexpr std::size_t PartneredControlFunction::NAME_MATCH_BLOCK_SIZE;
 
 	PartneredControlFunction::PartneredControlFunction(std::uint8_t CANPort, const std::vector<NAMEFilter> NAMEFilters) :
 	  ControlFunction(NAME(0), NULL_CAN_ADDRESS, CANPort),
 	  NAMEFilterList(NAMEFilters),
+	  NAMEFilterMask(0),
+	  NAMEFilterValue(0),
 	  initialized(false)
 	{
 		const std::lock_guard<std::mutex> lock(ControlFunction::controlFunctionProcessingMutex);
 		bool emptyPartnerSlotFound = false;
+		bool canMatch = !NAMEFilterList.empty();
 		controlFunctionType = Type::Partnered;
 
+		// All filters must match, so combine them into one mask and value
+		for (const auto &filter : NAMEFilterList)
+		{
+			std::uint64_t filterMask;
+			std::uint64_t filterValue;
+
+			if (filter.get_name_mask(filterMask, filterValue))
+			{
+				// Two filters on the same component with different values can't both match
+				if ((NAMEFilterValue & filterMask) != (filterValue & NAMEFilterMask))
+				{
+					canMatch = false;
+				}
+				NAMEFilterMask |= filterMask;
+				NAMEFilterValue |= filterValue;
+			}
+			else
+			{
+				canMatch = false;
+			}
+		}
+
+		if (!canMatch)
+		{
+			// No NAME has a bit set outside of a zero mask, so this never matches
+			NAMEFilterMask = 0;
+			NAMEFilterValue = 1;
+		}
+
 		for (auto &partner : partneredControlFunctionList)
 		{
 			if (nullptr == partner)
@@ -44,6 +78,7 @@ namespace isobus
 			partneredControlFunctionList.push_back(this);
 		}
 		anyPartnerNeedsInitializing = true;
+		compile_name_filters(CANPort);
 	}
 
 	PartneredControlFunction::~PartneredControlFunction()
@@ -51,6 +86,7 @@ namespace isobus
 		const std::lock_guard<std::mutex> lock(ControlFunction::controlFunctionProcessingMutex);
 		auto thisObject = std::find(partneredControlFunctionList.begin(), partneredControlFunctionList.end(), this);
 		*thisObject = nullptr; // Don't erase, in case the object was already deleted. Just make room for a new partner.
+		compile_name_filters(get_can_port());
 		CANNetworkManager::CANNetwork.on_partner_deleted(this, {}); // Tell the network manager to purge this partner from all tables
 	}
 
@@ -108,85 +144,41 @@ namespace isobus
 
 	bool PartneredControlFunction::check_matches_name(NAME NAMEToCheck) const
 	{
-		std::uint32_t currentFilterValue;
-		NAME::NAMEParameters currentFilterParameter;
-		bool retVal = true;
+		return ((NAMEToCheck.get_full_name() & NAMEFilterMask) == NAMEFilterValue);
+	}
 
-		if (0 == get_number_name_filters())
-		{
-			retVal = false;
-		}
+	PartneredControlFunction *PartneredControlFunction::find_partner_matching_name(std::uint8_t CANPort, NAME NAMEToCheck)
+	{
+		PartneredControlFunction *retVal = nullptr;
 
-		for (std::uint32_t i = 0; i < get_number_name_filters(); i++)
+		if (CANPort < CAN_PORT_MAXIMUM)
 		{
-			get_name_filter_parameter(i, currentFilterParameter, currentFilterValue);
+			const CompiledNAMEFilters &compiledFilters = compiledNAMEFilters[CANPort];
+			const std::uint64_t rawNAME = NAMEToCheck.get_full_name();
 
-			switch (currentFilterParameter)
+			for (std::size_t i = 0; (i < compiledFilters.masks.size()) && (nullptr == retVal); i += NAME_MATCH_BLOCK_SIZE)
 			{
-				case NAME::NAMEParameters::IdentityNumber:
-				{
-					retVal = (currentFilterValue == NAMEToCheck.get_identity_number());
-				}
-				break;
+				const std::uint64_t *masks = &compiledFilters.masks[i];
+				const std::uint64_t *values = &compiledFilters.values[i];
+				std::uint32_t matches = 0;
 
-				case NAME::NAMEParameters::ManufacturerCode:
+				// No early exit in here, so that the compiler can compare the whole block at once
+				for (std::size_t j = 0; j < NAME_MATCH_BLOCK_SIZE; j++)
 				{
-					retVal = (currentFilterValue == NAMEToCheck.get_manufacturer_code());
+					matches |= (static_cast<std::uint32_t>((rawNAME & masks[j]) == values[j]) << j);
 				}
-				break;
 
-				case NAME::NAMEParameters::EcuInstance:
+				if (0 != matches)
 				{
-					retVal = (currentFilterValue == NAMEToCheck.get_ecu_instance());
+					std::size_t firstMatch = 0;
+
+					while (0 == (matches & 0x01))
+					{
+						matches >>= 1;
+						firstMatch++;
+					}
+					retVal = compiledFilters.partners[i + firstMatch];
 				}
-				break;
-
-				case NAME::NAMEParameters::FunctionInstance:
-				{
-					retVal = (currentFilterValue == NAMEToCheck.get_function_instance());
-				}
-				break;
-
-				case NAME::NAMEParameters::FunctionCode:
-				{
-					retVal = (currentFilterValue == NAMEToCheck.get_function_code());
-				}
-				break;
-
-				case NAME::NAMEParameters::DeviceClass:
-				{
-					retVal = (currentFilterValue == NAMEToCheck.get_device_class());
-				}
-				break;
-
-				case NAME::NAMEParameters::DeviceClassInstance:
-				{
-					retVal = (currentFilterValue == NAMEToCheck.get_device_class_instance());
-				}
-				break;
-
-				case NAME::NAMEParameters::IndustryGroup:
-				{
-					retVal = (currentFilterValue == NAMEToCheck.get_industry_group());
-				}
-				break;
-
-				case NAME::NAMEParameters::ArbitraryAddressCapable:
-				{
-					retVal = ((0 != currentFilterValue) == NAMEToCheck.get_arbitrary_address_capable());
-				}
-				break;
-
-				default:
-				{
-					retVal = false;
-				}
-				break;
-			}
-
-			if (false == retVal)
-			{
-				break;
 			}
 		}
 		return retVal;
@@ -217,4 +209,34 @@ namespace isobus
 		return parameterGroupNumberCallbacks[index];
 	}
 
+	void PartneredControlFunction::compile_name_filters(std::uint8_t CANPort)
+	{
+		if (CANPort < CAN_PORT_MAXIMUM)
+		{
+			CompiledNAMEFilters &compiledFilters = compiledNAMEFilters[CANPort];
+
+			compiledFilters.masks.clear();
+			compiledFilters.values.clear();
+			compiledFilters.partners.clear();
+
+			for (auto partner : partneredControlFunctionList)
+			{
+				if ((nullptr != partner) && (CANPort == partner->get_can_port()))
+				{
+					compiledFilters.masks.push_back(partner->NAMEFilterMask);
+					compiledFilters.values.push_back(partner->NAMEFilterValue);
+					compiledFilters.partners.push_back(partner);
+				}
+			}
+
+			// Pad to whole blocks with entries that never match
+			while (0 != (compiledFilters.masks.size() % NAME_MATCH_BLOCK_SIZE))
+			{
+				compiledFilters.masks.push_back(0);
+				compiledFilters.values.push_back(1);
+				compiledFilters.partners.push_back(nullptr);
+			}
+		}
+	}
+
 } // namespace isobus
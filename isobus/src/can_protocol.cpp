@@ -57,4 +57,14 @@ namespace isobus
 		initialized = true;
 	}
 
+	bool CANLibProtocol::protocol_transmit_data_source(std::uint32_t,
+	                                                   std::shared_ptr<TransmitDataSource>,
+	                                                   ControlFunction *,
+	                                                   ControlFunction *,
+	                                                   TransmitCompleteCallback,
+	                                                   void *)
+	{
+		return false;
+	}
+
 } // namespace isobus
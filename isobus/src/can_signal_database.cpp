@@ -0,0 +1,646 @@
+//================================================================================================
+/// @file can_signal_database.cpp
+///
+/// @brief Loads signal definitions from a DBC file, and decodes batches of received messages
+/// into columns of physical values, for logging and gateways that handle many PGNs.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#include "isobus/isobus/can_signal_database.hpp"
+
+#include "isobus/isobus/can_constants.hpp"
+#include "isobus/isobus/can_identifier.hpp"
+#include "isobus/isobus/can_stack_logger.hpp"
+#include "isobus/utility/to_string.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace isobus
+{
+	constexpr std::uint16_t SignalDatabase::MAX_DATA_LENGTH;
+	constexpr std::uint16_t SignalDatabase::ROW_PADDING;
+
+	SignalDatabase::DecodedBatch::MessageRows::MessageRows() :
+	  decodedRows(0)
+	{
+	}
+
+	SignalDatabase::DecodedBatch::DecodedBatch() :
+	  stagedRows(0),
+	  database(nullptr)
+	{
+	}
+
+	std::size_t SignalDatabase::DecodedBatch::get_number_rows(std::size_t messageIndex) const
+	{
+		std::size_t retVal = 0;
+
+		if (messageIndex < messages.size())
+		{
+			retVal = messages[messageIndex].decodedRows;
+		}
+		return retVal;
+	}
+
+	const std::vector<double> &SignalDatabase::DecodedBatch::get_column(std::size_t messageIndex, std::size_t signalIndex) const
+	{
+		static const std::vector<double> EMPTY_COLUMN;
+
+		if ((messageIndex < messages.size()) &&
+		    (signalIndex < messages[messageIndex].columns.size()))
+		{
+			return messages[messageIndex].columns[signalIndex];
+		}
+		return EMPTY_COLUMN;
+	}
+
+	const std::vector<std::uint64_t> &SignalDatabase::DecodedBatch::get_timestamps(std::size_t messageIndex) const
+	{
+		static const std::vector<std::uint64_t> EMPTY_COLUMN;
+
+		if (messageIndex < messages.size())
+		{
+			return messages[messageIndex].timestamps;
+		}
+		return EMPTY_COLUMN;
+	}
+
+	const std::vector<std::uint8_t> &SignalDatabase::DecodedBatch::get_source_addresses(std::size_t messageIndex) const
+	{
+		static const std::vector<std::uint8_t> EMPTY_COLUMN;
+
+		if (messageIndex < messages.size())
+		{
+			return messages[messageIndex].sourceAddresses;
+		}
+		return EMPTY_COLUMN;
+	}
+
+	const std::vector<std::uint8_t> &SignalDatabase::DecodedBatch::get_can_ports(std::size_t messageIndex) const
+	{
+		static const std::vector<std::uint8_t> EMPTY_COLUMN;
+
+		if (messageIndex < messages.size())
+		{
+			return messages[messageIndex].canPorts;
+		}
+		return EMPTY_COLUMN;
+	}
+
+	std::size_t SignalDatabase::DecodedBatch::get_number_staged_rows() const
+	{
+		return stagedRows;
+	}
+
+	void SignalDatabase::DecodedBatch::clear()
+	{
+		for (auto &message : messages)
+		{
+			message.payloads.clear();
+			message.timestamps.clear();
+			message.sourceAddresses.clear();
+			message.canPorts.clear();
+			message.decodedRows = 0;
+
+			for (auto &column : message.columns)
+			{
+				column.clear();
+			}
+		}
+		stagedRows = 0;
+	}
+
+	SignalDatabase::SignalDatabase()
+	{
+	}
+
+	bool SignalDatabase::load_file(const std::string &filename)
+	{
+		std::ifstream inputFile(filename);
+		bool retVal = false;
+
+		if (inputFile.is_open())
+		{
+			std::ostringstream contents;
+			contents << inputFile.rdbuf();
+			retVal = load_string(contents.str());
+		}
+		else
+		{
+			CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[DB]: Unable to open signal database " + filename);
+		}
+		return retVal;
+	}
+
+	bool SignalDatabase::load_string(const std::string &dbcText)
+	{
+		std::istringstream input(dbcText);
+		std::string line;
+		MessageDefinition *currentMessage = nullptr;
+
+		messages.clear();
+		decoders.clear();
+		messageIndices.clear();
+
+		while (std::getline(input, line))
+		{
+			std::istringstream lineStream(line);
+			std::string keyword;
+
+			if (!(lineStream >> keyword))
+			{
+				continue; // Blank line
+			}
+
+			if ("BO_" == keyword)
+			{
+				std::uint64_t identifier = 0;
+				std::string messageName;
+				std::uint32_t dataLength = 0;
+				currentMessage = nullptr;
+
+				if ((lineStream >> identifier >> messageName >> dataLength) &&
+				    (!messageName.empty()) &&
+				    (':' == messageName.back()) &&
+				    (dataLength > 0) &&
+				    (dataLength <= MAX_DATA_LENGTH))
+				{
+					constexpr std::uint64_t DBC_EXTENDED_IDENTIFIER_FLAG = 0x80000000;
+
+					// DBC files mark 29 bit identifiers with the top bit, 11 bit identifiers aren't J1939 or ISO 11783
+					if (0 != (identifier & DBC_EXTENDED_IDENTIFIER_FLAG))
+					{
+						const CANIdentifier messageIdentifier(static_cast<std::uint32_t>(identifier & 0x1FFFFFFF));
+						const std::uint32_t parameterGroupNumber = messageIdentifier.get_parameter_group_number();
+
+						if (messageIndices.end() == messageIndices.find(parameterGroupNumber))
+						{
+							MessageDefinition newMessage;
+							newMessage.name = messageName.substr(0, messageName.size() - 1);
+							newMessage.parameterGroupNumber = parameterGroupNumber;
+							newMessage.dataLength = static_cast<std::uint16_t>(dataLength);
+							messageIndices[parameterGroupNumber] = messages.size();
+							messages.push_back(newMessage);
+							currentMessage = &messages.back();
+						}
+						else
+						{
+							CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[DB]: Ignoring message " + messageName + " since its PGN is already defined");
+						}
+					}
+				}
+			}
+			else if (("SG_" == keyword) && (nullptr != currentMessage))
+			{
+				SignalDefinition signal;
+
+				if (parse_signal(line, signal))
+				{
+					currentMessage->signals.push_back(signal);
+				}
+				else
+				{
+					CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[DB]: Unable to parse signal in message " + currentMessage->name + ": " + line);
+				}
+			}
+		}
+
+		// Build the decode tables now that every signal has been read
+		for (auto &message : messages)
+		{
+			MessageDecoder messageDecoder;
+			messageDecoder.rowStride = message.dataLength + ROW_PADDING;
+			messageDecoder.multiplexorIndex = -1;
+
+			auto signal = message.signals.begin();
+			while (signal != message.signals.end())
+			{
+				SignalDecoder signalDecoder;
+
+				if (build_decoder(*signal, message.dataLength, signalDecoder))
+				{
+					if (signal->isMultiplexor)
+					{
+						messageDecoder.multiplexorIndex = static_cast<std::int32_t>(messageDecoder.signals.size());
+					}
+					messageDecoder.signals.push_back(signalDecoder);
+					signal++;
+				}
+				else
+				{
+					CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[DB]: Skipping signal " + signal->name + " in message " + message.name + ", it doesn't fit in the message or spans more than 8 bytes");
+					signal = message.signals.erase(signal);
+				}
+			}
+			decoders.push_back(messageDecoder);
+		}
+
+		if (messages.empty())
+		{
+			CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[DB]: Signal database has no usable messages");
+		}
+		else
+		{
+			CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Info, "[DB]: Loaded " + isobus::to_string(static_cast<int>(messages.size())) + " messages into the signal database");
+		}
+		return (!messages.empty());
+	}
+
+	std::size_t SignalDatabase::get_number_messages() const
+	{
+		return messages.size();
+	}
+
+	const SignalDatabase::MessageDefinition &SignalDatabase::get_message(std::size_t messageIndex) const
+	{
+		return messages.at(messageIndex);
+	}
+
+	bool SignalDatabase::get_message_index(std::uint32_t parameterGroupNumber, std::size_t &messageIndex) const
+	{
+		bool retVal = false;
+		auto message = messageIndices.find(parameterGroupNumber);
+
+		if (messageIndices.end() != message)
+		{
+			messageIndex = message->second;
+			retVal = true;
+		}
+		return retVal;
+	}
+
+	bool SignalDatabase::get_signal_index(std::size_t messageIndex, const std::string &signalName, std::size_t &signalIndex) const
+	{
+		bool retVal = false;
+
+		if (messageIndex < messages.size())
+		{
+			const std::vector<SignalDefinition> &signals = messages[messageIndex].signals;
+
+			for (std::size_t i = 0; i < signals.size(); i++)
+			{
+				if (signalName == signals[i].name)
+				{
+					signalIndex = i;
+					retVal = true;
+					break;
+				}
+			}
+		}
+		return retVal;
+	}
+
+	bool SignalDatabase::stage(CANMessage &message, std::uint64_t timestamp_us, DecodedBatch &batch) const
+	{
+		const CANIdentifier identifier = message.get_identifier();
+		std::size_t messageIndex = 0;
+		bool retVal = false;
+
+		if ((CANIdentifier::Type::Extended == identifier.get_identifier_type()) &&
+		    (get_message_index(identifier.get_parameter_group_number(), messageIndex)))
+		{
+			const std::vector<std::uint8_t> &data = message.get_data();
+
+			prepare_batch(batch);
+			stage_payload(messageIndex,
+			              data.data(),
+			              std::min<std::size_t>(data.size(), message.get_data_length()),
+			              timestamp_us,
+			              identifier.get_source_address(),
+			              message.get_can_port_index(),
+			              batch);
+			retVal = true;
+		}
+		return retVal;
+	}
+
+	bool SignalDatabase::stage(const HardwareInterfaceCANFrame &frame, DecodedBatch &batch) const
+	{
+		std::size_t messageIndex = 0;
+		bool retVal = false;
+
+		if (frame.isExtendedFrame)
+		{
+			const CANIdentifier identifier(frame.identifier);
+
+			if (get_message_index(identifier.get_parameter_group_number(), messageIndex))
+			{
+				prepare_batch(batch);
+				stage_payload(messageIndex,
+				              frame.data,
+				              std::min<std::size_t>(frame.dataLength, CAN_DATA_LENGTH),
+				              frame.timestamp_us,
+				              identifier.get_source_address(),
+				              frame.channel,
+				              batch);
+				retVal = true;
+			}
+		}
+		return retVal;
+	}
+
+	void SignalDatabase::decode(DecodedBatch &batch) const
+	{
+		prepare_batch(batch);
+
+		for (std::size_t i = 0; i < decoders.size(); i++)
+		{
+			const MessageDecoder &messageDecoder = decoders[i];
+			DecodedBatch::MessageRows &rows = batch.messages[i];
+			const std::size_t firstRow = rows.decodedRows;
+			const std::size_t numberOfRows = rows.timestamps.size();
+
+			if (firstRow >= numberOfRows)
+			{
+				continue;
+			}
+
+			const std::uint8_t *payloads = rows.payloads.data();
+			const std::size_t rowStride = messageDecoder.rowStride;
+
+			if (messageDecoder.multiplexorIndex >= 0)
+			{
+				const SignalDecoder &multiplexor = messageDecoder.signals[static_cast<std::size_t>(messageDecoder.multiplexorIndex)];
+				batch.multiplexorValues.resize(numberOfRows);
+
+				for (std::size_t row = firstRow; row < numberOfRows; row++)
+				{
+					batch.multiplexorValues[row] = read_raw_value(multiplexor, payloads + (row * rowStride));
+				}
+			}
+
+			// One signal at a time down all the new rows, so each loop is the same shift, mask, and scale over contiguous rows
+			for (std::size_t j = 0; j < messageDecoder.signals.size(); j++)
+			{
+				const SignalDecoder &signalDecoder = messageDecoder.signals[j];
+				std::vector<double> &column = rows.columns[j];
+				column.resize(numberOfRows);
+				double *values = column.data();
+
+				if (0 != signalDecoder.signBit)
+				{
+					for (std::size_t row = firstRow; row < numberOfRows; row++)
+					{
+						const std::uint64_t rawValue = read_raw_value(signalDecoder, payloads + (row * rowStride));
+						const std::int64_t signedValue = static_cast<std::int64_t>((rawValue ^ signalDecoder.signBit) - signalDecoder.signBit);
+						values[row] = (static_cast<double>(signedValue) * signalDecoder.scale) + signalDecoder.offset;
+					}
+				}
+				else
+				{
+					for (std::size_t row = firstRow; row < numberOfRows; row++)
+					{
+						const std::uint64_t rawValue = read_raw_value(signalDecoder, payloads + (row * rowStride));
+						values[row] = (static_cast<double>(rawValue) * signalDecoder.scale) + signalDecoder.offset;
+					}
+				}
+
+				if ((signalDecoder.multiplexValue >= 0) &&
+				    (messageDecoder.multiplexorIndex >= 0))
+				{
+					const std::uint64_t multiplexValue = static_cast<std::uint64_t>(signalDecoder.multiplexValue);
+
+					for (std::size_t row = firstRow; row < numberOfRows; row++)
+					{
+						values[row] = (multiplexValue == batch.multiplexorValues[row]) ? values[row] : std::numeric_limits<double>::quiet_NaN();
+					}
+				}
+			}
+			batch.stagedRows -= (numberOfRows - firstRow);
+			rows.decodedRows = numberOfRows;
+		}
+	}
+
+	std::size_t SignalDatabase::decode_frames(const HardwareInterfaceCANFrame *frames, std::size_t numberOfFrames, DecodedBatch &batch) const
+	{
+		std::size_t retVal = 0;
+
+		if (nullptr != frames)
+		{
+			for (std::size_t i = 0; i < numberOfFrames; i++)
+			{
+				if (stage(frames[i], batch))
+				{
+					retVal++;
+				}
+			}
+			decode(batch);
+		}
+		return retVal;
+	}
+
+	std::size_t SignalDatabase::decode_messages(CANMessage *messages, std::size_t numberOfMessages, std::uint64_t timestamp_us, DecodedBatch &batch) const
+	{
+		std::size_t retVal = 0;
+
+		if (nullptr != messages)
+		{
+			for (std::size_t i = 0; i < numberOfMessages; i++)
+			{
+				if (stage(messages[i], timestamp_us, batch))
+				{
+					retVal++;
+				}
+			}
+			decode(batch);
+		}
+		return retVal;
+	}
+
+	bool SignalDatabase::parse_signal(const std::string &line, SignalDefinition &signal)
+	{
+		// SG_ <name> [M|m<value>] : <start>|<length>@<order><sign> (<scale>,<offset>) [<min>|<max>] "<unit>" <receivers>
+		const std::size_t colonPosition = line.find(':');
+		bool retVal = false;
+
+		if (std::string::npos != colonPosition)
+		{
+			std::istringstream nameStream(line.substr(0, colonPosition));
+			std::string keyword;
+			std::string multiplexIndicator;
+
+			signal.isMultiplexor = false;
+			signal.multiplexValue = -1;
+
+			if (nameStream >> keyword >> signal.name)
+			{
+				retVal = true;
+
+				if (nameStream >> multiplexIndicator)
+				{
+					if ("M" == multiplexIndicator)
+					{
+						signal.isMultiplexor = true;
+					}
+					else if ((multiplexIndicator.size() > 1) &&
+					         ('m' == multiplexIndicator[0]) &&
+					         (std::string::npos == multiplexIndicator.find_first_not_of("0123456789", 1)))
+					{
+						signal.multiplexValue = static_cast<std::int32_t>(std::stol(multiplexIndicator.substr(1)));
+					}
+					else
+					{
+						retVal = false; // Extended multiplexing isn't supported
+					}
+				}
+			}
+
+			unsigned int startBit = 0;
+			unsigned int bitLength = 0;
+			char byteOrder = 0;
+			char sign = 0;
+			const std::string definition = line.substr(colonPosition + 1);
+
+			if (retVal &&
+			    (8 == std::sscanf(definition.c_str(),
+			                      " %u|%u@%c%c (%lf,%lf) [%lf|%lf]",
+			                      &startBit,
+			                      &bitLength,
+			                      &byteOrder,
+			                      &sign,
+			                      &signal.scale,
+			                      &signal.offset,
+			                      &signal.minimum,
+			                      &signal.maximum)) &&
+			    (bitLength > 0) &&
+			    (bitLength <= 64) &&
+			    (startBit < (MAX_DATA_LENGTH * 8)) &&
+			    (('0' == byteOrder) || ('1' == byteOrder)) &&
+			    (('+' == sign) || ('-' == sign)))
+			{
+				const std::size_t unitStart = definition.find('"');
+				const std::size_t unitEnd = (std::string::npos == unitStart) ? std::string::npos : definition.find('"', unitStart + 1);
+
+				signal.startBit = static_cast<std::uint16_t>(startBit);
+				signal.bitLength = static_cast<std::uint8_t>(bitLength);
+				signal.byteFormat = ('1' == byteOrder) ? CANMessage::ByteFormat::LittleEndian : CANMessage::ByteFormat::BigEndian;
+				signal.isSigned = ('-' == sign);
+
+				if (std::string::npos != unitEnd)
+				{
+					signal.unit = definition.substr(unitStart + 1, unitEnd - unitStart - 1);
+				}
+			}
+			else
+			{
+				retVal = false;
+			}
+		}
+		return retVal;
+	}
+
+	bool SignalDatabase::build_decoder(const SignalDefinition &signal, std::uint16_t dataLength, SignalDecoder &decoder)
+	{
+		bool retVal = false;
+
+		decoder.mask = (~static_cast<std::uint64_t>(0)) >> (64 - signal.bitLength);
+		decoder.signBit = signal.isSigned ? (static_cast<std::uint64_t>(1) << (signal.bitLength - 1)) : 0;
+		decoder.scale = signal.scale;
+		decoder.offset = signal.offset;
+		decoder.multiplexValue = signal.multiplexValue;
+
+		if (CANMessage::ByteFormat::LittleEndian == signal.byteFormat)
+		{
+			// The start bit is the LSB, and the signal counts up from there
+			const std::uint32_t lastBit = signal.startBit + signal.bitLength - 1U;
+
+			decoder.bigEndian = false;
+			decoder.windowByte = static_cast<std::uint16_t>(signal.startBit / 8);
+			decoder.shift = static_cast<std::uint8_t>(signal.startBit % 8);
+			retVal = (((signal.startBit % 8) + signal.bitLength) <= 64) &&
+			  ((lastBit / 8) < dataLength);
+		}
+		else
+		{
+			// The start bit is the MSB, and the signal counts down through each byte, then on to bit 7 of the next byte
+			std::uint32_t leastSignificantBit = signal.startBit;
+
+			for (std::uint8_t i = 1; i < signal.bitLength; i++)
+			{
+				leastSignificantBit = (0 == (leastSignificantBit % 8)) ? (leastSignificantBit + 15) : (leastSignificantBit - 1);
+			}
+
+			const std::uint32_t firstByte = signal.startBit / 8;
+			const std::uint32_t lastByte = leastSignificantBit / 8;
+
+			// Read big endian, the window holds the first byte at the top, so the signal is contiguous in it
+			decoder.bigEndian = true;
+			decoder.windowByte = static_cast<std::uint16_t>(firstByte);
+			decoder.shift = static_cast<std::uint8_t>(((7 - (lastByte - firstByte)) * 8) + (leastSignificantBit % 8));
+			retVal = ((lastByte - firstByte) < 8) &&
+			  (lastByte < dataLength);
+		}
+		return retVal;
+	}
+
+	std::uint64_t SignalDatabase::read_raw_value(const SignalDecoder &decoder, const std::uint8_t *row)
+	{
+		const std::uint8_t *window = row + decoder.windowByte;
+		std::uint64_t windowValue = 0;
+
+		// Compilers turn these loops into a single load, plus a byte swap for big endian
+		if (decoder.bigEndian)
+		{
+			for (std::uint8_t i = 0; i < 8; i++)
+			{
+				windowValue |= (static_cast<std::uint64_t>(window[i]) << (8 * (7 - i)));
+			}
+		}
+		else
+		{
+			for (std::uint8_t i = 0; i < 8; i++)
+			{
+				windowValue |= (static_cast<std::uint64_t>(window[i]) << (8 * i));
+			}
+		}
+		return ((windowValue >> decoder.shift) & decoder.mask);
+	}
+
+	void SignalDatabase::prepare_batch(DecodedBatch &batch) const
+	{
+		if ((this != batch.database) ||
+		    (batch.messages.size() != decoders.size()))
+		{
+			batch.messages.clear();
+			batch.messages.resize(decoders.size());
+			batch.stagedRows = 0;
+			batch.database = this;
+		}
+
+		for (std::size_t i = 0; i < decoders.size(); i++)
+		{
+			if (batch.messages[i].columns.size() != decoders[i].signals.size())
+			{
+				batch.messages[i].columns.resize(decoders[i].signals.size());
+			}
+		}
+	}
+
+	void SignalDatabase::stage_payload(std::size_t messageIndex,
+	                                   const std::uint8_t *data,
+	                                   std::size_t dataLength,
+	                                   std::uint64_t timestamp_us,
+	                                   std::uint8_t sourceAddress,
+	                                   std::uint8_t canPort,
+	                                   DecodedBatch &batch) const
+	{
+		DecodedBatch::MessageRows &rows = batch.messages[messageIndex];
+		const std::size_t rowStride = decoders[messageIndex].rowStride;
+		const std::size_t rowStart = rows.payloads.size();
+		const std::size_t bytesToCopy = std::min<std::size_t>(dataLength, messages[messageIndex].dataLength);
+
+		// Bytes the sender didn't send read as "not available"
+		rows.payloads.resize(rowStart + rowStride, 0xFF);
+		std::copy(data, data + bytesToCopy, rows.payloads.begin() + rowStart);
+		rows.timestamps.push_back(timestamp_us);
+		rows.sourceAddresses.push_back(sourceAddress);
+		rows.canPorts.push_back(canPort);
+		batch.stagedRows++;
+	}
+} // namespace isobus
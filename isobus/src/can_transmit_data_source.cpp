@@ -0,0 +1,61 @@
+//================================================================================================
+/// @file can_transmit_data_source.cpp
+///
+/// @brief Implements the data sources protocols can read long message payloads from.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#include "isobus/isobus/can_transmit_data_source.hpp"
+#include "isobus/isobus/can_message.hpp"
+
+#include <cstring>
+
+namespace isobus
+{
+	const std::uint8_t *TransmitDataSource::get_data() const
+	{
+		return nullptr;
+	}
+
+	MemoryMappedFileDataSource::MemoryMappedFileDataSource(const std::string &filename)
+	{
+		file.open_read_only(filename);
+
+		if (file.get_size() > CANMessage::ABSOLUTE_MAX_MESSAGE_LENGTH)
+		{
+			// Can't ever be sent, so don't pretend we can
+			file.close();
+		}
+	}
+
+	bool MemoryMappedFileDataSource::get_is_valid() const
+	{
+		return file.get_is_open();
+	}
+
+	std::uint32_t MemoryMappedFileDataSource::get_size() const
+	{
+		return static_cast<std::uint32_t>(file.get_size());
+	}
+
+	const std::uint8_t *MemoryMappedFileDataSource::get_data() const
+	{
+		return file.get_data();
+	}
+
+	bool MemoryMappedFileDataSource::read(std::uint32_t offset, std::uint32_t length, std::uint8_t *destination)
+	{
+		bool retVal = false;
+
+		if ((nullptr != destination) &&
+		    (file.get_is_open()) &&
+		    (static_cast<std::uint64_t>(offset) + length <= file.get_size()))
+		{
+			memcpy(destination, file.get_data() + offset, length);
+			retVal = true;
+		}
+		return retVal;
+	}
+} // namespace isobus
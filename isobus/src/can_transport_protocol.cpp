@@ -18,6 +18,7 @@
 #include "isobus/utility/to_string.hpp"
 
 #include <algorithm>
+#include <cstring>
 
 namespace isobus
 {
@@ -26,11 +27,15 @@ namespace isobus
 	  sessionMessage(canPortIndex),
 	  sessionCompleteCallback(nullptr),
 	  frameChunkCallback(nullptr),
+	  windowBufferOffset(0),
+	  parent(nullptr),
 	  timestamp_ms(0),
 	  lastPacketNumber(0),
 	  packetCount(0),
 	  processedPacketsThisSession(0),
 	  clearToSendPacketMax(0),
+	  retransmitRequests(0),
+	  retransmitPending(false),
 	  sessionDirection(sessionDirection)
 	{
 	}
@@ -168,10 +173,36 @@ namespace isobus
 							    (nullptr != message->get_source_control_function()))
 							{
 								const std::uint8_t packetsToBeSent = data[1];
+								const std::uint8_t nextPacketNumber = data[2];
 
 								if (get_session(session, message->get_destination_control_function(), message->get_source_control_function(), pgn))
 								{
-									if (StateMachineState::WaitForClearToSend == session->state)
+									if (((StateMachineState::WaitForClearToSend == session->state) ||
+									     (StateMachineState::TxDataSession == session->state) ||
+									     (StateMachineState::WaitForEndOfMessageAcknowledge == session->state)) &&
+									    (0 != CANNetworkConfiguration::get_max_number_transport_protocol_retransmit_requests()) &&
+									    (0 != packetsToBeSent) &&
+									    (0 != nextPacketNumber) &&
+									    (nextPacketNumber <= session->processedPacketsThisSession))
+									{
+										// The receiver is asking us to go back and resend some packets
+										if (session->retransmitRequests < CANNetworkConfiguration::get_max_number_transport_protocol_retransmit_requests())
+										{
+											CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[TP]: Retransmitting from packet " + isobus::to_string(static_cast<int>(nextPacketNumber)) + ", PGN: " + isobus::to_string(pgn));
+											session->retransmitRequests++;
+											session->processedPacketsThisSession = (nextPacketNumber - 1);
+											session->packetCount = packetsToBeSent;
+											session->lastPacketNumber = 0;
+											set_state(session, StateMachineState::TxDataSession);
+										}
+										else
+										{
+											CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[TP]: Sent abort, retransmit request limit reached, PGN: " + isobus::to_string(pgn));
+											abort_session(session, ConnectionAbortReason::MaximumRetransmitRequestLimitReached);
+											close_session(session, false);
+										}
+									}
+									else if (StateMachineState::WaitForClearToSend == session->state)
 									{
 										session->packetCount = packetsToBeSent;
 										session->timestamp_ms = SystemTiming::get_timestamp_ms();
@@ -270,11 +301,18 @@ namespace isobus
 
 					if ((CAN_DATA_LENGTH == message->get_data_length()) &&
 					    (get_session(tempSession, message->get_source_control_function(), message->get_destination_control_function())) &&
-					    (StateMachineState::RxDataSession == tempSession->state))
+					    ((StateMachineState::RxDataSession == tempSession->state) ||
+					     ((StateMachineState::ClearToSend == tempSession->state) &&
+					      (tempSession->retransmitPending))))
 					{
+						const bool isConnectionMode = (nullptr != tempSession->sessionMessage.get_destination_control_function());
+
 						// Check for valid sequence number
-						if (message->get_data()[SEQUENCE_NUMBER_DATA_INDEX] == (tempSession->lastPacketNumber + 1))
+						if ((StateMachineState::RxDataSession == tempSession->state) &&
+						    (message->get_data()[SEQUENCE_NUMBER_DATA_INDEX] == (tempSession->lastPacketNumber + 1)))
 						{
+							tempSession->retransmitPending = false;
+
 							for (std::uint8_t i = SEQUENCE_NUMBER_DATA_INDEX; i < PROTOCOL_BYTES_PER_FRAME; i++)
 							{
 								std::uint16_t currentDataIndex = (PROTOCOL_BYTES_PER_FRAME * tempSession->lastPacketNumber) + i;
@@ -295,6 +333,22 @@ namespace isobus
 							}
 							tempSession->timestamp_ms = SystemTiming::get_timestamp_ms();
 						}
+						else if (tempSession->retransmitPending)
+						{
+							// Stale packets from the window we've asked to be resent, they'll come again
+						}
+						else if ((isConnectionMode) &&
+						         (message->get_data()[SEQUENCE_NUMBER_DATA_INDEX] == (tempSession->lastPacketNumber)) &&
+						         (0 != CANNetworkConfiguration::get_max_number_transport_protocol_retransmit_requests()))
+						{
+							// A duplicate of the last packet doesn't cost us anything, just ignore it
+							CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[TP]: Ignoring duplicate sequence number");
+						}
+						else if ((isConnectionMode) &&
+						         (request_retransmit(tempSession)))
+						{
+							CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[TP]: Bad sequence number, requesting retransmit from packet " + isobus::to_string(static_cast<int>(tempSession->lastPacketNumber + 1)));
+						}
 						else if (message->get_data()[SEQUENCE_NUMBER_DATA_INDEX] == (tempSession->lastPacketNumber))
 						{
 							// Sequence number is duplicate of the last one
@@ -348,14 +402,48 @@ namespace isobus
 	                                                         TransmitCompleteCallback sessionCompleteCallback,
 	                                                         void *parentPointer,
 	                                                         DataChunkCallback frameChunkCallback)
+	{
+		bool retVal = false;
+
+		if ((nullptr != dataBuffer) ||
+		    (nullptr != frameChunkCallback))
+		{
+			retVal = create_transmit_session(parameterGroupNumber, dataBuffer, messageLength, source, destination, sessionCompleteCallback, parentPointer, frameChunkCallback, nullptr);
+		}
+		return retVal;
+	}
+
+	bool TransportProtocolManager::protocol_transmit_data_source(std::uint32_t parameterGroupNumber,
+	                                                             std::shared_ptr<TransmitDataSource> dataSource,
+	                                                             ControlFunction *source,
+	                                                             ControlFunction *destination,
+	                                                             TransmitCompleteCallback sessionCompleteCallback,
+	                                                             void *parentPointer)
+	{
+		bool retVal = false;
+
+		if (nullptr != dataSource)
+		{
+			retVal = create_transmit_session(parameterGroupNumber, nullptr, dataSource->get_size(), source, destination, sessionCompleteCallback, parentPointer, nullptr, dataSource);
+		}
+		return retVal;
+	}
+
+	bool TransportProtocolManager::create_transmit_session(std::uint32_t parameterGroupNumber,
+	                                                       const std::uint8_t *dataBuffer,
+	                                                       std::uint32_t messageLength,
+	                                                       ControlFunction *source,
+	                                                       ControlFunction *destination,
+	                                                       TransmitCompleteCallback sessionCompleteCallback,
+	                                                       void *parentPointer,
+	                                                       DataChunkCallback frameChunkCallback,
+	                                                       std::shared_ptr<TransmitDataSource> dataSource)
 	{
 		TransportProtocolSession *session;
 		bool retVal = false;
 
 		if ((messageLength <= MAX_PROTOCOL_DATA_LENGTH) &&
 		    (messageLength > CAN_DATA_LENGTH) &&
-		    ((nullptr != dataBuffer) ||
-		     (nullptr != frameChunkCallback)) &&
 		    (nullptr != source) &&
 		    (true == source->get_address_valid()) &&
 		    ((nullptr == destination) ||
@@ -374,6 +462,7 @@ namespace isobus
 			newSession->processedPacketsThisSession = 0;
 			newSession->sessionCompleteCallback = sessionCompleteCallback;
 			newSession->frameChunkCallback = frameChunkCallback;
+			newSession->dataSource = dataSource;
 			newSession->parent = parentPointer;
 			if (0 != (messageLength % PROTOCOL_BYTES_PER_FRAME))
 			{
@@ -665,6 +754,96 @@ namespace isobus
 		return retVal;
 	}
 
+	bool TransportProtocolManager::request_retransmit(TransportProtocolSession *session)
+	{
+		bool retVal = false;
+
+		if ((nullptr != session) &&
+		    (session->retransmitRequests < CANNetworkConfiguration::get_max_number_transport_protocol_retransmit_requests()))
+		{
+			session->retransmitRequests++;
+			session->retransmitPending = true;
+			set_state(session, StateMachineState::ClearToSend);
+			retVal = true;
+		}
+		return retVal;
+	}
+
+	bool TransportProtocolManager::get_transmit_packet_data(TransportProtocolSession *session, std::uint8_t *packetData)
+	{
+		const std::uint32_t messageLength = session->sessionMessage.get_data_length();
+		const std::uint32_t bytesOffset = (PROTOCOL_BYTES_PER_FRAME * session->processedPacketsThisSession);
+		std::uint32_t numberBytesThisPacket = 0;
+		bool retVal = true;
+
+		if (bytesOffset < messageLength)
+		{
+			numberBytesThisPacket = (messageLength - bytesOffset);
+		}
+		if (numberBytesThisPacket > PROTOCOL_BYTES_PER_FRAME)
+		{
+			numberBytesThisPacket = PROTOCOL_BYTES_PER_FRAME;
+		}
+		memset(packetData, 0xFF, PROTOCOL_BYTES_PER_FRAME);
+
+		if (0 == numberBytesThisPacket)
+		{
+			// Past the end of the message, so the packet is all padding
+		}
+		else if ((nullptr != session->dataSource) &&
+		         (nullptr != session->dataSource->get_data()))
+		{
+			// The source is contiguous (like a memory mapped file) so read directly from it
+			memcpy(packetData, session->dataSource->get_data() + bytesOffset, numberBytesThisPacket);
+		}
+		else if ((nullptr != session->dataSource) ||
+		         ((nullptr != session->frameChunkCallback) &&
+		          (CANNetworkConfiguration::get_transport_protocol_window_data_chunk_callbacks())))
+		{
+			if ((bytesOffset < session->windowBufferOffset) ||
+			    ((bytesOffset + numberBytesThisPacket) > (session->windowBufferOffset + session->windowBuffer.size())))
+			{
+				// Fetch everything the current CTS window (or the whole BAM) will need in one go
+				std::uint32_t windowLength = (PROTOCOL_BYTES_PER_FRAME * (session->packetCount - session->lastPacketNumber));
+
+				if (windowLength > (messageLength - bytesOffset))
+				{
+					windowLength = (messageLength - bytesOffset);
+				}
+				session->windowBuffer.resize(windowLength);
+				session->windowBufferOffset = bytesOffset;
+
+				if (nullptr != session->dataSource)
+				{
+					retVal = session->dataSource->read(bytesOffset, windowLength, session->windowBuffer.data());
+				}
+				else
+				{
+					retVal = session->frameChunkCallback(session->processedPacketsThisSession + 1, bytesOffset, windowLength, session->windowBuffer.data(), session->parent);
+				}
+
+				if (!retVal)
+				{
+					session->windowBuffer.clear();
+				}
+			}
+
+			if (retVal)
+			{
+				memcpy(packetData, &session->windowBuffer[bytesOffset - session->windowBufferOffset], numberBytesThisPacket);
+			}
+		}
+		else if (nullptr != session->frameChunkCallback)
+		{
+			retVal = session->frameChunkCallback(session->processedPacketsThisSession + 1, bytesOffset, numberBytesThisPacket, packetData, session->parent);
+		}
+		else
+		{
+			memcpy(packetData, &session->sessionMessage.get_data()[bytesOffset], numberBytesThisPacket);
+		}
+		return retVal;
+	}
+
 	void TransportProtocolManager::update_state_machine(TransportProtocolSession *session)
 	{
 		if (nullptr != session)
@@ -728,57 +907,13 @@ namespace isobus
 						{
 							dataBuffer[0] = (session->processedPacketsThisSession + 1);
 
-							if (nullptr != session->frameChunkCallback)
+							if (!get_transmit_packet_data(session, &dataBuffer[1]))
 							{
-								// Use the callback to get this frame's data
-								std::uint8_t callbackBuffer[7] = {
-									0xFF,
-									0xFF,
-									0xFF,
-									0xFF,
-									0xFF,
-									0xFF,
-									0xFF
-								};
-								std::uint16_t numberBytesLeft = (session->sessionMessage.get_data_length() - (PROTOCOL_BYTES_PER_FRAME * session->processedPacketsThisSession));
-
-								if (numberBytesLeft > PROTOCOL_BYTES_PER_FRAME)
-								{
-									numberBytesLeft = PROTOCOL_BYTES_PER_FRAME;
-								}
-
-								bool callbackSuccessful = session->frameChunkCallback(dataBuffer[0], (PROTOCOL_BYTES_PER_FRAME * session->processedPacketsThisSession), numberBytesLeft, callbackBuffer, session->parent);
-
-								if (callbackSuccessful)
-								{
-									for (std::uint8_t j = 0; j < PROTOCOL_BYTES_PER_FRAME; j++)
-									{
-										dataBuffer[1 + j] = callbackBuffer[j];
-									}
-								}
-								else
-								{
-									abort_session(session, ConnectionAbortReason::AnyOtherError);
-									close_session(session, false);
-									sessionStillValid = false;
-									break;
-								}
-							}
-							else
-							{
-								// Use the data buffer to get the data for this frame
-								for (std::uint8_t j = 0; j < PROTOCOL_BYTES_PER_FRAME; j++)
-								{
-									std::uint32_t index = (j + (PROTOCOL_BYTES_PER_FRAME * session->processedPacketsThisSession));
-									if (index < session->sessionMessage.get_data_length())
-									{
-										dataBuffer[1 + j] = session->sessionMessage.get_data()[j + (PROTOCOL_BYTES_PER_FRAME * session->processedPacketsThisSession)];
-									}
-									else
-									{
-										dataBuffer[1 + j] = 0xFF;
-									}
-								}
+								CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[TP]: Aborting session, unable to get data for packet " + isobus::to_string(static_cast<int>(dataBuffer[0])));
+								abort_session(session, ConnectionAbortReason::AnyOtherError);
+								close_session(session, false);
+								sessionStillValid = false;
+								break;
 							}
 
 							if (CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::TransportProtocolData),
@@ -845,7 +980,13 @@ namespace isobus
 					else
 					{
 						// CM TP Timeout check
-						if (SystemTiming::time_expired_ms(session->timestamp_ms, MESSAGE_TR_TIMEOUT_MS))
+						if (SystemTiming::time_expired_ms(session->timestamp_ms, MESSAGE_TR_TIMEOUT_MS) &&
+						    (request_retransmit(session)))
+						{
+							// The rest of the window was probably lost, ask for it again
+							CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[TP]: CM Rx Timeout, requesting retransmit from packet " + isobus::to_string(static_cast<int>(session->lastPacketNumber + 1)));
+						}
+						else if (SystemTiming::time_expired_ms(session->timestamp_ms, MESSAGE_TR_TIMEOUT_MS))
 						{
 							CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[TP]: CM Rx Timeout");
 							abort_session(session, ConnectionAbortReason::Timeout);
@@ -22,11 +22,10 @@
 /// This is not a message to ignore all communications. It is a message to minimize network traffic.
 ///
 /// @attention It is recognized that some network messages may be required to continue even during
-/// the "stop broadcast" condition. You MUST handle this in your application, as the stack cannot
-/// decide what messages are required without context. In other words, you must opt-in to make
-/// your application layer messages adhere to DM13 requests by explicitly calling the functions
-/// on this protocol (using get_diagnostic_protocol_by_internal_control_function)
-/// to check if you should send it.
+/// the "stop broadcast" condition. The network manager drops (or optionally holds back) broadcasts
+/// from internal control functions while a DM13 has suspended them, except for network management
+/// and transport protocol messages. If your application needs other broadcasts to continue, add their
+/// PGNs with CANNetworkManager::add_broadcast_suspension_exception.
 ///
 /// @author Adrian Del Grosso
 ///
@@ -36,6 +35,7 @@
 #include "isobus/isobus/isobus_diagnostic_protocol.hpp"
 
 #include "isobus/isobus/can_general_parameter_group_numbers.hpp"
+#include "isobus/isobus/can_message_schema.hpp"
 #include "isobus/isobus/can_network_manager.hpp"
 #include "isobus/isobus/can_parameter_group_number_request_protocol.hpp"
 #include "isobus/isobus/can_stack_logger.hpp"
@@ -45,28 +45,49 @@
 
 namespace isobus
 {
+	// The 4 bytes of a DTC, as sent in DM1 and DM2 (J1939-73 5.7.1). The SPN is split in two, with its 3 most significant bits after the FMI.
+	using DTCSuspectParameterNumberLow = MessageField<0, 16>;
+	using DTCFailureModeIdentifier = MessageField<16, 5>;
+	using DTCSuspectParameterNumberHigh = MessageField<21, 3>;
+	using DTCOccurrenceCount = MessageField<24, 7>;
+	using DTCConversionMethod = MessageField<31, 1>;
+	using DTCLayout = MessageLayout<4, DTCSuspectParameterNumberLow, DTCFailureModeIdentifier, DTCSuspectParameterNumberHigh, DTCOccurrenceCount, DTCConversionMethod>;
+	static_assert(DTCLayout::DATA_LENGTH == 4, "A DTC is 4 bytes long"); // Also makes the compiler check the layout
+
+	// The DM22 individual clear/reset of an active or previously active DTC (J1939-73 5.7.22)
+	using DM22Control = MessageField<0, 8>;
+	using DM22NegativeAcknowledgeReason = MessageField<8, 8>;
+	using DM22SuspectParameterNumberLow = MessageField<40, 16>;
+	using DM22FailureModeIdentifier = MessageField<56, 5>;
+	using DM22SuspectParameterNumberHigh = MessageField<61, 3>;
+	using DM22Layout = MessageLayout<CAN_DATA_LENGTH, DM22Control, DM22NegativeAcknowledgeReason, DM22SuspectParameterNumberLow, DM22FailureModeIdentifier, DM22SuspectParameterNumberHigh>;
+	static_assert(DM22Layout::DATA_LENGTH == CAN_DATA_LENGTH, "DM22 is a single frame message");
+
 	std::list<DiagnosticProtocol *> DiagnosticProtocol::diagnosticProtocolList;
 	constexpr DiagnosticProtocol::Network DiagnosticProtocol::J1939NetworkIndicies[DM13_NUMBER_OF_J1939_NETWORKS];
+	constexpr std::uint8_t DiagnosticProtocol::MAX_FREEZE_FRAMES;
+	constexpr std::uint8_t DiagnosticProtocol::MAX_FREEZE_FRAME_DATA_BYTES;
 
 	DiagnosticProtocol::DiagnosticTroubleCode::DiagnosticTroubleCode() :
 	  suspectParameterNumber(0xFFFFFFFF),
 	  failureModeIdentifier(static_cast<std::uint8_t>(FailureModeIdentifier::ConditionExists)),
-	  lampState(LampStatus::None)
+	  lampState(LampStatus::None),
+	  occuranceCount(0)
 	{
 	}
 
 	DiagnosticProtocol::DiagnosticTroubleCode::DiagnosticTroubleCode(std::uint32_t spn, FailureModeIdentifier fmi, LampStatus lamp) :
 	  suspectParameterNumber(spn),
 	  failureModeIdentifier(static_cast<std::uint8_t>(fmi)),
-	  lampState(lamp)
+	  lampState(lamp),
+	  occuranceCount(0)
 	{
 	}
 
 	bool DiagnosticProtocol::DiagnosticTroubleCode::operator==(const DiagnosticTroubleCode &obj)
 	{
 		return ((suspectParameterNumber == obj.suspectParameterNumber) &&
-		        (failureModeIdentifier == obj.failureModeIdentifier) &&
-		        (lampState == obj.lampState));
+		        (failureModeIdentifier == obj.failureModeIdentifier));
 	}
 
 	std::uint8_t DiagnosticProtocol::DiagnosticTroubleCode::get_occurrance_count() const
@@ -84,6 +105,17 @@ namespace isobus
 	{
 		diagnosticProtocolList.push_back(this);
 		ecuIdentificationFields.resize(static_cast<std::size_t>(ECUIdentificationFields::NumberOfFields));
+		activeDTCPayload.resize(DM_PAYLOAD_LAMP_BYTES);
+		inactiveDTCPayload.resize(DM_PAYLOAD_LAMP_BYTES);
+		activeLampStateCounts.fill(0);
+		inactiveLampStateCounts.fill(0);
+
+		for (auto &freezeFrame : freezeFrames)
+		{
+			freezeFrame.captureTimestamp_ms = 0;
+			freezeFrame.dataLength = 0;
+			freezeFrame.inUse = false;
+		}
 
 		for (auto ecuIDField : ecuIdentificationFields)
 		{
@@ -132,17 +164,19 @@ namespace isobus
 
 		if (retVal)
 		{
+			// The constructor adds the new protocol to diagnosticProtocolList
 			DiagnosticProtocol *newProtocol = new DiagnosticProtocol(internalControlFunction);
-			diagnosticProtocolList.push_back(newProtocol);
 			// PGN protocol will check for duplicates, so no worries if there's already a request protocol registered.
 			ParameterGroupNumberRequestProtocol::assign_pgn_request_protocol_to_internal_control_function(internalControlFunction);
 			ParameterGroupNumberRequestProtocol::get_pgn_request_protocol_by_internal_control_function(internalControlFunction)->register_pgn_request_callback(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage2), process_parameter_group_number_request, newProtocol);
 			ParameterGroupNumberRequestProtocol::get_pgn_request_protocol_by_internal_control_function(internalControlFunction)->register_pgn_request_callback(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage3), process_parameter_group_number_request, newProtocol);
+			ParameterGroupNumberRequestProtocol::get_pgn_request_protocol_by_internal_control_function(internalControlFunction)->register_pgn_request_callback(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage4), process_parameter_group_number_request, newProtocol);
 			ParameterGroupNumberRequestProtocol::get_pgn_request_protocol_by_internal_control_function(internalControlFunction)->register_pgn_request_callback(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage11), process_parameter_group_number_request, newProtocol);
 			ParameterGroupNumberRequestProtocol::get_pgn_request_protocol_by_internal_control_function(internalControlFunction)->register_pgn_request_callback(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ProductIdentification), process_parameter_group_number_request, newProtocol);
 			ParameterGroupNumberRequestProtocol::get_pgn_request_protocol_by_internal_control_function(internalControlFunction)->register_pgn_request_callback(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticProtocolIdentification), process_parameter_group_number_request, newProtocol);
 			ParameterGroupNumberRequestProtocol::get_pgn_request_protocol_by_internal_control_function(internalControlFunction)->register_pgn_request_callback(static_cast<std::uint32_t>(CANLibParameterGroupNumber::SoftwareIdentification), process_parameter_group_number_request, newProtocol);
 			ParameterGroupNumberRequestProtocol::get_pgn_request_protocol_by_internal_control_function(internalControlFunction)->register_pgn_request_callback(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUIdentificationInformation), process_parameter_group_number_request, newProtocol);
+			ParameterGroupNumberRequestProtocol::get_pgn_request_protocol_by_internal_control_function(internalControlFunction)->register_pgn_request_callback(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage25), process_parameter_group_number_request, newProtocol);
 		}
 		return retVal;
 	}
@@ -204,7 +238,7 @@ namespace isobus
 
 			for (std::uint8_t i = 0; i < DM13_NUMBER_OF_J1939_NETWORKS; i++)
 			{
-				StopStartCommand command = static_cast<StopStartCommand>(messageData[0] & (DM13_NETWORK_BITMASK << (DM13_BITS_PER_NETWORK * static_cast<std::uint8_t>(J1939NetworkIndicies[i]))));
+				StopStartCommand command = get_dm13_network_command(messageData, J1939NetworkIndicies[i]);
 				switch (command)
 				{
 					case StopStartCommand::StopBroadcast:
@@ -229,7 +263,7 @@ namespace isobus
 			}
 
 			// Check current data link
-			StopStartCommand currentLinkCommand = static_cast<StopStartCommand>(messageData[0] & (DM13_NETWORK_BITMASK << (DM13_BITS_PER_NETWORK * static_cast<std::uint8_t>(Network::CurrentDataLink))));
+			StopStartCommand currentLinkCommand = get_dm13_network_command(messageData, Network::CurrentDataLink);
 			switch (currentLinkCommand)
 			{
 				case StopStartCommand::StopBroadcast:
@@ -256,6 +290,15 @@ namespace isobus
 		return retVal;
 	}
 
+	DiagnosticProtocol::StopStartCommand DiagnosticProtocol::get_dm13_network_command(const std::vector<std::uint8_t> &messageData, Network network)
+	{
+		// Each byte holds 4 networks, with the lowest numbered network in the most significant bits
+		const std::uint8_t networkIndex = static_cast<std::uint8_t>(network);
+		const std::uint8_t bitOffset = (DM13_BITS_PER_NETWORK * (3 - (networkIndex % 4)));
+
+		return static_cast<StopStartCommand>((messageData[networkIndex / 4] >> bitOffset) & DM13_NETWORK_BITMASK);
+	}
+
 	void DiagnosticProtocol::initialize(CANLibBadge<CANNetworkManager>)
 	{
 		if (!initialized)
@@ -279,8 +322,13 @@ namespace isobus
 
 	void DiagnosticProtocol::clear_active_diagnostic_trouble_codes()
 	{
-		inactiveDTCList.insert(std::end(inactiveDTCList), std::begin(activeDTCList), std::end(activeDTCList));
+		for (const auto &dtc : activeDTCList)
+		{
+			add_dtc_to_list(dtc, false);
+		}
 		activeDTCList.clear();
+		activeDTCPayload.resize(DM_PAYLOAD_LAMP_BYTES);
+		activeLampStateCounts.fill(0);
 
 		if (!get_are_broadcasts_stopped_for_channel(myControlFunction->get_can_port()))
 		{
@@ -290,7 +338,19 @@ namespace isobus
 
 	void DiagnosticProtocol::clear_inactive_diagnostic_trouble_codes()
 	{
+		if ((nullptr != dtcLog) && (!inactiveDTCList.empty()))
+		{
+			log_dtc_state(DiagnosticTroubleCode(), DiagnosticTroubleCodeLog::RecordType::ClearAllPreviouslyActive);
+		}
+
+		for (const auto &dtc : inactiveDTCList)
+		{
+			dtcIndex.erase(get_dtc_index_key(dtc.suspectParameterNumber, dtc.failureModeIdentifier));
+			remove_freeze_frame(dtc);
+		}
 		inactiveDTCList.clear();
+		inactiveDTCPayload.resize(DM_PAYLOAD_LAMP_BYTES);
+		inactiveLampStateCounts.fill(0);
 	}
 
 	void DiagnosticProtocol::clear_software_id_fields()
@@ -320,35 +380,42 @@ namespace isobus
 	bool DiagnosticProtocol::set_diagnostic_trouble_code_active(const DiagnosticTroubleCode &dtc, bool active)
 	{
 		bool retVal = false;
+		auto dtcLocation = dtcIndex.find(get_dtc_index_key(dtc.suspectParameterNumber, dtc.failureModeIdentifier));
 
 		if (active)
 		{
 			// First check to see if it's already active
-			auto activeLocation = std::find(activeDTCList.begin(), activeDTCList.end(), dtc);
+			if (dtcIndex.end() == dtcLocation)
+			{
+				DiagnosticTroubleCode newDTC = dtc;
 
-			if (activeDTCList.end() == activeLocation)
+				newDTC.occuranceCount = 1;
+				capture_freeze_frame(newDTC);
+				add_dtc_to_list(newDTC, true);
+				request_dm1_for_state_change();
+				retVal = true;
+			}
+			else if (!dtcLocation->second.active)
 			{
 				// Not already active. This is valid
-				auto inactiveLocation = std::find(inactiveDTCList.begin(), inactiveDTCList.end(), dtc);
+				DiagnosticTroubleCode reactivatedDTC = remove_dtc_from_list(false, dtcLocation->second.listIndex);
 
-				if (inactiveDTCList.end() != inactiveLocation)
+				if (reactivatedDTC.occuranceCount < MAX_OCCURANCE_COUNT)
 				{
-					inactiveLocation->occuranceCount++;
-					activeDTCList.push_back(*inactiveLocation);
-					inactiveDTCList.erase(inactiveLocation);
-				}
-				else
-				{
-					activeDTCList.push_back(dtc);
-					activeDTCList[activeDTCList.size() - 1].occuranceCount = 1;
-
-					if ((SystemTiming::get_time_elapsed_ms(lastDM1SentTimestamp) > DM_MAX_FREQUENCY_MS) &&
-					    (!get_are_broadcasts_stopped_for_channel(myControlFunction->get_can_port())))
-					{
-						txFlags.set_flag(static_cast<std::uint32_t>(TransmitFlags::DM1));
-						lastDM1SentTimestamp = SystemTiming::get_timestamp_ms();
-					}
+					reactivatedDTC.occuranceCount++;
 				}
+				reactivatedDTC.lampState = dtc.lampState;
+				capture_freeze_frame(reactivatedDTC);
+				add_dtc_to_list(reactivatedDTC, true);
+				request_dm1_for_state_change();
+				retVal = true;
+			}
+			else if (activeDTCList[dtcLocation->second.listIndex].lampState != dtc.lampState)
+			{
+				// Already active, but the lamp changed, which changes what DM1 reports
+				set_dtc_lamp_state(true, dtcLocation->second.listIndex, dtc.lampState);
+				request_dm1_for_state_change();
+				retVal = true;
 			}
 			else
 			{
@@ -359,21 +426,15 @@ namespace isobus
 		else
 		{
 			/// First check to see if it's already in the inactive list
-			auto inactiveLocation = std::find(inactiveDTCList.begin(), inactiveDTCList.end(), dtc);
-
-			if (inactiveDTCList.end() == inactiveLocation)
+			if ((dtcIndex.end() != dtcLocation) &&
+			    (dtcLocation->second.active))
 			{
-				auto activeLocation = std::find(activeDTCList.begin(), activeDTCList.end(), dtc);
-
-				if (activeDTCList.end() != activeLocation)
-				{
-					inactiveDTCList.push_back(*activeLocation);
-					activeDTCList.erase(activeLocation);
-				}
+				add_dtc_to_list(remove_dtc_from_list(true, dtcLocation->second.listIndex), false);
+				retVal = true;
 			}
 			else
 			{
-				// Already inactive!
+				// Already inactive, or unknown
 				retVal = false;
 			}
 		}
@@ -382,13 +443,102 @@ namespace isobus
 
 	bool DiagnosticProtocol::get_diagnostic_trouble_code_active(const DiagnosticTroubleCode &dtc)
 	{
-		auto activeLocation = std::find(activeDTCList.begin(), activeDTCList.end(), dtc);
+		auto dtcLocation = dtcIndex.find(get_dtc_index_key(dtc.suspectParameterNumber, dtc.failureModeIdentifier));
+		bool retVal = false;
+
+		if ((dtcIndex.end() != dtcLocation) &&
+		    (dtcLocation->second.active))
+		{
+			retVal = true;
+		}
+		return retVal;
+	}
+
+	std::uint8_t DiagnosticProtocol::get_diagnostic_trouble_code_occurrance_count(const DiagnosticTroubleCode &dtc) const
+	{
+		auto dtcLocation = dtcIndex.find(get_dtc_index_key(dtc.suspectParameterNumber, dtc.failureModeIdentifier));
+		std::uint8_t retVal = 0;
+
+		if (dtcIndex.end() != dtcLocation)
+		{
+			retVal = (dtcLocation->second.active ? activeDTCList : inactiveDTCList)[dtcLocation->second.listIndex].occuranceCount;
+		}
+		return retVal;
+	}
+
+	bool DiagnosticProtocol::set_diagnostic_trouble_code_log(std::shared_ptr<DiagnosticTroubleCodeLog> log)
+	{
+		std::vector<DiagnosticTroubleCodeLog::Record> restoredRecords;
 		bool retVal = false;
 
-		if (activeDTCList.end() != activeLocation)
+		if (nullptr == log)
 		{
+			dtcLog.reset();
 			retVal = true;
 		}
+		else if (log->open(restoredRecords))
+		{
+			const std::size_t numberOfUnloggedInactiveDTCs = inactiveDTCList.size();
+
+			dtcLog.reset();
+			for (const auto &record : restoredRecords)
+			{
+				if ((dtcIndex.end() == dtcIndex.find(get_dtc_index_key(record.suspectParameterNumber, record.failureModeIdentifier))) &&
+				    (record.lampState <= static_cast<std::uint8_t>(LampStatus::EngineProtectLampFastFlash)))
+				{
+					DiagnosticTroubleCode restoredDTC(record.suspectParameterNumber, static_cast<FailureModeIdentifier>(record.failureModeIdentifier), static_cast<LampStatus>(record.lampState));
+
+					restoredDTC.occuranceCount = (record.occurranceCount < MAX_OCCURANCE_COUNT) ? record.occurranceCount : MAX_OCCURANCE_COUNT;
+					add_dtc_to_list(restoredDTC, false);
+
+					if (DiagnosticTroubleCodeLog::RecordType::Active == record.type)
+					{
+						// The DTC was active at power down, so record that it's only previously active now
+						log->append({ record.suspectParameterNumber, record.failureModeIdentifier, record.lampState, restoredDTC.occuranceCount, DiagnosticTroubleCodeLog::RecordType::PreviouslyActive });
+					}
+				}
+			}
+			dtcLog = log;
+
+			// Bring the log up to date with any DTCs that were set before it was attached
+			for (const auto &dtc : activeDTCList)
+			{
+				log_dtc_state(dtc, DiagnosticTroubleCodeLog::RecordType::Active);
+			}
+			for (std::size_t i = 0; i < numberOfUnloggedInactiveDTCs; i++)
+			{
+				log_dtc_state(inactiveDTCList[i], DiagnosticTroubleCodeLog::RecordType::PreviouslyActive);
+			}
+			retVal = true;
+		}
+		else
+		{
+			CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[DP]: Unable to open the DTC log, DTCs will not be persisted");
+		}
+		return retVal;
+	}
+
+	void DiagnosticProtocol::set_freeze_frame_recorder(std::shared_ptr<FreezeFrameSignalRecorder> recorder)
+	{
+		freezeFrameRecorder = recorder;
+	}
+
+	bool DiagnosticProtocol::get_freeze_frame(const DiagnosticTroubleCode &dtc, std::vector<std::uint8_t> &freezeFrameData) const
+	{
+		bool retVal = false;
+
+		freezeFrameData.clear();
+		for (const auto &freezeFrame : freezeFrames)
+		{
+			if ((freezeFrame.inUse) &&
+			    (freezeFrame.dtc.suspectParameterNumber == dtc.suspectParameterNumber) &&
+			    (freezeFrame.dtc.failureModeIdentifier == dtc.failureModeIdentifier))
+			{
+				freezeFrameData.assign(freezeFrame.data.begin(), freezeFrame.data.begin() + freezeFrame.dataLength);
+				retVal = true;
+				break;
+			}
+		}
 		return retVal;
 	}
 
@@ -520,11 +670,13 @@ namespace isobus
 		{
 			pgnRequestProtocol->remove_pgn_request_callback(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage2), process_parameter_group_number_request, this);
 			pgnRequestProtocol->remove_pgn_request_callback(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage3), process_parameter_group_number_request, this);
+			pgnRequestProtocol->remove_pgn_request_callback(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage4), process_parameter_group_number_request, this);
 			pgnRequestProtocol->remove_pgn_request_callback(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage11), process_parameter_group_number_request, this);
 			pgnRequestProtocol->remove_pgn_request_callback(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ProductIdentification), process_parameter_group_number_request, this);
 			pgnRequestProtocol->remove_pgn_request_callback(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticProtocolIdentification), process_parameter_group_number_request, this);
 			pgnRequestProtocol->remove_pgn_request_callback(static_cast<std::uint32_t>(CANLibParameterGroupNumber::SoftwareIdentification), process_parameter_group_number_request, this);
 			pgnRequestProtocol->remove_pgn_request_callback(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUIdentificationInformation), process_parameter_group_number_request, this);
+			pgnRequestProtocol->remove_pgn_request_callback(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage25), process_parameter_group_number_request, this);
 
 			// Check if that was the last callback being handled and clean up if needed
 			if ((0 == pgnRequestProtocol->get_number_registered_pgn_request_callbacks()) && (0 == pgnRequestProtocol->get_number_registered_request_for_repetition_rate_callbacks()))
@@ -534,399 +686,304 @@ namespace isobus
 		}
 	}
 
-	void DiagnosticProtocol::get_active_list_lamp_state_and_flash_state(Lamps targetLamp, FlashState &flash, bool &lampOn)
+	std::uint32_t DiagnosticProtocol::get_dtc_index_key(std::uint32_t suspectParameterNumber, std::uint8_t failureModeIdentifier)
 	{
-		flash = FlashState::Solid;
-		lampOn = false;
-
-		for (auto dtc : activeDTCList)
-		{
-			switch (targetLamp)
-			{
-				case Lamps::AmberWarningLamp:
-				{
-					if (dtc.lampState == LampStatus::AmberWarningLampSolid)
-					{
-						lampOn = true;
-					}
-					else if (dtc.lampState == LampStatus::AmberWarningLampSlowFlash)
-					{
-						lampOn = true;
-						if (flash != FlashState::Fast)
-						{
-							flash = FlashState::Slow;
-						}
-					}
-					else if (dtc.lampState == LampStatus::AmberWarningLampFastFlash)
-					{
-						lampOn = true;
-						flash = FlashState::Fast;
-					}
-				}
-				break;
+		return (((suspectParameterNumber & 0x7FFFF) << 5) | (failureModeIdentifier & 0x1F));
+	}
 
-				case Lamps::MalfunctionIndicatorLamp:
-				{
-					if (dtc.lampState == LampStatus::MalfunctionIndicatorLampSolid)
-					{
-						lampOn = true;
-					}
-					else if (dtc.lampState == LampStatus::MalfuctionIndicatorLampSlowFlash)
-					{
-						lampOn = true;
-						if (flash != FlashState::Fast)
-						{
-							flash = FlashState::Slow;
-						}
-					}
-					else if (dtc.lampState == LampStatus::MalfunctionIndicatorLampFastFlash)
-					{
-						lampOn = true;
-						flash = FlashState::Fast;
-					}
-				}
-				break;
+	void DiagnosticProtocol::encode_dtc(const DiagnosticTroubleCode &dtc, std::uint8_t *buffer)
+	{
+		DTCSuspectParameterNumberLow::encode(buffer, dtc.suspectParameterNumber);
+		DTCFailureModeIdentifier::encode(buffer, dtc.failureModeIdentifier);
+		DTCSuspectParameterNumberHigh::encode(buffer, dtc.suspectParameterNumber >> 16);
+		DTCOccurrenceCount::encode(buffer, dtc.occuranceCount);
+		DTCConversionMethod::encode(buffer, 0);
+	}
 
-				case Lamps::ProtectLamp:
-				{
-					if (dtc.lampState == LampStatus::EngineProtectLampSolid)
-					{
-						lampOn = true;
-					}
-					else if (dtc.lampState == LampStatus::EngineProtectLampSlowFlash)
-					{
-						lampOn = true;
-						if (flash != FlashState::Fast)
-						{
-							flash = FlashState::Slow;
-						}
-					}
-					else if (dtc.lampState == LampStatus::EngineProtectLampFastFlash)
-					{
-						lampOn = true;
-						flash = FlashState::Fast;
-					}
-				}
-				break;
+	void DiagnosticProtocol::add_dtc_to_list(const DiagnosticTroubleCode &dtc, bool active)
+	{
+		std::vector<DiagnosticTroubleCode> &dtcList = (active ? activeDTCList : inactiveDTCList);
+		std::vector<std::uint8_t> &payload = (active ? activeDTCPayload : inactiveDTCPayload);
+		std::array<std::uint16_t, NUMBER_OF_LAMP_STATES> &lampStateCounts = (active ? activeLampStateCounts : inactiveLampStateCounts);
+		const std::size_t payloadOffset = payload.size();
 
-				case Lamps::RedStopLamp:
-				{
-					if (dtc.lampState == LampStatus::RedStopLampSolid)
-					{
-						lampOn = true;
-					}
-					else if (dtc.lampState == LampStatus::RedStopLampSlowFlash)
-					{
-						lampOn = true;
-						if (flash != FlashState::Fast)
-						{
-							flash = FlashState::Slow;
-						}
-					}
-					else if (dtc.lampState == LampStatus::RedStopLampFastFlash)
-					{
-						lampOn = true;
-						flash = FlashState::Fast;
-					}
-				}
-				break;
+		dtcIndex[get_dtc_index_key(dtc.suspectParameterNumber, dtc.failureModeIdentifier)] = { dtcList.size(), active };
+		dtcList.push_back(dtc);
+		payload.resize(payloadOffset + DM_PAYLOAD_BYTES_PER_DTC);
+		encode_dtc(dtc, &payload[payloadOffset]);
 
-				default:
-				{
-				}
-				break;
-			}
+		if (LampStatus::None != dtc.lampState)
+		{
+			lampStateCounts[static_cast<std::size_t>(dtc.lampState) - 1]++;
 		}
+		log_dtc_state(dtc, active ? DiagnosticTroubleCodeLog::RecordType::Active : DiagnosticTroubleCodeLog::RecordType::PreviouslyActive);
 	}
 
-	void DiagnosticProtocol::get_inactive_list_lamp_state_and_flash_state(Lamps targetLamp, FlashState &flash, bool &lampOn)
+	DiagnosticProtocol::DiagnosticTroubleCode DiagnosticProtocol::remove_dtc_from_list(bool active, std::size_t listIndex)
 	{
-		flash = FlashState::Solid;
-		lampOn = false;
+		std::vector<DiagnosticTroubleCode> &dtcList = (active ? activeDTCList : inactiveDTCList);
+		std::vector<std::uint8_t> &payload = (active ? activeDTCPayload : inactiveDTCPayload);
+		std::array<std::uint16_t, NUMBER_OF_LAMP_STATES> &lampStateCounts = (active ? activeLampStateCounts : inactiveLampStateCounts);
+		const DiagnosticTroubleCode retVal = dtcList[listIndex];
+		const std::size_t lastIndex = dtcList.size() - 1;
+
+		dtcIndex.erase(get_dtc_index_key(retVal.suspectParameterNumber, retVal.failureModeIdentifier));
 
-		for (auto dtc : inactiveDTCList)
+		if (listIndex != lastIndex)
 		{
-			switch (targetLamp)
-			{
-				case Lamps::AmberWarningLamp:
-				{
-					if (dtc.lampState == LampStatus::AmberWarningLampSolid)
-					{
-						lampOn = true;
-					}
-					else if (dtc.lampState == LampStatus::AmberWarningLampSlowFlash)
-					{
-						lampOn = true;
-						if (flash != FlashState::Fast)
-						{
-							flash = FlashState::Slow;
-						}
-					}
-					else if (dtc.lampState == LampStatus::AmberWarningLampFastFlash)
-					{
-						lampOn = true;
-						flash = FlashState::Fast;
-					}
-				}
-				break;
+			// Move the last DTC into the hole, so nothing else has to shift
+			dtcList[listIndex] = dtcList[lastIndex];
+			std::copy(payload.begin() + DM_PAYLOAD_LAMP_BYTES + (lastIndex * DM_PAYLOAD_BYTES_PER_DTC),
+			          payload.begin() + DM_PAYLOAD_LAMP_BYTES + ((lastIndex + 1) * DM_PAYLOAD_BYTES_PER_DTC),
+			          payload.begin() + DM_PAYLOAD_LAMP_BYTES + (listIndex * DM_PAYLOAD_BYTES_PER_DTC));
+			dtcIndex[get_dtc_index_key(dtcList[listIndex].suspectParameterNumber, dtcList[listIndex].failureModeIdentifier)].listIndex = listIndex;
+		}
+		dtcList.pop_back();
+		payload.resize(payload.size() - DM_PAYLOAD_BYTES_PER_DTC);
 
-				case Lamps::MalfunctionIndicatorLamp:
-				{
-					if (dtc.lampState == LampStatus::MalfunctionIndicatorLampSolid)
-					{
-						lampOn = true;
-					}
-					else if (dtc.lampState == LampStatus::MalfuctionIndicatorLampSlowFlash)
-					{
-						lampOn = true;
-						if (flash != FlashState::Fast)
-						{
-							flash = FlashState::Slow;
-						}
-					}
-					else if (dtc.lampState == LampStatus::MalfunctionIndicatorLampFastFlash)
-					{
-						lampOn = true;
-						flash = FlashState::Fast;
-					}
-				}
-				break;
+		if (LampStatus::None != retVal.lampState)
+		{
+			lampStateCounts[static_cast<std::size_t>(retVal.lampState) - 1]--;
+		}
+		return retVal;
+	}
 
-				case Lamps::ProtectLamp:
-				{
-					if (dtc.lampState == LampStatus::EngineProtectLampSolid)
-					{
-						lampOn = true;
-					}
-					else if (dtc.lampState == LampStatus::EngineProtectLampSlowFlash)
-					{
-						lampOn = true;
-						if (flash != FlashState::Fast)
-						{
-							flash = FlashState::Slow;
-						}
-					}
-					else if (dtc.lampState == LampStatus::EngineProtectLampFastFlash)
-					{
-						lampOn = true;
-						flash = FlashState::Fast;
-					}
-				}
-				break;
+	void DiagnosticProtocol::capture_freeze_frame(const DiagnosticTroubleCode &dtc)
+	{
+		if ((nullptr != freezeFrameRecorder) &&
+		    (0 != freezeFrameRecorder->get_number_of_signals()))
+		{
+			FreezeFrame *targetFrame = nullptr;
 
-				case Lamps::RedStopLamp:
+			// Reuse the DTC's old frame if it has one, otherwise take a free frame, or the oldest one
+			for (auto &freezeFrame : freezeFrames)
+			{
+				if ((freezeFrame.inUse) &&
+				    (freezeFrame.dtc.suspectParameterNumber == dtc.suspectParameterNumber) &&
+				    (freezeFrame.dtc.failureModeIdentifier == dtc.failureModeIdentifier))
 				{
-					if (dtc.lampState == LampStatus::RedStopLampSolid)
-					{
-						lampOn = true;
-					}
-					else if (dtc.lampState == LampStatus::RedStopLampSlowFlash)
-					{
-						lampOn = true;
-						if (flash != FlashState::Fast)
-						{
-							flash = FlashState::Slow;
-						}
-					}
-					else if (dtc.lampState == LampStatus::RedStopLampFastFlash)
-					{
-						lampOn = true;
-						flash = FlashState::Fast;
-					}
+					targetFrame = &freezeFrame;
+					break;
 				}
-				break;
-
-				default:
+				else if ((nullptr == targetFrame) ||
+				         ((targetFrame->inUse) &&
+				          ((!freezeFrame.inUse) ||
+				           (SystemTiming::get_time_elapsed_ms(freezeFrame.captureTimestamp_ms) > SystemTiming::get_time_elapsed_ms(targetFrame->captureTimestamp_ms)))))
 				{
+					targetFrame = &freezeFrame;
 				}
-				break;
 			}
+
+			targetFrame->dtc = dtc;
+			targetFrame->captureTimestamp_ms = SystemTiming::get_timestamp_ms();
+			targetFrame->dataLength = freezeFrameRecorder->capture_snapshot(targetFrame->data.data(), MAX_FREEZE_FRAME_DATA_BYTES);
+			targetFrame->inUse = true;
 		}
 	}
 
-	bool DiagnosticProtocol::protocol_transmit_message(std::uint32_t,
-	                                                   const std::uint8_t *,
-	                                                   std::uint32_t,
-	                                                   ControlFunction *,
-	                                                   ControlFunction *,
-	                                                   TransmitCompleteCallback,
-	                                                   void *,
-	                                                   DataChunkCallback)
+	void DiagnosticProtocol::remove_freeze_frame(const DiagnosticTroubleCode &dtc)
 	{
-		return false;
+		for (auto &freezeFrame : freezeFrames)
+		{
+			if ((freezeFrame.inUse) &&
+			    (freezeFrame.dtc.suspectParameterNumber == dtc.suspectParameterNumber) &&
+			    (freezeFrame.dtc.failureModeIdentifier == dtc.failureModeIdentifier))
+			{
+				freezeFrame.inUse = false;
+				break;
+			}
+		}
 	}
 
-	bool DiagnosticProtocol::send_diagnostic_message_1()
+	bool DiagnosticProtocol::send_freeze_frames(std::uint32_t parameterGroupNumber)
 	{
+		std::vector<std::uint8_t> payload;
 		bool retVal = false;
 
 		if (nullptr != myControlFunction)
 		{
-			std::uint16_t payloadSize = (activeDTCList.size() * DM_PAYLOAD_BYTES_PER_DTC) + 2; // 2 Bytes (0 and 1) are reserved
-
-			if (payloadSize <= MAX_PAYLOAD_SIZE_BYTES)
+			for (const auto &freezeFrame : freezeFrames)
 			{
-				std::vector<std::uint8_t> buffer;
-				buffer.resize(payloadSize);
-
-				if (get_j1939_mode())
+				if (freezeFrame.inUse)
 				{
-					bool tempLampState = false;
-					FlashState tempLampFlashState = FlashState::Solid;
-					get_active_list_lamp_state_and_flash_state(Lamps::ProtectLamp, tempLampFlashState, tempLampState);
+					const std::size_t frameOffset = payload.size();
 
-					/// Encode Protect state and flash
-					buffer[0] = tempLampState;
-					buffer[1] = convert_flash_state_to_byte(tempLampFlashState);
+					// Each frame is its length, the DTC, then the SPN data. The length counts the DTC and the data.
+					payload.resize(frameOffset + 1 + DM_PAYLOAD_BYTES_PER_DTC + freezeFrame.dataLength);
+					payload[frameOffset] = static_cast<std::uint8_t>(DM_PAYLOAD_BYTES_PER_DTC + freezeFrame.dataLength);
+					encode_dtc(freezeFrame.dtc, &payload[frameOffset + 1]);
+					std::copy(freezeFrame.data.begin(), freezeFrame.data.begin() + freezeFrame.dataLength, payload.begin() + frameOffset + 1 + DM_PAYLOAD_BYTES_PER_DTC);
+				}
+			}
 
-					get_active_list_lamp_state_and_flash_state(Lamps::AmberWarningLamp, tempLampFlashState, tempLampState);
+			if (payload.empty())
+			{
+				// No freeze frames, which is reported as a zero length frame with a zeroed DTC
+				payload = { 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF };
+			}
+			else if (payload.size() < CAN_DATA_LENGTH)
+			{
+				payload.resize(CAN_DATA_LENGTH, 0xFF);
+			}
 
-					/// Encode amber warning lamp state and flash
-					buffer[0] |= (tempLampState << 2);
-					buffer[1] |= (convert_flash_state_to_byte(tempLampFlashState) << 2);
+			retVal = CANNetworkManager::CANNetwork.send_can_message(parameterGroupNumber,
+			                                                        payload.data(),
+			                                                        payload.size(),
+			                                                        myControlFunction.get());
+		}
+		return retVal;
+	}
 
-					get_active_list_lamp_state_and_flash_state(Lamps::RedStopLamp, tempLampFlashState, tempLampState);
+	void DiagnosticProtocol::log_dtc_state(const DiagnosticTroubleCode &dtc, DiagnosticTroubleCodeLog::RecordType type)
+	{
+		if (nullptr != dtcLog)
+		{
+			DiagnosticTroubleCodeLog::Record record;
+
+			record.suspectParameterNumber = dtc.suspectParameterNumber;
+			record.failureModeIdentifier = dtc.failureModeIdentifier;
+			record.lampState = static_cast<std::uint8_t>(dtc.lampState);
+			record.occurranceCount = dtc.occuranceCount;
+			record.type = type;
+			dtcLog->append(record);
+		}
+	}
 
-					/// Encode red stop lamp state and flash
-					buffer[0] |= (tempLampState << 4);
-					buffer[1] |= (convert_flash_state_to_byte(tempLampFlashState) << 4);
+	void DiagnosticProtocol::request_dm1_for_state_change()
+	{
+		if ((SystemTiming::get_time_elapsed_ms(lastDM1SentTimestamp) > DM_MAX_FREQUENCY_MS) &&
+		    (!get_are_broadcasts_stopped_for_channel(myControlFunction->get_can_port())))
+		{
+			txFlags.set_flag(static_cast<std::uint32_t>(TransmitFlags::DM1));
+			lastDM1SentTimestamp = SystemTiming::get_timestamp_ms();
+		}
+	}
 
-					get_active_list_lamp_state_and_flash_state(Lamps::MalfunctionIndicatorLamp, tempLampFlashState, tempLampState);
+	void DiagnosticProtocol::set_dtc_lamp_state(bool active, std::size_t listIndex, LampStatus lamp)
+	{
+		std::vector<DiagnosticTroubleCode> &dtcList = (active ? activeDTCList : inactiveDTCList);
+		std::array<std::uint16_t, NUMBER_OF_LAMP_STATES> &lampStateCounts = (active ? activeLampStateCounts : inactiveLampStateCounts);
 
-					/// Encode malfunction indicator lamp state and flash
-					buffer[0] |= (tempLampState << 6);
-					buffer[1] |= (convert_flash_state_to_byte(tempLampFlashState) << 6);
-				}
-				else
-				{
-					// ISO 11783 does not use lamp state or lamp flash bytes
-					buffer[0] = 0xFF;
-					buffer[1] = 0xFF;
-				}
+		if (LampStatus::None != dtcList[listIndex].lampState)
+		{
+			lampStateCounts[static_cast<std::size_t>(dtcList[listIndex].lampState) - 1]--;
+		}
+		dtcList[listIndex].lampState = lamp;
 
-				if (0 == activeDTCList.size())
-				{
-					buffer[2] = 0x00;
-					buffer[3] = 0x00;
-					buffer[4] = 0x00;
-					buffer[5] = 0x00;
-					buffer[6] = 0xFF;
-					buffer[7] = 0xFF;
-					retVal = CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage1),
-					                                                        buffer.data(),
-					                                                        CAN_DATA_LENGTH,
-					                                                        myControlFunction.get());
-				}
-				else
-				{
-					for (std::size_t i = 0; i < activeDTCList.size(); i++)
-					{
-						buffer[2 + (DM_PAYLOAD_BYTES_PER_DTC * i)] = static_cast<std::uint8_t>(activeDTCList[i].suspectParameterNumber & 0xFF);
-						buffer[3 + (DM_PAYLOAD_BYTES_PER_DTC * i)] = static_cast<std::uint8_t>((activeDTCList[i].suspectParameterNumber >> 8) & 0xFF);
-						buffer[4 + (DM_PAYLOAD_BYTES_PER_DTC * i)] = ((static_cast<std::uint8_t>((activeDTCList[i].suspectParameterNumber >> 16) & 0xFF) << 5) | static_cast<std::uint8_t>(activeDTCList[i].failureModeIdentifier & 0x1F));
-						buffer[5 + (DM_PAYLOAD_BYTES_PER_DTC * i)] = (activeDTCList[i].occuranceCount & 0x7F);
-					}
+		if (LampStatus::None != lamp)
+		{
+			lampStateCounts[static_cast<std::size_t>(lamp) - 1]++;
+		}
+		log_dtc_state(dtcList[listIndex], active ? DiagnosticTroubleCodeLog::RecordType::Active : DiagnosticTroubleCodeLog::RecordType::PreviouslyActive);
+	}
 
-					if (payloadSize < CAN_DATA_LENGTH)
-					{
-						buffer[6] = 0xFF;
-						buffer[7] = 0xFF;
-						payloadSize = CAN_DATA_LENGTH;
-					}
+	void DiagnosticProtocol::get_lamp_state_and_flash_state(const std::array<std::uint16_t, NUMBER_OF_LAMP_STATES> &lampStateCounts, Lamps targetLamp, FlashState &flash, bool &lampOn)
+	{
+		// LampStatus lists each lamp in the same order as Lamps, with a solid, slow flash, and fast flash value for each
+		const std::size_t lampOffset = static_cast<std::size_t>(targetLamp) * NUMBER_OF_FLASH_STATES_PER_LAMP;
+		const std::uint16_t solidCount = lampStateCounts[lampOffset];
+		const std::uint16_t slowFlashCount = lampStateCounts[lampOffset + 1];
+		const std::uint16_t fastFlashCount = lampStateCounts[lampOffset + 2];
 
-					retVal = CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage1),
-					                                                        buffer.data(),
-					                                                        payloadSize,
-					                                                        myControlFunction.get());
-				}
-			}
+		lampOn = ((0 != solidCount) || (0 != slowFlashCount) || (0 != fastFlashCount));
+
+		if (0 != fastFlashCount)
+		{
+			flash = FlashState::Fast;
 		}
-		return retVal;
+		else if (0 != slowFlashCount)
+		{
+			flash = FlashState::Slow;
+		}
+		else
+		{
+			flash = FlashState::Solid;
+		}
+	}
+
+	bool DiagnosticProtocol::protocol_transmit_message(std::uint32_t,
+	                                                   const std::uint8_t *,
+	                                                   std::uint32_t,
+	                                                   ControlFunction *,
+	                                                   ControlFunction *,
+	                                                   TransmitCompleteCallback,
+	                                                   void *,
+	                                                   DataChunkCallback)
+	{
+		return false;
+	}
+
+	bool DiagnosticProtocol::send_diagnostic_message_1()
+	{
+		return send_dtc_list(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage1), true);
 	}
 
 	bool DiagnosticProtocol::send_diagnostic_message_2()
+	{
+		return send_dtc_list(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage2), false);
+	}
+
+	bool DiagnosticProtocol::send_dtc_list(std::uint32_t parameterGroupNumber, bool active)
 	{
 		bool retVal = false;
+		std::vector<std::uint8_t> &payload = (active ? activeDTCPayload : inactiveDTCPayload);
+		const std::array<std::uint16_t, NUMBER_OF_LAMP_STATES> &lampStateCounts = (active ? activeLampStateCounts : inactiveLampStateCounts);
 
-		if (nullptr != myControlFunction)
+		if ((nullptr != myControlFunction) &&
+		    (payload.size() <= MAX_PAYLOAD_SIZE_BYTES))
 		{
-			std::uint16_t payloadSize = (inactiveDTCList.size() * DM_PAYLOAD_BYTES_PER_DTC) + 2; // 2 Bytes (0 and 1) are reserved or used for lamp + flash
-
-			if (payloadSize <= MAX_PAYLOAD_SIZE_BYTES)
+			if (get_j1939_mode())
 			{
-				std::vector<std::uint8_t> buffer;
-				buffer.resize(payloadSize);
-
-				if (get_j1939_mode())
-				{
-					bool tempLampState = false;
-					FlashState tempLampFlashState = FlashState::Solid;
-					get_inactive_list_lamp_state_and_flash_state(Lamps::ProtectLamp, tempLampFlashState, tempLampState);
+				bool tempLampState = false;
+				FlashState tempLampFlashState = FlashState::Solid;
+				get_lamp_state_and_flash_state(lampStateCounts, Lamps::ProtectLamp, tempLampFlashState, tempLampState);
 
-					/// Encode Protect state and flash
-					buffer[0] = tempLampState;
-					buffer[1] = convert_flash_state_to_byte(tempLampFlashState);
+				/// Encode Protect state and flash
+				payload[0] = tempLampState;
+				payload[1] = convert_flash_state_to_byte(tempLampFlashState);
 
-					get_inactive_list_lamp_state_and_flash_state(Lamps::AmberWarningLamp, tempLampFlashState, tempLampState);
+				get_lamp_state_and_flash_state(lampStateCounts, Lamps::AmberWarningLamp, tempLampFlashState, tempLampState);
 
-					/// Encode amber warning lamp state and flash
-					buffer[0] |= (tempLampState << 2);
-					buffer[1] |= (convert_flash_state_to_byte(tempLampFlashState) << 2);
+				/// Encode amber warning lamp state and flash
+				payload[0] |= (tempLampState << 2);
+				payload[1] |= (convert_flash_state_to_byte(tempLampFlashState) << 2);
 
-					get_inactive_list_lamp_state_and_flash_state(Lamps::RedStopLamp, tempLampFlashState, tempLampState);
+				get_lamp_state_and_flash_state(lampStateCounts, Lamps::RedStopLamp, tempLampFlashState, tempLampState);
 
-					/// Encode red stop lamp state and flash
-					buffer[0] |= (tempLampState << 4);
-					buffer[1] |= (convert_flash_state_to_byte(tempLampFlashState) << 4);
+				/// Encode red stop lamp state and flash
+				payload[0] |= (tempLampState << 4);
+				payload[1] |= (convert_flash_state_to_byte(tempLampFlashState) << 4);
 
-					get_inactive_list_lamp_state_and_flash_state(Lamps::MalfunctionIndicatorLamp, tempLampFlashState, tempLampState);
+				get_lamp_state_and_flash_state(lampStateCounts, Lamps::MalfunctionIndicatorLamp, tempLampFlashState, tempLampState);
 
-					/// Encode malfunction indicator lamp state and flash
-					buffer[0] |= (tempLampState << 6);
-					buffer[1] |= (convert_flash_state_to_byte(tempLampFlashState) << 6);
-				}
-				else
-				{
-					// ISO 11783 does not use lamp state or lamp flash bytes
-					buffer[0] = 0xFF;
-					buffer[1] = 0xFF;
-				}
-
-				if (0 == inactiveDTCList.size())
-				{
-					buffer[2] = 0x00;
-					buffer[3] = 0x00;
-					buffer[4] = 0x00;
-					buffer[5] = 0x00;
-					buffer[6] = 0xFF;
-					buffer[7] = 0xFF;
-					retVal = CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage2),
-					                                                        buffer.data(),
-					                                                        CAN_DATA_LENGTH,
-					                                                        myControlFunction.get());
-				}
-				else
-				{
-					for (std::size_t i = 0; i < inactiveDTCList.size(); i++)
-					{
-						buffer[2 + (DM_PAYLOAD_BYTES_PER_DTC * i)] = static_cast<std::uint8_t>(inactiveDTCList[i].suspectParameterNumber & 0xFF);
-						buffer[3 + (DM_PAYLOAD_BYTES_PER_DTC * i)] = static_cast<std::uint8_t>((inactiveDTCList[i].suspectParameterNumber >> 8) & 0xFF);
-						buffer[4 + (DM_PAYLOAD_BYTES_PER_DTC * i)] = ((static_cast<std::uint8_t>((inactiveDTCList[i].suspectParameterNumber >> 16) & 0xFF) << 5) | static_cast<std::uint8_t>(inactiveDTCList[i].failureModeIdentifier & 0x1F));
-						buffer[5 + (DM_PAYLOAD_BYTES_PER_DTC * i)] = (inactiveDTCList[i].occuranceCount & 0x7F);
-					}
+				/// Encode malfunction indicator lamp state and flash
+				payload[0] |= (tempLampState << 6);
+				payload[1] |= (convert_flash_state_to_byte(tempLampFlashState) << 6);
+			}
+			else
+			{
+				// ISO 11783 does not use lamp state or lamp flash bytes
+				payload[0] = 0xFF;
+				payload[1] = 0xFF;
+			}
 
-					if (payloadSize < CAN_DATA_LENGTH)
-					{
-						buffer[6] = 0xFF;
-						buffer[7] = 0xFF;
-						payloadSize = CAN_DATA_LENGTH;
-					}
+			if (payload.size() < CAN_DATA_LENGTH)
+			{
+				// No DTCs (reported as a zeroed SPN) or a single DTC, so pad out to a full frame
+				std::array<std::uint8_t, CAN_DATA_LENGTH> buffer = { payload[0], payload[1], 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF };
 
-					retVal = CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage2),
-					                                                        buffer.data(),
-					                                                        payloadSize,
-					                                                        myControlFunction.get());
-				}
+				std::copy(payload.begin() + DM_PAYLOAD_LAMP_BYTES, payload.end(), buffer.begin() + DM_PAYLOAD_LAMP_BYTES);
+				retVal = CANNetworkManager::CANNetwork.send_can_message(parameterGroupNumber,
+				                                                        buffer.data(),
+				                                                        CAN_DATA_LENGTH,
+				                                                        myControlFunction.get());
+			}
+			else
+			{
+				retVal = CANNetworkManager::CANNetwork.send_can_message(parameterGroupNumber,
+				                                                        payload.data(),
+				                                                        payload.size(),
+				                                                        myControlFunction.get());
 			}
 		}
 		return retVal;
@@ -1063,10 +1120,9 @@ namespace isobus
 				buffer[2] = 0xFF;
 				buffer[3] = 0xFF;
 				buffer[4] = 0xFF;
-				buffer[5] = (currentMessageData.suspectParameterNumber & 0xFF);
-				buffer[6] = ((currentMessageData.suspectParameterNumber >> 8) & 0xFF);
-				buffer[7] = (((currentMessageData.suspectParameterNumber >> 16) << 5) & 0xFF);
-				buffer[7] |= (currentMessageData.failureModeIdentifier & 0x07);
+				DM22SuspectParameterNumberLow::encode(buffer.data(), currentMessageData.suspectParameterNumber);
+				DM22FailureModeIdentifier::encode(buffer.data(), currentMessageData.failureModeIdentifier);
+				DM22SuspectParameterNumberHigh::encode(buffer.data(), currentMessageData.suspectParameterNumber >> 16);
 
 				retVal = CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage22),
 				                                                        buffer.data(),
@@ -1107,12 +1163,10 @@ namespace isobus
 						auto messageData = message->get_data();
 
 						DM22Data tempDM22Data;
-						bool wasDTCCleared = false;
 
-						tempDM22Data.suspectParameterNumber = messageData.at(5);
-						tempDM22Data.suspectParameterNumber |= (messageData.at(6) << 8);
-						tempDM22Data.suspectParameterNumber |= (((messageData.at(7) & 0xE0) >> 5) << 16);
-						tempDM22Data.failureModeIdentifier = (messageData.at(7) & 0x1F);
+						tempDM22Data.suspectParameterNumber = static_cast<std::uint32_t>(DM22SuspectParameterNumberLow::decode(messageData.data()) |
+						                                                                 (DM22SuspectParameterNumberHigh::decode(messageData.data()) << 16));
+						tempDM22Data.failureModeIdentifier = static_cast<std::uint8_t>(DM22FailureModeIdentifier::decode(messageData.data()));
 						tempDM22Data.destination = message->get_source_control_function();
 						tempDM22Data.nackIndicator = 0;
 						tempDM22Data.clearActive = false;
@@ -1123,90 +1177,56 @@ namespace isobus
 							{
 								tempDM22Data.clearActive = true;
 
-								for (auto dtc = activeDTCList.begin(); dtc != activeDTCList.end(); dtc++)
+								auto dtcLocation = dtcIndex.find(get_dtc_index_key(tempDM22Data.suspectParameterNumber, tempDM22Data.failureModeIdentifier));
+
+								if ((dtcIndex.end() != dtcLocation) && (dtcLocation->second.active))
 								{
-									if ((tempDM22Data.suspectParameterNumber == dtc->suspectParameterNumber) &&
-									    (tempDM22Data.failureModeIdentifier == dtc->failureModeIdentifier))
-									{
-										inactiveDTCList.push_back(*dtc);
-										activeDTCList.erase(dtc);
-										wasDTCCleared = true;
-										tempDM22Data.nack = false;
-
-										dm22ResponseQueue.push_back(tempDM22Data);
-										txFlags.set_flag(static_cast<std::uint32_t>(TransmitFlags::DM22));
-										break;
-									}
+									add_dtc_to_list(remove_dtc_from_list(true, dtcLocation->second.listIndex), false);
+									tempDM22Data.nack = false;
 								}
-
-								if (!wasDTCCleared)
+								else if (dtcIndex.end() != dtcLocation)
 								{
+									// The DTC was active, but is inactive now, so we NACK with the proper reason
 									tempDM22Data.nack = true;
-
-									// Since we didn't find the DTC in the active list, we check the inactive to determine the proper NACK reason
-									for (auto dtc : inactiveDTCList)
-									{
-										if ((tempDM22Data.suspectParameterNumber == dtc.suspectParameterNumber) &&
-										    (tempDM22Data.failureModeIdentifier == dtc.failureModeIdentifier))
-										{
-											// The DTC was active, but is inactive now, so we NACK with the proper reason
-											tempDM22Data.nackIndicator = static_cast<std::uint8_t>(DM22NegativeAcknowledgeIndicator::DTCNoLongerActive);
-											break;
-										}
-									}
-
-									if (0 != tempDM22Data.nackIndicator)
-									{
-										// DTC is in neither list. NACK with the reason that we don't know anything about it
-										tempDM22Data.nackIndicator = static_cast<std::uint8_t>(DM22NegativeAcknowledgeIndicator::UnknownOrDoesNotExist);
-									}
-									dm22ResponseQueue.push_back(tempDM22Data);
-									txFlags.set_flag(static_cast<std::uint32_t>(TransmitFlags::DM22));
+									tempDM22Data.nackIndicator = static_cast<std::uint8_t>(DM22NegativeAcknowledgeIndicator::DTCNoLongerActive);
+								}
+								else
+								{
+									// DTC is in neither list. NACK with the reason that we don't know anything about it
+									tempDM22Data.nack = true;
+									tempDM22Data.nackIndicator = static_cast<std::uint8_t>(DM22NegativeAcknowledgeIndicator::UnknownOrDoesNotExist);
 								}
+								dm22ResponseQueue.push_back(tempDM22Data);
+								txFlags.set_flag(static_cast<std::uint32_t>(TransmitFlags::DM22));
 							}
 							break;
 
 							case static_cast<std::uint8_t>(DM22ControlByte::RequestToClearPreviouslyActiveDTC):
 							{
-								for (auto dtc = inactiveDTCList.begin(); dtc != inactiveDTCList.end(); dtc++)
+								auto dtcLocation = dtcIndex.find(get_dtc_index_key(tempDM22Data.suspectParameterNumber, tempDM22Data.failureModeIdentifier));
+
+								if ((dtcIndex.end() != dtcLocation) && (!dtcLocation->second.active))
 								{
-									if ((tempDM22Data.suspectParameterNumber == dtc->suspectParameterNumber) &&
-									    (tempDM22Data.failureModeIdentifier == dtc->failureModeIdentifier))
-									{
-										inactiveDTCList.erase(dtc);
-										wasDTCCleared = true;
-										tempDM22Data.nack = false;
-
-										dm22ResponseQueue.push_back(tempDM22Data);
-										txFlags.set_flag(static_cast<std::uint32_t>(TransmitFlags::DM22));
-										break;
-									}
-								}
+									const DiagnosticTroubleCode clearedDTC = remove_dtc_from_list(false, dtcLocation->second.listIndex);
 
-								if (!wasDTCCleared)
+									remove_freeze_frame(clearedDTC);
+									log_dtc_state(clearedDTC, DiagnosticTroubleCodeLog::RecordType::Cleared);
+									tempDM22Data.nack = false;
+								}
+								else if (dtcIndex.end() != dtcLocation)
 								{
+									// The DTC was inactive, but is active now, so we NACK with the proper reason
 									tempDM22Data.nack = true;
-
-									// Since we didn't find the DTC in the inactive list, we check the active to determine the proper NACK reason
-									for (auto dtc : activeDTCList)
-									{
-										if ((tempDM22Data.suspectParameterNumber == dtc.suspectParameterNumber) &&
-										    (tempDM22Data.failureModeIdentifier == dtc.failureModeIdentifier))
-										{
-											// The DTC was inactive, but is active now, so we NACK with the proper reason
-											tempDM22Data.nackIndicator = static_cast<std::uint8_t>(DM22NegativeAcknowledgeIndicator::DTCUNoLongerPreviouslyActive);
-											break;
-										}
-									}
-
-									if (0 != tempDM22Data.nackIndicator)
-									{
-										// DTC is in neither list. NACK with the reason that we don't know anything about it
-										tempDM22Data.nackIndicator = static_cast<std::uint8_t>(DM22NegativeAcknowledgeIndicator::UnknownOrDoesNotExist);
-									}
-									dm22ResponseQueue.push_back(tempDM22Data);
-									txFlags.set_flag(static_cast<std::uint32_t>(TransmitFlags::DM22));
+									tempDM22Data.nackIndicator = static_cast<std::uint8_t>(DM22NegativeAcknowledgeIndicator::DTCUNoLongerPreviouslyActive);
 								}
+								else
+								{
+									// DTC is in neither list. NACK with the reason that we don't know anything about it
+									tempDM22Data.nack = true;
+									tempDM22Data.nackIndicator = static_cast<std::uint8_t>(DM22NegativeAcknowledgeIndicator::UnknownOrDoesNotExist);
+								}
+								dm22ResponseQueue.push_back(tempDM22Data);
+								txFlags.set_flag(static_cast<std::uint32_t>(TransmitFlags::DM22));
 							}
 							break;
 
@@ -1255,6 +1275,20 @@ namespace isobus
 				}
 				break;
 
+				case static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage4):
+				{
+					txFlags.set_flag(static_cast<std::uint32_t>(TransmitFlags::DM4));
+					retVal = true;
+				}
+				break;
+
+				case static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage25):
+				{
+					txFlags.set_flag(static_cast<std::uint32_t>(TransmitFlags::DM25));
+					retVal = true;
+				}
+				break;
+
 				case static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage3):
 				{
 					clear_inactive_diagnostic_trouble_codes();
@@ -1368,6 +1402,18 @@ namespace isobus
 				}
 				break;
 
+				case static_cast<std::uint32_t>(TransmitFlags::DM4):
+				{
+					transmitSuccessful = parent->send_freeze_frames(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage4));
+				}
+				break;
+
+				case static_cast<std::uint32_t>(TransmitFlags::DM25):
+				{
+					transmitSuccessful = parent->send_freeze_frames(static_cast<std::uint32_t>(CANLibParameterGroupNumber::DiagnosticMessage25));
+				}
+				break;
+
 				default:
 				{
 				}
@@ -0,0 +1,444 @@
+//================================================================================================
+/// @file isobus_diagnostic_trouble_code_log.cpp
+///
+/// @brief A crash-safe, memory mapped, append-only log of diagnostic trouble code state changes,
+/// which lets the diagnostic protocol keep its DM2 history and occurrence counts across power cycles.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#include "isobus/isobus/isobus_diagnostic_trouble_code_log.hpp"
+
+#include "isobus/isobus/can_stack_logger.hpp"
+#include "isobus/utility/replace_file.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+
+namespace isobus
+{
+	constexpr std::uint32_t DiagnosticTroubleCodeLog::DEFAULT_RECORD_CAPACITY;
+	constexpr std::uint32_t DiagnosticTroubleCodeLog::RECORD_SIZE;
+	constexpr std::uint32_t DiagnosticTroubleCodeLog::HEADER_SIZE;
+
+	DiagnosticTroubleCodeLog::DiagnosticTroubleCodeLog(const std::string &filename, std::uint32_t capacity) :
+	  logFilename(filename),
+	  workerThread(nullptr),
+	  appendedRecordCount(0),
+	  flushedRecordCount(0),
+	  recordCapacity(std::max<std::uint32_t>(capacity, 1)),
+	  numberOfRecords(0),
+	  numberOfCompactions(0),
+	  stopRequested(false)
+	{
+	}
+
+	DiagnosticTroubleCodeLog::~DiagnosticTroubleCodeLog()
+	{
+		close();
+	}
+
+	bool DiagnosticTroubleCodeLog::open(std::vector<Record> &restoredRecords)
+	{
+		bool retVal = false;
+
+		restoredRecords.clear();
+
+		if (!get_is_open())
+		{
+			currentState.clear();
+			numberOfRecords = 0;
+			numberOfCompactions = 0;
+
+			if (mappedFile.open_read_write(logFilename, HEADER_SIZE + (static_cast<std::size_t>(recordCapacity) * RECORD_SIZE)))
+			{
+				const std::uint8_t *fileData = mappedFile.get_data();
+				const std::uint32_t fileCapacity = static_cast<std::uint32_t>((mappedFile.get_size() - HEADER_SIZE) / RECORD_SIZE);
+				bool headerValid = false;
+				bool needsCompaction = false;
+
+				if ((fileData[0] | (fileData[1] << 8) | (fileData[2] << 16) | (static_cast<std::uint32_t>(fileData[3]) << 24)) == FILE_MAGIC)
+				{
+					const std::uint32_t headerCRC = (fileData[12] | (fileData[13] << 8) | (fileData[14] << 16) | (static_cast<std::uint32_t>(fileData[15]) << 24));
+
+					headerValid = ((calculate_crc32(fileData, HEADER_SIZE - 4) == headerCRC) &&
+					               (FILE_VERSION == (fileData[4] | (fileData[5] << 8))) &&
+					               (RECORD_SIZE == static_cast<std::uint32_t>(fileData[6] | (fileData[7] << 8))));
+				}
+
+				if (headerValid)
+				{
+					Record record;
+					std::uint32_t index = 0;
+
+					while ((index < fileCapacity) &&
+					       (decode_record(fileData + HEADER_SIZE + (index * RECORD_SIZE), index, record)))
+					{
+						apply_record(record);
+						index++;
+					}
+					numberOfRecords = index;
+					recordCapacity = fileCapacity;
+
+					// Anything after the last good record must be untouched, or a later append could make stale records valid again
+					const std::uint8_t *unusedStart = fileData + HEADER_SIZE + (static_cast<std::size_t>(index) * RECORD_SIZE);
+					if (!std::all_of(unusedStart, fileData + mappedFile.get_size(), [](std::uint8_t value) { return 0 == value; }))
+					{
+						CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[DTC Log]: Ignoring damaged records at the end of " + logFilename);
+						needsCompaction = true;
+					}
+					else if ((numberOfRecords > (recordCapacity / 2)) &&
+					         ((numberOfRecords - currentState.size()) > currentState.size()))
+					{
+						// Most of the file is stale, so shrink it now to keep the next startup fast
+						needsCompaction = true;
+					}
+				}
+				else
+				{
+					const std::uint8_t *headerEnd = fileData + HEADER_SIZE;
+
+					if (!std::all_of(fileData, headerEnd, [](std::uint8_t value) { return 0 == value; }))
+					{
+						CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[DTC Log]: " + logFilename + " is not a valid DTC log, starting a new one");
+					}
+					needsCompaction = true;
+				}
+
+				if ((!needsCompaction) || compact())
+				{
+					for (const auto &dtcState : currentState)
+					{
+						restoredRecords.push_back(dtcState.second);
+					}
+
+					stopRequested = false;
+					appendedRecordCount = 0;
+					flushedRecordCount = 0;
+					workerThread = new std::thread([this]() { worker_thread_function(); });
+					retVal = true;
+				}
+				else
+				{
+					mappedFile.close();
+				}
+			}
+			else
+			{
+				CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[DTC Log]: Unable to map " + logFilename);
+			}
+		}
+		return retVal;
+	}
+
+	void DiagnosticTroubleCodeLog::close()
+	{
+		if (nullptr != workerThread)
+		{
+			{
+				const std::lock_guard<std::mutex> lock(logMutex);
+				stopRequested = true;
+			}
+			workerWakeCondition.notify_all();
+			workerThread->join();
+			delete workerThread;
+			workerThread = nullptr;
+		}
+		mappedFile.close();
+		currentState.clear();
+	}
+
+	bool DiagnosticTroubleCodeLog::get_is_open() const
+	{
+		return (nullptr != workerThread);
+	}
+
+	bool DiagnosticTroubleCodeLog::append(const Record &record)
+	{
+		bool retVal = false;
+
+		if (get_is_open())
+		{
+			{
+				const std::lock_guard<std::mutex> lock(logMutex);
+				pendingRecords.push_back(record);
+				appendedRecordCount++;
+			}
+			workerWakeCondition.notify_one();
+			retVal = true;
+		}
+		return retVal;
+	}
+
+	void DiagnosticTroubleCodeLog::flush()
+	{
+		std::unique_lock<std::mutex> lock(logMutex);
+		const std::uint64_t targetRecordCount = appendedRecordCount;
+
+		flushedCondition.wait(lock, [this, targetRecordCount]() { return (flushedRecordCount >= targetRecordCount) || (nullptr == workerThread); });
+	}
+
+	std::uint32_t DiagnosticTroubleCodeLog::get_number_of_records() const
+	{
+		return numberOfRecords;
+	}
+
+	std::uint32_t DiagnosticTroubleCodeLog::get_number_of_compactions() const
+	{
+		return numberOfCompactions;
+	}
+
+	std::uint32_t DiagnosticTroubleCodeLog::calculate_crc32(const std::uint8_t *data, std::size_t length)
+	{
+		static const std::array<std::uint32_t, 256> crcTable = []() {
+			std::array<std::uint32_t, 256> table;
+
+			for (std::uint32_t i = 0; i < table.size(); i++)
+			{
+				std::uint32_t value = i;
+
+				for (std::uint8_t bit = 0; bit < 8; bit++)
+				{
+					value = (0 != (value & 1)) ? (0xEDB88320 ^ (value >> 1)) : (value >> 1);
+				}
+				table[i] = value;
+			}
+			return table;
+		}();
+		std::uint32_t retVal = 0xFFFFFFFF;
+
+		for (std::size_t i = 0; i < length; i++)
+		{
+			retVal = crcTable[(retVal ^ data[i]) & 0xFF] ^ (retVal >> 8);
+		}
+		return retVal ^ 0xFFFFFFFF;
+	}
+
+	std::uint32_t DiagnosticTroubleCodeLog::get_record_key(const Record &record)
+	{
+		return ((record.suspectParameterNumber & 0x7FFFF) << 5) | (record.failureModeIdentifier & 0x1F);
+	}
+
+	void DiagnosticTroubleCodeLog::encode_record(const Record &record, std::uint32_t index, std::uint8_t *buffer)
+	{
+		std::uint8_t encodedRecord[RECORD_SIZE];
+
+		encodedRecord[0] = static_cast<std::uint8_t>(record.suspectParameterNumber & 0xFF);
+		encodedRecord[1] = static_cast<std::uint8_t>((record.suspectParameterNumber >> 8) & 0xFF);
+		encodedRecord[2] = static_cast<std::uint8_t>((record.suspectParameterNumber >> 16) & 0xFF);
+		encodedRecord[3] = static_cast<std::uint8_t>((record.suspectParameterNumber >> 24) & 0xFF);
+		encodedRecord[4] = record.failureModeIdentifier;
+		encodedRecord[5] = record.lampState;
+		encodedRecord[6] = record.occurranceCount;
+		encodedRecord[7] = static_cast<std::uint8_t>(record.type);
+		encodedRecord[8] = static_cast<std::uint8_t>(index & 0xFF);
+		encodedRecord[9] = static_cast<std::uint8_t>((index >> 8) & 0xFF);
+		encodedRecord[10] = static_cast<std::uint8_t>((index >> 16) & 0xFF);
+		encodedRecord[11] = static_cast<std::uint8_t>((index >> 24) & 0xFF);
+
+		const std::uint32_t crc = calculate_crc32(encodedRecord, RECORD_SIZE - 4);
+		encodedRecord[12] = static_cast<std::uint8_t>(crc & 0xFF);
+		encodedRecord[13] = static_cast<std::uint8_t>((crc >> 8) & 0xFF);
+		encodedRecord[14] = static_cast<std::uint8_t>((crc >> 16) & 0xFF);
+		encodedRecord[15] = static_cast<std::uint8_t>((crc >> 24) & 0xFF);
+
+		// Copy the finished record in one go, so the mapping never holds a record with a matching CRC but partial contents
+		memcpy(buffer, encodedRecord, RECORD_SIZE);
+	}
+
+	bool DiagnosticTroubleCodeLog::decode_record(const std::uint8_t *buffer, std::uint32_t index, Record &record)
+	{
+		const std::uint32_t storedCRC = (buffer[12] | (buffer[13] << 8) | (buffer[14] << 16) | (static_cast<std::uint32_t>(buffer[15]) << 24));
+		const std::uint32_t storedIndex = (buffer[8] | (buffer[9] << 8) | (buffer[10] << 16) | (static_cast<std::uint32_t>(buffer[11]) << 24));
+		bool retVal = false;
+
+		if ((storedIndex == index) &&
+		    (buffer[7] <= static_cast<std::uint8_t>(RecordType::ClearAllPreviouslyActive)) &&
+		    (calculate_crc32(buffer, RECORD_SIZE - 4) == storedCRC))
+		{
+			record.suspectParameterNumber = (buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) | (static_cast<std::uint32_t>(buffer[3]) << 24));
+			record.failureModeIdentifier = buffer[4];
+			record.lampState = buffer[5];
+			record.occurranceCount = buffer[6];
+			record.type = static_cast<RecordType>(buffer[7]);
+			retVal = true;
+		}
+		return retVal;
+	}
+
+	void DiagnosticTroubleCodeLog::apply_record(const Record &record)
+	{
+		switch (record.type)
+		{
+			case RecordType::Active:
+			case RecordType::PreviouslyActive:
+			{
+				currentState[get_record_key(record)] = record;
+			}
+			break;
+
+			case RecordType::Cleared:
+			{
+				currentState.erase(get_record_key(record));
+			}
+			break;
+
+			case RecordType::ClearAllPreviouslyActive:
+			{
+				for (auto dtcState = currentState.begin(); dtcState != currentState.end();)
+				{
+					if (RecordType::PreviouslyActive == dtcState->second.type)
+					{
+						dtcState = currentState.erase(dtcState);
+					}
+					else
+					{
+						dtcState++;
+					}
+				}
+			}
+			break;
+		}
+	}
+
+	bool DiagnosticTroubleCodeLog::compact()
+	{
+		const std::string temporaryFilename = logFilename + ".tmp";
+		std::uint32_t newCapacity = recordCapacity;
+		MemoryMappedFile temporaryFile;
+		bool retVal = false;
+
+		// Leave at least half the new file free, so compactions stay rare
+		while ((currentState.size() * 2) > newCapacity)
+		{
+			newCapacity *= 2;
+		}
+
+		// Start from an empty file, so nothing from an older log can be mistaken for a record
+		std::remove(temporaryFilename.c_str());
+
+		if (temporaryFile.open_read_write(temporaryFilename, HEADER_SIZE + (static_cast<std::size_t>(newCapacity) * RECORD_SIZE)))
+		{
+			std::uint8_t *fileData = temporaryFile.get_writable_data();
+			std::uint32_t index = 0;
+
+			fileData[0] = static_cast<std::uint8_t>(FILE_MAGIC & 0xFF);
+			fileData[1] = static_cast<std::uint8_t>((FILE_MAGIC >> 8) & 0xFF);
+			fileData[2] = static_cast<std::uint8_t>((FILE_MAGIC >> 16) & 0xFF);
+			fileData[3] = static_cast<std::uint8_t>((FILE_MAGIC >> 24) & 0xFF);
+			fileData[4] = static_cast<std::uint8_t>(FILE_VERSION & 0xFF);
+			fileData[5] = static_cast<std::uint8_t>((FILE_VERSION >> 8) & 0xFF);
+			fileData[6] = static_cast<std::uint8_t>(RECORD_SIZE & 0xFF);
+			fileData[7] = static_cast<std::uint8_t>((RECORD_SIZE >> 8) & 0xFF);
+			fileData[8] = static_cast<std::uint8_t>(newCapacity & 0xFF);
+			fileData[9] = static_cast<std::uint8_t>((newCapacity >> 8) & 0xFF);
+			fileData[10] = static_cast<std::uint8_t>((newCapacity >> 16) & 0xFF);
+			fileData[11] = static_cast<std::uint8_t>((newCapacity >> 24) & 0xFF);
+
+			const std::uint32_t headerCRC = calculate_crc32(fileData, HEADER_SIZE - 4);
+			fileData[12] = static_cast<std::uint8_t>(headerCRC & 0xFF);
+			fileData[13] = static_cast<std::uint8_t>((headerCRC >> 8) & 0xFF);
+			fileData[14] = static_cast<std::uint8_t>((headerCRC >> 16) & 0xFF);
+			fileData[15] = static_cast<std::uint8_t>((headerCRC >> 24) & 0xFF);
+
+			for (const auto &dtcState : currentState)
+			{
+				encode_record(dtcState.second, index, fileData + HEADER_SIZE + (static_cast<std::size_t>(index) * RECORD_SIZE));
+				index++;
+			}
+
+			// The new file must be complete on disk before it replaces the old one
+			if (temporaryFile.flush())
+			{
+				temporaryFile.close();
+				mappedFile.close();
+
+				if (replace_file(temporaryFilename, logFilename))
+				{
+					if (mappedFile.open_read_write(logFilename, HEADER_SIZE + (static_cast<std::size_t>(newCapacity) * RECORD_SIZE)))
+					{
+						recordCapacity = newCapacity;
+						numberOfRecords = index;
+						numberOfCompactions++;
+						retVal = true;
+					}
+				}
+				else
+				{
+					// Keep appending to the old file, which is still intact
+					mappedFile.open_read_write(logFilename, 0);
+				}
+			}
+		}
+
+		if (!retVal)
+		{
+			CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[DTC Log]: Failed to compact " + logFilename);
+		}
+		return retVal;
+	}
+
+	bool DiagnosticTroubleCodeLog::write_record(const Record &record)
+	{
+		bool retVal = false;
+
+		apply_record(record);
+
+		if (!mappedFile.get_is_open())
+		{
+			// A previous compaction failed to reopen the file, so try to recover by writing a fresh one
+			retVal = compact();
+		}
+		else if (numberOfRecords < recordCapacity)
+		{
+			encode_record(record, numberOfRecords, mappedFile.get_writable_data() + HEADER_SIZE + (static_cast<std::size_t>(numberOfRecords) * RECORD_SIZE));
+			numberOfRecords++;
+			retVal = true;
+		}
+		else
+		{
+			// The compacted file contains the latest state of each DTC, which already includes this record
+			retVal = compact();
+		}
+		return retVal;
+	}
+
+	void DiagnosticTroubleCodeLog::worker_thread_function()
+	{
+		std::unique_lock<std::mutex> lock(logMutex);
+
+		while ((!stopRequested) || (!pendingRecords.empty()))
+		{
+			workerWakeCondition.wait(lock, [this]() { return stopRequested || (!pendingRecords.empty()); });
+
+			if (!pendingRecords.empty())
+			{
+				const std::uint64_t batchEndCount = appendedRecordCount;
+
+				std::swap(pendingRecords, writingRecords);
+				lock.unlock();
+
+				for (const auto &record : writingRecords)
+				{
+					if (!write_record(record))
+					{
+						CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[DTC Log]: Failed to write a record to " + logFilename);
+					}
+				}
+				writingRecords.clear();
+
+				if (mappedFile.get_is_open())
+				{
+					mappedFile.flush();
+				}
+
+				lock.lock();
+				flushedRecordCount = batchEndCount;
+				flushedCondition.notify_all();
+			}
+		}
+	}
+} // namespace isobus
@@ -0,0 +1,169 @@
+//================================================================================================
+/// @file isobus_freeze_frame_signal_recorder.cpp
+///
+/// @brief Keeps the recent history of a set of SPNs in lock-free ring buffers, so that the
+/// diagnostic protocol can capture the operating conditions when a DTC becomes active.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#include "isobus/isobus/isobus_freeze_frame_signal_recorder.hpp"
+
+#include "isobus/utility/system_timing.hpp"
+
+namespace isobus
+{
+	constexpr std::size_t FreezeFrameSignalRecorder::INVALID_SIGNAL_INDEX;
+	constexpr std::uint32_t FreezeFrameSignalRecorder::DEFAULT_HISTORY_DURATION_MS;
+
+	FreezeFrameSignalRecorder::Signal::Signal(std::uint32_t spn, std::uint8_t length) :
+	  writeCount(0),
+	  suspectParameterNumber(spn),
+	  dataLength(length)
+	{
+		for (auto &slot : slots)
+		{
+			slot.sequence.store(0, std::memory_order_relaxed);
+			slot.value.store(0, std::memory_order_relaxed);
+			slot.timestamp_ms.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	FreezeFrameSignalRecorder::FreezeFrameSignalRecorder(std::uint32_t historyDuration) :
+	  historyDuration_ms(historyDuration),
+	  snapshotLength(0)
+	{
+	}
+
+	std::size_t FreezeFrameSignalRecorder::add_signal(std::uint32_t suspectParameterNumber, std::uint8_t dataLength)
+	{
+		std::size_t retVal = INVALID_SIGNAL_INDEX;
+
+		if ((dataLength > 0) &&
+		    (dataLength <= sizeof(std::uint32_t)) &&
+		    (suspectParameterNumber <= 0x7FFFF))
+		{
+			retVal = signals.size();
+			signals.emplace_back(new Signal(suspectParameterNumber, dataLength));
+			snapshotLength += dataLength;
+		}
+		return retVal;
+	}
+
+	bool FreezeFrameSignalRecorder::record(std::size_t signalIndex, std::uint32_t value)
+	{
+		bool retVal = false;
+
+		if (signalIndex < signals.size())
+		{
+			Signal &signal = *signals[signalIndex];
+			const std::uint32_t writeCount = signal.writeCount.load(std::memory_order_relaxed);
+			Slot &slot = signal.slots[writeCount & (SAMPLES_PER_SIGNAL - 1)];
+
+			// Mark the slot as being written, so a reader that catches us part way through will try again
+			slot.sequence.store((writeCount * 2) + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			slot.value.store(value, std::memory_order_relaxed);
+			slot.timestamp_ms.store(SystemTiming::get_timestamp_ms(), std::memory_order_relaxed);
+			slot.sequence.store((writeCount * 2) + 2, std::memory_order_release);
+			signal.writeCount.store(writeCount + 1, std::memory_order_release);
+			retVal = true;
+		}
+		return retVal;
+	}
+
+	bool FreezeFrameSignalRecorder::get_latest_sample(std::size_t signalIndex, Sample &sample) const
+	{
+		bool retVal = false;
+
+		if (signalIndex < signals.size())
+		{
+			const Signal &signal = *signals[signalIndex];
+
+			for (std::uint8_t i = 0; i < MAX_READ_ATTEMPTS; i++)
+			{
+				const std::uint32_t writeCount = signal.writeCount.load(std::memory_order_acquire);
+
+				if (0 == writeCount)
+				{
+					break;
+				}
+
+				const Slot &slot = signal.slots[(writeCount - 1) & (SAMPLES_PER_SIGNAL - 1)];
+				const std::uint32_t sequenceBefore = slot.sequence.load(std::memory_order_acquire);
+				const std::uint32_t value = slot.value.load(std::memory_order_relaxed);
+				const std::uint32_t timestamp = slot.timestamp_ms.load(std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_acquire);
+				const std::uint32_t sequenceAfter = slot.sequence.load(std::memory_order_relaxed);
+
+				if ((sequenceBefore == sequenceAfter) &&
+				    (sequenceBefore == (writeCount * 2)))
+				{
+					if ((0 == historyDuration_ms) ||
+					    (!SystemTiming::time_expired_ms(timestamp, historyDuration_ms)))
+					{
+						sample.value = value;
+						sample.timestamp_ms = timestamp;
+						retVal = true;
+					}
+					break;
+				}
+				// Otherwise the writer lapped the ring while we were reading, so try again with the newest sample
+			}
+		}
+		return retVal;
+	}
+
+	std::size_t FreezeFrameSignalRecorder::get_number_of_signals() const
+	{
+		return signals.size();
+	}
+
+	std::uint32_t FreezeFrameSignalRecorder::get_suspect_parameter_number(std::size_t signalIndex) const
+	{
+		std::uint32_t retVal = 0xFFFFFFFF;
+
+		if (signalIndex < signals.size())
+		{
+			retVal = signals[signalIndex]->suspectParameterNumber;
+		}
+		return retVal;
+	}
+
+	std::uint16_t FreezeFrameSignalRecorder::get_snapshot_length() const
+	{
+		return snapshotLength;
+	}
+
+	std::uint16_t FreezeFrameSignalRecorder::capture_snapshot(std::uint8_t *buffer, std::uint16_t bufferSize) const
+	{
+		std::uint16_t retVal = 0;
+
+		if (nullptr != buffer)
+		{
+			for (std::size_t i = 0; i < signals.size(); i++)
+			{
+				const std::uint8_t dataLength = signals[i]->dataLength;
+				Sample sample;
+
+				if ((retVal + dataLength) > bufferSize)
+				{
+					break;
+				}
+
+				if (!get_latest_sample(i, sample))
+				{
+					sample.value = 0xFFFFFFFF;
+				}
+
+				for (std::uint8_t j = 0; j < dataLength; j++)
+				{
+					buffer[retVal] = static_cast<std::uint8_t>((sample.value >> (8 * j)) & 0xFF);
+					retVal++;
+				}
+			}
+		}
+		return retVal;
+	}
+} // namespace isobus
@@ -2,6 +2,7 @@
 
 #include "isobus/isobus/can_constants.hpp"
 #include "isobus/isobus/can_general_parameter_group_numbers.hpp"
+#include "isobus/isobus/can_message_schema.hpp"
 #include "isobus/isobus/can_parameter_group_number_request_protocol.hpp"
 #include "isobus/isobus/can_partnered_control_function.hpp"
 #include "isobus/isobus/can_stack_logger.hpp"
@@ -10,6 +11,32 @@
 
 namespace isobus
 {
+	// The language command (ISO 11783-7 B.2), bytes 0 and 1 are the language code and bytes 6 and 7 are reserved
+	using LanguageCommandTimeFormat = MessageField<20, 2>;
+	using LanguageCommandDecimalSymbol = MessageField<22, 2>;
+	using LanguageCommandDateFormat = MessageField<24, 8>;
+	using LanguageCommandMassUnits = MessageField<32, 2>;
+	using LanguageCommandVolumeUnits = MessageField<34, 2>;
+	using LanguageCommandAreaUnits = MessageField<36, 2>;
+	using LanguageCommandDistanceUnits = MessageField<38, 2>;
+	using LanguageCommandGenericUnits = MessageField<40, 2>;
+	using LanguageCommandForceUnits = MessageField<42, 2>;
+	using LanguageCommandPressureUnits = MessageField<44, 2>;
+	using LanguageCommandTemperatureUnits = MessageField<46, 2>;
+	using LanguageCommandLayout = MessageLayout<CAN_DATA_LENGTH,
+	                                            LanguageCommandTimeFormat,
+	                                            LanguageCommandDecimalSymbol,
+	                                            LanguageCommandDateFormat,
+	                                            LanguageCommandMassUnits,
+	                                            LanguageCommandVolumeUnits,
+	                                            LanguageCommandAreaUnits,
+	                                            LanguageCommandDistanceUnits,
+	                                            LanguageCommandGenericUnits,
+	                                            LanguageCommandForceUnits,
+	                                            LanguageCommandPressureUnits,
+	                                            LanguageCommandTemperatureUnits>;
+	static_assert(LanguageCommandLayout::DATA_LENGTH == CAN_DATA_LENGTH, "The language command is a single frame message");
+
 	LanguageCommandInterface::LanguageCommandInterface(std::shared_ptr<InternalControlFunction> sourceControlFunction) :
 	  myControlFunction(sourceControlFunction),
 	  myPartner(nullptr)
@@ -155,17 +182,17 @@ namespace isobus
 			parentInterface->languageCode.clear();
 			parentInterface->languageCode.push_back(static_cast<char>(data.at(0)));
 			parentInterface->languageCode.push_back(static_cast<char>(data.at(1)));
-			parentInterface->timeFormat = static_cast<TimeFormats>((data.at(2) >> 4) & 0x03);
-			parentInterface->decimalSymbol = static_cast<DecimalSymbols>((data.at(2) >> 6) & 0x03);
-			parentInterface->dateFormat = static_cast<DateFormats>(data.at(3));
-			parentInterface->massUnitSystem = static_cast<MassUnits>(data.at(4) & 0x03);
-			parentInterface->volumeUnitSystem = static_cast<VolumeUnits>((data.at(4) >> 2) & 0x03);
-			parentInterface->areaUnitSystem = static_cast<AreaUnits>((data.at(4) >> 4) & 0x03);
-			parentInterface->distanceUnitSystem = static_cast<DistanceUnits>((data.at(4) >> 6) & 0x03);
-			parentInterface->genericUnitSystem = static_cast<UnitSystem>(data.at(5) & 0x03);
-			parentInterface->forceUnitSystem = static_cast<ForceUnits>((data.at(5) >> 2) & 0x03);
-			parentInterface->pressureUnitSystem = static_cast<PressureUnits>((data.at(5) >> 4) & 0x03);
-			parentInterface->temperatureUnitSystem = static_cast<TemperatureUnits>((data.at(5) >> 6) & 0x03);
+			parentInterface->timeFormat = static_cast<TimeFormats>(LanguageCommandTimeFormat::decode(data.data()));
+			parentInterface->decimalSymbol = static_cast<DecimalSymbols>(LanguageCommandDecimalSymbol::decode(data.data()));
+			parentInterface->dateFormat = static_cast<DateFormats>(LanguageCommandDateFormat::decode(data.data()));
+			parentInterface->massUnitSystem = static_cast<MassUnits>(LanguageCommandMassUnits::decode(data.data()));
+			parentInterface->volumeUnitSystem = static_cast<VolumeUnits>(LanguageCommandVolumeUnits::decode(data.data()));
+			parentInterface->areaUnitSystem = static_cast<AreaUnits>(LanguageCommandAreaUnits::decode(data.data()));
+			parentInterface->distanceUnitSystem = static_cast<DistanceUnits>(LanguageCommandDistanceUnits::decode(data.data()));
+			parentInterface->genericUnitSystem = static_cast<UnitSystem>(LanguageCommandGenericUnits::decode(data.data()));
+			parentInterface->forceUnitSystem = static_cast<ForceUnits>(LanguageCommandForceUnits::decode(data.data()));
+			parentInterface->pressureUnitSystem = static_cast<PressureUnits>(LanguageCommandPressureUnits::decode(data.data()));
+			parentInterface->temperatureUnitSystem = static_cast<TemperatureUnits>(LanguageCommandTemperatureUnits::decode(data.data()));
 
 			CANStackLogger::debug("[VT/TC]: Language and unit data received from control function " +
 			                      isobus::to_string(static_cast<int>(message->get_identifier().get_source_address())) +
@@ -15,13 +15,26 @@
 #include "isobus/utility/to_string.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstring>
+#include <limits>
 #include <map>
 #include <unordered_map>
 
 namespace isobus
 {
+	/// @brief The priority and callback for the next command sent inside VirtualTerminalClient::send_command_with_completion()
+	struct VTCommandCompletionOptions
+	{
+		const VirtualTerminalClient *client; ///< The client whose send_command_with_completion() is running
+		VirtualTerminalCommandPipeline::Priority priority; ///< The lane to queue the command in
+		VirtualTerminalCommandPipeline::CompletionCallback callback; ///< Called when the command finishes
+	};
+
+	/// @brief The completion options of the send_command_with_completion() call running on this thread, if any
+	static thread_local VTCommandCompletionOptions *currentCompletionOptions = nullptr;
+
 	VirtualTerminalClient::VirtualTerminalClient(std::shared_ptr<PartneredControlFunction> partner, std::shared_ptr<InternalControlFunction> clientSource) :
 	  partnerControlFunction(partner),
 	  myControlFunction(clientSource),
@@ -48,14 +61,23 @@ namespace isobus
 	  currentObjectPoolState(CurrentObjectPoolUploadState::Uninitialized),
 	  stateMachineTimestamp_ms(0),
 	  lastWorkingSetMaintenanceTimestamp_ms(0),
-	  workerThread(nullptr),
+	  scaledPoolCache(std::make_shared<VirtualTerminalScaledPoolCache>()),
 	  firstTimeInState(false),
 	  initialized(false),
 	  sendWorkingSetMaintenenace(false),
 	  shouldTerminate(false),
 	  objectPoolDataCallback(nullptr),
 	  objectPoolSize_bytes(0),
-	  lastObjectPoolIndex(0)
+	  lastObjectPoolIndex(0),
+	  commandCoalescingInterval_ms(DEFAULT_COMMAND_COALESCING_INTERVAL_MS),
+	  lastCoalescedCommandFlushTimestamp_ms(0),
+	  numberSuppressedCommands(0),
+	  commandCoalescingEnabled(false),
+	  flushCoalescedCommandsOnResponse(true),
+	  shadowStateEnabled(false),
+	  partialUploadInProgress(false),
+	  lastUploadWasPartial(false),
+	  commandPipelineEnabled(false)
 	{
 		if (nullptr != partnerControlFunction)
 		{
@@ -72,6 +94,18 @@ namespace isobus
 	}
 
 	void VirtualTerminalClient::initialize(bool spawnThread)
+	{
+		std::shared_ptr<VirtualTerminalClientExecutor> ownExecutor;
+
+		if ((spawnThread) &&
+		    ((!initialized) || (shouldTerminate)))
+		{
+			ownExecutor = std::make_shared<VirtualTerminalClientExecutor>();
+		}
+		initialize(ownExecutor);
+	}
+
+	void VirtualTerminalClient::initialize(std::shared_ptr<VirtualTerminalClientExecutor> sharedExecutor)
 	{
 		if (shouldTerminate)
 		{
@@ -81,9 +115,13 @@ namespace isobus
 
 		if (!initialized)
 		{
-			if (spawnThread)
+			if (nullptr != sharedExecutor)
 			{
-				workerThread = new std::thread([this]() { worker_thread_function(); });
+				{
+					const std::lock_guard<std::mutex> lock(executorMutex);
+					executor = sharedExecutor;
+				}
+				sharedExecutor->add_client(this);
 			}
 			initialized = true;
 		}
@@ -113,11 +151,17 @@ namespace isobus
 
 			shouldTerminate = true;
 
-			if (nullptr != workerThread)
+			std::shared_ptr<VirtualTerminalClientExecutor> previousExecutor;
+			{
+				const std::lock_guard<std::mutex> lock(executorMutex);
+				previousExecutor = std::move(executor);
+				executor = nullptr;
+			}
+
+			if (nullptr != previousExecutor)
 			{
-				workerThread->join();
-				delete workerThread;
-				workerThread = nullptr;
+				// If the client had its own executor, this also stops its thread
+				previousExecutor->remove_client(this);
 			}
 		}
 	}
@@ -323,12 +367,7 @@ namespace isobus
 			                                             0xFF,
 			                                             0xFF };
 
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_enable_disable_object(std::uint16_t objectID, EnableDisableObjectCommand command)
@@ -341,12 +380,7 @@ namespace isobus
 			                                             0xFF,
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_select_input_object(std::uint16_t objectID, SelectInputObjectOptions option)
@@ -359,12 +393,7 @@ namespace isobus
 			                                             0xFF,
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_ESC()
@@ -377,12 +406,7 @@ namespace isobus
 			                                             0xFF,
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_control_audio_signal(std::uint8_t activations, std::uint16_t frequency_hz, std::uint16_t duration_ms, std::uint16_t offTimeDuration_ms)
@@ -395,12 +419,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(duration_ms >> 8),
 			                                             static_cast<std::uint8_t>(offTimeDuration_ms & 0xFF),
 			                                             static_cast<std::uint8_t>(offTimeDuration_ms >> 8) };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_set_audio_volume(std::uint8_t volume_percent)
@@ -418,12 +437,7 @@ namespace isobus
 			                                             0xFF,
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_change_child_location(std::uint16_t objectID, std::uint16_t parentObjectID, std::uint8_t relativeXPositionChange, std::uint8_t relativeYPositionChange)
@@ -436,12 +450,7 @@ namespace isobus
 			                                             relativeXPositionChange,
 			                                             relativeYPositionChange,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_change_child_position(std::uint16_t objectID, std::uint16_t parentObjectID, std::uint16_t xPosition, std::uint16_t yPosition)
@@ -457,12 +466,7 @@ namespace isobus
 			static_cast<std::uint8_t>(yPosition & 0xFF),
 			static_cast<std::uint8_t>(yPosition >> 8),
 		};
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      9,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, 9);
 	}
 
 	bool VirtualTerminalClient::send_change_size_command(std::uint16_t objectID, std::uint16_t newWidth, std::uint16_t newHeight)
@@ -475,12 +479,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(newHeight & 0xFF),
 			                                             static_cast<std::uint8_t>(newHeight >> 8),
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_change_background_colour(std::uint16_t objectID, std::uint8_t colour)
@@ -493,12 +492,7 @@ namespace isobus
 			                                             0xFF,
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_change_numeric_value(std::uint16_t objectID, std::uint32_t value)
@@ -513,12 +507,7 @@ namespace isobus
 			static_cast<std::uint8_t>((value >> 16) & 0xFF),
 			static_cast<std::uint8_t>((value >> 24) & 0xFF),
 		};
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_change_string_value(std::uint16_t objectID, uint16_t stringLength, const char *value)
@@ -537,12 +526,7 @@ namespace isobus
 			{
 				buffer[5 + i] = value[i];
 			}
-			retVal = CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-			                                                        buffer,
-			                                                        5 + stringLength,
-			                                                        myControlFunction.get(),
-			                                                        partnerControlFunction.get(),
-			                                                        CANIdentifier::PriorityLowest7);
+			retVal = send_command(buffer, 5 + stringLength);
 			delete[] buffer;
 		}
 		return retVal;
@@ -563,12 +547,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(height_px & 0xFF),
 			                                             static_cast<std::uint8_t>(height_px >> 8),
 			                                             static_cast<std::uint8_t>(direction) };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_change_font_attributes(std::uint16_t objectID, std::uint8_t colour, FontSize size, std::uint8_t type, std::uint8_t styleBitfield)
@@ -581,12 +560,7 @@ namespace isobus
 			                                             type,
 			                                             styleBitfield,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_change_line_attributes(std::uint16_t objectID, std::uint8_t colour, std::uint8_t width, std::uint16_t lineArtBitmask)
@@ -599,12 +573,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(lineArtBitmask & 0xFF),
 			                                             static_cast<std::uint8_t>(lineArtBitmask >> 8),
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_change_fill_attributes(std::uint16_t objectID, FillType fillType, std::uint8_t colour, std::uint16_t fillPatternObjectID)
@@ -617,12 +586,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(fillPatternObjectID & 0xFF),
 			                                             static_cast<std::uint8_t>(fillPatternObjectID >> 8),
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_change_active_mask(std::uint16_t workingSetObjectID, std::uint16_t newActiveMaskObjectID)
@@ -635,12 +599,7 @@ namespace isobus
 			                                             0xFF,
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_change_softkey_mask(MaskType type, std::uint16_t dataOrAlarmMaskObjectID, std::uint16_t newSoftKeyMaskObjectID)
@@ -653,12 +612,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(newSoftKeyMaskObjectID >> 8),
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_change_attribute(std::uint16_t objectID, std::uint8_t attributeID, std::uint32_t value)
@@ -671,12 +625,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>((value >> 8) & 0xFF),
 			                                             static_cast<std::uint8_t>((value >> 16) & 0xFF),
 			                                             static_cast<std::uint8_t>((value >> 24) & 0xFF) };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_change_priority(std::uint16_t alarmMaskObjectID, AlarmMaskPriority priority)
@@ -689,12 +638,7 @@ namespace isobus
 			                                             0xFF,
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_change_list_item(std::uint16_t objectID, std::uint8_t listIndex, std::uint16_t newObjectID)
@@ -707,12 +651,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(newObjectID >> 8),
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_lock_unlock_mask(MaskLockState state, std::uint16_t objectID, std::uint16_t timeout_ms)
@@ -725,12 +664,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(timeout_ms >> 8),
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_execute_macro(std::uint16_t objectID)
@@ -743,12 +677,7 @@ namespace isobus
 			                                             0xFF,
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_change_object_label(std::uint16_t objectID, std::uint16_t labelStringObjectID, std::uint8_t fontType, std::uint16_t graphicalDesignatorObjectID)
@@ -761,12 +690,7 @@ namespace isobus
 			                                             fontType,
 			                                             static_cast<std::uint8_t>(graphicalDesignatorObjectID & 0xFF),
 			                                             static_cast<std::uint8_t>(graphicalDesignatorObjectID >> 8) };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_change_polygon_point(std::uint16_t objectID, std::uint8_t pointIndex, std::uint16_t newXValue, std::uint16_t newYValue)
@@ -779,12 +703,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(newXValue >> 8),
 			                                             static_cast<std::uint8_t>(newYValue & 0xFF),
 			                                             static_cast<std::uint8_t>(newYValue >> 8) };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_change_polygon_scale(std::uint16_t objectID, std::uint16_t widthAttribute, std::uint16_t heightAttribute)
@@ -797,12 +716,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(heightAttribute & 0xFF),
 			                                             static_cast<std::uint8_t>(heightAttribute >> 8),
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_select_colour_map_or_palette(std::uint16_t objectID)
@@ -815,12 +729,7 @@ namespace isobus
 			                                             0xFF,
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_execute_extended_macro(std::uint16_t objectID)
@@ -833,12 +742,7 @@ namespace isobus
 			                                             0xFF,
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_select_active_working_set(std::uint64_t NAMEofWorkingSetMasterForDesiredWorkingSet)
@@ -852,12 +756,7 @@ namespace isobus
 			                               static_cast<std::uint8_t>((NAMEofWorkingSetMasterForDesiredWorkingSet >> 40) & 0xFF),
 			                               static_cast<std::uint8_t>((NAMEofWorkingSetMasterForDesiredWorkingSet >> 48) & 0xFF),
 			                               static_cast<std::uint8_t>((NAMEofWorkingSetMasterForDesiredWorkingSet >> 56) & 0xFF) };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      9,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, 9);
 	}
 
 	bool VirtualTerminalClient::send_set_graphics_cursor(std::uint16_t objectID, std::int16_t xPosition, std::int16_t yPosition)
@@ -870,12 +769,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(xPosition >> 8),
 			                                             static_cast<std::uint8_t>(yPosition & 0xFF),
 			                                             static_cast<std::uint8_t>(yPosition >> 8) };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_move_graphics_cursor(std::uint16_t objectID, std::int16_t xOffset, std::int16_t yOffset)
@@ -888,12 +782,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(xOffset >> 8),
 			                                             static_cast<std::uint8_t>(yOffset & 0xFF),
 			                                             static_cast<std::uint8_t>(yOffset >> 8) };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_set_foreground_colour(std::uint16_t objectID, std::uint8_t colour)
@@ -906,12 +795,7 @@ namespace isobus
 			                                             0xFF,
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_set_background_colour(std::uint16_t objectID, std::uint8_t colour)
@@ -924,12 +808,7 @@ namespace isobus
 			                                             0xFF,
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_set_line_attributes_object_id(std::uint16_t objectID, std::uint16_t lineAttributesObjectID)
@@ -942,12 +821,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(lineAttributesObjectID >> 8),
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_set_fill_attributes_object_id(std::uint16_t objectID, std::uint16_t fillAttributesObjectID)
@@ -960,12 +834,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(fillAttributesObjectID >> 8),
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_set_font_attributes_object_id(std::uint16_t objectID, std::uint16_t fontAttributesObjectID)
@@ -978,12 +847,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(fontAttributesObjectID >> 8),
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_erase_rectangle(std::uint16_t objectID, std::uint16_t width, std::uint16_t height)
@@ -996,12 +860,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(width >> 8),
 			                                             static_cast<std::uint8_t>(height & 0xFF),
 			                                             static_cast<std::uint8_t>(height >> 8) };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_draw_point(std::uint16_t objectID, std::int16_t xOffset, std::int16_t yOffset)
@@ -1014,12 +873,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(xOffset >> 8),
 			                                             static_cast<std::uint8_t>(yOffset & 0xFF),
 			                                             static_cast<std::uint8_t>(yOffset >> 8) };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_draw_line(std::uint16_t objectID, std::int16_t xOffset, std::int16_t yOffset)
@@ -1032,12 +886,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(xOffset >> 8),
 			                                             static_cast<std::uint8_t>(yOffset & 0xFF),
 			                                             static_cast<std::uint8_t>(yOffset >> 8) };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_draw_rectangle(std::uint16_t objectID, std::uint16_t width, std::uint16_t height)
@@ -1050,12 +899,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(width >> 8),
 			                                             static_cast<std::uint8_t>(height & 0xFF),
 			                                             static_cast<std::uint8_t>(height >> 8) };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_draw_closed_ellipse(std::uint16_t objectID, std::uint16_t width, std::uint16_t height)
@@ -1068,12 +912,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(width >> 8),
 			                                             static_cast<std::uint8_t>(height & 0xFF),
 			                                             static_cast<std::uint8_t>(height >> 8) };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_draw_polygon(std::uint16_t objectID, std::uint8_t numberOfPoints, std::int16_t *listOfXOffsetsRelativeToCursor, std::int16_t *listOfYOffsetsRelativeToCursor)
@@ -1099,12 +938,7 @@ namespace isobus
 				buffer[7 + i] = static_cast<std::uint8_t>(listOfYOffsetsRelativeToCursor[0] & 0xFF);
 				buffer[8 + i] = static_cast<std::uint8_t>((listOfYOffsetsRelativeToCursor[0] >> 8) & 0xFF);
 			}
-			retVal = CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-			                                                        buffer,
-			                                                        messageLength,
-			                                                        myControlFunction.get(),
-			                                                        partnerControlFunction.get(),
-			                                                        CANIdentifier::PriorityLowest7);
+			retVal = send_command(buffer, messageLength);
 			delete[] buffer;
 		}
 		return retVal;
@@ -1126,12 +960,7 @@ namespace isobus
 			buffer[4] = static_cast<std::uint8_t>(transparent);
 			buffer[5] = textLength;
 			memcpy(buffer, value, textLength);
-			retVal = CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-			                                                        buffer,
-			                                                        messageLength,
-			                                                        myControlFunction.get(),
-			                                                        partnerControlFunction.get(),
-			                                                        CANIdentifier::PriorityLowest7);
+			retVal = send_command(buffer, messageLength);
 			delete[] buffer;
 		}
 		return retVal;
@@ -1147,12 +976,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(xAttribute >> 8),
 			                                             static_cast<std::uint8_t>(yAttribute & 0xFF),
 			                                             static_cast<std::uint8_t>(yAttribute >> 8) };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_zoom_viewport(std::uint16_t objectID, float zoom)
@@ -1172,12 +996,7 @@ namespace isobus
 			                                             floatToBytesBuffer[1],
 			                                             floatToBytesBuffer[2],
 			                                             floatToBytesBuffer[3] };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_pan_and_zoom_viewport(std::uint16_t objectID, std::int16_t xAttribute, std::int16_t yAttribute, float zoom)
@@ -1201,12 +1020,7 @@ namespace isobus
 			                                floatToBytesBuffer[1],
 			                                floatToBytesBuffer[2],
 			                                floatToBytesBuffer[3] };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      12,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, 12);
 	}
 
 	bool VirtualTerminalClient::send_change_viewport_size(std::uint16_t objectID, std::uint16_t width, std::uint16_t height)
@@ -1225,12 +1039,7 @@ namespace isobus
 				                                             static_cast<std::uint8_t>(width >> 8),
 				                                             static_cast<std::uint8_t>(height & 0xFF),
 				                                             static_cast<std::uint8_t>(height >> 8) };
-			retVal = CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-			                                                        buffer,
-			                                                        CAN_DATA_LENGTH,
-			                                                        myControlFunction.get(),
-			                                                        partnerControlFunction.get(),
-			                                                        CANIdentifier::PriorityLowest7);
+			retVal = send_command(buffer, CAN_DATA_LENGTH);
 		}
 		return retVal;
 	}
@@ -1245,12 +1054,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(objectID >> 8),
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_copy_canvas_to_picture_graphic(std::uint16_t graphicsContextObjectID, std::uint16_t objectID)
@@ -1263,12 +1067,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(objectID >> 8),
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_copy_viewport_to_picture_graphic(std::uint16_t graphicsContextObjectID, std::uint16_t objectID)
@@ -1281,12 +1080,7 @@ namespace isobus
 			                                             static_cast<std::uint8_t>(objectID >> 8),
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	bool VirtualTerminalClient::send_get_attribute_value(std::uint16_t objectID, std::uint8_t attributeID)
@@ -1299,12 +1093,7 @@ namespace isobus
 			                                             0xFF,
 			                                             0xFF,
 			                                             0xFF };
-		return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
-		                                                      buffer,
-		                                                      CAN_DATA_LENGTH,
-		                                                      myControlFunction.get(),
-		                                                      partnerControlFunction.get(),
-		                                                      CANIdentifier::PriorityLowest7);
+		return send_command(buffer, CAN_DATA_LENGTH);
 	}
 
 	std::uint8_t VirtualTerminalClient::get_softkey_x_axis_pixels() const
@@ -1491,10 +1280,13 @@ namespace isobus
 			tempData.objectPoolSize = size;
 			tempData.autoScaleDataMaskOriginalDimension = 0;
 			tempData.autoScaleSoftKeyDesignatorOriginalHeight = 0;
+			tempData.poolHash = 0;
+			tempData.poolHashValid = false;
 			tempData.version = poolSupportedVTVersion;
 			tempData.useDataCallback = false;
 			tempData.uploaded = false;
 			tempData.versionLabel = version;
+			tempData.objectIndex.build(pool, size);
 
 			if (poolIndex < objectPools.size())
 			{
@@ -1505,6 +1297,7 @@ namespace isobus
 				objectPools.resize(poolIndex + 1);
 				objectPools[poolIndex] = tempData;
 			}
+			shadowState.clear();
 		}
 	}
 
@@ -1521,10 +1314,13 @@ namespace isobus
 			tempData.objectPoolSize = pool->size();
 			tempData.autoScaleDataMaskOriginalDimension = 0;
 			tempData.autoScaleSoftKeyDesignatorOriginalHeight = 0;
+			tempData.poolHash = 0;
+			tempData.poolHashValid = false;
 			tempData.version = poolSupportedVTVersion;
 			tempData.useDataCallback = false;
 			tempData.uploaded = false;
 			tempData.versionLabel = version;
+			tempData.objectIndex.build(pool->data(), static_cast<std::uint32_t>(pool->size()));
 
 			if (poolIndex < objectPools.size())
 			{
@@ -1535,7 +1331,27 @@ namespace isobus
 				objectPools.resize(poolIndex + 1);
 				objectPools[poolIndex] = tempData;
 			}
+			shadowState.clear();
+		}
+	}
+
+	bool VirtualTerminalClient::set_object_pool(std::uint8_t poolIndex, VTVersion poolSupportedVTVersion, std::shared_ptr<TransmitDataSource> pool, std::string version)
+	{
+		bool retVal = false;
+
+		if ((nullptr != pool) &&
+		    (nullptr != pool->get_data()) &&
+		    (0 != pool->get_size()))
+		{
+			set_object_pool(poolIndex, poolSupportedVTVersion, pool->get_data(), pool->get_size(), version);
+			objectPools[poolIndex].objectPoolSource = pool;
+			retVal = true;
+		}
+		else
+		{
+			CANStackLogger::error("[VT]: Object pool sources must be valid and contiguous in memory");
 		}
+		return retVal;
 	}
 
 	void VirtualTerminalClient::set_object_pool_scaling(std::uint8_t poolIndex,
@@ -1559,6 +1375,10 @@ namespace isobus
 			tempData.objectPoolVectorPointer = nullptr;
 			tempData.dataCallback = value;
 			tempData.objectPoolSize = poolTotalSize;
+			tempData.autoScaleDataMaskOriginalDimension = 0;
+			tempData.autoScaleSoftKeyDesignatorOriginalHeight = 0;
+			tempData.poolHash = 0;
+			tempData.poolHashValid = false;
 			tempData.version = poolSupportedVTVersion;
 			tempData.useDataCallback = true;
 			tempData.uploaded = false;
@@ -1572,7 +1392,135 @@ namespace isobus
 				objectPools.resize(poolIndex + 1);
 				objectPools[poolIndex] = tempData;
 			}
+			shadowState.clear();
+		}
+	}
+
+	const VirtualTerminalObjectPoolIndex *VirtualTerminalClient::get_object_pool_index(std::uint8_t poolIndex) const
+	{
+		const VirtualTerminalObjectPoolIndex *retVal = nullptr;
+
+		if ((poolIndex < objectPools.size()) &&
+		    (objectPools[poolIndex].objectIndex.get_is_valid()))
+		{
+			retVal = &objectPools[poolIndex].objectIndex;
+		}
+		return retVal;
+	}
+
+	void VirtualTerminalClient::set_scaled_object_pool_cache(std::shared_ptr<VirtualTerminalScaledPoolCache> cache)
+	{
+		scaledPoolCache = cache;
+	}
+
+	std::shared_ptr<VirtualTerminalScaledPoolCache> VirtualTerminalClient::get_scaled_object_pool_cache() const
+	{
+		return scaledPoolCache;
+	}
+
+	void VirtualTerminalClient::set_command_coalescing(bool enabled, std::uint32_t flushInterval_ms, bool flushOnVTResponse)
+	{
+		commandCoalescingInterval_ms = flushInterval_ms;
+		flushCoalescedCommandsOnResponse = flushOnVTResponse;
+		commandCoalescingEnabled = enabled;
+	}
+
+	bool VirtualTerminalClient::get_command_coalescing_enabled() const
+	{
+		return commandCoalescingEnabled;
+	}
+
+	std::size_t VirtualTerminalClient::get_number_queued_commands() const
+	{
+		return commandCoalescer.get_number_pending();
+	}
+
+	std::uint32_t VirtualTerminalClient::get_number_coalesced_commands() const
+	{
+		return commandCoalescer.get_number_coalesced();
+	}
+
+	void VirtualTerminalClient::set_shadow_state_enabled(bool enabled)
+	{
+		shadowStateEnabled = enabled;
+	}
+
+	bool VirtualTerminalClient::get_shadow_state_enabled() const
+	{
+		return shadowStateEnabled;
+	}
+
+	void VirtualTerminalClient::invalidate_shadow_state()
+	{
+		shadowState.clear();
+	}
+
+	void VirtualTerminalClient::invalidate_shadow_state(std::uint16_t objectID)
+	{
+		shadowState.invalidate(objectID);
+	}
+
+	void VirtualTerminalClient::set_shadow_state_response_timeout(std::uint32_t value_ms)
+	{
+		shadowState.set_response_timeout(value_ms);
+	}
+
+	const VirtualTerminalShadowState &VirtualTerminalClient::get_shadow_state() const
+	{
+		return shadowState;
+	}
+
+	std::uint32_t VirtualTerminalClient::get_number_suppressed_commands() const
+	{
+		return numberSuppressedCommands;
+	}
+
+	void VirtualTerminalClient::set_object_pool_manifest_file(const std::string &filename)
+	{
+		objectPoolManifestFilename = filename;
+	}
+
+	std::string VirtualTerminalClient::get_object_pool_manifest_file() const
+	{
+		return objectPoolManifestFilename;
+	}
+
+	bool VirtualTerminalClient::get_last_upload_was_partial() const
+	{
+		return lastUploadWasPartial;
+	}
+
+	void VirtualTerminalClient::set_command_pipeline_enabled(bool enabled)
+	{
+		commandPipelineEnabled = enabled;
+	}
+
+	bool VirtualTerminalClient::get_command_pipeline_enabled() const
+	{
+		return commandPipelineEnabled;
+	}
+
+	VirtualTerminalCommandPipeline &VirtualTerminalClient::get_command_pipeline()
+	{
+		return commandPipeline;
+	}
+
+	bool VirtualTerminalClient::send_command_with_completion(const std::function<bool()> &sendFunction,
+	                                                         VirtualTerminalCommandPipeline::Priority priority,
+	                                                         VirtualTerminalCommandPipeline::CompletionCallback callback)
+	{
+		bool retVal = false;
+
+		if (nullptr != sendFunction)
+		{
+			VTCommandCompletionOptions options = { this, priority, callback };
+			VTCommandCompletionOptions *previousOptions = currentCompletionOptions;
+
+			currentCompletionOptions = &options;
+			retVal = sendFunction();
+			currentCompletionOptions = previousOptions;
 		}
+		return retVal;
 	}
 
 	void VirtualTerminalClient::update()
@@ -1586,6 +1534,7 @@ namespace isobus
 				case StateMachineState::Disconnected:
 				{
 					sendWorkingSetMaintenenace = false;
+					commandCoalescer.clear_awaiting_response();
 
 					if (partnerControlFunction->get_address_valid())
 					{
@@ -1727,6 +1676,7 @@ namespace isobus
 					         (!objectPools[0].versionLabel.empty()) &&
 					         (send_get_versions()))
 					{
+						load_object_pool_manifest();
 						set_state(StateMachineState::WaitForGetVersionsResponse);
 					}
 				}
@@ -1763,9 +1713,12 @@ namespace isobus
 						tempVersionBuffer[5] = ' ';
 						tempVersionBuffer[6] = ' ';
 
-						for (std::size_t i = 0; ((i < VERSION_LABEL_LENGTH) && (i < objectPools[0].versionLabel.size())); i++)
+						// A partial upload starts from the version of the previous pool
+						const std::string &versionLabel = partialUploadInProgress ? partialUploadBaseLabel : objectPools[0].versionLabel;
+
+						for (std::size_t i = 0; ((i < VERSION_LABEL_LENGTH) && (i < versionLabel.size())); i++)
 						{
-							tempVersionBuffer[i] = objectPools[0].versionLabel[i];
+							tempVersionBuffer[i] = versionLabel[i];
 						}
 
 						if (send_load_version(tempVersionBuffer))
@@ -1844,11 +1797,19 @@ namespace isobus
 								set_state(StateMachineState::Failed);
 							}
 						}
+
+						std::uint32_t numberChangedObjects = 0;
+						if ((!objectPoolManifestFilename.empty()) &&
+						    (!prepare_object_pool_manifest(numberChangedObjects)))
+						{
+							CANStackLogger::warn("[VT]: Unable to index the object pool, so the next upload can't be partial");
+						}
 					}
 
 					for (std::uint32_t i = 0; i < objectPools.size(); i++)
 					{
 						if (((nullptr != objectPools[i].objectPoolDataPointer) ||
+						     (nullptr != objectPools[i].objectPoolVectorPointer) ||
 						     (nullptr != objectPools[i].dataCallback)) &&
 						    (objectPools[i].objectPoolSize > 0))
 						{
@@ -1912,6 +1873,72 @@ namespace isobus
 				}
 				break;
 
+				case StateMachineState::UploadChangedObjects:
+				{
+					if (firstTimeInState)
+					{
+						std::uint32_t numberChangedObjects = 0;
+
+						if ((get_any_pool_needs_scaling()) &&
+						    (!scale_object_pools()))
+						{
+							set_state(StateMachineState::Failed);
+						}
+						else if (prepare_object_pool_manifest(numberChangedObjects))
+						{
+							CANStackLogger::info("[VT]: Uploading " + isobus::to_string(numberChangedObjects) + " changed objects (" + isobus::to_string(partialObjectPoolData.size()) + " bytes)");
+						}
+						else
+						{
+							CANStackLogger::warn("[VT]: Unable to find the changed objects in the object pool");
+							fall_back_to_full_object_pool_upload();
+						}
+					}
+
+					if (StateMachineState::UploadChangedObjects == state)
+					{
+						if (CurrentObjectPoolUploadState::Uninitialized == currentObjectPoolState)
+						{
+							if (partialObjectPoolData.empty())
+							{
+								// Nothing changed that the VT needs to know about
+								for (auto &objectPool : objectPools)
+								{
+									objectPool.uploaded = true;
+								}
+								set_state(StateMachineState::SendEndOfObjectPool);
+							}
+							else if (CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
+							                                                          nullptr,
+							                                                          static_cast<std::uint32_t>(partialObjectPoolData.size()) + 1, // Account for Mux byte
+							                                                          myControlFunction.get(),
+							                                                          partnerControlFunction.get(),
+							                                                          CANIdentifier::CANPriority::PriorityLowest7,
+							                                                          process_callback,
+							                                                          this,
+							                                                          process_internal_changed_objects_upload_callback))
+							{
+								currentObjectPoolState = CurrentObjectPoolUploadState::InProgress;
+							}
+						}
+						else if (CurrentObjectPoolUploadState::Success == currentObjectPoolState)
+						{
+							currentObjectPoolState = CurrentObjectPoolUploadState::Uninitialized;
+							for (auto &objectPool : objectPools)
+							{
+								objectPool.uploaded = true;
+							}
+							set_state(StateMachineState::SendEndOfObjectPool);
+						}
+						else if (CurrentObjectPoolUploadState::Failed == currentObjectPoolState)
+						{
+							CANStackLogger::warn("[VT]: The changed objects failed to upload");
+							fall_back_to_full_object_pool_upload();
+						}
+					}
+				}
+				break;
+
 				case StateMachineState::SendEndOfObjectPool:
 				{
 					if (send_end_of_object_pool())
@@ -1967,6 +1994,12 @@ namespace isobus
 			set_state(StateMachineState::Disconnected);
 		}
 
+		if (StateMachineState::Connected == state)
+		{
+			update_coalesced_commands();
+			update_command_pipeline();
+		}
+
 		if ((sendWorkingSetMaintenenace) &&
 		    (SystemTiming::time_expired_ms(lastWorkingSetMaintenanceTimestamp_ms, WORKING_SET_MAINTENANCE_TIMEOUT_MS)))
 		{
@@ -1980,6 +2013,50 @@ namespace isobus
 		}
 	}
 
+	std::uint32_t VirtualTerminalClient::get_time_until_next_update_ms() const
+	{
+		std::uint32_t retVal = POLLING_UPDATE_INTERVAL_MS;
+
+		if (firstTimeInState)
+		{
+			// The state just changed, so the new state should run right away
+			retVal = 0;
+		}
+		else if (StateMachineState::Connected == state)
+		{
+			auto get_time_remaining_ms = [](std::uint32_t timestamp_ms, std::uint32_t timeout_ms) {
+				const std::uint32_t elapsedTime_ms = SystemTiming::get_time_elapsed_ms(timestamp_ms);
+				return (elapsedTime_ms < timeout_ms) ? (timeout_ms - elapsedTime_ms) : 0;
+			};
+
+			retVal = std::min(get_time_remaining_ms(lastWorkingSetMaintenanceTimestamp_ms, WORKING_SET_MAINTENANCE_TIMEOUT_MS),
+			                  get_time_remaining_ms(lastVTStatusTimestamp_ms, VT_STATUS_TIMEOUT_MS));
+
+			if (0 != commandCoalescer.get_number_pending())
+			{
+				retVal = std::min(retVal, get_time_remaining_ms(lastCoalescedCommandFlushTimestamp_ms, commandCoalescingInterval_ms));
+			}
+
+			const VirtualTerminalCommandPipeline::Statistics pipelineStatistics = commandPipeline.get_statistics();
+			if ((0 != pipelineStatistics.numberQueued) ||
+			    (0 != pipelineStatistics.numberInFlight))
+			{
+				// Responses wake the client, but commands can also time out or need to be sent again
+				if (retVal > POLLING_UPDATE_INTERVAL_MS)
+				{
+					retVal = POLLING_UPDATE_INTERVAL_MS;
+				}
+			}
+
+			if (0 == retVal)
+			{
+				// Something was already due during the last update, so it couldn't be sent. Try again later rather than spinning.
+				retVal = POLLING_UPDATE_INTERVAL_MS;
+			}
+		}
+		return retVal;
+	}
+
 	bool VirtualTerminalClient::send_delete_object_pool()
 	{
 		constexpr std::uint8_t buffer[CAN_DATA_LENGTH] = { static_cast<std::uint8_t>(Function::DeleteObjectPoolCommand),
@@ -2399,11 +2476,23 @@ namespace isobus
 		                                                      CANIdentifier::PriorityLowest7);
 	}
 
+	void VirtualTerminalClient::update_snapshot_version_label(bool stored)
+	{
+		const std::shared_ptr<NetworkSnapshot> snapshot = CANNetworkManager::CANNetwork.get_network_snapshot();
+
+		if ((nullptr != snapshot) &&
+		    (!objectPools.empty()))
+		{
+			snapshot->set_vt_version_label(partnerControlFunction->get_NAME(), stored ? objectPools[0].versionLabel : std::string());
+		}
+	}
+
 	void VirtualTerminalClient::set_state(StateMachineState value)
 	{
+		const bool stateChanged = (value != state);
 		stateMachineTimestamp_ms = SystemTiming::get_timestamp_ms();
 
-		if (value != state)
+		if (stateChanged)
 		{
 			firstTimeInState = true;
 		}
@@ -2417,6 +2506,22 @@ namespace isobus
 			{
 				objectPools[i].uploaded = false;
 			}
+			shadowState.clear();
+			commandPipeline.abort_all();
+			partialUploadInProgress = false;
+		}
+		else if ((StateMachineState::Connected == value) &&
+		         (stateChanged))
+		{
+			// The VT has just loaded our pools, so it's showing their initial values
+			shadowState.clear();
+			for (const auto &pool : objectPools)
+			{
+				if (pool.objectIndex.get_is_valid())
+				{
+					shadowState.seed(pool.objectIndex);
+				}
+			}
 		}
 	}
 
@@ -2646,6 +2751,8 @@ namespace isobus
 
 				case static_cast<std::uint32_t>(CANLibParameterGroupNumber::VirtualTerminalToECU):
 				{
+					parentVT->commandPipeline.process_response(message->get_data().data(), message->get_data_length());
+
 					switch (message->get_uint8_at(0))
 					{
 						case static_cast<std::uint8_t>(Function::SoftKeyActivationMessage):
@@ -2760,6 +2867,7 @@ namespace isobus
 							{
 								//! @todo process TAN
 							}
+							parentVT->shadowState.process_vt_numeric_value_change(objectID, value);
 							parentVT->process_change_numeric_value_callback(objectID, value, parentVT);
 						}
 						break;
@@ -2813,6 +2921,7 @@ namespace isobus
 							std::uint8_t stringLength = message->get_uint8_at(3);
 							std::string value = std::string(message->get_data().begin() + 4, message->get_data().begin() + 4 + stringLength);
 
+							parentVT->shadowState.process_vt_string_value_change(objectID, value);
 							parentVT->process_change_string_value_callback(objectID, value, parentVT);
 						}
 						break;
@@ -3050,6 +3159,15 @@ namespace isobus
 						}
 						break;
 
+						case static_cast<std::uint8_t>(Function::ChangeNumericValueCommand):
+						case static_cast<std::uint8_t>(Function::ChangeAttributeCommand):
+						case static_cast<std::uint8_t>(Function::ChangeStringValueCommand):
+						{
+							parentVT->commandCoalescer.process_response(message->get_data().data(), message->get_data_length());
+							parentVT->shadowState.process_response(message->get_data().data(), message->get_data_length());
+						}
+						break;
+
 						case static_cast<std::uint8_t>(Function::VTStatusMessage):
 						{
 							parentVT->lastVTStatusTimestamp_ms = SystemTiming::get_timestamp_ms();
@@ -3124,7 +3242,19 @@ namespace isobus
 								if ((!parentVT->objectPools.empty()) &&
 								    (!parentVT->objectPools[0].versionLabel.empty()))
 								{
-									parentVT->set_state(StateMachineState::SendGetVersions);
+									const std::shared_ptr<NetworkSnapshot> snapshot = CANNetworkManager::CANNetwork.get_network_snapshot();
+
+									// If this VT had our label stored last time, try loading it straight away. A failed load still falls back to an upload.
+									if ((nullptr != snapshot) &&
+									    (parentVT->objectPools[0].versionLabel == snapshot->get_vt_version_label(parentVT->partnerControlFunction->get_NAME())))
+									{
+										CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Info, "[VT]: The network snapshot says the VT has our version label stored, skipping get versions.");
+										parentVT->set_state(StateMachineState::SendLoadVersion);
+									}
+									else
+									{
+										parentVT->set_state(StateMachineState::SendGetVersions);
+									}
 								}
 								else
 								{
@@ -3182,6 +3312,11 @@ namespace isobus
 												CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Info, "[VT]: VT Server has a matching label for " + isobus::to_string(labelDecoded) + ". It will be loaded and upload will be skipped.");
 												break;
 											}
+											else if (parentVT->get_is_partial_upload_base(labelDecoded))
+											{
+												// Keep the previous version of our pool, so only the objects that changed need uploading
+												parentVT->partialUploadBaseLabel = labelDecoded;
+											}
 											else
 											{
 												CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Info, "[VT]: VT Server has a label for " + isobus::to_string(labelDecoded) + ". This version will be deleted.");
@@ -3200,7 +3335,14 @@ namespace isobus
 												}
 											}
 										}
-										if (!labelMatched)
+										if ((!labelMatched) &&
+										    (!parentVT->partialUploadBaseLabel.empty()))
+										{
+											CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Info, "[VT]: VT Server has the previous version " + isobus::to_string(parentVT->partialUploadBaseLabel) + " of the pool. It will be loaded and only the changed objects will be uploaded.");
+											parentVT->partialUploadInProgress = true;
+											parentVT->set_state(StateMachineState::SendLoadVersion);
+										}
+										else if (!labelMatched)
 										{
 											CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Info, "[VT]: No version label from the VT matched. Client will upload the pool and store it instead.");
 											parentVT->set_state(StateMachineState::UploadObjectPool);
@@ -3228,10 +3370,17 @@ namespace isobus
 						{
 							if (StateMachineState::WaitForLoadVersionResponse == parentVT->state)
 							{
-								if (0 == message->get_uint8_at(5))
+								if ((0 == message->get_uint8_at(5)) &&
+								    (parentVT->partialUploadInProgress))
+								{
+									CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Info, "[VT]: Loaded the previous object pool version from VT non-volatile memory with no errors.");
+									parentVT->set_state(StateMachineState::UploadChangedObjects);
+								}
+								else if (0 == message->get_uint8_at(5))
 								{
 									CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Info, "[VT]: Loaded object pool version from VT non-volatile memory with no errors.");
 									parentVT->set_state(StateMachineState::Connected);
+									parentVT->update_snapshot_version_label(true);
 									if (parentVT->send_aux_n_preferred_assignment())
 									{
 										CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Debug, "[AUX-N]: Sent preferred assignments.");
@@ -3259,7 +3408,9 @@ namespace isobus
 
 									// Not sure what happened here... should be mostly impossible. Try to upload instead.
 									CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[VT]: Switching to pool upload instead.");
+									parentVT->partialUploadInProgress = false;
 									parentVT->set_state(StateMachineState::UploadObjectPool);
+									parentVT->update_snapshot_version_label(false);
 								}
 							}
 							else
@@ -3277,7 +3428,9 @@ namespace isobus
 								{
 									// Stored with no error
 									parentVT->set_state(StateMachineState::Connected);
+									parentVT->update_snapshot_version_label(true);
 									CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Info, "[VT]: Stored object pool with no error.");
+									parentVT->save_object_pool_manifest();
 								}
 								else
 								{
@@ -3337,10 +3490,14 @@ namespace isobus
 								if ((!anyErrorInPool) &&
 								    (0 == objectPoolErrorBitmask))
 								{
+									parentVT->lastUploadWasPartial = parentVT->partialUploadInProgress;
+									parentVT->partialUploadInProgress = false;
+									parentVT->partialObjectPoolData.clear();
+
 									// Clear scaling buffers
 									for (auto &objectPool : parentVT->objectPools)
 									{
-										objectPool.scaledObjectPool.clear();
+										objectPool.scaledObjectPool.reset();
 									}
 
 									// Check if we need to store this pool
@@ -3362,6 +3519,11 @@ namespace isobus
 										CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[AUX-N]: Failed to send preferred assignments.");
 									}
 								}
+								else if (parentVT->partialUploadInProgress)
+								{
+									CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[VT]: The VT rejected the changed objects, faulty object " + isobus::to_string(static_cast<int>(objectIDOfFaultyObject)) + ". Uploading the whole object pool instead.");
+									parentVT->fall_back_to_full_object_pool_upload();
+								}
 								else
 								{
 									parentVT->set_state(StateMachineState::Failed);
@@ -3421,6 +3583,7 @@ namespace isobus
 				}
 				break;
 			}
+			parentVT->wake_executor();
 		}
 		else
 		{
@@ -3441,7 +3604,8 @@ namespace isobus
 		{
 			VirtualTerminalClient *parent = reinterpret_cast<VirtualTerminalClient *>(parentPointer);
 
-			if (StateMachineState::UploadObjectPool == parent->state)
+			if ((StateMachineState::UploadObjectPool == parent->state) ||
+			    (StateMachineState::UploadChangedObjects == parent->state))
 			{
 				if (successful)
 				{
@@ -3452,6 +3616,7 @@ namespace isobus
 					parent->currentObjectPoolState = CurrentObjectPoolUploadState::Failed;
 				}
 			}
+			parent->wake_executor();
 		}
 	}
 
@@ -3487,19 +3652,21 @@ namespace isobus
 			    (bytesOffset + numberOfBytesNeeded) <= parentVTClient->objectPools[poolIndex].objectPoolSize + 1)
 			{
 				// We've got more data to transfer
-				if ((0 != parentVTClient->objectPools[poolIndex].autoScaleDataMaskOriginalDimension) && (0 != parentVTClient->objectPools[poolIndex].autoScaleSoftKeyDesignatorOriginalHeight))
+				if ((0 != parentVTClient->objectPools[poolIndex].autoScaleDataMaskOriginalDimension) &&
+				    (0 != parentVTClient->objectPools[poolIndex].autoScaleSoftKeyDesignatorOriginalHeight) &&
+				    (nullptr != parentVTClient->objectPools[poolIndex].scaledObjectPool))
 				{
 					// Object pool has been pre-scaled. Use the scaling buffer instead
 					retVal = true;
 					if (0 == bytesOffset)
 					{
 						chunkBuffer[0] = static_cast<std::uint8_t>(Function::ObjectPoolTransferMessage);
-						memcpy(&chunkBuffer[1], &parentVTClient->objectPools[poolIndex].scaledObjectPool[bytesOffset], numberOfBytesNeeded - 1);
+						memcpy(&chunkBuffer[1], &parentVTClient->objectPools[poolIndex].scaledObjectPool->data()[bytesOffset], numberOfBytesNeeded - 1);
 					}
 					else
 					{
 						// Subtract off 1 to account for the mux in the first byte of the message
-						memcpy(chunkBuffer, &parentVTClient->objectPools[poolIndex].scaledObjectPool[bytesOffset - 1], numberOfBytesNeeded);
+						memcpy(chunkBuffer, &parentVTClient->objectPools[poolIndex].scaledObjectPool->data()[bytesOffset - 1], numberOfBytesNeeded);
 					}
 				}
 				else
@@ -3521,16 +3688,27 @@ namespace isobus
 					else
 					{
 						// We already have the whole pool in RAM
-						retVal = true;
-						if (0 == bytesOffset)
+						const std::uint8_t *poolData = parentVTClient->objectPools[poolIndex].objectPoolDataPointer;
+
+						if ((nullptr == poolData) &&
+						    (nullptr != parentVTClient->objectPools[poolIndex].objectPoolVectorPointer))
 						{
-							chunkBuffer[0] = static_cast<std::uint8_t>(Function::ObjectPoolTransferMessage);
-							memcpy(&chunkBuffer[1], &parentVTClient->objectPools[poolIndex].objectPoolDataPointer[bytesOffset], numberOfBytesNeeded - 1);
+							poolData = parentVTClient->objectPools[poolIndex].objectPoolVectorPointer->data();
 						}
-						else
+
+						if (nullptr != poolData)
 						{
-							// Subtract off 1 to account for the mux in the first byte of the message
-							memcpy(chunkBuffer, &parentVTClient->objectPools[poolIndex].objectPoolDataPointer[bytesOffset - 1], numberOfBytesNeeded);
+							retVal = true;
+							if (0 == bytesOffset)
+							{
+								chunkBuffer[0] = static_cast<std::uint8_t>(Function::ObjectPoolTransferMessage);
+								memcpy(&chunkBuffer[1], &poolData[bytesOffset], numberOfBytesNeeded - 1);
+							}
+							else
+							{
+								// Subtract off 1 to account for the mux in the first byte of the message
+								memcpy(chunkBuffer, &poolData[bytesOffset - 1], numberOfBytesNeeded);
+							}
 						}
 					}
 				}
@@ -3539,14 +3717,182 @@ namespace isobus
 		return retVal;
 	}
 
-	bool VirtualTerminalClient::get_any_pool_needs_scaling() const
+	bool VirtualTerminalClient::process_internal_changed_objects_upload_callback(std::uint32_t,
+	                                                                             std::uint32_t bytesOffset,
+	                                                                             std::uint32_t numberOfBytesNeeded,
+	                                                                             std::uint8_t *chunkBuffer,
+	                                                                             void *parentPointer)
 	{
 		bool retVal = false;
 
-		for (auto &objectPool : objectPools)
+		if ((nullptr != parentPointer) &&
+		    (nullptr != chunkBuffer) &&
+		    (0 != numberOfBytesNeeded))
 		{
-			if ((0 != objectPool.autoScaleDataMaskOriginalDimension) &&
-			    (0 != objectPool.autoScaleSoftKeyDesignatorOriginalHeight))
+			const VirtualTerminalClient *parentVTClient = reinterpret_cast<VirtualTerminalClient *>(parentPointer);
+			const std::vector<std::uint8_t> &changedObjects = parentVTClient->partialObjectPoolData;
+
+			if ((bytesOffset + numberOfBytesNeeded) <= (changedObjects.size() + 1))
+			{
+				retVal = true;
+				if (0 == bytesOffset)
+				{
+					chunkBuffer[0] = static_cast<std::uint8_t>(Function::ObjectPoolTransferMessage);
+					memcpy(&chunkBuffer[1], changedObjects.data(), numberOfBytesNeeded - 1);
+				}
+				else
+				{
+					// Subtract off 1 to account for the mux in the first byte of the message
+					memcpy(chunkBuffer, &changedObjects[bytesOffset - 1], numberOfBytesNeeded);
+				}
+			}
+		}
+		return retVal;
+	}
+
+	void VirtualTerminalClient::load_object_pool_manifest()
+	{
+		previousManifest.clear();
+		partialUploadBaseLabel.clear();
+		partialUploadInProgress = false;
+
+		if ((!objectPoolManifestFilename.empty()) &&
+		    (!previousManifest.load(objectPoolManifestFilename)))
+		{
+			CANStackLogger::debug("[VT]: No valid object pool manifest was found, so the pool can't be uploaded partially");
+		}
+	}
+
+	bool VirtualTerminalClient::get_is_partial_upload_base(const std::string &label) const
+	{
+		constexpr std::size_t VERSION_LABEL_LENGTH = 7;
+		std::string manifestLabel = previousManifest.get_version_label();
+		bool retVal = false;
+
+		if ((!manifestLabel.empty()) &&
+		    (0 != previousManifest.get_number_objects()))
+		{
+			// Labels on the VT are padded with spaces
+			manifestLabel.resize(VERSION_LABEL_LENGTH, ' ');
+			retVal = (manifestLabel == label);
+		}
+		return retVal;
+	}
+
+	bool VirtualTerminalClient::prepare_object_pool_manifest(std::uint32_t &numberChangedObjects)
+	{
+		bool retVal = true;
+
+		uploadManifest.clear();
+		partialObjectPoolData.clear();
+		numberChangedObjects = 0;
+
+		for (auto &objectPool : objectPools)
+		{
+			const std::uint8_t *poolData = nullptr;
+			std::vector<std::uint8_t> fetchedData;
+			std::uint32_t numberPoolChangedObjects = 0;
+
+			// Hash what actually gets uploaded, which is the scaled copy if the pool was scaled
+			if (nullptr != objectPool.scaledObjectPool)
+			{
+				poolData = objectPool.scaledObjectPool->data();
+			}
+			else if (nullptr != objectPool.objectPoolDataPointer)
+			{
+				poolData = objectPool.objectPoolDataPointer;
+			}
+			else if (nullptr != objectPool.objectPoolVectorPointer)
+			{
+				poolData = objectPool.objectPoolVectorPointer->data();
+				objectPool.objectPoolSize = static_cast<std::uint32_t>(objectPool.objectPoolVectorPointer->size());
+			}
+			else if ((objectPool.useDataCallback) &&
+			         (read_object_pool_from_callback(objectPool, fetchedData)))
+			{
+				poolData = fetchedData.data();
+			}
+
+			if ((nullptr == poolData) ||
+			    (!uploadManifest.add_object_pool(poolData, objectPool.objectPoolSize)) ||
+			    ((partialUploadInProgress) &&
+			     (!previousManifest.get_changed_objects(poolData, objectPool.objectPoolSize, partialObjectPoolData, numberPoolChangedObjects))))
+			{
+				retVal = false;
+				break;
+			}
+			numberChangedObjects += numberPoolChangedObjects;
+		}
+
+		if (!retVal)
+		{
+			uploadManifest.clear();
+			partialObjectPoolData.clear();
+			numberChangedObjects = 0;
+		}
+		return retVal;
+	}
+
+	void VirtualTerminalClient::save_object_pool_manifest()
+	{
+		if ((!objectPoolManifestFilename.empty()) &&
+		    (0 != uploadManifest.get_number_objects()) &&
+		    (!objectPools.empty()))
+		{
+			uploadManifest.set_version_label(objectPools[0].versionLabel);
+
+			if (!uploadManifest.save(objectPoolManifestFilename))
+			{
+				CANStackLogger::warn("[VT]: Unable to write the object pool manifest file " + objectPoolManifestFilename);
+			}
+			uploadManifest.clear();
+		}
+
+		if (!partialUploadBaseLabel.empty())
+		{
+			// The new version replaces the one the partial upload started from
+			std::array<std::uint8_t, 7> deleteBuffer;
+
+			for (std::size_t i = 0; i < deleteBuffer.size(); i++)
+			{
+				deleteBuffer[i] = (i < partialUploadBaseLabel.size()) ? static_cast<std::uint8_t>(partialUploadBaseLabel[i]) : ' ';
+			}
+
+			if (!send_delete_version(deleteBuffer))
+			{
+				CANStackLogger::warn("[VT]: Failed to send the delete version message for label " + partialUploadBaseLabel);
+			}
+			partialUploadBaseLabel.clear();
+		}
+	}
+
+	void VirtualTerminalClient::fall_back_to_full_object_pool_upload()
+	{
+		partialUploadInProgress = false;
+		partialObjectPoolData.clear();
+		currentObjectPoolState = CurrentObjectPoolUploadState::Uninitialized;
+
+		// The VT may have some of the changed objects, so start over from an empty pool
+		if (!send_delete_object_pool())
+		{
+			CANStackLogger::warn("[VT]: Failed to send the delete object pool message");
+		}
+
+		for (auto &objectPool : objectPools)
+		{
+			objectPool.uploaded = false;
+		}
+		set_state(StateMachineState::UploadObjectPool);
+	}
+
+	bool VirtualTerminalClient::get_any_pool_needs_scaling() const
+	{
+		bool retVal = false;
+
+		for (auto &objectPool : objectPools)
+		{
+			if ((0 != objectPool.autoScaleDataMaskOriginalDimension) &&
+			    (0 != objectPool.autoScaleSoftKeyDesignatorOriginalHeight))
 			{
 				retVal = true;
 				break;
@@ -3557,29 +3903,88 @@ namespace isobus
 
 	bool VirtualTerminalClient::scale_object_pools()
 	{
+		/// @brief A pool that wasn't in the cache, and needs to be scaled
+		struct ScalingJob
+		{
+			ObjectPoolDataStruct *objectPool; ///< The pool being scaled
+			VirtualTerminalScaledPoolCache::Key key; ///< The pool's key in the cache
+			std::vector<std::uint8_t> poolData; ///< A copy of the pool which is scaled in place
+			VirtualTerminalObjectPoolIndex localIndex; ///< An index of poolData, for pools that the client hasn't indexed
+			bool success; ///< Tells if every object was scaled
+		};
 		bool retVal = true;
+		std::vector<ScalingJob> jobs;
+
+		jobs.reserve(objectPools.size());
 
 		for (auto &objectPool : objectPools)
 		{
-			// Step 1: Make a read/write copy of the pool
+			if ((0 == objectPool.autoScaleDataMaskOriginalDimension) ||
+			    (0 == objectPool.autoScaleSoftKeyDesignatorOriginalHeight))
+			{
+				// This pool gets uploaded as-is
+				continue;
+			}
+
+			const std::uint8_t *sourceData = nullptr;
+			std::vector<std::uint8_t> fetchedData;
+
+			// Step 1: Find the original pool, reading it in large chunks if it comes from a callback
 			if (nullptr != objectPool.objectPoolDataPointer)
 			{
-				objectPool.scaledObjectPool.resize(objectPool.objectPoolSize);
-				memcpy(&objectPool.scaledObjectPool[0], objectPool.objectPoolDataPointer, objectPool.objectPoolSize);
+				sourceData = objectPool.objectPoolDataPointer;
 			}
 			else if (nullptr != objectPool.objectPoolVectorPointer)
 			{
-				objectPool.scaledObjectPool.resize(objectPool.objectPoolVectorPointer->size());
-				std::copy(objectPool.objectPoolVectorPointer->begin(), objectPool.objectPoolVectorPointer->end(), objectPool.scaledObjectPool.begin());
+				sourceData = objectPool.objectPoolVectorPointer->data();
+				objectPool.objectPoolSize = static_cast<std::uint32_t>(objectPool.objectPoolVectorPointer->size());
 			}
-			else if (objectPool.useDataCallback)
+			else if ((objectPool.useDataCallback) &&
+			         (!objectPool.poolHashValid))
 			{
-				objectPool.scaledObjectPool.resize(objectPool.objectPoolSize);
+				retVal = read_object_pool_from_callback(objectPool, fetchedData);
+				sourceData = fetchedData.data();
+			}
 
-				for (std::uint32_t i = 0; i < objectPool.objectPoolSize; i++)
-				{
-					retVal &= objectPool.dataCallback(i, i, 1, &objectPool.scaledObjectPool[i], this);
-				}
+			if (!retVal)
+			{
+				break;
+			}
+
+			// Step 2: Reuse a previously scaled pool if this VT has the same geometry as one we've seen before
+			if ((!objectPool.poolHashValid) && (nullptr != sourceData))
+			{
+				objectPool.poolHash = VirtualTerminalScaledPoolCache::hash_pool(sourceData, objectPool.objectPoolSize);
+				objectPool.poolHashValid = true;
+			}
+
+			ScalingJob job;
+			job.objectPool = &objectPool;
+			job.key.poolHash = objectPool.poolHash;
+			job.key.poolSize = objectPool.objectPoolSize;
+			job.key.originalDataMaskDimension = objectPool.autoScaleDataMaskOriginalDimension;
+			job.key.originalSoftKeyDesignatorHeight = objectPool.autoScaleSoftKeyDesignatorOriginalHeight;
+			job.key.dataMaskDimension = get_number_x_pixels();
+			job.key.softKeyDesignatorWidth = get_softkey_x_axis_pixels();
+			job.key.smallFontSizes = smallFontSizesBitfield;
+			job.key.largeFontSizes = largeFontSizesBitfield;
+			job.success = false;
+
+			if (nullptr != scaledPoolCache)
+			{
+				objectPool.scaledObjectPool = scaledPoolCache->find(job.key);
+			}
+
+			if (nullptr != objectPool.scaledObjectPool)
+			{
+				CANStackLogger::debug("[VT]: Reusing a cached scaled object pool of " + isobus::to_string(objectPool.objectPoolSize) + " bytes");
+				continue;
+			}
+
+			if (nullptr == sourceData)
+			{
+				// A callback pool that was hashed on an earlier connection, but whose scaled copy isn't cached
+				retVal = read_object_pool_from_callback(objectPool, fetchedData);
 
 				if (!retVal)
 				{
@@ -3587,50 +3992,132 @@ namespace isobus
 				}
 			}
 
-			// Step 2, Parse the pool and resize each object as we iterate through it
-			auto poolIterator = objectPool.scaledObjectPool.begin();
+			// Step 3: Make a read/write copy of the pool to scale
+			if (!fetchedData.empty())
+			{
+				job.poolData = std::move(fetchedData);
+			}
+			else
+			{
+				job.poolData.assign(sourceData, sourceData + objectPool.objectPoolSize);
+			}
 
-			while ((poolIterator != objectPool.scaledObjectPool.end()) &&
-			       retVal)
+			if ((!objectPool.objectIndex.get_is_valid()) ||
+			    (objectPool.objectIndex.get_pool_size() != objectPool.objectPoolSize))
 			{
-				if (VirtualTerminalObjectType::Key == static_cast<VirtualTerminalObjectType>(poolIterator[2]))
-				{
-					retVal &= resize_object(&poolIterator[0],
-					                        static_cast<float>(get_softkey_x_axis_pixels()) / static_cast<float>(objectPool.autoScaleSoftKeyDesignatorOriginalHeight),
-					                        static_cast<VirtualTerminalObjectType>(poolIterator[2]));
-				}
-				else
+				// Callback pools were never indexed, and a vector pool may have been changed since it was assigned
+				job.localIndex.build(job.poolData.data(), static_cast<std::uint32_t>(job.poolData.size()));
+			}
+			jobs.push_back(std::move(job));
+		}
+
+		// Step 4: Scale the remaining pools, sharing them between this thread and a few helper threads if there's more than one
+		if (retVal && !jobs.empty())
+		{
+			const std::size_t numberOfCores = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+			const std::size_t numberOfThreads = std::min<std::size_t>({ jobs.size(), numberOfCores, MAX_OBJECT_POOL_SCALING_THREADS });
+			std::atomic<std::size_t> nextJob = { 0 };
+			std::vector<std::thread> scalingThreads;
+			auto run_jobs = [this, &jobs, &nextJob]() {
+				for (std::size_t i = nextJob++; i < jobs.size(); i = nextJob++)
 				{
-					retVal &= resize_object(&poolIterator[0],
-					                        static_cast<float>(get_number_x_pixels()) / static_cast<float>(objectPool.autoScaleDataMaskOriginalDimension),
-					                        static_cast<VirtualTerminalObjectType>(poolIterator[2]));
+					ScalingJob &job = jobs[i];
+					const VirtualTerminalObjectPoolIndex &index = job.localIndex.get_is_valid() ? job.localIndex : job.objectPool->objectIndex;
+					job.success = scale_object_pool(*job.objectPool, job.poolData, index);
 				}
+			};
+
+			scalingThreads.reserve(numberOfThreads - 1);
+			for (std::size_t i = 1; i < numberOfThreads; i++)
+			{
+				scalingThreads.emplace_back(run_jobs);
+			}
+			run_jobs();
+
+			for (auto &thread : scalingThreads)
+			{
+				thread.join();
+			}
 
-				std::uint32_t objectSize = get_number_bytes_in_object(&poolIterator[0]);
-				if (retVal)
+			for (auto &job : jobs)
+			{
+				if (job.success)
 				{
-					if (get_is_object_scalable(static_cast<VirtualTerminalObjectType>(*(poolIterator + 2))))
+					auto scaledPool = std::make_shared<const std::vector<std::uint8_t>>(std::move(job.poolData));
+					job.objectPool->scaledObjectPool = scaledPool;
+
+					if (nullptr != scaledPoolCache)
 					{
-						CANStackLogger::debug("[VT]: Resized an object: " +
-						                      isobus::to_string(static_cast<int>((*poolIterator)) | (static_cast<int>((*poolIterator + 1))) << 8) +
-						                      " with type " +
-						                      isobus::to_string(static_cast<int>((*(poolIterator + 2)))) +
-						                      " with size " +
-						                      isobus::to_string(static_cast<int>(objectSize)));
+						scaledPoolCache->insert(job.key, scaledPool);
 					}
 				}
 				else
+				{
+					retVal = false;
+				}
+			}
+		}
+		return retVal;
+	}
+
+	bool VirtualTerminalClient::read_object_pool_from_callback(const ObjectPoolDataStruct &objectPool, std::vector<std::uint8_t> &poolData)
+	{
+		bool retVal = true;
+
+		poolData.resize(objectPool.objectPoolSize);
+
+		for (std::uint32_t i = 0; (i < objectPool.objectPoolSize) && retVal; i += OBJECT_POOL_FETCH_CHUNK_SIZE)
+		{
+			const std::uint32_t bytesToRead = ((objectPool.objectPoolSize - i) < OBJECT_POOL_FETCH_CHUNK_SIZE) ? (objectPool.objectPoolSize - i) : OBJECT_POOL_FETCH_CHUNK_SIZE;
+			retVal = objectPool.dataCallback(i, i, bytesToRead, &poolData[i], this);
+		}
+
+		if (!retVal)
+		{
+			CANStackLogger::error("[VT]: Failed to read an object pool from its data chunk callback for scaling");
+		}
+		return retVal;
+	}
+
+	bool VirtualTerminalClient::scale_object_pool(const ObjectPoolDataStruct &objectPool, std::vector<std::uint8_t> &poolData, const VirtualTerminalObjectPoolIndex &objectIndex)
+	{
+		bool retVal = true;
+		const float dataMaskScaleFactor = static_cast<float>(get_number_x_pixels()) / static_cast<float>(objectPool.autoScaleDataMaskOriginalDimension);
+		const float softKeyScaleFactor = static_cast<float>(get_softkey_x_axis_pixels()) / static_cast<float>(objectPool.autoScaleSoftKeyDesignatorOriginalHeight);
+
+		if ((!objectIndex.get_is_valid()) ||
+		    (objectIndex.get_pool_size() != poolData.size()))
+		{
+			CANStackLogger::error("[VT]: Cannot autoscale object pool, the pool could not be indexed");
+			retVal = false;
+		}
+
+		for (std::size_t i = 0; (i < objectIndex.get_number_objects()) && retVal; i++)
+		{
+			const VirtualTerminalObjectPoolIndex::ObjectInfo *object = objectIndex.get_object_at_position(i);
+
+			if (nullptr != object)
+			{
+				retVal = resize_object(&poolData[object->offset],
+				                       (VirtualTerminalObjectType::Key == object->type) ? softKeyScaleFactor : dataMaskScaleFactor,
+				                       object->type);
+
+				if (!retVal)
 				{
 					CANStackLogger::error("[VT]: Failed to resize an object: " +
-					                      isobus::to_string(static_cast<int>((*poolIterator)) | (static_cast<int>((*poolIterator + 1))) << 8) +
+					                      isobus::to_string(static_cast<int>(object->objectID)) +
 					                      " with type " +
-					                      isobus::to_string(static_cast<int>((*poolIterator + 2))) +
+					                      isobus::to_string(static_cast<int>(object->type)) +
 					                      " with size " +
-					                      isobus::to_string(static_cast<int>(objectSize)));
+					                      isobus::to_string(static_cast<int>(object->length)));
 				}
-				poolIterator += objectSize;
 			}
 		}
+
+		if (retVal)
+		{
+			CANStackLogger::debug("[VT]: Scaled " + isobus::to_string(objectIndex.get_number_objects()) + " objects in a pool of " + isobus::to_string(poolData.size()) + " bytes");
+		}
 		return retVal;
 	}
 
@@ -3691,7 +4178,7 @@ namespace isobus
 
 		while ((!get_font_size_supported(retVal)) && (FontSize::Size6x8 != retVal))
 		{
-			retVal = static_cast<FontSize>(static_cast<std::uint8_t>(originalFont) - 1);
+			retVal = static_cast<FontSize>(static_cast<std::uint8_t>(retVal) - 1);
 		}
 		return retVal;
 	}
@@ -3912,510 +4399,69 @@ namespace isobus
 
 	std::uint32_t VirtualTerminalClient::get_minimum_object_length(VirtualTerminalObjectType type)
 	{
-		std::uint32_t retVal = 0;
+		return VirtualTerminalObjectPoolIndex::get_minimum_object_length(type);
+	}
 
-		switch (type)
-		{
-			case VirtualTerminalObjectType::WorkingSet:
-			{
-				retVal = 10;
-			}
-			break;
+	std::uint32_t VirtualTerminalClient::get_number_bytes_in_object(std::uint8_t *buffer)
+	{
+		return VirtualTerminalObjectPoolIndex::get_object_length(buffer, std::numeric_limits<std::uint32_t>::max());
+	}
 
-			case VirtualTerminalObjectType::OutputList:
-			case VirtualTerminalObjectType::ExternalReferenceNAME:
-			case VirtualTerminalObjectType::ObjectLabelRefrenceList:
-			{
-				retVal = 12;
-			}
-			break;
+	void VirtualTerminalClient::process_standard_object_height_and_width(std::uint8_t *buffer, float scaleFactor)
+	{
+		auto width = static_cast<std::uint16_t>(((static_cast<std::uint16_t>(buffer[3]) | (static_cast<std::uint16_t>(buffer[4]) << 8))) * scaleFactor);
+		auto height = static_cast<std::uint16_t>(((static_cast<std::uint16_t>(buffer[5]) | (static_cast<std::uint16_t>(buffer[6]) << 8))) * scaleFactor);
+		buffer[3] = (width & 0xFF);
+		buffer[4] = (width >> 8);
+		buffer[5] = (height & 0xFF);
+		buffer[6] = (height >> 8);
+	}
 
-			case VirtualTerminalObjectType::AlarmMask:
-			case VirtualTerminalObjectType::Container:
-			case VirtualTerminalObjectType::KeyGroup:
-			{
-				retVal = 10;
-			}
-			break;
+	bool VirtualTerminalClient::resize_object(std::uint8_t *buffer, float scaleFactor, VirtualTerminalObjectType type)
+	{
+		bool retVal = false;
 
-			case VirtualTerminalObjectType::ExternalObjectPointer:
+		if (get_is_object_scalable(type))
+		{
+			switch (type)
 			{
-				retVal = 9;
-			}
-			break;
+				case VirtualTerminalObjectType::DataMask:
+				{
+					const std::uint8_t childrenToFollow = buffer[6];
 
-			case VirtualTerminalObjectType::SoftKeyMask:
-			case VirtualTerminalObjectType::ColourMap:
-			{
-				retVal = 6;
-			}
-			break;
+					for (std::uint_fast8_t i = 0; i < childrenToFollow; i++)
+					{
+						auto childX = static_cast<std::int16_t>(((static_cast<std::int16_t>(buffer[10 + (6 * i)]) | (static_cast<std::int16_t>(buffer[11 + (6 * i)]) << 8))) * scaleFactor);
+						auto childY = static_cast<std::int16_t>(((static_cast<std::int16_t>(buffer[12 + (6 * i)]) | (static_cast<std::int16_t>(buffer[13 + (6 * i)]) << 8))) * scaleFactor);
+						buffer[10 + (6 * i)] = (childX & 0xFF);
+						buffer[11 + (6 * i)] = (childX >> 8);
+						buffer[12 + (6 * i)] = (childY & 0xFF);
+						buffer[13 + (6 * i)] = (childY >> 8);
+					}
+					retVal = true;
+				}
+				break;
 
-			case VirtualTerminalObjectType::Key:
-			case VirtualTerminalObjectType::NumberVariable:
-			case VirtualTerminalObjectType::InputAttributes:
-			{
-				retVal = 7;
-			}
-			break;
+				case VirtualTerminalObjectType::AlarmMask:
+				{
+					const std::uint8_t childrenToFollow = buffer[8];
 
-			case VirtualTerminalObjectType::Button:
-			case VirtualTerminalObjectType::InputBoolean:
-			case VirtualTerminalObjectType::OutputRectangle:
-			case VirtualTerminalObjectType::InputList:
-			case VirtualTerminalObjectType::ExternalObjectDefinition:
-			{
-				retVal = 13;
-			}
-			break;
+					for (std::uint_fast8_t i = 0; i < childrenToFollow; i++)
+					{
+						auto childX = static_cast<std::int16_t>(((static_cast<std::int16_t>(buffer[12 + (6 * i)]) | (static_cast<std::int16_t>(buffer[13 + (6 * i)]) << 8))) * scaleFactor);
+						auto childY = static_cast<std::int16_t>(((static_cast<std::int16_t>(buffer[14 + (6 * i)]) | (static_cast<std::int16_t>(buffer[15 + (6 * i)]) << 8))) * scaleFactor);
+						buffer[12 + (6 * i)] = (childX & 0xFF);
+						buffer[13 + (6 * i)] = (childX >> 8);
+						buffer[14 + (6 * i)] = (childY & 0xFF);
+						buffer[15 + (6 * i)] = (childY >> 8);
+					}
+					retVal = true;
+				}
+				break;
 
-			case VirtualTerminalObjectType::InputString:
-			{
-				retVal = 19;
-			}
-			break;
-
-			case VirtualTerminalObjectType::InputNumber:
-			{
-				retVal = 38;
-			}
-			break;
-
-			case VirtualTerminalObjectType::OutputString:
-			{
-				retVal = 17;
-			}
-			break;
-
-			case VirtualTerminalObjectType::OutputNumber:
-			{
-				retVal = 29;
-			}
-			break;
-
-			case VirtualTerminalObjectType::OutputLine:
-			{
-				retVal = 11;
-			}
-			break;
-
-			case VirtualTerminalObjectType::OutputEllipse:
-			{
-				retVal = 15;
-			}
-			break;
-
-			case VirtualTerminalObjectType::OutputPolygon:
-			{
-				retVal = 14;
-			}
-			break;
-
-			case VirtualTerminalObjectType::OutputMeter:
-			{
-				retVal = 21;
-			}
-			break;
-
-			case VirtualTerminalObjectType::OutputLinearBarGraph:
-			{
-				retVal = 24;
-			}
-			break;
-
-			case VirtualTerminalObjectType::OutputArchedBarGraph:
-			{
-				retVal = 27;
-			}
-			break;
-
-			case VirtualTerminalObjectType::PictureGraphic:
-			case VirtualTerminalObjectType::Animation:
-			case VirtualTerminalObjectType::WindowMask:
-			{
-				retVal = 17;
-			}
-			break;
-
-			case VirtualTerminalObjectType::StringVariable:
-			case VirtualTerminalObjectType::ExtendedInputAttributes:
-			case VirtualTerminalObjectType::ObjectPointer:
-			case VirtualTerminalObjectType::Macro:
-			{
-				retVal = 5;
-			}
-			break;
-
-			case VirtualTerminalObjectType::FontAttributes:
-			case VirtualTerminalObjectType::LineAttributes:
-			case VirtualTerminalObjectType::FillAttributes:
-			case VirtualTerminalObjectType::DataMask:
-			{
-				retVal = 8;
-			}
-			break;
-
-			case VirtualTerminalObjectType::GraphicsContext:
-			{
-				retVal = 34;
-			}
-			break;
-
-			default:
-			{
-				CANStackLogger::error("[VT]: Cannot autoscale object pool due to unknown object minimum length - type " + static_cast<int>(type));
-			}
-			break;
-		}
-		return retVal;
-	}
-
-	std::uint32_t VirtualTerminalClient::get_number_bytes_in_object(std::uint8_t *buffer)
-	{
-		auto currentObjectType = static_cast<VirtualTerminalObjectType>(buffer[2]);
-		std::uint32_t retVal = get_minimum_object_length(currentObjectType);
-
-		switch (currentObjectType)
-		{
-			case VirtualTerminalObjectType::WorkingSet:
-			{
-				const std::uint32_t sizeOfChildObjects = (buffer[7] * 6);
-				const std::uint32_t sizeOfMacros = (buffer[8] * 2);
-				const std::uint32_t sizeOfLanguageCodes = (buffer[9] * 2);
-				retVal += (sizeOfLanguageCodes + sizeOfChildObjects + sizeOfMacros);
-			}
-			break;
-
-			case VirtualTerminalObjectType::DataMask:
-			{
-				const std::uint32_t sizeOfChildObjects = (buffer[6] * 6);
-				const std::uint32_t sizeOfMacros = (buffer[7] * 2);
-				retVal += (sizeOfChildObjects + sizeOfMacros);
-			}
-			break;
-
-			case VirtualTerminalObjectType::AlarmMask:
-			case VirtualTerminalObjectType::Container:
-			{
-				const std::uint32_t sizeOfChildObjects = (buffer[8] * 6);
-				const std::uint32_t sizeOfMacros = (buffer[9] * 2);
-				retVal += (sizeOfChildObjects + sizeOfMacros);
-			}
-			break;
-
-			case VirtualTerminalObjectType::SoftKeyMask:
-			{
-				const std::uint32_t sizeOfChildObjects = (buffer[4] * 2);
-				const std::uint32_t sizeOfMacros = (buffer[5] * 2);
-				retVal += (sizeOfChildObjects + sizeOfMacros);
-			}
-			break;
-
-			case VirtualTerminalObjectType::Key:
-			{
-				const std::uint32_t sizeOfChildObjects = (buffer[5] * 6);
-				const std::uint32_t sizeOfMacros = (buffer[6] * 2);
-				retVal += (sizeOfChildObjects + sizeOfMacros);
-			}
-			break;
-
-			case VirtualTerminalObjectType::Button:
-			{
-				const std::uint32_t sizeOfChildObjects = (buffer[11] * 6);
-				const std::uint32_t sizeOfMacros = (buffer[12] * 2);
-				retVal += (sizeOfChildObjects + sizeOfMacros);
-			}
-			break;
-
-			case VirtualTerminalObjectType::InputBoolean:
-			{
-				const std::uint32_t sizeOfMacros = (buffer[12] * 2);
-				retVal += sizeOfMacros;
-			}
-			break;
-
-			case VirtualTerminalObjectType::InputString:
-			{
-				const std::uint32_t sizeOfValue = buffer[16];
-				const std::uint32_t sizeOfMacros = (buffer[18 + sizeOfValue] * 2);
-				retVal += (sizeOfValue + sizeOfMacros);
-			}
-			break;
-
-			case VirtualTerminalObjectType::InputNumber:
-			{
-				const std::uint32_t sizeOfMacros = (buffer[37] * 2);
-				retVal += sizeOfMacros;
-			}
-			break;
-
-			case VirtualTerminalObjectType::InputList:
-			{
-				const std::uint32_t sizeOfMacros = (buffer[12] * 2);
-				const std::uint32_t sizeOfListObjectIDs = (buffer[10] * 2);
-				retVal += (sizeOfMacros + sizeOfListObjectIDs);
-			}
-			break;
-
-			case VirtualTerminalObjectType::OutputString:
-			{
-				const std::uint32_t sizeOfValue = (static_cast<uint16_t>(buffer[14]) | static_cast<uint16_t>(buffer[15] << 8));
-				const std::uint32_t sizeOfMacros = (buffer[16 + sizeOfValue] * 2);
-				retVal += (sizeOfMacros + sizeOfValue);
-			}
-			break;
-
-			case VirtualTerminalObjectType::OutputNumber:
-			{
-				const std::uint32_t sizeOfMacros = (buffer[28] * 2);
-				retVal += sizeOfMacros;
-			}
-			break;
-
-			case VirtualTerminalObjectType::OutputList:
-			{
-				const std::uint32_t sizeOfMacros = (buffer[11] * 2);
-				const std::uint32_t sizeOfListObjectIDs = (buffer[10] * 2);
-				retVal += (sizeOfMacros + sizeOfListObjectIDs);
-			}
-			break;
-
-			case VirtualTerminalObjectType::OutputLine:
-			{
-				const std::uint32_t sizeOfMacros = (buffer[10] * 2);
-				retVal += sizeOfMacros;
-			}
-			break;
-
-			case VirtualTerminalObjectType::OutputRectangle:
-			{
-				const std::uint32_t sizeOfMacros = (buffer[12] * 2);
-				retVal += sizeOfMacros;
-			}
-			break;
-
-			case VirtualTerminalObjectType::OutputEllipse:
-			{
-				const std::uint32_t sizeOfMacros = (buffer[14] * 2);
-				retVal += sizeOfMacros;
-			}
-			break;
-
-			case VirtualTerminalObjectType::OutputPolygon:
-			{
-				const std::uint32_t sizeOfPoints = (buffer[12] * 4);
-				const std::uint32_t sizeOfMacros = (buffer[13] * 2);
-				retVal += (sizeOfMacros + sizeOfPoints);
-			}
-			break;
-
-			case VirtualTerminalObjectType::OutputMeter:
-			{
-				const std::uint32_t sizeOfMacros = (buffer[20] * 2);
-				retVal += sizeOfMacros;
-			}
-			break;
-
-			case VirtualTerminalObjectType::OutputLinearBarGraph:
-			{
-				const std::uint32_t sizeOfMacros = (buffer[23] * 2);
-				retVal += sizeOfMacros;
-			}
-			break;
-
-			case VirtualTerminalObjectType::OutputArchedBarGraph:
-			{
-				const std::uint32_t sizeOfMacros = (buffer[26] * 2);
-				retVal += sizeOfMacros;
-			}
-			break;
-
-			case VirtualTerminalObjectType::PictureGraphic:
-			{
-				const std::uint32_t sizeOfMacros = (buffer[16] * 2);
-				const std::uint32_t sizeOfRawData = (static_cast<std::uint32_t>(buffer[12]) |
-				                                     (static_cast<std::uint32_t>(buffer[13]) << 8) |
-				                                     (static_cast<std::uint32_t>(buffer[14]) << 16) |
-				                                     (static_cast<std::uint32_t>(buffer[15]) << 24));
-				retVal += (sizeOfRawData + sizeOfMacros);
-			}
-			break;
-
-			case VirtualTerminalObjectType::ObjectPointer:
-			case VirtualTerminalObjectType::NumberVariable:
-			case VirtualTerminalObjectType::GraphicsContext:
-			case VirtualTerminalObjectType::ExternalReferenceNAME:
-			case VirtualTerminalObjectType::ExternalObjectPointer:
-			case VirtualTerminalObjectType::AuxiliaryControlDesignatorType2:
-			{
-				// No additional length
-			}
-			break;
-
-			case VirtualTerminalObjectType::StringVariable:
-			{
-				const std::uint32_t sizeOfValue = (static_cast<uint16_t>(buffer[3]) | static_cast<uint16_t>(buffer[4]) << 8);
-				retVal += sizeOfValue;
-			}
-			break;
-
-			case VirtualTerminalObjectType::FontAttributes:
-			case VirtualTerminalObjectType::LineAttributes:
-			case VirtualTerminalObjectType::FillAttributes:
-			{
-				const std::uint32_t sizeOfMacros = (buffer[7] * 2);
-				retVal += sizeOfMacros;
-			}
-			break;
-
-			case VirtualTerminalObjectType::InputAttributes:
-			{
-				const std::uint32_t sizeOfValidationString = buffer[4];
-				const std::uint32_t sizeOfMacros = (buffer[5 + sizeOfValidationString] * 2);
-				retVal += (sizeOfMacros + sizeOfValidationString);
-			}
-			break;
-
-			case VirtualTerminalObjectType::ExtendedInputAttributes:
-			{
-				const std::uint32_t numberOfCodePlanes = buffer[5];
-				retVal += (numberOfCodePlanes * 2); // Doesn't include the character ranges, need to handle those externally
-			}
-			break;
-
-			case VirtualTerminalObjectType::Macro:
-			{
-				const std::uint32_t numberOfMacroBytes = (static_cast<std::uint16_t>(buffer[3]) | (static_cast<std::uint16_t>(buffer[4]) << 8));
-				retVal += numberOfMacroBytes;
-			}
-			break;
-
-			case VirtualTerminalObjectType::ColourMap:
-			{
-				const std::uint32_t numberIndexes = (static_cast<std::uint16_t>(buffer[3]) | (static_cast<std::uint16_t>(buffer[4]) << 8));
-				retVal += numberIndexes;
-			}
-			break;
-
-			case VirtualTerminalObjectType::WindowMask:
-			{
-				const std::uint32_t sizeOfReferences = (buffer[14] * 2);
-				const std::uint32_t numberObjects = (buffer[15] * 6);
-				const std::uint32_t sizeOfMacros = (buffer[16] * 2);
-				retVal += (sizeOfMacros + numberObjects + sizeOfReferences);
-			}
-			break;
-
-			case VirtualTerminalObjectType::KeyGroup:
-			{
-				const std::uint32_t numberObjects = (buffer[8] * 2);
-				const std::uint32_t sizeOfMacros = (buffer[9] * 2);
-				retVal += (sizeOfMacros + numberObjects);
-			}
-			break;
-
-			case VirtualTerminalObjectType::ObjectLabelRefrenceList:
-			{
-				const std::uint32_t sizeOfLabeledObjects = ((static_cast<uint16_t>(buffer[4]) | static_cast<uint16_t>(buffer[5]) << 8) * 7);
-				retVal += sizeOfLabeledObjects;
-			}
-			break;
-
-			case VirtualTerminalObjectType::ExternalObjectDefinition:
-			{
-				const std::uint32_t sizeOfObjects = (buffer[12] * 2);
-				retVal += sizeOfObjects;
-			}
-			break;
-
-			case VirtualTerminalObjectType::Animation:
-			{
-				const std::uint32_t sizeOfObjects = (buffer[15] * 6);
-				const std::uint32_t sizeOfMacros = (buffer[16] * 2);
-				retVal += (sizeOfMacros + sizeOfObjects);
-			}
-			break;
-
-			case VirtualTerminalObjectType::AuxiliaryFunctionType1:
-			case VirtualTerminalObjectType::AuxiliaryFunctionType2:
-			{
-				const std::uint32_t sizeOfObjects = (buffer[5] * 6);
-				retVal += sizeOfObjects;
-			}
-			break;
-
-			case VirtualTerminalObjectType::AuxiliaryInputType1:
-			case VirtualTerminalObjectType::AuxiliaryInputType2:
-			{
-				const std::uint32_t sizeOfObjects = (buffer[6] * 6);
-				retVal += sizeOfObjects;
-			}
-			break;
-
-			default:
-			{
-				CANStackLogger::error("[VT]: Cannot autoscale object pool due to unknown object total length - type " + static_cast<int>(buffer[2]));
-			}
-			break;
-		}
-		return retVal;
-	}
-
-	void VirtualTerminalClient::process_standard_object_height_and_width(std::uint8_t *buffer, float scaleFactor)
-	{
-		auto width = static_cast<std::uint16_t>(((static_cast<std::uint16_t>(buffer[3]) | (static_cast<std::uint16_t>(buffer[4]) << 8))) * scaleFactor);
-		auto height = static_cast<std::uint16_t>(((static_cast<std::uint16_t>(buffer[5]) | (static_cast<std::uint16_t>(buffer[6]) << 8))) * scaleFactor);
-		buffer[3] = (width & 0xFF);
-		buffer[4] = (width >> 8);
-		buffer[5] = (height & 0xFF);
-		buffer[6] = (height >> 8);
-	}
-
-	bool VirtualTerminalClient::resize_object(std::uint8_t *buffer, float scaleFactor, VirtualTerminalObjectType type)
-	{
-		bool retVal = false;
-
-		if (get_is_object_scalable(type))
-		{
-			switch (type)
-			{
-				case VirtualTerminalObjectType::DataMask:
-				{
-					const std::uint8_t childrenToFollow = buffer[6];
-
-					for (std::uint_fast8_t i = 0; i < childrenToFollow; i++)
-					{
-						auto childX = static_cast<std::int16_t>(((static_cast<std::int16_t>(buffer[10 + (6 * i)]) | (static_cast<std::int16_t>(buffer[11 + (6 * i)]) << 8))) * scaleFactor);
-						auto childY = static_cast<std::int16_t>(((static_cast<std::int16_t>(buffer[12 + (6 * i)]) | (static_cast<std::int16_t>(buffer[13 + (6 * i)]) << 8))) * scaleFactor);
-						buffer[10 + (6 * i)] = (childX & 0xFF);
-						buffer[11 + (6 * i)] = (childX >> 8);
-						buffer[12 + (6 * i)] = (childY & 0xFF);
-						buffer[13 + (6 * i)] = (childY >> 8);
-					}
-					retVal = true;
-				}
-				break;
-
-				case VirtualTerminalObjectType::AlarmMask:
-				{
-					const std::uint8_t childrenToFollow = buffer[8];
-
-					for (std::uint_fast8_t i = 0; i < childrenToFollow; i++)
-					{
-						auto childX = static_cast<std::int16_t>(((static_cast<std::int16_t>(buffer[12 + (6 * i)]) | (static_cast<std::int16_t>(buffer[13 + (6 * i)]) << 8))) * scaleFactor);
-						auto childY = static_cast<std::int16_t>(((static_cast<std::int16_t>(buffer[14 + (6 * i)]) | (static_cast<std::int16_t>(buffer[15 + (6 * i)]) << 8))) * scaleFactor);
-						buffer[12 + (6 * i)] = (childX & 0xFF);
-						buffer[13 + (6 * i)] = (childX >> 8);
-						buffer[14 + (6 * i)] = (childY & 0xFF);
-						buffer[15 + (6 * i)] = (childY >> 8);
-					}
-					retVal = true;
-				}
-				break;
-
-				case VirtualTerminalObjectType::Container:
-				{
-					std::uint8_t childrenToFollow = buffer[8];
+				case VirtualTerminalObjectType::Container:
+				{
+					std::uint8_t childrenToFollow = buffer[8];
 
 					// Modify the object in memory
 					process_standard_object_height_and_width(buffer, scaleFactor);
@@ -4639,16 +4685,176 @@ namespace isobus
 		return retVal;
 	}
 
-	void VirtualTerminalClient::worker_thread_function()
+	bool VirtualTerminalClient::send_command(const std::uint8_t *data, std::uint32_t length)
 	{
-		for (;;)
+		bool retVal;
+		bool commandQueued = false;
+		VTCommandCompletionOptions *completionOptions = nullptr;
+
+		if ((nullptr != currentCompletionOptions) &&
+		    (this == currentCompletionOptions->client))
+		{
+			// Only the first command sent inside send_command_with_completion() gets its options
+			completionOptions = currentCompletionOptions;
+			currentCompletionOptions = nullptr;
+		}
+
+		if ((shadowStateEnabled) &&
+		    (shadowState.get_is_redundant(data, length)))
+		{
+			// The VT already has this value, or will once it processes a command we already sent
+			numberSuppressedCommands++;
+			retVal = true;
+
+			if ((nullptr != completionOptions) &&
+			    (nullptr != completionOptions->callback))
+			{
+				completionOptions->callback(VirtualTerminalCommandPipeline::Result::Success, 0);
+			}
+		}
+		else if (nullptr != completionOptions)
 		{
-			if (shouldTerminate)
+			retVal = add_to_command_pipeline(data, length, completionOptions->priority, completionOptions->callback);
+			commandQueued = retVal;
+
+			if (!retVal)
 			{
-				break;
+				CANStackLogger::error("[VT]: Unable to queue command " + isobus::to_string(static_cast<int>(data[0])) + " with a completion callback, the VT doesn't respond to it or the pipeline is full");
 			}
-			update();
-			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+		else if ((commandCoalescingEnabled) &&
+		         (VirtualTerminalCommandCoalescer::get_is_coalescable(data, length)))
+		{
+			retVal = commandCoalescer.add(data, length);
+			commandQueued = retVal;
+		}
+		else if ((commandPipelineEnabled) &&
+		         (VirtualTerminalCommandPipeline::get_is_managed(data, length)))
+		{
+			retVal = add_to_command_pipeline(data, length, VirtualTerminalCommandPipeline::get_default_priority(data[0]), nullptr);
+			commandQueued = retVal;
+		}
+		else
+		{
+			retVal = CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
+			                                                        data,
+			                                                        length,
+			                                                        myControlFunction.get(),
+			                                                        partnerControlFunction.get(),
+			                                                        CANIdentifier::PriorityLowest7);
+		}
+
+		if (retVal)
+		{
+			// Tracked even when suppression is disabled, so that it can be enabled at any time
+			shadowState.process_sent_command(data, length);
+		}
+
+		if (commandQueued)
+		{
+			// Let the executor send the command now instead of at the next timer deadline
+			wake_executor();
+		}
+		return retVal;
+	}
+
+	bool VirtualTerminalClient::add_to_command_pipeline(const std::uint8_t *data,
+	                                                    std::uint32_t length,
+	                                                    VirtualTerminalCommandPipeline::Priority priority,
+	                                                    VirtualTerminalCommandPipeline::CompletionCallback callback)
+	{
+		bool retVal;
+
+		if (VirtualTerminalShadowState::get_is_tracked(data, length))
+		{
+			// The VT may or may not have the value of a command that didn't finish, so make sure a repeat of it is sent
+			std::vector<std::uint8_t> command(data, data + length);
+			retVal = commandPipeline.add(data, length, priority, [this, command, callback](VirtualTerminalCommandPipeline::Result result, std::uint8_t errorCode) {
+				if ((VirtualTerminalCommandPipeline::Result::Timeout == result) ||
+				    (VirtualTerminalCommandPipeline::Result::Aborted == result))
+				{
+					shadowState.process_failed_command(command.data(), static_cast<std::uint32_t>(command.size()));
+				}
+
+				if (nullptr != callback)
+				{
+					callback(result, errorCode);
+				}
+			});
+		}
+		else
+		{
+			retVal = commandPipeline.add(data, length, priority, callback);
+		}
+		return retVal;
+	}
+
+	void VirtualTerminalClient::update_coalesced_commands()
+	{
+		if (0 != commandCoalescer.get_number_pending())
+		{
+			bool shouldFlush = false;
+
+			if (!commandCoalescingEnabled)
+			{
+				shouldFlush = true;
+			}
+			else if ((flushCoalescedCommandsOnResponse) &&
+			         (0 == commandCoalescer.get_number_awaiting_response()))
+			{
+				shouldFlush = true;
+			}
+			else if (SystemTiming::time_expired_ms(lastCoalescedCommandFlushTimestamp_ms, commandCoalescingInterval_ms))
+			{
+				// Any responses we were waiting on are either lost or very late, so stop waiting for them
+				commandCoalescer.clear_awaiting_response();
+				shouldFlush = true;
+			}
+
+			if (shouldFlush)
+			{
+				commandCoalescer.flush([this](const std::uint8_t *data, std::uint32_t length) {
+					bool retVal;
+
+					if (commandPipelineEnabled)
+					{
+						retVal = add_to_command_pipeline(data, length, VirtualTerminalCommandPipeline::get_default_priority(data[0]), nullptr);
+					}
+					else
+					{
+						retVal = CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
+						                                                        data,
+						                                                        length,
+						                                                        myControlFunction.get(),
+						                                                        partnerControlFunction.get(),
+						                                                        CANIdentifier::PriorityLowest7);
+					}
+					return retVal;
+				});
+				lastCoalescedCommandFlushTimestamp_ms = SystemTiming::get_timestamp_ms();
+			}
+		}
+	}
+
+	void VirtualTerminalClient::update_command_pipeline()
+	{
+		commandPipeline.update([this](const std::uint8_t *data, std::uint32_t length) {
+			return CANNetworkManager::CANNetwork.send_can_message(static_cast<std::uint32_t>(CANLibParameterGroupNumber::ECUtoVirtualTerminal),
+			                                                      data,
+			                                                      length,
+			                                                      myControlFunction.get(),
+			                                                      partnerControlFunction.get(),
+			                                                      CANIdentifier::PriorityLowest7);
+		});
+	}
+
+	void VirtualTerminalClient::wake_executor()
+	{
+		const std::lock_guard<std::mutex> lock(executorMutex);
+
+		if (nullptr != executor)
+		{
+			executor->wake(this);
 		}
 	}
 
@@ -0,0 +1,202 @@
+//================================================================================================
+/// @file isobus_virtual_terminal_client_executor.cpp
+///
+/// @brief Implements a thread that updates VT clients when something happens
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#include "isobus/isobus/isobus_virtual_terminal_client_executor.hpp"
+#include "isobus/isobus/isobus_virtual_terminal_client.hpp"
+#include "isobus/utility/system_timing.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace isobus
+{
+	VirtualTerminalClientExecutor::VirtualTerminalClientExecutor() :
+	  numberUpdates(0),
+	  wakePending(false),
+	  shouldTerminate(false)
+	{
+		workerThread = std::thread([this]() { worker_thread_function(); });
+	}
+
+	VirtualTerminalClientExecutor::~VirtualTerminalClientExecutor()
+	{
+		{
+			const std::lock_guard<std::mutex> lock(executorMutex);
+			shouldTerminate = true;
+		}
+		wakeCondition.notify_one();
+
+		if (workerThread.joinable())
+		{
+			workerThread.join();
+		}
+	}
+
+	void VirtualTerminalClientExecutor::add_client(VirtualTerminalClient *client)
+	{
+		if (nullptr != client)
+		{
+			{
+				const std::lock_guard<std::mutex> lock(executorMutex);
+
+				if (nullptr == find_client(client))
+				{
+					clients.push_back({ client, SystemTiming::get_timestamp_ms(), 0, true });
+					wakePending = true;
+				}
+			}
+			wakeCondition.notify_one();
+		}
+	}
+
+	void VirtualTerminalClientExecutor::remove_client(VirtualTerminalClient *client)
+	{
+		std::unique_lock<std::mutex> updateLock(updateMutex, std::defer_lock);
+
+		if (std::this_thread::get_id() != workerThread.get_id())
+		{
+			// Wait for the client's update to finish if it's running
+			updateLock.lock();
+		}
+
+		const std::lock_guard<std::mutex> lock(executorMutex);
+		auto scheduledClient = std::find_if(clients.begin(), clients.end(), [client](const ScheduledClient &candidate) { return candidate.client == client; });
+
+		if (clients.end() != scheduledClient)
+		{
+			clients.erase(scheduledClient);
+		}
+	}
+
+	std::size_t VirtualTerminalClientExecutor::get_number_clients() const
+	{
+		const std::lock_guard<std::mutex> lock(executorMutex);
+		return clients.size();
+	}
+
+	void VirtualTerminalClientExecutor::wake(VirtualTerminalClient *client)
+	{
+		bool shouldNotify = false;
+
+		{
+			const std::lock_guard<std::mutex> lock(executorMutex);
+			ScheduledClient *scheduledClient = find_client(client);
+
+			if ((nullptr != scheduledClient) &&
+			    (!scheduledClient->woken))
+			{
+				scheduledClient->woken = true;
+				wakePending = true;
+				shouldNotify = true;
+			}
+		}
+
+		if (shouldNotify)
+		{
+			wakeCondition.notify_one();
+		}
+	}
+
+	std::uint32_t VirtualTerminalClientExecutor::get_number_updates() const
+	{
+		const std::lock_guard<std::mutex> lock(executorMutex);
+		return numberUpdates;
+	}
+
+	void VirtualTerminalClientExecutor::worker_thread_function()
+	{
+		std::vector<VirtualTerminalClient *> dueClients;
+		std::unique_lock<std::mutex> lock(executorMutex);
+
+		while (!shouldTerminate)
+		{
+			std::uint32_t sleepTime_ms = std::numeric_limits<std::uint32_t>::max();
+
+			dueClients.clear();
+			wakePending = false;
+
+			for (auto &scheduledClient : clients)
+			{
+				const std::uint32_t elapsedTime_ms = SystemTiming::get_time_elapsed_ms(scheduledClient.lastUpdateTimestamp_ms);
+
+				if ((scheduledClient.woken) ||
+				    (elapsedTime_ms >= scheduledClient.updateDelay_ms))
+				{
+					scheduledClient.woken = false;
+					dueClients.push_back(scheduledClient.client);
+				}
+				else
+				{
+					sleepTime_ms = std::min(sleepTime_ms, scheduledClient.updateDelay_ms - elapsedTime_ms);
+				}
+			}
+
+			if (!dueClients.empty())
+			{
+				// Update without holding executorMutex, so clients can wake themselves from their own callbacks
+				lock.unlock();
+
+				{
+					const std::lock_guard<std::mutex> updateLock(updateMutex);
+
+					for (auto client : dueClients)
+					{
+						bool stillAdded;
+						{
+							const std::lock_guard<std::mutex> clientsLock(executorMutex);
+							stillAdded = (nullptr != find_client(client));
+						}
+
+						if (stillAdded)
+						{
+							client->update();
+							const std::uint32_t updateDelay_ms = client->get_time_until_next_update_ms();
+
+							const std::lock_guard<std::mutex> clientsLock(executorMutex);
+							ScheduledClient *scheduledClient = find_client(client);
+
+							if (nullptr != scheduledClient)
+							{
+								scheduledClient->lastUpdateTimestamp_ms = SystemTiming::get_timestamp_ms();
+								scheduledClient->updateDelay_ms = updateDelay_ms;
+							}
+							numberUpdates++;
+						}
+					}
+				}
+				lock.lock();
+			}
+			else if (std::numeric_limits<std::uint32_t>::max() == sleepTime_ms)
+			{
+				// No clients, so there's nothing to do until one is added
+				wakeCondition.wait(lock, [this]() { return (wakePending || shouldTerminate); });
+			}
+			else
+			{
+				wakeCondition.wait_for(lock, std::chrono::milliseconds(sleepTime_ms), [this]() { return (wakePending || shouldTerminate); });
+			}
+		}
+	}
+
+	VirtualTerminalClientExecutor::ScheduledClient *VirtualTerminalClientExecutor::find_client(const VirtualTerminalClient *client)
+	{
+		ScheduledClient *retVal = nullptr;
+
+		for (auto &scheduledClient : clients)
+		{
+			if (scheduledClient.client == client)
+			{
+				retVal = &scheduledClient;
+				break;
+			}
+		}
+		return retVal;
+	}
+} // namespace isobus
@@ -0,0 +1,200 @@
+//================================================================================================
+/// @file isobus_virtual_terminal_command_coalescer.cpp
+///
+/// @brief Implements a queue of VT commands that keeps only the latest value for each object
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#include "isobus/isobus/isobus_virtual_terminal_command_coalescer.hpp"
+
+namespace isobus
+{
+	VirtualTerminalCommandCoalescer::VirtualTerminalCommandCoalescer() :
+	  numberAwaitingResponse(0),
+	  numberCoalesced(0)
+	{
+	}
+
+	bool VirtualTerminalCommandCoalescer::get_is_coalescable(const std::uint8_t *data, std::uint32_t length)
+	{
+		return ((nullptr != data) &&
+		        (length >= 4) &&
+		        (get_is_coalescable_function(data[0])));
+	}
+
+	bool VirtualTerminalCommandCoalescer::add(const std::uint8_t *data, std::uint32_t length)
+	{
+		bool retVal = false;
+
+		if (get_is_coalescable(data, length))
+		{
+			const std::uint32_t key = get_key(data);
+			const std::lock_guard<std::mutex> lock(queueMutex);
+			auto existingCommand = pendingCommands.find(key);
+
+			if (pendingCommands.end() != existingCommand)
+			{
+				existingCommand->second.assign(data, data + length);
+				numberCoalesced++;
+			}
+			else
+			{
+				pendingCommands[key] = std::vector<std::uint8_t>(data, data + length);
+				pendingOrder.push_back(key);
+			}
+			retVal = true;
+		}
+		return retVal;
+	}
+
+	std::uint32_t VirtualTerminalCommandCoalescer::flush(const SendFunction &sendFunction)
+	{
+		std::uint32_t retVal = 0;
+		const std::lock_guard<std::mutex> lock(queueMutex);
+
+		bool sendFailed = false;
+
+		// Sending only queues the message in the network manager, so it's fine to hold the lock meanwhile
+		while ((!sendFailed) && (!pendingOrder.empty()))
+		{
+			const std::vector<std::uint8_t> &command = pendingCommands[pendingOrder.front()];
+
+			if (sendFunction(command.data(), static_cast<std::uint32_t>(command.size())))
+			{
+				awaitingResponses[pendingOrder.front()]++;
+				pendingCommands.erase(pendingOrder.front());
+				pendingOrder.pop_front();
+				retVal++;
+			}
+			else
+			{
+				sendFailed = true;
+			}
+		}
+		numberAwaitingResponse += retVal;
+		return retVal;
+	}
+
+	void VirtualTerminalCommandCoalescer::process_response(const std::uint8_t *data, std::uint32_t length)
+	{
+		std::uint32_t key = 0;
+
+		if ((nullptr != data) &&
+		    (length > 0) &&
+		    (get_is_coalescable_function(data[0])) &&
+		    (get_response_key(data, length, key)))
+		{
+			const std::lock_guard<std::mutex> lock(queueMutex);
+			auto awaitingResponse = awaitingResponses.find(key);
+
+			if (awaitingResponses.end() != awaitingResponse)
+			{
+				awaitingResponse->second--;
+				numberAwaitingResponse--;
+
+				if (0 == awaitingResponse->second)
+				{
+					awaitingResponses.erase(awaitingResponse);
+				}
+			}
+		}
+	}
+
+	void VirtualTerminalCommandCoalescer::clear_awaiting_response()
+	{
+		const std::lock_guard<std::mutex> lock(queueMutex);
+		awaitingResponses.clear();
+		numberAwaitingResponse = 0;
+	}
+
+	void VirtualTerminalCommandCoalescer::clear()
+	{
+		const std::lock_guard<std::mutex> lock(queueMutex);
+		pendingCommands.clear();
+		pendingOrder.clear();
+		awaitingResponses.clear();
+		numberAwaitingResponse = 0;
+	}
+
+	std::size_t VirtualTerminalCommandCoalescer::get_number_pending() const
+	{
+		const std::lock_guard<std::mutex> lock(queueMutex);
+		return pendingCommands.size();
+	}
+
+	std::uint32_t VirtualTerminalCommandCoalescer::get_number_awaiting_response() const
+	{
+		const std::lock_guard<std::mutex> lock(queueMutex);
+		return numberAwaitingResponse;
+	}
+
+	std::uint32_t VirtualTerminalCommandCoalescer::get_number_coalesced() const
+	{
+		const std::lock_guard<std::mutex> lock(queueMutex);
+		return numberCoalesced;
+	}
+
+	bool VirtualTerminalCommandCoalescer::get_is_coalescable_function(std::uint8_t functionCode)
+	{
+		bool retVal = false;
+
+		switch (functionCode)
+		{
+			case CHANGE_NUMERIC_VALUE_COMMAND:
+			case CHANGE_ATTRIBUTE_COMMAND:
+			case CHANGE_STRING_VALUE_COMMAND:
+			{
+				retVal = true;
+			}
+			break;
+
+			default:
+			{
+			}
+			break;
+		}
+		return retVal;
+	}
+
+	std::uint32_t VirtualTerminalCommandCoalescer::get_key(const std::uint8_t *data)
+	{
+		std::uint32_t retVal = (static_cast<std::uint32_t>(data[0]) << 24) |
+		  (static_cast<std::uint32_t>(data[1]) << 8) |
+		  (static_cast<std::uint32_t>(data[2]) << 16);
+
+		if (CHANGE_ATTRIBUTE_COMMAND == data[0])
+		{
+			retVal |= data[3];
+		}
+		return retVal;
+	}
+
+	bool VirtualTerminalCommandCoalescer::get_response_key(const std::uint8_t *data, std::uint32_t length, std::uint32_t &key)
+	{
+		bool retVal = false;
+
+		if (CHANGE_STRING_VALUE_COMMAND == data[0])
+		{
+			// The change string value response has two reserved bytes before the object ID
+			if (length >= 5)
+			{
+				const std::uint8_t command[] = { data[0], data[3], data[4] };
+				key = get_key(command);
+				retVal = true;
+			}
+		}
+		else if (length >= 4)
+		{
+			// The other responses start with the object ID, followed by the attribute ID for change attribute
+			key = get_key(data);
+			retVal = true;
+		}
+		return retVal;
+	}
+
+	constexpr std::uint8_t VirtualTerminalCommandCoalescer::CHANGE_NUMERIC_VALUE_COMMAND;
+	constexpr std::uint8_t VirtualTerminalCommandCoalescer::CHANGE_ATTRIBUTE_COMMAND;
+	constexpr std::uint8_t VirtualTerminalCommandCoalescer::CHANGE_STRING_VALUE_COMMAND;
+} // namespace isobus
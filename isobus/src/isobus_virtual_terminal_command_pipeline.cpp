@@ -0,0 +1,357 @@
+//================================================================================================
+/// @file isobus_virtual_terminal_command_pipeline.cpp
+///
+/// @brief Implements a flow controlled queue of VT commands
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#include "isobus/isobus/isobus_virtual_terminal_command_pipeline.hpp"
+#include "isobus/utility/system_timing.hpp"
+
+namespace isobus
+{
+	/// @brief The function code of the graphics context command, whose responses are also matched by sub-command
+	static constexpr std::uint8_t GRAPHICS_CONTEXT_COMMAND = 0xB8;
+
+	VirtualTerminalCommandPipeline::VirtualTerminalCommandPipeline(std::uint8_t maximumInFlight) :
+	  statistics{},
+	  maximumQueueSize(DEFAULT_MAXIMUM_QUEUE_SIZE),
+	  responseTimeout_ms(DEFAULT_RESPONSE_TIMEOUT_MS),
+	  maximumInFlight((0 != maximumInFlight) ? maximumInFlight : 1)
+	{
+	}
+
+	bool VirtualTerminalCommandPipeline::get_is_managed(const std::uint8_t *data, std::uint32_t length)
+	{
+		std::uint8_t errorCodeOffset = 0;
+		return ((nullptr != data) &&
+		        (0 != length) &&
+		        (get_error_code_offset(data[0], errorCodeOffset)));
+	}
+
+	VirtualTerminalCommandPipeline::Priority VirtualTerminalCommandPipeline::get_default_priority(std::uint8_t functionCode)
+	{
+		Priority retVal = Priority::Normal;
+
+		switch (functionCode)
+		{
+			case 0x92: // ESC
+			case 0xA3: // Control audio signal
+			case 0xA4: // Set audio volume
+			case 0xAD: // Change active mask
+			case 0xAE: // Change soft key mask
+			case 0xB0: // Change priority
+			case 0xBD: // Lock/unlock mask
+			{
+				retVal = Priority::High;
+			}
+			break;
+
+			case 0xA8: // Change numeric value
+			case 0xAF: // Change attribute
+			case 0xB3: // Change string value
+			case GRAPHICS_CONTEXT_COMMAND:
+			{
+				retVal = Priority::Low;
+			}
+			break;
+
+			default:
+			{
+			}
+			break;
+		}
+		return retVal;
+	}
+
+	bool VirtualTerminalCommandPipeline::add(const std::uint8_t *data, std::uint32_t length, Priority priority, CompletionCallback callback)
+	{
+		bool retVal = false;
+
+		if ((get_is_managed(data, length)) &&
+		    (priority < Priority::NumberOfPriorities))
+		{
+			const std::lock_guard<std::mutex> lock(pipelineMutex);
+			std::deque<Command> &lane = lanes[static_cast<std::uint8_t>(priority)];
+
+			if (lane.size() < maximumQueueSize)
+			{
+				Command command;
+				command.data.assign(data, data + length);
+				command.callback = callback;
+				command.sentTimestamp_ms = 0;
+				lane.push_back(std::move(command));
+
+				const std::uint32_t queueDepth = get_number_queued();
+				if (queueDepth > statistics.maximumQueueDepth)
+				{
+					statistics.maximumQueueDepth = queueDepth;
+				}
+				retVal = true;
+			}
+			else
+			{
+				statistics.numberRejected++;
+			}
+		}
+		return retVal;
+	}
+
+	void VirtualTerminalCommandPipeline::update(const SendFunction &sendFunction)
+	{
+		std::vector<Completion> completions;
+
+		{
+			const std::lock_guard<std::mutex> lock(pipelineMutex);
+
+			while ((!inFlightCommands.empty()) &&
+			       (SystemTiming::time_expired_ms(inFlightCommands.front().sentTimestamp_ms, responseTimeout_ms)))
+			{
+				completions.push_back({ inFlightCommands.front().callback, Result::Timeout, 0 });
+				inFlightCommands.pop_front();
+				statistics.numberTimedOut++;
+			}
+
+			bool sendFailed = false;
+			for (std::uint8_t i = 0; (i < static_cast<std::uint8_t>(Priority::NumberOfPriorities)) && (!sendFailed); i++)
+			{
+				while ((!lanes[i].empty()) && (!sendFailed))
+				{
+					if (inFlightCommands.size() >= maximumInFlight)
+					{
+						statistics.numberWindowFull++;
+						sendFailed = true;
+					}
+					else if (sendFunction(lanes[i].front().data.data(), static_cast<std::uint32_t>(lanes[i].front().data.size())))
+					{
+						lanes[i].front().sentTimestamp_ms = SystemTiming::get_timestamp_ms();
+						inFlightCommands.push_back(std::move(lanes[i].front()));
+						lanes[i].pop_front();
+						statistics.numberSent++;
+					}
+					else
+					{
+						// Keep the command at the front of its lane so commands aren't reordered
+						statistics.numberSendFailures++;
+						sendFailed = true;
+					}
+				}
+			}
+		}
+		call_completions(completions);
+	}
+
+	bool VirtualTerminalCommandPipeline::process_response(const std::uint8_t *data, std::uint32_t length)
+	{
+		bool retVal = false;
+		std::uint8_t errorCodeOffset = 0;
+		std::vector<Completion> completions;
+
+		if ((nullptr != data) &&
+		    (get_error_code_offset(data[0], errorCodeOffset)) &&
+		    (length > errorCodeOffset))
+		{
+			const std::lock_guard<std::mutex> lock(pipelineMutex);
+
+			for (auto command = inFlightCommands.begin(); command != inFlightCommands.end(); command++)
+			{
+				if ((data[0] == command->data[0]) &&
+				    ((GRAPHICS_CONTEXT_COMMAND != data[0]) ||
+				     ((command->data.size() > 3) && (data[3] == command->data[3]))))
+				{
+					const std::uint8_t errorCode = data[errorCodeOffset];
+					const std::uint32_t responseTime_ms = SystemTiming::get_time_elapsed_ms(command->sentTimestamp_ms);
+
+					if (responseTime_ms > statistics.maximumResponseTime_ms)
+					{
+						statistics.maximumResponseTime_ms = responseTime_ms;
+					}
+
+					if (0 == errorCode)
+					{
+						completions.push_back({ command->callback, Result::Success, errorCode });
+						statistics.numberSucceeded++;
+					}
+					else
+					{
+						completions.push_back({ command->callback, Result::VTError, errorCode });
+						statistics.numberVTErrors++;
+					}
+					inFlightCommands.erase(command);
+					retVal = true;
+					break;
+				}
+			}
+		}
+		call_completions(completions);
+		return retVal;
+	}
+
+	void VirtualTerminalCommandPipeline::abort_all()
+	{
+		std::vector<Completion> completions;
+
+		{
+			const std::lock_guard<std::mutex> lock(pipelineMutex);
+
+			for (const auto &command : inFlightCommands)
+			{
+				completions.push_back({ command.callback, Result::Aborted, 0 });
+			}
+			inFlightCommands.clear();
+
+			for (auto &lane : lanes)
+			{
+				for (const auto &command : lane)
+				{
+					completions.push_back({ command.callback, Result::Aborted, 0 });
+				}
+				lane.clear();
+			}
+			statistics.numberAborted += static_cast<std::uint32_t>(completions.size());
+		}
+		call_completions(completions);
+	}
+
+	void VirtualTerminalCommandPipeline::set_maximum_in_flight(std::uint8_t value)
+	{
+		const std::lock_guard<std::mutex> lock(pipelineMutex);
+		maximumInFlight = (0 != value) ? value : 1;
+	}
+
+	std::uint8_t VirtualTerminalCommandPipeline::get_maximum_in_flight() const
+	{
+		const std::lock_guard<std::mutex> lock(pipelineMutex);
+		return maximumInFlight;
+	}
+
+	void VirtualTerminalCommandPipeline::set_maximum_queue_size(std::uint32_t value)
+	{
+		const std::lock_guard<std::mutex> lock(pipelineMutex);
+		maximumQueueSize = value;
+	}
+
+	void VirtualTerminalCommandPipeline::set_response_timeout(std::uint32_t value_ms)
+	{
+		const std::lock_guard<std::mutex> lock(pipelineMutex);
+		responseTimeout_ms = value_ms;
+	}
+
+	VirtualTerminalCommandPipeline::Statistics VirtualTerminalCommandPipeline::get_statistics() const
+	{
+		const std::lock_guard<std::mutex> lock(pipelineMutex);
+		Statistics retVal = statistics;
+		retVal.numberQueued = get_number_queued();
+		retVal.numberInFlight = static_cast<std::uint32_t>(inFlightCommands.size());
+		return retVal;
+	}
+
+	bool VirtualTerminalCommandPipeline::get_error_code_offset(std::uint8_t functionCode, std::uint8_t &offset)
+	{
+		bool retVal = true;
+
+		// Where the error code is in each command's response, see ISO 11783-6 Annex F
+		switch (functionCode)
+		{
+			case 0xA3: // Control audio signal
+			case 0xA4: // Set audio volume
+			case 0xB2: // Delete object pool
+			{
+				offset = 1;
+			}
+			break;
+
+			case 0xBD: // Lock/unlock mask
+			case 0xBE: // Execute macro
+			{
+				offset = 2;
+			}
+			break;
+
+			case 0x92: // ESC
+			case 0xA6: // Change size
+			case 0xA8: // Change numeric value
+			case 0xA9: // Change end point
+			case 0xAA: // Change font attributes
+			case 0xAB: // Change line attributes
+			case 0xAC: // Change fill attributes
+			case 0xAD: // Change active mask
+			case 0xB5: // Change object label
+			case 0xB6: // Change polygon point
+			case 0xBA: // Select colour map
+			case 0xBC: // Execute extended macro
+			{
+				offset = 3;
+			}
+			break;
+
+			case 0xA0: // Hide/show object
+			case 0xA1: // Enable/disable object
+			case 0xA2: // Select input object
+			case 0xA7: // Change background colour
+			case 0xAF: // Change attribute
+			case 0xB0: // Change priority
+			case GRAPHICS_CONTEXT_COMMAND:
+			{
+				offset = 4;
+			}
+			break;
+
+			case 0xA5: // Change child location
+			case 0xAE: // Change soft key mask
+			case 0xB3: // Change string value
+			case 0xB4: // Change child position
+			{
+				offset = 5;
+			}
+			break;
+
+			case 0xB1: // Change list item
+			{
+				offset = 6;
+			}
+			break;
+
+			case 0xB7: // Change polygon scale
+			{
+				offset = 7;
+			}
+			break;
+
+			default:
+			{
+				retVal = false;
+			}
+			break;
+		}
+		return retVal;
+	}
+
+	void VirtualTerminalCommandPipeline::call_completions(const std::vector<Completion> &completions)
+	{
+		for (const auto &completion : completions)
+		{
+			if (nullptr != completion.callback)
+			{
+				completion.callback(completion.result, completion.errorCode);
+			}
+		}
+	}
+
+	std::uint32_t VirtualTerminalCommandPipeline::get_number_queued() const
+	{
+		std::uint32_t retVal = 0;
+
+		for (const auto &lane : lanes)
+		{
+			retVal += static_cast<std::uint32_t>(lane.size());
+		}
+		return retVal;
+	}
+
+	constexpr std::uint8_t VirtualTerminalCommandPipeline::DEFAULT_MAXIMUM_IN_FLIGHT;
+	constexpr std::uint32_t VirtualTerminalCommandPipeline::DEFAULT_MAXIMUM_QUEUE_SIZE;
+	constexpr std::uint32_t VirtualTerminalCommandPipeline::DEFAULT_RESPONSE_TIMEOUT_MS;
+} // namespace isobus
@@ -0,0 +1,921 @@
+//================================================================================================
+/// @file isobus_virtual_terminal_object_pool_index.cpp
+///
+/// @brief Implements an index of the objects in a serialized VT object pool
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#include "isobus/isobus/isobus_virtual_terminal_object_pool_index.hpp"
+#include "isobus/isobus/can_stack_logger.hpp"
+#include "isobus/utility/to_string.hpp"
+
+
+namespace isobus
+{
+	/// @brief Describes where the object IDs that an object type refers to are located
+	struct ObjectReferenceLayout
+	{
+		std::uint8_t singleReferenceOffsets[3]; ///< Offsets of up to 3 object ID attributes, 0 when unused
+		std::uint8_t listCountOffset; ///< Offset of the list's element count, 0 if the type has no list
+		std::uint8_t listStartOffset; ///< Offset of the list's first element
+		std::uint8_t listStride; ///< Size of each list element, which starts with an object ID
+	};
+
+	/// @brief Returns where the object references are in a type of object
+	/// @param[in] type The object type
+	/// @param[out] layout Where the references are
+	/// @returns `true` if the type has references we know how to check, otherwise `false`
+	static bool get_object_reference_layout(VirtualTerminalObjectType type, ObjectReferenceLayout &layout)
+	{
+		bool retVal = true;
+		layout = { { 0, 0, 0 }, 0, 0, 0 };
+
+		switch (type)
+		{
+			case VirtualTerminalObjectType::WorkingSet:
+			{
+				layout = { { 5, 0, 0 }, 7, 10, 6 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::DataMask:
+			{
+				layout = { { 4, 0, 0 }, 6, 8, 6 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::AlarmMask:
+			{
+				layout = { { 4, 0, 0 }, 8, 10, 6 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::Container:
+			{
+				layout = { { 0, 0, 0 }, 8, 10, 6 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::SoftKeyMask:
+			{
+				layout = { { 0, 0, 0 }, 4, 6, 2 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::Key:
+			{
+				layout = { { 0, 0, 0 }, 5, 7, 6 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::Button:
+			{
+				layout = { { 0, 0, 0 }, 11, 13, 6 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::InputBoolean:
+			{
+				layout = { { 6, 8, 0 }, 0, 0, 0 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::InputString:
+			{
+				layout = { { 8, 10, 13 }, 0, 0, 0 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::InputNumber:
+			case VirtualTerminalObjectType::OutputString:
+			case VirtualTerminalObjectType::OutputNumber:
+			{
+				layout = { { 8, 11, 0 }, 0, 0, 0 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::InputList:
+			{
+				layout = { { 7, 0, 0 }, 10, 13, 2 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputList:
+			{
+				layout = { { 7, 0, 0 }, 10, 12, 2 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputLine:
+			case VirtualTerminalObjectType::ObjectPointer:
+			{
+				layout = { { 3, 0, 0 }, 0, 0, 0 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputRectangle:
+			{
+				layout = { { 3, 10, 0 }, 0, 0, 0 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputEllipse:
+			{
+				layout = { { 3, 12, 0 }, 0, 0, 0 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputPolygon:
+			{
+				layout = { { 7, 9, 0 }, 0, 0, 0 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputMeter:
+			{
+				layout = { { 16, 0, 0 }, 0, 0, 0 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputLinearBarGraph:
+			{
+				layout = { { 15, 19, 0 }, 0, 0, 0 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputArchedBarGraph:
+			{
+				layout = { { 18, 22, 0 }, 0, 0, 0 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::FillAttributes:
+			{
+				layout = { { 5, 0, 0 }, 0, 0, 0 };
+			}
+			break;
+
+			case VirtualTerminalObjectType::KeyGroup:
+			{
+				layout = { { 4, 6, 0 }, 8, 10, 2 };
+			}
+			break;
+
+			default:
+			{
+				retVal = false;
+			}
+			break;
+		}
+		return retVal;
+	}
+
+	VirtualTerminalObjectPoolIndex::VirtualTerminalObjectPoolIndex() :
+	  poolData(nullptr),
+	  poolSize(0)
+	{
+	}
+
+	bool VirtualTerminalObjectPoolIndex::build(const std::uint8_t *data, std::uint32_t size)
+	{
+		bool retVal = true;
+		std::uint32_t offset = 0;
+
+		clear();
+
+		if (nullptr == data)
+		{
+			retVal = false;
+		}
+
+		while (retVal && (offset < size))
+		{
+			const std::uint32_t objectLength = get_object_length(&data[offset], size - offset);
+
+			if ((0 == objectLength) || (objectLength > (size - offset)))
+			{
+				CANStackLogger::warn("[VT]: Unable to index object pool, object at offset " +
+				                      isobus::to_string(offset) +
+				                      ((size - offset) > 2 ? (" with type " + isobus::to_string(static_cast<int>(data[offset + 2]))) : std::string("")) +
+				                      " has an unknown length or overruns the pool");
+				retVal = false;
+			}
+			else
+			{
+				ObjectInfo info;
+				info.offset = offset;
+				info.length = objectLength;
+				info.objectID = static_cast<std::uint16_t>(static_cast<std::uint16_t>(data[offset]) | (static_cast<std::uint16_t>(data[offset + 1]) << 8));
+				info.type = static_cast<VirtualTerminalObjectType>(data[offset + 2]);
+
+				if (objectPositions.end() != objectPositions.find(info.objectID))
+				{
+					CANStackLogger::warn("[VT]: Unable to index object pool, object ID " + isobus::to_string(static_cast<int>(info.objectID)) + " is used more than once");
+					retVal = false;
+				}
+				else
+				{
+					objectPositions[info.objectID] = objects.size();
+					objects.push_back(info);
+					offset += objectLength;
+				}
+			}
+		}
+
+		if (retVal && !objects.empty())
+		{
+			poolData = data;
+			poolSize = size;
+		}
+		else
+		{
+			clear();
+			retVal = false;
+		}
+		return retVal;
+	}
+
+	void VirtualTerminalObjectPoolIndex::clear()
+	{
+		poolData = nullptr;
+		poolSize = 0;
+		objects.clear();
+		objectPositions.clear();
+	}
+
+	bool VirtualTerminalObjectPoolIndex::get_is_valid() const
+	{
+		return (nullptr != poolData);
+	}
+
+	std::uint32_t VirtualTerminalObjectPoolIndex::get_pool_size() const
+	{
+		return poolSize;
+	}
+
+	std::size_t VirtualTerminalObjectPoolIndex::get_number_objects() const
+	{
+		return objects.size();
+	}
+
+	const VirtualTerminalObjectPoolIndex::ObjectInfo *VirtualTerminalObjectPoolIndex::get_object_at_position(std::size_t position) const
+	{
+		const ObjectInfo *retVal = nullptr;
+
+		if (position < objects.size())
+		{
+			retVal = &objects[position];
+		}
+		return retVal;
+	}
+
+	bool VirtualTerminalObjectPoolIndex::get_object(std::uint16_t objectID, ObjectInfo &info) const
+	{
+		bool retVal = false;
+		auto position = objectPositions.find(objectID);
+
+		if (objectPositions.end() != position)
+		{
+			info = objects[position->second];
+			retVal = true;
+		}
+		return retVal;
+	}
+
+	bool VirtualTerminalObjectPoolIndex::get_object_exists(std::uint16_t objectID) const
+	{
+		return (objectPositions.end() != objectPositions.find(objectID));
+	}
+
+	const std::uint8_t *VirtualTerminalObjectPoolIndex::get_object_data(std::uint16_t objectID) const
+	{
+		const std::uint8_t *retVal = nullptr;
+		auto position = objectPositions.find(objectID);
+
+		if (objectPositions.end() != position)
+		{
+			retVal = &poolData[objects[position->second].offset];
+		}
+		return retVal;
+	}
+
+	bool VirtualTerminalObjectPoolIndex::get_uint8_attribute(std::uint16_t objectID, std::uint32_t attributeOffset, std::uint8_t &value) const
+	{
+		bool retVal = false;
+		auto position = objectPositions.find(objectID);
+
+		if ((objectPositions.end() != position) &&
+		    (attributeOffset < objects[position->second].length))
+		{
+			value = poolData[objects[position->second].offset + attributeOffset];
+			retVal = true;
+		}
+		return retVal;
+	}
+
+	bool VirtualTerminalObjectPoolIndex::get_uint16_attribute(std::uint16_t objectID, std::uint32_t attributeOffset, std::uint16_t &value) const
+	{
+		bool retVal = false;
+		auto position = objectPositions.find(objectID);
+
+		if ((objectPositions.end() != position) &&
+		    (attributeOffset < objects[position->second].length) &&
+		    (objects[position->second].length - attributeOffset >= sizeof(std::uint16_t)))
+		{
+			const std::uint8_t *attribute = &poolData[objects[position->second].offset + attributeOffset];
+			value = static_cast<std::uint16_t>(static_cast<std::uint16_t>(attribute[0]) | (static_cast<std::uint16_t>(attribute[1]) << 8));
+			retVal = true;
+		}
+		return retVal;
+	}
+
+	bool VirtualTerminalObjectPoolIndex::get_uint32_attribute(std::uint16_t objectID, std::uint32_t attributeOffset, std::uint32_t &value) const
+	{
+		bool retVal = false;
+		auto position = objectPositions.find(objectID);
+
+		if ((objectPositions.end() != position) &&
+		    (attributeOffset < objects[position->second].length) &&
+		    (objects[position->second].length - attributeOffset >= sizeof(std::uint32_t)))
+		{
+			const std::uint8_t *attribute = &poolData[objects[position->second].offset + attributeOffset];
+			value = (static_cast<std::uint32_t>(attribute[0]) |
+			         (static_cast<std::uint32_t>(attribute[1]) << 8) |
+			         (static_cast<std::uint32_t>(attribute[2]) << 16) |
+			         (static_cast<std::uint32_t>(attribute[3]) << 24));
+			retVal = true;
+		}
+		return retVal;
+	}
+
+	bool VirtualTerminalObjectPoolIndex::get_referenced_object_ids(std::uint16_t objectID, std::vector<std::uint16_t> &references) const
+	{
+		bool retVal = false;
+		auto position = objectPositions.find(objectID);
+
+		references.clear();
+
+		if (objectPositions.end() != position)
+		{
+			const ObjectInfo &info = objects[position->second];
+			ObjectReferenceLayout layout;
+			std::uint16_t referencedID = NULL_OBJECT_ID;
+			retVal = true;
+
+			if (get_object_reference_layout(info.type, layout))
+			{
+				for (const auto &referenceOffset : layout.singleReferenceOffsets)
+				{
+					if ((0 != referenceOffset) &&
+					    (get_uint16_attribute(objectID, referenceOffset, referencedID)))
+					{
+						references.push_back(referencedID);
+					}
+				}
+
+				std::uint8_t numberListElements = 0;
+				if ((0 != layout.listCountOffset) &&
+				    (get_uint8_attribute(objectID, layout.listCountOffset, numberListElements)))
+				{
+					for (std::uint_fast16_t i = 0; i < numberListElements; i++)
+					{
+						if (get_uint16_attribute(objectID, layout.listStartOffset + (i * layout.listStride), referencedID))
+						{
+							references.push_back(referencedID);
+						}
+					}
+				}
+			}
+		}
+		return retVal;
+	}
+
+	std::vector<VirtualTerminalObjectPoolIndex::InvalidReference> VirtualTerminalObjectPoolIndex::get_invalid_references() const
+	{
+		std::vector<InvalidReference> retVal;
+		std::vector<std::uint16_t> references;
+
+		for (const auto &object : objects)
+		{
+			get_referenced_object_ids(object.objectID, references);
+
+			for (const auto &referencedID : references)
+			{
+				if ((NULL_OBJECT_ID != referencedID) &&
+				    (!get_object_exists(referencedID)))
+				{
+					retVal.push_back({ object.objectID, referencedID });
+				}
+			}
+		}
+		return retVal;
+	}
+
+	std::uint32_t VirtualTerminalObjectPoolIndex::get_minimum_object_length(VirtualTerminalObjectType type)
+	{
+		std::uint32_t retVal = 0;
+
+		switch (type)
+		{
+			case VirtualTerminalObjectType::WorkingSet:
+			{
+				retVal = 10;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputList:
+			case VirtualTerminalObjectType::ExternalReferenceNAME:
+			case VirtualTerminalObjectType::ObjectLabelRefrenceList:
+			{
+				retVal = 12;
+			}
+			break;
+
+			case VirtualTerminalObjectType::AlarmMask:
+			case VirtualTerminalObjectType::Container:
+			case VirtualTerminalObjectType::KeyGroup:
+			{
+				retVal = 10;
+			}
+			break;
+
+			case VirtualTerminalObjectType::ExternalObjectPointer:
+			{
+				retVal = 9;
+			}
+			break;
+
+			case VirtualTerminalObjectType::SoftKeyMask:
+			case VirtualTerminalObjectType::ColourMap:
+			case VirtualTerminalObjectType::AuxiliaryFunctionType1:
+			case VirtualTerminalObjectType::AuxiliaryFunctionType2:
+			case VirtualTerminalObjectType::AuxiliaryInputType2:
+			case VirtualTerminalObjectType::AuxiliaryControlDesignatorType2:
+			{
+				retVal = 6;
+			}
+			break;
+
+			case VirtualTerminalObjectType::Key:
+			case VirtualTerminalObjectType::NumberVariable:
+			case VirtualTerminalObjectType::InputAttributes:
+			case VirtualTerminalObjectType::AuxiliaryInputType1:
+			{
+				retVal = 7;
+			}
+			break;
+
+			case VirtualTerminalObjectType::Button:
+			case VirtualTerminalObjectType::InputBoolean:
+			case VirtualTerminalObjectType::OutputRectangle:
+			case VirtualTerminalObjectType::InputList:
+			case VirtualTerminalObjectType::ExternalObjectDefinition:
+			{
+				retVal = 13;
+			}
+			break;
+
+			case VirtualTerminalObjectType::InputString:
+			{
+				retVal = 19;
+			}
+			break;
+
+			case VirtualTerminalObjectType::InputNumber:
+			{
+				retVal = 38;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputString:
+			{
+				retVal = 17;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputNumber:
+			{
+				retVal = 29;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputLine:
+			{
+				retVal = 11;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputEllipse:
+			{
+				retVal = 15;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputPolygon:
+			{
+				retVal = 14;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputMeter:
+			{
+				retVal = 21;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputLinearBarGraph:
+			{
+				retVal = 24;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputArchedBarGraph:
+			{
+				retVal = 27;
+			}
+			break;
+
+			case VirtualTerminalObjectType::PictureGraphic:
+			case VirtualTerminalObjectType::Animation:
+			case VirtualTerminalObjectType::WindowMask:
+			{
+				retVal = 17;
+			}
+			break;
+
+			case VirtualTerminalObjectType::StringVariable:
+			case VirtualTerminalObjectType::ExtendedInputAttributes:
+			case VirtualTerminalObjectType::ObjectPointer:
+			case VirtualTerminalObjectType::Macro:
+			{
+				retVal = 5;
+			}
+			break;
+
+			case VirtualTerminalObjectType::FontAttributes:
+			case VirtualTerminalObjectType::LineAttributes:
+			case VirtualTerminalObjectType::FillAttributes:
+			case VirtualTerminalObjectType::DataMask:
+			{
+				retVal = 8;
+			}
+			break;
+
+			case VirtualTerminalObjectType::GraphicsContext:
+			{
+				retVal = 34;
+			}
+			break;
+
+			default:
+			{
+				// Proprietary or reserved object, we can't know how long it is
+			}
+			break;
+		}
+		return retVal;
+	}
+
+	std::uint32_t VirtualTerminalObjectPoolIndex::get_object_length(const std::uint8_t *buffer, std::uint32_t bytesAvailable)
+	{
+		auto currentObjectType = VirtualTerminalObjectType::Reserved;
+		std::uint32_t retVal = 0;
+
+		if ((nullptr != buffer) && (bytesAvailable >= 3))
+		{
+			currentObjectType = static_cast<VirtualTerminalObjectType>(buffer[2]);
+			retVal = get_minimum_object_length(currentObjectType);
+		}
+
+		if (retVal > bytesAvailable)
+		{
+			// The fixed length attributes aren't all there, so the variable length ones can't be found
+			retVal = 0;
+		}
+
+		switch ((0 != retVal) ? currentObjectType : VirtualTerminalObjectType::Reserved)
+		{
+			case VirtualTerminalObjectType::WorkingSet:
+			{
+				const std::uint32_t sizeOfChildObjects = (buffer[7] * 6);
+				const std::uint32_t sizeOfMacros = (buffer[8] * 2);
+				const std::uint32_t sizeOfLanguageCodes = (buffer[9] * 2);
+				retVal += (sizeOfLanguageCodes + sizeOfChildObjects + sizeOfMacros);
+			}
+			break;
+
+			case VirtualTerminalObjectType::DataMask:
+			{
+				const std::uint32_t sizeOfChildObjects = (buffer[6] * 6);
+				const std::uint32_t sizeOfMacros = (buffer[7] * 2);
+				retVal += (sizeOfChildObjects + sizeOfMacros);
+			}
+			break;
+
+			case VirtualTerminalObjectType::AlarmMask:
+			case VirtualTerminalObjectType::Container:
+			{
+				const std::uint32_t sizeOfChildObjects = (buffer[8] * 6);
+				const std::uint32_t sizeOfMacros = (buffer[9] * 2);
+				retVal += (sizeOfChildObjects + sizeOfMacros);
+			}
+			break;
+
+			case VirtualTerminalObjectType::SoftKeyMask:
+			{
+				const std::uint32_t sizeOfChildObjects = (buffer[4] * 2);
+				const std::uint32_t sizeOfMacros = (buffer[5] * 2);
+				retVal += (sizeOfChildObjects + sizeOfMacros);
+			}
+			break;
+
+			case VirtualTerminalObjectType::Key:
+			{
+				const std::uint32_t sizeOfChildObjects = (buffer[5] * 6);
+				const std::uint32_t sizeOfMacros = (buffer[6] * 2);
+				retVal += (sizeOfChildObjects + sizeOfMacros);
+			}
+			break;
+
+			case VirtualTerminalObjectType::Button:
+			{
+				const std::uint32_t sizeOfChildObjects = (buffer[11] * 6);
+				const std::uint32_t sizeOfMacros = (buffer[12] * 2);
+				retVal += (sizeOfChildObjects + sizeOfMacros);
+			}
+			break;
+
+			case VirtualTerminalObjectType::InputBoolean:
+			{
+				const std::uint32_t sizeOfMacros = (buffer[12] * 2);
+				retVal += sizeOfMacros;
+			}
+			break;
+
+			case VirtualTerminalObjectType::InputString:
+			{
+				const std::uint32_t sizeOfValue = buffer[16];
+
+				if ((18 + sizeOfValue) < bytesAvailable)
+				{
+					const std::uint32_t sizeOfMacros = (buffer[18 + sizeOfValue] * 2);
+					retVal += (sizeOfValue + sizeOfMacros);
+				}
+				else
+				{
+					retVal = 0;
+				}
+			}
+			break;
+
+			case VirtualTerminalObjectType::InputNumber:
+			{
+				const std::uint32_t sizeOfMacros = (buffer[37] * 2);
+				retVal += sizeOfMacros;
+			}
+			break;
+
+			case VirtualTerminalObjectType::InputList:
+			{
+				const std::uint32_t sizeOfMacros = (buffer[12] * 2);
+				const std::uint32_t sizeOfListObjectIDs = (buffer[10] * 2);
+				retVal += (sizeOfMacros + sizeOfListObjectIDs);
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputString:
+			{
+				const std::uint32_t sizeOfValue = (static_cast<uint16_t>(buffer[14]) | static_cast<uint16_t>(buffer[15] << 8));
+
+				if ((16 + sizeOfValue) < bytesAvailable)
+				{
+					const std::uint32_t sizeOfMacros = (buffer[16 + sizeOfValue] * 2);
+					retVal += (sizeOfMacros + sizeOfValue);
+				}
+				else
+				{
+					retVal = 0;
+				}
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputNumber:
+			{
+				const std::uint32_t sizeOfMacros = (buffer[28] * 2);
+				retVal += sizeOfMacros;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputList:
+			{
+				const std::uint32_t sizeOfMacros = (buffer[11] * 2);
+				const std::uint32_t sizeOfListObjectIDs = (buffer[10] * 2);
+				retVal += (sizeOfMacros + sizeOfListObjectIDs);
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputLine:
+			{
+				const std::uint32_t sizeOfMacros = (buffer[10] * 2);
+				retVal += sizeOfMacros;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputRectangle:
+			{
+				const std::uint32_t sizeOfMacros = (buffer[12] * 2);
+				retVal += sizeOfMacros;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputEllipse:
+			{
+				const std::uint32_t sizeOfMacros = (buffer[14] * 2);
+				retVal += sizeOfMacros;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputPolygon:
+			{
+				const std::uint32_t sizeOfPoints = (buffer[12] * 4);
+				const std::uint32_t sizeOfMacros = (buffer[13] * 2);
+				retVal += (sizeOfMacros + sizeOfPoints);
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputMeter:
+			{
+				const std::uint32_t sizeOfMacros = (buffer[20] * 2);
+				retVal += sizeOfMacros;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputLinearBarGraph:
+			{
+				const std::uint32_t sizeOfMacros = (buffer[23] * 2);
+				retVal += sizeOfMacros;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputArchedBarGraph:
+			{
+				const std::uint32_t sizeOfMacros = (buffer[26] * 2);
+				retVal += sizeOfMacros;
+			}
+			break;
+
+			case VirtualTerminalObjectType::PictureGraphic:
+			{
+				const std::uint32_t sizeOfMacros = (buffer[16] * 2);
+				const std::uint32_t sizeOfRawData = (static_cast<std::uint32_t>(buffer[12]) |
+				                                     (static_cast<std::uint32_t>(buffer[13]) << 8) |
+				                                     (static_cast<std::uint32_t>(buffer[14]) << 16) |
+				                                     (static_cast<std::uint32_t>(buffer[15]) << 24));
+				retVal += (sizeOfRawData + sizeOfMacros);
+			}
+			break;
+
+			case VirtualTerminalObjectType::ObjectPointer:
+			case VirtualTerminalObjectType::NumberVariable:
+			case VirtualTerminalObjectType::GraphicsContext:
+			case VirtualTerminalObjectType::ExternalReferenceNAME:
+			case VirtualTerminalObjectType::ExternalObjectPointer:
+			case VirtualTerminalObjectType::AuxiliaryControlDesignatorType2:
+			{
+				// No additional length
+			}
+			break;
+
+			case VirtualTerminalObjectType::StringVariable:
+			{
+				const std::uint32_t sizeOfValue = (static_cast<uint16_t>(buffer[3]) | static_cast<uint16_t>(buffer[4]) << 8);
+				retVal += sizeOfValue;
+			}
+			break;
+
+			case VirtualTerminalObjectType::FontAttributes:
+			case VirtualTerminalObjectType::LineAttributes:
+			case VirtualTerminalObjectType::FillAttributes:
+			{
+				const std::uint32_t sizeOfMacros = (buffer[7] * 2);
+				retVal += sizeOfMacros;
+			}
+			break;
+
+			case VirtualTerminalObjectType::InputAttributes:
+			{
+				const std::uint32_t sizeOfValidationString = buffer[4];
+
+				if ((5 + sizeOfValidationString) < bytesAvailable)
+				{
+					const std::uint32_t sizeOfMacros = (buffer[5 + sizeOfValidationString] * 2);
+					retVal += (sizeOfMacros + sizeOfValidationString);
+				}
+				else
+				{
+					retVal = 0;
+				}
+			}
+			break;
+
+			case VirtualTerminalObjectType::ExtendedInputAttributes:
+			{
+				// Each code plane is its number, then a count of character ranges, then 4 bytes per range
+				const std::uint32_t numberOfCodePlanes = buffer[4];
+
+				for (std::uint32_t i = 0; (i < numberOfCodePlanes) && (0 != retVal); i++)
+				{
+					if ((retVal + 1) < bytesAvailable)
+					{
+						retVal += (2 + (buffer[retVal + 1] * 4));
+					}
+					else
+					{
+						retVal = 0;
+					}
+				}
+			}
+			break;
+
+			case VirtualTerminalObjectType::Macro:
+			{
+				const std::uint32_t numberOfMacroBytes = (static_cast<std::uint16_t>(buffer[3]) | (static_cast<std::uint16_t>(buffer[4]) << 8));
+				retVal += numberOfMacroBytes;
+			}
+			break;
+
+			case VirtualTerminalObjectType::ColourMap:
+			{
+				const std::uint32_t numberIndexes = (static_cast<std::uint16_t>(buffer[3]) | (static_cast<std::uint16_t>(buffer[4]) << 8));
+				retVal += numberIndexes;
+			}
+			break;
+
+			case VirtualTerminalObjectType::WindowMask:
+			{
+				const std::uint32_t sizeOfReferences = (buffer[14] * 2);
+				const std::uint32_t numberObjects = (buffer[15] * 6);
+				const std::uint32_t sizeOfMacros = (buffer[16] * 2);
+				retVal += (sizeOfMacros + numberObjects + sizeOfReferences);
+			}
+			break;
+
+			case VirtualTerminalObjectType::KeyGroup:
+			{
+				const std::uint32_t numberObjects = (buffer[8] * 2);
+				const std::uint32_t sizeOfMacros = (buffer[9] * 2);
+				retVal += (sizeOfMacros + numberObjects);
+			}
+			break;
+
+			case VirtualTerminalObjectType::ObjectLabelRefrenceList:
+			{
+				const std::uint32_t sizeOfLabeledObjects = ((static_cast<uint16_t>(buffer[4]) | static_cast<uint16_t>(buffer[5]) << 8) * 7);
+				retVal += sizeOfLabeledObjects;
+			}
+			break;
+
+			case VirtualTerminalObjectType::ExternalObjectDefinition:
+			{
+				const std::uint32_t sizeOfObjects = (buffer[12] * 2);
+				retVal += sizeOfObjects;
+			}
+			break;
+
+			case VirtualTerminalObjectType::Animation:
+			{
+				const std::uint32_t sizeOfObjects = (buffer[15] * 6);
+				const std::uint32_t sizeOfMacros = (buffer[16] * 2);
+				retVal += (sizeOfMacros + sizeOfObjects);
+			}
+			break;
+
+			case VirtualTerminalObjectType::AuxiliaryFunctionType1:
+			case VirtualTerminalObjectType::AuxiliaryFunctionType2:
+			case VirtualTerminalObjectType::AuxiliaryInputType2:
+			{
+				const std::uint32_t sizeOfObjects = (buffer[5] * 6);
+				retVal += sizeOfObjects;
+			}
+			break;
+
+			case VirtualTerminalObjectType::AuxiliaryInputType1:
+			{
+				const std::uint32_t sizeOfObjects = (buffer[6] * 6);
+				retVal += sizeOfObjects;
+			}
+			break;
+
+			default:
+			{
+				retVal = 0;
+			}
+			break;
+		}
+		return retVal;
+	}
+
+	constexpr std::uint16_t VirtualTerminalObjectPoolIndex::NULL_OBJECT_ID;
+} // namespace isobus
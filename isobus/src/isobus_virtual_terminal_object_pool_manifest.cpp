@@ -0,0 +1,257 @@
+//================================================================================================
+/// @file isobus_virtual_terminal_object_pool_manifest.cpp
+///
+/// @brief Implements a list of the objects in a VT object pool and a hash of each one
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#include "isobus/isobus/isobus_virtual_terminal_object_pool_manifest.hpp"
+#include "isobus/isobus/isobus_virtual_terminal_object_pool_index.hpp"
+#include "isobus/utility/replace_file.hpp"
+#include "isobus/utility/xxhash.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace isobus
+{
+	VirtualTerminalObjectPoolManifest::VirtualTerminalObjectPoolManifest()
+	{
+	}
+
+	void VirtualTerminalObjectPoolManifest::clear()
+	{
+		objectHashes.clear();
+		versionLabel.clear();
+	}
+
+	void VirtualTerminalObjectPoolManifest::set_version_label(const std::string &label)
+	{
+		versionLabel = label;
+	}
+
+	std::string VirtualTerminalObjectPoolManifest::get_version_label() const
+	{
+		return versionLabel;
+	}
+
+	void VirtualTerminalObjectPoolManifest::add_object(std::uint16_t objectID, std::uint64_t hash)
+	{
+		objectHashes[objectID] = hash;
+	}
+
+	bool VirtualTerminalObjectPoolManifest::add_object_pool(const std::uint8_t *poolData, std::uint32_t poolSize)
+	{
+		VirtualTerminalObjectPoolIndex index;
+		bool retVal = index.build(poolData, poolSize);
+
+		if (retVal)
+		{
+			for (std::size_t i = 0; i < index.get_number_objects(); i++)
+			{
+				const VirtualTerminalObjectPoolIndex::ObjectInfo *object = index.get_object_at_position(i);
+
+				if (nullptr != object)
+				{
+					add_object(object->objectID, hash_object(&poolData[object->offset], object->length));
+				}
+			}
+		}
+		return retVal;
+	}
+
+	bool VirtualTerminalObjectPoolManifest::get_object_hash(std::uint16_t objectID, std::uint64_t &hash) const
+	{
+		bool retVal = false;
+		auto object = objectHashes.find(objectID);
+
+		if (objectHashes.end() != object)
+		{
+			hash = object->second;
+			retVal = true;
+		}
+		return retVal;
+	}
+
+	std::size_t VirtualTerminalObjectPoolManifest::get_number_objects() const
+	{
+		return objectHashes.size();
+	}
+
+	bool VirtualTerminalObjectPoolManifest::get_changed_objects(const std::uint8_t *poolData,
+	                                                            std::uint32_t poolSize,
+	                                                            std::vector<std::uint8_t> &changedObjects,
+	                                                            std::uint32_t &numberChangedObjects) const
+	{
+		VirtualTerminalObjectPoolIndex index;
+		bool retVal = index.build(poolData, poolSize);
+
+		numberChangedObjects = 0;
+
+		if (retVal)
+		{
+			for (std::size_t i = 0; i < index.get_number_objects(); i++)
+			{
+				const VirtualTerminalObjectPoolIndex::ObjectInfo *object = index.get_object_at_position(i);
+				std::uint64_t previousHash = 0;
+
+				if ((nullptr != object) &&
+				    ((!get_object_hash(object->objectID, previousHash)) ||
+				     (hash_object(&poolData[object->offset], object->length) != previousHash)))
+				{
+					const std::uint8_t *objectData = &poolData[object->offset];
+					changedObjects.insert(changedObjects.end(), objectData, objectData + object->length);
+					numberChangedObjects++;
+				}
+			}
+		}
+		return retVal;
+	}
+
+	bool VirtualTerminalObjectPoolManifest::save(const std::string &filename) const
+	{
+		bool retVal = false;
+		const std::string temporaryFilename = filename + ".tmp";
+		std::vector<std::uint8_t> fileData;
+		const std::uint32_t numberObjects = static_cast<std::uint32_t>(objectHashes.size());
+
+		fileData.reserve(HEADER_SIZE + 1 + versionLabel.size() + 4 + (ENTRY_SIZE * objectHashes.size()) + 8);
+		for (std::uint_fast8_t i = 0; i < 4; i++)
+		{
+			fileData.push_back(static_cast<std::uint8_t>(FILE_MAGIC >> (8 * i)));
+		}
+		fileData.push_back(static_cast<std::uint8_t>(FILE_VERSION & 0xFF));
+		fileData.push_back(static_cast<std::uint8_t>(FILE_VERSION >> 8));
+		fileData.push_back(0xFF);
+		fileData.push_back(0xFF);
+
+		fileData.push_back(static_cast<std::uint8_t>(versionLabel.size() & 0xFF));
+		fileData.insert(fileData.end(), versionLabel.begin(), versionLabel.begin() + (versionLabel.size() & 0xFF));
+
+		for (std::uint_fast8_t i = 0; i < 4; i++)
+		{
+			fileData.push_back(static_cast<std::uint8_t>(numberObjects >> (8 * i)));
+		}
+		for (const auto &object : objectHashes)
+		{
+			fileData.push_back(static_cast<std::uint8_t>(object.first & 0xFF));
+			fileData.push_back(static_cast<std::uint8_t>(object.first >> 8));
+			for (std::uint_fast8_t i = 0; i < 8; i++)
+			{
+				fileData.push_back(static_cast<std::uint8_t>(object.second >> (8 * i)));
+			}
+		}
+
+		// Ends with a hash of everything before it, so a partly written or corrupted file isn't trusted
+		const std::uint64_t fileHash = XXHash64::hash(fileData.data(), fileData.size());
+		for (std::uint_fast8_t i = 0; i < 8; i++)
+		{
+			fileData.push_back(static_cast<std::uint8_t>(fileHash >> (8 * i)));
+		}
+
+		{
+			std::ofstream file(temporaryFilename, std::ios::binary | std::ios::trunc);
+
+			if (file.is_open())
+			{
+				file.write(reinterpret_cast<const char *>(fileData.data()), static_cast<std::streamsize>(fileData.size()));
+				file.flush();
+				retVal = file.good();
+			}
+		}
+
+		if (retVal)
+		{
+			retVal = replace_file(temporaryFilename, filename);
+		}
+
+		if (!retVal)
+		{
+			std::remove(temporaryFilename.c_str());
+		}
+		return retVal;
+	}
+
+	bool VirtualTerminalObjectPoolManifest::load(const std::string &filename)
+	{
+		bool retVal = false;
+		std::ifstream file(filename, std::ios::binary);
+
+		clear();
+
+		if (file.is_open())
+		{
+			const std::vector<std::uint8_t> fileData((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+			std::size_t position = HEADER_SIZE;
+
+			if ((fileData.size() >= (HEADER_SIZE + 1 + 4 + 8)) &&
+			    (FILE_MAGIC == (fileData[0] | (fileData[1] << 8) | (fileData[2] << 16) | (static_cast<std::uint32_t>(fileData[3]) << 24))) &&
+			    (FILE_VERSION == (fileData[4] | (fileData[5] << 8))))
+			{
+				const std::size_t hashPosition = fileData.size() - 8;
+				std::uint64_t expectedHash = 0;
+
+				for (std::uint_fast8_t i = 0; i < 8; i++)
+				{
+					expectedHash |= (static_cast<std::uint64_t>(fileData[hashPosition + i]) << (8 * i));
+				}
+
+				if (XXHash64::hash(fileData.data(), hashPosition) == expectedHash)
+				{
+					const std::uint8_t labelLength = fileData[position];
+					position++;
+
+					if ((position + labelLength + 4) <= hashPosition)
+					{
+						const std::string label(fileData.begin() + position, fileData.begin() + position + labelLength);
+						std::uint32_t numberObjects = 0;
+
+						position += labelLength;
+						for (std::uint_fast8_t i = 0; i < 4; i++)
+						{
+							numberObjects |= (static_cast<std::uint32_t>(fileData[position + i]) << (8 * i));
+						}
+						position += 4;
+
+						if ((position + (static_cast<std::size_t>(numberObjects) * ENTRY_SIZE)) == hashPosition)
+						{
+							for (std::uint32_t i = 0; i < numberObjects; i++)
+							{
+								std::uint64_t hash = 0;
+								const std::uint16_t objectID = static_cast<std::uint16_t>(fileData[position] | (fileData[position + 1] << 8));
+
+								for (std::uint_fast8_t j = 0; j < 8; j++)
+								{
+									hash |= (static_cast<std::uint64_t>(fileData[position + 2 + j]) << (8 * j));
+								}
+								add_object(objectID, hash);
+								position += ENTRY_SIZE;
+							}
+							versionLabel = label;
+							retVal = true;
+						}
+					}
+				}
+			}
+		}
+
+		if (!retVal)
+		{
+			clear();
+		}
+		return retVal;
+	}
+
+	std::uint64_t VirtualTerminalObjectPoolManifest::hash_object(const std::uint8_t *objectData, std::uint32_t length)
+	{
+		return XXHash64::hash(objectData, length);
+	}
+
+	constexpr std::uint32_t VirtualTerminalObjectPoolManifest::FILE_MAGIC;
+	constexpr std::uint16_t VirtualTerminalObjectPoolManifest::FILE_VERSION;
+	constexpr std::uint32_t VirtualTerminalObjectPoolManifest::HEADER_SIZE;
+	constexpr std::uint32_t VirtualTerminalObjectPoolManifest::ENTRY_SIZE;
+} // namespace isobus
@@ -0,0 +1,298 @@
+//================================================================================================
+/// @file isobus_virtual_terminal_scaled_pool_cache.cpp
+///
+/// @brief Implements a cache of auto-scaled VT object pools
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#include "isobus/isobus/isobus_virtual_terminal_scaled_pool_cache.hpp"
+#include "isobus/isobus/can_stack_logger.hpp"
+#include "isobus/utility/replace_file.hpp"
+#include "isobus/utility/xxhash.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace isobus
+{
+	bool VirtualTerminalScaledPoolCache::Key::operator==(const Key &other) const
+	{
+		return ((poolHash == other.poolHash) &&
+		        (poolSize == other.poolSize) &&
+		        (originalDataMaskDimension == other.originalDataMaskDimension) &&
+		        (originalSoftKeyDesignatorHeight == other.originalSoftKeyDesignatorHeight) &&
+		        (dataMaskDimension == other.dataMaskDimension) &&
+		        (softKeyDesignatorWidth == other.softKeyDesignatorWidth) &&
+		        (smallFontSizes == other.smallFontSizes) &&
+		        (largeFontSizes == other.largeFontSizes));
+	}
+
+	std::size_t VirtualTerminalScaledPoolCache::KeyHasher::operator()(const Key &key) const
+	{
+		std::uint8_t serializedKey[KEY_SIZE];
+		serialize_key(key, serializedKey);
+		return static_cast<std::size_t>(hash_pool(serializedKey, KEY_SIZE));
+	}
+
+	VirtualTerminalScaledPoolCache::VirtualTerminalScaledPoolCache(std::size_t maximumEntries) :
+	  maximumEntries(maximumEntries),
+	  numberHits(0),
+	  numberMisses(0)
+	{
+	}
+
+	void VirtualTerminalScaledPoolCache::set_directory(const std::string &path)
+	{
+		const std::lock_guard<std::mutex> lock(cacheMutex);
+		directory = path;
+	}
+
+	std::string VirtualTerminalScaledPoolCache::get_directory() const
+	{
+		const std::lock_guard<std::mutex> lock(cacheMutex);
+		return directory;
+	}
+
+	std::shared_ptr<const std::vector<std::uint8_t>> VirtualTerminalScaledPoolCache::find(const Key &key)
+	{
+		std::shared_ptr<const std::vector<std::uint8_t>> retVal;
+		std::string cacheDirectory;
+
+		{
+			const std::lock_guard<std::mutex> lock(cacheMutex);
+			auto entry = entries.find(key);
+
+			if (entries.end() != entry)
+			{
+				retVal = entry->second;
+				numberHits++;
+			}
+			else
+			{
+				cacheDirectory = directory;
+			}
+		}
+
+		if (!cacheDirectory.empty())
+		{
+			// Read the file without holding the lock, so other pools can be looked up meanwhile
+			auto scaledPool = std::make_shared<std::vector<std::uint8_t>>();
+
+			if (read_file(cacheDirectory, key, *scaledPool))
+			{
+				const std::lock_guard<std::mutex> lock(cacheMutex);
+				insert_in_memory(key, scaledPool);
+				retVal = scaledPool;
+				numberHits++;
+			}
+		}
+
+		if (nullptr == retVal)
+		{
+			const std::lock_guard<std::mutex> lock(cacheMutex);
+			numberMisses++;
+		}
+		return retVal;
+	}
+
+	void VirtualTerminalScaledPoolCache::insert(const Key &key, std::shared_ptr<const std::vector<std::uint8_t>> scaledPool)
+	{
+		if (nullptr != scaledPool)
+		{
+			std::string cacheDirectory;
+
+			{
+				const std::lock_guard<std::mutex> lock(cacheMutex);
+				insert_in_memory(key, scaledPool);
+				cacheDirectory = directory;
+			}
+
+			if ((!cacheDirectory.empty()) &&
+			    (!write_file(cacheDirectory, key, *scaledPool)))
+			{
+				CANStackLogger::warn("[VT]: Unable to write scaled object pool to the cache directory");
+			}
+		}
+	}
+
+	std::string VirtualTerminalScaledPoolCache::get_filename(const Key &key) const
+	{
+		std::string retVal;
+		const std::lock_guard<std::mutex> lock(cacheMutex);
+
+		if (!directory.empty())
+		{
+			retVal = make_filename(directory, key);
+		}
+		return retVal;
+	}
+
+	void VirtualTerminalScaledPoolCache::clear()
+	{
+		const std::lock_guard<std::mutex> lock(cacheMutex);
+		entries.clear();
+		insertionOrder.clear();
+	}
+
+	std::size_t VirtualTerminalScaledPoolCache::get_number_entries() const
+	{
+		const std::lock_guard<std::mutex> lock(cacheMutex);
+		return entries.size();
+	}
+
+	std::uint32_t VirtualTerminalScaledPoolCache::get_number_hits() const
+	{
+		const std::lock_guard<std::mutex> lock(cacheMutex);
+		return numberHits;
+	}
+
+	std::uint32_t VirtualTerminalScaledPoolCache::get_number_misses() const
+	{
+		const std::lock_guard<std::mutex> lock(cacheMutex);
+		return numberMisses;
+	}
+
+	std::uint64_t VirtualTerminalScaledPoolCache::hash_pool(const std::uint8_t *data, std::uint32_t size)
+	{
+		return XXHash64::hash(data, size);
+	}
+
+	void VirtualTerminalScaledPoolCache::serialize_key(const Key &key, std::uint8_t *buffer)
+	{
+		for (std::uint_fast8_t i = 0; i < 8; i++)
+		{
+			buffer[i] = static_cast<std::uint8_t>(key.poolHash >> (8 * i));
+		}
+		for (std::uint_fast8_t i = 0; i < 4; i++)
+		{
+			buffer[8 + i] = static_cast<std::uint8_t>(key.poolSize >> (8 * i));
+			buffer[12 + i] = static_cast<std::uint8_t>(key.originalDataMaskDimension >> (8 * i));
+			buffer[16 + i] = static_cast<std::uint8_t>(key.originalSoftKeyDesignatorHeight >> (8 * i));
+		}
+		buffer[20] = static_cast<std::uint8_t>(key.dataMaskDimension & 0xFF);
+		buffer[21] = static_cast<std::uint8_t>(key.dataMaskDimension >> 8);
+		buffer[22] = static_cast<std::uint8_t>(key.softKeyDesignatorWidth & 0xFF);
+		buffer[23] = static_cast<std::uint8_t>(key.softKeyDesignatorWidth >> 8);
+		buffer[24] = key.smallFontSizes;
+		buffer[25] = key.largeFontSizes;
+	}
+
+	std::string VirtualTerminalScaledPoolCache::make_filename(const std::string &cacheDirectory, const Key &key)
+	{
+		std::uint8_t serializedKey[KEY_SIZE];
+		std::stringstream stream;
+
+		serialize_key(key, serializedKey);
+		stream << cacheDirectory << "/vt_scaled_pool_" << std::hex << std::setw(16) << std::setfill('0') << hash_pool(serializedKey, KEY_SIZE) << ".bin";
+		return stream.str();
+	}
+
+	bool VirtualTerminalScaledPoolCache::read_file(const std::string &cacheDirectory, const Key &key, std::vector<std::uint8_t> &scaledPool)
+	{
+		bool retVal = false;
+		std::ifstream file(make_filename(cacheDirectory, key), std::ios::binary);
+
+		if (file.is_open())
+		{
+			std::uint8_t header[HEADER_SIZE];
+			std::uint8_t serializedKey[KEY_SIZE];
+			serialize_key(key, serializedKey);
+
+			if ((file.read(reinterpret_cast<char *>(header), HEADER_SIZE)) &&
+			    (FILE_MAGIC == (header[0] | (header[1] << 8) | (header[2] << 16) | (static_cast<std::uint32_t>(header[3]) << 24))) &&
+			    (FILE_VERSION == (header[4] | (header[5] << 8))) &&
+			    (0 == std::memcmp(&header[8], serializedKey, KEY_SIZE)))
+			{
+				std::uint64_t expectedHash = 0;
+				for (std::uint_fast8_t i = 0; i < 8; i++)
+				{
+					expectedHash |= (static_cast<std::uint64_t>(header[8 + KEY_SIZE + i]) << (8 * i));
+				}
+
+				// Scaling doesn't move any objects, so the scaled pool is the same size as the original
+				scaledPool.resize(key.poolSize);
+				retVal = ((file.read(reinterpret_cast<char *>(scaledPool.data()), key.poolSize)) &&
+				          (hash_pool(scaledPool.data(), key.poolSize) == expectedHash));
+			}
+		}
+		return retVal;
+	}
+
+	bool VirtualTerminalScaledPoolCache::write_file(const std::string &cacheDirectory, const Key &key, const std::vector<std::uint8_t> &scaledPool)
+	{
+		bool retVal = false;
+		const std::string filename = make_filename(cacheDirectory, key);
+		const std::string temporaryFilename = filename + ".tmp";
+		std::uint8_t header[HEADER_SIZE] = { 0 };
+		const std::uint64_t poolHash = hash_pool(scaledPool.data(), static_cast<std::uint32_t>(scaledPool.size()));
+
+		header[0] = static_cast<std::uint8_t>(FILE_MAGIC & 0xFF);
+		header[1] = static_cast<std::uint8_t>((FILE_MAGIC >> 8) & 0xFF);
+		header[2] = static_cast<std::uint8_t>((FILE_MAGIC >> 16) & 0xFF);
+		header[3] = static_cast<std::uint8_t>((FILE_MAGIC >> 24) & 0xFF);
+		header[4] = static_cast<std::uint8_t>(FILE_VERSION & 0xFF);
+		header[5] = static_cast<std::uint8_t>(FILE_VERSION >> 8);
+		serialize_key(key, &header[8]);
+		for (std::uint_fast8_t i = 0; i < 8; i++)
+		{
+			header[8 + KEY_SIZE + i] = static_cast<std::uint8_t>(poolHash >> (8 * i));
+		}
+
+		{
+			std::ofstream file(temporaryFilename, std::ios::binary | std::ios::trunc);
+
+			if (file.is_open())
+			{
+				file.write(reinterpret_cast<const char *>(header), HEADER_SIZE);
+				file.write(reinterpret_cast<const char *>(scaledPool.data()), static_cast<std::streamsize>(scaledPool.size()));
+				file.flush();
+				retVal = file.good();
+			}
+		}
+
+		if (retVal)
+		{
+			retVal = replace_file(temporaryFilename, filename);
+		}
+
+		if (!retVal)
+		{
+			std::remove(temporaryFilename.c_str());
+		}
+		return retVal;
+	}
+
+	void VirtualTerminalScaledPoolCache::insert_in_memory(const Key &key, std::shared_ptr<const std::vector<std::uint8_t>> scaledPool)
+	{
+		if (0 != maximumEntries)
+		{
+			auto existingEntry = entries.find(key);
+
+			if (entries.end() != existingEntry)
+			{
+				existingEntry->second = scaledPool;
+			}
+			else
+			{
+				while (entries.size() >= maximumEntries)
+				{
+					entries.erase(insertionOrder.front());
+					insertionOrder.pop_front();
+				}
+				entries[key] = scaledPool;
+				insertionOrder.push_back(key);
+			}
+		}
+	}
+
+	constexpr std::size_t VirtualTerminalScaledPoolCache::DEFAULT_MAXIMUM_ENTRIES;
+	constexpr std::uint32_t VirtualTerminalScaledPoolCache::FILE_MAGIC;
+	constexpr std::uint16_t VirtualTerminalScaledPoolCache::FILE_VERSION;
+	constexpr std::uint32_t VirtualTerminalScaledPoolCache::KEY_SIZE;
+	constexpr std::uint32_t VirtualTerminalScaledPoolCache::HEADER_SIZE;
+} // namespace isobus
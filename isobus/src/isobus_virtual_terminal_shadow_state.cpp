@@ -0,0 +1,551 @@
+//================================================================================================
+/// @file isobus_virtual_terminal_shadow_state.cpp
+///
+/// @brief Implements tracking of the values a VT is showing for each object
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+
+#include "isobus/isobus/isobus_virtual_terminal_shadow_state.hpp"
+#include "isobus/utility/system_timing.hpp"
+
+namespace isobus
+{
+	VirtualTerminalShadowState::VirtualTerminalShadowState() :
+	  responseTimeout_ms(DEFAULT_RESPONSE_TIMEOUT_MS)
+	{
+	}
+
+	void VirtualTerminalShadowState::seed(const VirtualTerminalObjectPoolIndex &index)
+	{
+		const std::lock_guard<std::mutex> lock(stateMutex);
+
+		for (std::size_t i = 0; i < index.get_number_objects(); i++)
+		{
+			const VirtualTerminalObjectPoolIndex::ObjectInfo *info = index.get_object_at_position(i);
+
+			if (nullptr != info)
+			{
+				seed_numeric_value(index, *info);
+				seed_string_value(index, *info);
+			}
+		}
+	}
+
+	void VirtualTerminalShadowState::clear()
+	{
+		const std::lock_guard<std::mutex> lock(stateMutex);
+		confirmedValues.clear();
+		pendingValues.clear();
+		confirmedStrings.clear();
+		pendingStrings.clear();
+	}
+
+	void VirtualTerminalShadowState::invalidate(std::uint16_t objectID)
+	{
+		const std::lock_guard<std::mutex> lock(stateMutex);
+
+		// Attributes of the object can have any attribute ID, so check every key
+		for (auto value = confirmedValues.begin(); value != confirmedValues.end();)
+		{
+			if (objectID == static_cast<std::uint16_t>(value->first >> 8))
+			{
+				value = confirmedValues.erase(value);
+			}
+			else
+			{
+				value++;
+			}
+		}
+		for (auto value = pendingValues.begin(); value != pendingValues.end();)
+		{
+			if (objectID == static_cast<std::uint16_t>(value->first >> 8))
+			{
+				value = pendingValues.erase(value);
+			}
+			else
+			{
+				value++;
+			}
+		}
+		confirmedStrings.erase(objectID);
+		pendingStrings.erase(objectID);
+	}
+
+	bool VirtualTerminalShadowState::get_is_redundant(const std::uint8_t *data, std::uint32_t length) const
+	{
+		bool retVal = false;
+
+		// String commands can be shorter than a CAN frame, numeric ones are always 8 bytes
+		if ((nullptr != data) && (length >= 5))
+		{
+			const std::uint16_t objectID = static_cast<std::uint16_t>(data[1] | (data[2] << 8));
+			const std::uint32_t value = (length >= 8) ? read_uint32(&data[4]) : 0;
+			const std::lock_guard<std::mutex> lock(stateMutex);
+
+			switch (data[0])
+			{
+				case CHANGE_NUMERIC_VALUE_COMMAND:
+				case CHANGE_ATTRIBUTE_COMMAND:
+				{
+					if (length >= 8)
+					{
+						const std::uint32_t key = get_key(data[0], objectID, (CHANGE_ATTRIBUTE_COMMAND == data[0]) ? data[3] : 0);
+						auto pendingValue = pendingValues.find(key);
+
+						// The latest value we sent is what the VT will have once it's done, so compare to that first.
+						// If the VT hasn't responded in time the command may have been lost, so its value isn't known.
+						if (pendingValues.end() != pendingValue)
+						{
+							retVal = ((value == pendingValue->second.value) &&
+							          (!SystemTiming::time_expired_ms(pendingValue->second.timestamp_ms, responseTimeout_ms)));
+						}
+						else
+						{
+							auto confirmedValue = confirmedValues.find(key);
+							retVal = ((confirmedValues.end() != confirmedValue) && (value == confirmedValue->second));
+						}
+					}
+				}
+				break;
+
+				case CHANGE_STRING_VALUE_COMMAND:
+				{
+					const std::uint16_t stringLength = static_cast<std::uint16_t>(data[3] | (data[4] << 8));
+
+					if (length >= (5U + stringLength))
+					{
+						const std::string value(reinterpret_cast<const char *>(&data[5]), stringLength);
+						auto pendingString = pendingStrings.find(objectID);
+
+						if (pendingStrings.end() != pendingString)
+						{
+							retVal = ((value == pendingString->second.value) &&
+							          (!SystemTiming::time_expired_ms(pendingString->second.timestamp_ms, responseTimeout_ms)));
+						}
+						else
+						{
+							auto confirmedString = confirmedStrings.find(objectID);
+							retVal = ((confirmedStrings.end() != confirmedString) && (value == confirmedString->second));
+						}
+					}
+				}
+				break;
+
+				default:
+				{
+				}
+				break;
+			}
+		}
+		return retVal;
+	}
+
+	void VirtualTerminalShadowState::process_sent_command(const std::uint8_t *data, std::uint32_t length)
+	{
+		// String commands can be shorter than a CAN frame, numeric ones are always 8 bytes
+		if ((nullptr != data) && (length >= 5))
+		{
+			const std::uint16_t objectID = static_cast<std::uint16_t>(data[1] | (data[2] << 8));
+			const std::uint32_t value = (length >= 8) ? read_uint32(&data[4]) : 0;
+			const std::lock_guard<std::mutex> lock(stateMutex);
+
+			switch (data[0])
+			{
+				case CHANGE_NUMERIC_VALUE_COMMAND:
+				case CHANGE_ATTRIBUTE_COMMAND:
+				{
+					if (length >= 8)
+					{
+						PendingValue &pendingValue = pendingValues[get_key(data[0], objectID, (CHANGE_ATTRIBUTE_COMMAND == data[0]) ? data[3] : 0)];
+						pendingValue.value = value;
+						pendingValue.timestamp_ms = SystemTiming::get_timestamp_ms();
+					}
+				}
+				break;
+
+				case CHANGE_STRING_VALUE_COMMAND:
+				{
+					const std::uint16_t stringLength = static_cast<std::uint16_t>(data[3] | (data[4] << 8));
+
+					if (length >= (5U + stringLength))
+					{
+						PendingString &pendingString = pendingStrings[objectID];
+						pendingString.value = std::string(reinterpret_cast<const char *>(&data[5]), stringLength);
+						pendingString.timestamp_ms = SystemTiming::get_timestamp_ms();
+					}
+				}
+				break;
+
+				default:
+				{
+				}
+				break;
+			}
+		}
+	}
+
+	void VirtualTerminalShadowState::process_failed_command(const std::uint8_t *data, std::uint32_t length)
+	{
+		if ((nullptr != data) && (length >= 5))
+		{
+			const std::uint16_t objectID = static_cast<std::uint16_t>(data[1] | (data[2] << 8));
+			const std::lock_guard<std::mutex> lock(stateMutex);
+
+			switch (data[0])
+			{
+				case CHANGE_NUMERIC_VALUE_COMMAND:
+				case CHANGE_ATTRIBUTE_COMMAND:
+				{
+					if (length >= 8)
+					{
+						const std::uint32_t key = get_key(data[0], objectID, (CHANGE_ATTRIBUTE_COMMAND == data[0]) ? data[3] : 0);
+						auto pendingValue = pendingValues.find(key);
+
+						// A newer value that's still in flight will be confirmed or fail on its own
+						if ((pendingValues.end() != pendingValue) && (read_uint32(&data[4]) == pendingValue->second.value))
+						{
+							pendingValues.erase(pendingValue);
+						}
+						confirmedValues.erase(key);
+					}
+				}
+				break;
+
+				case CHANGE_STRING_VALUE_COMMAND:
+				{
+					const std::uint16_t stringLength = static_cast<std::uint16_t>(data[3] | (data[4] << 8));
+
+					if (length >= (5U + stringLength))
+					{
+						auto pendingString = pendingStrings.find(objectID);
+
+						if ((pendingStrings.end() != pendingString) &&
+						    (0 == pendingString->second.value.compare(0, std::string::npos, reinterpret_cast<const char *>(&data[5]), stringLength)))
+						{
+							pendingStrings.erase(pendingString);
+						}
+						confirmedStrings.erase(objectID);
+					}
+				}
+				break;
+
+				default:
+				{
+				}
+				break;
+			}
+		}
+	}
+
+	void VirtualTerminalShadowState::process_response(const std::uint8_t *data, std::uint32_t length)
+	{
+		if ((nullptr != data) && (length >= 8))
+		{
+			const std::lock_guard<std::mutex> lock(stateMutex);
+
+			switch (data[0])
+			{
+				case CHANGE_NUMERIC_VALUE_COMMAND:
+				{
+					// The response echoes the value the VT now has
+					const std::uint32_t key = get_key(data[0], static_cast<std::uint16_t>(data[1] | (data[2] << 8)), 0);
+					const std::uint32_t value = read_uint32(&data[4]);
+					auto pendingValue = pendingValues.find(key);
+
+					if (0 == data[3])
+					{
+						confirmedValues[key] = value;
+
+						if ((pendingValues.end() != pendingValue) && (value == pendingValue->second.value))
+						{
+							pendingValues.erase(pendingValue);
+						}
+					}
+					else
+					{
+						confirmedValues.erase(key);
+						pendingValues.erase(key);
+					}
+				}
+				break;
+
+				case CHANGE_ATTRIBUTE_COMMAND:
+				{
+					// The response doesn't echo the value, so the VT now has the last value we sent
+					const std::uint32_t key = get_key(data[0], static_cast<std::uint16_t>(data[1] | (data[2] << 8)), data[3]);
+					auto pendingValue = pendingValues.find(key);
+
+					if ((0 == data[4]) && (pendingValues.end() != pendingValue))
+					{
+						confirmedValues[key] = pendingValue->second.value;
+						pendingValues.erase(pendingValue);
+					}
+					else if (0 != data[4])
+					{
+						confirmedValues.erase(key);
+						pendingValues.erase(key);
+					}
+				}
+				break;
+
+				case CHANGE_STRING_VALUE_COMMAND:
+				{
+					const std::uint16_t objectID = static_cast<std::uint16_t>(data[3] | (data[4] << 8));
+					auto pendingString = pendingStrings.find(objectID);
+
+					if ((0 == data[5]) && (pendingStrings.end() != pendingString))
+					{
+						confirmedStrings[objectID] = pendingString->second.value;
+						pendingStrings.erase(pendingString);
+					}
+					else if (0 != data[5])
+					{
+						confirmedStrings.erase(objectID);
+						pendingStrings.erase(objectID);
+					}
+				}
+				break;
+
+				default:
+				{
+				}
+				break;
+			}
+		}
+	}
+
+	void VirtualTerminalShadowState::process_vt_numeric_value_change(std::uint16_t objectID, std::uint32_t value)
+	{
+		const std::lock_guard<std::mutex> lock(stateMutex);
+		const std::uint32_t key = get_key(CHANGE_NUMERIC_VALUE_COMMAND, objectID, 0);
+		confirmedValues[key] = value;
+		pendingValues.erase(key);
+	}
+
+	void VirtualTerminalShadowState::process_vt_string_value_change(std::uint16_t objectID, const std::string &value)
+	{
+		const std::lock_guard<std::mutex> lock(stateMutex);
+		confirmedStrings[objectID] = value;
+		pendingStrings.erase(objectID);
+	}
+
+	bool VirtualTerminalShadowState::get_numeric_value(std::uint16_t objectID, std::uint32_t &value) const
+	{
+		return get_confirmed_value(get_key(CHANGE_NUMERIC_VALUE_COMMAND, objectID, 0), value);
+	}
+
+	bool VirtualTerminalShadowState::get_string_value(std::uint16_t objectID, std::string &value) const
+	{
+		bool retVal = false;
+		const std::lock_guard<std::mutex> lock(stateMutex);
+		auto confirmedString = confirmedStrings.find(objectID);
+
+		if (confirmedStrings.end() != confirmedString)
+		{
+			value = confirmedString->second;
+			retVal = true;
+		}
+		return retVal;
+	}
+
+	void VirtualTerminalShadowState::set_response_timeout(std::uint32_t value_ms)
+	{
+		const std::lock_guard<std::mutex> lock(stateMutex);
+		responseTimeout_ms = value_ms;
+	}
+
+	bool VirtualTerminalShadowState::get_is_tracked(const std::uint8_t *data, std::uint32_t length)
+	{
+		return ((nullptr != data) &&
+		        (length >= 5) &&
+		        ((CHANGE_NUMERIC_VALUE_COMMAND == data[0]) ||
+		         (CHANGE_ATTRIBUTE_COMMAND == data[0]) ||
+		         (CHANGE_STRING_VALUE_COMMAND == data[0])));
+	}
+
+	bool VirtualTerminalShadowState::get_attribute_value(std::uint16_t objectID, std::uint8_t attributeID, std::uint32_t &value) const
+	{
+		return get_confirmed_value(get_key(CHANGE_ATTRIBUTE_COMMAND, objectID, attributeID), value);
+	}
+
+	std::uint32_t VirtualTerminalShadowState::get_key(std::uint8_t functionCode, std::uint16_t objectID, std::uint8_t attributeID)
+	{
+		return (static_cast<std::uint32_t>(functionCode) << 24) | (static_cast<std::uint32_t>(objectID) << 8) | attributeID;
+	}
+
+	std::uint32_t VirtualTerminalShadowState::read_uint32(const std::uint8_t *data)
+	{
+		return static_cast<std::uint32_t>(data[0]) |
+		  (static_cast<std::uint32_t>(data[1]) << 8) |
+		  (static_cast<std::uint32_t>(data[2]) << 16) |
+		  (static_cast<std::uint32_t>(data[3]) << 24);
+	}
+
+	bool VirtualTerminalShadowState::get_confirmed_value(std::uint32_t key, std::uint32_t &value) const
+	{
+		bool retVal = false;
+		const std::lock_guard<std::mutex> lock(stateMutex);
+		auto confirmedValue = confirmedValues.find(key);
+
+		if (confirmedValues.end() != confirmedValue)
+		{
+			value = confirmedValue->second;
+			retVal = true;
+		}
+		return retVal;
+	}
+
+	void VirtualTerminalShadowState::seed_numeric_value(const VirtualTerminalObjectPoolIndex &index, const VirtualTerminalObjectPoolIndex::ObjectInfo &info)
+	{
+		std::uint32_t valueOffset = 0;
+		std::uint8_t valueSize = 0;
+
+		// Where the value attribute is in each object that change numeric value applies to
+		switch (info.type)
+		{
+			case VirtualTerminalObjectType::InputBoolean:
+			{
+				valueOffset = 10;
+				valueSize = 1;
+			}
+			break;
+
+			case VirtualTerminalObjectType::InputNumber:
+			case VirtualTerminalObjectType::OutputNumber:
+			{
+				valueOffset = 13;
+				valueSize = 4;
+			}
+			break;
+
+			case VirtualTerminalObjectType::InputList:
+			case VirtualTerminalObjectType::OutputList:
+			{
+				valueOffset = 9;
+				valueSize = 1;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputMeter:
+			{
+				valueOffset = 18;
+				valueSize = 2;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputLinearBarGraph:
+			{
+				valueOffset = 17;
+				valueSize = 2;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputArchedBarGraph:
+			{
+				valueOffset = 20;
+				valueSize = 2;
+			}
+			break;
+
+			case VirtualTerminalObjectType::NumberVariable:
+			{
+				valueOffset = 3;
+				valueSize = 4;
+			}
+			break;
+
+			case VirtualTerminalObjectType::ObjectPointer:
+			{
+				valueOffset = 3;
+				valueSize = 2;
+			}
+			break;
+
+			default:
+			{
+			}
+			break;
+		}
+
+		if (0 != valueSize)
+		{
+			std::uint32_t value = 0;
+			bool valueRead = false;
+
+			if (1 == valueSize)
+			{
+				std::uint8_t byteValue = 0;
+				valueRead = index.get_uint8_attribute(info.objectID, valueOffset, byteValue);
+				value = byteValue;
+			}
+			else if (2 == valueSize)
+			{
+				std::uint16_t wordValue = 0;
+				valueRead = index.get_uint16_attribute(info.objectID, valueOffset, wordValue);
+				value = wordValue;
+			}
+			else
+			{
+				valueRead = index.get_uint32_attribute(info.objectID, valueOffset, value);
+			}
+
+			if (valueRead)
+			{
+				confirmedValues[get_key(CHANGE_NUMERIC_VALUE_COMMAND, info.objectID, 0)] = value;
+			}
+		}
+	}
+
+	void VirtualTerminalShadowState::seed_string_value(const VirtualTerminalObjectPoolIndex &index, const VirtualTerminalObjectPoolIndex::ObjectInfo &info)
+	{
+		std::uint32_t valueOffset = 0;
+		std::uint16_t stringLength = 0;
+		bool lengthRead = false;
+
+		// Where the length and value attributes are in each object that change string value applies to
+		switch (info.type)
+		{
+			case VirtualTerminalObjectType::InputString:
+			{
+				std::uint8_t shortLength = 0;
+				lengthRead = index.get_uint8_attribute(info.objectID, 16, shortLength);
+				stringLength = shortLength;
+				valueOffset = 17;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputString:
+			{
+				lengthRead = index.get_uint16_attribute(info.objectID, 14, stringLength);
+				valueOffset = 16;
+			}
+			break;
+
+			case VirtualTerminalObjectType::StringVariable:
+			{
+				lengthRead = index.get_uint16_attribute(info.objectID, 3, stringLength);
+				valueOffset = 5;
+			}
+			break;
+
+			default:
+			{
+			}
+			break;
+		}
+
+		if ((lengthRead) &&
+		    ((valueOffset + stringLength) <= info.length))
+		{
+			const std::uint8_t *objectData = index.get_object_data(info.objectID);
+			confirmedStrings[info.objectID] = std::string(reinterpret_cast<const char *>(&objectData[valueOffset]), stringLength);
+		}
+	}
+
+	constexpr std::uint8_t VirtualTerminalShadowState::CHANGE_NUMERIC_VALUE_COMMAND;
+	constexpr std::uint8_t VirtualTerminalShadowState::CHANGE_ATTRIBUTE_COMMAND;
+	constexpr std::uint8_t VirtualTerminalShadowState::CHANGE_STRING_VALUE_COMMAND;
+	constexpr std::uint32_t VirtualTerminalShadowState::DEFAULT_RESPONSE_TIMEOUT_MS;
+} // namespace isobus
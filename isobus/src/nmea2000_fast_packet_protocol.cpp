@@ -11,11 +11,13 @@
 #include "isobus/isobus/nmea2000_fast_packet_protocol.hpp"
 
 #include "isobus/isobus/can_constants.hpp"
+#include "isobus/isobus/can_network_configuration.hpp"
 #include "isobus/isobus/can_network_manager.hpp"
 #include "isobus/isobus/can_stack_logger.hpp"
 #include "isobus/utility/system_timing.hpp"
 
 #include <algorithm>
+#include <cstring>
 
 namespace isobus
 {
@@ -26,10 +28,12 @@ namespace isobus
 	  sessionCompleteCallback(nullptr),
 	  frameChunkCallback(nullptr),
 	  timestamp_ms(0),
+	  lastFrameTimestamp_us(0),
 	  lastPacketNumber(0),
 	  packetCount(0),
 	  processedPacketsThisSession(0),
 	  sequenceNumber(0),
+	  transmitFailed(false),
 	  sessionDirection(sessionDirection)
 	{
 	}
@@ -55,17 +59,27 @@ namespace isobus
 
 	void FastPacketProtocol::register_multipacket_message_callback(std::uint32_t parameterGroupNumber, CANLibCallback callback, void *parent)
 	{
-		parameterGroupNumberCallbacks.push_back(ParameterGroupNumberCallbackData(parameterGroupNumber, callback, parent));
+		parameterGroupNumberCallbacks[parameterGroupNumber].push_back(ParameterGroupNumberCallbackData(parameterGroupNumber, callback, parent));
 		CANNetworkManager::CANNetwork.add_protocol_parameter_group_number_callback(parameterGroupNumber, process_message, this);
 	}
 
 	void FastPacketProtocol::remove_multipacket_message_callback(std::uint32_t parameterGroupNumber, CANLibCallback callback, void *parent)
 	{
 		ParameterGroupNumberCallbackData tempObject(parameterGroupNumber, callback, parent);
-		auto callbackLocation = std::find(parameterGroupNumberCallbacks.begin(), parameterGroupNumberCallbacks.end(), tempObject);
-		if (parameterGroupNumberCallbacks.end() != callbackLocation)
+		auto pgnCallbacks = parameterGroupNumberCallbacks.find(parameterGroupNumber);
+
+		if (parameterGroupNumberCallbacks.end() != pgnCallbacks)
 		{
-			parameterGroupNumberCallbacks.erase(callbackLocation);
+			auto callbackLocation = std::find(pgnCallbacks->second.begin(), pgnCallbacks->second.end(), tempObject);
+			if (pgnCallbacks->second.end() != callbackLocation)
+			{
+				pgnCallbacks->second.erase(callbackLocation);
+			}
+
+			if (pgnCallbacks->second.empty())
+			{
+				parameterGroupNumberCallbacks.erase(pgnCallbacks);
+			}
 		}
 		CANNetworkManager::CANNetwork.remove_protocol_parameter_group_number_callback(parameterGroupNumber, process_message, this);
 	}
@@ -88,7 +102,9 @@ namespace isobus
 		    (parameterGroupNumber <= FP_MAX_PARAMETER_GROUP_NUMBER) &&
 		    (messageLength <= MAX_PROTOCOL_MESSAGE_LENGTH) &&
 		    ((nullptr != data) ||
-		     (nullptr != frameChunkCallback)))
+		     (nullptr != frameChunkCallback)) &&
+		    ((nullptr != destination) ||
+		     (CANNetworkManager::BroadcastGateResult::Send == CANNetworkManager::CANNetwork.check_broadcast_gate(source->get_can_port(), parameterGroupNumber, false))))
 		{
 			FastPacketProtocolSession *tempSession = nullptr;
 
@@ -101,17 +117,12 @@ namespace isobus
 				tempSession->sessionMessage.set_data(data, messageLength);
 				tempSession->frameChunkCallback = frameChunkCallback;
 				tempSession->parent = parentPointer;
-				tempSession->packetCount = ((messageLength - 6) / PROTOCOL_BYTES_PER_FRAME);
+				tempSession->packetCount = get_number_frames_after_first(messageLength);
 				tempSession->timestamp_ms = SystemTiming::get_timestamp_ms();
 				tempSession->processedPacketsThisSession = 0;
 				tempSession->sessionCompleteCallback = txCompleteCallback;
 				tempSession->sequenceNumber = get_new_sequence_number(tempSession);
 
-				if (0 != (messageLength % PROTOCOL_BYTES_PER_FRAME))
-				{
-					tempSession->packetCount++;
-				}
-
 				std::unique_lock<std::mutex> lock(sessionMutex);
 
 				activeSessions.push_back(tempSession);
@@ -132,40 +143,77 @@ namespace isobus
 
 	void FastPacketProtocol::update(CANLibBadge<CANNetworkManager>)
 	{
+		for (auto rxSession = activeRxSessions.begin(); rxSession != activeRxSessions.end();)
+		{
+			// Closing a session removes it from the index, so step past it first
+			auto currentSession = rxSession->second;
+			rxSession++;
+			update_state_machine(currentSession);
+		}
+
 		std::unique_lock<std::mutex> lock(sessionMutex);
 
-		for (auto i : activeSessions)
+		schedule_transmit_frames();
+
+		// Iterate backwards so that closing a session doesn't skip the next one
+		for (std::size_t i = activeSessions.size(); i > 0; i--)
 		{
-			update_state_machine(i);
+			update_state_machine(activeSessions[i - 1]);
 		}
 	}
 
+	std::uint64_t FastPacketProtocol::get_rx_session_key(std::uint8_t canPortIndex, std::uint8_t sourceAddress, std::uint32_t parameterGroupNumber, std::uint8_t sequenceNumber)
+	{
+		return ((static_cast<std::uint64_t>(canPortIndex) << 40) |
+		        (static_cast<std::uint64_t>(sourceAddress) << 32) |
+		        (static_cast<std::uint64_t>(parameterGroupNumber & 0x3FFFF) << 8) |
+		        (sequenceNumber & SEQUENCE_NUMBER_BIT_MASK));
+	}
+
+	std::uint8_t FastPacketProtocol::get_number_frames_after_first(std::uint32_t messageLength)
+	{
+		constexpr std::uint32_t FIRST_FRAME_DATA_LENGTH = PROTOCOL_BYTES_PER_FRAME - 1;
+		std::uint8_t retVal = 0;
+
+		if (messageLength > FIRST_FRAME_DATA_LENGTH)
+		{
+			// Round up, so a partly filled last frame is counted
+			retVal = static_cast<std::uint8_t>(((messageLength - FIRST_FRAME_DATA_LENGTH) + (PROTOCOL_BYTES_PER_FRAME - 1)) / PROTOCOL_BYTES_PER_FRAME);
+		}
+		return retVal;
+	}
+
 	void FastPacketProtocol::add_session_history(FastPacketProtocolSession *session)
 	{
 		if (nullptr != session)
 		{
-			bool formerSessionMatched = false;
+			const NAME sessionName = session->sessionMessage.get_source_control_function()->get_NAME();
+			const FastPacketHistoryKey historyKey(sessionName.get_full_name(), session->sessionMessage.get_identifier().get_parameter_group_number());
+			const std::uint8_t nextSequenceNumber = ((session->sequenceNumber + 1) & SEQUENCE_NUMBER_BIT_MASK);
+			auto formerSession = sessionHistoryIndex.find(historyKey);
 
-			for (std::size_t i = 0; i < sessionHistory.size(); i++)
+			if (sessionHistoryIndex.end() != formerSession)
 			{
-				if ((sessionHistory[i].isoName == session->sessionMessage.get_source_control_function()->get_NAME()) &&
-				    (sessionHistory[i].parameterGroupNumber == session->sessionMessage.get_identifier().get_parameter_group_number()))
-				{
-					sessionHistory[i].sequenceNumber++;
-					formerSessionMatched = true;
-					break;
-				}
+				// Move the entry to the front, since it's now the most recently used
+				formerSession->second->sequenceNumber = nextSequenceNumber;
+				sessionHistory.splice(sessionHistory.begin(), sessionHistory, formerSession->second);
 			}
-
-			if (!formerSessionMatched)
+			else
 			{
 				FastPacketHistory history{
-					session->sessionMessage.get_source_control_function()->get_NAME(),
-					session->sessionMessage.get_identifier().get_parameter_group_number(),
-					session->sequenceNumber
+					sessionName,
+					historyKey.second,
+					nextSequenceNumber
 				};
-				history.sequenceNumber++;
-				sessionHistory.push_back(history);
+				sessionHistory.push_front(history);
+				sessionHistoryIndex[historyKey] = sessionHistory.begin();
+
+				if (sessionHistory.size() > MAX_SESSION_HISTORY_SIZE)
+				{
+					const FastPacketHistory &oldestHistory = sessionHistory.back();
+					sessionHistoryIndex.erase(FastPacketHistoryKey(oldestHistory.isoName.get_full_name(), oldestHistory.parameterGroupNumber));
+					sessionHistory.pop_back();
+				}
 			}
 		}
 	}
@@ -174,14 +222,30 @@ namespace isobus
 	{
 		if (nullptr != session)
 		{
-			process_session_complete_callback(session, successfull);
-			for (auto currentSession = activeSessions.begin(); currentSession != activeSessions.end(); currentSession++)
+			if (FastPacketProtocolSession::Direction::Receive == session->sessionDirection)
 			{
-				if (session == *currentSession)
+				auto rxSession = activeRxSessions.find(get_rx_session_key(session->sessionMessage.get_can_port_index(),
+				                                                          session->sessionMessage.get_identifier().get_source_address(),
+				                                                          session->sessionMessage.get_identifier().get_parameter_group_number(),
+				                                                          session->sequenceNumber));
+
+				if ((activeRxSessions.end() != rxSession) && (session == rxSession->second))
 				{
-					activeSessions.erase(currentSession);
+					activeRxSessions.erase(rxSession);
 					delete session;
-					break;
+				}
+			}
+			else
+			{
+				process_session_complete_callback(session, successfull);
+				for (auto currentSession = activeSessions.begin(); currentSession != activeSessions.end(); currentSession++)
+				{
+					if (session == *currentSession)
+					{
+						activeSessions.erase(currentSession);
+						delete session;
+						break;
+					}
 				}
 			}
 		}
@@ -193,14 +257,12 @@ namespace isobus
 
 		if (nullptr != session)
 		{
-			for (auto formerSessions : sessionHistory)
+			auto formerSession = sessionHistoryIndex.find(FastPacketHistoryKey(session->sessionMessage.get_source_control_function()->get_NAME().get_full_name(),
+			                                                                   session->sessionMessage.get_identifier().get_parameter_group_number()));
+
+			if (sessionHistoryIndex.end() != formerSession)
 			{
-				if ((formerSessions.isoName == session->sessionMessage.get_source_control_function()->get_NAME()) &&
-				    (formerSessions.parameterGroupNumber == session->sessionMessage.get_identifier().get_parameter_group_number()))
-				{
-					retVal = formerSessions.sequenceNumber;
-					break;
-				}
+				retVal = formerSession->second->sequenceNumber;
 			}
 		}
 		return retVal;
@@ -240,112 +302,108 @@ namespace isobus
 		    (message->get_identifier().get_parameter_group_number() <= FP_MAX_PARAMETER_GROUP_NUMBER))
 		{
 			// See if we care about parsing this message
-			if (parameterGroupNumberCallbacks.size() > 0)
-			{
-				bool pgnNeedsParsing = false;
+			auto pgnCallbacks = parameterGroupNumberCallbacks.find(message->get_identifier().get_parameter_group_number());
 
-				for (auto callback : parameterGroupNumberCallbacks)
+			if (parameterGroupNumberCallbacks.end() != pgnCallbacks)
+			{
+				FastPacketProtocolSession *currentSession = nullptr;
+				const std::vector<std::uint8_t> &messageData = message->get_data();
+				const std::uint8_t frameCount = (messageData[0] & FRAME_COUNTER_BIT_MASK);
+				const std::uint8_t sequenceNumber = ((messageData[0] >> SEQUENCE_NUMBER_BIT_OFFSET) & SEQUENCE_NUMBER_BIT_MASK);
+				const std::uint64_t sessionKey = get_rx_session_key(message->get_can_port_index(),
+				                                                    message->get_identifier().get_source_address(),
+				                                                    message->get_identifier().get_parameter_group_number(),
+				                                                    sequenceNumber);
+				auto sessionLocation = activeRxSessions.find(sessionKey);
+
+				if (activeRxSessions.end() != sessionLocation)
 				{
-					if (callback.get_parameter_group_number() == message->get_identifier().get_parameter_group_number())
-					{
-						pgnNeedsParsing = true;
-						break;
-					}
+					currentSession = sessionLocation->second;
 				}
 
-				if (pgnNeedsParsing)
+				// Check for a valid session
+				if (nullptr != currentSession)
 				{
-					FastPacketProtocolSession *currentSession = nullptr;
-					std::vector<std::uint8_t> messageData = message->get_data();
-					std::uint8_t frameCount = (messageData[0] & FRAME_COUNTER_BIT_MASK);
-
-					// Check for a valid session
-					if (get_session(currentSession, message->get_identifier().get_parameter_group_number(), message->get_source_control_function(), message->get_destination_control_function()))
+					// Matched a session
+					if (0 != frameCount)
 					{
-						// Matched a session
-						if (0 != frameCount)
+						// Continue processing the message
+						for (std::uint8_t i = 0; i < PROTOCOL_BYTES_PER_FRAME; i++)
 						{
-							// Continue processing the message
-							for (std::uint8_t i = 0; i < PROTOCOL_BYTES_PER_FRAME; i++)
-							{
-								currentSession->sessionMessage.set_data(messageData[1 + i], i + (currentSession->processedPacketsThisSession * PROTOCOL_BYTES_PER_FRAME) - 1);
-							}
-							currentSession->processedPacketsThisSession++;
+							currentSession->sessionMessage.set_data(messageData[1 + i], i + (currentSession->processedPacketsThisSession * PROTOCOL_BYTES_PER_FRAME) - 1);
+						}
+						currentSession->processedPacketsThisSession++;
+						currentSession->timestamp_ms = SystemTiming::get_timestamp_ms();
 
-							// Currently counting one by index and one by value, so add 1 to expected packet count
-							if (currentSession->processedPacketsThisSession >= currentSession->packetCount + 1)
+						// Currently counting one by index and one by value, so add 1 to expected packet count
+						if (currentSession->processedPacketsThisSession >= currentSession->packetCount + 1)
+						{
+							// Complete
+							// Let everyone who registered for this PGN know
+							for (auto callback : pgnCallbacks->second)
 							{
-								// Complete
-								// Find the appropriate callback and let them know
-								for (auto callback : parameterGroupNumberCallbacks)
-								{
-									if (callback.get_parameter_group_number() == currentSession->sessionMessage.get_identifier().get_parameter_group_number())
-									{
-										callback.get_callback()(&currentSession->sessionMessage, callback.get_parent());
-									}
-								}
-								close_session(currentSession, true); // All done
+								callback.get_callback()(&currentSession->sessionMessage, callback.get_parent());
 							}
-						}
-						else
-						{
-							CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[FP]: Existing session matched new frame counter, aborting the matching session.");
-							close_session(currentSession, false);
+							close_session(currentSession, true); // All done
 						}
 					}
 					else
 					{
-						// No matching session. See if we need to start a new session
-						if (0 == frameCount)
+						CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[FP]: Existing session matched new frame counter, aborting the matching session.");
+						close_session(currentSession, false);
+						currentSession = nullptr;
+					}
+				}
+
+				if (nullptr == currentSession)
+				{
+					// No matching session. See if we need to start a new session
+					if (0 == frameCount)
+					{
+						if (messageData[1] <= MAX_PROTOCOL_MESSAGE_LENGTH)
 						{
-							if (messageData[1] <= MAX_PROTOCOL_MESSAGE_LENGTH)
+							// This is the beginning of a new message
+							currentSession = new FastPacketProtocolSession(FastPacketProtocolSession::Direction::Receive, message->get_can_port_index());
+							currentSession->frameChunkCallback = nullptr;
+							currentSession->packetCount = get_number_frames_after_first(messageData[1]);
+							currentSession->lastPacketNumber = sequenceNumber;
+							currentSession->sequenceNumber = sequenceNumber;
+							currentSession->processedPacketsThisSession = 1;
+							currentSession->sessionMessage.set_data_size(messageData[1]);
+							currentSession->sessionMessage.set_identifier(message->get_identifier());
+							currentSession->sessionMessage.set_source_control_function(message->get_source_control_function());
+							currentSession->sessionMessage.set_destination_control_function(message->get_destination_control_function());
+							currentSession->timestamp_ms = SystemTiming::get_timestamp_ms();
+
+							// Save the 6 bytes of payload in this first message
+							for (std::uint8_t i = 0; i < (PROTOCOL_BYTES_PER_FRAME - 1); i++)
 							{
-								// This is the beginning of a new message
-								currentSession = new FastPacketProtocolSession(FastPacketProtocolSession::Direction::Receive, message->get_can_port_index());
-								currentSession->frameChunkCallback = nullptr;
-								if (messageData[1] >= PROTOCOL_BYTES_PER_FRAME - 1)
-								{
-									currentSession->packetCount = ((messageData[1] - 6) / PROTOCOL_BYTES_PER_FRAME);
-								}
-								else
-								{
-									currentSession->packetCount = 1;
-								}
-								currentSession->lastPacketNumber = ((messageData[0] >> SEQUENCE_NUMBER_BIT_OFFSET) & SEQUENCE_NUMBER_BIT_MASK);
-								currentSession->processedPacketsThisSession = 1;
-								currentSession->sessionMessage.set_data_size(messageData[1]);
-								currentSession->sessionMessage.set_identifier(message->get_identifier());
-								currentSession->sessionMessage.set_source_control_function(message->get_source_control_function());
-								currentSession->sessionMessage.set_destination_control_function(message->get_destination_control_function());
-								currentSession->timestamp_ms = SystemTiming::get_timestamp_ms();
-
-								if (0 != (messageData[1] % PROTOCOL_BYTES_PER_FRAME))
-								{
-									currentSession->packetCount++;
-								}
-
-								// Save the 6 bytes of payload in this first message
-								for (std::uint8_t i = 0; i < (PROTOCOL_BYTES_PER_FRAME - 1); i++)
-								{
-									currentSession->sessionMessage.set_data(messageData[2 + i], i);
-								}
+								currentSession->sessionMessage.set_data(messageData[2 + i], i);
+							}
 
-								std::unique_lock<std::mutex> lock(sessionMutex);
+							activeRxSessions[sessionKey] = currentSession;
 
-								activeSessions.push_back(currentSession);
-							}
-							else
+							if (0 == currentSession->packetCount)
 							{
-								CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[FP]: Ignoring possible new FP session with advertised length > 233.");
+								// The whole message fit in the first frame
+								for (auto callback : pgnCallbacks->second)
+								{
+									callback.get_callback()(&currentSession->sessionMessage, callback.get_parent());
+								}
+								close_session(currentSession, true);
 							}
 						}
 						else
 						{
-							// This is the middle of some message that we have no context for.
-							// Ignore the message.
-							CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[FP]: Ignoring FP message, no context available.");
+							CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[FP]: Ignoring possible new FP session with advertised length > 233.");
 						}
 					}
+					else
+					{
+						// This is the middle of some message that we have no context for.
+						// Ignore the message.
+						CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Warning, "[FP]: Ignoring FP message, no context available.");
+					}
 				}
 			}
 		}
@@ -379,129 +437,169 @@ namespace isobus
 		return false;
 	}
 
-	void FastPacketProtocol::update_state_machine(FastPacketProtocolSession *session)
+	bool FastPacketProtocol::get_transmit_frame(FastPacketProtocolSession *session, std::uint8_t *dataBuffer)
 	{
-		if (nullptr != session)
+		bool retVal = true;
+		const std::uint8_t frameIndex = session->processedPacketsThisSession;
+		const std::uint32_t messageLength = session->sessionMessage.get_data_length();
+		std::uint32_t dataOffset = 0;
+		std::uint32_t numberBytesInFrame = (PROTOCOL_BYTES_PER_FRAME - 1);
+		std::uint8_t dataIndex = 2;
+
+		dataBuffer[0] = static_cast<std::uint8_t>(frameIndex | ((session->sequenceNumber & SEQUENCE_NUMBER_BIT_MASK) << SEQUENCE_NUMBER_BIT_OFFSET));
+
+		if (0 == frameIndex)
 		{
-			switch (session->sessionDirection)
+			dataBuffer[1] = static_cast<std::uint8_t>(messageLength);
+		}
+		else
+		{
+			dataOffset = (PROTOCOL_BYTES_PER_FRAME - 1) + (PROTOCOL_BYTES_PER_FRAME * (frameIndex - 1));
+			numberBytesInFrame = PROTOCOL_BYTES_PER_FRAME;
+			dataIndex = 1;
+		}
+
+		// Unused bytes at the end of the last frame are padded
+		for (std::uint8_t i = dataIndex; i < CAN_DATA_LENGTH; i++)
+		{
+			dataBuffer[i] = 0xFF;
+		}
+
+		if (dataOffset >= messageLength)
+		{
+			numberBytesInFrame = 0;
+		}
+		else if ((dataOffset + numberBytesInFrame) > messageLength)
+		{
+			numberBytesInFrame = (messageLength - dataOffset);
+		}
+
+		if (0 != numberBytesInFrame)
+		{
+			if (nullptr != session->frameChunkCallback)
 			{
-				case FastPacketProtocolSession::Direction::Receive:
+				std::uint8_t callbackBuffer[CAN_DATA_LENGTH] = { 0 }; // Only need 7 but give them 8 in case they make a mistake
+
+				retVal = session->frameChunkCallback(frameIndex, dataOffset, numberBytesInFrame, callbackBuffer, session->parent);
+
+				if (retVal)
 				{
-					if (SystemTiming::time_expired_ms(session->timestamp_ms, FP_TIMEOUT_MS))
-					{
-						CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[FP]: Rx session timed out.");
-						close_session(session, false);
-					}
+					memcpy(&dataBuffer[dataIndex], callbackBuffer, numberBytesInFrame);
 				}
-				break;
+			}
+			else
+			{
+				memcpy(&dataBuffer[dataIndex], &session->sessionMessage.get_data()[dataOffset], numberBytesInFrame);
+			}
+		}
+		return retVal;
+	}
 
-				case FastPacketProtocolSession::Direction::Transmit:
-				{
-					std::array<std::uint8_t, CAN_DATA_LENGTH> dataBuffer;
-					std::vector<std::uint8_t> messageData;
-					bool txSessionCancelled = false;
+	void FastPacketProtocol::schedule_transmit_frames()
+	{
+		const std::uint32_t minimumFrameGap_us = CANNetworkConfiguration::get_minimum_time_between_fast_packet_frames_us();
+		bool hardwareBusy = false;
+		bool framesSent = true;
+
+		// Keep sessions ordered by priority. The sort is stable, so sessions with equal priority stay in the order they were started.
+		std::stable_sort(activeSessions.begin(), activeSessions.end(), [](const FastPacketProtocolSession *first, const FastPacketProtocolSession *second) {
+			return (static_cast<std::uint8_t>(first->sessionMessage.get_identifier().get_priority()) < static_cast<std::uint8_t>(second->sessionMessage.get_identifier().get_priority()));
+		});
+
+		// Each pass sends one frame from every ready session in the highest priority group that has a ready session,
+		// so sessions with equal priority are interleaved frame by frame, and lower priority sessions
+		// can use the bus while higher priority ones are waiting on their frame gap.
+		while (framesSent && (!hardwareBusy))
+		{
+			std::size_t groupStart = 0;
 
-					for (std::uint8_t i = session->processedPacketsThisSession; i <= session->packetCount; i++)
-					{
-						std::uint8_t bytesProcessedSoFar = (session->processedPacketsThisSession > 0 ? 6 : 0);
+			framesSent = false;
+			while ((!framesSent) && (!hardwareBusy) && (groupStart < activeSessions.size()))
+			{
+				const CANIdentifier::CANPriority groupPriority = activeSessions[groupStart]->sessionMessage.get_identifier().get_priority();
+				std::size_t groupEnd = groupStart;
 
-						if (0 != bytesProcessedSoFar)
-						{
-							bytesProcessedSoFar += (PROTOCOL_BYTES_PER_FRAME * (session->processedPacketsThisSession - 1));
-						}
+				while ((groupEnd < activeSessions.size()) &&
+				       (groupPriority == activeSessions[groupEnd]->sessionMessage.get_identifier().get_priority()))
+				{
+					groupEnd++;
+				}
 
-						std::uint16_t numberBytesLeft = (session->sessionMessage.get_data_length() - bytesProcessedSoFar);
+				for (std::size_t i = groupStart; (i < groupEnd) && (!hardwareBusy); i++)
+				{
+					FastPacketProtocolSession *session = activeSessions[i];
 
-						if (numberBytesLeft > PROTOCOL_BYTES_PER_FRAME)
-						{
-							numberBytesLeft = PROTOCOL_BYTES_PER_FRAME;
-						}
+					if ((!session->transmitFailed) &&
+					    (session->processedPacketsThisSession <= session->packetCount) &&
+					    ((0 == minimumFrameGap_us) ||
+					     (0 == session->processedPacketsThisSession) ||
+					     (SystemTiming::time_expired_us(session->lastFrameTimestamp_us, minimumFrameGap_us))))
+					{
+						std::uint8_t dataBuffer[CAN_DATA_LENGTH];
 
-						if (nullptr != session->frameChunkCallback)
+						if (!get_transmit_frame(session, dataBuffer))
 						{
-							std::uint8_t callbackBuffer[CAN_DATA_LENGTH] = { 0 }; // Only need 7 but give them 8 in case they make a mistake
-							bool callbackSuccessful = session->frameChunkCallback(dataBuffer[0], (PROTOCOL_BYTES_PER_FRAME * session->processedPacketsThisSession), numberBytesLeft, callbackBuffer, session->parent);
-
-							if (callbackSuccessful)
-							{
-								for (std::uint8_t j = 0; j < PROTOCOL_BYTES_PER_FRAME; j++)
-								{
-									dataBuffer[1 + j] = callbackBuffer[j];
-								}
-							}
-							else
-							{
-								close_session(session, false);
-								break;
-							}
-						}
-						else
-						{
-							messageData = session->sessionMessage.get_data();
-							if (0 == session->processedPacketsThisSession)
-							{
-								dataBuffer[0] = session->processedPacketsThisSession;
-								dataBuffer[0] |= (session->sequenceNumber << SEQUENCE_NUMBER_BIT_OFFSET);
-								dataBuffer[1] = session->sessionMessage.get_data_length();
-								dataBuffer[2] = messageData[0];
-								dataBuffer[3] = messageData[1];
-								dataBuffer[4] = messageData[2];
-								dataBuffer[5] = messageData[3];
-								dataBuffer[6] = messageData[4];
-								dataBuffer[7] = messageData[5];
-							}
-							else
-							{
-								dataBuffer[0] = session->processedPacketsThisSession;
-								dataBuffer[0] |= (session->sequenceNumber << SEQUENCE_NUMBER_BIT_OFFSET);
-
-								if (numberBytesLeft < PROTOCOL_BYTES_PER_FRAME)
-								{
-									dataBuffer[1] = 0xFF;
-									dataBuffer[2] = 0xFF;
-									dataBuffer[3] = 0xFF;
-									dataBuffer[4] = 0xFF;
-									dataBuffer[5] = 0xFF;
-									dataBuffer[6] = 0xFF;
-									dataBuffer[7] = 0xFF;
-								}
-
-								for (std::uint8_t j = 0; j < numberBytesLeft; j++)
-								{
-									dataBuffer[1 + j] = messageData[6 + ((i - 1) * PROTOCOL_BYTES_PER_FRAME) + j];
-								}
-							}
+							CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[FP]: Tx session data chunk callback failed.");
+							session->transmitFailed = true;
 						}
-						if (CANNetworkManager::CANNetwork.send_can_message(session->sessionMessage.get_identifier().get_parameter_group_number(),
-						                                                   dataBuffer.data(),
-						                                                   CAN_DATA_LENGTH,
-						                                                   reinterpret_cast<InternalControlFunction *>(session->sessionMessage.get_source_control_function()),
-						                                                   session->sessionMessage.get_destination_control_function(),
-						                                                   session->sessionMessage.get_identifier().get_priority(),
-						                                                   nullptr,
-						                                                   nullptr))
+						else if (CANNetworkManager::CANNetwork.send_can_message(session->sessionMessage.get_identifier().get_parameter_group_number(),
+						                                                        dataBuffer,
+						                                                        CAN_DATA_LENGTH,
+						                                                        reinterpret_cast<InternalControlFunction *>(session->sessionMessage.get_source_control_function()),
+						                                                        session->sessionMessage.get_destination_control_function(),
+						                                                        session->sessionMessage.get_identifier().get_priority(),
+						                                                        nullptr,
+						                                                        nullptr))
 						{
 							session->processedPacketsThisSession++;
 							session->timestamp_ms = SystemTiming::get_timestamp_ms();
+							session->lastFrameTimestamp_us = SystemTiming::get_timestamp_us();
+							framesSent = true;
 						}
 						else
 						{
-							if (SystemTiming::time_expired_ms(session->timestamp_ms, FP_TIMEOUT_MS))
-							{
-								CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[FP]: Tx session timed out.");
-								close_session(session, false);
-								txSessionCancelled = true;
-							}
-							break;
+							// Try again next update
+							hardwareBusy = true;
 						}
 					}
+				}
+				groupStart = groupEnd;
+			}
+		}
+	}
+
+	void FastPacketProtocol::update_state_machine(FastPacketProtocolSession *session)
+	{
+		if (nullptr != session)
+		{
+			switch (session->sessionDirection)
+			{
+				case FastPacketProtocolSession::Direction::Receive:
+				{
+					if (SystemTiming::time_expired_ms(session->timestamp_ms, FP_TIMEOUT_MS))
+					{
+						CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[FP]: Rx session timed out.");
+						close_session(session, false);
+					}
+				}
+				break;
 
-					if ((!txSessionCancelled) &&
-					    (session->processedPacketsThisSession >= session->packetCount))
+				case FastPacketProtocolSession::Direction::Transmit:
+				{
+					if (session->transmitFailed)
+					{
+						close_session(session, false);
+					}
+					else if (session->processedPacketsThisSession > session->packetCount)
 					{
 						add_session_history(session);
 						close_session(session, true); // Session is done!
 					}
+					else if (SystemTiming::time_expired_ms(session->timestamp_ms, FP_TIMEOUT_MS))
+					{
+						CANStackLogger::CAN_stack_log(CANStackLogger::LoggingLevel::Error, "[FP]: Tx session timed out.");
+						close_session(session, false);
+					}
 				}
 				break;
 			}
@@ -1,18 +1,75 @@
 #include <gtest/gtest.h>
 
+#include "helpers/test_network.hpp"
 #include "isobus/hardware_integration/can_hardware_interface.hpp"
 #include "isobus/hardware_integration/virtual_can_plugin.hpp"
 #include "isobus/isobus/can_NAME_filter.hpp"
 #include "isobus/isobus/can_constants.hpp"
 #include "isobus/isobus/can_internal_control_function.hpp"
+#include "isobus/isobus/can_network_configuration.hpp"
 #include "isobus/isobus/can_network_manager.hpp"
+#include "isobus/isobus/can_network_snapshot.hpp"
 #include "isobus/isobus/can_partnered_control_function.hpp"
+#include "isobus/utility/system_timing.hpp"
 
+#include <atomic>
 #include <chrono>
+#include <cstdio>
+#include <memory>
+#include <set>
 #include <thread>
+#include <vector>
 
 using namespace isobus;
 
+namespace
+{
+	void update_network()
+	{
+		CANNetworkManager::CANNetwork.update();
+	}
+
+	void receive_frame(HardwareInterfaceCANFrame &rxFrame, void *parentPointer)
+	{
+		CANNetworkManager::CANNetwork.can_lib_process_rx_message(rxFrame, parentPointer);
+	}
+
+	std::atomic<std::uint32_t> requestsForClaim = { 0 };
+	std::atomic<std::uint32_t> messagesFromWrongPort = { 0 };
+	std::atomic<std::uint32_t> messagesFromFirstECU = { 0 };
+	std::atomic<std::uint32_t> messagesFromSecondECU = { 0 };
+
+	/// Counts the requests for address claim sent on channel 0, then passes every frame to the stack
+	void count_requests_for_claim(HardwareInterfaceCANFrame &rxFrame, void *parentPointer)
+	{
+		if ((1 == rxFrame.channel) &&
+		    (0xEA00 == CANIdentifier(rxFrame.identifier).get_parameter_group_number()))
+		{
+			requestsForClaim++;
+		}
+		CANNetworkManager::CANNetwork.can_lib_process_rx_message(rxFrame, parentPointer);
+	}
+
+	/// Counts messages by the port they arrived on, and checks that their source is on that port too
+	void count_message_by_port(CANMessage *message, void *)
+	{
+		ControlFunction *source = message->get_source_control_function();
+
+		if ((nullptr == source) || (source->get_can_port() != message->get_can_port_index()))
+		{
+			messagesFromWrongPort++;
+		}
+		else if (1 == message->get_can_port_index())
+		{
+			messagesFromFirstECU++;
+		}
+		else
+		{
+			messagesFromSecondECU++;
+		}
+	}
+} // namespace
+
 TEST(ADDRESS_CLAIM_TESTS, PartneredClaim)
 {
 	std::shared_ptr<VirtualCANPlugin> firstDevice = std::make_shared<VirtualCANPlugin>();
@@ -22,16 +79,8 @@ TEST(ADDRESS_CLAIM_TESTS, PartneredClaim)
 	CANHardwareInterface::assign_can_channel_frame_handler(1, secondDevice);
 	CANHardwareInterface::start();
 
-	CANHardwareInterface::add_can_lib_update_callback(
-	  [] {
-		  CANNetworkManager::CANNetwork.update();
-	  },
-	  nullptr);
-	CANHardwareInterface::add_raw_can_message_rx_callback(
-	  [](HardwareInterfaceCANFrame &rxFrame, void *parentPointer) {
-		  CANNetworkManager::CANNetwork.can_lib_process_rx_message(rxFrame, parentPointer);
-	  },
-	  nullptr);
+	CANHardwareInterface::add_can_lib_update_callback(update_network, nullptr);
+	CANHardwareInterface::add_raw_can_message_rx_callback(receive_frame, nullptr);
 
 	std::this_thread::sleep_for(std::chrono::milliseconds(250));
 
@@ -69,5 +118,304 @@ TEST(ADDRESS_CLAIM_TESTS, PartneredClaim)
 	EXPECT_TRUE(firstPartneredSecondECU.get_address_valid());
 	EXPECT_TRUE(secondPartneredFirstEcu.get_address_valid());
 
+	CANHardwareInterface::remove_can_lib_update_callback(update_network, nullptr);
+	CANHardwareInterface::remove_raw_can_message_rx_callback(receive_frame, nullptr);
+	CANHardwareInterface::stop();
+}
+
+TEST(ADDRESS_CLAIM_TESTS, CoordinatedClaim)
+{
+	constexpr std::uint8_t NUMBER_OF_ECUS = 8;
+	requestsForClaim = 0;
+
+	CANNetworkConfiguration::set_coordinated_address_claiming(true);
+	EXPECT_TRUE(CANNetworkConfiguration::get_coordinated_address_claiming());
+
+	std::shared_ptr<VirtualCANPlugin> firstDevice = std::make_shared<VirtualCANPlugin>();
+	std::shared_ptr<VirtualCANPlugin> secondDevice = std::make_shared<VirtualCANPlugin>();
+	CANHardwareInterface::set_number_of_can_channels(2);
+	CANHardwareInterface::assign_can_channel_frame_handler(0, firstDevice);
+	CANHardwareInterface::assign_can_channel_frame_handler(1, secondDevice);
+	CANHardwareInterface::start();
+
+	CANHardwareInterface::add_can_lib_update_callback(update_network, nullptr);
+	CANHardwareInterface::add_raw_can_message_rx_callback(count_requests_for_claim, nullptr);
+
+	// All of them want the same address, the lowest NAME should get it and the rest should move
+	std::vector<std::unique_ptr<InternalControlFunction>> internalECUs;
+	for (std::uint8_t i = 0; i < NUMBER_OF_ECUS; i++)
+	{
+		NAME ecuName(0);
+		ecuName.set_arbitrary_address_capable(true);
+		ecuName.set_industry_group(2);
+		ecuName.set_function_code(static_cast<std::uint8_t>(NAME::Function::OffVehicleGateway));
+		ecuName.set_identity_number(NUMBER_OF_ECUS - i);
+		ecuName.set_manufacturer_code(69);
+		internalECUs.emplace_back(new InternalControlFunction(ecuName, 0x80, 0));
+	}
+
+	bool allValid = false;
+	for (std::uint32_t i = 0; (i < 200) && (!allValid); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		allValid = true;
+		for (auto &ecu : internalECUs)
+		{
+			allValid = allValid && ecu->get_address_valid();
+		}
+	}
+	ASSERT_TRUE(allValid);
+
+	std::set<std::uint8_t> claimedAddresses;
+	for (auto &ecu : internalECUs)
+	{
+		claimedAddresses.insert(ecu->get_address());
+	}
+	EXPECT_EQ(NUMBER_OF_ECUS, claimedAddresses.size());
+	EXPECT_EQ(0x80, internalECUs.back()->get_address());
+	EXPECT_EQ(1u, requestsForClaim);
+
+	CANHardwareInterface::remove_can_lib_update_callback(update_network, nullptr);
+	CANHardwareInterface::remove_raw_can_message_rx_callback(count_requests_for_claim, nullptr);
+	CANHardwareInterface::stop();
+	internalECUs.clear();
+	CANNetworkConfiguration::set_coordinated_address_claiming(false);
+}
+
+TEST(ADDRESS_CLAIM_TESTS, NetworkSnapshotFile)
+{
+	const std::string filename = "network_snapshot_test.txt";
+	NetworkSnapshot snapshot;
+	NetworkSnapshot loadedSnapshot;
+	NAME testName(0);
+	testName.set_arbitrary_address_capable(true);
+	testName.set_function_code(static_cast<std::uint8_t>(NAME::Function::SeatControl));
+	testName.set_identity_number(1234);
+	testName.set_manufacturer_code(69);
+
+	snapshot.set_internal_control_function_address(0, testName, 0x90);
+	snapshot.set_internal_control_function_address(0, testName, 0x91);
+	snapshot.set_partner_address(1, testName, 0x26);
+	snapshot.set_vt_version_label(testName, "V 1.0");
+	EXPECT_EQ(1u, snapshot.get_number_internal_control_functions());
+	EXPECT_EQ(0x91, snapshot.get_internal_control_function_address(0, testName));
+	EXPECT_EQ(NULL_CAN_ADDRESS, snapshot.get_internal_control_function_address(1, testName));
+
+	ASSERT_TRUE(snapshot.save(filename));
+	ASSERT_TRUE(loadedSnapshot.load(filename));
+	EXPECT_EQ(0x91, loadedSnapshot.get_internal_control_function_address(0, testName));
+	EXPECT_EQ(1u, loadedSnapshot.get_number_partners());
+	EXPECT_EQ("V 1.0", loadedSnapshot.get_vt_version_label(testName));
+
+	// A damaged file leaves the snapshot empty rather than half loaded
+	FILE *damagedFile = std::fopen(filename.c_str(), "a");
+	ASSERT_NE(nullptr, damagedFile);
+	std::fputs("icf 0 zz\n", damagedFile);
+	std::fclose(damagedFile);
+	EXPECT_FALSE(loadedSnapshot.load(filename));
+	EXPECT_EQ(0u, loadedSnapshot.get_number_internal_control_functions());
+	EXPECT_EQ("", loadedSnapshot.get_vt_version_label(testName));
+	EXPECT_FALSE(loadedSnapshot.load("this_file_does_not_exist.txt"));
+	std::remove(filename.c_str());
+}
+
+TEST(ADDRESS_CLAIM_TESTS, WarmStartFromSnapshot)
+{
+	std::shared_ptr<VirtualCANPlugin> firstDevice = std::make_shared<VirtualCANPlugin>();
+	std::shared_ptr<VirtualCANPlugin> secondDevice = std::make_shared<VirtualCANPlugin>();
+	CANHardwareInterface::set_number_of_can_channels(2);
+	CANHardwareInterface::assign_can_channel_frame_handler(0, firstDevice);
+	CANHardwareInterface::assign_can_channel_frame_handler(1, secondDevice);
+	CANHardwareInterface::start();
+
+	CANHardwareInterface::add_can_lib_update_callback(update_network, nullptr);
+	CANHardwareInterface::add_raw_can_message_rx_callback(receive_frame, nullptr);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+	NAME ourName(0);
+	ourName.set_arbitrary_address_capable(true);
+	ourName.set_industry_group(1);
+	ourName.set_function_code(static_cast<std::uint8_t>(NAME::Function::InstrumentCluster));
+	ourName.set_identity_number(1);
+	ourName.set_manufacturer_code(69);
+
+	NAME bodyName(0);
+	bodyName.set_arbitrary_address_capable(true);
+	bodyName.set_industry_group(1);
+	bodyName.set_function_code(static_cast<std::uint8_t>(NAME::Function::BodyControl));
+	bodyName.set_identity_number(2);
+	bodyName.set_manufacturer_code(69);
+
+	NAME recorderName(0);
+	recorderName.set_arbitrary_address_capable(true);
+	recorderName.set_industry_group(1);
+	recorderName.set_function_code(static_cast<std::uint8_t>(NAME::Function::TripRecorder));
+	recorderName.set_identity_number(3);
+	recorderName.set_manufacturer_code(69);
+
+	// Last time, we were at 0x90, the body controller was at 0x91, and there was a trip recorder at 0x95
+	std::shared_ptr<NetworkSnapshot> snapshot = std::make_shared<NetworkSnapshot>();
+	snapshot->set_internal_control_function_address(0, ourName, 0x90);
+	snapshot->set_partner_address(0, bodyName, 0x91);
+	snapshot->set_partner_address(0, recorderName, 0x95);
+	CANNetworkManager::CANNetwork.set_network_snapshot(snapshot);
+
+	InternalControlFunction ourECU(ourName, 0x1C, 0);
+	PartneredControlFunction bodyPartner(0, { NAMEFilter(NAME::NAMEParameters::FunctionCode, static_cast<std::uint8_t>(NAME::Function::BodyControl)) });
+	PartneredControlFunction recorderPartner(0, { NAMEFilter(NAME::NAMEParameters::FunctionCode, static_cast<std::uint8_t>(NAME::Function::TripRecorder)) });
+
+	// The partners are usable right away, before anything has claimed
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	EXPECT_EQ(0x91, bodyPartner.get_address());
+	EXPECT_EQ(bodyName, bodyPartner.get_NAME());
+	EXPECT_TRUE(CANNetworkManager::CANNetwork.get_is_partner_binding_provisional(&bodyPartner));
+	EXPECT_EQ(0x95, recorderPartner.get_address());
+
+	// The body controller comes back at a different address this time, and the trip recorder never comes back
+	InternalControlFunction bodyECU(bodyName, 0x92, 1);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	EXPECT_EQ(0x90, ourECU.get_address());
+	EXPECT_EQ(0x92, bodyPartner.get_address());
+	EXPECT_FALSE(CANNetworkManager::CANNetwork.get_is_partner_binding_provisional(&bodyPartner));
+	EXPECT_TRUE(CANNetworkManager::CANNetwork.get_is_partner_binding_provisional(&recorderPartner));
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(CANNetworkManager::PROVISIONAL_PARTNER_TIMEOUT_MS));
+	EXPECT_FALSE(recorderPartner.get_address_valid());
+	EXPECT_FALSE(CANNetworkManager::CANNetwork.get_is_partner_binding_provisional(&recorderPartner));
+	EXPECT_EQ(0x92, bodyPartner.get_address());
+
+	snapshot->capture();
+	EXPECT_EQ(0x90, snapshot->get_internal_control_function_address(0, ourName));
+	EXPECT_EQ(0x92, snapshot->get_internal_control_function_address(1, bodyName));
+
+	CANHardwareInterface::remove_can_lib_update_callback(update_network, nullptr);
+	CANHardwareInterface::remove_raw_can_message_rx_callback(receive_frame, nullptr);
+	CANHardwareInterface::stop();
+	CANNetworkManager::CANNetwork.set_network_snapshot(nullptr);
+}
+
+TEST(ADDRESS_CLAIM_TESTS, AddressTableIsPerPort)
+{
+	constexpr std::uint32_t TEST_PGN = 0xFF42;
+	messagesFromWrongPort = 0;
+	messagesFromFirstECU = 0;
+	messagesFromSecondECU = 0;
+
+	std::shared_ptr<VirtualCANPlugin> firstDevice = std::make_shared<VirtualCANPlugin>();
+	std::shared_ptr<VirtualCANPlugin> secondDevice = std::make_shared<VirtualCANPlugin>();
+	CANHardwareInterface::set_number_of_can_channels(2);
+	CANHardwareInterface::assign_can_channel_frame_handler(0, firstDevice);
+	CANHardwareInterface::assign_can_channel_frame_handler(1, secondDevice);
+	CANHardwareInterface::start();
+
+	CANHardwareInterface::add_can_lib_update_callback(update_network, nullptr);
+	CANHardwareInterface::add_raw_can_message_rx_callback(receive_frame, nullptr);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+	NAME firstName(0);
+	firstName.set_arbitrary_address_capable(true);
+	firstName.set_industry_group(1);
+	firstName.set_function_code(static_cast<std::uint8_t>(NAME::Function::CabClimateControl));
+	firstName.set_identity_number(10);
+	firstName.set_manufacturer_code(69);
+	InternalControlFunction firstInternalECU(firstName, 0x1C, 0);
+
+	NAME secondName(0);
+	secondName.set_arbitrary_address_capable(true);
+	secondName.set_industry_group(1);
+	secondName.set_function_code(static_cast<std::uint8_t>(NAME::Function::SeatControl));
+	secondName.set_identity_number(11);
+	secondName.set_manufacturer_code(69);
+	InternalControlFunction secondInternalECU(secondName, 0x1D, 1);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	ASSERT_TRUE(firstInternalECU.get_address_valid());
+	ASSERT_TRUE(secondInternalECU.get_address_valid());
+
+	// Each ECU's messages are heard on the other port, and must come from that port's control function for the address,
+	// not from the internal control function that has the same address on the other port.
+	CANNetworkManager::CANNetwork.add_global_parameter_group_number_callback(TEST_PGN, count_message_by_port, nullptr);
+
+	const std::uint8_t testData[CAN_DATA_LENGTH] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	EXPECT_TRUE(CANNetworkManager::CANNetwork.send_can_message(TEST_PGN, testData, CAN_DATA_LENGTH, &firstInternalECU));
+	EXPECT_TRUE(CANNetworkManager::CANNetwork.send_can_message(TEST_PGN, testData, CAN_DATA_LENGTH, &secondInternalECU));
+
+	for (std::uint32_t i = 0; (i < 50) && ((messagesFromFirstECU + messagesFromSecondECU + messagesFromWrongPort) < 2); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	EXPECT_EQ(1u, messagesFromFirstECU);
+	EXPECT_EQ(1u, messagesFromSecondECU);
+	EXPECT_EQ(0u, messagesFromWrongPort);
+
+	CANNetworkManager::CANNetwork.remove_global_parameter_group_number_callback(TEST_PGN, count_message_by_port, nullptr);
+	CANHardwareInterface::remove_can_lib_update_callback(update_network, nullptr);
+	CANHardwareInterface::remove_raw_can_message_rx_callback(receive_frame, nullptr);
 	CANHardwareInterface::stop();
 }
+
+/// Runs each test on the test network, and stops it and restores the defaults when the test ends, even if the test failed
+class ADDRESS_CLAIM_NETWORK_TESTS : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		test_helpers::start_test_network();
+	}
+
+	void TearDown() override
+	{
+		test_helpers::stop_test_network();
+		CANNetworkConfiguration::set_coordinated_address_claiming(false);
+	}
+};
+
+TEST_F(ADDRESS_CLAIM_NETWORK_TESTS, CoordinatedReclaimWaitsForContention)
+{
+	constexpr std::uint32_t ADDRESS_CLAIM_PGN = 0xEE00;
+	constexpr std::uint32_t ADDRESS_CONTENTION_TIME_MS = 250;
+	CANNetworkConfiguration::set_coordinated_address_claiming(true);
+
+	NAME ecuName(0);
+	ecuName.set_arbitrary_address_capable(true);
+	ecuName.set_industry_group(2);
+	ecuName.set_function_code(static_cast<std::uint8_t>(NAME::Function::OffVehicleGateway));
+	ecuName.set_identity_number(100);
+	ecuName.set_manufacturer_code(69);
+	InternalControlFunction internalECU(ecuName, 0x90, 0);
+
+	for (std::uint32_t i = 0; (i < 100) && (!internalECU.get_address_valid()); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	ASSERT_TRUE(internalECU.get_address_valid());
+	ASSERT_EQ(0x90, internalECU.get_address());
+
+	// A control function with a lower NAME takes our address
+	NAME competingName = ecuName;
+	HardwareInterfaceCANFrame competingClaim;
+	HardwareInterfaceCANFrame newClaim;
+	ASSERT_TRUE(test_helpers::wait_for_transmitted_frame(ADDRESS_CLAIM_PGN, 0, newClaim));
+	competingName.set_identity_number(1);
+	competingClaim.timestamp_us = 0;
+	competingClaim.identifier = CANIdentifier(CANIdentifier::Type::Extended, ADDRESS_CLAIM_PGN, CANIdentifier::CANPriority::PriorityDefault6, 0xFF, 0x90).get_identifier();
+	competingClaim.channel = 0;
+	competingClaim.dataLength = 8;
+	competingClaim.isExtendedFrame = true;
+	for (std::uint8_t i = 0; i < 8; i++)
+	{
+		competingClaim.data[i] = static_cast<std::uint8_t>(competingName.get_full_name() >> (8 * i));
+	}
+
+	const std::size_t sentClaims = test_helpers::count_transmitted_frames(ADDRESS_CLAIM_PGN);
+	const std::uint32_t stolenTimestamp = SystemTiming::get_timestamp_ms();
+	CANNetworkManager::CANNetwork.can_lib_process_rx_message(competingClaim, nullptr);
+
+	// Our next claim, at a new address, only goes out once the contention period is over
+	ASSERT_TRUE(test_helpers::wait_for_transmitted_frame(ADDRESS_CLAIM_PGN, sentClaims, newClaim));
+	EXPECT_GE(SystemTiming::get_time_elapsed_ms(stolenTimestamp), ADDRESS_CONTENTION_TIME_MS);
+	EXPECT_NE(0x90, CANIdentifier(newClaim.identifier).get_source_address());
+}
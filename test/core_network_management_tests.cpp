@@ -1,9 +1,16 @@
 #include <gtest/gtest.h>
 
 #include "isobus/isobus/can_internal_control_function.hpp"
+#include "isobus/isobus/can_latest_value_cache.hpp"
+#include "isobus/isobus/can_managed_message.hpp"
+#include "isobus/isobus/can_network_manager.hpp"
 #include "isobus/isobus/can_partnered_control_function.hpp"
+#include "isobus/isobus/can_signal_database.hpp"
 
+#include <atomic>
+#include <cmath>
 #include <memory>
+#include <thread>
 
 using namespace isobus;
 
@@ -36,3 +43,352 @@ TEST(CORE_TESTS, TestCreateAndDestroyICFs)
 	delete TestIcf2;
 	auto TestIcf3 = std::make_shared<isobus::InternalControlFunction>(TestDeviceNAME, 0x81, 0);
 }
+
+TEST(CORE_TESTS, CompiledNAMEFilters)
+{
+	NAME testName(0);
+	testName.set_arbitrary_address_capable(true);
+	testName.set_industry_group(2);
+	testName.set_device_class(4);
+	testName.set_device_class_instance(3);
+	testName.set_function_code(static_cast<std::uint8_t>(NAME::Function::VirtualTerminal));
+	testName.set_function_instance(1);
+	testName.set_ecu_instance(5);
+	testName.set_manufacturer_code(1407);
+	testName.set_identity_number(123456);
+
+	const std::vector<NAMEFilter> matchingFilters = {
+		NAMEFilter(NAME::NAMEParameters::ArbitraryAddressCapable, 1),
+		NAMEFilter(NAME::NAMEParameters::IndustryGroup, 2),
+		NAMEFilter(NAME::NAMEParameters::DeviceClass, 4),
+		NAMEFilter(NAME::NAMEParameters::DeviceClassInstance, 3),
+		NAMEFilter(NAME::NAMEParameters::FunctionCode, static_cast<std::uint8_t>(NAME::Function::VirtualTerminal)),
+		NAMEFilter(NAME::NAMEParameters::FunctionInstance, 1),
+		NAMEFilter(NAME::NAMEParameters::EcuInstance, 5),
+		NAMEFilter(NAME::NAMEParameters::ManufacturerCode, 1407),
+		NAMEFilter(NAME::NAMEParameters::IdentityNumber, 123456)
+	};
+
+	// Each filter on its own should agree with the component based check, for both a matching and a non-matching NAME
+	for (const auto &filter : matchingFilters)
+	{
+		std::uint64_t mask;
+		std::uint64_t value;
+		ASSERT_TRUE(filter.get_name_mask(mask, value));
+		EXPECT_TRUE(filter.check_name_matches_filter(testName));
+		EXPECT_EQ(value, testName.get_full_name() & mask);
+		EXPECT_FALSE(filter.check_name_matches_filter(NAME(testName.get_full_name() ^ mask)));
+		EXPECT_NE(value, (testName.get_full_name() ^ mask) & mask);
+	}
+
+	PartneredControlFunction allFilters(0, matchingFilters);
+	EXPECT_TRUE(allFilters.check_matches_name(testName));
+	EXPECT_FALSE(allFilters.check_matches_name(NAME(testName.get_full_name() ^ 0x01)));
+
+	// Filters that can never match
+	PartneredControlFunction noFilters(0, {});
+	PartneredControlFunction conflictingFilters(0, { NAMEFilter(NAME::NAMEParameters::EcuInstance, 5), NAMEFilter(NAME::NAMEParameters::EcuInstance, 4) });
+	PartneredControlFunction outOfRangeFilter(0, { NAMEFilter(NAME::NAMEParameters::FunctionCode, 0x100 | static_cast<std::uint8_t>(NAME::Function::VirtualTerminal)) });
+	EXPECT_FALSE(noFilters.check_matches_name(testName));
+	EXPECT_FALSE(noFilters.check_matches_name(NAME(0)));
+	EXPECT_FALSE(conflictingFilters.check_matches_name(testName));
+	EXPECT_FALSE(outOfRangeFilter.check_matches_name(testName));
+
+	// The first matching partner on the channel is found, even past the first block
+	std::vector<std::unique_ptr<PartneredControlFunction>> otherPartners;
+	for (std::uint8_t i = 0; i < 20; i++)
+	{
+		otherPartners.emplace_back(new PartneredControlFunction(0, { NAMEFilter(NAME::NAMEParameters::FunctionCode, i) }));
+	}
+	PartneredControlFunction functionOnly(0, { NAMEFilter(NAME::NAMEParameters::FunctionCode, static_cast<std::uint8_t>(NAME::Function::VirtualTerminal)) });
+	PartneredControlFunction otherChannel(1, { NAMEFilter(NAME::NAMEParameters::ManufacturerCode, 1407) });
+
+	EXPECT_EQ(&allFilters, PartneredControlFunction::find_partner_matching_name(0, testName));
+	EXPECT_EQ(&functionOnly, PartneredControlFunction::find_partner_matching_name(0, NAME(testName.get_full_name() ^ 0x01)));
+	EXPECT_EQ(&otherChannel, PartneredControlFunction::find_partner_matching_name(1, testName));
+	EXPECT_EQ(nullptr, PartneredControlFunction::find_partner_matching_name(2, testName));
+	EXPECT_EQ(nullptr, PartneredControlFunction::find_partner_matching_name(CAN_PORT_MAXIMUM, testName));
+
+	NAME engineName(0);
+	engineName.set_function_code(static_cast<std::uint8_t>(NAME::Function::Engine));
+	EXPECT_EQ(otherPartners[0].get(), PartneredControlFunction::find_partner_matching_name(0, engineName));
+	engineName.set_function_code(19);
+	EXPECT_EQ(otherPartners[19].get(), PartneredControlFunction::find_partner_matching_name(0, engineName));
+
+	// Deleted partners stop matching
+	otherPartners.clear();
+	EXPECT_EQ(nullptr, PartneredControlFunction::find_partner_matching_name(0, engineName));
+}
+
+TEST(CORE_TESTS, LatestValueCache)
+{
+	LatestValueCache cache;
+	LatestValueCache::ValueInfo info;
+	std::uint8_t buffer[LatestValueCache::MAX_DATA_LENGTH] = { 0 };
+	CANLibManagedMessage testMessage(0);
+
+	EXPECT_TRUE(cache.add_parameter_group_number(0xFE49));
+	EXPECT_TRUE(cache.add_parameter_group_number(0xFE49));
+	EXPECT_TRUE(cache.get_is_parameter_group_number_cached(0xFE49));
+	EXPECT_FALSE(cache.get_is_parameter_group_number_cached(0xFE48));
+	EXPECT_FALSE(cache.get_latest_value(0, 0xFE49, 0x26, buffer, sizeof(buffer), info));
+	EXPECT_EQ(LatestValueCache::NO_VALUE_AGE, cache.get_age_ms(0, 0xFE49, 0x26));
+
+	testMessage.set_identifier(CANIdentifier(CANIdentifier::Type::Extended, 0xFE49, CANIdentifier::CANPriority::PriorityDefault6, 0xFF, 0x26));
+	testMessage.set_data_size(8);
+	for (std::uint8_t i = 0; i < 8; i++)
+	{
+		testMessage.set_data(i + 1, i);
+	}
+	cache.record(testMessage);
+
+	ASSERT_TRUE(cache.get_latest_value(0, 0xFE49, 0x26, buffer, sizeof(buffer), info));
+	EXPECT_EQ(8, info.dataLength);
+	EXPECT_EQ(0x26, info.sourceAddress);
+	EXPECT_EQ(1, buffer[0]);
+	EXPECT_EQ(8, buffer[7]);
+	EXPECT_LT(cache.get_age_ms(0, 0xFE49, 0x26), 1000u);
+	EXPECT_FALSE(cache.get_latest_value(1, 0xFE49, 0x26, buffer, sizeof(buffer), info));
+
+	// A second source, and the latest value from any source
+	testMessage.set_identifier(CANIdentifier(CANIdentifier::Type::Extended, 0xFE49, CANIdentifier::CANPriority::PriorityDefault6, 0xFF, 0x27));
+	testMessage.set_data(0xAA, 0);
+	cache.record(testMessage);
+	ASSERT_TRUE(cache.get_latest_value(0, 0xFE49, 0xFF, buffer, 2, info));
+	EXPECT_EQ(0x27, info.sourceAddress);
+	EXPECT_EQ(8, info.dataLength);
+	EXPECT_EQ(0xAA, buffer[0]);
+	ASSERT_TRUE(cache.get_latest_value(0, 0xFE49, 0x26, buffer, sizeof(buffer), info));
+	EXPECT_EQ(1, buffer[0]);
+
+	// PGNs that aren't cached are ignored
+	testMessage.set_identifier(CANIdentifier(CANIdentifier::Type::Extended, 0xFE48, CANIdentifier::CANPriority::PriorityDefault6, 0xFF, 0x26));
+	cache.record(testMessage);
+	EXPECT_FALSE(cache.get_latest_value(0, 0xFE48, 0x26, buffer, sizeof(buffer), info));
+}
+
+TEST(CORE_TESTS, LatestValueCacheConcurrentReads)
+{
+	LatestValueCache cache;
+	std::atomic<bool> running(true);
+	std::atomic<std::uint32_t> tornReads(0);
+	std::atomic<std::uint32_t> goodReads(0);
+	ASSERT_TRUE(cache.add_parameter_group_number(0xFEF1));
+
+	// Every byte of each payload is the same, so a read that mixes two payloads is easy to spot
+	std::thread reader([&cache, &running, &tornReads, &goodReads]() {
+		while (running)
+		{
+			LatestValueCache::ValueInfo info;
+			std::uint8_t buffer[32];
+
+			if (cache.get_latest_value(0, 0xFEF1, 0x1C, buffer, sizeof(buffer), info))
+			{
+				for (std::uint8_t i = 1; i < info.dataLength; i++)
+				{
+					if (buffer[i] != buffer[0])
+					{
+						tornReads++;
+						break;
+					}
+				}
+				goodReads++;
+			}
+		}
+	});
+
+	CANLibManagedMessage testMessage(0);
+	testMessage.set_identifier(CANIdentifier(CANIdentifier::Type::Extended, 0xFEF1, CANIdentifier::CANPriority::PriorityDefault6, 0xFF, 0x1C));
+	testMessage.set_data_size(32);
+	for (std::uint32_t i = 0; (i < 200000) || (0 == goodReads); i++)
+	{
+		for (std::uint8_t j = 0; j < 32; j++)
+		{
+			testMessage.set_data(static_cast<std::uint8_t>(i), j);
+		}
+		cache.record(testMessage);
+	}
+	running = false;
+	reader.join();
+
+	EXPECT_EQ(0u, tornReads);
+	EXPECT_NE(0u, goodReads);
+}
+
+static const std::string TEST_DBC = "VERSION \"\"\n"
+                                    "\n"
+                                    "BO_ 2364540158 EEC1: 8 Vector__XXX\n"
+                                    " SG_ EngineSpeed : 24|16@1+ (0.125,0) [0|8031.875] \"rpm\" Vector__XXX\n"
+                                    " SG_ ActualEnginePercentTorque : 16|8@1+ (1,-125) [-125|125] \"%\" Vector__XXX\n"
+                                    " SG_ EngineTorqueMode : 0|4@1+ (1,0) [0|15] \"\" Vector__XXX\n"
+                                    "\n"
+                                    "BO_ 2566848766 TestMotorola: 8 Vector__XXX\n"
+                                    " SG_ BigWord : 7|16@0+ (1,0) [0|65535] \"\" Vector__XXX\n"
+                                    " SG_ SignedValue : 16|8@1- (0.5,0) [-64|63.5] \"\" Vector__XXX\n"
+                                    " SG_ Mode M : 24|8@1+ (1,0) [0|255] \"\" Vector__XXX\n"
+                                    " SG_ ModeOneValue m1 : 32|8@1+ (1,0) [0|255] \"\" Vector__XXX\n"
+                                    " SG_ ModeTwoValue m2 : 32|8@1+ (2,0) [0|510] \"\" Vector__XXX\n"
+                                    " SG_ TooWide : 60|16@1+ (1,0) [0|65535] \"\" Vector__XXX\n"
+                                    "\n"
+                                    "BO_ 1024 StandardFrame: 8 Vector__XXX\n"
+                                    " SG_ Ignored : 0|8@1+ (1,0) [0|255] \"\" Vector__XXX\n";
+
+TEST(CORE_TESTS, SignalDatabaseBatchDecode)
+{
+	SignalDatabase database;
+	SignalDatabase::DecodedBatch batch;
+	std::size_t eec1Index = 0;
+	std::size_t testIndex = 0;
+	std::size_t signalIndex = 0;
+
+	EXPECT_FALSE(database.load_string("not a dbc file"));
+	ASSERT_TRUE(database.load_string(TEST_DBC));
+	ASSERT_EQ(2u, database.get_number_messages());
+	ASSERT_TRUE(database.get_message_index(0xF004, eec1Index));
+	ASSERT_TRUE(database.get_message_index(0xFF00, testIndex));
+	EXPECT_FALSE(database.get_message_index(0x400, signalIndex));
+	EXPECT_EQ("EEC1", database.get_message(eec1Index).name);
+	EXPECT_EQ(5u, database.get_message(testIndex).signals.size()); // TooWide runs off the end of the message
+	EXPECT_TRUE(database.get_signal_index(eec1Index, "EngineSpeed", signalIndex));
+	EXPECT_EQ("rpm", database.get_message(eec1Index).signals.at(signalIndex).unit);
+	EXPECT_FALSE(database.get_signal_index(eec1Index, "VehicleSpeed", signalIndex));
+
+	std::vector<HardwareInterfaceCANFrame> frames(4);
+	for (std::size_t i = 0; i < frames.size(); i++)
+	{
+		frames[i].timestamp_us = 1000 * i;
+		frames[i].channel = 1;
+		frames[i].dataLength = 8;
+		frames[i].isExtendedFrame = true;
+		std::fill(std::begin(frames[i].data), std::end(frames[i].data), 0xFF);
+	}
+
+	// Two EEC1s from different engines, two of the test message with different modes
+	frames[0].identifier = CANIdentifier(CANIdentifier::Type::Extended, 0xF004, CANIdentifier::CANPriority::PriorityDefault6, 0xFF, 0x00).get_identifier();
+	frames[0].data[0] = 0xF3;
+	frames[0].data[2] = 150;
+	frames[0].data[3] = 0xE0;
+	frames[0].data[4] = 0x2E;
+	frames[1].identifier = CANIdentifier(CANIdentifier::Type::Extended, 0xF004, CANIdentifier::CANPriority::PriorityDefault6, 0xFF, 0x01).get_identifier();
+	frames[1].data[2] = 100;
+	frames[1].data[3] = 0x40;
+	frames[1].data[4] = 0x1F;
+	frames[2].identifier = CANIdentifier(CANIdentifier::Type::Extended, 0xFF00, CANIdentifier::CANPriority::PriorityDefault6, 0xFF, 0x80).get_identifier();
+	frames[2].data[0] = 0x12;
+	frames[2].data[1] = 0x34;
+	frames[2].data[2] = 0xF6;
+	frames[2].data[3] = 1;
+	frames[2].data[4] = 7;
+	frames[3].identifier = frames[2].identifier;
+	frames[3].data[2] = 0x0A;
+	frames[3].data[3] = 2;
+	frames[3].data[4] = 7;
+
+	EXPECT_EQ(4u, database.decode_frames(frames.data(), frames.size(), batch));
+	EXPECT_EQ(0u, batch.get_number_staged_rows());
+	ASSERT_EQ(2u, batch.get_number_rows(eec1Index));
+	ASSERT_EQ(2u, batch.get_number_rows(testIndex));
+
+	ASSERT_TRUE(database.get_signal_index(eec1Index, "EngineSpeed", signalIndex));
+	EXPECT_DOUBLE_EQ(1500.0, batch.get_column(eec1Index, signalIndex).at(0));
+	EXPECT_DOUBLE_EQ(1000.0, batch.get_column(eec1Index, signalIndex).at(1));
+	ASSERT_TRUE(database.get_signal_index(eec1Index, "ActualEnginePercentTorque", signalIndex));
+	EXPECT_DOUBLE_EQ(25.0, batch.get_column(eec1Index, signalIndex).at(0));
+	EXPECT_DOUBLE_EQ(-25.0, batch.get_column(eec1Index, signalIndex).at(1));
+	ASSERT_TRUE(database.get_signal_index(eec1Index, "EngineTorqueMode", signalIndex));
+	EXPECT_DOUBLE_EQ(3.0, batch.get_column(eec1Index, signalIndex).at(0));
+	EXPECT_EQ(0x00, batch.get_source_addresses(eec1Index).at(0));
+	EXPECT_EQ(0x01, batch.get_source_addresses(eec1Index).at(1));
+	EXPECT_EQ(1, batch.get_can_ports(eec1Index).at(1));
+	EXPECT_EQ(1000u, batch.get_timestamps(eec1Index).at(1));
+
+	ASSERT_TRUE(database.get_signal_index(testIndex, "BigWord", signalIndex));
+	EXPECT_DOUBLE_EQ(0x1234, batch.get_column(testIndex, signalIndex).at(0));
+	ASSERT_TRUE(database.get_signal_index(testIndex, "SignedValue", signalIndex));
+	EXPECT_DOUBLE_EQ(-5.0, batch.get_column(testIndex, signalIndex).at(0));
+	EXPECT_DOUBLE_EQ(5.0, batch.get_column(testIndex, signalIndex).at(1));
+	ASSERT_TRUE(database.get_signal_index(testIndex, "ModeOneValue", signalIndex));
+	EXPECT_DOUBLE_EQ(7.0, batch.get_column(testIndex, signalIndex).at(0));
+	EXPECT_TRUE(std::isnan(batch.get_column(testIndex, signalIndex).at(1)));
+	ASSERT_TRUE(database.get_signal_index(testIndex, "ModeTwoValue", signalIndex));
+	EXPECT_TRUE(std::isnan(batch.get_column(testIndex, signalIndex).at(0)));
+	EXPECT_DOUBLE_EQ(14.0, batch.get_column(testIndex, signalIndex).at(1));
+
+	// Rows keep accumulating until the batch is cleared
+	EXPECT_EQ(2u, database.decode_frames(frames.data(), 2, batch));
+	EXPECT_EQ(4u, batch.get_number_rows(eec1Index));
+	batch.clear();
+	EXPECT_EQ(0u, batch.get_number_rows(eec1Index));
+
+	// Standard frames and unknown PGNs are ignored
+	frames[0].isExtendedFrame = false;
+	frames[1].identifier = CANIdentifier(CANIdentifier::Type::Extended, 0xFEF1, CANIdentifier::CANPriority::PriorityDefault6, 0xFF, 0x01).get_identifier();
+	EXPECT_EQ(0u, database.decode_frames(frames.data(), 2, batch));
+
+	// Messages received with the transport protocols decode too
+	CANLibManagedMessage testMessage(0);
+	testMessage.set_identifier(CANIdentifier(CANIdentifier::Type::Extended, 0xF004, CANIdentifier::CANPriority::PriorityDefault6, 0xFF, 0x02));
+	testMessage.set_data_size(8);
+	for (std::uint8_t i = 0; i < 8; i++)
+	{
+		testMessage.set_data(0xFF, i);
+	}
+	testMessage.set_data(0x80, 3);
+	testMessage.set_data(0x0C, 4);
+	EXPECT_EQ(1u, database.decode_messages(&testMessage, 1, 5000, batch));
+	ASSERT_TRUE(database.get_signal_index(eec1Index, "EngineSpeed", signalIndex));
+	EXPECT_DOUBLE_EQ(400.0, batch.get_column(eec1Index, signalIndex).at(0));
+	EXPECT_EQ(5000u, batch.get_timestamps(eec1Index).at(0));
+}
+
+static std::size_t signalBatchRows = 0;
+static double lastDecodedEngineSpeed = 0.0;
+
+static void test_signal_batch_callback(const SignalDatabase &database, const SignalDatabase::DecodedBatch &batch, void *)
+{
+	std::size_t messageIndex = 0;
+	std::size_t signalIndex = 0;
+
+	if ((database.get_message_index(0xF004, messageIndex)) &&
+	    (database.get_signal_index(messageIndex, "EngineSpeed", signalIndex)))
+	{
+		signalBatchRows += batch.get_number_rows(messageIndex);
+
+		if (0 != batch.get_number_rows(messageIndex))
+		{
+			lastDecodedEngineSpeed = batch.get_column(messageIndex, signalIndex).back();
+		}
+	}
+}
+
+TEST(CORE_TESTS, SignalDatabaseNetworkManagerConsumer)
+{
+	auto database = std::make_shared<SignalDatabase>();
+	ASSERT_TRUE(database->load_string(TEST_DBC));
+
+	CANNetworkManager::CANNetwork.update(); // Received messages are ignored until the network manager is initialized
+	CANNetworkManager::CANNetwork.set_signal_database(database, test_signal_batch_callback, nullptr);
+	EXPECT_EQ(database, CANNetworkManager::CANNetwork.get_signal_database());
+
+	HardwareInterfaceCANFrame frame;
+	frame.timestamp_us = 0;
+	frame.channel = 0;
+	frame.dataLength = 8;
+	frame.isExtendedFrame = true;
+	frame.identifier = CANIdentifier(CANIdentifier::Type::Extended, 0xF004, CANIdentifier::CANPriority::PriorityDefault6, 0xFF, 0x00).get_identifier();
+	std::fill(std::begin(frame.data), std::end(frame.data), 0xFF);
+	frame.data[3] = 0xE0;
+	frame.data[4] = 0x2E;
+
+	CANNetworkManager::CANNetwork.can_lib_process_rx_message(frame, nullptr);
+	CANNetworkManager::CANNetwork.can_lib_process_rx_message(frame, nullptr);
+	CANNetworkManager::CANNetwork.update();
+	EXPECT_EQ(2u, signalBatchRows);
+	EXPECT_DOUBLE_EQ(1500.0, lastDecodedEngineSpeed);
+
+	// Nothing is decoded once the database is removed
+	CANNetworkManager::CANNetwork.set_signal_database(nullptr, nullptr, nullptr);
+	CANNetworkManager::CANNetwork.can_lib_process_rx_message(frame, nullptr);
+	CANNetworkManager::CANNetwork.update();
+	EXPECT_EQ(2u, signalBatchRows);
+}
@@ -0,0 +1,742 @@
+#include <gtest/gtest.h>
+
+#include "helpers/test_network.hpp"
+#include "isobus/isobus/can_network_manager.hpp"
+#include "isobus/isobus/isobus_diagnostic_protocol.hpp"
+#include "isobus/isobus/isobus_diagnostic_trouble_code_log.hpp"
+#include "isobus/isobus/isobus_freeze_frame_signal_recorder.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+using namespace isobus;
+
+namespace
+{
+	constexpr std::uint32_t DM1_PGN = 0xFECA;
+	constexpr std::uint32_t DM22_PGN = 0xC300;
+
+	HardwareInterfaceCANFrame make_dm22_frame(DiagnosticProtocol::DiagnosticTroubleCode dtc, std::uint8_t controlByte)
+	{
+		HardwareInterfaceCANFrame frame;
+
+		frame.timestamp_us = 0;
+		frame.identifier = CANIdentifier(CANIdentifier::Type::Extended, 0xC300, CANIdentifier::CANPriority::PriorityDefault6, 0xFF, 0x80).get_identifier();
+		frame.channel = 0;
+		frame.dataLength = 8;
+		frame.isExtendedFrame = true;
+		frame.data[0] = controlByte;
+		frame.data[1] = 0xFF;
+		frame.data[2] = 0xFF;
+		frame.data[3] = 0xFF;
+		frame.data[4] = 0xFF;
+		frame.data[5] = static_cast<std::uint8_t>(dtc.suspectParameterNumber & 0xFF);
+		frame.data[6] = static_cast<std::uint8_t>((dtc.suspectParameterNumber >> 8) & 0xFF);
+		frame.data[7] = static_cast<std::uint8_t>((((dtc.suspectParameterNumber >> 16) & 0x07) << 5) | (dtc.failureModeIdentifier & 0x1F));
+		return frame;
+	}
+
+	void receive_dm22(DiagnosticProtocol::DiagnosticTroubleCode dtc, std::uint8_t controlByte)
+	{
+		HardwareInterfaceCANFrame frame = make_dm22_frame(dtc, controlByte);
+
+		CANNetworkManager::CANNetwork.can_lib_process_rx_message(frame, nullptr);
+		CANNetworkManager::CANNetwork.update();
+	}
+} // namespace
+
+/// Runs each test on the test network, and stops it when the test ends, even if the test failed
+class DIAGNOSTIC_PROTOCOL_NETWORK_TESTS : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		test_helpers::start_test_network();
+	}
+
+	void TearDown() override
+	{
+		test_helpers::stop_test_network();
+	}
+};
+
+TEST(DIAGNOSTIC_PROTOCOL_TESTS, ProtocolAssignment)
+{
+	NAME testName(0);
+	testName.set_arbitrary_address_capable(true);
+	testName.set_industry_group(1);
+	testName.set_identity_number(21);
+	testName.set_manufacturer_code(69);
+	auto testInternalECU = std::make_shared<InternalControlFunction>(testName, 0x1F, 0);
+
+	EXPECT_EQ(nullptr, DiagnosticProtocol::get_diagnostic_protocol_by_internal_control_function(testInternalECU));
+	EXPECT_TRUE(DiagnosticProtocol::assign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+	EXPECT_FALSE(DiagnosticProtocol::assign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+	EXPECT_NE(nullptr, DiagnosticProtocol::get_diagnostic_protocol_by_internal_control_function(testInternalECU));
+
+	// The protocol is only in the list once, so nothing is left behind once it's deassigned
+	EXPECT_TRUE(DiagnosticProtocol::deassign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+	EXPECT_EQ(nullptr, DiagnosticProtocol::get_diagnostic_protocol_by_internal_control_function(testInternalECU));
+	EXPECT_FALSE(DiagnosticProtocol::deassign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+
+	// So it can be assigned again
+	EXPECT_TRUE(DiagnosticProtocol::assign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+	EXPECT_NE(nullptr, DiagnosticProtocol::get_diagnostic_protocol_by_internal_control_function(testInternalECU));
+	EXPECT_TRUE(DiagnosticProtocol::deassign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+}
+
+TEST(DIAGNOSTIC_PROTOCOL_TESTS, DTCStateChanges)
+{
+	NAME testName(0);
+	testName.set_arbitrary_address_capable(true);
+	testName.set_industry_group(1);
+	testName.set_identity_number(7);
+	testName.set_manufacturer_code(69);
+	auto testInternalECU = std::make_shared<InternalControlFunction>(testName, 0x1C, 0);
+
+	ASSERT_TRUE(DiagnosticProtocol::assign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+	DiagnosticProtocol *protocolUnderTest = DiagnosticProtocol::get_diagnostic_protocol_by_internal_control_function(testInternalECU);
+	ASSERT_NE(nullptr, protocolUnderTest);
+
+	std::vector<DiagnosticProtocol::DiagnosticTroubleCode> testDTCs;
+	for (std::uint32_t i = 0; i < 300; i++)
+	{
+		testDTCs.push_back(DiagnosticProtocol::DiagnosticTroubleCode(0x40000 + i, DiagnosticProtocol::FailureModeIdentifier::ConditionExists, DiagnosticProtocol::LampStatus::None));
+	}
+
+	for (auto &dtc : testDTCs)
+	{
+		EXPECT_FALSE(protocolUnderTest->get_diagnostic_trouble_code_active(dtc));
+		EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(dtc, true));
+		EXPECT_FALSE(protocolUnderTest->set_diagnostic_trouble_code_active(dtc, true));
+	}
+
+	// Deactivate every other DTC, which shuffles the rest of the active list around
+	for (std::size_t i = 0; i < testDTCs.size(); i += 2)
+	{
+		EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(testDTCs[i], false));
+		EXPECT_FALSE(protocolUnderTest->set_diagnostic_trouble_code_active(testDTCs[i], false));
+	}
+
+	for (std::size_t i = 0; i < testDTCs.size(); i++)
+	{
+		EXPECT_EQ(0 != (i % 2), protocolUnderTest->get_diagnostic_trouble_code_active(testDTCs[i]));
+	}
+
+	// DTCs are identified by SPN and FMI, so a lamp change is the same DTC
+	DiagnosticProtocol::DiagnosticTroubleCode lampChangedDTC = testDTCs[1];
+	lampChangedDTC.lampState = DiagnosticProtocol::LampStatus::AmberWarningLampSolid;
+	EXPECT_TRUE(protocolUnderTest->get_diagnostic_trouble_code_active(lampChangedDTC));
+
+	protocolUnderTest->clear_active_diagnostic_trouble_codes();
+	for (auto &dtc : testDTCs)
+	{
+		EXPECT_FALSE(protocolUnderTest->get_diagnostic_trouble_code_active(dtc));
+	}
+
+	// Inactive DTCs can be reactivated
+	EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(testDTCs[0], true));
+	EXPECT_TRUE(protocolUnderTest->get_diagnostic_trouble_code_active(testDTCs[0]));
+
+	protocolUnderTest->clear_inactive_diagnostic_trouble_codes();
+	EXPECT_FALSE(protocolUnderTest->set_diagnostic_trouble_code_active(testDTCs[1], false));
+	EXPECT_TRUE(protocolUnderTest->get_diagnostic_trouble_code_active(testDTCs[0]));
+
+	EXPECT_TRUE(DiagnosticProtocol::deassign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+}
+
+TEST(DIAGNOSTIC_PROTOCOL_TESTS, OccurrenceCountLimit)
+{
+	NAME testName(0);
+	testName.set_arbitrary_address_capable(true);
+	testName.set_industry_group(1);
+	testName.set_identity_number(25);
+	testName.set_manufacturer_code(69);
+	auto testInternalECU = std::make_shared<InternalControlFunction>(testName, 0x23, 0);
+
+	ASSERT_TRUE(DiagnosticProtocol::assign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+	DiagnosticProtocol *protocolUnderTest = DiagnosticProtocol::get_diagnostic_protocol_by_internal_control_function(testInternalECU);
+	ASSERT_NE(nullptr, protocolUnderTest);
+
+	DiagnosticProtocol::DiagnosticTroubleCode testDTC(0x1234, DiagnosticProtocol::FailureModeIdentifier::ConditionExists, DiagnosticProtocol::LampStatus::None);
+
+	for (std::uint32_t i = 1; i <= 130; i++)
+	{
+		EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(testDTC, true));
+		EXPECT_EQ(std::min<std::uint32_t>(i, 126), protocolUnderTest->get_diagnostic_trouble_code_occurrance_count(testDTC));
+		EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(testDTC, false));
+	}
+
+	// The count is 7 bits, and 127 means not available, so it stops at 126 instead of wrapping
+	EXPECT_EQ(126, protocolUnderTest->get_diagnostic_trouble_code_occurrance_count(testDTC));
+
+	EXPECT_TRUE(DiagnosticProtocol::deassign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+}
+
+TEST(DIAGNOSTIC_PROTOCOL_TESTS, DM22ClearsDTCs)
+{
+	NAME testName(0);
+	testName.set_arbitrary_address_capable(true);
+	testName.set_industry_group(1);
+	testName.set_identity_number(8);
+	testName.set_manufacturer_code(69);
+	auto testInternalECU = std::make_shared<InternalControlFunction>(testName, 0x1D, 0);
+
+	ASSERT_TRUE(DiagnosticProtocol::assign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+	DiagnosticProtocol *protocolUnderTest = DiagnosticProtocol::get_diagnostic_protocol_by_internal_control_function(testInternalECU);
+	ASSERT_NE(nullptr, protocolUnderTest);
+
+	// Lets the network manager initialize the protocol
+	CANNetworkManager::CANNetwork.update();
+
+	DiagnosticProtocol::DiagnosticTroubleCode firstDTC(0x5A5A5, DiagnosticProtocol::FailureModeIdentifier::DataErratic, DiagnosticProtocol::LampStatus::None);
+	DiagnosticProtocol::DiagnosticTroubleCode secondDTC(1234, DiagnosticProtocol::FailureModeIdentifier::VoltageAboveNormal, DiagnosticProtocol::LampStatus::None);
+
+	EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(firstDTC, true));
+	EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(secondDTC, true));
+
+	// Clear active moves the DTC to the inactive list
+	receive_dm22(firstDTC, 0x11);
+	EXPECT_FALSE(protocolUnderTest->get_diagnostic_trouble_code_active(firstDTC));
+	EXPECT_TRUE(protocolUnderTest->get_diagnostic_trouble_code_active(secondDTC));
+
+	// Clear previously active removes it completely
+	receive_dm22(firstDTC, 0x01);
+	EXPECT_FALSE(protocolUnderTest->set_diagnostic_trouble_code_active(firstDTC, false));
+
+	// Clearing a previously active DTC that is active does nothing
+	receive_dm22(secondDTC, 0x01);
+	EXPECT_TRUE(protocolUnderTest->get_diagnostic_trouble_code_active(secondDTC));
+
+	EXPECT_TRUE(DiagnosticProtocol::deassign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+}
+
+TEST(DIAGNOSTIC_PROTOCOL_TESTS, DTCLogPersistsHistory)
+{
+	const std::string logFilename = "dtc_history_test.log";
+	NAME testName(0);
+	testName.set_arbitrary_address_capable(true);
+	testName.set_industry_group(1);
+	testName.set_identity_number(9);
+	testName.set_manufacturer_code(69);
+	auto testInternalECU = std::make_shared<InternalControlFunction>(testName, 0x1E, 0);
+
+	DiagnosticProtocol::DiagnosticTroubleCode historyDTC(3000, DiagnosticProtocol::FailureModeIdentifier::DataErratic, DiagnosticProtocol::LampStatus::AmberWarningLampSolid);
+	DiagnosticProtocol::DiagnosticTroubleCode activeDTC(3001, DiagnosticProtocol::FailureModeIdentifier::VoltageAboveNormal, DiagnosticProtocol::LampStatus::None);
+	DiagnosticProtocol::DiagnosticTroubleCode clearedDTC(3002, DiagnosticProtocol::FailureModeIdentifier::ConditionExists, DiagnosticProtocol::LampStatus::None);
+
+	std::remove(logFilename.c_str());
+
+	if (!MemoryMappedFile::get_is_supported())
+	{
+		return;
+	}
+
+	{
+		ASSERT_TRUE(DiagnosticProtocol::assign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+		DiagnosticProtocol *protocolUnderTest = DiagnosticProtocol::get_diagnostic_protocol_by_internal_control_function(testInternalECU);
+		ASSERT_NE(nullptr, protocolUnderTest);
+
+		auto dtcLog = std::make_shared<DiagnosticTroubleCodeLog>(logFilename);
+		ASSERT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_log(dtcLog));
+
+		// Lets the network manager initialize the protocol
+		CANNetworkManager::CANNetwork.update();
+
+		for (std::uint8_t i = 0; i < 3; i++)
+		{
+			EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(historyDTC, true));
+			EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(historyDTC, false));
+		}
+		EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(activeDTC, true));
+		EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(clearedDTC, true));
+		EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(clearedDTC, false));
+		receive_dm22(clearedDTC, 0x01);
+		EXPECT_EQ(0, protocolUnderTest->get_diagnostic_trouble_code_occurrance_count(clearedDTC));
+
+		dtcLog->flush();
+		EXPECT_EQ(10u, dtcLog->get_number_of_records());
+		EXPECT_TRUE(DiagnosticProtocol::deassign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+	}
+
+	// Simulate a power cycle
+	ASSERT_TRUE(DiagnosticProtocol::assign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+	DiagnosticProtocol *protocolUnderTest = DiagnosticProtocol::get_diagnostic_protocol_by_internal_control_function(testInternalECU);
+	ASSERT_NE(nullptr, protocolUnderTest);
+	ASSERT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_log(std::make_shared<DiagnosticTroubleCodeLog>(logFilename)));
+
+	EXPECT_EQ(3, protocolUnderTest->get_diagnostic_trouble_code_occurrance_count(historyDTC));
+	EXPECT_FALSE(protocolUnderTest->get_diagnostic_trouble_code_active(historyDTC));
+	EXPECT_EQ(1, protocolUnderTest->get_diagnostic_trouble_code_occurrance_count(activeDTC));
+	EXPECT_FALSE(protocolUnderTest->get_diagnostic_trouble_code_active(activeDTC));
+	EXPECT_EQ(0, protocolUnderTest->get_diagnostic_trouble_code_occurrance_count(clearedDTC));
+
+	// Reactivating a restored DTC continues its occurrence count
+	EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(historyDTC, true));
+	EXPECT_EQ(4, protocolUnderTest->get_diagnostic_trouble_code_occurrance_count(historyDTC));
+
+	EXPECT_TRUE(DiagnosticProtocol::deassign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+	std::remove(logFilename.c_str());
+}
+
+TEST(DIAGNOSTIC_PROTOCOL_TESTS, DTCLogCompactionAndRecovery)
+{
+	const std::string logFilename = "dtc_compaction_test.log";
+	std::vector<DiagnosticTroubleCodeLog::Record> restoredRecords;
+
+	std::remove(logFilename.c_str());
+
+	if (!MemoryMappedFile::get_is_supported())
+	{
+		return;
+	}
+
+	{
+		DiagnosticTroubleCodeLog dtcLog(logFilename, 8);
+		ASSERT_TRUE(dtcLog.open(restoredRecords));
+		EXPECT_TRUE(restoredRecords.empty());
+
+		// Toggling 3 DTCs many times overflows the 8 record file, so it has to be compacted
+		for (std::uint8_t i = 0; i < 30; i++)
+		{
+			EXPECT_TRUE(dtcLog.append({ 100u + (i % 3), 2, 0, i, (0 == (i % 2)) ? DiagnosticTroubleCodeLog::RecordType::Active : DiagnosticTroubleCodeLog::RecordType::PreviouslyActive }));
+		}
+		EXPECT_TRUE(dtcLog.append({ 200, 3, 0, 1, DiagnosticTroubleCodeLog::RecordType::PreviouslyActive }));
+		dtcLog.flush();
+		EXPECT_NE(0u, dtcLog.get_number_of_compactions());
+		EXPECT_LE(dtcLog.get_number_of_records(), 8u);
+	}
+
+	{
+		DiagnosticTroubleCodeLog dtcLog(logFilename, 8);
+		ASSERT_TRUE(dtcLog.open(restoredRecords));
+		ASSERT_EQ(4u, restoredRecords.size());
+
+		for (const auto &record : restoredRecords)
+		{
+			if (200 != record.suspectParameterNumber)
+			{
+				// The last of the 30 records for each DTC wins
+				EXPECT_EQ(record.suspectParameterNumber - 100 + 27, record.occurranceCount);
+			}
+		}
+		EXPECT_TRUE(dtcLog.append({ 200, 3, 0, 1, DiagnosticTroubleCodeLog::RecordType::Cleared }));
+		EXPECT_TRUE(dtcLog.append({ 0, 0, 0, 0, DiagnosticTroubleCodeLog::RecordType::ClearAllPreviouslyActive }));
+		EXPECT_TRUE(dtcLog.append({ 300, 4, 0, 5, DiagnosticTroubleCodeLog::RecordType::PreviouslyActive }));
+	}
+
+	{
+		DiagnosticTroubleCodeLog dtcLog(logFilename, 8);
+		ASSERT_TRUE(dtcLog.open(restoredRecords));
+
+		// Only the previously active DTCs were cleared
+		ASSERT_EQ(2u, restoredRecords.size());
+		for (const auto &record : restoredRecords)
+		{
+			EXPECT_TRUE(((101 == record.suspectParameterNumber) && (DiagnosticTroubleCodeLog::RecordType::Active == record.type)) ||
+			            (300 == record.suspectParameterNumber));
+		}
+	}
+	std::remove(logFilename.c_str());
+
+	{
+		DiagnosticTroubleCodeLog dtcLog(logFilename);
+		ASSERT_TRUE(dtcLog.open(restoredRecords));
+		EXPECT_TRUE(dtcLog.append({ 400, 1, 0, 1, DiagnosticTroubleCodeLog::RecordType::PreviouslyActive }));
+		EXPECT_TRUE(dtcLog.append({ 401, 1, 0, 1, DiagnosticTroubleCodeLog::RecordType::PreviouslyActive }));
+	}
+
+	// Tear the last record, as if power was lost while it was being written
+	{
+		std::fstream logFile(logFilename, std::ios::binary | std::ios::in | std::ios::out);
+		logFile.seekp(DiagnosticTroubleCodeLog::HEADER_SIZE + DiagnosticTroubleCodeLog::RECORD_SIZE + 6);
+		logFile.put(static_cast<char>(0x55));
+	}
+
+	{
+		DiagnosticTroubleCodeLog dtcLog(logFilename);
+		ASSERT_TRUE(dtcLog.open(restoredRecords));
+		ASSERT_EQ(1u, restoredRecords.size());
+		EXPECT_EQ(400u, restoredRecords[0].suspectParameterNumber);
+
+		// The damaged record was dropped when the log was opened, so new records are kept
+		EXPECT_EQ(1u, dtcLog.get_number_of_compactions());
+		EXPECT_TRUE(dtcLog.append({ 402, 1, 0, 1, DiagnosticTroubleCodeLog::RecordType::PreviouslyActive }));
+	}
+
+	DiagnosticTroubleCodeLog dtcLog(logFilename);
+	ASSERT_TRUE(dtcLog.open(restoredRecords));
+	EXPECT_EQ(2u, restoredRecords.size());
+	dtcLog.close();
+	std::remove(logFilename.c_str());
+}
+
+TEST(DIAGNOSTIC_PROTOCOL_TESTS, DTCLogRestoreManyRecords)
+{
+	const std::string logFilename = "dtc_restore_many_test.log";
+	const std::uint32_t numberOfRecords = 4000;
+	std::vector<DiagnosticTroubleCodeLog::Record> restoredRecords;
+
+	std::remove(logFilename.c_str());
+
+	if (!MemoryMappedFile::get_is_supported())
+	{
+		return;
+	}
+
+	{
+		DiagnosticTroubleCodeLog dtcLog(logFilename);
+		ASSERT_TRUE(dtcLog.open(restoredRecords));
+
+		for (std::uint32_t i = 0; i < numberOfRecords; i++)
+		{
+			EXPECT_TRUE(dtcLog.append({ i, 31, 0, 1, DiagnosticTroubleCodeLog::RecordType::PreviouslyActive }));
+		}
+	}
+
+	DiagnosticTroubleCodeLog dtcLog(logFilename);
+	ASSERT_TRUE(dtcLog.open(restoredRecords));
+	ASSERT_EQ(numberOfRecords, restoredRecords.size());
+
+	std::sort(restoredRecords.begin(), restoredRecords.end(), [](const DiagnosticTroubleCodeLog::Record &first, const DiagnosticTroubleCodeLog::Record &second) {
+		return first.suspectParameterNumber < second.suspectParameterNumber;
+	});
+	for (std::uint32_t i = 0; i < numberOfRecords; i++)
+	{
+		EXPECT_EQ(i, restoredRecords[i].suspectParameterNumber);
+		EXPECT_EQ(31, restoredRecords[i].failureModeIdentifier);
+		EXPECT_EQ(0, restoredRecords[i].lampState);
+		EXPECT_EQ(1, restoredRecords[i].occurranceCount);
+		EXPECT_EQ(DiagnosticTroubleCodeLog::RecordType::PreviouslyActive, restoredRecords[i].type);
+	}
+	dtcLog.close();
+	std::remove(logFilename.c_str());
+}
+
+TEST(DIAGNOSTIC_PROTOCOL_TESTS, FreezeFrameSignalRecorder)
+{
+	FreezeFrameSignalRecorder recorder(0);
+	FreezeFrameSignalRecorder::Sample sample;
+	std::uint8_t snapshot[8] = { 0 };
+
+	EXPECT_EQ(FreezeFrameSignalRecorder::INVALID_SIGNAL_INDEX, recorder.add_signal(190, 0));
+	EXPECT_EQ(FreezeFrameSignalRecorder::INVALID_SIGNAL_INDEX, recorder.add_signal(190, 5));
+	const std::size_t engineSpeed = recorder.add_signal(190, 2);
+	const std::size_t coolantTemperature = recorder.add_signal(110, 1);
+	ASSERT_EQ(0u, engineSpeed);
+	ASSERT_EQ(1u, coolantTemperature);
+	EXPECT_EQ(3u, recorder.get_snapshot_length());
+	EXPECT_EQ(110u, recorder.get_suspect_parameter_number(coolantTemperature));
+
+	// Nothing recorded yet, so everything is not available
+	EXPECT_FALSE(recorder.get_latest_sample(engineSpeed, sample));
+	EXPECT_EQ(3u, recorder.capture_snapshot(snapshot, sizeof(snapshot)));
+	EXPECT_EQ(0xFF, snapshot[0]);
+	EXPECT_EQ(0xFF, snapshot[2]);
+
+	EXPECT_TRUE(recorder.record(engineSpeed, 0x1234));
+	EXPECT_TRUE(recorder.record(coolantTemperature, 0x56));
+	EXPECT_FALSE(recorder.record(2, 0));
+	EXPECT_EQ(3u, recorder.capture_snapshot(snapshot, sizeof(snapshot)));
+	EXPECT_EQ(0x34, snapshot[0]);
+	EXPECT_EQ(0x12, snapshot[1]);
+	EXPECT_EQ(0x56, snapshot[2]);
+
+	// Signals that don't fit are left out
+	EXPECT_EQ(2u, recorder.capture_snapshot(snapshot, 2));
+
+	// Readers always see a complete sample while another thread is recording
+	std::atomic<bool> stopWriting(false);
+	std::thread writerThread([&recorder, &stopWriting, engineSpeed]() {
+		std::uint32_t value = 0;
+		while (!stopWriting)
+		{
+			recorder.record(engineSpeed, value);
+			value = (value + 1) & 0xFFFF;
+		}
+	});
+	std::uint32_t readCount = 0;
+	for (std::uint32_t i = 0; i < 10000; i++)
+	{
+		if (recorder.get_latest_sample(engineSpeed, sample))
+		{
+			EXPECT_LE(sample.value, 0xFFFFu);
+			readCount++;
+		}
+	}
+	stopWriting = true;
+	writerThread.join();
+	EXPECT_NE(0u, readCount);
+}
+
+TEST(DIAGNOSTIC_PROTOCOL_TESTS, FreezeFrameCapture)
+{
+	NAME testName(0);
+	testName.set_arbitrary_address_capable(true);
+	testName.set_industry_group(1);
+	testName.set_identity_number(10);
+	testName.set_manufacturer_code(69);
+	auto testInternalECU = std::make_shared<InternalControlFunction>(testName, 0x1F, 0);
+
+	ASSERT_TRUE(DiagnosticProtocol::assign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+	DiagnosticProtocol *protocolUnderTest = DiagnosticProtocol::get_diagnostic_protocol_by_internal_control_function(testInternalECU);
+	ASSERT_NE(nullptr, protocolUnderTest);
+
+	auto recorder = std::make_shared<FreezeFrameSignalRecorder>();
+	const std::size_t engineSpeed = recorder->add_signal(190, 2);
+	std::vector<std::uint8_t> freezeFrameData;
+	std::vector<DiagnosticProtocol::DiagnosticTroubleCode> testDTCs;
+
+	for (std::uint32_t i = 0; i <= DiagnosticProtocol::MAX_FREEZE_FRAMES; i++)
+	{
+		testDTCs.push_back(DiagnosticProtocol::DiagnosticTroubleCode(5000 + i, DiagnosticProtocol::FailureModeIdentifier::ConditionExists, DiagnosticProtocol::LampStatus::None));
+	}
+
+	// Without a recorder, nothing is captured
+	EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(testDTCs[0], true));
+	EXPECT_FALSE(protocolUnderTest->get_freeze_frame(testDTCs[0], freezeFrameData));
+	EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(testDTCs[0], false));
+
+	protocolUnderTest->set_freeze_frame_recorder(recorder);
+	recorder->record(engineSpeed, 1000);
+	EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(testDTCs[0], true));
+	recorder->record(engineSpeed, 2000);
+
+	// The frame holds the value from when the DTC became active
+	ASSERT_TRUE(protocolUnderTest->get_freeze_frame(testDTCs[0], freezeFrameData));
+	ASSERT_EQ(2u, freezeFrameData.size());
+	EXPECT_EQ(1000, freezeFrameData[0] | (freezeFrameData[1] << 8));
+
+	// Reactivating recaptures
+	EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(testDTCs[0], false));
+	EXPECT_TRUE(protocolUnderTest->get_freeze_frame(testDTCs[0], freezeFrameData));
+	EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(testDTCs[0], true));
+	ASSERT_TRUE(protocolUnderTest->get_freeze_frame(testDTCs[0], freezeFrameData));
+	EXPECT_EQ(2000, freezeFrameData[0] | (freezeFrameData[1] << 8));
+
+	// When all frames are used, the oldest one is replaced
+	for (std::size_t i = 1; i < testDTCs.size(); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(testDTCs[i], true));
+	}
+	EXPECT_FALSE(protocolUnderTest->get_freeze_frame(testDTCs[0], freezeFrameData));
+	EXPECT_TRUE(protocolUnderTest->get_freeze_frame(testDTCs.back(), freezeFrameData));
+
+	// Clearing the history removes the frames
+	protocolUnderTest->clear_active_diagnostic_trouble_codes();
+	EXPECT_TRUE(protocolUnderTest->get_freeze_frame(testDTCs[1], freezeFrameData));
+	protocolUnderTest->clear_inactive_diagnostic_trouble_codes();
+	EXPECT_FALSE(protocolUnderTest->get_freeze_frame(testDTCs[1], freezeFrameData));
+
+	EXPECT_TRUE(DiagnosticProtocol::deassign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+}
+
+TEST_F(DIAGNOSTIC_PROTOCOL_NETWORK_TESTS, LampChangeSendsDM1)
+{
+	NAME testName(0);
+	testName.set_arbitrary_address_capable(true);
+	testName.set_industry_group(1);
+	testName.set_function_code(static_cast<std::uint8_t>(NAME::Function::EngineValveController));
+	testName.set_identity_number(20);
+	testName.set_manufacturer_code(69);
+	auto testInternalECU = std::make_shared<InternalControlFunction>(testName, 0x1E, 0);
+
+	for (std::uint32_t i = 0; (i < 100) && (!testInternalECU->get_address_valid()); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	ASSERT_TRUE(testInternalECU->get_address_valid());
+
+	ASSERT_TRUE(DiagnosticProtocol::assign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+	DiagnosticProtocol *protocolUnderTest = DiagnosticProtocol::get_diagnostic_protocol_by_internal_control_function(testInternalECU);
+	ASSERT_NE(nullptr, protocolUnderTest);
+	protocolUnderTest->set_j1939_mode(true);
+
+	DiagnosticProtocol::DiagnosticTroubleCode testDTC(1234, DiagnosticProtocol::FailureModeIdentifier::ConditionExists, DiagnosticProtocol::LampStatus::None);
+	HardwareInterfaceCANFrame dm1Frame;
+
+	EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(testDTC, true));
+	std::size_t sentDM1s = test_helpers::count_transmitted_frames(DM1_PGN);
+	ASSERT_TRUE(test_helpers::wait_for_transmitted_frame(DM1_PGN, sentDM1s, dm1Frame));
+	EXPECT_EQ(0x00, dm1Frame.data[0] & 0x0C);
+
+	// Changing the lamp of an active DTC is a state change
+	testDTC.lampState = DiagnosticProtocol::LampStatus::AmberWarningLampSolid;
+	EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(testDTC, true));
+	EXPECT_FALSE(protocolUnderTest->set_diagnostic_trouble_code_active(testDTC, true));
+	EXPECT_TRUE(protocolUnderTest->get_diagnostic_trouble_code_active(testDTC));
+
+	// The next DM1, sent no later than the rate limit allows, reports the amber lamp
+	sentDM1s = test_helpers::count_transmitted_frames(DM1_PGN);
+	ASSERT_TRUE(test_helpers::wait_for_transmitted_frame(DM1_PGN, sentDM1s, dm1Frame));
+	EXPECT_EQ(0x04, dm1Frame.data[0] & 0x0C);
+	EXPECT_EQ(1234 & 0xFF, dm1Frame.data[2]);
+
+	protocolUnderTest->set_j1939_mode(false);
+	EXPECT_TRUE(DiagnosticProtocol::deassign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+}
+
+TEST_F(DIAGNOSTIC_PROTOCOL_NETWORK_TESTS, DM22NegativeAcknowledgeReasons)
+{
+	NAME testName(0);
+	testName.set_arbitrary_address_capable(true);
+	testName.set_industry_group(1);
+	testName.set_function_code(static_cast<std::uint8_t>(NAME::Function::EngineValveController));
+	testName.set_identity_number(22);
+	testName.set_manufacturer_code(69);
+	auto testInternalECU = std::make_shared<InternalControlFunction>(testName, 0x21, 0);
+
+	for (std::uint32_t i = 0; (i < 100) && (!testInternalECU->get_address_valid()); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	ASSERT_TRUE(testInternalECU->get_address_valid());
+
+	ASSERT_TRUE(DiagnosticProtocol::assign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+	DiagnosticProtocol *protocolUnderTest = DiagnosticProtocol::get_diagnostic_protocol_by_internal_control_function(testInternalECU);
+	ASSERT_NE(nullptr, protocolUnderTest);
+
+	// Lets the network manager initialize the protocol, which registers for DM22
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	DiagnosticProtocol::DiagnosticTroubleCode activeDTC(0x5A5A5, DiagnosticProtocol::FailureModeIdentifier::DataErratic, DiagnosticProtocol::LampStatus::None);
+	DiagnosticProtocol::DiagnosticTroubleCode inactiveDTC(1234, DiagnosticProtocol::FailureModeIdentifier::VoltageAboveNormal, DiagnosticProtocol::LampStatus::None);
+	DiagnosticProtocol::DiagnosticTroubleCode unknownDTC(4321, DiagnosticProtocol::FailureModeIdentifier::VoltageBelowNormal, DiagnosticProtocol::LampStatus::None);
+
+	EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(activeDTC, true));
+	EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(inactiveDTC, true));
+	EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(inactiveDTC, false));
+
+	struct DM22Case
+	{
+		DiagnosticProtocol::DiagnosticTroubleCode dtc;
+		std::uint8_t request;
+		std::uint8_t response;
+		std::uint8_t reason;
+	};
+	const std::vector<DM22Case> cases = {
+		{ unknownDTC, 0x11, 0x13, 0x02 }, // Unknown or does not exist
+		{ inactiveDTC, 0x11, 0x13, 0x04 }, // No longer active
+		{ unknownDTC, 0x01, 0x03, 0x02 }, // Unknown or does not exist
+		{ activeDTC, 0x01, 0x03, 0x03 }, // No longer previously active
+		{ activeDTC, 0x11, 0x12, 0xFF } // Positive acknowledge
+	};
+
+	for (std::size_t i = 0; i < cases.size(); i++)
+	{
+		HardwareInterfaceCANFrame request = make_dm22_frame(cases[i].dtc, cases[i].request);
+		HardwareInterfaceCANFrame response;
+
+		CANNetworkManager::CANNetwork.can_lib_process_rx_message(request, nullptr);
+		ASSERT_TRUE(test_helpers::wait_for_transmitted_frame(DM22_PGN, i, response));
+		EXPECT_EQ(cases[i].response, response.data[0]);
+		EXPECT_EQ(cases[i].reason, response.data[1]);
+		EXPECT_EQ(request.data[5], response.data[5]);
+		EXPECT_EQ(request.data[6], response.data[6]);
+		EXPECT_EQ(request.data[7], response.data[7]);
+	}
+	EXPECT_FALSE(protocolUnderTest->get_diagnostic_trouble_code_active(activeDTC));
+
+	EXPECT_TRUE(DiagnosticProtocol::deassign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+}
+
+TEST_F(DIAGNOSTIC_PROTOCOL_NETWORK_TESTS, SingleDTCMessagesFillOneFrame)
+{
+	constexpr std::uint32_t DM2_PGN = 0xFECB;
+
+	NAME testName(0);
+	testName.set_arbitrary_address_capable(true);
+	testName.set_industry_group(1);
+	testName.set_function_code(static_cast<std::uint8_t>(NAME::Function::EngineValveController));
+	testName.set_identity_number(23);
+	testName.set_manufacturer_code(69);
+	auto testInternalECU = std::make_shared<InternalControlFunction>(testName, 0x22, 0);
+
+	for (std::uint32_t i = 0; (i < 100) && (!testInternalECU->get_address_valid()); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	ASSERT_TRUE(testInternalECU->get_address_valid());
+
+	ASSERT_TRUE(DiagnosticProtocol::assign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+	DiagnosticProtocol *protocolUnderTest = DiagnosticProtocol::get_diagnostic_protocol_by_internal_control_function(testInternalECU);
+	ASSERT_NE(nullptr, protocolUnderTest);
+	protocolUnderTest->set_j1939_mode(true);
+
+	// With no DTCs, DM1 reports a zeroed SPN
+	HardwareInterfaceCANFrame dm1Frame;
+	ASSERT_TRUE(test_helpers::wait_for_transmitted_frame(DM1_PGN, test_helpers::count_transmitted_frames(DM1_PGN), dm1Frame));
+	EXPECT_EQ(8u, dm1Frame.dataLength);
+	EXPECT_EQ(0x00, dm1Frame.data[2]);
+	EXPECT_EQ(0x00, dm1Frame.data[3]);
+	EXPECT_EQ(0x00, dm1Frame.data[4]);
+	EXPECT_EQ(0x00, dm1Frame.data[5]);
+	EXPECT_EQ(0xFF, dm1Frame.data[6]);
+	EXPECT_EQ(0xFF, dm1Frame.data[7]);
+
+	// One DTC takes 6 of the 8 bytes, and the rest is padding
+	DiagnosticProtocol::DiagnosticTroubleCode testDTC(0x5A5A5, DiagnosticProtocol::FailureModeIdentifier::DataErratic, DiagnosticProtocol::LampStatus::None);
+	const std::uint8_t encodedDTC[4] = { 0xA5, 0xA5, static_cast<std::uint8_t>((0x05 << 5) | static_cast<std::uint8_t>(DiagnosticProtocol::FailureModeIdentifier::DataErratic)), 0x01 };
+
+	EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(testDTC, true));
+	ASSERT_TRUE(test_helpers::wait_for_transmitted_frame(DM1_PGN, test_helpers::count_transmitted_frames(DM1_PGN), dm1Frame));
+	EXPECT_EQ(8u, dm1Frame.dataLength);
+	for (std::uint8_t i = 0; i < 4; i++)
+	{
+		EXPECT_EQ(encodedDTC[i], dm1Frame.data[2 + i]);
+	}
+	EXPECT_EQ(0xFF, dm1Frame.data[6]);
+	EXPECT_EQ(0xFF, dm1Frame.data[7]);
+
+	// The same for DM2, once the DTC is inactive. Only known control functions can request it, so a tool claims first.
+	EXPECT_TRUE(protocolUnderTest->set_diagnostic_trouble_code_active(testDTC, false));
+
+	HardwareInterfaceCANFrame request;
+	HardwareInterfaceCANFrame dm2Frame;
+	NAME toolName(0);
+	toolName.set_arbitrary_address_capable(true);
+	toolName.set_industry_group(1);
+	toolName.set_function_code(static_cast<std::uint8_t>(NAME::Function::OnboardDiagnosticUnit));
+	toolName.set_identity_number(24);
+	toolName.set_manufacturer_code(69);
+
+	request.timestamp_us = 0;
+	request.identifier = CANIdentifier(CANIdentifier::Type::Extended, 0xEE00, CANIdentifier::CANPriority::PriorityDefault6, 0xFF, 0x80).get_identifier();
+	request.channel = 0;
+	request.dataLength = 8;
+	request.isExtendedFrame = true;
+	for (std::uint8_t i = 0; i < 8; i++)
+	{
+		request.data[i] = static_cast<std::uint8_t>(toolName.get_full_name() >> (8 * i));
+	}
+	CANNetworkManager::CANNetwork.can_lib_process_rx_message(request, nullptr);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	request.timestamp_us = 0;
+	request.identifier = CANIdentifier(CANIdentifier::Type::Extended, 0xEA00, CANIdentifier::CANPriority::PriorityDefault6, 0x22, 0x80).get_identifier();
+	request.channel = 0;
+	request.dataLength = 3;
+	request.isExtendedFrame = true;
+	request.data[0] = static_cast<std::uint8_t>(DM2_PGN & 0xFF);
+	request.data[1] = static_cast<std::uint8_t>((DM2_PGN >> 8) & 0xFF);
+	request.data[2] = static_cast<std::uint8_t>((DM2_PGN >> 16) & 0xFF);
+	CANNetworkManager::CANNetwork.can_lib_process_rx_message(request, nullptr);
+
+	ASSERT_TRUE(test_helpers::wait_for_transmitted_frame(DM2_PGN, 0, dm2Frame));
+	EXPECT_EQ(8u, dm2Frame.dataLength);
+	for (std::uint8_t i = 0; i < 4; i++)
+	{
+		EXPECT_EQ(encodedDTC[i], dm2Frame.data[2 + i]);
+	}
+	EXPECT_EQ(0xFF, dm2Frame.data[6]);
+	EXPECT_EQ(0xFF, dm2Frame.data[7]);
+
+	protocolUnderTest->set_j1939_mode(false);
+	EXPECT_TRUE(DiagnosticProtocol::deassign_diagnostic_protocol_to_internal_control_function(testInternalECU));
+}
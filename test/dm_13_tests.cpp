@@ -1,7 +1,16 @@
 #include <gtest/gtest.h>
 
+#include "helpers/test_network.hpp"
 #include "isobus/isobus/can_managed_message.hpp"
+#include "isobus/isobus/can_network_configuration.hpp"
+#include "isobus/isobus/can_network_manager.hpp"
 #include "isobus/isobus/isobus_diagnostic_protocol.hpp"
+#include "isobus/isobus/nmea2000_fast_packet_protocol.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
 
 using namespace isobus;
 
@@ -32,3 +41,223 @@ TEST(DM13_TESTS, TestInvalidDM13Rejection)
 	testDM13Message.set_data_size(4);
 	EXPECT_EQ(false, DiagnosticProtocol::parse_j1939_network_states(&testDM13Message, testNetworkStates));
 }
+
+TEST(DM13_TESTS, TestNetworkCommandDecoding)
+{
+	std::uint32_t testNetworkStates = 0;
+	CANIdentifier testID(CANIdentifier::Type::Extended,
+	                     0xDF00,
+	                     CANIdentifier::CANPriority::PriorityDefault6,
+	                     0xFF,
+	                     0x80);
+	CANLibManagedMessage testDM13Message(2);
+	testDM13Message.set_identifier(testID);
+	testDM13Message.set_data_size(8);
+
+	auto set_message_data = [&testDM13Message](const std::uint8_t *data) {
+		for (std::uint8_t i = 0; i < 8; i++)
+		{
+			testDM13Message.set_data(data[i], i);
+		}
+	};
+
+	// Stop J1939 network 2 and the current data link, leave everything else alone
+	std::uint8_t stopData[8] = { 0xFC, 0xFC, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+	set_message_data(stopData);
+	EXPECT_TRUE(DiagnosticProtocol::parse_j1939_network_states(&testDM13Message, testNetworkStates));
+	EXPECT_EQ(0x06u, testNetworkStates);
+
+	// Don't care for every network leaves the states as they were
+	std::uint8_t holdData[8] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+	set_message_data(holdData);
+	EXPECT_TRUE(DiagnosticProtocol::parse_j1939_network_states(&testDM13Message, testNetworkStates));
+	EXPECT_EQ(0x06u, testNetworkStates);
+
+	// Start J1939 network 1 and 2, stop J1939 network 3
+	std::uint8_t startData[8] = { 0x7F, 0xFD, 0xFC, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+	set_message_data(startData);
+	EXPECT_TRUE(DiagnosticProtocol::parse_j1939_network_states(&testDM13Message, testNetworkStates));
+	EXPECT_EQ(0x04u, testNetworkStates);
+}
+
+namespace
+{
+	constexpr std::uint32_t DM13_TIMEOUT_MS = 6000; ///< The time after the last DM13 when broadcasts resume, from J1939-73 5.7.13
+
+	std::atomic<std::uint32_t> successfulTransmits = { 0 };
+	std::atomic<std::uint32_t> failedTransmits = { 0 };
+
+	std::size_t count_transmitted_frames(std::uint32_t parameterGroupNumber, std::uint8_t firstDataByte)
+	{
+		std::size_t retVal = 0;
+
+		for (auto &frame : test_helpers::get_transmitted_frames())
+		{
+			if ((CANIdentifier(frame.identifier).get_parameter_group_number() == parameterGroupNumber) &&
+			    (frame.data[0] == firstDataByte))
+			{
+				retVal++;
+			}
+		}
+		return retVal;
+	}
+
+	void inject_dm13(std::uint8_t firstDataByte, std::uint8_t channel)
+	{
+		HardwareInterfaceCANFrame frame;
+		frame.timestamp_us = 0;
+		frame.identifier = CANIdentifier(CANIdentifier::Type::Extended, 0xDF00, CANIdentifier::CANPriority::PriorityDefault6, 0xFF, 0x80).get_identifier();
+		frame.channel = channel;
+		frame.dataLength = 8;
+		frame.isExtendedFrame = true;
+		frame.data[0] = firstDataByte;
+		for (std::uint8_t i = 1; i < 8; i++)
+		{
+			frame.data[i] = 0xFF;
+		}
+		CANNetworkManager::can_lib_process_rx_message(frame, nullptr);
+	}
+
+	void test_transmit_complete_callback(std::uint32_t, std::uint32_t, InternalControlFunction *, ControlFunction *, bool successful, void *)
+	{
+		if (successful)
+		{
+			successfulTransmits++;
+		}
+		else
+		{
+			failedTransmits++;
+		}
+	}
+
+	bool wait_for_broadcasts_suspended(std::uint8_t channel, bool suspended)
+	{
+		for (std::uint32_t i = 0; (i < 100) && (suspended != CANNetworkManager::CANNetwork.get_broadcasts_suspended(channel)); i++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		return (suspended == CANNetworkManager::CANNetwork.get_broadcasts_suspended(channel));
+	}
+} // namespace
+
+/// Runs each test on the test network, and stops it and restores the defaults when the test ends, even if the test failed
+class DM13_NETWORK_TESTS : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		successfulTransmits = 0;
+		failedTransmits = 0;
+		test_helpers::start_test_network();
+	}
+
+	void TearDown() override
+	{
+		test_helpers::stop_test_network();
+		CANNetworkConfiguration::set_defer_suspended_broadcasts(false);
+	}
+};
+
+TEST_F(DM13_NETWORK_TESTS, BroadcastSuspensionGate)
+{
+	NAME testName(0);
+	testName.set_arbitrary_address_capable(true);
+	testName.set_industry_group(1);
+	testName.set_function_code(static_cast<std::uint8_t>(NAME::Function::EngineValveController));
+	testName.set_identity_number(13);
+	testName.set_manufacturer_code(69);
+	InternalControlFunction testInternalECU(testName, 0x1D, 0);
+
+	for (std::uint32_t i = 0; (i < 100) && (!testInternalECU.get_address_valid()); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	ASSERT_TRUE(testInternalECU.get_address_valid());
+
+	const std::uint8_t testData[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	const std::uint8_t newerTestData[8] = { 9, 2, 3, 4, 5, 6, 7, 8 };
+	const std::uint8_t fastPacketData[20] = { 0 };
+
+	// Stop broadcasts on the current data link
+	inject_dm13(0xFC, 0);
+	ASSERT_TRUE(wait_for_broadcasts_suspended(0, true));
+	EXPECT_FALSE(CANNetworkManager::CANNetwork.get_broadcasts_suspended(1));
+	EXPECT_EQ(1u, CANNetworkManager::CANNetwork.get_broadcast_suspension_statistics(0).suspensionCount);
+
+	// Ordinary broadcasts are dropped, including fast packet ones
+	EXPECT_FALSE(CANNetworkManager::CANNetwork.send_can_message(0xFF00, testData, 8, &testInternalECU));
+	EXPECT_FALSE(FastPacketProtocol::Protocol.send_multipacket_message(0x1F805, fastPacketData, 20, &testInternalECU, nullptr));
+	EXPECT_EQ(2u, CANNetworkManager::CANNetwork.get_broadcast_suspension_statistics(0).suppressedMessages);
+
+	// Exceptions still go out
+	CANNetworkManager::CANNetwork.add_broadcast_suspension_exception(0xFF01);
+	EXPECT_TRUE(CANNetworkManager::CANNetwork.send_can_message(0xFF01, testData, 8, &testInternalECU));
+	EXPECT_EQ(1u, CANNetworkManager::CANNetwork.get_broadcast_suspension_statistics(0).exceptedMessages);
+	CANNetworkManager::CANNetwork.remove_broadcast_suspension_exception(0xFF01);
+	EXPECT_FALSE(CANNetworkManager::CANNetwork.send_can_message(0xFF01, testData, 8, &testInternalECU));
+
+	// Deferred broadcasts are coalesced, then sent when broadcasts resume. The replaced one is reported as never sent.
+	CANNetworkConfiguration::set_defer_suspended_broadcasts(true);
+	EXPECT_TRUE(CANNetworkConfiguration::get_defer_suspended_broadcasts());
+	EXPECT_TRUE(CANNetworkManager::CANNetwork.send_can_message(0xFF02, testData, 8, &testInternalECU, nullptr, CANIdentifier::CANPriority::PriorityDefault6, test_transmit_complete_callback));
+	EXPECT_TRUE(CANNetworkManager::CANNetwork.send_can_message(0xFF02, newerTestData, 8, &testInternalECU, nullptr, CANIdentifier::CANPriority::PriorityDefault6, test_transmit_complete_callback));
+	EXPECT_EQ(2u, CANNetworkManager::CANNetwork.get_broadcast_suspension_statistics(0).deferredMessages);
+	EXPECT_EQ(1u, failedTransmits);
+	EXPECT_EQ(0u, successfulTransmits);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	EXPECT_EQ(0u, count_transmitted_frames(0xFF00, 1));
+	EXPECT_EQ(1u, count_transmitted_frames(0xFF01, 1));
+	EXPECT_EQ(0u, count_transmitted_frames(0xFF02, 1));
+	EXPECT_EQ(0u, count_transmitted_frames(0xFF02, 9));
+
+	// Start broadcasts again
+	inject_dm13(0xFD, 0);
+	for (std::uint32_t i = 0; (i < 100) && (0 == count_transmitted_frames(0xFF02, 9)); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	EXPECT_FALSE(CANNetworkManager::CANNetwork.get_broadcasts_suspended(0));
+	EXPECT_EQ(1u, count_transmitted_frames(0xFF02, 9));
+	EXPECT_EQ(0u, count_transmitted_frames(0xFF02, 1));
+	EXPECT_EQ(1u, CANNetworkManager::CANNetwork.get_broadcast_suspension_statistics(0).sentDeferredMessages);
+	EXPECT_EQ(1u, successfulTransmits);
+	EXPECT_EQ(1u, failedTransmits);
+	EXPECT_TRUE(CANNetworkManager::CANNetwork.send_can_message(0xFF00, testData, 8, &testInternalECU));
+}
+
+TEST_F(DM13_NETWORK_TESTS, SuspensionTimesOutPerChannel)
+{
+	NAME testName(0);
+	testName.set_arbitrary_address_capable(true);
+	testName.set_industry_group(1);
+	testName.set_function_code(static_cast<std::uint8_t>(NAME::Function::EngineValveController));
+	testName.set_identity_number(14);
+	testName.set_manufacturer_code(69);
+	InternalControlFunction testInternalECU(testName, 0x1E, 0);
+
+	for (std::uint32_t i = 0; (i < 100) && (!testInternalECU.get_address_valid()); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	ASSERT_TRUE(testInternalECU.get_address_valid());
+
+	// Channel 0 is suspended first, then channel 1 half way through channel 0's timeout
+	inject_dm13(0xFC, 0);
+	ASSERT_TRUE(wait_for_broadcasts_suspended(0, true));
+	std::this_thread::sleep_for(std::chrono::milliseconds(DM13_TIMEOUT_MS / 2));
+	inject_dm13(0xFC, 1);
+	ASSERT_TRUE(wait_for_broadcasts_suspended(1, true));
+	EXPECT_TRUE(CANNetworkManager::CANNetwork.get_broadcasts_suspended(0));
+
+	// Only channel 0 times out, since channel 1's DM13 is more recent
+	for (std::uint32_t i = 0; (i < 400) && (CANNetworkManager::CANNetwork.get_broadcasts_suspended(0)); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	EXPECT_FALSE(CANNetworkManager::CANNetwork.get_broadcasts_suspended(0));
+	EXPECT_TRUE(CANNetworkManager::CANNetwork.get_broadcasts_suspended(1));
+
+	inject_dm13(0xFD, 1);
+	EXPECT_TRUE(wait_for_broadcasts_suspended(1, false));
+}
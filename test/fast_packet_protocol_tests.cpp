@@ -0,0 +1,420 @@
+#include <gtest/gtest.h>
+
+#include "isobus/hardware_integration/can_hardware_interface.hpp"
+#include "isobus/hardware_integration/virtual_can_plugin.hpp"
+#include "isobus/isobus/can_identifier.hpp"
+#include "isobus/isobus/can_internal_control_function.hpp"
+#include "isobus/isobus/can_network_configuration.hpp"
+#include "isobus/isobus/can_network_manager.hpp"
+#include "isobus/isobus/nmea2000_fast_packet_protocol.hpp"
+#include "isobus/utility/system_timing.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace isobus;
+
+namespace
+{
+	constexpr std::uint32_t TEST_PGN = 0x1F805; // GNSS position data
+
+	std::vector<std::vector<std::uint8_t>> receivedMessages;
+
+	std::atomic<std::uint32_t> receivedMessageCount = { 0 };
+	std::atomic_bool networkUpdatesPaused = { false };
+
+	std::mutex transmittedFramesMutex;
+	std::vector<HardwareInterfaceCANFrame> transmittedFrames;
+	std::atomic<std::uint32_t> transmittedMessages = { 0 };
+	std::atomic<std::uint32_t> framesPerSession[3] = { { 0 }, { 0 }, { 0 } };
+
+	void test_fast_packet_callback(CANMessage *message, void *)
+	{
+		receivedMessages.push_back(message->get_data());
+		receivedMessageCount++;
+	}
+
+	void test_fast_packet_tx_callback(std::uint32_t, std::uint32_t, InternalControlFunction *, ControlFunction *, bool successful, void *)
+	{
+		if (successful)
+		{
+			transmittedMessages++;
+		}
+	}
+
+	std::vector<HardwareInterfaceCANFrame> build_fast_packet_frames(std::uint8_t sourceAddress, std::uint8_t sequenceNumber, const std::vector<std::uint8_t> &payload)
+	{
+		std::vector<HardwareInterfaceCANFrame> retVal;
+		std::size_t payloadIndex = 0;
+		std::uint8_t frameCounter = 0;
+
+		while ((0 == frameCounter) || (payloadIndex < payload.size()))
+		{
+			HardwareInterfaceCANFrame frame;
+			std::uint8_t dataIndex = 1;
+
+			frame.timestamp_us = 0;
+			frame.identifier = CANIdentifier(CANIdentifier::Type::Extended, TEST_PGN, CANIdentifier::CANPriority::PriorityDefault6, 0xFF, sourceAddress).get_identifier();
+			frame.channel = 0;
+			frame.dataLength = 8;
+			frame.isExtendedFrame = true;
+			frame.data[0] = static_cast<std::uint8_t>((sequenceNumber << 5) | frameCounter);
+
+			if (0 == frameCounter)
+			{
+				frame.data[1] = static_cast<std::uint8_t>(payload.size());
+				dataIndex = 2;
+			}
+
+			for (; dataIndex < 8; dataIndex++)
+			{
+				frame.data[dataIndex] = (payloadIndex < payload.size()) ? payload[payloadIndex++] : 0xFF;
+			}
+			retVal.push_back(frame);
+			frameCounter++;
+		}
+		return retVal;
+	}
+
+	/// Updates the network manager, unless a test has paused updates to queue several messages at once
+	void update_network()
+	{
+		if (!networkUpdatesPaused)
+		{
+			CANNetworkManager::CANNetwork.update();
+		}
+	}
+
+	/// Counts the frames sent for each of the three test PGNs, then passes every frame to the stack
+	void count_session_frames(HardwareInterfaceCANFrame &rxFrame, void *parentPointer)
+	{
+		const std::uint32_t parameterGroupNumber = CANIdentifier(rxFrame.identifier).get_parameter_group_number();
+
+		if ((1 == rxFrame.channel) &&
+		    (parameterGroupNumber >= TEST_PGN) &&
+		    (parameterGroupNumber < TEST_PGN + 3))
+		{
+			framesPerSession[parameterGroupNumber - TEST_PGN]++;
+		}
+		CANNetworkManager::CANNetwork.can_lib_process_rx_message(rxFrame, parentPointer);
+	}
+
+	/// Records the frames sent for the three test PGNs, then passes every frame to the stack
+	void record_session_frames(HardwareInterfaceCANFrame &rxFrame, void *parentPointer)
+	{
+		const std::uint32_t parameterGroupNumber = CANIdentifier(rxFrame.identifier).get_parameter_group_number();
+
+		if ((1 == rxFrame.channel) &&
+		    (parameterGroupNumber >= TEST_PGN) &&
+		    (parameterGroupNumber < TEST_PGN + 3))
+		{
+			const std::lock_guard<std::mutex> lock(transmittedFramesMutex);
+			transmittedFrames.push_back(rxFrame);
+		}
+		CANNetworkManager::CANNetwork.can_lib_process_rx_message(rxFrame, parentPointer);
+	}
+
+	void receive_frame(HardwareInterfaceCANFrame &frame)
+	{
+		// The first update initializes the network manager, which clears the Rx queue
+		CANNetworkManager::CANNetwork.update();
+		CANNetworkManager::CANNetwork.can_lib_process_rx_message(frame, nullptr);
+		CANNetworkManager::CANNetwork.update();
+	}
+} // namespace
+
+TEST(FAST_PACKET_PROTOCOL_TESTS, ReceiveMaximumLengthMessage)
+{
+	std::vector<std::uint8_t> payload(223);
+
+	for (std::size_t i = 0; i < payload.size(); i++)
+	{
+		payload[i] = static_cast<std::uint8_t>(i);
+	}
+	receivedMessages.clear();
+	FastPacketProtocol::Protocol.register_multipacket_message_callback(TEST_PGN, test_fast_packet_callback, nullptr);
+
+	auto frames = build_fast_packet_frames(0x30, 2, payload);
+	EXPECT_EQ(32u, frames.size());
+
+	for (auto &frame : frames)
+	{
+		receive_frame(frame);
+	}
+
+	ASSERT_EQ(1u, receivedMessages.size());
+	EXPECT_EQ(payload, receivedMessages[0]);
+	FastPacketProtocol::Protocol.remove_multipacket_message_callback(TEST_PGN, test_fast_packet_callback, nullptr);
+}
+
+TEST(FAST_PACKET_PROTOCOL_TESTS, InterleavedSessions)
+{
+	const std::vector<std::uint8_t> firstPayload = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20 };
+	const std::vector<std::uint8_t> secondPayload = { 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40 };
+	const std::vector<std::uint8_t> otherSourcePayload = { 41, 42, 43, 44, 45, 46, 47, 48, 49, 50 };
+
+	receivedMessages.clear();
+	FastPacketProtocol::Protocol.register_multipacket_message_callback(TEST_PGN, test_fast_packet_callback, nullptr);
+
+	// Two sequence numbers from the same source, plus another source, all at once
+	auto firstFrames = build_fast_packet_frames(0x31, 3, firstPayload);
+	auto secondFrames = build_fast_packet_frames(0x31, 4, secondPayload);
+	auto otherSourceFrames = build_fast_packet_frames(0x32, 3, otherSourcePayload);
+	ASSERT_EQ(firstFrames.size(), secondFrames.size());
+
+	for (std::size_t i = 0; i < firstFrames.size(); i++)
+	{
+		receive_frame(firstFrames[i]);
+		receive_frame(secondFrames[i]);
+
+		if (i < otherSourceFrames.size())
+		{
+			receive_frame(otherSourceFrames[i]);
+		}
+	}
+
+	ASSERT_EQ(3u, receivedMessages.size());
+	EXPECT_EQ(otherSourcePayload, receivedMessages[0]);
+	EXPECT_EQ(firstPayload, receivedMessages[1]);
+	EXPECT_EQ(secondPayload, receivedMessages[2]);
+	FastPacketProtocol::Protocol.remove_multipacket_message_callback(TEST_PGN, test_fast_packet_callback, nullptr);
+}
+
+TEST(FAST_PACKET_PROTOCOL_TESTS, RestartedSessionAndRemovedCallback)
+{
+	const std::vector<std::uint8_t> payload = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20 };
+
+	receivedMessages.clear();
+	FastPacketProtocol::Protocol.register_multipacket_message_callback(TEST_PGN, test_fast_packet_callback, nullptr);
+
+	// A repeated first frame restarts the session instead of dropping the message
+	auto frames = build_fast_packet_frames(0x33, 1, payload);
+	receive_frame(frames[0]);
+	receive_frame(frames[1]);
+
+	for (auto &frame : frames)
+	{
+		receive_frame(frame);
+	}
+	ASSERT_EQ(1u, receivedMessages.size());
+	EXPECT_EQ(payload, receivedMessages[0]);
+
+	// Once the callback is removed the PGN is no longer parsed
+	FastPacketProtocol::Protocol.remove_multipacket_message_callback(TEST_PGN, test_fast_packet_callback, nullptr);
+	for (auto &frame : frames)
+	{
+		receive_frame(frame);
+	}
+	EXPECT_EQ(1u, receivedMessages.size());
+}
+
+TEST(FAST_PACKET_PROTOCOL_TESTS, ReceiveFrameBoundaryLengths)
+{
+	// The first frame carries 6 bytes and the rest carry 7, so these lengths exactly fill 1, 2 and 3 frames
+	const std::vector<std::size_t> lengths = { 6, 13, 20 };
+
+	receivedMessages.clear();
+	FastPacketProtocol::Protocol.register_multipacket_message_callback(TEST_PGN, test_fast_packet_callback, nullptr);
+
+	for (std::size_t i = 0; i < lengths.size(); i++)
+	{
+		std::vector<std::uint8_t> payload(lengths[i]);
+
+		for (std::size_t j = 0; j < payload.size(); j++)
+		{
+			payload[j] = static_cast<std::uint8_t>(j + 1);
+		}
+
+		auto frames = build_fast_packet_frames(0x32, static_cast<std::uint8_t>(i), payload);
+		ASSERT_EQ(i + 1, frames.size());
+
+		for (auto &frame : frames)
+		{
+			EXPECT_EQ(i, receivedMessages.size());
+			receive_frame(frame);
+		}
+
+		// Complete after the last frame, without waiting for a frame that never comes
+		ASSERT_EQ(i + 1, receivedMessages.size());
+		EXPECT_EQ(payload, receivedMessages[i]);
+	}
+	FastPacketProtocol::Protocol.remove_multipacket_message_callback(TEST_PGN, test_fast_packet_callback, nullptr);
+}
+
+TEST(FAST_PACKET_PROTOCOL_TESTS, TransmitFrameBoundaryLengths)
+{
+	const std::vector<std::uint8_t> lengths = { 6, 13, 20 };
+
+	for (auto &frameCount : framesPerSession)
+	{
+		frameCount = 0;
+	}
+
+	std::shared_ptr<VirtualCANPlugin> firstDevice = std::make_shared<VirtualCANPlugin>();
+	std::shared_ptr<VirtualCANPlugin> secondDevice = std::make_shared<VirtualCANPlugin>();
+	CANHardwareInterface::set_number_of_can_channels(2);
+	CANHardwareInterface::assign_can_channel_frame_handler(0, firstDevice);
+	CANHardwareInterface::assign_can_channel_frame_handler(1, secondDevice);
+	CANHardwareInterface::start();
+
+	CANHardwareInterface::add_can_lib_update_callback(update_network, nullptr);
+	CANHardwareInterface::add_raw_can_message_rx_callback(count_session_frames, nullptr);
+
+	NAME testName(0);
+	testName.set_arbitrary_address_capable(true);
+	testName.set_industry_group(4);
+	testName.set_function_code(static_cast<std::uint8_t>(NAME::Function::VehicleNavigation));
+	testName.set_identity_number(13);
+	testName.set_manufacturer_code(69);
+	InternalControlFunction testInternalECU(testName, 0x1C, 0);
+
+	std::vector<std::uint8_t> payload(20);
+	for (std::size_t i = 0; i < payload.size(); i++)
+	{
+		payload[i] = static_cast<std::uint8_t>(i + 1);
+	}
+
+	for (std::uint32_t i = 0; (i < 100) && (!testInternalECU.get_address_valid()); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	ASSERT_TRUE(testInternalECU.get_address_valid());
+
+	receivedMessages.clear();
+	receivedMessageCount = 0;
+	transmittedMessages = 0;
+
+	for (std::uint8_t i = 0; i < lengths.size(); i++)
+	{
+		FastPacketProtocol::Protocol.register_multipacket_message_callback(TEST_PGN + i, test_fast_packet_callback, nullptr);
+		EXPECT_TRUE(FastPacketProtocol::Protocol.send_multipacket_message(TEST_PGN + i, payload.data(), lengths[i], &testInternalECU, nullptr, CANIdentifier::CANPriority::PriorityDefault6, test_fast_packet_tx_callback));
+
+		for (std::uint32_t j = 0; (j < 100) && ((receivedMessageCount < (i + 1u)) || (transmittedMessages < (i + 1u))); j++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		ASSERT_EQ(i + 1u, receivedMessages.size());
+		EXPECT_EQ(std::vector<std::uint8_t>(payload.begin(), payload.begin() + lengths[i]), receivedMessages[i]);
+		EXPECT_EQ(i + 1u, transmittedMessages);
+	}
+
+	// Give any extra frame time to show up before counting
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	for (std::uint8_t i = 0; i < lengths.size(); i++)
+	{
+		EXPECT_EQ(i + 1u, framesPerSession[i]);
+		FastPacketProtocol::Protocol.remove_multipacket_message_callback(TEST_PGN + i, test_fast_packet_callback, nullptr);
+	}
+	CANHardwareInterface::remove_can_lib_update_callback(update_network, nullptr);
+	CANHardwareInterface::remove_raw_can_message_rx_callback(count_session_frames, nullptr);
+	CANHardwareInterface::stop();
+}
+
+TEST(FAST_PACKET_PROTOCOL_TESTS, ConcurrentAndPacedTransmit)
+{
+	std::shared_ptr<VirtualCANPlugin> firstDevice = std::make_shared<VirtualCANPlugin>();
+	std::shared_ptr<VirtualCANPlugin> secondDevice = std::make_shared<VirtualCANPlugin>();
+	CANHardwareInterface::set_number_of_can_channels(2);
+	CANHardwareInterface::assign_can_channel_frame_handler(0, firstDevice);
+	CANHardwareInterface::assign_can_channel_frame_handler(1, secondDevice);
+	CANHardwareInterface::start();
+
+	CANHardwareInterface::add_can_lib_update_callback(update_network, nullptr);
+	CANHardwareInterface::add_raw_can_message_rx_callback(record_session_frames, nullptr);
+
+	NAME testName(0);
+	testName.set_arbitrary_address_capable(true);
+	testName.set_industry_group(4);
+	testName.set_function_code(static_cast<std::uint8_t>(NAME::Function::VehicleNavigation));
+	testName.set_identity_number(12);
+	testName.set_manufacturer_code(69);
+	InternalControlFunction testInternalECU(testName, 0x1C, 0);
+
+	std::vector<std::uint8_t> payload(223);
+	for (std::size_t i = 0; i < payload.size(); i++)
+	{
+		payload[i] = static_cast<std::uint8_t>(i);
+	}
+
+	for (std::uint32_t i = 0; (i < 100) && (!testInternalECU.get_address_valid()); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	ASSERT_TRUE(testInternalECU.get_address_valid());
+
+	receivedMessages.clear();
+	receivedMessageCount = 0;
+	transmittedMessages = 0;
+	FastPacketProtocol::Protocol.register_multipacket_message_callback(TEST_PGN, test_fast_packet_callback, nullptr);
+	FastPacketProtocol::Protocol.register_multipacket_message_callback(TEST_PGN + 1, test_fast_packet_callback, nullptr);
+	FastPacketProtocol::Protocol.register_multipacket_message_callback(TEST_PGN + 2, test_fast_packet_callback, nullptr);
+
+	// Several sessions at once, at different priorities. Updates are paused so that all of them are queued before the first frame goes out.
+	networkUpdatesPaused = true;
+	EXPECT_TRUE(FastPacketProtocol::Protocol.send_multipacket_message(TEST_PGN, payload.data(), 223, &testInternalECU, nullptr, CANIdentifier::CANPriority::PriorityLowest7, test_fast_packet_tx_callback));
+	EXPECT_TRUE(FastPacketProtocol::Protocol.send_multipacket_message(TEST_PGN + 1, payload.data(), 100, &testInternalECU, nullptr, CANIdentifier::CANPriority::Priority3, test_fast_packet_tx_callback));
+	EXPECT_TRUE(FastPacketProtocol::Protocol.send_multipacket_message(TEST_PGN + 2, payload.data(), 100, &testInternalECU, nullptr, CANIdentifier::CANPriority::Priority3, test_fast_packet_tx_callback));
+	networkUpdatesPaused = false;
+
+	for (std::uint32_t i = 0; (i < 100) && (receivedMessageCount < 3); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	ASSERT_EQ(3u, receivedMessages.size());
+	EXPECT_EQ(3u, transmittedMessages);
+	for (auto &message : receivedMessages)
+	{
+		EXPECT_EQ(std::vector<std::uint8_t>(payload.begin(), payload.begin() + message.size()), message);
+	}
+
+	{
+		// The two priority 3 sessions take turns, one frame each, and the priority 7 session waits until they're done
+		const std::lock_guard<std::mutex> lock(transmittedFramesMutex);
+		ASSERT_EQ(15u + 15u + 32u, transmittedFrames.size());
+
+		for (std::size_t i = 0; i < transmittedFrames.size(); i++)
+		{
+			const HardwareInterfaceCANFrame &frame = transmittedFrames[i];
+			std::uint32_t expectedPGN = TEST_PGN;
+			std::uint8_t expectedFrameCounter = static_cast<std::uint8_t>(i - 30);
+
+			if (i < 30)
+			{
+				expectedPGN = TEST_PGN + 1 + (i % 2);
+				expectedFrameCounter = static_cast<std::uint8_t>(i / 2);
+			}
+			EXPECT_EQ(expectedPGN, CANIdentifier(frame.identifier).get_parameter_group_number());
+			EXPECT_EQ(expectedFrameCounter, frame.data[0] & 0x1F);
+		}
+		transmittedFrames.clear();
+	}
+
+	// With a frame gap, a 32 frame message can't be sent faster than 31 gaps
+	CANNetworkConfiguration::set_minimum_time_between_fast_packet_frames_us(2000);
+	EXPECT_EQ(2000u, CANNetworkConfiguration::get_minimum_time_between_fast_packet_frames_us());
+	receivedMessages.clear();
+	receivedMessageCount = 0;
+	transmittedMessages = 0;
+
+	std::uint32_t startTime = SystemTiming::get_timestamp_ms();
+	EXPECT_TRUE(FastPacketProtocol::Protocol.send_multipacket_message(TEST_PGN, payload.data(), 223, &testInternalECU, nullptr, CANIdentifier::CANPriority::PriorityDefault6, test_fast_packet_tx_callback));
+
+	for (std::uint32_t i = 0; (i < 100) && (receivedMessageCount < 1); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	ASSERT_EQ(1u, receivedMessages.size());
+	EXPECT_EQ(payload, receivedMessages[0]);
+	EXPECT_GE(SystemTiming::get_time_elapsed_ms(startTime), 62u);
+	CANNetworkConfiguration::set_minimum_time_between_fast_packet_frames_us(0);
+
+	FastPacketProtocol::Protocol.remove_multipacket_message_callback(TEST_PGN, test_fast_packet_callback, nullptr);
+	FastPacketProtocol::Protocol.remove_multipacket_message_callback(TEST_PGN + 1, test_fast_packet_callback, nullptr);
+	FastPacketProtocol::Protocol.remove_multipacket_message_callback(TEST_PGN + 2, test_fast_packet_callback, nullptr);
+	CANHardwareInterface::remove_can_lib_update_callback(update_network, nullptr);
+	CANHardwareInterface::remove_raw_can_message_rx_callback(record_session_frames, nullptr);
+	CANHardwareInterface::stop();
+}
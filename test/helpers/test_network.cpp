@@ -0,0 +1,126 @@
+#include "test_network.hpp"
+
+#include "isobus/hardware_integration/can_hardware_interface.hpp"
+#include "isobus/hardware_integration/virtual_can_plugin.hpp"
+#include "isobus/isobus/can_identifier.hpp"
+#include "isobus/isobus/can_network_manager.hpp"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace isobus;
+
+namespace test_helpers
+{
+	namespace
+	{
+		std::mutex transmittedFramesMutex;
+		std::vector<HardwareInterfaceCANFrame> transmittedFrames;
+		bool networkStarted = false;
+
+		void update_network()
+		{
+			CANNetworkManager::CANNetwork.update();
+		}
+
+		void receive_frame(HardwareInterfaceCANFrame &rxFrame, void *)
+		{
+			if (1 == rxFrame.channel)
+			{
+				const std::lock_guard<std::mutex> lock(transmittedFramesMutex);
+				transmittedFrames.push_back(rxFrame);
+			}
+			else
+			{
+				CANNetworkManager::CANNetwork.can_lib_process_rx_message(rxFrame, nullptr);
+			}
+		}
+	} // namespace
+
+	void start_test_network()
+	{
+		std::shared_ptr<VirtualCANPlugin> firstDevice = std::make_shared<VirtualCANPlugin>();
+		std::shared_ptr<VirtualCANPlugin> secondDevice = std::make_shared<VirtualCANPlugin>();
+
+		clear_transmitted_frames();
+		CANHardwareInterface::set_number_of_can_channels(2);
+		CANHardwareInterface::assign_can_channel_frame_handler(0, firstDevice);
+		CANHardwareInterface::assign_can_channel_frame_handler(1, secondDevice);
+		CANHardwareInterface::start();
+		CANHardwareInterface::add_can_lib_update_callback(update_network, nullptr);
+		CANHardwareInterface::add_raw_can_message_rx_callback(receive_frame, nullptr);
+		networkStarted = true;
+	}
+
+	void stop_test_network()
+	{
+		if (networkStarted)
+		{
+			CANHardwareInterface::remove_can_lib_update_callback(update_network, nullptr);
+			CANHardwareInterface::remove_raw_can_message_rx_callback(receive_frame, nullptr);
+			CANHardwareInterface::stop();
+			networkStarted = false;
+		}
+	}
+
+	std::vector<HardwareInterfaceCANFrame> get_transmitted_frames()
+	{
+		const std::lock_guard<std::mutex> lock(transmittedFramesMutex);
+		return transmittedFrames;
+	}
+
+	void clear_transmitted_frames()
+	{
+		const std::lock_guard<std::mutex> lock(transmittedFramesMutex);
+		transmittedFrames.clear();
+	}
+
+	std::size_t count_transmitted_frames(std::uint32_t parameterGroupNumber)
+	{
+		const std::lock_guard<std::mutex> lock(transmittedFramesMutex);
+		std::size_t retVal = 0;
+
+		for (auto &frame : transmittedFrames)
+		{
+			if (CANIdentifier(frame.identifier).get_parameter_group_number() == parameterGroupNumber)
+			{
+				retVal++;
+			}
+		}
+		return retVal;
+	}
+
+	bool wait_for_transmitted_frame(std::uint32_t parameterGroupNumber, std::size_t skip, HardwareInterfaceCANFrame &frame)
+	{
+		bool retVal = false;
+
+		for (std::uint32_t i = 0; (i < 200) && (!retVal); i++)
+		{
+			{
+				const std::lock_guard<std::mutex> lock(transmittedFramesMutex);
+				std::size_t matches = 0;
+
+				for (auto transmittedFrame = transmittedFrames.begin(); (transmittedFrame != transmittedFrames.end()) && (!retVal); transmittedFrame++)
+				{
+					if (CANIdentifier(transmittedFrame->identifier).get_parameter_group_number() == parameterGroupNumber)
+					{
+						if (matches == skip)
+						{
+							frame = *transmittedFrame;
+							retVal = true;
+						}
+						matches++;
+					}
+				}
+			}
+
+			if (!retVal)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+		}
+		return retVal;
+	}
+} // namespace test_helpers
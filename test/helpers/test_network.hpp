@@ -0,0 +1,49 @@
+//================================================================================================
+/// @file test_network.hpp
+///
+/// @brief Runs the stack on a virtual CAN bus for tests, and records the frames it sends.
+/// @details Tests that start the network must stop it before they end, otherwise its callbacks
+/// keep feeding frames to the stack during the tests that come after them. Calling
+/// stop_test_network from a fixture's TearDown does this even when an assertion fails.
+//================================================================================================
+#ifndef TEST_NETWORK_HPP
+#define TEST_NETWORK_HPP
+
+#include "isobus/isobus/can_frame.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace test_helpers
+{
+	/// @brief Starts the hardware interface on two virtual CAN channels and adds the network update and Rx callbacks
+	/// @details Frames received on channel 0 are passed to the network manager, and frames received on channel 1 are recorded.
+	/// Any frames recorded by an earlier test are cleared first.
+	void start_test_network();
+
+	/// @brief Removes the callbacks added by start_test_network and stops the hardware interface
+	/// @details This does nothing if the test network isn't running, so it is safe to call from every TearDown.
+	void stop_test_network();
+
+	/// @brief Returns a copy of the frames the stack has sent since the test network started
+	/// @returns The frames the stack has sent, in the order they were sent
+	std::vector<isobus::HardwareInterfaceCANFrame> get_transmitted_frames();
+
+	/// @brief Forgets the frames the stack has sent so far
+	void clear_transmitted_frames();
+
+	/// @brief Counts the frames the stack has sent with a PGN
+	/// @param[in] parameterGroupNumber The PGN to count
+	/// @returns The number of frames sent with that PGN
+	std::size_t count_transmitted_frames(std::uint32_t parameterGroupNumber);
+
+	/// @brief Waits up to 2 seconds for the stack to send a frame with a PGN
+	/// @param[in] parameterGroupNumber The PGN to wait for
+	/// @param[in] skip The number of frames with that PGN to skip, so that 0 waits for the first one
+	/// @param[out] frame The frame that was sent
+	/// @returns true if the frame was sent in time, otherwise false
+	bool wait_for_transmitted_frame(std::uint32_t parameterGroupNumber, std::size_t skip, isobus::HardwareInterfaceCANFrame &frame);
+} // namespace test_helpers
+
+#endif // TEST_NETWORK_HPP
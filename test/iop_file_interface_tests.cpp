@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include "isobus/utility/iop_file_interface.hpp"
+#include "isobus/utility/xxhash.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+using namespace isobus;
+
+TEST(IOP_FILE_INTERFACE_TESTS, XXHash64ReferenceValues)
+{
+	const std::uint8_t abc[] = { 'a', 'b', 'c' };
+	const char sentence[] = "Nobody inspects the spammish repetition";
+	const char shortInput[] = "xxhash";
+
+	// Values from the reference xxHash implementation
+	EXPECT_EQ(0xEF46DB3751D8E999ULL, XXHash64::hash(nullptr, 0));
+	EXPECT_EQ(0x44BC2CF5AD770999ULL, XXHash64::hash(abc, sizeof(abc)));
+	EXPECT_EQ(0xB559B98D844E0635ULL, XXHash64::hash(reinterpret_cast<const std::uint8_t *>(shortInput), std::strlen(shortInput), 20141025));
+	EXPECT_NE(XXHash64::hash(abc, sizeof(abc)), XXHash64::hash(abc, sizeof(abc), 1));
+
+	// Longer than one 32 byte stripe, so the four lanes are used
+	EXPECT_EQ(0xFBCEA83C8A378BF1ULL, XXHash64::hash(reinterpret_cast<const std::uint8_t *>(sentence), std::strlen(sentence)));
+
+	// Three stripes followed by an 8 byte, a 4 byte, and a 3 byte tail
+	std::vector<std::uint8_t> data(111);
+	for (std::size_t i = 0; i < data.size(); i++)
+	{
+		data[i] = static_cast<std::uint8_t>((i * 7) ^ (i >> 3));
+	}
+	EXPECT_EQ(0xFAC17704682116FFULL, XXHash64::hash(data.data(), data.size()));
+	EXPECT_EQ(0x4D16E49F69DDDAC5ULL, XXHash64::hash(data.data(), data.size(), 1));
+}
+
+TEST(IOP_FILE_INTERFACE_TESTS, XXHash64Incremental)
+{
+	std::vector<std::uint8_t> data(1000);
+
+	for (std::size_t i = 0; i < data.size(); i++)
+	{
+		data[i] = static_cast<std::uint8_t>((i * 7) ^ (i >> 3));
+	}
+
+	const std::uint64_t expectedHash = XXHash64::hash(data.data(), data.size());
+
+	// Every way of splitting up the data gives the same hash, including chunks smaller and larger than a stripe
+	for (std::size_t chunkSize = 1; chunkSize < 100; chunkSize += 3)
+	{
+		XXHash64 hasher;
+
+		for (std::size_t position = 0; position < data.size(); position += chunkSize)
+		{
+			hasher.update(&data[position], std::min(chunkSize, data.size() - position));
+		}
+		EXPECT_EQ(expectedHash, hasher.digest());
+		EXPECT_EQ(data.size(), hasher.get_total_length());
+	}
+
+	// Changing one bit changes the hash
+	data[500] ^= 0x01;
+	EXPECT_NE(expectedHash, XXHash64::hash(data.data(), data.size()));
+}
+
+TEST(IOP_FILE_INTERFACE_TESTS, VersionLabels)
+{
+	std::vector<std::uint8_t> testPool = IOPFileInterface::read_iop_file("../examples/vt_version_3_object_pool/VT3TestPool.iop");
+	ASSERT_NE(0, testPool.size());
+
+	const std::string version = IOPFileInterface::hash_object_pool_to_version(testPool);
+	const std::string extendedVersion = IOPFileInterface::hash_object_pool_to_extended_version(testPool);
+	EXPECT_EQ(ObjectPoolHasher::VERSION_LABEL_LENGTH, version.size());
+	EXPECT_EQ(ObjectPoolHasher::EXTENDED_VERSION_LABEL_LENGTH, extendedVersion.size());
+
+	for (char character : version + extendedVersion)
+	{
+		EXPECT_TRUE(std::isalnum(static_cast<unsigned char>(character)));
+	}
+
+	// Hashing while reading gives the same labels as hashing afterwards
+	ObjectPoolHasher readHasher;
+	EXPECT_EQ(testPool, IOPFileInterface::read_iop_file("../examples/vt_version_3_object_pool/VT3TestPool.iop", readHasher));
+	EXPECT_EQ(version, readHasher.get_version());
+	EXPECT_EQ(extendedVersion, readHasher.get_extended_version());
+
+	ObjectPoolHasher chunkHasher;
+	chunkHasher.update(testPool.data(), 100);
+	chunkHasher.update(&testPool[100], testPool.size() - 100);
+	EXPECT_EQ(version, chunkHasher.get_version());
+
+	chunkHasher.reset();
+	EXPECT_NE(version, chunkHasher.get_version());
+
+	// Changing the pool changes both labels
+	testPool.back() ^= 0x80;
+	EXPECT_NE(version, IOPFileInterface::hash_object_pool_to_version(testPool));
+	EXPECT_NE(extendedVersion, IOPFileInterface::hash_object_pool_to_extended_version(testPool));
+
+	ObjectPoolHasher missingFileHasher;
+	EXPECT_TRUE(IOPFileInterface::read_iop_file("this_file_does_not_exist.iop", missingFileHasher).empty());
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include "isobus/isobus/can_message_schema.hpp"
+
+#include <array>
+
+using namespace isobus;
+
+// Electronic engine controller 1, J1939-71
+using EngineTorqueMode = MessageField<0, 4>;
+using DriverDemandTorque = ScaledMessageField<MessageField<8, 8>, 1, 1, -125>;
+using EngineSpeed = ScaledMessageField<MessageField<24, 16>, 1, 8, 0>;
+using EngineStarterMode = MessageField<48, 4>;
+using EEC1Layout = MessageLayout<8, EngineTorqueMode, DriverDemandTorque, EngineSpeed, EngineStarterMode>;
+static_assert(8 == EEC1Layout::DATA_LENGTH, "EEC1 is 8 bytes");
+
+TEST(MESSAGE_SCHEMA_TESTS, RawFieldRoundTrip)
+{
+	std::array<std::uint8_t, 8> data;
+	data.fill(0xFF);
+
+	using Unaligned = MessageField<21, 3>;
+	using Wide = MessageField<4, 40>;
+
+	Unaligned::encode(data.data(), 0x05);
+	EXPECT_EQ(0xBF, data[2]); // Only bits 5 to 7 change
+	EXPECT_EQ(0x05u, Unaligned::decode(data.data()));
+
+	Unaligned::encode(data.data(), 0xFA); // Too big, only the low 3 bits are kept
+	EXPECT_EQ(0x02u, Unaligned::decode(data.data()));
+
+	data.fill(0x00);
+	Wide::encode(data.data(), 0x123456789AULL);
+	EXPECT_EQ(0xA0, data[0]);
+	EXPECT_EQ(0x89, data[1]);
+	EXPECT_EQ(0x67, data[2]);
+	EXPECT_EQ(0x45, data[3]);
+	EXPECT_EQ(0x23, data[4]);
+	EXPECT_EQ(0x01, data[5]);
+	EXPECT_EQ(0x123456789AULL, Wide::decode(data.data()));
+
+	using Everything = MessageField<0, 64>;
+	Everything::encode_not_available(data.data());
+	for (const auto &byte : data)
+	{
+		EXPECT_EQ(0xFF, byte);
+	}
+	EXPECT_EQ(0xFFFFFFFFFFFFFFFFULL, Everything::decode(data.data()));
+}
+
+TEST(MESSAGE_SCHEMA_TESTS, BigEndianField)
+{
+	std::array<std::uint8_t, 8> data;
+	data.fill(0x00);
+
+	using BigEndianWord = MessageField<16, 32, CANMessage::ByteFormat::BigEndian>;
+
+	BigEndianWord::encode(data.data(), 0x11223344);
+	EXPECT_EQ(0x00, data[1]);
+	EXPECT_EQ(0x11, data[2]);
+	EXPECT_EQ(0x22, data[3]);
+	EXPECT_EQ(0x33, data[4]);
+	EXPECT_EQ(0x44, data[5]);
+	EXPECT_EQ(0x00, data[6]);
+	EXPECT_EQ(0x11223344u, BigEndianWord::decode(data.data()));
+}
+
+TEST(MESSAGE_SCHEMA_TESTS, ScaledFields)
+{
+	std::array<std::uint8_t, 8> data;
+	double value = 0.0;
+
+	EEC1Layout::initialize(data.data());
+	EXPECT_FALSE(EngineSpeed::decode_value(data.data(), value)); // Not available
+
+	EngineSpeed::encode_value(data.data(), 1500.0);
+	EXPECT_EQ(0xE0, data[3]);
+	EXPECT_EQ(0x2E, data[4]);
+	EXPECT_TRUE(EngineSpeed::decode_value(data.data(), value));
+	EXPECT_DOUBLE_EQ(1500.0, value);
+
+	// 0.125 rpm per bit, so this rounds to the nearest step
+	EngineSpeed::encode_value(data.data(), 1000.06);
+	EXPECT_TRUE(EngineSpeed::decode_value(data.data(), value));
+	EXPECT_DOUBLE_EQ(1000.0, value);
+
+	// Values out of range are clamped
+	EngineSpeed::encode_value(data.data(), 100000.0);
+	EXPECT_EQ(0xFAFFu, EngineSpeed::decode(data.data()));
+	EXPECT_DOUBLE_EQ(8031.875, EngineSpeed::get_maximum_value());
+	EngineSpeed::encode_value(data.data(), -10.0);
+	EXPECT_EQ(0u, EngineSpeed::decode(data.data()));
+
+	DriverDemandTorque::encode_value(data.data(), -25.0);
+	EXPECT_EQ(100, data[1]);
+	EXPECT_TRUE(DriverDemandTorque::decode_value(data.data(), value));
+	EXPECT_DOUBLE_EQ(-25.0, value);
+	EXPECT_DOUBLE_EQ(-125.0, DriverDemandTorque::get_minimum_value());
+	EXPECT_DOUBLE_EQ(125.0, DriverDemandTorque::get_maximum_value());
+
+	// The neighbouring fields are untouched
+	EXPECT_EQ(0x0Fu, EngineTorqueMode::decode(data.data()));
+	EXPECT_EQ(0x0Fu, EngineStarterMode::decode(data.data()));
+	EXPECT_EQ(0xFF, data[2]);
+	EXPECT_EQ(0xFF, data[5]);
+	EXPECT_EQ(0xFF, data[7]);
+}
+
+TEST(MESSAGE_SCHEMA_TESTS, LayoutChecks)
+{
+	EXPECT_TRUE((MessageLayoutChecks<8, MessageField<0, 32>, MessageField<32, 32>>::get_fields_fit()));
+	EXPECT_TRUE((MessageLayoutChecks<8, MessageField<0, 32>, MessageField<32, 32>>::get_fields_disjoint()));
+	EXPECT_FALSE((MessageLayoutChecks<4, MessageField<0, 32>, MessageField<30, 4>>::get_fields_fit()));
+	EXPECT_FALSE((MessageLayoutChecks<8, MessageField<0, 32>, MessageField<31, 4>>::get_fields_disjoint()));
+	EXPECT_TRUE((MessageLayoutChecks<8>::get_fields_disjoint()));
+
+	EXPECT_EQ(0xFAu, get_j1939_maximum_valid_value(8));
+	EXPECT_EQ(0xFAFFu, get_j1939_maximum_valid_value(16));
+	EXPECT_EQ(1u, get_j1939_maximum_valid_value(2));
+	EXPECT_EQ(13u, get_j1939_maximum_valid_value(4));
+}
@@ -0,0 +1,717 @@
+#include <gtest/gtest.h>
+
+#include "helpers/test_network.hpp"
+#include "isobus/isobus/can_NAME_filter.hpp"
+#include "isobus/isobus/can_identifier.hpp"
+#include "isobus/isobus/can_internal_control_function.hpp"
+#include "isobus/isobus/can_network_configuration.hpp"
+#include "isobus/isobus/can_network_manager.hpp"
+#include "isobus/isobus/can_partnered_control_function.hpp"
+#include "isobus/isobus/can_transmit_data_source.hpp"
+#include "isobus/utility/memory_mapped_file.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace isobus;
+
+namespace
+{
+	/// A non-contiguous source, so protocols have to read it with read()
+	class CountingDataSource : public TransmitDataSource
+	{
+	public:
+		explicit CountingDataSource(std::uint32_t length) :
+		  size(length)
+		{
+		}
+
+		std::uint32_t get_size() const override
+		{
+			return size;
+		}
+
+		bool read(std::uint32_t offset, std::uint32_t length, std::uint8_t *destination) override
+		{
+			readCalls++;
+			for (std::uint32_t i = 0; i < length; i++)
+			{
+				destination[i] = static_cast<std::uint8_t>(offset + i);
+			}
+			return (offset + length) <= size;
+		}
+
+		std::uint32_t readCalls = 0;
+
+	private:
+		std::uint32_t size;
+	};
+
+	/// A contiguous source, so protocols copy straight out of get_data()
+	class ContiguousDataSource : public TransmitDataSource
+	{
+	public:
+		explicit ContiguousDataSource(std::uint32_t length) :
+		  data(length)
+		{
+			for (std::uint32_t i = 0; i < length; i++)
+			{
+				data[i] = static_cast<std::uint8_t>(i);
+			}
+		}
+
+		std::uint32_t get_size() const override
+		{
+			return static_cast<std::uint32_t>(data.size());
+		}
+
+		const std::uint8_t *get_data() const override
+		{
+			return data.data();
+		}
+
+		bool read(std::uint32_t offset, std::uint32_t length, std::uint8_t *destination) override
+		{
+			bool retVal = false;
+
+			if ((offset + length) <= data.size())
+			{
+				std::copy(data.begin() + offset, data.begin() + offset + length, destination);
+				retVal = true;
+			}
+			return retVal;
+		}
+
+	private:
+		std::vector<std::uint8_t> data;
+	};
+
+	constexpr std::uint8_t PEER_ADDRESS = 0x50; ///< The address of the ECU the tests play the part of
+	constexpr std::uint32_t PEER_IDENTITY_NUMBER = 0x50; ///< Keeps the peer's NAME apart from control functions earlier tests left on the bus
+	constexpr std::uint32_t TEST_PGN = 0xEF00; ///< Proprietary A, which is destination specific
+	constexpr std::uint32_t TP_CM_PGN = 0xEC00;
+	constexpr std::uint32_t TP_DT_PGN = 0xEB00;
+	constexpr std::uint32_t ETP_CM_PGN = 0xC800;
+	constexpr std::uint32_t ETP_DT_PGN = 0xC700;
+
+	std::map<std::uint32_t, std::size_t> nextFrameIndices;
+
+	std::atomic<std::uint32_t> successfulTransmits = { 0 };
+	std::atomic<std::uint32_t> failedTransmits = { 0 };
+	std::atomic<std::uint32_t> chunkCallbacks = { 0 };
+	std::mutex receivedDataMutex;
+	std::vector<std::vector<std::uint8_t>> receivedData;
+
+	void test_transmit_complete_callback(std::uint32_t, std::uint32_t, InternalControlFunction *, ControlFunction *, bool successful, void *)
+	{
+		if (successful)
+		{
+			successfulTransmits++;
+		}
+		else
+		{
+			failedTransmits++;
+		}
+	}
+
+	bool test_chunk_callback(std::uint32_t, std::uint32_t bytesOffset, std::uint32_t numberOfBytesNeeded, std::uint8_t *chunkBuffer, void *)
+	{
+		chunkCallbacks++;
+		for (std::uint32_t i = 0; i < numberOfBytesNeeded; i++)
+		{
+			chunkBuffer[i] = static_cast<std::uint8_t>(bytesOffset + i);
+		}
+		return true;
+	}
+
+	void test_receive_callback(CANMessage *message, void *)
+	{
+		const std::lock_guard<std::mutex> lock(receivedDataMutex);
+		receivedData.push_back(message->get_data());
+	}
+
+	/// Clears what earlier tests recorded, then runs the stack on the test network
+	void start_test_network()
+	{
+		nextFrameIndices.clear();
+		successfulTransmits = 0;
+		failedTransmits = 0;
+		chunkCallbacks = 0;
+		test_helpers::start_test_network();
+	}
+
+	/// Receives a frame on channel 0 as if the peer had sent it
+	void inject_peer_frame(std::uint32_t parameterGroupNumber, std::uint8_t destinationAddress, const std::array<std::uint8_t, 8> &data)
+	{
+		HardwareInterfaceCANFrame frame;
+		frame.timestamp_us = 0;
+		frame.identifier = CANIdentifier(CANIdentifier::Type::Extended, parameterGroupNumber, CANIdentifier::CANPriority::PriorityDefault6, destinationAddress, PEER_ADDRESS).get_identifier();
+		frame.channel = 0;
+		frame.dataLength = 8;
+		frame.isExtendedFrame = true;
+		for (std::uint8_t i = 0; i < 8; i++)
+		{
+			frame.data[i] = data[i];
+		}
+		CANNetworkManager::can_lib_process_rx_message(frame, nullptr);
+	}
+
+	/// Claims the peer's address, so the stack can bind a partner to it
+	void inject_peer_address_claim(const NAME &peerName)
+	{
+		const std::uint64_t fullName = peerName.get_full_name();
+		std::array<std::uint8_t, 8> data;
+
+		for (std::uint8_t i = 0; i < 8; i++)
+		{
+			data[i] = static_cast<std::uint8_t>(fullName >> (8 * i));
+		}
+		inject_peer_frame(0xEE00, 0xFF, data);
+	}
+
+	/// Gets the next frame the stack sent with a PGN, waiting up to a second for it.
+	/// Each PGN is read in the order it was sent, independently of the others.
+	bool get_next_stack_frame(std::uint32_t parameterGroupNumber, HardwareInterfaceCANFrame &frame)
+	{
+		bool retVal = false;
+
+		for (std::uint32_t i = 0; (i < 200) && (!retVal); i++)
+		{
+			{
+				const std::vector<HardwareInterfaceCANFrame> transmittedFrames = test_helpers::get_transmitted_frames();
+				std::size_t &frameIndex = nextFrameIndices[parameterGroupNumber];
+
+				for (; frameIndex < transmittedFrames.size(); frameIndex++)
+				{
+					if (parameterGroupNumber == CANIdentifier(transmittedFrames[frameIndex].identifier).get_parameter_group_number())
+					{
+						frame = transmittedFrames[frameIndex];
+						frameIndex++;
+						retVal = true;
+						break;
+					}
+				}
+			}
+
+			if (!retVal)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			}
+		}
+		return retVal;
+	}
+
+	/// Builds a TP or ETP connection management message for the test PGN
+	std::array<std::uint8_t, 8> make_connection_management_data(std::uint8_t multiplexor, std::uint8_t byte1, std::uint8_t byte2, std::uint8_t byte3, std::uint8_t byte4)
+	{
+		return { multiplexor,
+			       byte1,
+			       byte2,
+			       byte3,
+			       byte4,
+			       static_cast<std::uint8_t>(TEST_PGN),
+			       static_cast<std::uint8_t>(TEST_PGN >> 8),
+			       static_cast<std::uint8_t>(TEST_PGN >> 16) };
+	}
+
+	/// Sends a data packet from the peer, filled with the bytes of the test pattern at that packet's offset
+	void inject_peer_data_packet(std::uint32_t dataPGN, std::uint8_t stackAddress, std::uint8_t sequenceNumber, std::uint32_t packetIndex, std::uint32_t messageLength)
+	{
+		std::array<std::uint8_t, 8> data;
+
+		data[0] = sequenceNumber;
+		for (std::uint32_t i = 0; i < 7; i++)
+		{
+			const std::uint32_t offset = (7 * packetIndex) + i;
+			data[i + 1] = (offset < messageLength) ? static_cast<std::uint8_t>(offset) : 0xFF;
+		}
+		inject_peer_frame(dataPGN, stackAddress, data);
+	}
+
+	/// Waits for the stack to receive a message and checks it's the test pattern
+	bool wait_for_received_message(std::uint32_t messageLength)
+	{
+		bool retVal = false;
+
+		for (std::uint32_t i = 0; (i < 200) && (!retVal); i++)
+		{
+			{
+				const std::lock_guard<std::mutex> lock(receivedDataMutex);
+
+				if (!receivedData.empty())
+				{
+					std::vector<std::uint8_t> expectedData(messageLength);
+
+					for (std::uint32_t j = 0; j < messageLength; j++)
+					{
+						expectedData[j] = static_cast<std::uint8_t>(j);
+					}
+					retVal = (expectedData == receivedData.front());
+					receivedData.clear();
+					break;
+				}
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		return retVal;
+	}
+
+	/// Builds an ETP CTS for the test PGN
+	std::array<std::uint8_t, 8> make_extended_clear_to_send(std::uint8_t numberOfPackets, std::uint32_t nextPacket)
+	{
+		return make_connection_management_data(0x15, numberOfPackets, static_cast<std::uint8_t>(nextPacket), static_cast<std::uint8_t>(nextPacket >> 8), static_cast<std::uint8_t>(nextPacket >> 16));
+	}
+
+	/// Reads a window of data packets from the stack and appends their payload
+	bool read_data_packets(std::uint32_t dataPGN, std::uint8_t firstSequenceNumber, std::uint8_t numberOfPackets, std::vector<std::uint8_t> &payload)
+	{
+		bool retVal = true;
+
+		for (std::uint8_t i = 0; (i < numberOfPackets) && (retVal); i++)
+		{
+			HardwareInterfaceCANFrame frame;
+
+			retVal = (get_next_stack_frame(dataPGN, frame) && (static_cast<std::uint8_t>(firstSequenceNumber + i) == frame.data[0]));
+			payload.insert(payload.end(), &frame.data[1], &frame.data[8]);
+		}
+		return retVal;
+	}
+
+	/// Plays the receiver of a TP session from the stack, with CTS windows of a fixed size
+	bool receive_transport_protocol_message(std::uint8_t stackAddress, std::uint8_t packetsPerWindow, std::vector<std::uint8_t> &payload)
+	{
+		HardwareInterfaceCANFrame frame;
+		bool retVal = (get_next_stack_frame(TP_CM_PGN, frame) && (0x10 == frame.data[0]));
+		const std::uint16_t messageLength = static_cast<std::uint16_t>(frame.data[1] | (frame.data[2] << 8));
+		const std::uint8_t numberOfPackets = frame.data[3];
+
+		payload.clear();
+		for (std::uint8_t nextPacket = 1; (nextPacket <= numberOfPackets) && (retVal); nextPacket += packetsPerWindow)
+		{
+			const std::uint8_t windowSize = std::min<std::uint8_t>(packetsPerWindow, numberOfPackets - nextPacket + 1);
+
+			inject_peer_frame(TP_CM_PGN, stackAddress, make_connection_management_data(0x11, windowSize, nextPacket, 0xFF, 0xFF));
+			retVal = read_data_packets(TP_DT_PGN, nextPacket, windowSize, payload);
+		}
+
+		if (retVal)
+		{
+			inject_peer_frame(TP_CM_PGN, stackAddress, make_connection_management_data(0x13, static_cast<std::uint8_t>(messageLength), static_cast<std::uint8_t>(messageLength >> 8), numberOfPackets, 0xFF));
+		}
+		return retVal;
+	}
+
+	/// Plays the receiver of an ETP session from the stack, with the largest CTS windows allowed
+	bool receive_extended_transport_protocol_message(std::uint8_t stackAddress, std::vector<std::uint8_t> &payload)
+	{
+		HardwareInterfaceCANFrame frame;
+		bool retVal = (get_next_stack_frame(ETP_CM_PGN, frame) && (0x14 == frame.data[0]));
+		const std::uint32_t messageLength = (frame.data[1] | (frame.data[2] << 8) | (frame.data[3] << 16) | (static_cast<std::uint32_t>(frame.data[4]) << 24));
+		const std::uint32_t numberOfPackets = ((messageLength - 1) / 7) + 1;
+
+		payload.clear();
+		for (std::uint32_t nextPacket = 1; (nextPacket <= numberOfPackets) && (retVal); nextPacket += 0xFF)
+		{
+			const std::uint8_t windowSize = static_cast<std::uint8_t>(std::min<std::uint32_t>(0xFF, numberOfPackets - nextPacket + 1));
+
+			inject_peer_frame(ETP_CM_PGN, stackAddress, make_extended_clear_to_send(windowSize, nextPacket));
+
+			// Every window starts with a data packet offset message
+			retVal = (get_next_stack_frame(ETP_CM_PGN, frame) &&
+			          (0x16 == frame.data[0]) &&
+			          (windowSize == frame.data[1]) &&
+			          ((nextPacket - 1) == static_cast<std::uint32_t>(frame.data[2] | (frame.data[3] << 8) | (frame.data[4] << 16))) &&
+			          (read_data_packets(ETP_DT_PGN, 1, windowSize, payload)));
+		}
+
+		if (retVal)
+		{
+			inject_peer_frame(ETP_CM_PGN, stackAddress, make_connection_management_data(0x17, static_cast<std::uint8_t>(messageLength), static_cast<std::uint8_t>(messageLength >> 8), static_cast<std::uint8_t>(messageLength >> 16), static_cast<std::uint8_t>(messageLength >> 24)));
+		}
+		return retVal;
+	}
+
+	bool wait_for_transmit_result()
+	{
+		for (std::uint32_t i = 0; (i < 200) && (0 == (successfulTransmits + failedTransmits)); i++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		return (1 == successfulTransmits) && (0 == failedTransmits);
+	}
+
+	NAME make_test_name(NAME::Function function, std::uint32_t identityNumber)
+	{
+		NAME retVal(0);
+		retVal.set_arbitrary_address_capable(true);
+		retVal.set_industry_group(1);
+		retVal.set_function_code(static_cast<std::uint8_t>(function));
+		retVal.set_identity_number(identityNumber);
+		retVal.set_manufacturer_code(69);
+		return retVal;
+	}
+
+	/// Waits for the stack to claim an address, then claims the peer's address so the partner binds to it
+	bool connect_to_peer(const InternalControlFunction &internalECU, const PartneredControlFunction &partner)
+	{
+		for (std::uint32_t i = 0; (i < 100) && (!internalECU.get_address_valid()); i++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		inject_peer_address_claim(make_test_name(NAME::Function::SeatControl, PEER_IDENTITY_NUMBER));
+
+		for (std::uint32_t i = 0; (i < 100) && (!partner.get_address_valid()); i++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		// The partner binds as soon as the claim arrives, but the address table is only updated by the next network update
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		return internalECU.get_address_valid() && partner.get_address_valid();
+	}
+} // namespace
+
+/// Runs each test on the test network, and stops it and restores the defaults when the test ends, even if the test failed
+class TRANSPORT_PROTOCOL_NETWORK_TESTS : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		start_test_network();
+	}
+
+	void TearDown() override
+	{
+		test_helpers::stop_test_network();
+		CANNetworkManager::CANNetwork.remove_any_control_function_parameter_group_number_callback(TEST_PGN, test_receive_callback, nullptr);
+		CANNetworkConfiguration::set_transport_protocol_window_data_chunk_callbacks(false);
+		CANNetworkConfiguration::set_max_number_transport_protocol_retransmit_requests(2);
+	}
+};
+
+TEST(TRANSPORT_PROTOCOL_TESTS, MemoryMappedFileDataSource)
+{
+	const std::string fileName = "tp_test_data_source.bin";
+	std::vector<std::uint8_t> fileContents(100);
+
+	for (std::size_t i = 0; i < fileContents.size(); i++)
+	{
+		fileContents[i] = static_cast<std::uint8_t>(i);
+	}
+	{
+		std::ofstream file(fileName, std::ios::binary);
+		file.write(reinterpret_cast<const char *>(fileContents.data()), fileContents.size());
+	}
+
+	MemoryMappedFileDataSource source(fileName);
+
+	if (MemoryMappedFile::get_is_supported())
+	{
+		std::uint8_t buffer[10] = { 0 };
+
+		ASSERT_TRUE(source.get_is_valid());
+		EXPECT_EQ(100u, source.get_size());
+		ASSERT_NE(nullptr, source.get_data());
+		EXPECT_EQ(42, source.get_data()[42]);
+		EXPECT_TRUE(source.read(90, 10, buffer));
+		EXPECT_EQ(95, buffer[5]);
+		EXPECT_FALSE(source.read(95, 10, buffer));
+	}
+	else
+	{
+		EXPECT_FALSE(source.get_is_valid());
+	}
+
+	MemoryMappedFileDataSource missingSource("this_file_does_not_exist.bin");
+	EXPECT_FALSE(missingSource.get_is_valid());
+	EXPECT_EQ(0u, missingSource.get_size());
+	std::remove(fileName.c_str());
+}
+
+TEST(TRANSPORT_PROTOCOL_TESTS, SendFromDataSourceValidation)
+{
+	NAME testName(0);
+	testName.set_arbitrary_address_capable(true);
+	testName.set_industry_group(1);
+	testName.set_identity_number(5);
+	testName.set_manufacturer_code(69);
+	InternalControlFunction testInternalECU(testName, 0x1E, 0);
+
+	// Nothing is running, so the ECU hasn't claimed an address
+	auto source = std::make_shared<CountingDataSource>(100);
+	EXPECT_FALSE(CANNetworkManager::CANNetwork.send_can_message_from_data_source(0xFEEC, nullptr, &testInternalECU));
+	EXPECT_FALSE(CANNetworkManager::CANNetwork.send_can_message_from_data_source(0xFEEC, source, nullptr));
+	EXPECT_FALSE(CANNetworkManager::CANNetwork.send_can_message_from_data_source(0xFEEC, source, &testInternalECU));
+	EXPECT_FALSE(CANNetworkManager::CANNetwork.send_can_message_from_data_source(0xFEEC, std::make_shared<CountingDataSource>(0), &testInternalECU));
+	EXPECT_EQ(0u, source->readCalls);
+}
+
+TEST(TRANSPORT_PROTOCOL_TESTS, RetransmitRequestConfiguration)
+{
+	const std::uint8_t defaultRetransmitRequests = CANNetworkConfiguration::get_max_number_transport_protocol_retransmit_requests();
+
+	EXPECT_EQ(2, defaultRetransmitRequests);
+	CANNetworkConfiguration::set_max_number_transport_protocol_retransmit_requests(0);
+	EXPECT_EQ(0, CANNetworkConfiguration::get_max_number_transport_protocol_retransmit_requests());
+	CANNetworkConfiguration::set_max_number_transport_protocol_retransmit_requests(defaultRetransmitRequests);
+}
+
+TEST_F(TRANSPORT_PROTOCOL_NETWORK_TESTS, DataSourceConnectionModeTransfers)
+{
+	InternalControlFunction testInternalECU(make_test_name(NAME::Function::CabClimateControl, 1), 0x1C, 0);
+	PartneredControlFunction testPartner(0, { NAMEFilter(NAME::NAMEParameters::FunctionCode, static_cast<std::uint8_t>(NAME::Function::SeatControl)), NAMEFilter(NAME::NAMEParameters::IdentityNumber, PEER_IDENTITY_NUMBER) });
+	ASSERT_TRUE(connect_to_peer(testInternalECU, testPartner));
+
+	// A TP message read in two CTS windows, so the source is read once per window
+	auto source = std::make_shared<CountingDataSource>(100);
+	std::vector<std::uint8_t> payload;
+	ASSERT_TRUE(CANNetworkManager::CANNetwork.send_can_message_from_data_source(TEST_PGN, source, &testInternalECU, &testPartner, CANIdentifier::CANPriority::PriorityDefault6, test_transmit_complete_callback));
+	ASSERT_TRUE(receive_transport_protocol_message(testInternalECU.get_address(), 8, payload));
+	EXPECT_TRUE(wait_for_transmit_result());
+	EXPECT_EQ(2u, source->readCalls);
+	ASSERT_EQ(105u, payload.size());
+	for (std::uint32_t i = 0; i < 100; i++)
+	{
+		EXPECT_EQ(static_cast<std::uint8_t>(i), payload[i]);
+	}
+	EXPECT_EQ(std::vector<std::uint8_t>(5, 0xFF), std::vector<std::uint8_t>(payload.begin() + 100, payload.end()));
+
+	// An ETP message that needs two CTS windows of 255 packets
+	successfulTransmits = 0;
+	source = std::make_shared<CountingDataSource>(2000);
+	ASSERT_TRUE(CANNetworkManager::CANNetwork.send_can_message_from_data_source(TEST_PGN, source, &testInternalECU, &testPartner, CANIdentifier::CANPriority::PriorityDefault6, test_transmit_complete_callback));
+	ASSERT_TRUE(receive_extended_transport_protocol_message(testInternalECU.get_address(), payload));
+	EXPECT_TRUE(wait_for_transmit_result());
+	EXPECT_EQ(2u, source->readCalls);
+	ASSERT_EQ(2002u, payload.size());
+	for (std::uint32_t i = 0; i < 2000; i++)
+	{
+		EXPECT_EQ(static_cast<std::uint8_t>(i), payload[i]);
+	}
+}
+
+TEST_F(TRANSPORT_PROTOCOL_NETWORK_TESTS, WindowedDataChunkCallbacks)
+{
+	InternalControlFunction testInternalECU(make_test_name(NAME::Function::CabClimateControl, 3), 0x1C, 0);
+	PartneredControlFunction testPartner(0, { NAMEFilter(NAME::NAMEParameters::FunctionCode, static_cast<std::uint8_t>(NAME::Function::SeatControl)), NAMEFilter(NAME::NAMEParameters::IdentityNumber, PEER_IDENTITY_NUMBER) });
+	ASSERT_TRUE(connect_to_peer(testInternalECU, testPartner));
+
+	// By default the callback is asked for one packet at a time
+	std::vector<std::uint8_t> payload;
+	EXPECT_FALSE(CANNetworkConfiguration::get_transport_protocol_window_data_chunk_callbacks());
+	ASSERT_TRUE(CANNetworkManager::CANNetwork.send_can_message(TEST_PGN, nullptr, 100, &testInternalECU, &testPartner, CANIdentifier::CANPriority::PriorityDefault6, test_transmit_complete_callback, nullptr, test_chunk_callback));
+	ASSERT_TRUE(receive_transport_protocol_message(testInternalECU.get_address(), 8, payload));
+	EXPECT_TRUE(wait_for_transmit_result());
+	EXPECT_EQ(15u, chunkCallbacks);
+
+	// With windowed callbacks it's asked once per CTS window instead
+	CANNetworkConfiguration::set_transport_protocol_window_data_chunk_callbacks(true);
+	successfulTransmits = 0;
+	chunkCallbacks = 0;
+	ASSERT_TRUE(CANNetworkManager::CANNetwork.send_can_message(TEST_PGN, nullptr, 100, &testInternalECU, &testPartner, CANIdentifier::CANPriority::PriorityDefault6, test_transmit_complete_callback, nullptr, test_chunk_callback));
+	ASSERT_TRUE(receive_transport_protocol_message(testInternalECU.get_address(), 8, payload));
+	EXPECT_TRUE(wait_for_transmit_result());
+	EXPECT_EQ(2u, chunkCallbacks);
+	for (std::uint32_t i = 0; i < 100; i++)
+	{
+		EXPECT_EQ(static_cast<std::uint8_t>(i), payload[i]);
+	}
+
+	successfulTransmits = 0;
+	chunkCallbacks = 0;
+	ASSERT_TRUE(CANNetworkManager::CANNetwork.send_can_message(TEST_PGN, nullptr, 2000, &testInternalECU, &testPartner, CANIdentifier::CANPriority::PriorityDefault6, test_transmit_complete_callback, nullptr, test_chunk_callback));
+	ASSERT_TRUE(receive_extended_transport_protocol_message(testInternalECU.get_address(), payload));
+	EXPECT_TRUE(wait_for_transmit_result());
+	EXPECT_EQ(2u, chunkCallbacks);
+	for (std::uint32_t i = 0; i < 2000; i++)
+	{
+		EXPECT_EQ(static_cast<std::uint8_t>(i), payload[i]);
+	}
+}
+
+TEST_F(TRANSPORT_PROTOCOL_NETWORK_TESTS, ClearToSendPastEndOfMessage)
+{
+	InternalControlFunction testInternalECU(make_test_name(NAME::Function::CabClimateControl, 4), 0x1C, 0);
+	PartneredControlFunction testPartner(0, { NAMEFilter(NAME::NAMEParameters::FunctionCode, static_cast<std::uint8_t>(NAME::Function::SeatControl)), NAMEFilter(NAME::NAMEParameters::IdentityNumber, PEER_IDENTITY_NUMBER) });
+	ASSERT_TRUE(connect_to_peer(testInternalECU, testPartner));
+
+	// The peer asks for 5 packets of a 2 packet TP message, the extras are all padding
+	HardwareInterfaceCANFrame frame;
+	std::vector<std::uint8_t> payload;
+	ASSERT_TRUE(CANNetworkManager::CANNetwork.send_can_message_from_data_source(TEST_PGN, std::make_shared<ContiguousDataSource>(10), &testInternalECU, &testPartner, CANIdentifier::CANPriority::PriorityDefault6, test_transmit_complete_callback));
+	ASSERT_TRUE(get_next_stack_frame(TP_CM_PGN, frame));
+	EXPECT_EQ(0x10, frame.data[0]);
+	inject_peer_frame(TP_CM_PGN, testInternalECU.get_address(), make_connection_management_data(0x11, 5, 1, 0xFF, 0xFF));
+	ASSERT_TRUE(read_data_packets(TP_DT_PGN, 1, 5, payload));
+	for (std::uint32_t i = 0; i < payload.size(); i++)
+	{
+		EXPECT_EQ((i < 10) ? static_cast<std::uint8_t>(i) : 0xFF, payload[i]);
+	}
+	inject_peer_frame(TP_CM_PGN, testInternalECU.get_address(), make_connection_management_data(0x13, 10, 0, 2, 0xFF));
+	EXPECT_TRUE(wait_for_transmit_result());
+
+	// Same for ETP, with a last window of 10 packets when only 3 are left
+	successfulTransmits = 0;
+	ASSERT_TRUE(CANNetworkManager::CANNetwork.send_can_message_from_data_source(TEST_PGN, std::make_shared<ContiguousDataSource>(1800), &testInternalECU, &testPartner, CANIdentifier::CANPriority::PriorityDefault6, test_transmit_complete_callback));
+	ASSERT_TRUE(get_next_stack_frame(ETP_CM_PGN, frame));
+	EXPECT_EQ(0x14, frame.data[0]);
+	inject_peer_frame(ETP_CM_PGN, testInternalECU.get_address(), make_extended_clear_to_send(0xFF, 1));
+	ASSERT_TRUE(get_next_stack_frame(ETP_CM_PGN, frame));
+	EXPECT_EQ(0x16, frame.data[0]);
+	payload.clear();
+	ASSERT_TRUE(read_data_packets(ETP_DT_PGN, 1, 0xFF, payload));
+	inject_peer_frame(ETP_CM_PGN, testInternalECU.get_address(), make_extended_clear_to_send(10, 256));
+	ASSERT_TRUE(get_next_stack_frame(ETP_CM_PGN, frame));
+	EXPECT_EQ(0x16, frame.data[0]);
+	ASSERT_TRUE(read_data_packets(ETP_DT_PGN, 1, 10, payload));
+	ASSERT_EQ(1855u, payload.size());
+	for (std::uint32_t i = 0; i < payload.size(); i++)
+	{
+		EXPECT_EQ((i < 1800) ? static_cast<std::uint8_t>(i) : 0xFF, payload[i]);
+	}
+	inject_peer_frame(ETP_CM_PGN, testInternalECU.get_address(), make_connection_management_data(0x17, static_cast<std::uint8_t>(1800), static_cast<std::uint8_t>(1800 >> 8), 0, 0));
+	EXPECT_TRUE(wait_for_transmit_result());
+}
+
+TEST_F(TRANSPORT_PROTOCOL_NETWORK_TESTS, TransportProtocolRetransmitRequests)
+{
+	InternalControlFunction testInternalECU(make_test_name(NAME::Function::CabClimateControl, 5), 0x1C, 0);
+	PartneredControlFunction testPartner(0, { NAMEFilter(NAME::NAMEParameters::FunctionCode, static_cast<std::uint8_t>(NAME::Function::SeatControl)), NAMEFilter(NAME::NAMEParameters::IdentityNumber, PEER_IDENTITY_NUMBER) });
+	ASSERT_TRUE(connect_to_peer(testInternalECU, testPartner));
+	CANNetworkManager::CANNetwork.add_any_control_function_parameter_group_number_callback(TEST_PGN, test_receive_callback, nullptr);
+	const std::uint8_t stackAddress = testInternalECU.get_address();
+
+	// As a receiver, a lost packet is asked for again
+	HardwareInterfaceCANFrame frame;
+	inject_peer_frame(TP_CM_PGN, stackAddress, make_connection_management_data(0x10, 20, 0, 3, 0xFF));
+	ASSERT_TRUE(get_next_stack_frame(TP_CM_PGN, frame));
+	EXPECT_EQ(0x11, frame.data[0]);
+	EXPECT_EQ(3, frame.data[1]);
+	EXPECT_EQ(1, frame.data[2]);
+	inject_peer_data_packet(TP_DT_PGN, stackAddress, 1, 0, 20);
+	inject_peer_data_packet(TP_DT_PGN, stackAddress, 3, 2, 20);
+	ASSERT_TRUE(get_next_stack_frame(TP_CM_PGN, frame));
+	EXPECT_EQ(0x11, frame.data[0]);
+	EXPECT_EQ(2, frame.data[1]);
+	EXPECT_EQ(2, frame.data[2]);
+	inject_peer_data_packet(TP_DT_PGN, stackAddress, 2, 1, 20);
+	inject_peer_data_packet(TP_DT_PGN, stackAddress, 3, 2, 20);
+	ASSERT_TRUE(get_next_stack_frame(TP_CM_PGN, frame));
+	EXPECT_EQ(0x13, frame.data[0]);
+	EXPECT_TRUE(wait_for_received_message(20));
+
+	// As a sender, a CTS that points back into sent data rewinds the session
+	std::array<std::uint8_t, 20> messageData;
+	std::vector<std::uint8_t> payload;
+	for (std::uint8_t i = 0; i < messageData.size(); i++)
+	{
+		messageData[i] = i;
+	}
+	ASSERT_TRUE(CANNetworkManager::CANNetwork.send_can_message(TEST_PGN, messageData.data(), 20, &testInternalECU, &testPartner, CANIdentifier::CANPriority::PriorityDefault6, test_transmit_complete_callback));
+	ASSERT_TRUE(get_next_stack_frame(TP_CM_PGN, frame));
+	EXPECT_EQ(0x10, frame.data[0]);
+	inject_peer_frame(TP_CM_PGN, stackAddress, make_connection_management_data(0x11, 3, 1, 0xFF, 0xFF));
+	ASSERT_TRUE(read_data_packets(TP_DT_PGN, 1, 3, payload));
+	payload.clear();
+	inject_peer_frame(TP_CM_PGN, stackAddress, make_connection_management_data(0x11, 2, 2, 0xFF, 0xFF));
+	ASSERT_TRUE(read_data_packets(TP_DT_PGN, 2, 2, payload));
+	for (std::uint32_t i = 0; i < 13; i++)
+	{
+		EXPECT_EQ(static_cast<std::uint8_t>(i + 7), payload[i]);
+	}
+	inject_peer_frame(TP_CM_PGN, stackAddress, make_connection_management_data(0x13, 20, 0, 3, 0xFF));
+	EXPECT_TRUE(wait_for_transmit_result());
+
+	// With retransmits off, a receiver aborts on the first lost packet
+	CANNetworkConfiguration::set_max_number_transport_protocol_retransmit_requests(0);
+	inject_peer_frame(TP_CM_PGN, stackAddress, make_connection_management_data(0x10, 20, 0, 3, 0xFF));
+	ASSERT_TRUE(get_next_stack_frame(TP_CM_PGN, frame));
+	EXPECT_EQ(0x11, frame.data[0]);
+	inject_peer_data_packet(TP_DT_PGN, stackAddress, 1, 0, 20);
+	inject_peer_data_packet(TP_DT_PGN, stackAddress, 3, 2, 20);
+	ASSERT_TRUE(get_next_stack_frame(TP_CM_PGN, frame));
+	EXPECT_EQ(0xFF, frame.data[0]);
+	EXPECT_EQ(7, frame.data[1]);
+}
+
+TEST_F(TRANSPORT_PROTOCOL_NETWORK_TESTS, ExtendedTransportProtocolRetransmitRequests)
+{
+	InternalControlFunction testInternalECU(make_test_name(NAME::Function::CabClimateControl, 6), 0x1C, 0);
+	PartneredControlFunction testPartner(0, { NAMEFilter(NAME::NAMEParameters::FunctionCode, static_cast<std::uint8_t>(NAME::Function::SeatControl)), NAMEFilter(NAME::NAMEParameters::IdentityNumber, PEER_IDENTITY_NUMBER) });
+	ASSERT_TRUE(connect_to_peer(testInternalECU, testPartner));
+	CANNetworkManager::CANNetwork.add_any_control_function_parameter_group_number_callback(TEST_PGN, test_receive_callback, nullptr);
+	const std::uint8_t stackAddress = testInternalECU.get_address();
+
+	// As a receiver, packets that arrive out of order are asked for again
+	HardwareInterfaceCANFrame frame;
+	inject_peer_frame(ETP_CM_PGN, stackAddress, make_connection_management_data(0x14, 20, 0, 0, 0));
+	ASSERT_TRUE(get_next_stack_frame(ETP_CM_PGN, frame));
+	EXPECT_EQ(0x15, frame.data[0]);
+	EXPECT_EQ(3, frame.data[1]);
+	EXPECT_EQ(1, frame.data[2]);
+	inject_peer_frame(ETP_CM_PGN, stackAddress, make_connection_management_data(0x16, 3, 0, 0, 0));
+	inject_peer_data_packet(ETP_DT_PGN, stackAddress, 1, 0, 20);
+	inject_peer_data_packet(ETP_DT_PGN, stackAddress, 3, 2, 20);
+	inject_peer_data_packet(ETP_DT_PGN, stackAddress, 2, 1, 20);
+	ASSERT_TRUE(get_next_stack_frame(ETP_CM_PGN, frame));
+	EXPECT_EQ(0x15, frame.data[0]);
+	EXPECT_EQ(2, frame.data[1]);
+	EXPECT_EQ(2, frame.data[2]);
+	inject_peer_frame(ETP_CM_PGN, stackAddress, make_connection_management_data(0x16, 2, 1, 0, 0));
+	inject_peer_data_packet(ETP_DT_PGN, stackAddress, 1, 1, 20);
+	inject_peer_data_packet(ETP_DT_PGN, stackAddress, 2, 2, 20);
+	ASSERT_TRUE(get_next_stack_frame(ETP_CM_PGN, frame));
+	EXPECT_EQ(0x17, frame.data[0]);
+	EXPECT_TRUE(wait_for_received_message(20));
+
+	// As a sender, a CTS that points back into sent data rewinds the session
+	std::vector<std::uint8_t> messageData(1800);
+	std::vector<std::uint8_t> payload;
+	for (std::uint32_t i = 0; i < messageData.size(); i++)
+	{
+		messageData[i] = static_cast<std::uint8_t>(i);
+	}
+	ASSERT_TRUE(CANNetworkManager::CANNetwork.send_can_message(TEST_PGN, messageData.data(), 1800, &testInternalECU, &testPartner, CANIdentifier::CANPriority::PriorityDefault6, test_transmit_complete_callback));
+	ASSERT_TRUE(get_next_stack_frame(ETP_CM_PGN, frame));
+	EXPECT_EQ(0x14, frame.data[0]);
+	inject_peer_frame(ETP_CM_PGN, stackAddress, make_extended_clear_to_send(0xFF, 1));
+	ASSERT_TRUE(get_next_stack_frame(ETP_CM_PGN, frame));
+	EXPECT_EQ(0x16, frame.data[0]);
+	ASSERT_TRUE(read_data_packets(ETP_DT_PGN, 1, 0xFF, payload));
+	payload.clear();
+	inject_peer_frame(ETP_CM_PGN, stackAddress, make_extended_clear_to_send(59, 200));
+	ASSERT_TRUE(get_next_stack_frame(ETP_CM_PGN, frame));
+	EXPECT_EQ(0x16, frame.data[0]);
+	EXPECT_EQ(59, frame.data[1]);
+	EXPECT_EQ(199, frame.data[2]);
+	ASSERT_TRUE(read_data_packets(ETP_DT_PGN, 1, 59, payload));
+	for (std::uint32_t i = 0; i < (1800 - (199 * 7)); i++)
+	{
+		EXPECT_EQ(static_cast<std::uint8_t>(i + (199 * 7)), payload[i]);
+	}
+	inject_peer_frame(ETP_CM_PGN, stackAddress, make_connection_management_data(0x17, static_cast<std::uint8_t>(1800), static_cast<std::uint8_t>(1800 >> 8), 0, 0));
+	EXPECT_TRUE(wait_for_transmit_result());
+
+	// With retransmits off, out of order packets are dropped without aborting
+	CANNetworkConfiguration::set_max_number_transport_protocol_retransmit_requests(0);
+	inject_peer_frame(ETP_CM_PGN, stackAddress, make_connection_management_data(0x14, 20, 0, 0, 0));
+	ASSERT_TRUE(get_next_stack_frame(ETP_CM_PGN, frame));
+	EXPECT_EQ(0x15, frame.data[0]);
+	inject_peer_frame(ETP_CM_PGN, stackAddress, make_connection_management_data(0x16, 3, 0, 0, 0));
+	inject_peer_data_packet(ETP_DT_PGN, stackAddress, 1, 0, 20);
+	inject_peer_data_packet(ETP_DT_PGN, stackAddress, 3, 2, 20);
+	inject_peer_data_packet(ETP_DT_PGN, stackAddress, 1, 0, 20);
+	inject_peer_data_packet(ETP_DT_PGN, stackAddress, 2, 1, 20);
+	inject_peer_data_packet(ETP_DT_PGN, stackAddress, 3, 2, 20);
+	ASSERT_TRUE(get_next_stack_frame(ETP_CM_PGN, frame));
+	EXPECT_EQ(0x17, frame.data[0]);
+	EXPECT_TRUE(wait_for_received_message(20));
+}
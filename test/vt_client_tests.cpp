@@ -5,6 +5,15 @@
 #include "isobus/hardware_integration/virtual_can_plugin.hpp"
 #include "isobus/isobus/can_network_manager.hpp"
 #include "isobus/isobus/isobus_virtual_terminal_client.hpp"
+#include "isobus/isobus/isobus_virtual_terminal_object_pool_index.hpp"
+#include "isobus/isobus/isobus_virtual_terminal_object_pool_manifest.hpp"
+#include "isobus/isobus/isobus_virtual_terminal_scaled_pool_cache.hpp"
+#include "isobus/utility/memory_mapped_file.hpp"
+#include "isobus/utility/system_timing.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
 
 using namespace isobus;
 
@@ -60,6 +69,40 @@ public:
 		largeFontSizesBitfield = largeFontsBitfield;
 	}
 
+	void test_wrapper_set_vt_geometry(std::uint16_t dataMaskPixels, std::uint8_t softKeyPixels)
+	{
+		xPixels = dataMaskPixels;
+		yPixels = dataMaskPixels;
+		softKeyXAxisPixels = softKeyPixels;
+		softKeyYAxisPixels = softKeyPixels;
+	}
+
+	std::shared_ptr<const std::vector<std::uint8_t>> test_wrapper_get_scaled_pool(std::uint8_t poolIndex) const
+	{
+		return objectPools[poolIndex].scaledObjectPool;
+	}
+
+	static bool test_wrapper_process_internal_object_pool_upload_callback(std::uint32_t bytesOffset, std::uint32_t numberOfBytesNeeded, std::uint8_t *chunkBuffer, void *parentPointer)
+	{
+		return VirtualTerminalClient::process_internal_object_pool_upload_callback(0, bytesOffset, numberOfBytesNeeded, chunkBuffer, parentPointer);
+	}
+
+	void test_wrapper_clear_scaled_pools()
+	{
+		for (auto &objectPool : objectPools)
+		{
+			objectPool.scaledObjectPool.reset();
+		}
+	}
+
+	void test_wrapper_set_connected()
+	{
+		set_state(StateMachineState::Connected);
+		firstTimeInState = false;
+		lastVTStatusTimestamp_ms = SystemTiming::get_timestamp_ms();
+		lastWorkingSetMaintenanceTimestamp_ms = SystemTiming::get_timestamp_ms();
+	}
+
 	static std::vector<std::uint8_t> staticTestPool;
 
 	static bool testWrapperDataChunkCallback(std::uint32_t,
@@ -725,3 +768,1035 @@ TEST(VIRTUAL_TERMINAL_TESTS, TestNumberBytesInInvalidObjects)
 		EXPECT_EQ(0, clientUnderTest.test_wrapper_get_number_bytes_in_object(testObject));
 	}
 }
+
+TEST(VIRTUAL_TERMINAL_TESTS, ObjectPoolIndexOfExamplePools)
+{
+	const std::vector<std::string> poolFiles = { "../examples/vt_version_3_object_pool/VT3TestPool.iop", "../examples/vt_aux_n/vtpooldata.iop" };
+
+	for (const auto &poolFile : poolFiles)
+	{
+		std::vector<std::uint8_t> testPool = isobus::IOPFileInterface::read_iop_file(poolFile);
+		ASSERT_NE(0, testPool.size());
+
+		VirtualTerminalObjectPoolIndex index;
+		EXPECT_FALSE(index.get_is_valid());
+		ASSERT_TRUE(index.build(testPool.data(), static_cast<std::uint32_t>(testPool.size())));
+		EXPECT_TRUE(index.get_is_valid());
+		EXPECT_EQ(testPool.size(), index.get_pool_size());
+		ASSERT_NE(0, index.get_number_objects());
+
+		// The objects should cover the whole pool, back to back
+		std::uint32_t expectedOffset = 0;
+		for (std::size_t i = 0; i < index.get_number_objects(); i++)
+		{
+			const auto *objectAtPosition = index.get_object_at_position(i);
+			ASSERT_NE(nullptr, objectAtPosition);
+			const auto &object = *objectAtPosition;
+			EXPECT_EQ(expectedOffset, object.offset);
+			EXPECT_EQ(object.length, VirtualTerminalObjectPoolIndex::get_object_length(&testPool[object.offset], object.length));
+			expectedOffset += object.length;
+
+			VirtualTerminalObjectPoolIndex::ObjectInfo foundObject;
+			ASSERT_TRUE(index.get_object(object.objectID, foundObject));
+			EXPECT_EQ(object.offset, foundObject.offset);
+			EXPECT_EQ(object.type, foundObject.type);
+			EXPECT_EQ(&testPool[object.offset], index.get_object_data(object.objectID));
+		}
+		EXPECT_EQ(testPool.size(), expectedOffset);
+		EXPECT_EQ(0, index.get_invalid_references().size());
+
+		// Every pool has exactly one working set
+		std::size_t numberWorkingSets = 0;
+		for (std::size_t i = 0; i < index.get_number_objects(); i++)
+		{
+			if (VirtualTerminalObjectType::WorkingSet == index.get_object_at_position(i)->type)
+			{
+				numberWorkingSets++;
+			}
+		}
+		EXPECT_EQ(1, numberWorkingSets);
+		EXPECT_EQ(nullptr, index.get_object_at_position(index.get_number_objects()));
+
+		// A truncated pool can't be indexed
+		EXPECT_FALSE(index.build(testPool.data(), static_cast<std::uint32_t>(testPool.size() - 1)));
+		EXPECT_FALSE(index.get_is_valid());
+		EXPECT_EQ(0, index.get_number_objects());
+		EXPECT_EQ(nullptr, index.get_object_at_position(0));
+	}
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, ObjectPoolIndexAttributesAndReferences)
+{
+	std::vector<std::uint8_t> testPool = {
+		// Data mask 1, with children 5 and 6
+		0x01, 0x00, static_cast<std::uint8_t>(VirtualTerminalObjectType::DataMask), 0x07, 0xFF, 0xFF, 0x02, 0x00, 0x05, 0x00, 0x0A, 0x00, 0x14, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00,
+		// Object pointer 5, pointing at nothing
+		0x05, 0x00, static_cast<std::uint8_t>(VirtualTerminalObjectType::ObjectPointer), 0xFF, 0xFF,
+		// Number variable 7
+		0x07, 0x00, static_cast<std::uint8_t>(VirtualTerminalObjectType::NumberVariable), 0x78, 0x56, 0x34, 0x12
+	};
+
+	VirtualTerminalObjectPoolIndex index;
+	ASSERT_TRUE(index.build(testPool.data(), static_cast<std::uint32_t>(testPool.size())));
+	EXPECT_EQ(3, index.get_number_objects());
+	EXPECT_TRUE(index.get_object_exists(5));
+	EXPECT_FALSE(index.get_object_exists(6));
+	EXPECT_EQ(nullptr, index.get_object_data(6));
+
+	VirtualTerminalObjectPoolIndex::ObjectInfo object;
+	ASSERT_TRUE(index.get_object(7, object));
+	EXPECT_EQ(25, object.offset);
+	EXPECT_EQ(7, object.length);
+	EXPECT_EQ(VirtualTerminalObjectType::NumberVariable, object.type);
+
+	std::uint8_t byteValue = 0;
+	std::uint16_t wordValue = 0;
+	std::uint32_t longValue = 0;
+	EXPECT_TRUE(index.get_uint8_attribute(1, 3, byteValue));
+	EXPECT_EQ(0x07, byteValue);
+	EXPECT_TRUE(index.get_uint16_attribute(1, 10, wordValue));
+	EXPECT_EQ(10, wordValue);
+	EXPECT_TRUE(index.get_uint32_attribute(7, 3, longValue));
+	EXPECT_EQ(0x12345678u, longValue);
+
+	// Attributes past the end of the object aren't read from its neighbour
+	EXPECT_FALSE(index.get_uint32_attribute(7, 4, longValue));
+	EXPECT_FALSE(index.get_uint16_attribute(5, 4, wordValue));
+	EXPECT_FALSE(index.get_uint8_attribute(5, 5, byteValue));
+	EXPECT_FALSE(index.get_uint8_attribute(6, 0, byteValue));
+
+	std::vector<std::uint16_t> references;
+	EXPECT_TRUE(index.get_referenced_object_ids(1, references));
+	ASSERT_EQ(3, references.size());
+	EXPECT_EQ(0xFFFF, references[0]);
+	EXPECT_EQ(5, references[1]);
+	EXPECT_EQ(6, references[2]);
+
+	auto invalidReferences = index.get_invalid_references();
+	ASSERT_EQ(1, invalidReferences.size());
+	EXPECT_EQ(1, invalidReferences[0].objectID);
+	EXPECT_EQ(6, invalidReferences[0].referencedObjectID);
+
+	// Duplicate object IDs make the pool invalid
+	testPool[25] = 0x05;
+	EXPECT_FALSE(index.build(testPool.data(), static_cast<std::uint32_t>(testPool.size())));
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, ObjectPoolIndexFromClient)
+{
+	DerivedTestVTClient clientUnderTest(nullptr, nullptr);
+	EXPECT_EQ(nullptr, clientUnderTest.get_object_pool_index(0));
+
+	std::vector<std::uint8_t> testPool = isobus::IOPFileInterface::read_iop_file("../examples/vt_version_3_object_pool/VT3TestPool.iop");
+	ASSERT_NE(0, testPool.size());
+
+	clientUnderTest.set_object_pool(0, VirtualTerminalClient::VTVersion::Version3, &testPool);
+	const VirtualTerminalObjectPoolIndex *index = clientUnderTest.get_object_pool_index(0);
+	ASSERT_NE(nullptr, index);
+	EXPECT_EQ(testPool.size(), index->get_pool_size());
+	EXPECT_EQ(nullptr, clientUnderTest.get_object_pool_index(1));
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, ScaledPoolCacheReuse)
+{
+	std::vector<std::uint8_t> testPool = isobus::IOPFileInterface::read_iop_file("../examples/vt_version_3_object_pool/VT3TestPool.iop");
+	ASSERT_NE(0, testPool.size());
+
+	DerivedTestVTClient clientUnderTest(nullptr, nullptr);
+	clientUnderTest.test_wrapper_set_vt_geometry(480, 60);
+	clientUnderTest.set_object_pool(0, VirtualTerminalClient::VTVersion::Version3, &testPool);
+	clientUnderTest.set_object_pool_scaling(0, 240, 240);
+
+	auto cache = clientUnderTest.get_scaled_object_pool_cache();
+	ASSERT_NE(nullptr, cache);
+
+	EXPECT_TRUE(clientUnderTest.test_wrapper_scale_object_pools());
+	auto firstScaledPool = clientUnderTest.test_wrapper_get_scaled_pool(0);
+	ASSERT_NE(nullptr, firstScaledPool);
+	EXPECT_EQ(testPool.size(), firstScaledPool->size());
+	EXPECT_NE(testPool, *firstScaledPool);
+	EXPECT_EQ(1, cache->get_number_entries());
+	EXPECT_EQ(0, cache->get_number_hits());
+	EXPECT_EQ(1, cache->get_number_misses());
+
+	// Reconnecting to the same VT reuses the scaled pool
+	clientUnderTest.test_wrapper_clear_scaled_pools();
+	EXPECT_TRUE(clientUnderTest.test_wrapper_scale_object_pools());
+	EXPECT_EQ(firstScaledPool, clientUnderTest.test_wrapper_get_scaled_pool(0));
+	EXPECT_EQ(1, cache->get_number_hits());
+
+	// A VT with a different geometry gets its own scaled pool
+	clientUnderTest.test_wrapper_set_vt_geometry(200, 60);
+	EXPECT_TRUE(clientUnderTest.test_wrapper_scale_object_pools());
+	EXPECT_NE(*firstScaledPool, *clientUnderTest.test_wrapper_get_scaled_pool(0));
+	EXPECT_EQ(2, cache->get_number_entries());
+
+	// Scaling without a cache, and scaling a pool that comes from a callback, give the same result
+	DerivedTestVTClient uncachedClient(nullptr, nullptr);
+	uncachedClient.set_scaled_object_pool_cache(nullptr);
+	uncachedClient.test_wrapper_set_vt_geometry(480, 60);
+	DerivedTestVTClient::staticTestPool = testPool;
+	uncachedClient.register_object_pool_data_chunk_callback(0, VirtualTerminalClient::VTVersion::Version3, static_cast<std::uint32_t>(testPool.size()), DerivedTestVTClient::testWrapperDataChunkCallback);
+	uncachedClient.set_object_pool_scaling(0, 240, 240);
+	EXPECT_TRUE(uncachedClient.test_wrapper_scale_object_pools());
+	ASSERT_NE(nullptr, uncachedClient.test_wrapper_get_scaled_pool(0));
+	EXPECT_EQ(*firstScaledPool, *uncachedClient.test_wrapper_get_scaled_pool(0));
+	EXPECT_EQ(nullptr, uncachedClient.get_object_pool_index(0));
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, ScaledPoolCacheParallelPools)
+{
+	std::vector<std::uint8_t> firstPool = isobus::IOPFileInterface::read_iop_file("../examples/vt_version_3_object_pool/VT3TestPool.iop");
+	std::vector<std::uint8_t> secondPool = isobus::IOPFileInterface::read_iop_file("../examples/vt_aux_n/vtpooldata.iop");
+	ASSERT_NE(0, firstPool.size());
+	ASSERT_NE(0, secondPool.size());
+
+	DerivedTestVTClient clientUnderTest(nullptr, nullptr);
+	clientUnderTest.test_wrapper_set_vt_geometry(480, 60);
+	clientUnderTest.set_object_pool(0, VirtualTerminalClient::VTVersion::Version3, &firstPool);
+	clientUnderTest.set_object_pool(1, VirtualTerminalClient::VTVersion::Version3, &secondPool);
+	clientUnderTest.set_object_pool_scaling(0, 240, 240);
+	clientUnderTest.set_object_pool_scaling(1, 240, 240);
+	EXPECT_TRUE(clientUnderTest.test_wrapper_scale_object_pools());
+
+	// Each pool should match what scaling it on its own gives
+	for (std::uint8_t i = 0; i < 2; i++)
+	{
+		DerivedTestVTClient singlePoolClient(nullptr, nullptr);
+		singlePoolClient.test_wrapper_set_vt_geometry(480, 60);
+		singlePoolClient.set_object_pool(0, VirtualTerminalClient::VTVersion::Version3, (0 == i) ? &firstPool : &secondPool);
+		singlePoolClient.set_object_pool_scaling(0, 240, 240);
+		EXPECT_TRUE(singlePoolClient.test_wrapper_scale_object_pools());
+
+		ASSERT_NE(nullptr, clientUnderTest.test_wrapper_get_scaled_pool(i));
+		EXPECT_EQ(*singlePoolClient.test_wrapper_get_scaled_pool(0), *clientUnderTest.test_wrapper_get_scaled_pool(i));
+	}
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, ScaledPoolCacheDirectory)
+{
+	std::vector<std::uint8_t> testPool = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	auto scaledPool = std::make_shared<const std::vector<std::uint8_t>>(std::vector<std::uint8_t>{ 8, 7, 6, 5, 4, 3, 2, 1 });
+
+	VirtualTerminalScaledPoolCache::Key key;
+	key.poolHash = VirtualTerminalScaledPoolCache::hash_pool(testPool.data(), static_cast<std::uint32_t>(testPool.size()));
+	key.poolSize = static_cast<std::uint32_t>(testPool.size());
+	key.originalDataMaskDimension = 240;
+	key.originalSoftKeyDesignatorHeight = 60;
+	key.dataMaskDimension = 480;
+	key.softKeyDesignatorWidth = 80;
+	key.smallFontSizes = 0xFF;
+	key.largeFontSizes = 0x01;
+
+	VirtualTerminalScaledPoolCache firstCache;
+	firstCache.set_directory(".");
+	EXPECT_EQ(".", firstCache.get_directory());
+	std::remove(firstCache.get_filename(key).c_str());
+	EXPECT_EQ(nullptr, firstCache.find(key));
+	firstCache.insert(key, scaledPool);
+	EXPECT_EQ(scaledPool, firstCache.find(key));
+
+	// A new cache using the same directory finds the pool on disk
+	VirtualTerminalScaledPoolCache secondCache;
+	secondCache.set_directory(".");
+	auto loadedPool = secondCache.find(key);
+	ASSERT_NE(nullptr, loadedPool);
+	EXPECT_EQ(*scaledPool, *loadedPool);
+	EXPECT_EQ(1, secondCache.get_number_entries());
+
+	// A different geometry is a different entry
+	auto otherKey = key;
+	otherKey.dataMaskDimension = 200;
+	EXPECT_EQ(nullptr, secondCache.find(otherKey));
+
+	// Only one entry is kept in memory when the cache is limited to one
+	VirtualTerminalScaledPoolCache smallCache(1);
+	smallCache.insert(key, scaledPool);
+	smallCache.insert(otherKey, scaledPool);
+	EXPECT_EQ(1, smallCache.get_number_entries());
+	EXPECT_EQ(nullptr, smallCache.find(key));
+	EXPECT_EQ(scaledPool, smallCache.find(otherKey));
+
+	// Corrupting the file makes it a miss rather than returning bad data
+	const std::string filename = secondCache.get_filename(key);
+	ASSERT_FALSE(filename.empty());
+	{
+		std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
+		ASSERT_TRUE(file.is_open());
+		file.seekp(-1, std::ios::end);
+		file.put(0x55);
+	}
+	VirtualTerminalScaledPoolCache thirdCache;
+	thirdCache.set_directory(".");
+	EXPECT_EQ(nullptr, thirdCache.find(key));
+	EXPECT_EQ(1, thirdCache.get_number_misses());
+
+	std::remove(filename.c_str());
+}
+
+/// @brief A data source that isn't contiguous in memory, which can't be used as an object pool
+class ChunkedTestDataSource : public TransmitDataSource
+{
+public:
+	std::uint32_t get_size() const override
+	{
+		return 100;
+	}
+
+	bool read(std::uint32_t, std::uint32_t length, std::uint8_t *destination) override
+	{
+		memset(destination, 0, length);
+		return true;
+	}
+};
+
+TEST(VIRTUAL_TERMINAL_TESTS, ObjectPoolFromMemoryMappedFile)
+{
+	const std::string poolFile = "../examples/vt_version_3_object_pool/VT3TestPool.iop";
+	std::vector<std::uint8_t> testPool = isobus::IOPFileInterface::read_iop_file(poolFile);
+	ASSERT_NE(0, testPool.size());
+
+	DerivedTestVTClient clientUnderTest(nullptr, nullptr);
+	EXPECT_FALSE(clientUnderTest.set_object_pool(0, VirtualTerminalClient::VTVersion::Version3, std::shared_ptr<TransmitDataSource>(nullptr)));
+	EXPECT_FALSE(clientUnderTest.set_object_pool(0, VirtualTerminalClient::VTVersion::Version3, std::make_shared<ChunkedTestDataSource>()));
+	EXPECT_EQ(nullptr, clientUnderTest.get_object_pool_index(0));
+
+	if (!MemoryMappedFile::get_is_supported())
+	{
+		return;
+	}
+
+	auto mappedPool = std::make_shared<MemoryMappedFileDataSource>(poolFile);
+	ASSERT_TRUE(mappedPool->get_is_valid());
+	ASSERT_EQ(testPool.size(), mappedPool->get_size());
+
+	// The version label is the same whether the pool is hashed from the heap or from the mapping
+	EXPECT_EQ(isobus::IOPFileInterface::hash_object_pool_to_version(testPool),
+	          isobus::IOPFileInterface::hash_object_pool_to_version(mappedPool->get_data(), mappedPool->get_size()));
+
+	EXPECT_TRUE(clientUnderTest.set_object_pool(0, VirtualTerminalClient::VTVersion::Version3, mappedPool));
+
+	// The index and the upload both read straight from the mapping
+	const VirtualTerminalObjectPoolIndex *index = clientUnderTest.get_object_pool_index(0);
+	ASSERT_NE(nullptr, index);
+	const auto *firstObject = index->get_object_at_position(0);
+	ASSERT_NE(nullptr, firstObject);
+	EXPECT_EQ(mappedPool->get_data(), index->get_object_data(firstObject->objectID));
+
+	std::uint8_t chunk[8] = { 0 };
+	EXPECT_TRUE(DerivedTestVTClient::test_wrapper_process_internal_object_pool_upload_callback(0, 8, chunk, &clientUnderTest));
+	EXPECT_EQ(0x11, chunk[0]);
+	EXPECT_EQ(0, memcmp(&chunk[1], testPool.data(), 7));
+	EXPECT_TRUE(DerivedTestVTClient::test_wrapper_process_internal_object_pool_upload_callback(8, 8, chunk, &clientUnderTest));
+	EXPECT_EQ(0, memcmp(chunk, &testPool[7], 8));
+
+	// Scaling a mapped pool gives the same result as scaling it from the heap
+	DerivedTestVTClient vectorClient(nullptr, nullptr);
+	vectorClient.test_wrapper_set_vt_geometry(480, 60);
+	vectorClient.set_object_pool(0, VirtualTerminalClient::VTVersion::Version3, &testPool);
+	vectorClient.set_object_pool_scaling(0, 240, 240);
+	EXPECT_TRUE(vectorClient.test_wrapper_scale_object_pools());
+
+	clientUnderTest.test_wrapper_set_vt_geometry(480, 60);
+	clientUnderTest.set_object_pool_scaling(0, 240, 240);
+	EXPECT_TRUE(clientUnderTest.test_wrapper_scale_object_pools());
+	ASSERT_NE(nullptr, clientUnderTest.test_wrapper_get_scaled_pool(0));
+	EXPECT_EQ(*vectorClient.test_wrapper_get_scaled_pool(0), *clientUnderTest.test_wrapper_get_scaled_pool(0));
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, CommandCoalescerKeepsLatestValues)
+{
+	VirtualTerminalCommandCoalescer coalescer;
+	std::vector<std::vector<std::uint8_t>> sentCommands;
+	auto sendFunction = [&sentCommands](const std::uint8_t *data, std::uint32_t length) {
+		sentCommands.emplace_back(data, data + length);
+		return true;
+	};
+
+	const std::uint8_t numericValue1[] = { 0xA8, 0x10, 0x00, 0xFF, 1, 0, 0, 0 };
+	const std::uint8_t numericValue2[] = { 0xA8, 0x10, 0x00, 0xFF, 2, 0, 0, 0 };
+	const std::uint8_t otherObjectValue[] = { 0xA8, 0x11, 0x00, 0xFF, 3, 0, 0, 0 };
+	const std::uint8_t attribute1[] = { 0xAF, 0x10, 0x00, 0x01, 4, 0, 0, 0 };
+	const std::uint8_t attribute2[] = { 0xAF, 0x10, 0x00, 0x02, 5, 0, 0, 0 };
+	const std::uint8_t stringValue1[] = { 0xB3, 0x12, 0x00, 0x02, 0x00, 'h', 'i' };
+	const std::uint8_t stringValue2[] = { 0xB3, 0x12, 0x00, 0x03, 0x00, 'b', 'y', 'e' };
+	const std::uint8_t hideShow[] = { 0xA0, 0x10, 0x00, 0x01, 0xFF, 0xFF, 0xFF, 0xFF };
+
+	EXPECT_FALSE(coalescer.add(hideShow, sizeof(hideShow)));
+	EXPECT_FALSE(coalescer.add(nullptr, 8));
+
+	EXPECT_TRUE(coalescer.add(numericValue1, sizeof(numericValue1)));
+	EXPECT_TRUE(coalescer.add(otherObjectValue, sizeof(otherObjectValue)));
+	EXPECT_TRUE(coalescer.add(attribute1, sizeof(attribute1)));
+	EXPECT_TRUE(coalescer.add(attribute2, sizeof(attribute2)));
+	EXPECT_TRUE(coalescer.add(stringValue1, sizeof(stringValue1)));
+	EXPECT_TRUE(coalescer.add(numericValue2, sizeof(numericValue2)));
+	EXPECT_TRUE(coalescer.add(stringValue2, sizeof(stringValue2)));
+	EXPECT_EQ(5, coalescer.get_number_pending());
+	EXPECT_EQ(2, coalescer.get_number_coalesced());
+
+	// The replaced values keep the position of the first command for their object
+	EXPECT_EQ(5, coalescer.flush(sendFunction));
+	ASSERT_EQ(5, sentCommands.size());
+	EXPECT_EQ(std::vector<std::uint8_t>(numericValue2, numericValue2 + sizeof(numericValue2)), sentCommands[0]);
+	EXPECT_EQ(std::vector<std::uint8_t>(otherObjectValue, otherObjectValue + sizeof(otherObjectValue)), sentCommands[1]);
+	EXPECT_EQ(std::vector<std::uint8_t>(attribute1, attribute1 + sizeof(attribute1)), sentCommands[2]);
+	EXPECT_EQ(std::vector<std::uint8_t>(attribute2, attribute2 + sizeof(attribute2)), sentCommands[3]);
+	EXPECT_EQ(std::vector<std::uint8_t>(stringValue2, stringValue2 + sizeof(stringValue2)), sentCommands[4]);
+	EXPECT_EQ(0, coalescer.get_number_pending());
+	EXPECT_EQ(5, coalescer.get_number_awaiting_response());
+
+	// Only responses for the flushed commands count
+	const std::uint8_t numericResponse[] = { 0xA8, 0x10, 0x00, 0x00, 2, 0, 0, 0 };
+	const std::uint8_t unrelatedNumericResponse[] = { 0xA8, 0x20, 0x00, 0x00, 2, 0, 0, 0 };
+	const std::uint8_t unrelatedAttributeResponse[] = { 0xAF, 0x10, 0x00, 0x03, 0x00, 0xFF, 0xFF, 0xFF };
+	const std::uint8_t attributeResponse[] = { 0xAF, 0x10, 0x00, 0x02, 0x00, 0xFF, 0xFF, 0xFF };
+	const std::uint8_t stringResponse[] = { 0xB3, 0xFF, 0xFF, 0x12, 0x00, 0x00, 0xFF, 0xFF };
+	const std::uint8_t hideShowResponse[] = { 0xA0, 0x10, 0x00, 0x01, 0x00, 0xFF, 0xFF, 0xFF };
+	coalescer.process_response(hideShowResponse, sizeof(hideShowResponse));
+	coalescer.process_response(unrelatedNumericResponse, sizeof(unrelatedNumericResponse));
+	coalescer.process_response(unrelatedAttributeResponse, sizeof(unrelatedAttributeResponse));
+	coalescer.process_response(nullptr, 8);
+	coalescer.process_response(numericResponse, 3);
+	EXPECT_EQ(5, coalescer.get_number_awaiting_response());
+	coalescer.process_response(numericResponse, sizeof(numericResponse));
+	coalescer.process_response(attributeResponse, sizeof(attributeResponse));
+	coalescer.process_response(stringResponse, sizeof(stringResponse));
+	EXPECT_EQ(2, coalescer.get_number_awaiting_response());
+
+	// A second response for the same command doesn't count twice
+	coalescer.process_response(numericResponse, sizeof(numericResponse));
+	EXPECT_EQ(2, coalescer.get_number_awaiting_response());
+	coalescer.clear_awaiting_response();
+	EXPECT_EQ(0, coalescer.get_number_awaiting_response());
+	coalescer.process_response(attributeResponse, sizeof(attributeResponse));
+	EXPECT_EQ(0, coalescer.get_number_awaiting_response());
+
+	// A command that can't be sent stays queued, along with everything after it
+	std::uint32_t sendsAllowed = 1;
+	auto limitedSendFunction = [&sendsAllowed](const std::uint8_t *, std::uint32_t) {
+		bool retVal = (0 != sendsAllowed);
+		if (retVal)
+		{
+			sendsAllowed--;
+		}
+		return retVal;
+	};
+	EXPECT_TRUE(coalescer.add(numericValue1, sizeof(numericValue1)));
+	EXPECT_TRUE(coalescer.add(otherObjectValue, sizeof(otherObjectValue)));
+	EXPECT_EQ(1, coalescer.flush(limitedSendFunction));
+	EXPECT_EQ(1, coalescer.get_number_pending());
+	EXPECT_EQ(0, coalescer.flush(limitedSendFunction));
+
+	coalescer.clear();
+	EXPECT_EQ(0, coalescer.get_number_pending());
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, CommandCoalescingInClient)
+{
+	DerivedTestVTClient clientUnderTest(nullptr, nullptr);
+	EXPECT_FALSE(clientUnderTest.get_command_coalescing_enabled());
+
+	clientUnderTest.set_command_coalescing(true);
+	EXPECT_TRUE(clientUnderTest.get_command_coalescing_enabled());
+
+	// Coalesced commands are queued, even though there's no VT to send them to yet
+	for (std::uint32_t i = 0; i < 100; i++)
+	{
+		EXPECT_TRUE(clientUnderTest.send_change_numeric_value(1000, i));
+		EXPECT_TRUE(clientUnderTest.send_change_attribute(1001, 3, i));
+		EXPECT_TRUE(clientUnderTest.send_change_string_value(1002, std::to_string(i)));
+	}
+	EXPECT_EQ(3, clientUnderTest.get_number_queued_commands());
+	EXPECT_EQ(297, clientUnderTest.get_number_coalesced_commands());
+
+	// Other commands are still sent right away, which fails without a partner
+	EXPECT_FALSE(clientUnderTest.send_hide_show_object(1000, VirtualTerminalClient::HideShowObjectCommand::HideObject));
+	EXPECT_EQ(3, clientUnderTest.get_number_queued_commands());
+
+	clientUnderTest.set_command_coalescing(false);
+	EXPECT_FALSE(clientUnderTest.send_change_numeric_value(1000, 0));
+	EXPECT_EQ(3, clientUnderTest.get_number_queued_commands());
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, ShadowStateSeededFromPool)
+{
+	std::vector<std::uint8_t> testPool = isobus::IOPFileInterface::read_iop_file("../examples/vt_version_3_object_pool/VT3TestPool.iop");
+	ASSERT_NE(0, testPool.size());
+
+	VirtualTerminalObjectPoolIndex index;
+	ASSERT_TRUE(index.build(testPool.data(), static_cast<std::uint32_t>(testPool.size())));
+
+	VirtualTerminalShadowState shadowState;
+	shadowState.seed(index);
+
+	// Every numeric and string value object in the pool should have been seeded
+	std::size_t numberNumericObjects = 0;
+	std::size_t numberStringObjects = 0;
+	for (std::size_t i = 0; i < index.get_number_objects(); i++)
+	{
+		const auto *infoAtPosition = index.get_object_at_position(i);
+		ASSERT_NE(nullptr, infoAtPosition);
+		const auto &info = *infoAtPosition;
+		std::uint32_t value = 0;
+		std::string stringValue;
+
+		switch (info.type)
+		{
+			case VirtualTerminalObjectType::OutputNumber:
+			case VirtualTerminalObjectType::InputNumber:
+			case VirtualTerminalObjectType::NumberVariable:
+			{
+				std::uint32_t expectedValue = 0;
+				EXPECT_TRUE(index.get_uint32_attribute(info.objectID, (VirtualTerminalObjectType::NumberVariable == info.type) ? 3 : 13, expectedValue));
+				EXPECT_TRUE(shadowState.get_numeric_value(info.objectID, value));
+				EXPECT_EQ(expectedValue, value);
+				numberNumericObjects++;
+			}
+			break;
+
+			case VirtualTerminalObjectType::OutputString:
+			case VirtualTerminalObjectType::InputString:
+			case VirtualTerminalObjectType::StringVariable:
+			{
+				EXPECT_TRUE(shadowState.get_string_value(info.objectID, stringValue));
+				numberStringObjects++;
+			}
+			break;
+
+			case VirtualTerminalObjectType::DataMask:
+			{
+				EXPECT_FALSE(shadowState.get_numeric_value(info.objectID, value));
+				EXPECT_FALSE(shadowState.get_string_value(info.objectID, stringValue));
+			}
+			break;
+
+			default:
+			{
+			}
+			break;
+		}
+	}
+	EXPECT_NE(0, numberNumericObjects);
+	EXPECT_NE(0, numberStringObjects);
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, ShadowStateTracksCommandsAndResponses)
+{
+	VirtualTerminalShadowState shadowState;
+
+	const std::uint8_t numericValue[] = { 0xA8, 0x10, 0x00, 0xFF, 42, 0, 0, 0 };
+	const std::uint8_t otherNumericValue[] = { 0xA8, 0x10, 0x00, 0xFF, 43, 0, 0, 0 };
+	const std::uint8_t numericSuccess[] = { 0xA8, 0x10, 0x00, 0x00, 43, 0, 0, 0 };
+	const std::uint8_t numericFailure[] = { 0xA8, 0x10, 0x00, 0x01, 43, 0, 0, 0 };
+	const std::uint8_t attribute[] = { 0xAF, 0x10, 0x00, 0x04, 7, 0, 0, 0 };
+	const std::uint8_t attributeSuccess[] = { 0xAF, 0x10, 0x00, 0x04, 0x00, 0xFF, 0xFF, 0xFF };
+	const std::uint8_t stringValue[] = { 0xB3, 0x12, 0x00, 0x02, 0x00, 'h', 'i' };
+	const std::uint8_t stringSuccess[] = { 0xB3, 0xFF, 0xFF, 0x12, 0x00, 0x00, 0xFF, 0xFF };
+	const std::uint8_t hideShow[] = { 0xA0, 0x10, 0x00, 0x01, 0xFF, 0xFF, 0xFF, 0xFF };
+	std::uint32_t value = 0;
+	std::string text;
+
+	// Nothing is known yet, so nothing is redundant
+	EXPECT_FALSE(shadowState.get_is_redundant(numericValue, sizeof(numericValue)));
+	EXPECT_FALSE(shadowState.get_is_redundant(hideShow, sizeof(hideShow)));
+
+	// A command that's in flight makes repeating it redundant, but not changing it
+	shadowState.process_sent_command(numericValue, sizeof(numericValue));
+	EXPECT_TRUE(shadowState.get_is_redundant(numericValue, sizeof(numericValue)));
+	EXPECT_FALSE(shadowState.get_is_redundant(otherNumericValue, sizeof(otherNumericValue)));
+	EXPECT_FALSE(shadowState.get_numeric_value(0x10, value));
+
+	shadowState.process_sent_command(otherNumericValue, sizeof(otherNumericValue));
+	shadowState.process_response(numericSuccess, sizeof(numericSuccess));
+	EXPECT_TRUE(shadowState.get_numeric_value(0x10, value));
+	EXPECT_EQ(43, value);
+	EXPECT_TRUE(shadowState.get_is_redundant(otherNumericValue, sizeof(otherNumericValue)));
+	EXPECT_FALSE(shadowState.get_is_redundant(numericValue, sizeof(numericValue)));
+
+	// A failed command forgets the value
+	shadowState.process_response(numericFailure, sizeof(numericFailure));
+	EXPECT_FALSE(shadowState.get_numeric_value(0x10, value));
+	EXPECT_FALSE(shadowState.get_is_redundant(otherNumericValue, sizeof(otherNumericValue)));
+
+	// The operator changing a value on the VT is tracked too
+	shadowState.process_vt_numeric_value_change(0x10, 42);
+	EXPECT_TRUE(shadowState.get_is_redundant(numericValue, sizeof(numericValue)));
+
+	shadowState.process_sent_command(attribute, sizeof(attribute));
+	shadowState.process_response(attributeSuccess, sizeof(attributeSuccess));
+	EXPECT_TRUE(shadowState.get_attribute_value(0x10, 4, value));
+	EXPECT_EQ(7, value);
+	EXPECT_TRUE(shadowState.get_is_redundant(attribute, sizeof(attribute)));
+
+	shadowState.process_sent_command(stringValue, sizeof(stringValue));
+	shadowState.process_response(stringSuccess, sizeof(stringSuccess));
+	EXPECT_TRUE(shadowState.get_string_value(0x12, text));
+	EXPECT_EQ("hi", text);
+	EXPECT_TRUE(shadowState.get_is_redundant(stringValue, sizeof(stringValue)));
+
+	// Invalidating an object forgets its value and all its attributes, but not other objects
+	shadowState.invalidate(0x10);
+	EXPECT_FALSE(shadowState.get_is_redundant(numericValue, sizeof(numericValue)));
+	EXPECT_FALSE(shadowState.get_is_redundant(attribute, sizeof(attribute)));
+	EXPECT_TRUE(shadowState.get_is_redundant(stringValue, sizeof(stringValue)));
+
+	shadowState.clear();
+	EXPECT_FALSE(shadowState.get_is_redundant(stringValue, sizeof(stringValue)));
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, ShadowStateForgetsUnansweredCommands)
+{
+	VirtualTerminalShadowState shadowState;
+
+	const std::uint8_t numericValue[] = { 0xA8, 0x10, 0x00, 0xFF, 42, 0, 0, 0 };
+	const std::uint8_t otherNumericValue[] = { 0xA8, 0x10, 0x00, 0xFF, 43, 0, 0, 0 };
+	const std::uint8_t stringValue[] = { 0xB3, 0x12, 0x00, 0x02, 0x00, 'h', 'i' };
+	const std::uint8_t hideShow[] = { 0xA0, 0x10, 0x00, 0x01, 0xFF, 0xFF, 0xFF, 0xFF };
+
+	EXPECT_TRUE(VirtualTerminalShadowState::get_is_tracked(numericValue, sizeof(numericValue)));
+	EXPECT_TRUE(VirtualTerminalShadowState::get_is_tracked(stringValue, sizeof(stringValue)));
+	EXPECT_FALSE(VirtualTerminalShadowState::get_is_tracked(hideShow, sizeof(hideShow)));
+
+	// A command the VT never answers stops being trusted once the response timeout passes
+	shadowState.process_sent_command(numericValue, sizeof(numericValue));
+	shadowState.process_sent_command(stringValue, sizeof(stringValue));
+	EXPECT_TRUE(shadowState.get_is_redundant(numericValue, sizeof(numericValue)));
+	EXPECT_TRUE(shadowState.get_is_redundant(stringValue, sizeof(stringValue)));
+	shadowState.set_response_timeout(0);
+	EXPECT_FALSE(shadowState.get_is_redundant(numericValue, sizeof(numericValue)));
+	EXPECT_FALSE(shadowState.get_is_redundant(stringValue, sizeof(stringValue)));
+
+	// A command that failed in the pipeline is forgotten right away, but only if it's still the latest value sent
+	shadowState.set_response_timeout(VirtualTerminalShadowState::DEFAULT_RESPONSE_TIMEOUT_MS);
+	shadowState.process_sent_command(numericValue, sizeof(numericValue));
+	shadowState.process_failed_command(otherNumericValue, sizeof(otherNumericValue));
+	EXPECT_TRUE(shadowState.get_is_redundant(numericValue, sizeof(numericValue)));
+	shadowState.process_failed_command(numericValue, sizeof(numericValue));
+	EXPECT_FALSE(shadowState.get_is_redundant(numericValue, sizeof(numericValue)));
+
+	shadowState.process_sent_command(stringValue, sizeof(stringValue));
+	EXPECT_TRUE(shadowState.get_is_redundant(stringValue, sizeof(stringValue)));
+	shadowState.process_failed_command(stringValue, sizeof(stringValue));
+	EXPECT_FALSE(shadowState.get_is_redundant(stringValue, sizeof(stringValue)));
+
+	// The VT may have applied a command it didn't answer, so the confirmed value is forgotten too
+	shadowState.process_vt_numeric_value_change(0x10, 43);
+	EXPECT_TRUE(shadowState.get_is_redundant(otherNumericValue, sizeof(otherNumericValue)));
+	shadowState.process_sent_command(numericValue, sizeof(numericValue));
+	shadowState.process_failed_command(numericValue, sizeof(numericValue));
+	EXPECT_FALSE(shadowState.get_is_redundant(otherNumericValue, sizeof(otherNumericValue)));
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, ShadowStateRepeatsUnansweredCommandsInClient)
+{
+	DerivedTestVTClient clientUnderTest(nullptr, nullptr);
+	clientUnderTest.set_command_pipeline_enabled(true);
+	clientUnderTest.set_shadow_state_enabled(true);
+
+	// With no VT to answer, a repeat is skipped while the first command is still waiting for its response
+	EXPECT_TRUE(clientUnderTest.send_change_numeric_value(1000, 42));
+	EXPECT_TRUE(clientUnderTest.send_change_numeric_value(1000, 42));
+	EXPECT_EQ(1, clientUnderTest.get_number_suppressed_commands());
+	EXPECT_EQ(1, clientUnderTest.get_command_pipeline().get_statistics().numberQueued);
+
+	// Once the command is aborted, the repeat is sent
+	clientUnderTest.get_command_pipeline().abort_all();
+	EXPECT_TRUE(clientUnderTest.send_change_numeric_value(1000, 42));
+	EXPECT_EQ(1, clientUnderTest.get_number_suppressed_commands());
+	EXPECT_EQ(1, clientUnderTest.get_command_pipeline().get_statistics().numberQueued);
+
+	// Once the VT has had its time to answer, the repeat is sent
+	clientUnderTest.set_shadow_state_response_timeout(0);
+	EXPECT_TRUE(clientUnderTest.send_change_numeric_value(1000, 42));
+	EXPECT_EQ(1, clientUnderTest.get_number_suppressed_commands());
+	EXPECT_EQ(2, clientUnderTest.get_command_pipeline().get_statistics().numberQueued);
+
+	clientUnderTest.get_command_pipeline().abort_all();
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, ShadowStateInClient)
+{
+	DerivedTestVTClient clientUnderTest(nullptr, nullptr);
+	EXPECT_FALSE(clientUnderTest.get_shadow_state_enabled());
+
+	// Queue commands so they count as sent without a VT to send them to
+	clientUnderTest.set_command_coalescing(true);
+	clientUnderTest.set_shadow_state_enabled(true);
+	EXPECT_TRUE(clientUnderTest.get_shadow_state_enabled());
+
+	for (std::uint32_t i = 0; i < 20; i++)
+	{
+		EXPECT_TRUE(clientUnderTest.send_change_numeric_value(1000, 5));
+	}
+	EXPECT_EQ(19, clientUnderTest.get_number_suppressed_commands());
+	EXPECT_EQ(0, clientUnderTest.get_number_coalesced_commands());
+
+	// Invalidating the object bypasses the shadow state for the next command
+	clientUnderTest.invalidate_shadow_state(1000);
+	EXPECT_TRUE(clientUnderTest.send_change_numeric_value(1000, 5));
+	EXPECT_EQ(19, clientUnderTest.get_number_suppressed_commands());
+	EXPECT_EQ(1, clientUnderTest.get_number_coalesced_commands());
+
+	// Reloading the object pool forgets everything
+	std::vector<std::uint8_t> testPool = isobus::IOPFileInterface::read_iop_file("../examples/vt_version_3_object_pool/VT3TestPool.iop");
+	clientUnderTest.set_object_pool(0, VirtualTerminalClient::VTVersion::Version3, &testPool);
+	EXPECT_TRUE(clientUnderTest.send_change_numeric_value(1000, 5));
+	EXPECT_EQ(19, clientUnderTest.get_number_suppressed_commands());
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, CommandPipelineWindowAndPriorities)
+{
+	VirtualTerminalCommandPipeline pipeline(2);
+	std::vector<std::uint8_t> sentFunctionCodes;
+	std::vector<VirtualTerminalCommandPipeline::Result> results;
+	std::vector<std::uint8_t> errorCodes;
+
+	auto sender = [&sentFunctionCodes](const std::uint8_t *data, std::uint32_t) {
+		sentFunctionCodes.push_back(data[0]);
+		return true;
+	};
+	auto callback = [&results, &errorCodes](VirtualTerminalCommandPipeline::Result result, std::uint8_t errorCode) {
+		results.push_back(result);
+		errorCodes.push_back(errorCode);
+	};
+
+	const std::uint8_t changeNumericValue[8] = { 0xA8, 0xE8, 0x03, 0xFF, 0x05, 0x00, 0x00, 0x00 };
+	const std::uint8_t hideShow[8] = { 0xA0, 0xE9, 0x03, 0x01, 0xFF, 0xFF, 0xFF, 0xFF };
+	const std::uint8_t changeActiveMask[8] = { 0xAD, 0x00, 0x00, 0xE8, 0x03, 0xFF, 0xFF, 0xFF };
+	const std::uint8_t selectActiveWorkingSet[8] = { 0x90, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 };
+
+	EXPECT_EQ(VirtualTerminalCommandPipeline::Priority::Low, VirtualTerminalCommandPipeline::get_default_priority(0xA8));
+	EXPECT_EQ(VirtualTerminalCommandPipeline::Priority::Normal, VirtualTerminalCommandPipeline::get_default_priority(0xA0));
+	EXPECT_EQ(VirtualTerminalCommandPipeline::Priority::High, VirtualTerminalCommandPipeline::get_default_priority(0xAD));
+
+	// The VT doesn't respond to this command with an error code, so it can't be tracked
+	EXPECT_FALSE(VirtualTerminalCommandPipeline::get_is_managed(selectActiveWorkingSet, 8));
+	EXPECT_FALSE(pipeline.add(selectActiveWorkingSet, 8, VirtualTerminalCommandPipeline::Priority::Normal, callback));
+
+	EXPECT_TRUE(pipeline.add(changeNumericValue, 8, VirtualTerminalCommandPipeline::Priority::Low, callback));
+	EXPECT_TRUE(pipeline.add(hideShow, 8, VirtualTerminalCommandPipeline::Priority::Normal, callback));
+	EXPECT_TRUE(pipeline.add(changeActiveMask, 8, VirtualTerminalCommandPipeline::Priority::High, callback));
+	EXPECT_EQ(3, pipeline.get_statistics().maximumQueueDepth);
+
+	// Only two commands fit in the window, and the highest priorities go first
+	pipeline.update(sender);
+	ASSERT_EQ(2, sentFunctionCodes.size());
+	EXPECT_EQ(0xAD, sentFunctionCodes[0]);
+	EXPECT_EQ(0xA0, sentFunctionCodes[1]);
+
+	VirtualTerminalCommandPipeline::Statistics statistics = pipeline.get_statistics();
+	EXPECT_EQ(2, statistics.numberInFlight);
+	EXPECT_EQ(1, statistics.numberQueued);
+	EXPECT_EQ(1, statistics.numberWindowFull);
+
+	// A response to a command that isn't in flight is ignored
+	const std::uint8_t changeSoftKeyMaskResponse[8] = { 0xAE, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF };
+	EXPECT_FALSE(pipeline.process_response(changeSoftKeyMaskResponse, 8));
+
+	const std::uint8_t hideShowResponse[8] = { 0xA0, 0xE9, 0x03, 0x01, 0x00, 0xFF, 0xFF, 0xFF };
+	EXPECT_TRUE(pipeline.process_response(hideShowResponse, 8));
+	ASSERT_EQ(1, results.size());
+	EXPECT_EQ(VirtualTerminalCommandPipeline::Result::Success, results[0]);
+
+	// The window has room again, so the low priority command is sent
+	pipeline.update(sender);
+	ASSERT_EQ(3, sentFunctionCodes.size());
+	EXPECT_EQ(0xA8, sentFunctionCodes[2]);
+
+	const std::uint8_t changeActiveMaskResponse[8] = { 0xAD, 0xE8, 0x03, 0x01, 0xFF, 0xFF, 0xFF, 0xFF };
+	EXPECT_TRUE(pipeline.process_response(changeActiveMaskResponse, 8));
+	ASSERT_EQ(2, results.size());
+	EXPECT_EQ(VirtualTerminalCommandPipeline::Result::VTError, results[1]);
+	EXPECT_EQ(0x01, errorCodes[1]);
+
+	statistics = pipeline.get_statistics();
+	EXPECT_EQ(3, statistics.numberSent);
+	EXPECT_EQ(1, statistics.numberSucceeded);
+	EXPECT_EQ(1, statistics.numberVTErrors);
+	EXPECT_EQ(1, statistics.numberInFlight);
+	EXPECT_EQ(0, statistics.numberQueued);
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, CommandPipelineTimeoutsAndAborts)
+{
+	VirtualTerminalCommandPipeline pipeline;
+	std::vector<VirtualTerminalCommandPipeline::Result> results;
+	bool sendSucceeds = false;
+
+	auto sender = [&sendSucceeds](const std::uint8_t *, std::uint32_t) {
+		return sendSucceeds;
+	};
+	auto callback = [&results](VirtualTerminalCommandPipeline::Result result, std::uint8_t) {
+		results.push_back(result);
+	};
+
+	const std::uint8_t hideShow[8] = { 0xA0, 0xE9, 0x03, 0x01, 0xFF, 0xFF, 0xFF, 0xFF };
+	EXPECT_TRUE(pipeline.add(hideShow, 8, VirtualTerminalCommandPipeline::Priority::Normal, callback));
+	EXPECT_TRUE(pipeline.add(hideShow, 8, VirtualTerminalCommandPipeline::Priority::Normal, callback));
+
+	// Commands stay queued while the CAN stack can't take them
+	pipeline.update(sender);
+	EXPECT_EQ(2, pipeline.get_statistics().numberQueued);
+	EXPECT_EQ(1, pipeline.get_statistics().numberSendFailures);
+
+	// With no timeout, in-flight commands time out on the next update
+	sendSucceeds = true;
+	pipeline.set_response_timeout(0);
+	pipeline.set_maximum_in_flight(1);
+	EXPECT_EQ(1, pipeline.get_maximum_in_flight());
+	pipeline.update(sender);
+	EXPECT_EQ(1, pipeline.get_statistics().numberInFlight);
+	pipeline.update(sender);
+	ASSERT_EQ(1, results.size());
+	EXPECT_EQ(VirtualTerminalCommandPipeline::Result::Timeout, results[0]);
+	EXPECT_EQ(1, pipeline.get_statistics().numberTimedOut);
+
+	// A full lane rejects new commands
+	pipeline.set_maximum_queue_size(1);
+	EXPECT_TRUE(pipeline.add(hideShow, 8, VirtualTerminalCommandPipeline::Priority::Low, callback));
+	EXPECT_FALSE(pipeline.add(hideShow, 8, VirtualTerminalCommandPipeline::Priority::Low, callback));
+	EXPECT_EQ(1, pipeline.get_statistics().numberRejected);
+
+	pipeline.abort_all();
+	ASSERT_EQ(3, results.size());
+	EXPECT_EQ(VirtualTerminalCommandPipeline::Result::Aborted, results[1]);
+	EXPECT_EQ(VirtualTerminalCommandPipeline::Result::Aborted, results[2]);
+	EXPECT_EQ(2, pipeline.get_statistics().numberAborted);
+	EXPECT_EQ(0, pipeline.get_statistics().numberInFlight);
+	EXPECT_EQ(0, pipeline.get_statistics().numberQueued);
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, CommandPipelineInClient)
+{
+	DerivedTestVTClient clientUnderTest(nullptr, nullptr);
+	std::vector<VirtualTerminalCommandPipeline::Result> results;
+
+	auto callback = [&results](VirtualTerminalCommandPipeline::Result result, std::uint8_t) {
+		results.push_back(result);
+	};
+
+	EXPECT_FALSE(clientUnderTest.get_command_pipeline_enabled());
+
+	// Commands with a completion callback always go through the pipeline
+	EXPECT_TRUE(clientUnderTest.send_command_with_completion([&clientUnderTest]() { return clientUnderTest.send_change_active_mask(0, 1000); },
+	                                                         VirtualTerminalCommandPipeline::Priority::High,
+	                                                         callback));
+	EXPECT_EQ(1, clientUnderTest.get_command_pipeline().get_statistics().numberQueued);
+
+	// The VT doesn't respond to this command with an error code, so it can't have a completion callback
+	EXPECT_FALSE(clientUnderTest.send_command_with_completion([&clientUnderTest]() { return clientUnderTest.send_select_active_working_set(0); },
+	                                                          VirtualTerminalCommandPipeline::Priority::Normal,
+	                                                          callback));
+
+	clientUnderTest.set_command_pipeline_enabled(true);
+	EXPECT_TRUE(clientUnderTest.get_command_pipeline_enabled());
+	EXPECT_TRUE(clientUnderTest.send_hide_show_object(1000, VirtualTerminalClient::HideShowObjectCommand::HideObject));
+	EXPECT_EQ(2, clientUnderTest.get_command_pipeline().get_statistics().numberQueued);
+
+	// A command the shadow state suppresses completes right away
+	clientUnderTest.set_shadow_state_enabled(true);
+	EXPECT_TRUE(clientUnderTest.send_change_numeric_value(1000, 5));
+	EXPECT_TRUE(clientUnderTest.send_command_with_completion([&clientUnderTest]() { return clientUnderTest.send_change_numeric_value(1000, 5); },
+	                                                         VirtualTerminalCommandPipeline::Priority::Low,
+	                                                         callback));
+	ASSERT_EQ(1, results.size());
+	EXPECT_EQ(VirtualTerminalCommandPipeline::Result::Success, results[0]);
+	EXPECT_EQ(3, clientUnderTest.get_command_pipeline().get_statistics().numberQueued);
+
+	clientUnderTest.get_command_pipeline().abort_all();
+	ASSERT_EQ(2, results.size());
+	EXPECT_EQ(VirtualTerminalCommandPipeline::Result::Aborted, results[1]);
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, ClientUpdateDeadlines)
+{
+	DerivedTestVTClient clientUnderTest(nullptr, nullptr);
+
+	// While connecting, the client is polled
+	EXPECT_EQ(50, clientUnderTest.get_time_until_next_update_ms());
+
+	// Once connected, it only needs an update when the next maintenance message is due
+	clientUnderTest.test_wrapper_set_connected();
+	EXPECT_GT(clientUnderTest.get_time_until_next_update_ms(), 900);
+	EXPECT_LE(clientUnderTest.get_time_until_next_update_ms(), 1000);
+
+	// Commands waiting in the pipeline need to be looked after sooner
+	clientUnderTest.set_command_pipeline_enabled(true);
+	EXPECT_TRUE(clientUnderTest.send_hide_show_object(1000, VirtualTerminalClient::HideShowObjectCommand::HideObject));
+	EXPECT_EQ(50, clientUnderTest.get_time_until_next_update_ms());
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, SharedClientExecutor)
+{
+	auto executor = std::make_shared<VirtualTerminalClientExecutor>();
+	DerivedTestVTClient firstClient(nullptr, nullptr);
+	DerivedTestVTClient secondClient(nullptr, nullptr);
+
+	firstClient.initialize(executor);
+	secondClient.initialize(executor);
+	EXPECT_TRUE(firstClient.get_is_initialized());
+	EXPECT_EQ(2, executor->get_number_clients());
+
+	// Both clients are updated right away when they're added
+	for (std::uint32_t i = 0; (i < 100) && (executor->get_number_updates() < 2); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	EXPECT_GE(executor->get_number_updates(), 2);
+
+	// Waking a client updates it without waiting for its next deadline
+	const std::uint32_t updatesBeforeWake = executor->get_number_updates();
+	executor->wake(&firstClient);
+	for (std::uint32_t i = 0; (i < 100) && (executor->get_number_updates() == updatesBeforeWake); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_GT(executor->get_number_updates(), updatesBeforeWake);
+
+	firstClient.terminate();
+	EXPECT_EQ(1, executor->get_number_clients());
+	secondClient.terminate();
+	EXPECT_EQ(0, executor->get_number_clients());
+
+	// Clients that spawn their own thread get an executor of their own
+	DerivedTestVTClient threadedClient(nullptr, nullptr);
+	threadedClient.initialize(true);
+	EXPECT_TRUE(threadedClient.get_is_initialized());
+	threadedClient.terminate();
+	EXPECT_EQ(0, executor->get_number_clients());
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, ObjectPoolManifestFindsChangedObjects)
+{
+	std::vector<std::uint8_t> testPool = isobus::IOPFileInterface::read_iop_file("../examples/vt_version_3_object_pool/VT3TestPool.iop");
+	ASSERT_FALSE(testPool.empty());
+
+	VirtualTerminalObjectPoolIndex index;
+	ASSERT_TRUE(index.build(testPool.data(), static_cast<std::uint32_t>(testPool.size())));
+
+	VirtualTerminalObjectPoolManifest manifest;
+	ASSERT_TRUE(manifest.add_object_pool(testPool.data(), static_cast<std::uint32_t>(testPool.size())));
+	EXPECT_EQ(index.get_number_objects(), manifest.get_number_objects());
+
+	// Nothing changed
+	std::vector<std::uint8_t> changedObjects;
+	std::uint32_t numberChangedObjects = 0;
+	EXPECT_TRUE(manifest.get_changed_objects(testPool.data(), static_cast<std::uint32_t>(testPool.size()), changedObjects, numberChangedObjects));
+	EXPECT_EQ(0, numberChangedObjects);
+	EXPECT_TRUE(changedObjects.empty());
+
+	// Change the background colour of the working set, which is the byte after its type
+	ASSERT_NE(nullptr, index.get_object_at_position(0));
+	const VirtualTerminalObjectPoolIndex::ObjectInfo workingSet = *index.get_object_at_position(0);
+	ASSERT_EQ(VirtualTerminalObjectType::WorkingSet, workingSet.type);
+	testPool[workingSet.offset + 3]++;
+
+	EXPECT_TRUE(manifest.get_changed_objects(testPool.data(), static_cast<std::uint32_t>(testPool.size()), changedObjects, numberChangedObjects));
+	EXPECT_EQ(1, numberChangedObjects);
+	ASSERT_EQ(workingSet.length, changedObjects.size());
+	EXPECT_EQ(0, memcmp(changedObjects.data(), &testPool[workingSet.offset], workingSet.length));
+
+	// Objects the manifest doesn't know about count as changed
+	VirtualTerminalObjectPoolManifest emptyManifest;
+	changedObjects.clear();
+	EXPECT_TRUE(emptyManifest.get_changed_objects(testPool.data(), static_cast<std::uint32_t>(testPool.size()), changedObjects, numberChangedObjects));
+	EXPECT_EQ(index.get_number_objects(), numberChangedObjects);
+	EXPECT_EQ(testPool.size(), changedObjects.size());
+
+	// A malformed pool can't be compared
+	EXPECT_FALSE(manifest.get_changed_objects(testPool.data(), static_cast<std::uint32_t>(testPool.size()) - 1, changedObjects, numberChangedObjects));
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, ObjectPoolManifestFile)
+{
+	const std::string filename = "vt_object_pool_manifest_test.bin";
+	VirtualTerminalObjectPoolManifest manifest;
+	manifest.set_version_label("Test1");
+	manifest.add_object(0, 0x0123456789ABCDEF);
+	manifest.add_object(1000, 42);
+	ASSERT_TRUE(manifest.save(filename));
+
+	VirtualTerminalObjectPoolManifest loadedManifest;
+	ASSERT_TRUE(loadedManifest.load(filename));
+	EXPECT_EQ("Test1", loadedManifest.get_version_label());
+	EXPECT_EQ(2, loadedManifest.get_number_objects());
+	std::uint64_t hash = 0;
+	EXPECT_TRUE(loadedManifest.get_object_hash(0, hash));
+	EXPECT_EQ(0x0123456789ABCDEF, hash);
+	EXPECT_TRUE(loadedManifest.get_object_hash(1000, hash));
+	EXPECT_EQ(42, hash);
+	EXPECT_FALSE(loadedManifest.get_object_hash(1, hash));
+
+	// A corrupted file is rejected and leaves the manifest empty
+	{
+		std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
+		ASSERT_TRUE(file.is_open());
+		file.seekp(10);
+		file.put('X');
+	}
+	EXPECT_FALSE(loadedManifest.load(filename));
+	EXPECT_EQ(0, loadedManifest.get_number_objects());
+	EXPECT_TRUE(loadedManifest.get_version_label().empty());
+
+	std::remove(filename.c_str());
+	EXPECT_FALSE(loadedManifest.load(filename));
+
+	// The client only uses a manifest when it's given a file to keep it in
+	VirtualTerminalClient clientUnderTest(nullptr, nullptr);
+	EXPECT_TRUE(clientUnderTest.get_object_pool_manifest_file().empty());
+	clientUnderTest.set_object_pool_manifest_file(filename);
+	EXPECT_EQ(filename, clientUnderTest.get_object_pool_manifest_file());
+	EXPECT_FALSE(clientUnderTest.get_last_upload_was_partial());
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, VectorObjectPoolUploadData)
+{
+	std::vector<std::uint8_t> testPool = isobus::IOPFileInterface::read_iop_file("../examples/vt_version_3_object_pool/VT3TestPool.iop");
+	ASSERT_FALSE(testPool.empty());
+
+	// An unscaled pool set from a vector is uploaded straight from the vector
+	DerivedTestVTClient clientUnderTest(nullptr, nullptr);
+	clientUnderTest.set_object_pool(0, VirtualTerminalClient::VTVersion::Version3, &testPool);
+
+	std::uint8_t chunk[8] = { 0 };
+	EXPECT_TRUE(DerivedTestVTClient::test_wrapper_process_internal_object_pool_upload_callback(0, 8, chunk, &clientUnderTest));
+	EXPECT_EQ(0x11, chunk[0]);
+	EXPECT_EQ(0, memcmp(&chunk[1], testPool.data(), 7));
+	EXPECT_TRUE(DerivedTestVTClient::test_wrapper_process_internal_object_pool_upload_callback(static_cast<std::uint32_t>(testPool.size()) - 7, 8, chunk, &clientUnderTest));
+	EXPECT_EQ(0, memcmp(chunk, &testPool[testPool.size() - 8], 8));
+	EXPECT_FALSE(DerivedTestVTClient::test_wrapper_process_internal_object_pool_upload_callback(static_cast<std::uint32_t>(testPool.size()) - 6, 8, chunk, &clientUnderTest));
+}
+
+TEST(VIRTUAL_TERMINAL_TESTS, VectorAndPointerPoolsUploadTheSameData)
+{
+	std::vector<std::uint8_t> testPool = isobus::IOPFileInterface::read_iop_file("../examples/vt_version_3_object_pool/VT3TestPool.iop");
+	ASSERT_FALSE(testPool.empty());
+
+	DerivedTestVTClient vectorClient(nullptr, nullptr);
+	DerivedTestVTClient pointerClient(nullptr, nullptr);
+	vectorClient.set_object_pool(0, VirtualTerminalClient::VTVersion::Version3, &testPool);
+	pointerClient.set_object_pool(0, VirtualTerminalClient::VTVersion::Version3, testPool.data(), static_cast<std::uint32_t>(testPool.size()));
+
+	// Walk the whole transfer, including the mux byte and a short last chunk
+	const std::uint32_t transferSize = static_cast<std::uint32_t>(testPool.size()) + 1;
+	std::vector<std::uint8_t> vectorTransfer;
+	std::vector<std::uint8_t> pointerTransfer;
+
+	for (std::uint32_t bytesOffset = 0; bytesOffset < transferSize; bytesOffset += 8)
+	{
+		const std::uint32_t chunkSize = std::min<std::uint32_t>(8, transferSize - bytesOffset);
+		std::uint8_t vectorChunk[8] = { 0 };
+		std::uint8_t pointerChunk[8] = { 0 };
+
+		ASSERT_TRUE(DerivedTestVTClient::test_wrapper_process_internal_object_pool_upload_callback(bytesOffset, chunkSize, vectorChunk, &vectorClient));
+		ASSERT_TRUE(DerivedTestVTClient::test_wrapper_process_internal_object_pool_upload_callback(bytesOffset, chunkSize, pointerChunk, &pointerClient));
+		vectorTransfer.insert(vectorTransfer.end(), vectorChunk, vectorChunk + chunkSize);
+		pointerTransfer.insert(pointerTransfer.end(), pointerChunk, pointerChunk + chunkSize);
+	}
+
+	ASSERT_EQ(transferSize, vectorTransfer.size());
+	EXPECT_EQ(0x11, vectorTransfer[0]);
+	EXPECT_TRUE(std::equal(testPool.begin(), testPool.end(), vectorTransfer.begin() + 1));
+	EXPECT_EQ(pointerTransfer, vectorTransfer);
+}
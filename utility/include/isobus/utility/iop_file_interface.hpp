@@ -10,12 +10,16 @@
 #ifndef IOP_FILE_INTERFACE_HPP
 #define IOP_FILE_INTERFACE_HPP
 
+#include "isobus/utility/xxhash.hpp"
+
 #include <cstdint>
 #include <string>
 #include <vector>
 
 namespace isobus
 {
+	class ObjectPoolHasher;
+
 	//================================================================================================
 	/// @class IOPFileInterface
 	///
@@ -32,11 +36,77 @@ namespace isobus
 		/// @returns A vector with an object pool in it, or an empty vector if reading failed
 		static std::vector<std::uint8_t> read_iop_file(const std::string &filename);
 
+		/// @brief Reads an IOP file given a file name/path, and hashes it while it is read
+		/// @param[in] filename A string filepath for the IOP file to read
+		/// @param[in,out] hasher A hasher that the contents of the file are added to
+		/// @returns A vector with an object pool in it, or an empty vector if reading failed
+		static std::vector<std::uint8_t> read_iop_file(const std::string &filename, ObjectPoolHasher &hasher);
+
 		/// @brief Reads an object pool and generates a string version by hashing it
-		/// @details Credit for the hash algorithm here goes to "see" on stack overflow.
+		/// @details The version is derived from a 64 bit xxHash of the pool, so it is the same on every platform.
 		/// @param[in] iopData The object pool to hash and generate a version for
-		/// @returns A 7 character string that is probably somewhat unique for this pool
+		/// @returns A 7 character version label for this pool
 		static std::string hash_object_pool_to_version(std::vector<std::uint8_t> &iopData);
+
+		/// @brief Reads an object pool from a buffer, like a memory mapped IOP file, and generates a string version by hashing it
+		/// @details Gives the same version as the vector overload does for the same data.
+		/// @param[in] iopData The object pool to hash and generate a version for
+		/// @param[in] iopSize The size of the object pool in bytes
+		/// @returns A 7 character version label for this pool
+		static std::string hash_object_pool_to_version(const std::uint8_t *iopData, std::size_t iopSize);
+
+		/// @brief Reads an object pool and generates an extended (32 character) version by hashing it
+		/// @details The version is derived from a 128 bit hash of the pool, and is meant for the extended version commands
+		/// @param[in] iopData The object pool to hash and generate a version for
+		/// @returns A 32 character version label for this pool
+		static std::string hash_object_pool_to_extended_version(const std::vector<std::uint8_t> &iopData);
+
+		/// @brief Reads an object pool from a buffer and generates an extended (32 character) version by hashing it
+		/// @param[in] iopData The object pool to hash and generate a version for
+		/// @param[in] iopSize The size of the object pool in bytes
+		/// @returns A 32 character version label for this pool
+		static std::string hash_object_pool_to_extended_version(const std::uint8_t *iopData, std::size_t iopSize);
+	};
+
+	//================================================================================================
+	/// @class ObjectPoolHasher
+	///
+	/// @brief Hashes an object pool incrementally, for example while it is read from a file or
+	/// uploaded to a VT, and turns the result into version labels.
+	/// @details The labels are the same as the ones from IOPFileInterface::hash_object_pool_to_version
+	/// and IOPFileInterface::hash_object_pool_to_extended_version for the same data, no matter how
+	/// the data was split up when it was passed to update().
+	//================================================================================================
+	class ObjectPoolHasher
+	{
+	public:
+		/// @brief Constructor for a hasher with no data hashed yet
+		ObjectPoolHasher();
+
+		/// @brief Discards any data hashed so far and starts again
+		void reset();
+
+		/// @brief Adds part of the object pool to the hash
+		/// @param[in] data The next part of the object pool
+		/// @param[in] size The number of bytes in data
+		void update(const std::uint8_t *data, std::size_t size);
+
+		/// @brief Returns a version label for the data hashed so far, for the store and load version commands
+		/// @returns A 7 character version label
+		std::string get_version() const;
+
+		/// @brief Returns a version label for the data hashed so far, for the extended store and load version commands
+		/// @returns A 32 character version label
+		std::string get_extended_version() const;
+
+		static constexpr std::size_t VERSION_LABEL_LENGTH = 7; ///< The length of a version label
+		static constexpr std::size_t EXTENDED_VERSION_LABEL_LENGTH = 32; ///< The length of an extended version label
+
+	private:
+		static constexpr std::uint64_t SECOND_LANE_SEED = 0x6F626A656374706FULL; ///< Seeds the second half of the 128 bit hash so it is independent of the first
+
+		XXHash64 firstLane; ///< The first 64 bits of the hash, which the 7 character version is derived from
+		XXHash64 secondLane; ///< The second 64 bits of the hash, only used for the extended version
 	};
 }
 
@@ -0,0 +1,98 @@
+//================================================================================================
+/// @file memory_mapped_file.hpp
+///
+/// @brief A small, platform independent wrapper around a memory mapping of a file.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+#ifndef MEMORY_MAPPED_FILE_HPP
+#define MEMORY_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace isobus
+{
+	//================================================================================================
+	/// @class MemoryMappedFile
+	///
+	/// @brief Maps a file into the address space of the process so that it can be read without
+	/// first copying it into the heap.
+	/// @details Pages are only loaded by the OS when they are touched, so mapping a large file is
+	/// nearly free, and large object pools or logs can be transmitted straight out of the page cache.
+	/// On platforms without a virtual memory system (like ESP-IDF) opening a file will always fail.
+	//================================================================================================
+	class MemoryMappedFile
+	{
+	public:
+		/// @brief Constructs an empty, unmapped file object
+		MemoryMappedFile();
+
+		/// @brief Destructor, unmaps the file if needed
+		~MemoryMappedFile();
+
+		/// @brief Deleted copy constructor, a mapping has exactly one owner
+		MemoryMappedFile(const MemoryMappedFile &) = delete;
+
+		/// @brief Deleted assignment operator, a mapping has exactly one owner
+		/// @returns Nothing, this is deleted
+		MemoryMappedFile &operator=(const MemoryMappedFile &) = delete;
+
+		/// @brief Maps the specified file as read-only. Closes any previously mapped file first.
+		/// @param[in] filename The path of the file to map
+		/// @returns `true` if the file was mapped, otherwise `false`
+		bool open_read_only(const std::string &filename);
+
+		/// @brief Maps the specified file as shared and writable, creating it if it doesn't exist.
+		/// Closes any previously mapped file first.
+		/// @details Writes to the mapping go to the page cache directly, so they survive the process
+		/// crashing. Call flush() to also make them survive a power loss.
+		/// @param[in] filename The path of the file to map
+		/// @param[in] minimumSize The file is grown to at least this many bytes before it is mapped
+		/// @returns `true` if the file was mapped, otherwise `false`
+		bool open_read_write(const std::string &filename, std::size_t minimumSize);
+
+		/// @brief Unmaps the file and releases the associated OS handles
+		void close();
+
+		/// @brief Returns if a file is currently mapped
+		/// @returns `true` if a file is currently mapped, otherwise `false`
+		bool get_is_open() const;
+
+		/// @brief Returns a pointer to the first byte of the mapping
+		/// @returns A pointer to the start of the mapping, or nullptr if nothing is mapped
+		const std::uint8_t *get_data() const;
+
+		/// @brief Returns a writable pointer to the first byte of the mapping
+		/// @returns A pointer to the start of the mapping, or nullptr if nothing is mapped or the mapping is read-only
+		std::uint8_t *get_writable_data();
+
+		/// @brief Writes any modified pages of a writable mapping back to the file and waits for them
+		/// to reach the storage device. This can block for a long time, so don't call it from time critical threads.
+		/// @returns `true` if the mapping was flushed, otherwise `false`
+		bool flush();
+
+		/// @brief Returns the size of the mapping in bytes
+		/// @returns The size of the mapped file in bytes, or 0 if nothing is mapped
+		std::size_t get_size() const;
+
+		/// @brief Returns if memory mapping is supported on this platform
+		/// @returns `true` if the platform supports memory mapped files
+		static bool get_is_supported();
+
+	private:
+		std::uint8_t *mappedData; ///< The start of the mapping
+		std::size_t mappedSize; ///< The length of the mapping in bytes
+		bool writable; ///< Tells if the mapping was opened with open_read_write
+#if defined(_WIN32)
+		void *fileHandle; ///< The Windows file handle
+		void *mappingHandle; ///< The Windows file mapping handle
+#else
+		int fileDescriptor; ///< The POSIX file descriptor
+#endif
+	};
+} // namespace isobus
+
+#endif // MEMORY_MAPPED_FILE_HPP
@@ -0,0 +1,26 @@
+//================================================================================================
+/// @file replace_file.hpp
+///
+/// @brief Replaces a file with a newly written one, so that a power loss leaves either the old
+/// file or the new one, but never a partly written file or no file at all
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+#ifndef REPLACE_FILE_HPP
+#define REPLACE_FILE_HPP
+
+#include <string>
+
+namespace isobus
+{
+	/// @brief Syncs a newly written file to disk, then renames it over another file in one step
+	/// @details The new file must already be written and closed. On Windows, where std::rename can't
+	/// replace an existing file, the file is moved with MoveFileEx instead.
+	/// @param[in] newFilename The file to move, usually a temporary file next to the one it replaces
+	/// @param[in] filename The file to replace. It doesn't need to exist yet.
+	/// @returns `true` if the file was replaced, otherwise `false`, in which case both files are left as they were
+	bool replace_file(const std::string &newFilename, const std::string &filename);
+} // namespace isobus
+
+#endif // REPLACE_FILE_HPP
@@ -0,0 +1,105 @@
+//================================================================================================
+/// @file xxhash.hpp
+///
+/// @brief A portable implementation of the 64 bit xxHash algorithm, with an incremental API
+/// so that data can be hashed as it is read or transmitted.
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+#ifndef XXHASH_HPP
+#define XXHASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace isobus
+{
+	//================================================================================================
+	/// @class XXHash64
+	///
+	/// @brief Calculates the XXH64 hash of a stream of bytes.
+	/// @details Data can be passed to update() in chunks of any size, and the result is the same as
+	/// hashing all of it at once. The result doesn't depend on the platform's endianness or word size,
+	/// and matches the reference xxHash implementation, so it is safe to store or send to other devices.
+	//================================================================================================
+	class XXHash64
+	{
+	public:
+		/// @brief Constructor for a hasher with no data hashed yet
+		/// @param[in] seed A seed value, which gives a different, independent hash for the same data
+		explicit XXHash64(std::uint64_t seed = 0);
+
+		/// @brief Discards any data hashed so far and starts again
+		/// @param[in] seed A seed value, which gives a different, independent hash for the same data
+		void reset(std::uint64_t seed = 0);
+
+		/// @brief Adds data to the hash
+		/// @param[in] data The data to hash
+		/// @param[in] size The number of bytes in data
+		void update(const std::uint8_t *data, std::size_t size);
+
+		/// @brief Returns the hash of all data passed to update() so far. More data can be added afterwards.
+		/// @returns The 64 bit hash
+		std::uint64_t digest() const;
+
+		/// @brief Returns the number of bytes hashed so far
+		/// @returns The number of bytes hashed so far
+		std::uint64_t get_total_length() const;
+
+		/// @brief Hashes a buffer in one call
+		/// @param[in] data The data to hash
+		/// @param[in] size The number of bytes in data
+		/// @param[in] seed A seed value, which gives a different, independent hash for the same data
+		/// @returns The 64 bit hash
+		static std::uint64_t hash(const std::uint8_t *data, std::size_t size, std::uint64_t seed = 0);
+
+	private:
+		static constexpr std::uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL; ///< The first xxHash 64 bit prime
+		static constexpr std::uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL; ///< The second xxHash 64 bit prime
+		static constexpr std::uint64_t PRIME_3 = 0x165667B19E3779F9ULL; ///< The third xxHash 64 bit prime
+		static constexpr std::uint64_t PRIME_4 = 0x85EBCA77C2B2AE63ULL; ///< The fourth xxHash 64 bit prime
+		static constexpr std::uint64_t PRIME_5 = 0x27D4EB2F165667C5ULL; ///< The fifth xxHash 64 bit prime
+		static constexpr std::size_t STRIPE_SIZE = 32; ///< The number of bytes consumed by each round of the four accumulators
+
+		/// @brief Rotates a value left
+		/// @param[in] value The value to rotate
+		/// @param[in] bits The number of bits to rotate by, from 1 to 63
+		/// @returns The rotated value
+		static std::uint64_t rotate_left(std::uint64_t value, std::uint32_t bits);
+
+		/// @brief Reads a little endian 64 bit value
+		/// @param[in] data The first byte of the value
+		/// @returns The value
+		static std::uint64_t read_uint64(const std::uint8_t *data);
+
+		/// @brief Reads a little endian 32 bit value
+		/// @param[in] data The first byte of the value
+		/// @returns The value
+		static std::uint32_t read_uint32(const std::uint8_t *data);
+
+		/// @brief Mixes 8 bytes of input into an accumulator
+		/// @param[in] accumulator The accumulator to mix into
+		/// @param[in] input The input to mix
+		/// @returns The new value of the accumulator
+		static std::uint64_t round(std::uint64_t accumulator, std::uint64_t input);
+
+		/// @brief Merges one of the four accumulators into the final hash
+		/// @param[in] hash The hash so far
+		/// @param[in] accumulator The accumulator to merge
+		/// @returns The new value of the hash
+		static std::uint64_t merge_round(std::uint64_t hash, std::uint64_t accumulator);
+
+		/// @brief Consumes one 32 byte stripe of input into the accumulators
+		/// @param[in] stripe The stripe to consume, which must be STRIPE_SIZE bytes long
+		void consume_stripe(const std::uint8_t *stripe);
+
+		std::uint64_t accumulators[4]; ///< The four lanes of the hash state
+		std::uint64_t seed; ///< The seed the hash was started with
+		std::uint64_t totalLength; ///< The number of bytes hashed so far
+		std::uint8_t buffer[STRIPE_SIZE]; ///< Bytes that don't yet fill a stripe
+		std::size_t bufferSize; ///< The number of bytes in buffer
+	};
+} // namespace isobus
+
+#endif // XXHASH_HPP
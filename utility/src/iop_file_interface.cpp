@@ -10,7 +10,6 @@
 
 #include <fstream>
 #include <iomanip>
-#include <iterator>
 #include <sstream>
 
 namespace isobus
@@ -18,40 +17,127 @@ namespace isobus
 	std::vector<std::uint8_t> IOPFileInterface::read_iop_file(const std::string &filename)
 	{
 		std::vector<std::uint8_t> retVal;
-		std::streampos fileSize;
+		std::ifstream file(filename, std::ios::binary | std::ios::ate);
 
-		std::ifstream file(filename, std::ios::binary);
+		if (file.is_open())
+		{
+			const std::streamsize fileSize = file.tellg();
+
+			if (fileSize > 0)
+			{
+				// Read the whole file at once, rather than a byte at a time through a stream iterator
+				retVal.resize(static_cast<std::size_t>(fileSize));
+				file.seekg(0, std::ios::beg);
+
+				if (!file.read(reinterpret_cast<char *>(retVal.data()), fileSize))
+				{
+					retVal.clear();
+				}
+			}
+		}
+		return retVal;
+	}
+
+	std::vector<std::uint8_t> IOPFileInterface::read_iop_file(const std::string &filename, ObjectPoolHasher &hasher)
+	{
+		constexpr std::size_t READ_CHUNK_SIZE = 65536;
+		std::vector<std::uint8_t> retVal;
+		std::ifstream file(filename, std::ios::binary | std::ios::ate);
 
 		if (file.is_open())
 		{
-			// Ignore newlines
-			file.unsetf(std::ios::skipws);
+			const std::streamsize fileSize = file.tellg();
 
-			file.seekg(0, std::ios::end);
-			fileSize = file.tellg();
-			file.seekg(0, std::ios::beg);
+			if (fileSize > 0)
+			{
+				std::size_t position = 0;
+				retVal.resize(static_cast<std::size_t>(fileSize));
+				file.seekg(0, std::ios::beg);
 
-			retVal.reserve(fileSize);
+				// Hash each chunk while it is still in the cache from being read
+				while (position < retVal.size())
+				{
+					const std::size_t chunkSize = ((retVal.size() - position) < READ_CHUNK_SIZE) ? (retVal.size() - position) : READ_CHUNK_SIZE;
 
-			// Read in the data
-			retVal.insert(retVal.begin(), std::istream_iterator<std::uint8_t>(file), std::istream_iterator<std::uint8_t>());
+					if (file.read(reinterpret_cast<char *>(&retVal[position]), static_cast<std::streamsize>(chunkSize)))
+					{
+						hasher.update(&retVal[position], chunkSize);
+						position += chunkSize;
+					}
+					else
+					{
+						retVal.clear();
+					}
+				}
+			}
 		}
 		return retVal;
 	}
 
 	std::string IOPFileInterface::hash_object_pool_to_version(std::vector<std::uint8_t> &iopData)
 	{
-		std::size_t seed = iopData.size();
-		std::stringstream stream;
+		return hash_object_pool_to_version(iopData.data(), iopData.size());
+	}
+
+	std::string IOPFileInterface::hash_object_pool_to_version(const std::uint8_t *iopData, std::size_t iopSize)
+	{
+		ObjectPoolHasher hasher;
+		hasher.update(iopData, iopSize);
+		return hasher.get_version();
+	}
+
+	std::string IOPFileInterface::hash_object_pool_to_extended_version(const std::vector<std::uint8_t> &iopData)
+	{
+		return hash_object_pool_to_extended_version(iopData.data(), iopData.size());
+	}
+
+	std::string IOPFileInterface::hash_object_pool_to_extended_version(const std::uint8_t *iopData, std::size_t iopSize)
+	{
+		ObjectPoolHasher hasher;
+		hasher.update(iopData, iopSize);
+		return hasher.get_extended_version();
+	}
+
+	ObjectPoolHasher::ObjectPoolHasher() :
+	  firstLane(0),
+	  secondLane(SECOND_LANE_SEED)
+	{
+	}
 
-		for (auto x : iopData)
+	void ObjectPoolHasher::reset()
+	{
+		firstLane.reset(0);
+		secondLane.reset(SECOND_LANE_SEED);
+	}
+
+	void ObjectPoolHasher::update(const std::uint8_t *data, std::size_t size)
+	{
+		firstLane.update(data, size);
+		secondLane.update(data, size);
+	}
+
+	std::string ObjectPoolHasher::get_version() const
+	{
+		// 5 bits per character from an alphabet without easily confused letters, which fits 35 bits of the hash in 7 characters
+		constexpr char ALPHABET[] = "0123456789abcdefghjkmnpqrstvwxyz";
+		const std::uint64_t hash = firstLane.digest();
+		std::string retVal(VERSION_LABEL_LENGTH, ' ');
+
+		for (std::size_t i = 0; i < VERSION_LABEL_LENGTH; i++)
 		{
-			x = ((x >> 16) ^ x) * 0x45d9f3b;
-			x = ((x >> 16) ^ x) * 0x45d9f3b;
-			x = (x >> 16) ^ x;
-			seed ^= x + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+			retVal[i] = ALPHABET[(hash >> (64 - (5 * (i + 1)))) & 0x1F];
 		}
-		stream << std::hex << seed;
+		return retVal;
+	}
+
+	std::string ObjectPoolHasher::get_extended_version() const
+	{
+		std::stringstream stream;
+		stream << std::hex << std::setfill('0') << std::setw(16) << firstLane.digest() << std::setw(16) << secondLane.digest();
 		return stream.str();
 	}
+
+	constexpr std::size_t ObjectPoolHasher::VERSION_LABEL_LENGTH;
+	constexpr std::size_t ObjectPoolHasher::EXTENDED_VERSION_LABEL_LENGTH;
+	constexpr std::uint64_t ObjectPoolHasher::SECOND_LANE_SEED;
 }
@@ -0,0 +1,273 @@
+//================================================================================================
+/// @file memory_mapped_file.cpp
+///
+/// @brief Implementation of a platform independent memory mapped file
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+#include "isobus/utility/memory_mapped_file.hpp"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#define ISOBUS_MEMORY_MAPPING_SUPPORTED
+#elif (defined(__unix__) || defined(__APPLE__)) && !defined(ESP_PLATFORM)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ISOBUS_MEMORY_MAPPING_SUPPORTED
+#endif
+
+namespace isobus
+{
+	MemoryMappedFile::MemoryMappedFile() :
+	  mappedData(nullptr),
+	  mappedSize(0),
+	  writable(false),
+#if defined(_WIN32)
+	  fileHandle(nullptr),
+	  mappingHandle(nullptr)
+#else
+	  fileDescriptor(-1)
+#endif
+	{
+	}
+
+	MemoryMappedFile::~MemoryMappedFile()
+	{
+		close();
+	}
+
+	bool MemoryMappedFile::open_read_only(const std::string &filename)
+	{
+		bool retVal = false;
+
+		close();
+
+#if defined(_WIN32)
+		HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+		if (INVALID_HANDLE_VALUE != file)
+		{
+			LARGE_INTEGER fileSize;
+
+			fileHandle = file;
+
+			if ((GetFileSizeEx(file, &fileSize)) &&
+			    (fileSize.QuadPart > 0))
+			{
+				mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+				if (nullptr != mappingHandle)
+				{
+					mappedData = static_cast<std::uint8_t *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+
+					if (nullptr != mappedData)
+					{
+						mappedSize = static_cast<std::size_t>(fileSize.QuadPart);
+						retVal = true;
+					}
+				}
+			}
+		}
+#elif defined(ISOBUS_MEMORY_MAPPING_SUPPORTED)
+		fileDescriptor = ::open(filename.c_str(), O_RDONLY);
+
+		if (fileDescriptor >= 0)
+		{
+			struct stat fileStatus;
+
+			if ((0 == fstat(fileDescriptor, &fileStatus)) &&
+			    (fileStatus.st_size > 0))
+			{
+				void *mapping = mmap(nullptr, static_cast<std::size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+
+				if (MAP_FAILED != mapping)
+				{
+					// Transmit sources are always read front to back, so let the kernel read ahead aggressively
+					madvise(mapping, static_cast<std::size_t>(fileStatus.st_size), MADV_SEQUENTIAL);
+					mappedData = static_cast<std::uint8_t *>(mapping);
+					mappedSize = static_cast<std::size_t>(fileStatus.st_size);
+					retVal = true;
+				}
+			}
+		}
+#else
+		(void)filename;
+#endif
+
+		if (!retVal)
+		{
+			close();
+		}
+		return retVal;
+	}
+
+	bool MemoryMappedFile::open_read_write(const std::string &filename, std::size_t minimumSize)
+	{
+		bool retVal = false;
+
+		close();
+
+#if defined(_WIN32)
+		HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+		if (INVALID_HANDLE_VALUE != file)
+		{
+			LARGE_INTEGER fileSize;
+
+			fileHandle = file;
+
+			if (GetFileSizeEx(file, &fileSize))
+			{
+				std::uint64_t mappingSize = static_cast<std::uint64_t>(fileSize.QuadPart);
+
+				if (mappingSize < minimumSize)
+				{
+					// Creating a mapping larger than the file grows the file to match
+					mappingSize = minimumSize;
+				}
+
+				if (mappingSize > 0)
+				{
+					mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(mappingSize >> 32), static_cast<DWORD>(mappingSize & 0xFFFFFFFF), nullptr);
+
+					if (nullptr != mappingHandle)
+					{
+						mappedData = static_cast<std::uint8_t *>(MapViewOfFile(mappingHandle, FILE_MAP_WRITE, 0, 0, 0));
+
+						if (nullptr != mappedData)
+						{
+							mappedSize = static_cast<std::size_t>(mappingSize);
+							writable = true;
+							retVal = true;
+						}
+					}
+				}
+			}
+		}
+#elif defined(ISOBUS_MEMORY_MAPPING_SUPPORTED)
+		fileDescriptor = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+
+		if (fileDescriptor >= 0)
+		{
+			struct stat fileStatus;
+
+			if (0 == fstat(fileDescriptor, &fileStatus))
+			{
+				std::size_t mappingSize = static_cast<std::size_t>(fileStatus.st_size);
+
+				if ((mappingSize < minimumSize) &&
+				    (0 == ftruncate(fileDescriptor, static_cast<off_t>(minimumSize))))
+				{
+					mappingSize = minimumSize;
+				}
+
+				if (mappingSize > 0)
+				{
+					void *mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+
+					if (MAP_FAILED != mapping)
+					{
+						mappedData = static_cast<std::uint8_t *>(mapping);
+						mappedSize = mappingSize;
+						writable = true;
+						retVal = true;
+					}
+				}
+			}
+		}
+#else
+		(void)filename;
+		(void)minimumSize;
+#endif
+
+		if (!retVal)
+		{
+			close();
+		}
+		return retVal;
+	}
+
+	void MemoryMappedFile::close()
+	{
+#if defined(_WIN32)
+		if (nullptr != mappedData)
+		{
+			UnmapViewOfFile(mappedData);
+		}
+		if (nullptr != mappingHandle)
+		{
+			CloseHandle(mappingHandle);
+			mappingHandle = nullptr;
+		}
+		if (nullptr != fileHandle)
+		{
+			CloseHandle(fileHandle);
+			fileHandle = nullptr;
+		}
+#elif defined(ISOBUS_MEMORY_MAPPING_SUPPORTED)
+		if (nullptr != mappedData)
+		{
+			munmap(mappedData, mappedSize);
+		}
+		if (fileDescriptor >= 0)
+		{
+			::close(fileDescriptor);
+			fileDescriptor = -1;
+		}
+#endif
+		mappedData = nullptr;
+		mappedSize = 0;
+		writable = false;
+	}
+
+	bool MemoryMappedFile::get_is_open() const
+	{
+		return (nullptr != mappedData);
+	}
+
+	const std::uint8_t *MemoryMappedFile::get_data() const
+	{
+		return mappedData;
+	}
+
+	std::uint8_t *MemoryMappedFile::get_writable_data()
+	{
+		return (writable ? mappedData : nullptr);
+	}
+
+	bool MemoryMappedFile::flush()
+	{
+		bool retVal = false;
+
+		if ((nullptr != mappedData) && writable)
+		{
+#if defined(_WIN32)
+			retVal = ((0 != FlushViewOfFile(mappedData, 0)) &&
+			          (0 != FlushFileBuffers(fileHandle)));
+#elif defined(ISOBUS_MEMORY_MAPPING_SUPPORTED)
+			retVal = (0 == msync(mappedData, mappedSize, MS_SYNC));
+#endif
+		}
+		return retVal;
+	}
+
+	std::size_t MemoryMappedFile::get_size() const
+	{
+		return mappedSize;
+	}
+
+	bool MemoryMappedFile::get_is_supported()
+	{
+#if defined(ISOBUS_MEMORY_MAPPING_SUPPORTED)
+		return true;
+#else
+		return false;
+#endif
+	}
+} // namespace isobus
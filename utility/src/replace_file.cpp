@@ -0,0 +1,55 @@
+//================================================================================================
+/// @file replace_file.cpp
+///
+/// @brief Implements replacing a file with a newly written one
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+#include "isobus/utility/replace_file.hpp"
+
+#include <cstdio>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif (defined(__unix__) || defined(__APPLE__)) && !defined(ESP_PLATFORM)
+#include <fcntl.h>
+#include <unistd.h>
+#define ISOBUS_FILE_SYNC_SUPPORTED
+#endif
+
+namespace isobus
+{
+	bool replace_file(const std::string &newFilename, const std::string &filename)
+	{
+		bool retVal = false;
+
+#if defined(_WIN32)
+		HANDLE file = CreateFileA(newFilename.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+		if (INVALID_HANDLE_VALUE != file)
+		{
+			const bool synced = (0 != FlushFileBuffers(file));
+
+			CloseHandle(file);
+			retVal = synced && (0 != MoveFileExA(newFilename.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH));
+		}
+#elif defined(ISOBUS_FILE_SYNC_SUPPORTED)
+		const int fileDescriptor = open(newFilename.c_str(), O_RDONLY);
+
+		if (fileDescriptor >= 0)
+		{
+			const bool synced = (0 == fsync(fileDescriptor));
+
+			close(fileDescriptor);
+			retVal = synced && (0 == std::rename(newFilename.c_str(), filename.c_str()));
+		}
+#else
+		retVal = (0 == std::rename(newFilename.c_str(), filename.c_str()));
+#endif
+		return retVal;
+	}
+} // namespace isobus
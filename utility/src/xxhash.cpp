@@ -0,0 +1,177 @@
+//================================================================================================
+/// @file xxhash.cpp
+///
+/// @brief Implementation of the 64 bit xxHash algorithm
+/// @author Adrian Del Grosso
+///
+/// @copyright 2023 Adrian Del Grosso
+//================================================================================================
+#include "isobus/utility/xxhash.hpp"
+
+#include <cstring>
+
+namespace isobus
+{
+	XXHash64::XXHash64(std::uint64_t seed)
+	{
+		reset(seed);
+	}
+
+	void XXHash64::reset(std::uint64_t seed)
+	{
+		this->seed = seed;
+		accumulators[0] = seed + PRIME_1 + PRIME_2;
+		accumulators[1] = seed + PRIME_2;
+		accumulators[2] = seed;
+		accumulators[3] = seed - PRIME_1;
+		totalLength = 0;
+		bufferSize = 0;
+	}
+
+	void XXHash64::update(const std::uint8_t *data, std::size_t size)
+	{
+		if ((nullptr != data) && (0 != size))
+		{
+			std::size_t position = 0;
+			totalLength += size;
+
+			if (0 != bufferSize)
+			{
+				// Top up the partial stripe from the last call first
+				const std::size_t bytesToCopy = ((STRIPE_SIZE - bufferSize) < size) ? (STRIPE_SIZE - bufferSize) : size;
+				memcpy(&buffer[bufferSize], data, bytesToCopy);
+				bufferSize += bytesToCopy;
+				position = bytesToCopy;
+
+				if (STRIPE_SIZE == bufferSize)
+				{
+					consume_stripe(buffer);
+					bufferSize = 0;
+				}
+			}
+
+			while ((size - position) >= STRIPE_SIZE)
+			{
+				consume_stripe(&data[position]);
+				position += STRIPE_SIZE;
+			}
+
+			if (position < size)
+			{
+				memcpy(&buffer[bufferSize], &data[position], size - position);
+				bufferSize += (size - position);
+			}
+		}
+	}
+
+	std::uint64_t XXHash64::digest() const
+	{
+		std::uint64_t retVal;
+		std::size_t position = 0;
+
+		if (totalLength >= STRIPE_SIZE)
+		{
+			retVal = rotate_left(accumulators[0], 1) +
+			  rotate_left(accumulators[1], 7) +
+			  rotate_left(accumulators[2], 12) +
+			  rotate_left(accumulators[3], 18);
+
+			for (std::uint_fast8_t i = 0; i < 4; i++)
+			{
+				retVal = merge_round(retVal, accumulators[i]);
+			}
+		}
+		else
+		{
+			retVal = seed + PRIME_5;
+		}
+		retVal += totalLength;
+
+		while ((position + 8) <= bufferSize)
+		{
+			retVal ^= round(0, read_uint64(&buffer[position]));
+			retVal = rotate_left(retVal, 27) * PRIME_1 + PRIME_4;
+			position += 8;
+		}
+
+		if ((position + 4) <= bufferSize)
+		{
+			retVal ^= static_cast<std::uint64_t>(read_uint32(&buffer[position])) * PRIME_1;
+			retVal = rotate_left(retVal, 23) * PRIME_2 + PRIME_3;
+			position += 4;
+		}
+
+		while (position < bufferSize)
+		{
+			retVal ^= static_cast<std::uint64_t>(buffer[position]) * PRIME_5;
+			retVal = rotate_left(retVal, 11) * PRIME_1;
+			position++;
+		}
+
+		// Final avalanche, so every input bit affects every output bit
+		retVal ^= retVal >> 33;
+		retVal *= PRIME_2;
+		retVal ^= retVal >> 29;
+		retVal *= PRIME_3;
+		retVal ^= retVal >> 32;
+		return retVal;
+	}
+
+	std::uint64_t XXHash64::get_total_length() const
+	{
+		return totalLength;
+	}
+
+	std::uint64_t XXHash64::hash(const std::uint8_t *data, std::size_t size, std::uint64_t seed)
+	{
+		XXHash64 hasher(seed);
+		hasher.update(data, size);
+		return hasher.digest();
+	}
+
+	std::uint64_t XXHash64::rotate_left(std::uint64_t value, std::uint32_t bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	std::uint64_t XXHash64::read_uint64(const std::uint8_t *data)
+	{
+		return static_cast<std::uint64_t>(read_uint32(data)) | (static_cast<std::uint64_t>(read_uint32(&data[4])) << 32);
+	}
+
+	std::uint32_t XXHash64::read_uint32(const std::uint8_t *data)
+	{
+		return static_cast<std::uint32_t>(data[0]) |
+		  (static_cast<std::uint32_t>(data[1]) << 8) |
+		  (static_cast<std::uint32_t>(data[2]) << 16) |
+		  (static_cast<std::uint32_t>(data[3]) << 24);
+	}
+
+	std::uint64_t XXHash64::round(std::uint64_t accumulator, std::uint64_t input)
+	{
+		accumulator += input * PRIME_2;
+		accumulator = rotate_left(accumulator, 31);
+		return accumulator * PRIME_1;
+	}
+
+	std::uint64_t XXHash64::merge_round(std::uint64_t hash, std::uint64_t accumulator)
+	{
+		hash ^= round(0, accumulator);
+		return hash * PRIME_1 + PRIME_4;
+	}
+
+	void XXHash64::consume_stripe(const std::uint8_t *stripe)
+	{
+		accumulators[0] = round(accumulators[0], read_uint64(&stripe[0]));
+		accumulators[1] = round(accumulators[1], read_uint64(&stripe[8]));
+		accumulators[2] = round(accumulators[2], read_uint64(&stripe[16]));
+		accumulators[3] = round(accumulators[3], read_uint64(&stripe[24]));
+	}
+
+	constexpr std::uint64_t XXHash64::PRIME_1;
+	constexpr std::uint64_t XXHash64::PRIME_2;
+	constexpr std::uint64_t XXHash64::PRIME_3;
+	constexpr std::uint64_t XXHash64::PRIME_4;
+	constexpr std::uint64_t XXHash64::PRIME_5;
+	constexpr std::size_t XXHash64::STRIPE_SIZE;
+} // namespace isobus